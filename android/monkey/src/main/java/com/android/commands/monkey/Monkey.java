@@ -748,7 +748,15 @@ public class Monkey {
             AndroidDevice.initializeAndroidDevice(mAm, mWm, mPm, ime);
             AndroidDevice.checkInteractive();
 
-            if (!"".equals(mMappingFilePath) && !"max.mapping".equals(mMappingFilePath)) {
+            boolean asyncInit = Config.asyncInit && mUseApeNativeReuse;
+            String mappingPath = "max.mapping".equals(mMappingFilePath) ? "" : mMappingFilePath;
+            // native decisions follow the monkey seed, so a run can be replayed with -s
+            AiClient.setRandomSeed(mSeed);
+            if (asyncInit) {
+                // configs, reuse model and resource mapping load while permissions are granted
+                Logger.println("// init with reuse agent in the background");
+                AiClient.initAgentAsync(AiClient.AlgorithmType.configured(), mMainApps.get(0).getPackageName(), mappingPath);
+            } else if (!"".equals(mappingPath)) {
                 AiClient.loadResMapping(mMappingFilePath);
             }
 
@@ -763,7 +771,9 @@ public class Monkey {
                 ((MonkeySourceApeNative) mEventSource).startMutation(mWm, mAm, mVerbose);
             }
             ((MonkeySourceApeNative) mEventSource).setAttribute(mMainApps.get(0).getPackageName(), appVersionCode, mMainIntentAction, mMainIntentData, mMainQuickAppActivity);
-            if (mUseApeNativeReuse) {
+            if (asyncInit) {
+                ((MonkeySourceApeNative) mEventSource).startGuiTraceRecording();
+            } else if (mUseApeNativeReuse) {
                 Logger.println("// init with reuse agent");
                 ((MonkeySourceApeNative) mEventSource).initReuseAgent();
             }
@@ -775,7 +785,15 @@ public class Monkey {
             AndroidDevice.initializeAndroidDevice(mAm, mWm, mPm, ime);
             AndroidDevice.checkInteractive();
 
-            if (!"".equals(mMappingFilePath) && !"max.mapping".equals(mMappingFilePath)) {
+            boolean asyncInit = Config.asyncInit && mUseApeNativeReuse;
+            String mappingPath = "max.mapping".equals(mMappingFilePath) ? "" : mMappingFilePath;
+            // native decisions follow the monkey seed, so a run can be replayed with -s
+            AiClient.setRandomSeed(mSeed);
+            if (asyncInit) {
+                // configs, reuse model and resource mapping load while permissions are granted
+                Logger.println("// init with reuse agent in the background");
+                AiClient.initAgentAsync(AiClient.AlgorithmType.configured(), mMainApps.get(0).getPackageName(), mappingPath);
+            } else if (!"".equals(mappingPath)) {
                 AiClient.loadResMapping(mMappingFilePath);
             }
 
@@ -790,7 +808,9 @@ public class Monkey {
                 ((MonkeySourceApeU2) mEventSource).startMutation(mWm, mAm, mVerbose);
             }
             ((MonkeySourceApeU2) mEventSource).setAttribute(mMainApps.get(0).getPackageName(), appVersionCode, mMainIntentAction, mMainIntentData, mMainQuickAppActivity);
-            if (mUseApeNativeReuse) {
+            if (asyncInit) {
+                ((MonkeySourceApeU2) mEventSource).startGuiTraceRecording();
+            } else if (mUseApeNativeReuse) {
                 Logger.println("// init with reuse agent");
                 ((MonkeySourceApeU2) mEventSource).initReuseAgent();
             }
@@ -27,6 +27,8 @@ import com.android.commands.monkey.utils.RandomHelper;
 import org.json.JSONException;
 import org.json.JSONObject;
 
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
 import java.util.ArrayList;
 import java.util.Collections;
 import java.util.List;
@@ -119,6 +121,46 @@ public class CustomEventFuzzer {
         }
     }
 
+    /**
+     * Decode count fuzz actions written by AiClient.getFuzzActions into out. Each record is
+     * type u8 (0 rotation, 1 app_switch, 2 drag, 3 pinch, 4 click) | flag u8 | point count u16 |
+     * value i32 | (x f32, y f32) x point count, little-endian.
+     */
+    public static void fromNativeFuzzBuffer(ByteBuffer buffer, int count, List<CustomEvent> out) {
+        ByteBuffer in = buffer.duplicate().order(ByteOrder.LITTLE_ENDIAN);
+        in.clear();
+        for (int i = 0; i < count; i++) {
+            int type = in.get() & 0xFF;
+            boolean flag = in.get() != 0;
+            int pointCount = in.getShort() & 0xFFFF;
+            int value = in.getInt();
+            float[] values = new float[pointCount * 2];
+            for (int k = 0; k < values.length; k++) {
+                values[k] = in.getFloat();
+            }
+            switch (type) {
+                case 0:
+                    out.add(new RotationEvent(value, flag));
+                    break;
+                case 1:
+                    out.add(new SwitchEvent(flag));
+                    break;
+                case 2:
+                    out.add(DragEvent.fromValues(values));
+                    break;
+                case 3:
+                    out.add(new PinchOrZoomEvent(values));
+                    break;
+                case 4:
+                    out.add(new ClickEvent(values[0], values[1], value));
+                    break;
+                default:
+                    Logger.warningPrintln("fromNativeFuzzBuffer: unknown fuzz action type " + type);
+                    return;
+            }
+        }
+    }
+
     public static List<CustomEvent> generateSimplifyFuzzingEvents() {
         List<CustomEvent> events = new ArrayList<CustomEvent>();
         int repeat = RandomHelper.nextBetween(1, 3);
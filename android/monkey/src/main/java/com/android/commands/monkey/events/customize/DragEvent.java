@@ -45,6 +45,11 @@ public class DragEvent extends AbstractCustomEvent {
         this.values = values;
     }
 
+    /** Drag through flat [x1,y1,x2,y2,...] values, as native fuzzing sends them. */
+    public static CustomEvent fromValues(float[] values) {
+        return new DragEvent(values);
+    }
+
     public static CustomEvent fromJSONObject(JSONObject jEvent) throws JSONException {
         JSONArray jValues = jEvent.getJSONArray("values");
         float[] values = new float[jValues.length()];
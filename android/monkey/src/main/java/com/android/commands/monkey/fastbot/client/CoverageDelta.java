@@ -0,0 +1,56 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+
+package com.android.commands.monkey.fastbot.client;
+
+import java.nio.ByteBuffer;
+import java.nio.charset.StandardCharsets;
+import java.util.ArrayList;
+import java.util.List;
+
+/**
+ * Coverage changes since a version, as native Model::writeCoverageDelta encodes them.
+ * Pass {@link #version} to the next AiClient.getCoverageDelta to get only what is new.
+ */
+public class CoverageDelta {
+    /** Number of distinct activities seen so far. */
+    public int version;
+    /** Activity reports so far. */
+    public int stepsCount;
+    /** Activities first seen since the requested version, in order. */
+    public final List<String> newActivities = new ArrayList<>();
+
+    /** Bytes before the activity records. */
+    public static final int BINARY_HEADER_SIZE = 16;
+
+    /**
+     * Fill the fields from a delta. Layout (little-endian): magic "FC\0\1", u32 version,
+     * u32 stepsCount, u32 activity count, then (u16 length, UTF-8 bytes) per activity.
+     * @param buffer result buffer in little-endian order
+     * @param length bytes written by native
+     * @return false if the delta is malformed
+     */
+    public boolean readFrom(ByteBuffer buffer, int length) {
+        newActivities.clear();
+        if (length < BINARY_HEADER_SIZE || length > buffer.capacity()) return false;
+        if (buffer.get(0) != 'F' || buffer.get(1) != 'C' || buffer.get(2) != 0 || buffer.get(3) != 1) return false;
+        version = buffer.getInt(4);
+        stepsCount = buffer.getInt(8);
+        int count = buffer.getInt(12);
+        int offset = BINARY_HEADER_SIZE;
+        for (int i = 0; i < count; i++) {
+            if (offset + 2 > length) return false;
+            int size = buffer.getShort(offset) & 0xFFFF;
+            offset += 2;
+            if (size > length - offset) return false;
+            byte[] bytes = new byte[size];
+            ByteBuffer view = buffer.duplicate();
+            view.position(offset);
+            view.get(bytes);
+            newActivities.add(new String(bytes, StandardCharsets.UTF_8));
+            offset += size;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,92 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+
+package com.android.commands.monkey.fastbot.client;
+
+import android.graphics.Rect;
+import android.view.accessibility.AccessibilityNodeInfo;
+
+import java.nio.charset.StandardCharsets;
+import java.util.List;
+
+/**
+ * @author Zhao Zhang
+ */
+
+/**
+ * Several operations answered by one native call (AiClient.getActionPlanFromBuffer): the first runs
+ * on the page that was dumped, each later one only while its guard still holds on the live page,
+ * so scripted actions do not cost a GUI dump each.
+ */
+public class OperatePlan extends GsonIface {
+
+    public static class Step {
+        /** Activity the step expects; empty for no check. */
+        public String activity;
+        /** widgetGuardHash of the target the step was planned on; 0 for no check. */
+        public long widgetHash;
+        public Operate operate;
+
+        /**
+         * Whether the step may run without a new dump: the top activity is the expected one and
+         * root shows a widget at the operation's position with the expected hash.
+         */
+        public boolean guardHolds(String topActivity, AccessibilityNodeInfo root) {
+            if (operate == null) return false;
+            if (activity != null && !activity.isEmpty() && !activity.equals(topActivity)) return false;
+            if (widgetHash == 0) return true;
+            Rect bounds = new Rect();
+            return root != null && operate.setRectFromPos(bounds) && hasWidget(root, bounds, widgetHash, new Rect());
+        }
+    }
+
+    public List<Step> steps;
+
+    public static OperatePlan fromJson(String jsonStr) {
+        return gson.fromJson(jsonStr, OperatePlan.class);
+    }
+
+    private static final long FNV_OFFSET = 0xcbf29ce484222325L;
+    private static final long FNV_PRIME = 0x100000001b3L;
+
+    /**
+     * Same as native PlannedOperate::widgetGuardHash: 64-bit FNV-1a over the UTF-8 class name,
+     * then left, top, right, bottom as little-endian int32.
+     */
+    public static long widgetGuardHash(CharSequence className, Rect bounds) {
+        long hash = FNV_OFFSET;
+        if (className != null) {
+            for (byte b : className.toString().getBytes(StandardCharsets.UTF_8)) {
+                hash = (hash ^ (b & 0xFF)) * FNV_PRIME;
+            }
+        }
+        int[] values = {bounds.left, bounds.top, bounds.right, bounds.bottom};
+        for (int value : values) {
+            for (int shift = 0; shift < 32; shift += 8) {
+                hash = (hash ^ ((value >>> shift) & 0xFF)) * FNV_PRIME;
+            }
+        }
+        return hash;
+    }
+
+    /** Whether node or a visible node under it has the given bounds and guard hash. */
+    private static boolean hasWidget(AccessibilityNodeInfo node, Rect bounds, long hash, Rect reuseRect) {
+        node.getBoundsInScreen(reuseRect);
+        if (reuseRect.equals(bounds) && widgetGuardHash(node.getClassName(), reuseRect) == hash) {
+            return true;
+        }
+        int childCount = node.getChildCount();
+        for (int i = 0; i < childCount; i++) {
+            AccessibilityNodeInfo child = node.getChild(i);
+            if (child != null) {
+                try {
+                    if (child.isVisibleToUser() && hasWidget(child, bounds, hash, reuseRect)) return true;
+                } finally {
+                    child.recycle();
+                }
+            }
+        }
+        return false;
+    }
+}
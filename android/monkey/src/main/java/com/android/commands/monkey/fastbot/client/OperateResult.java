@@ -4,6 +4,9 @@
 
 package com.android.commands.monkey.fastbot.client;
 
+import java.nio.ByteBuffer;
+import java.nio.charset.StandardCharsets;
+
 /**
  * Native-friendly result for getAction. JNI fills these fields; Java builds Operate from it.
  */
@@ -22,4 +25,53 @@ public class OperateResult {
     public String aid;
     public String jAction;
     public String widget;
+
+    /** Bytes before the string table in the binary operation layout. */
+    public static final int BINARY_FIXED_SIZE = 32;
+    /** Fixed part plus the string table (offset, length) of text, sid, aid, jAction, widget. */
+    public static final int BINARY_HEADER_SIZE = BINARY_FIXED_SIZE + 5 * 8;
+
+    /**
+     * Fill the fields from an operation encoded by native DeviceOperateWrapper::writeBinary.
+     * Layout (little-endian): magic "FO\0\1", i32 actOrdinal, i16[4] pos, i32 throttle,
+     * u8 flags (clear, adbInput, rawInput, allowFuzzing, editable from bit 0) and 3 bytes padding,
+     * i64 waitTime, then (u32 offset, i32 length; -1 = null) for text, sid, aid, jAction, widget,
+     * whose UTF-8 bytes follow.
+     * @param buffer result buffer in little-endian order
+     * @param length bytes written by native
+     * @return false if the result is malformed
+     */
+    public boolean readFrom(ByteBuffer buffer, int length) {
+        if (length < BINARY_HEADER_SIZE || length > buffer.capacity()) return false;
+        if (buffer.get(0) != 'F' || buffer.get(1) != 'O' || buffer.get(2) != 0 || buffer.get(3) != 1) return false;
+        actOrdinal = buffer.getInt(4);
+        pos = new short[]{buffer.getShort(8), buffer.getShort(10), buffer.getShort(12), buffer.getShort(14)};
+        throttle = buffer.getInt(16);
+        int flags = buffer.get(20);
+        clear = (flags & 1) != 0;
+        adbInput = (flags & 2) != 0;
+        rawInput = (flags & 4) != 0;
+        allowFuzzing = (flags & 8) != 0;
+        editable = (flags & 16) != 0;
+        waitTime = buffer.getLong(24);
+        String[] strings = new String[5];
+        for (int i = 0; i < strings.length; i++) {
+            int entry = BINARY_FIXED_SIZE + i * 8;
+            int offset = buffer.getInt(entry);
+            int size = buffer.getInt(entry + 4);
+            if (size < 0) continue;
+            if (offset < BINARY_HEADER_SIZE || offset > length || size > length - offset) return false;
+            byte[] bytes = new byte[size];
+            ByteBuffer view = buffer.duplicate();
+            view.position(offset);
+            view.get(bytes);
+            strings[i] = new String(bytes, StandardCharsets.UTF_8);
+        }
+        text = strings[0];
+        sid = strings[1];
+        aid = strings[2];
+        jAction = strings[3];
+        widget = strings[4];
+        return true;
+    }
 }
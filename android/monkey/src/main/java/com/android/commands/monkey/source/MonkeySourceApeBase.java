@@ -246,7 +246,15 @@ public abstract class MonkeySourceApeBase {
     }
 
     public void initReuseAgent() {
-        AiClient.InitAgent(AiClient.AlgorithmType.Reuse, this.packageName);
+        AiClient.InitAgent(AiClient.AlgorithmType.configured(), this.packageName);
+        startGuiTraceRecording();
+    }
+
+    /** Record the GUI trace if max.guiTraceFile is set; initReuseAgent does it after InitAgent. */
+    public void startGuiTraceRecording() {
+        if (!Config.guiTraceFile.isEmpty()) {
+            AiClient.startGuiTraceRecording(Config.guiTraceFile);
+        }
     }
 
     public File getOutputDir() {
@@ -86,6 +86,7 @@ import com.android.commands.monkey.events.customize.ClickEvent;
 import com.android.commands.monkey.events.customize.ShellEvent;
 import com.android.commands.monkey.fastbot.client.ActionType;
 import com.android.commands.monkey.fastbot.client.Operate;
+import com.android.commands.monkey.fastbot.client.OperatePlan;
 import com.android.commands.monkey.framework.AndroidDevice;
 import com.android.commands.monkey.provider.SchemaProvider;
 import com.android.commands.monkey.provider.ShellProvider;
@@ -104,10 +105,12 @@ import java.io.File;
 import java.io.FileOutputStream;
 import java.io.OutputStreamWriter;
 import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
 import java.nio.CharBuffer;
 import java.nio.charset.CharsetEncoder;
 import java.nio.charset.CoderResult;
 import java.nio.charset.StandardCharsets;
+import java.util.ArrayDeque;
 import java.util.ArrayList;
 import java.util.Arrays;
 import java.util.HashMap;
@@ -143,6 +146,12 @@ public class MonkeySourceApeNative extends MonkeySourceApeBase implements Monkey
     private ByteBuffer mXmlBuffer;
     /** Reusable list for generateFuzzingAction simplify path (PERFORMANCE_OPTIMIZATION_ITEMS §8.3). */
     private final List<CustomEvent> mReusableFuzzEvents = new ArrayList<>();
+    /** Native fuzz actions (AiClient.getFuzzActions); 3 actions of at most 16 points fit. */
+    private final ByteBuffer mFuzzActionBuffer = ByteBuffer.allocateDirect(512).order(ByteOrder.LITTLE_ENDIAN);
+    /** Steps of the last action plan not run yet (max.actionPlanSteps > 1), each run instead of a dump while its guard holds. */
+    private final ArrayDeque<OperatePlan.Step> mPlannedSteps = new ArrayDeque<>();
+    /** Steps of a plan dropped by a failed guard, not reported to native yet. */
+    private int mUnexecutedPlanSteps = 0;
 
     public MonkeySourceApeNative(Random random, List<ComponentName> MainApps,
                                  long throttle, boolean randomizeThrottle, boolean permissionTargetSystem,
@@ -195,6 +204,11 @@ public class MonkeySourceApeNative extends MonkeySourceApeBase implements Monkey
 
     public void tearDown() {
         this.disconnect();
+        AiClient.stopGuiTraceRecording();
+        // The native agent is never destructed when the process exits; save what it learned since the last save
+        AiClient.flushActivityReports();
+        AiClient.flushModel();
+        AiClient.endSession();
         this.printCoverage();
         for (ImageWriterQueue writer : mImageWriters) {
             writer.tearDown();
@@ -265,6 +279,43 @@ public class MonkeySourceApeNative extends MonkeySourceApeBase implements Monkey
         }
     }
 
+    /**
+     * Get action for the binary dump in mXmlBuffer; with max.actionPlanSteps > 1 the rest of the
+     * plan is kept in mPlannedSteps.
+     */
+    private Operate getActionFromBinaryBuffer(String activity) {
+        if (Config.actionPlanSteps <= 1) {
+            return AiClient.getActionFromBuffer(activity, mXmlBuffer);
+        }
+        OperatePlan plan = AiClient.getActionPlanFromBuffer(activity, mXmlBuffer, Config.actionPlanSteps,
+                mUnexecutedPlanSteps);
+        if (plan == null) {
+            return null;
+        }
+        mUnexecutedPlanSteps = 0;
+        mPlannedSteps.clear();
+        mPlannedSteps.addAll(plan.steps.subList(1, plan.steps.size()));
+        return plan.steps.get(0).operate;
+    }
+
+    /**
+     * Next planned step if its guard holds on the live page, so no dump is needed; otherwise the
+     * rest of the plan is dropped (and queued again natively with the next plan).
+     */
+    private Operate takePlannedOperate(String activity, AccessibilityNodeInfo root) {
+        OperatePlan.Step step = mPlannedSteps.pollFirst();
+        if (step == null) {
+            return null;
+        }
+        if (step.guardHolds(activity, root)) {
+            return step.operate;
+        }
+        if (mVerbose > 0) Logger.println("// planned step guard failed, dropping " + (mPlannedSteps.size() + 1) + " steps");
+        mUnexecutedPlanSteps += mPlannedSteps.size() + 1;
+        mPlannedSteps.clear();
+        return null;
+    }
+
     void resetRotation() {
         addEvent(new MonkeyRotationEvent(Surface.ROTATION_0, false));
     }
@@ -449,8 +500,15 @@ public class MonkeySourceApeNative extends MonkeySourceApeBase implements Monkey
             }
         }
 
+        // A planned step whose guard holds runs without dumping the page
+        if (info != null && topActivityName != null && !mPlannedSteps.isEmpty()) {
+            operate = takePlannedOperate(topActivityName.getClassName(), info);
+        }
+
         // If node is not null, build tree and recycle this resource.
-        if (info!=null){
+        if (info != null && operate != null) {
+            info.recycle();
+        } else if (info!=null){
             boolean useXmlOnly = "xml".equalsIgnoreCase(Config.treeDumpMode);
             if (useXmlOnly) {
                 // max.treeDumpMode=xml: skip binary, always dump XML (e.g. for perf comparison or compatibility).
@@ -460,11 +518,11 @@ public class MonkeySourceApeNative extends MonkeySourceApeBase implements Monkey
                 if (mVerbose > 0) Logger.println("// dumpXml: " + tDumpXml + " ms (treeDumpMode=xml)");
                 if (mVerbose > 3) Logger.println("//" + stringOfGuiTree);
             } else {
-                // Default: try compact binary first; fall back to XML if buffer too small or fail.
+                // Default: try compact binary first (a delta against the previous dump); fall back to XML if buffer too small or fail.
                 ensureXmlBufferCapacity(1024 * 1024);  // 1MB for large trees; dumpNodeRecBinary returns -1 if full
                 mXmlBuffer.clear();  // critical: remaining() must be capacity; otherwise limit was last write size
                 long tBin0 = System.currentTimeMillis();
-                int binaryWritten = TreeBuilder.dumpToBinary(info, mXmlBuffer);
+                int binaryWritten = TreeBuilder.dumpToBinaryDelta(info, mXmlBuffer, AiClient.getDeltaBaseDumpId());
                 tDumpBinary = System.currentTimeMillis() - tBin0;
                 if (mVerbose > 0) {
                     Logger.println("// dumpBinary: " + tDumpBinary + " ms" + (binaryWritten <= 0 ? " (buffer full or fail)" : ""));
@@ -472,7 +530,7 @@ public class MonkeySourceApeNative extends MonkeySourceApeBase implements Monkey
                 if (binaryWritten > 0) {
                     mXmlBuffer.position(0);
                     mXmlBuffer.limit(binaryWritten);
-                    operate = AiClient.getActionFromBuffer(topActivityName != null ? topActivityName.getClassName() : "", mXmlBuffer);
+                    operate = getActionFromBinaryBuffer(topActivityName != null ? topActivityName.getClassName() : "");
                 }
                 if (operate == null) {
                     if (mVerbose > 0) {
@@ -666,13 +724,10 @@ public class MonkeySourceApeNative extends MonkeySourceApeBase implements Monkey
             int w = bounds.width();
             int h = bounds.height();
             mReusableFuzzEvents.clear();
+            // All actions in one native call, binary, off the current activity's shielded areas
             int repeat = RandomHelper.nextBetween(1, 3);
-            for (int i = 0; i < repeat; i++) {
-                String json = AiClient.getNextFuzzAction(w, h, true);
-                if (json != null) {
-                    mReusableFuzzEvents.addAll(CustomEventFuzzer.fromNativeFuzzJson(json));
-                }
-            }
+            int written = AiClient.getFuzzActions(mFuzzActionBuffer, repeat, w, h, this.currentActivity);
+            CustomEventFuzzer.fromNativeFuzzBuffer(mFuzzActionBuffer, written, mReusableFuzzEvents);
             if (mReusableFuzzEvents.isEmpty()) {
                 return new FuzzAction(CustomEventFuzzer.generateSimplifyFuzzingEvents());
             }
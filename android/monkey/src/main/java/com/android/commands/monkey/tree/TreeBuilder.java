@@ -20,6 +20,8 @@ import java.io.StringWriter;
 import java.nio.ByteBuffer;
 import java.nio.ByteOrder;
 import java.nio.charset.StandardCharsets;
+import java.util.ArrayList;
+import java.util.HashMap;
 
 /**
  * @author Jianqiang Guo, Zhao Zhang
@@ -291,6 +293,268 @@ public class TreeBuilder {
         return savedPos;
     }
 
+    // Binary format v2: node count, one string table per dump, then nodes with varint fields, string indexes
+    // and bounds relative to the parent (see Element::createFromBinary).
+    private static final byte[] BINARY_MAGIC_V2 = {'F', 'B', 0, 2};
+    // Delta dump: a v2 dump with an id, whose unchanged subtrees reference the dump it is based on
+    // by pre-order position (see DeltaDumpDecoder).
+    private static final byte[] BINARY_MAGIC_DELTA = {'F', 'B', 0, 3};
+
+    /** Nodes of one v2 dump, written before the string table they index is known; reused per thread. */
+    private static final class BinaryV2Writer {
+        final HashMap<String, Integer> stringIndexes = new HashMap<>();
+        final ArrayList<String> strings = new ArrayList<>();
+        byte[] nodes = new byte[64 * 1024];
+        int size;
+        int nodeCount;
+        /** Whether nodes start with a reference, and whether they may reference the previous dump. */
+        boolean delta;
+        boolean referenceBase;
+        /** Subtree signature -> pre-order position, for the previous delta dump and the one being written. */
+        HashMap<Long, Integer> previousSubtrees = new HashMap<>();
+        HashMap<Long, Integer> currentSubtrees = new HashMap<>();
+        long previousDumpId;
+        long lastDumpId;
+        /** Signature of the subtree dumpNodeRecBinaryV2 wrote last. */
+        long signature;
+
+        void reset(boolean delta, boolean referenceBase) {
+            stringIndexes.clear();
+            strings.clear();
+            size = 0;
+            nodeCount = 0;
+            this.delta = delta;
+            this.referenceBase = referenceBase;
+            currentSubtrees.clear();
+        }
+
+        void putVarint(long value) {
+            if (size + 10 > nodes.length) {
+                byte[] grown = new byte[nodes.length * 2];
+                System.arraycopy(nodes, 0, grown, 0, size);
+                nodes = grown;
+            }
+            while ((value & ~0x7FL) != 0) {
+                nodes[size++] = (byte) ((value & 0x7F) | 0x80);
+                value >>>= 7;
+            }
+            nodes[size++] = (byte) value;
+        }
+
+        void putDelta(int value, int parentValue) {
+            long delta = (long) value - parentValue;
+            putVarint((delta << 1) ^ (delta >> 63));
+        }
+
+        int indexOf(String value) {
+            Integer index = stringIndexes.get(value);
+            if (index == null) {
+                index = strings.size();
+                stringIndexes.put(value, index);
+                strings.add(value);
+            }
+            return index;
+        }
+
+        /** Forget the strings added since the table had mark entries, i.e. by a subtree replaced with a reference. */
+        void truncateStrings(int mark) {
+            for (int i = strings.size() - 1; i >= mark; i--) {
+                stringIndexes.remove(strings.remove(i));
+            }
+        }
+    }
+
+    private static final ThreadLocal<BinaryV2Writer> sBinaryV2Writer = new ThreadLocal<BinaryV2Writer>() {
+        @Override
+        protected BinaryV2Writer initialValue() {
+            return new BinaryV2Writer();
+        }
+    };
+
+    private static void putVarint(ByteBuffer buf, long value) {
+        while ((value & ~0x7FL) != 0) {
+            buf.put((byte) ((value & 0x7F) | 0x80));
+            value >>>= 7;
+        }
+        buf.put((byte) value);
+    }
+
+    // 64-bit FNV-1a over subtree attributes: signatures must not collide across a dump and the next
+    private static final long FNV_OFFSET = 0xcbf29ce484222325L;
+    private static final long FNV_PRIME = 0x100000001b3L;
+
+    private static long mix(long hash, long value) {
+        for (int i = 0; i < 8; i++) {
+            hash = (hash ^ (value & 0xFF)) * FNV_PRIME;
+            value >>>= 8;
+        }
+        return hash;
+    }
+
+    private static long mix(long hash, String value) {
+        hash = mix(hash, value.length());
+        for (int i = 0; i < value.length(); i++) {
+            char c = value.charAt(i);
+            hash = ((hash ^ (c & 0xFF)) * FNV_PRIME ^ (c >>> 8)) * FNV_PRIME;
+        }
+        return hash;
+    }
+
+    /**
+     * Write tree to ByteBuffer in binary format v2: class and package names that repeat on every node are
+     * sent once in the string table, and the node count lets the C++ parser pre-size its storage.
+     *
+     * @param rootInfo root node
+     * @param buffer direct ByteBuffer, position advanced by bytes written
+     * @return bytes written, or -1 if buffer too small
+     */
+    public static int dumpToBinaryV2(AccessibilityNodeInfo rootInfo, ByteBuffer buffer) {
+        if (rootInfo == null || buffer == null || !buffer.isDirect()) return -1;
+        BinaryV2Writer writer = sBinaryV2Writer.get();
+        writer.reset(false, false);
+        if (!dumpNodeRecBinaryV2(rootInfo, writer, 0, 1, 0, 0, 0, 0)) return -1;
+        return writeBinaryV2(writer, buffer, BINARY_MAGIC_V2, 0, 0);
+    }
+
+    /**
+     * Write tree to ByteBuffer as a delta dump: every subtree that is unchanged since the previous delta dump
+     * is sent as a reference to it, which the native side resolves against the tree it kept.
+     *
+     * @param rootInfo root node
+     * @param buffer direct ByteBuffer, position advanced by bytes written
+     * @param baseDumpId dump the native side kept (AiClient.getDeltaBaseDumpId()); references are only
+     *                   written if it is the previous dump of this thread, e.g. not after a failed step
+     * @return bytes written, or -1 if buffer too small
+     */
+    public static int dumpToBinaryDelta(AccessibilityNodeInfo rootInfo, ByteBuffer buffer, long baseDumpId) {
+        if (rootInfo == null || buffer == null || !buffer.isDirect()) return -1;
+        BinaryV2Writer writer = sBinaryV2Writer.get();
+        boolean referenceBase = baseDumpId != 0 && baseDumpId == writer.previousDumpId;
+        writer.reset(true, referenceBase);
+        long dumpId = ++writer.lastDumpId;
+        int written = -1;
+        if (dumpNodeRecBinaryV2(rootInfo, writer, 0, 1, 0, 0, 0, 0)) {
+            written = writeBinaryV2(writer, buffer, BINARY_MAGIC_DELTA, dumpId, referenceBase ? baseDumpId : 0);
+        }
+        // Swap the maps: this dump is the base of the next one if the native side takes it
+        HashMap<Long, Integer> subtrees = writer.previousSubtrees;
+        writer.previousSubtrees = writer.currentSubtrees;
+        writer.currentSubtrees = subtrees;
+        writer.previousDumpId = written > 0 ? dumpId : 0;
+        return written;
+    }
+
+    private static int writeBinaryV2(BinaryV2Writer writer, ByteBuffer buffer, byte[] magic, long dumpId,
+                                     long baseDumpId) {
+        byte[][] strings = new byte[writer.strings.size()][];
+        long total = magic.length + 4 * 10 + writer.size;
+        for (int i = 0; i < strings.length; i++) {
+            strings[i] = toUtf8Bytes(writer.strings.get(i));
+            total += 5 + strings[i].length;
+        }
+        if (buffer.remaining() < total) return -1;
+        buffer.put(magic);
+        if (magic == BINARY_MAGIC_DELTA) {
+            putVarint(buffer, dumpId);
+            putVarint(buffer, baseDumpId);
+        }
+        putVarint(buffer, writer.nodeCount);
+        putVarint(buffer, strings.length);
+        for (byte[] value : strings) {
+            putVarint(buffer, value.length);
+            buffer.put(value);
+        }
+        buffer.put(writer.nodes, 0, writer.size);
+        return buffer.position();
+    }
+
+    private static boolean dumpNodeRecBinaryV2(AccessibilityNodeInfo node, BinaryV2Writer w, int index, int depth,
+                                               int parentLeft, int parentTop, int parentRight, int parentBottom) {
+        if (depth > 25) return false;
+        int nodeStart = w.size;
+        int stringMark = w.strings.size();
+        int position = w.nodeCount++;
+        if (w.delta) w.putVarint(0);  // reference: 0 for a node sent in full
+        Rect r = sBinaryDumpRect.get();
+        getVisibleBoundsInScreen(node, r);
+        int left = r.left, top = r.top, right = r.right, bottom = r.bottom;
+        w.putDelta(left, parentLeft);
+        w.putDelta(top, parentTop);
+        w.putDelta(right, parentRight);
+        w.putDelta(bottom, parentBottom);
+        w.putVarint(index);
+        int flags = 0;
+        if (node.isCheckable()) flags |= 1;
+        if (node.isChecked()) flags |= 2;
+        if (node.isClickable()) flags |= 4;
+        if (node.isEnabled()) flags |= 8;
+        if (node.isFocusable()) flags |= 16;
+        if (node.isFocused()) flags |= 32;
+        if (node.isScrollable()) flags |= 64;
+        if (node.isLongClickable()) flags |= 128;
+        if (node.isPassword()) flags |= 256;
+        if (node.isSelected()) flags |= 512;
+        w.putVarint(flags);
+        String text = safeCharSeqToString(node.getText());
+        String rid = safeCharSeqToString(node.getViewIdResourceName());
+        String clazz = safeCharSeqToString(node.getClassName());
+        String pkg = safeCharSeqToString(node.getPackageName());
+        String cd = safeCharSeqToString(node.getContentDescription());
+        int fieldMask = (text.isEmpty() ? 0 : 1 << TAG_TEXT) | (rid.isEmpty() ? 0 : 1 << TAG_RID)
+                | (clazz.isEmpty() ? 0 : 1 << TAG_CLASS) | (pkg.isEmpty() ? 0 : 1 << TAG_PKG)
+                | (cd.isEmpty() ? 0 : 1 << TAG_CD);
+        w.putVarint(fieldMask);  // < 0x80: one byte, as the parser reads it
+        if (!text.isEmpty()) w.putVarint(w.indexOf(text));
+        if (!rid.isEmpty()) w.putVarint(w.indexOf(rid));
+        if (!clazz.isEmpty()) w.putVarint(w.indexOf(clazz));
+        if (!pkg.isEmpty()) w.putVarint(w.indexOf(pkg));
+        if (!cd.isEmpty()) w.putVarint(w.indexOf(cd));
+        // The node's own index is left out: a subtree that only moved among its siblings is still reused
+        long signature = FNV_OFFSET;
+        if (w.delta) {
+            signature = mix(mix(mix(mix(mix(signature, left), top), right), bottom), flags);
+            signature = mix(mix(mix(mix(mix(signature, text), rid), clazz), pkg), cd);
+        }
+        // Single pass as in v1: the child count is back-patched as a varint padded to three bytes
+        int posNumChildren = w.size;
+        w.putVarint(0);
+        w.putVarint(0);
+        w.putVarint(0);
+        int childCount = node.getChildCount();
+        int written = 0;
+        for (int i = 0; i < childCount; i++) {
+            AccessibilityNodeInfo child = node.getChild(i);
+            if (child != null) {
+                try {
+                    if (child.isVisibleToUser()) {
+                        if (!dumpNodeRecBinaryV2(child, w, written, depth + 1, left, top, right, bottom)) return false;
+                        signature = mix(signature, w.signature);
+                        written++;
+                    }
+                } finally {
+                    child.recycle();
+                }
+            }
+        }
+        w.nodes[posNumChildren] = (byte) ((written & 0x7F) | 0x80);
+        w.nodes[posNumChildren + 1] = (byte) (((written >>> 7) & 0x7F) | 0x80);
+        w.nodes[posNumChildren + 2] = (byte) ((written >>> 14) & 0x7F);
+        if (w.delta) {
+            signature = mix(signature, written);
+            w.signature = signature;
+            if (!w.currentSubtrees.containsKey(signature)) w.currentSubtrees.put(signature, position);
+            Integer previous = w.referenceBase ? w.previousSubtrees.get(signature) : null;
+            if (previous != null) {
+                // Unchanged since the previous dump: replace what was written with a reference
+                w.size = nodeStart;
+                w.truncateStrings(stringMark);
+                w.putVarint(previous + 1L);
+                w.putVarint(index);
+            }
+        }
+        return true;
+    }
+
     /**
      * Using {@link AccessibilityNodeInfo} this method will walk the layout hierarchy
      * and generates an xml dump to the location specified by <code>dumpFile</code>
@@ -90,6 +90,38 @@ public class Config {
      * Config: max.treeDumpMode = binary | xml
      */
     public static final String treeDumpMode = Config.get("max.treeDumpMode", "xml");
+    /**
+     * native writes each action in binary into a reused direct buffer instead of returning JSON
+     * or creating an OperateResult object through JNI, enable by default
+     */
+    public static final boolean nativeResultBuffer = Config.getBoolean("max.nativeResultBuffer", true);
+    /**
+     * operations native may answer per binary dump: queued custom actions after the first are run
+     * without dumping while the activity and target widget they were planned on are still shown;
+     * 1 (default) asks for one operation per dump.
+     * Config: max.actionPlanSteps = 4
+     */
+    public static final int actionPlanSteps = Config.getInteger("max.actionPlanSteps", 1);
+    /**
+     * start the reuse agent in the background: native loads its configs, the reuse model and the
+     * resource mapping in parallel while permissions are granted, and the first step waits for
+     * them; disabled by default.
+     * Config: max.asyncInit = true
+     */
+    public static final boolean asyncInit = Config.getBoolean("max.asyncInit", false);
+    /**
+     * host:port of a decision server (fastbot_decision_server) running the model on a host: the
+     * agent is started as AlgorithmType.Server and native forwards every dump to it, deciding
+     * locally while it is slow or unreachable; empty (default) decides on the device.
+     * Config: max.decisionServer = 192.168.1.10:7330
+     */
+    public static final String decisionServer = Config.get("max.decisionServer", "");
+    /**
+     * record every getAction call (GUI tree, activity, operation, native cost) to this file for the
+     * native replay benchmark; empty (default) disables recording.
+     * Config: max.guiTraceFile = /sdcard/fastbot_gui_trace.bin
+     */
+    public static final String guiTraceFile = Config.get("max.guiTraceFile", "");
     /**
      * generator fuzzing event
      */
@@ -8,13 +8,18 @@ import android.graphics.PointF;
 import android.os.Build;
 import android.os.SystemClock;
 
+import com.android.commands.monkey.fastbot.client.CoverageDelta;
 import com.android.commands.monkey.fastbot.client.Operate;
+import com.android.commands.monkey.fastbot.client.OperatePlan;
 import com.android.commands.monkey.fastbot.client.OperateResult;
+import com.android.commands.monkey.utils.Config;
 import com.android.commands.monkey.utils.Logger;
 
 import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
 import java.nio.charset.StandardCharsets;
 import java.util.Arrays;
+import java.util.HashMap;
 import java.util.List;
 import java.util.concurrent.TimeUnit;
 
@@ -43,7 +48,8 @@ public class AiClient {
         SataRL(1),
         SataNStep(2),
         NStepQ(3),
-        Reuse(4);
+        Reuse(4),
+        Server(6);
 
         private final int _value;
 
@@ -54,14 +60,41 @@ public class AiClient {
         public int value() {
             return this._value;
         }
+
+        /** Server when max.decisionServer is set, Reuse otherwise. */
+        public static AlgorithmType configured() {
+            return Config.decisionServer.isEmpty() ? Reuse : Server;
+        }
     }
 
     public static void InitAgent(AlgorithmType agentType, String packagename) {
         singleton.fgdsaf5d(agentType.value(), packagename, 0);
     }
 
+    /**
+     * InitAgent and loadResMapping (resmapping, "" for none) in the background, returning at once:
+     * native loads the configs, the reuse model and the mapping in parallel, and the first
+     * getAction waits only for what its step needs.
+     */
+    public static void initAgentAsync(AlgorithmType agentType, String packagename, String resmapping) {
+        singleton.initAgentAsyncNative(agentType.value(), packagename, 0, resmapping);
+    }
+
     private boolean loaded = false;
 
+    /** Reused by getActionFromBuffer for native results; grown when a result does not fit. */
+    private ByteBuffer resultBuffer = ByteBuffer.allocateDirect(16 * 1024).order(ByteOrder.LITTLE_ENDIAN);
+    private final OperateResult bufferResult = new OperateResult();
+
+    /** Activity switches sent to native in one call per batch: (u16 length, UTF-8 bytes) records. */
+    private static final int ACTIVITY_REPORT_BATCH = 16;
+    private ByteBuffer activityReports = ByteBuffer.allocateDirect(4 * 1024).order(ByteOrder.LITTLE_ENDIAN);
+    private int queuedActivityReports = 0;
+    /** Native handles of the activities seen (registerActivityNative), so steps pass an int, not a string. */
+    private final HashMap<String, Integer> activityHandles = new HashMap<>();
+    /** Reused by getCoverageDelta; grown when a delta does not fit. */
+    private ByteBuffer coverageBuffer = ByteBuffer.allocateDirect(4 * 1024).order(ByteOrder.LITTLE_ENDIAN);
+
     protected AiClient(boolean success) {
         loaded = success;
     }
@@ -144,7 +177,17 @@ public class AiClient {
      */
     public static void reportActivity(String activity) {
         if (activity != null && singleton.loaded) {
-            singleton.reportActivityNative(activity);
+            singleton.queueActivityReport(activity);
+        }
+    }
+
+    /**
+     * Send the activity switches queued by reportActivity to native. Coverage queries flush
+     * first; call it before the run ends.
+     */
+    public static void flushActivityReports() {
+        if (singleton.loaded) {
+            singleton.sendActivityReports();
         }
     }
 
@@ -153,10 +196,81 @@ public class AiClient {
      */
     public static String getCoverageJson() {
         if (!singleton.loaded) return "{}";
+        singleton.sendActivityReports();
         String s = singleton.getCoverageJsonNative();
         return s != null ? s : "{}";
     }
 
+    /**
+     * Coverage since sinceVersion in binary: the counters and only the activities first seen
+     * since, so periodic polling does not serialize the whole set (pass 0 for all of it, then
+     * the version of the last delta).
+     * @return the delta, or null if native is not loaded or has no model
+     */
+    public static CoverageDelta getCoverageDelta(int sinceVersion) {
+        if (!singleton.loaded) return null;
+        return singleton.readCoverageDelta(sinceVersion);
+    }
+
+    /** Queue one activity switch, sending the queue when it is full. */
+    private synchronized void queueActivityReport(String activity) {
+        byte[] bytes = activity.getBytes(StandardCharsets.UTF_8);
+        int length = Math.min(bytes.length, 0xFFFF);
+        if (activityReports.remaining() < 2 + length) {
+            sendActivityReports();
+            if (activityReports.remaining() < 2 + length) {
+                activityReports = ByteBuffer.allocateDirect(Integer.highestOneBit(2 + length) << 1)
+                        .order(ByteOrder.LITTLE_ENDIAN);
+            }
+        }
+        activityReports.putShort((short) length).put(bytes, 0, length);
+        if (++queuedActivityReports >= ACTIVITY_REPORT_BATCH) {
+            sendActivityReports();
+        }
+    }
+
+    private synchronized void sendActivityReports() {
+        if (activityReports.position() > 0) {
+            reportActivitiesNative(activityReports, activityReports.position());
+            activityReports.clear();
+        }
+        queuedActivityReports = 0;
+    }
+
+    private synchronized CoverageDelta readCoverageDelta(int sinceVersion) {
+        sendActivityReports();
+        int written = getCoverageDeltaNative(sinceVersion, coverageBuffer);
+        if (written < 0) {
+            coverageBuffer = ByteBuffer.allocateDirect(Integer.highestOneBit(-written) << 1).order(ByteOrder.LITTLE_ENDIAN);
+            written = getCoverageDeltaNative(sinceVersion, coverageBuffer);
+        }
+        CoverageDelta delta = new CoverageDelta();
+        return written > 0 && delta.readFrom(coverageBuffer, written) ? delta : null;
+    }
+
+    /**
+     * Per-stage getAction latency histograms from native, in microseconds:
+     * {"unit":"us","stages":{"parse":{"count":N,"mean":..,"p50":..,"p90":..,"p99":..,"p999":..,"max":..},...}}
+     * @param reset clear the histograms after taking the snapshot
+     */
+    public static String getPerfStats(boolean reset) {
+        if (!singleton.loaded) return "{}";
+        String s = singleton.getPerfStatsNative(reset);
+        return s != null && !s.isEmpty() ? s : "{}";
+    }
+
+    /**
+     * Estimated native heap bytes per subsystem (graph states, widgets, actions, Q-table,
+     * reuse model, preference caches...), to see which structure grows during a long run:
+     * {"totalBytes":N,"processRssBytes":N,"subsystems":{"graph.states":{"count":N,"bytes":N},...}}
+     * Walks the whole model: poll it every few minutes, not every step.
+     */
+    public static String getMemoryFootprint() {
+        if (!singleton.loaded) return "{}";
+        String s = singleton.getMemoryFootprintNative();
+        return s != null && !s.isEmpty() ? s : "{}";
+    }
+
     /**
      * Get next fuzz action JSON from native (performance §3.3). Returns one fuzz action as JSON;
      * simplify=true picks from rotation/app_switch/drag/pinch/click only.
@@ -166,18 +280,105 @@ public class AiClient {
         return singleton.getNextFuzzActionNative(displayWidth, displayHeight, simplify);
     }
 
+    /**
+     * Write up to count fuzz actions into buffer (a little-endian Direct ByteBuffer) in one native
+     * call, without JSON; CustomEventFuzzer.fromNativeFuzzBuffer reads them back. With an activity,
+     * actions touching its shielded areas are drawn again; pass null for no filter.
+     * @return number of actions written (fewer if the buffer is full), 0 if native is not loaded
+     */
+    public static int getFuzzActions(ByteBuffer buffer, int count, int displayWidth, int displayHeight,
+                                     String activity) {
+        if (!singleton.loaded || buffer == null || !buffer.isDirect()) return 0;
+        return singleton.getFuzzActionsIntoBufferNative(buffer, count, displayWidth, displayHeight, activity);
+    }
+
+    /**
+     * Seed every native random generator (agents, state sampling, fuzzing) with seed, so a run
+     * with the same seed takes the same decisions. Call before InitAgent / initAgentAsync.
+     */
+    public static void setRandomSeed(long seed) {
+        if (!singleton.loaded) return;
+        singleton.setRandomSeedNative(seed);
+    }
+
+    /**
+     * Persist the native reuse model now instead of at its next scheduled save.
+     * Call from the thread that requests actions, e.g. before the test stops.
+     * @return true if the model changes were written
+     */
+    public static boolean flushModel() {
+        if (!singleton.loaded) return false;
+        return singleton.flushModelNative();
+    }
+
+    /**
+     * End the native session cleanly: stop its snapshots (max.sessionSnapshotSeconds) and
+     * delete the snapshot file, so the next run does not resume from it.
+     */
+    public static void endSession() {
+        if (!singleton.loaded) return;
+        singleton.endSessionNative();
+    }
+
+    /**
+     * Record every getAction call (GUI tree, activity, chosen operation, native cost) to a GUI
+     * trace file, the corpus of the native replay benchmark. Writing happens on a native
+     * background thread; calls are dropped rather than delayed if the disk falls behind.
+     * Replaces the trace being recorded, if any.
+     * @param path trace file to create, e.g. /sdcard/fastbot_gui_trace.bin
+     * @return true if recording started
+     */
+    public static boolean startGuiTraceRecording(String path) {
+        if (!singleton.loaded || path == null) return false;
+        return singleton.startGuiTraceRecordingNative(path);
+    }
+
+    /** Stop recording the GUI trace started by startGuiTraceRecording. */
+    public static void stopGuiTraceRecording() {
+        if (!singleton.loaded) return;
+        singleton.stopGuiTraceRecordingNative();
+    }
+
+    /**
+     * Reload max.widget.black and max.tree.pruning without restarting the agent.
+     * The files are parsed on the calling thread; pages after the swap use the new rules.
+     * @param onlyIfChanged skip the reload if neither file changed since the last load
+     * @return true if new rules were applied
+     */
+    public static boolean reloadPreferences(boolean onlyIfChanged) {
+        if (!singleton.loaded) return false;
+        return singleton.reloadPreferencesNative(onlyIfChanged);
+    }
+
+    /**
+     * Delta dump the native side kept, which the next TreeBuilder.dumpToBinaryDelta may reference;
+     * 0 if it must send a dump without references (none kept yet, or the last one did not parse).
+     */
+    public static long getDeltaBaseDumpId() {
+        if (!singleton.loaded) return 0;
+        return singleton.getDeltaBaseDumpIdNative();
+    }
+
     /**
      * Get action from XML supplied as Direct ByteBuffer (performance: avoids JNI string copy).
-     * Tries structured result first to avoid JSON parse (opt4); falls back to JSON if needed.
+     * Tries structured result first to avoid JSON parse (opt4): the reused result buffer, or the
+     * OperateResult object when max.nativeResultBuffer is off; falls back to JSON if needed.
      */
     public static Operate getActionFromBuffer(String activity, ByteBuffer xmlBuffer) {
         if (xmlBuffer == null || !xmlBuffer.isDirect() || xmlBuffer.remaining() <= 0) {
             return null;
         }
         int byteLength = xmlBuffer.remaining();
-        OperateResult r = singleton.getActionFromBufferNativeStructured(activity, xmlBuffer, byteLength);
-        if (r != null) {
-            return Operate.fromOperateResult(r);
+        if (Config.nativeResultBuffer) {
+            Operate operate = singleton.getActionIntoResultBuffer(activity, xmlBuffer, byteLength);
+            if (operate != null) {
+                return operate;
+            }
+        } else {
+            OperateResult r = singleton.getActionFromBufferNativeStructured(activity, xmlBuffer, byteLength);
+            if (r != null) {
+                return Operate.fromOperateResult(r);
+            }
         }
         String operateStr = singleton.getActionFromBufferNative(activity, xmlBuffer, byteLength);
         if (operateStr == null || operateStr.length() < 1) {
@@ -186,10 +387,117 @@ public class AiClient {
         return Operate.fromJson(operateStr);
     }
 
+    /**
+     * Like getActionFromBuffer, followed by up to maxSteps - 1 queued custom actions that native
+     * resolved on the same page; run each later step only while OperatePlan.Step.guardHolds.
+     * @param unexecutedSteps trailing steps of the previous plan that were not run; native queues them again
+     * @return null if native returned no plan
+     */
+    public static OperatePlan getActionPlanFromBuffer(String activity, ByteBuffer xmlBuffer, int maxSteps,
+                                                      int unexecutedSteps) {
+        if (xmlBuffer == null || !xmlBuffer.isDirect() || xmlBuffer.remaining() <= 0) {
+            return null;
+        }
+        String planStr = singleton.getActionPlanFromBufferNative(activity, xmlBuffer, xmlBuffer.remaining(),
+                maxSteps, unexecutedSteps);
+        if (planStr == null || planStr.length() < 1) {
+            return null;
+        }
+        OperatePlan plan = OperatePlan.fromJson(planStr);
+        return plan != null && plan.steps != null && !plan.steps.isEmpty() ? plan : null;
+    }
+
+    /**
+     * Native writes the action into resultBuffer (no JNI object allocation); a result larger than
+     * the buffer is kept natively and copied into a grown buffer without running another step.
+     * @return null if native returned no structured result
+     */
+    private Operate getActionIntoResultBuffer(String activity, ByteBuffer xmlBuffer, int byteLength) {
+        int written = getActionFromBufferNativeIntoByHandle(activityHandle(activity), xmlBuffer, byteLength,
+                resultBuffer);
+        if (written < 0) {
+            written = takePendingResultIntoGrownBuffer(written);
+        }
+        return readResultBuffer(written);
+    }
+
+    /** pollActionResultNative: the submitted step is still running. */
+    private static final int ACTION_PENDING = Integer.MIN_VALUE;
+
+    /**
+     * Start getActionFromBuffer on a native worker and return at once, so the caller can wait for
+     * the device meanwhile; take the operation with pollAction. xmlBuffer must stay untouched
+     * until pollAction returned it.
+     * @return false if nothing was submitted (bad buffer, or a submitted step not polled yet)
+     */
+    public static boolean submitActionFromBuffer(String activity, ByteBuffer xmlBuffer) {
+        if (xmlBuffer == null || !xmlBuffer.isDirect() || xmlBuffer.remaining() <= 0) {
+            return false;
+        }
+        boolean submitted = singleton.submitActionFromBufferNativeByHandle(singleton.activityHandle(activity),
+                xmlBuffer, xmlBuffer.remaining());
+        singleton.actionPending |= submitted;
+        return submitted;
+    }
+
+    /**
+     * Operation of the step submitted by submitActionFromBuffer.
+     * @param timeoutMs how long to wait for it; negative waits until it is done
+     * @return null if it is still running after timeoutMs (see isActionPending), or it has no operation
+     */
+    public static Operate pollAction(long timeoutMs) {
+        return singleton.pollActionIntoResultBuffer(timeoutMs);
+    }
+
+    /** Whether a submitted step was not polled to completion yet. */
+    public static boolean isActionPending() {
+        return singleton.actionPending;
+    }
+
+    private boolean actionPending = false;
+
+    /** Handle of an activity name, registered with native the first time it is seen; 0 for null. */
+    private synchronized int activityHandle(String activity) {
+        if (activity == null) {
+            return 0;
+        }
+        Integer handle = activityHandles.get(activity);
+        if (handle == null) {
+            handle = registerActivityNative(activity);
+            activityHandles.put(activity, handle);
+        }
+        return handle;
+    }
+
+    private Operate pollActionIntoResultBuffer(long timeoutMs) {
+        int written = pollActionResultNative(resultBuffer, timeoutMs);
+        actionPending = written == ACTION_PENDING;
+        if (actionPending) {
+            return null;
+        }
+        if (written < 0) {
+            written = takePendingResultIntoGrownBuffer(written);
+        }
+        return readResultBuffer(written);
+    }
+
+    private int takePendingResultIntoGrownBuffer(int written) {
+        resultBuffer = ByteBuffer.allocateDirect(Integer.highestOneBit(-written) << 1).order(ByteOrder.LITTLE_ENDIAN);
+        return takePendingResultNative(resultBuffer);
+    }
+
+    private Operate readResultBuffer(int written) {
+        if (written <= 0 || !bufferResult.readFrom(resultBuffer, written)) {
+            return null;
+        }
+        return Operate.fromOperateResult(bufferResult);
+    }
+
     private native void jdasdbil(String b9);
 
     private native String b0bhkadf(String a0, String a1);
     private native void fgdsaf5d(int b7, String b2, int t);
+    private native void initAgentAsyncNative(int agentType, String packageName, int deviceType, String resMapping);
     private native boolean nkksdhdk(String a0, float p1, float p2);
 
     /**
@@ -201,6 +509,12 @@ public class AiClient {
      */
     private native boolean[] checkPointsInShieldNative(String activity, float[] xCoords, float[] yCoords);
 
+    /** checkPointsInShieldNative with a handle of registerActivityNative. */
+    private native boolean[] checkPointsInShieldNativeByHandle(int activityHandle, float[] xCoords, float[] yCoords);
+
+    /** Intern an activity name natively; the handle stands for it in the ...ByHandle calls. */
+    private native int registerActivityNative(String activity);
+
     /**
      * Get action from XML in Direct ByteBuffer (performance: avoid GetStringUTFChars copy, PERF §3.1).
      * @param activity current activity name
@@ -213,9 +527,49 @@ public class AiClient {
     /** Structured result to avoid JSON parse (SECURITY_AND_OPTIMIZATION §7 opt4). Returns null on error. */
     private native OperateResult getActionFromBufferNativeStructured(String activity, ByteBuffer xmlBuffer, int byteLength);
 
+    /** Write the result into a direct buffer (layout: OperateResult.readFrom); bytes written, 0 for none, -size if too small. */
+    private native int getActionFromBufferNativeInto(String activity, ByteBuffer xmlBuffer, int byteLength, ByteBuffer resultBuffer);
+
+    /** getActionFromBufferNativeInto with a handle of registerActivityNative. */
+    private native int getActionFromBufferNativeIntoByHandle(int activityHandle, ByteBuffer xmlBuffer, int byteLength,
+                                                             ByteBuffer resultBuffer);
+
+    /** getAction (b0bhkadf) answered into resultBuffer; same return values as getActionFromBufferNativeInto. */
+    private native int getActionNativeInto(String activity, String pageDesc, ByteBuffer resultBuffer);
+
+    /** Copy the result that did not fit into resultBuffer; same return values as getActionFromBufferNativeInto. */
+    private native int takePendingResultNative(ByteBuffer resultBuffer);
+
+    /** getActionFromBufferNative followed by the queued custom actions resolved on the same page, as plan JSON. */
+    private native String getActionPlanFromBufferNative(String activity, ByteBuffer xmlBuffer, int byteLength,
+                                                        int maxSteps, int unexecutedSteps);
+
+    /** Parse and step on a native worker; false if nothing was submitted. */
+    private native boolean submitActionFromBufferNative(String activity, ByteBuffer xmlBuffer, int byteLength);
+
+    /** submitActionFromBufferNative with a handle of registerActivityNative. */
+    private native boolean submitActionFromBufferNativeByHandle(int activityHandle, ByteBuffer xmlBuffer, int byteLength);
+
+    /** Result of the submitted step as getActionNativeInto returns it, or ACTION_PENDING after timeoutMs. */
+    private native int pollActionResultNative(ByteBuffer resultBuffer, long timeoutMs);
+
+    private native long getDeltaBaseDumpIdNative();
+
     private native void reportActivityNative(String activity);
     private native String getCoverageJsonNative();
+    private native int reportActivitiesNative(ByteBuffer buffer, int byteLength);
+    private native int getCoverageDeltaNative(int sinceVersion, ByteBuffer resultBuffer);
+    private native String getPerfStatsNative(boolean reset);
+    private native String getMemoryFootprintNative();
     private native String getNextFuzzActionNative(int displayWidth, int displayHeight, boolean simplify);
+    private native int getFuzzActionsIntoBufferNative(ByteBuffer resultBuffer, int count, int displayWidth,
+                                                      int displayHeight, String activity);
+    private native void setRandomSeedNative(long seed);
+    private native boolean flushModelNative();
+    private native void endSessionNative();
+    private native boolean reloadPreferencesNative(boolean onlyIfChanged);
+    private native boolean startGuiTraceRecordingNative(String path);
+    private native void stopGuiTraceRecordingNative();
 
     public static native String getNativeVersion();
 
@@ -234,7 +588,7 @@ public class AiClient {
         if (!singleton.loaded || xCoords == null || yCoords == null || xCoords.length != yCoords.length) {
             return null;
         }
-        return singleton.checkPointsInShieldNative(activity, xCoords, yCoords);
+        return singleton.checkPointsInShieldNativeByHandle(singleton.activityHandle(activity), xCoords, yCoords);
     }
 
     public Operate b1bhkadf(String activity, String pageDesc) {
@@ -243,6 +597,17 @@ public class AiClient {
             Logger.println("Please report this bug issue to github");
             System.exit(1);
         }
+        if (Config.nativeResultBuffer) {
+            int written = getActionNativeInto(activity, pageDesc, resultBuffer);
+            if (written < 0) {
+                written = takePendingResultIntoGrownBuffer(written);
+            }
+            Operate operate = readResultBuffer(written);
+            if (operate == null) {
+                Logger.errorPrintln("native get operate failed");
+            }
+            return operate;
+        }
         String operateStr = b0bhkadf(activity, pageDesc);
 
         if (operateStr.length() < 1) {
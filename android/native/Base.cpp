@@ -67,31 +67,6 @@ namespace fastbotx {
 
     }
 
-    Rect::Rect() {
-        this->top = 0;
-        this->bottom = 0;
-        this->right = 0;
-        this->left = 0;
-    }
-
-    Rect::Rect(const Rect &rect) {
-        this->top = rect.top;
-        this->bottom = rect.bottom;
-        this->right = rect.right;
-        this->left = rect.left;
-    }
-
-    Rect::Rect(int left, int top, int right, int bottom) {
-        this->top = top;
-        this->bottom = bottom;
-        this->right = right;
-        this->left = left;
-    }
-
-    bool Rect::isEmpty() const {
-        return this->left >= this->right || this->top >= this->bottom;
-    }
-
     Point Rect::center() const {
         return {(int) ((double) (this->top) + 0.5f * (double) (this->bottom - this->top)),
                 (int) ((double) this->left + 0.5f * (double) (this->right - this->left))};
@@ -121,25 +96,6 @@ namespace fastbotx {
                this->bottom == node.bottom;
     }
 
-
-    Rect &Rect::operator=(const Rect &node) {
-        this->left = node.left;
-        this->top = node.top;
-        this->right = node.right;
-        this->bottom = node.bottom;
-        return *this;
-    }
-
-    const RectPtr Rect::RectZero = std::make_shared<Rect>();
-    std::vector<std::shared_ptr<Rect>> Rect::_rectPool;
-
-    RectPtr Rect::getRect(const RectPtr &rect) {
-        if (nullptr == rect || rect->isEmpty()) {
-            return RectZero;
-        }
-        return rect;
-    }
-
     Point::Point() {
         this->x = 0;
         this->y = 0;
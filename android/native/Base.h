@@ -23,8 +23,10 @@
 #include <cstdint>
 #include <random>
 #include <cstring>
+#include <type_traits>
 #define XXH_NO_EXTERNC_GUARD
 #include "thirdpart/xxhash/xxhash.h"
+#include "Random.h"
 
 #include "json.hpp"
 
@@ -103,6 +105,15 @@ namespace fastbotx {
         }
     };
 
+    /// Orders by hash(): with the cached, final hash() of State, Action and Widget one integer
+    /// compare, where Comparator goes through operator< and virtual hash() calls
+    template<typename T>
+    struct HashComparator {
+        bool operator()(std::shared_ptr<T> const &left, std::shared_ptr<T> const &right) const {
+            return left->hash() < right->hash();
+        }
+    };
+
     /**
      * @brief Fast string hash function using XXH3 algorithm
      * 
@@ -180,17 +191,45 @@ namespace fastbotx {
     typedef std::shared_ptr<std::string> stringPtr;
     typedef std::set<stringPtr, Comparator<std::string>> stringPtrSet;
 
+    /// XOR of hashes[0..count), plus the order term 127 * (i << 6) of each non-zero entry if withOrder.
+    /// Four independent lanes, so the reduction pipelines and the compiler can vectorize it.
+    /// \param hashes Precomputed hashes, contiguous (e.g. WidgetColumns::hashes); 0 marks a missing entry
+    /// \param count Number of hashes
+    /// \param withOrder If true, then the index of every entry is encoded into the final hash code as well
+    /// \return The final hash code (0x1 for no entries), as combineHash gives for the same hashes
+    inline uintptr_t combineHashes(const uintptr_t *hashes, size_t count, bool withOrder) {
+        uintptr_t lanes[4] = {0x1, 0, 0, 0};
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            lanes[0] ^= hashes[i];
+            lanes[1] ^= hashes[i + 1];
+            lanes[2] ^= hashes[i + 2];
+            lanes[3] ^= hashes[i + 3];
+        }
+        for (; i < count; i++) {
+            lanes[0] ^= hashes[i];
+        }
+        if (withOrder) {
+            for (i = 0; i < count; i++) {
+                lanes[i & 3] ^= hashes[i] != 0 ? 127U * (i << 6) : 0;
+            }
+        }
+        return lanes[0] ^ lanes[1] ^ lanes[2] ^ lanes[3];
+    }
+
     /// Compute the hash code according to the given vector, and embed order index as well when possible.
-    /// \tparam T The class type for hashing
-    /// \param vector The vector of shared pointer of class T
+    /// Statically typed: T::hash() is called on each element in place (no RTTI, no refcount traffic).
+    /// \tparam T The class type for hashing, a HashNode
+    /// \param vector The vector of shared pointer of class T; null entries are skipped
     /// \param withOrder If true, then this method will encode the order of entry into the final hash code as well
     /// \return The final hash code
     template<typename T>
     uintptr_t combineHash(const std::vector<std::shared_ptr<T> > &vector, bool withOrder) {
+        static_assert(std::is_base_of<HashNode, T>::value, "combineHash needs HashNode elements");
         size_t count = vector.size();
         uintptr_t combinedHashcode = 0x1;
         for (size_t i = 0; i < count; i++) {
-            auto hashNode = std::dynamic_pointer_cast<HashNode>(vector.at(i));
+            const T *hashNode = vector[i].get();
             if (hashNode != nullptr) {
                 combinedHashcode ^= (hashNode->hash());
                 if (withOrder)
@@ -201,7 +240,7 @@ namespace fastbotx {
     }
 
     /// Compute the hash code according to the given vector, and embed order index as well when possible.
-    /// \tparam Iter The class type for hashing
+    /// \tparam Iter The class type for hashing, an iterator over shared pointers of a HashNode type
     /// \param it Need to pass in a type of iterator, which is the beginning of the iterator
     /// \param end The end of the iterator
     /// \param withOrder If true, then this method will encode the order of entry into the final hash code as well
@@ -212,7 +251,7 @@ namespace fastbotx {
         int indexOfElement = 0;
         Iter cursor = it;
         for (; cursor != end; ++cursor) {
-            auto inode = std::dynamic_pointer_cast<HashNode>((*cursor));
+            const auto *inode = (*cursor).get();
             if (inode != nullptr) {
                 hashCode ^= inode->hash();
                 if (withOrder)
@@ -252,6 +291,68 @@ namespace fastbotx {
 
     ActionType stringToActionType(const std::string &actionTypeString);
 
+    /**
+     * @brief Set of ActionType values packed into one 32-bit mask
+     *
+     * Replaces std::set<ActionType> for per-widget action sets: no node allocation,
+     * O(1) insert/contains, popcount size, and iteration in ascending enum order
+     * (the same order std::set produced).
+     */
+    class ActionTypeSet {
+    public:
+        class const_iterator {
+        public:
+            explicit const_iterator(uint32_t rest) : _rest(rest) {}
+
+            ActionType operator*() const { return static_cast<ActionType>(__builtin_ctz(this->_rest)); }
+
+            const_iterator &operator++() {
+                this->_rest &= this->_rest - 1;
+                return *this;
+            }
+
+            bool operator==(const const_iterator &other) const { return this->_rest == other._rest; }
+
+            bool operator!=(const const_iterator &other) const { return this->_rest != other._rest; }
+
+        private:
+            uint32_t _rest;
+        };
+
+        constexpr ActionTypeSet() : _bits(0) {}
+
+        constexpr explicit ActionTypeSet(uint32_t bits) : _bits(bits) {}
+
+        static constexpr uint32_t bit(ActionType type) { return 1U << static_cast<uint32_t>(type); }
+
+        void insert(ActionType type) { this->_bits |= bit(type); }
+
+        void erase(ActionType type) { this->_bits &= ~bit(type); }
+
+        bool contains(ActionType type) const { return (this->_bits & bit(type)) != 0; }
+
+        bool empty() const { return 0 == this->_bits; }
+
+        size_t size() const { return static_cast<size_t>(__builtin_popcount(this->_bits)); }
+
+        void clear() { this->_bits = 0; }
+
+        uint32_t bits() const { return this->_bits; }
+
+        const_iterator begin() const { return const_iterator(this->_bits); }
+
+        const_iterator end() const { return const_iterator(0); }
+
+        bool operator==(const ActionTypeSet &other) const { return this->_bits == other._bits; }
+
+        bool operator!=(const ActionTypeSet &other) const { return this->_bits != other._bits; }
+
+    private:
+        uint32_t _bits;
+    };
+
+    static_assert(ActionType::ActTypeSize <= 32, "ActionTypeSet packs ActionType into 32 bits");
+
     enum ScrollType {
         ALL = 0,
         Horizontal,
@@ -311,45 +412,35 @@ namespace fastbotx {
         virtual ~Point() = default;
     };
 
-    class Rect : HashNode {
+    /// Bounds of a node: four ints, trivially copyable, held by value in Element, Widget and State
+    class Rect {
     public:
-        int top;
-        int bottom;
-        int left;
-        int right;
+        int top{0};
+        int bottom{0};
+        int left{0};
+        int right{0};
 
     public:
-        Rect();
+        Rect() = default;
 
-        Rect(const Rect &rect);
-
-        Rect(int left, int top, int right, int bottom);
-
-        virtual ~Rect() = default;
+        Rect(int left, int top, int right, int bottom)
+                : top(top), bottom(bottom), left(left), right(right) {
+        }
 
-        bool isEmpty() const;
+        bool isEmpty() const { return this->left >= this->right || this->top >= this->bottom; }
 
         bool contains(const Point &point) const;
 
         Point center() const;
 
-        uintptr_t hash() const override;
+        uintptr_t hash() const;
 
         std::string toString() const;
 
         bool operator==(const Rect &node) const;
-
-        Rect &operator=(const Rect &node);
-        // Rect & operator=(const Rect&& rect);
-
-        // a  reference, means do not change it's value
-        static std::shared_ptr<Rect> getRect(const std::shared_ptr<Rect> &rect);
-
-        static const std::shared_ptr<Rect> RectZero;
-    private:
-        static std::vector<std::shared_ptr<Rect>> _rectPool;
     };
 
+    /// Shared rect, for the rect caches of Preference (StringRectsMap) and its reject rects
     typedef std::shared_ptr<Rect> RectPtr;
 
 
@@ -360,20 +451,6 @@ namespace fastbotx {
         return false;
     }
 
-    // Thread-local random number generator for better performance and thread safety
-    inline int randomInt(int min, int max) {
-        thread_local std::mt19937 rng(std::random_device{}());
-        std::uniform_int_distribution<int> dist(min, max - 1);
-        return dist(rng);
-    }
-
-
-    inline int randomInt(int min, int max, int seed) {
-        thread_local std::mt19937 rng(seed);
-        std::uniform_int_distribution<int> dist(min, max - 1);
-        return dist(rng);
-    }
-
     inline void trimString(std::string &str) {
         str.erase(0, str.find_first_not_of(' '));
         str.erase(str.find_last_not_of(' ') + 1);
@@ -448,14 +525,11 @@ namespace fastbotx {
     static const char AlphabetSeq[AlphabetSeqLen] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz~!@#$%^&*()<>_-;',.?/\"|{}";// len 84
     static const char AlphabetChSeq[AlphabetChSeqLen] = "你好中文字符串｜。，；（）【】？！测试啊哈"; // len 64
 
-    inline std::string getRandomChars() {
+    inline std::string getRandomChars(Rng &rng) {
         std::stringstream randomStringStream;
-        int len = randomInt(11, 1000);
-        // Use thread-local random number generator for better performance
-        thread_local std::mt19937 rng(std::random_device{}());
-        std::uniform_int_distribution<int> dist(0, AlphabetSeqLen * 4 + AlphabetChSeqLen - 1);
+        int len = rng.nextInt(11, 1000);
         while (len-- > 0) {
-            int i = dist(rng);
+            int i = rng.nextInt(0, AlphabetSeqLen * 4 + AlphabetChSeqLen);
             if (i < AlphabetSeqLen * 4) {
                 i /= 4;
                 randomStringStream << AlphabetSeq[i];
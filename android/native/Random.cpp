@@ -0,0 +1,91 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef Random_CPP_
+#define Random_CPP_
+
+#include "Random.h"
+#include "Base.h"
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <unordered_map>
+
+namespace fastbotx {
+
+    namespace {
+        uint64_t splitmix64(uint64_t &state) {
+            uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            return z ^ (z >> 31);
+        }
+
+        uint64_t initialSeed() {
+            const char *fixedSeed = std::getenv("FASTBOT_RANDOM_SEED");
+            if (fixedSeed != nullptr && *fixedSeed != '\0') {
+                return std::strtoull(fixedSeed, nullptr, 10);
+            }
+            std::random_device device;
+            return (static_cast<uint64_t>(device()) << 32) ^ device();
+        }
+
+        struct SeedState {
+            std::atomic<uint64_t> seed{initialSeed()};
+            std::atomic<uint32_t> generation{1};
+            /// Indexes handed out by nextStream, per name; under mutex
+            std::unordered_map<std::string, uint64_t> nextIndex;
+            std::mutex mutex;
+        };
+
+        SeedState &seedState() {
+            static SeedState *state = new SeedState();  // never destructed: threads may draw during exit
+            return *state;
+        }
+    }
+
+    Rng::Rng(uint64_t seed) {
+        for (uint64_t &word: this->_s) {
+            word = splitmix64(seed);
+        }
+    }
+
+    void RandomStreams::setGlobalSeed(uint64_t seed) {
+        SeedState &state = seedState();
+        std::lock_guard<std::mutex> guard(state.mutex);
+        state.seed.store(seed, std::memory_order_relaxed);
+        state.nextIndex.clear();
+        state.generation.fetch_add(1, std::memory_order_release);
+    }
+
+    uint64_t RandomStreams::globalSeed() {
+        return seedState().seed.load(std::memory_order_relaxed);
+    }
+
+    Rng RandomStreams::stream(const std::string &name, uint64_t index) {
+        uint64_t mixed = globalSeed() ^ static_cast<uint64_t>(fastStringHash(name.data(), name.size()));
+        uint64_t streamSeed = splitmix64(mixed) + index * 0x9e3779b97f4a7c15ULL;
+        return Rng(splitmix64(streamSeed));
+    }
+
+    Rng RandomStreams::nextStream(const std::string &name) {
+        SeedState &state = seedState();
+        uint64_t index;
+        {
+            std::lock_guard<std::mutex> guard(state.mutex);
+            index = state.nextIndex[name]++;
+        }
+        return stream(name, index);
+    }
+
+    uint32_t RandomStreams::generation() {
+        return seedState().generation.load(std::memory_order_acquire);
+    }
+
+}
+
+#endif //Random_CPP_
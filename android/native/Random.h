@@ -0,0 +1,118 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef Random_H_
+#define Random_H_
+
+#include <cstdint>
+#include <limits>
+#include <string>
+
+namespace fastbotx {
+
+    /**
+     * @brief xoshiro256** generator: 32 bytes of state, a few cycles per draw
+     *
+     * Unlike std::mt19937 (2.5 KB of state) it is cheap to seed and to copy. Draws go through
+     * its own methods rather than std distributions, whose results differ between
+     * standard libraries, so a seed gives the same decisions on the device and on a host
+     * replay. Also a UniformRandomBitGenerator for std algorithms.
+     */
+    class Rng {
+    public:
+        typedef uint64_t result_type;
+
+        /// State expanded from seed by splitmix64 (never all zero)
+        explicit Rng(uint64_t seed = 0);
+
+        static constexpr result_type min() { return 0; }
+
+        static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+        result_type operator()() { return this->next(); }
+
+        uint64_t next() {
+            const uint64_t result = rotl(this->_s[1] * 5, 7) * 9;
+            const uint64_t t = this->_s[1] << 17;
+            this->_s[2] ^= this->_s[0];
+            this->_s[3] ^= this->_s[1];
+            this->_s[1] ^= this->_s[2];
+            this->_s[0] ^= this->_s[3];
+            this->_s[2] ^= t;
+            this->_s[3] = rotl(this->_s[3], 45);
+            return result;
+        }
+
+        /// Uniform in [0, 1)
+        double nextDouble() { return static_cast<double>(this->next() >> 11) * (1.0 / 9007199254740992.0); }
+
+        /// Uniform in [0, 1)
+        float nextFloat() { return static_cast<float>(this->next() >> 40) * (1.0f / 16777216.0f); }
+
+        /// Uniform in [0, bound), 0 if bound is 0 (Lemire's multiply-shift, unbiased)
+        uint32_t nextBelow(uint32_t bound) {
+            uint64_t product = static_cast<uint64_t>(static_cast<uint32_t>(this->next() >> 32)) * bound;
+            auto low = static_cast<uint32_t>(product);
+            if (low < bound) {
+                uint32_t threshold = (0U - bound) % bound;
+                while (low < threshold) {
+                    product = static_cast<uint64_t>(static_cast<uint32_t>(this->next() >> 32)) * bound;
+                    low = static_cast<uint32_t>(product);
+                }
+            }
+            return static_cast<uint32_t>(product >> 32);
+        }
+
+        /// Uniform in [min, max), min if the range is empty
+        int nextInt(int min, int max) {
+            if (max <= min) {
+                return min;
+            }
+            auto span = static_cast<uint32_t>(static_cast<int64_t>(max) - min);
+            return static_cast<int>(static_cast<int64_t>(min) + this->nextBelow(span));
+        }
+
+    private:
+        static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+        uint64_t _s[4];
+    };
+
+    /**
+     * @brief Seeds of all generators: one global seed, and named streams derived from it
+     *
+     * The global seed is FASTBOT_RANDOM_SEED from the environment when set (replays,
+     * bench/ReplayBench.cpp), otherwise a random_device draw; setGlobalSeed replaces it
+     * (AiClient.setRandomSeed, from the monkey seed). Each component draws from its own
+     * stream, so its decisions do not shift when another one draws more or less:
+     * - "agent": one stream per agent, in creation order (nextStream)
+     * - "device": one stream per device of a Model (DeviceShard), in creation order, for
+     *   the draws of its steps outside the agent (preference event rates, input texts,
+     *   throttle); the agent's own stream covers its state sampling
+     * - "fuzz": the fuzzing actions of the JNI layer
+     * Generators made before a setGlobalSeed keep their stream; the fuzzer reseeds on its
+     * next draw (see generation()). No stream is per thread, so a replay does not depend on
+     * which worker runs a step.
+     */
+    class RandomStreams {
+    public:
+        static void setGlobalSeed(uint64_t seed);
+
+        static uint64_t globalSeed();
+
+        /// Generator of stream (name, index) under the global seed
+        static Rng stream(const std::string &name, uint64_t index = 0);
+
+        /// Generator of the next index of stream name: the n-th call for a name gets index n - 1
+        static Rng nextStream(const std::string &name);
+
+        /// Starts at 1 and changes on every setGlobalSeed
+        static uint32_t generation();
+    };
+
+}
+
+#endif //Random_H_
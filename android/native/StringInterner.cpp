@@ -0,0 +1,87 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef StringInterner_CPP_
+#define StringInterner_CPP_
+
+#include "StringInterner.h"
+#include "utils.hpp"
+#include <cstdlib>
+
+namespace fastbotx {
+
+    StringInterner &StringInterner::global() {
+        // Intentionally leaked: handles may be resolved from static destructors
+        static StringInterner *interner = new StringInterner();
+        return *interner;
+    }
+
+    StringInterner::StringInterner() {
+        for (auto &chunk: this->_chunks) {
+            chunk.store(nullptr, std::memory_order_relaxed);
+        }
+        for (auto &bucket: this->_buckets) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        auto *first = new Entry[ChunkSize];
+        first[0].value = std::make_shared<std::string>();
+        first[0].hash = 0;
+        first[0].next = 0;
+        this->_chunks[0].store(first, std::memory_order_release);
+        this->_count.store(1, std::memory_order_release);
+    }
+
+    uint32_t StringInterner::find(const char *data, size_t size, uintptr_t hash) const {
+        for (uint32_t id = this->_buckets[bucketOf(hash)].load(std::memory_order_acquire); id != 0;) {
+            const Entry &candidate = entry(id);
+            if (candidate.hash == hash && candidate.value->size() == size &&
+                0 == std::memcmp(candidate.value->data(), data, size)) {
+                return id;
+            }
+            id = candidate.next;
+        }
+        return 0;
+    }
+
+    InternedString StringInterner::intern(const char *data, size_t size) {
+        if (nullptr == data || 0 == size) {
+            return {};
+        }
+        uintptr_t hash = fastStringHash(data, size);
+        uint32_t found = find(data, size, hash);
+        if (found != 0) {
+            return InternedString(found);
+        }
+        std::lock_guard<std::mutex> guard(this->_mutex);
+        // Another thread may have inserted it since
+        found = find(data, size, hash);
+        if (found != 0) {
+            return InternedString(found);
+        }
+        size_t id = this->_count.load(std::memory_order_relaxed);
+        if (id >= static_cast<size_t>(MaxChunks) * ChunkSize) {
+            BLOGE("string interner is full (%zu entries), aborting", id);
+            std::abort();
+        }
+        auto chunkIndex = static_cast<uint32_t>(id >> ChunkBits);
+        Entry *chunk = this->_chunks[chunkIndex].load(std::memory_order_relaxed);
+        if (nullptr == chunk) {
+            chunk = new Entry[ChunkSize];
+            this->_chunks[chunkIndex].store(chunk, std::memory_order_release);
+        }
+        Entry &slot = chunk[id & (ChunkSize - 1)];
+        slot.value = std::make_shared<std::string>(data, size);
+        slot.hash = hash;
+        std::atomic<uint32_t> &bucket = this->_buckets[bucketOf(hash)];
+        slot.next = bucket.load(std::memory_order_relaxed);
+        bucket.store(static_cast<uint32_t>(id), std::memory_order_release);
+        this->_count.store(id + 1, std::memory_order_release);
+        return InternedString(static_cast<uint32_t>(id));
+    }
+
+}  // namespace fastbotx
+
+#endif  // StringInterner_CPP_
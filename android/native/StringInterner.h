@@ -0,0 +1,202 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef StringInterner_H_
+#define StringInterner_H_
+
+#include "Base.h"
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace fastbotx {
+
+    /**
+     * @brief Handle to a process-wide interned string
+     *
+     * Class names, package names, resource IDs and activity names repeat on every
+     * node and every step. Interning maps each distinct string to a small integer id
+     * with its XXH3 hash (fastStringHash) computed once, so equality is an integer
+     * compare and hashing is a load.
+     *
+     * Id 0 is reserved for the empty string, so a default-constructed handle is "".
+     * Interned strings are never freed; the table only grows with distinct values,
+     * which for these fields is bounded by the app under test. Running out of ids is
+     * fatal, as no handle can stand for an uninterned string.
+     */
+    class InternedString {
+    public:
+        InternedString() = default;
+
+        /// Intern a string (thread-safe); returns the existing handle if already present
+        static InternedString intern(const char *data, size_t size);
+
+        static InternedString intern(const std::string &s) { return intern(s.data(), s.size()); }
+
+        /// Handle of an id handed out before (e.g. passed back through JNI); false if there is none
+        static bool fromId(uint32_t id, InternedString &s);
+
+        uint32_t id() const { return this->_id; }
+
+        bool empty() const { return 0 == this->_id; }
+
+        /// Stable reference; valid for the lifetime of the process
+        const std::string &str() const;
+
+        /// Precomputed fastStringHash() of the string (0 for empty)
+        uintptr_t hash() const;
+
+        /// Canonical shared string, identical pointer for identical content
+        const stringPtr &ptr() const;
+
+        bool operator==(const InternedString &other) const { return this->_id == other._id; }
+
+        bool operator!=(const InternedString &other) const { return this->_id != other._id; }
+
+        bool operator<(const InternedString &other) const { return this->_id < other._id; }
+
+    private:
+        explicit InternedString(uint32_t id) : _id(id) {}
+
+        uint32_t _id{0};
+
+        friend class StringInterner;
+    };
+
+    /**
+     * @brief Global intern table backing InternedString
+     *
+     * Entries live in fixed-size chunks that never move, so resolving an id is
+     * lock-free. Lookups are too: a fixed array of buckets heads chains of ids linked
+     * through the entries, and an entry is complete before the release store that links
+     * it in. Only inserting a string not found takes the mutex, and looks again under it.
+     */
+    class StringInterner {
+    public:
+        static StringInterner &global();
+
+        InternedString intern(const char *data, size_t size);
+
+        /// Number of distinct strings, including the reserved empty string
+        size_t size() const { return this->_count.load(std::memory_order_acquire); }
+
+        struct Entry {
+            stringPtr value;
+            uintptr_t hash;
+            /// Next id of the same bucket, 0 at the end; set before the entry is linked in
+            uint32_t next;
+        };
+
+        const Entry &entry(uint32_t id) const {
+            return this->_chunks[id >> ChunkBits].load(std::memory_order_acquire)[id & (ChunkSize - 1)];
+        }
+
+    private:
+        StringInterner();
+
+        static constexpr uint32_t ChunkBits = 12;
+        static constexpr uint32_t ChunkSize = 1U << ChunkBits;
+        /// 1024 chunks x 4096 entries: far above the distinct names of any app
+        static constexpr uint32_t MaxChunks = 1024;
+        /// Chains stay about one id long up to tens of thousands of strings
+        static constexpr uint32_t BucketBits = 16;
+
+        /// Id of string (data, size) with the given hash, or 0 if it is not interned
+        uint32_t find(const char *data, size_t size, uintptr_t hash) const;
+
+        static uint32_t bucketOf(uintptr_t hash) {
+            return static_cast<uint32_t>((static_cast<uint64_t>(hash) * 0x9E3779B97F4A7C15ULL) >> (64 - BucketBits));
+        }
+
+        std::mutex _mutex;
+        /// First id of each bucket's chain, 0 if empty; collisions resolved by comparing the stored strings
+        std::atomic<uint32_t> _buckets[1U << BucketBits];
+        std::atomic<Entry *> _chunks[MaxChunks];
+        std::atomic<size_t> _count{0};
+    };
+
+    /**
+     * @brief Set of interned strings as a dense bitset over their ids
+     *
+     * Membership is a shift and a mask, so code probing it once per reuse target (the
+     * visited activities) does no string compares. Bytes grow with the largest id
+     * inserted, an eighth of a byte per interned string at most.
+     */
+    class InternedStringSet {
+    public:
+        bool contains(InternedString s) const {
+            size_t word = s.id() >> 6;
+            return word < this->_words.size() && ((this->_words[word] >> (s.id() & 63)) & 1U) != 0;
+        }
+
+        /// @return true if s was not in the set
+        bool insert(InternedString s) {
+            size_t word = s.id() >> 6;
+            if (word >= this->_words.size()) {
+                this->_words.resize(word + 1, 0);
+            }
+            uint64_t bit = uint64_t{1} << (s.id() & 63);
+            if ((this->_words[word] & bit) != 0) {
+                return false;
+            }
+            this->_words[word] |= bit;
+            this->_size++;
+            return true;
+        }
+
+        size_t size() const { return this->_size; }
+
+        size_t heapBytes() const { return this->_words.capacity() * sizeof(uint64_t); }
+
+    private:
+        std::vector<uint64_t> _words;
+        size_t _size{0};
+    };
+
+    inline const std::string &InternedString::str() const {
+        return *StringInterner::global().entry(this->_id).value;
+    }
+
+    inline uintptr_t InternedString::hash() const {
+        return StringInterner::global().entry(this->_id).hash;
+    }
+
+    inline const stringPtr &InternedString::ptr() const {
+        return StringInterner::global().entry(this->_id).value;
+    }
+
+    inline InternedString InternedString::intern(const char *data, size_t size) {
+        return StringInterner::global().intern(data, size);
+    }
+
+    inline bool InternedString::fromId(uint32_t id, InternedString &s) {
+        if (id >= StringInterner::global().size()) {
+            return false;
+        }
+        s = InternedString(id);
+        return true;
+    }
+
+    /// Orders interned strings by their text, for iteration orders that must not depend on ids
+    struct InternedStringNameLess {
+        bool operator()(const InternedString &left, const InternedString &right) const {
+            return left.str() < right.str();
+        }
+    };
+
+}  // namespace fastbotx
+
+namespace std {
+    /// Ids are dense and unique per string, so the id itself is a perfect hash
+    template<>
+    struct hash<fastbotx::InternedString> {
+        size_t operator()(const fastbotx::InternedString &s) const { return s.id(); }
+    };
+}
+
+#endif  // StringInterner_H_
@@ -0,0 +1,98 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef Trace_CPP_
+#define Trace_CPP_
+
+#include "Trace.h"
+
+#if FASTBOT_TRACE_LEVEL > FASTBOT_TRACE_OFF
+
+#include "utils.hpp"
+#include <vector>
+
+#ifdef __ANDROID__
+#include <dlfcn.h>
+#endif
+
+namespace fastbotx {
+    namespace trace {
+
+#ifdef __ANDROID__
+        typedef void (*BeginSectionFunction)(const char *);
+
+        typedef void (*EndSectionFunction)();
+
+        /// ATrace entry points of libandroid, resolved at run time (they appeared in API 23)
+        struct ATraceFunctions {
+            BeginSectionFunction beginSection{nullptr};
+            EndSectionFunction endSection{nullptr};
+
+            ATraceFunctions() {
+                void *library = dlopen("libandroid.so", RTLD_NOW | RTLD_LOCAL);
+                if (library == nullptr) {
+                    return;
+                }
+                beginSection = reinterpret_cast<BeginSectionFunction>(dlsym(library, "ATrace_beginSection"));
+                endSection = reinterpret_cast<EndSectionFunction>(dlsym(library, "ATrace_endSection"));
+                if (beginSection == nullptr || endSection == nullptr) {
+                    beginSection = nullptr;
+                    endSection = nullptr;
+                }
+            }
+        };
+
+        static const ATraceFunctions &atrace() {
+            static const ATraceFunctions functions;
+            return functions;
+        }
+#endif
+
+        /// Spans open on this thread, for the BLOG fallback
+        struct OpenSpan {
+            const char *name;
+            std::chrono::steady_clock::time_point start;
+        };
+
+        static std::vector<OpenSpan> &openSpans() {
+            thread_local std::vector<OpenSpan> spans;
+            return spans;
+        }
+
+        void beginSection(const char *name) {
+#ifdef __ANDROID__
+            if (atrace().beginSection != nullptr) {
+                atrace().beginSection(name);
+                return;
+            }
+#endif
+            openSpans().push_back(OpenSpan{name, std::chrono::steady_clock::now()});
+        }
+
+        void endSection() {
+#ifdef __ANDROID__
+            if (atrace().endSection != nullptr) {
+                atrace().endSection();
+                return;
+            }
+#endif
+            std::vector<OpenSpan> &spans = openSpans();
+            if (spans.empty()) {
+                return;
+            }
+            OpenSpan span = spans.back();
+            spans.pop_back();
+            double millis = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - span.start).count();
+            BLOG("trace: %*s%s %.3fms", static_cast<int>(spans.size() * 2), "", span.name, millis);
+        }
+
+    }
+}
+
+#endif
+
+#endif //Trace_CPP_
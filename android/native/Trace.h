@@ -0,0 +1,85 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef Trace_H_
+#define Trace_H_
+
+/**
+ * Tracing spans for profiling the native hot path.
+ *
+ * FASTBOT_TRACE_LEVEL (set by CMake, default off) picks what is compiled in:
+ *   FASTBOT_TRACE_OFF       nothing: every macro below expands to a no-op
+ *   FASTBOT_TRACE_STAGES    one span per getAction stage (see StageTimer)
+ *   FASTBOT_TRACE_FUNCTIONS the stages plus the hot functions
+ *
+ * On Android spans go to ATrace (systrace / Perfetto "app" category, API 23+), so an
+ * APK build shows exact per-function timing in the trace of the monkey process.
+ * Elsewhere, and on devices without ATrace, each span logs its duration with BLOG.
+ *
+ * Usage:
+ *   FASTBOT_TRACE_STAGE("parse");   // span until the end of the enclosing scope
+ *   FASTBOT_TRACE_FUNCTION();       // span named after the enclosing function
+ */
+
+#define FASTBOT_TRACE_OFF       0
+#define FASTBOT_TRACE_STAGES    1
+#define FASTBOT_TRACE_FUNCTIONS 2
+
+#ifndef FASTBOT_TRACE_LEVEL
+#define FASTBOT_TRACE_LEVEL FASTBOT_TRACE_OFF
+#endif
+
+#if FASTBOT_TRACE_LEVEL > FASTBOT_TRACE_OFF
+
+#include <chrono>
+
+namespace fastbotx {
+    namespace trace {
+
+        /// Open a span on the calling thread; name must outlive the span
+        void beginSection(const char *name);
+
+        /// Close the innermost span opened on the calling thread
+        void endSection();
+
+        /// Span covering its own lifetime
+        class Span {
+        public:
+            explicit Span(const char *name) {
+                beginSection(name);
+            }
+
+            ~Span() {
+                endSection();
+            }
+
+            Span(const Span &) = delete;
+
+            Span &operator=(const Span &) = delete;
+        };
+
+    }
+}
+
+#define FASTBOT_TRACE_CONCAT_(a, b) a##b
+#define FASTBOT_TRACE_CONCAT(a, b) FASTBOT_TRACE_CONCAT_(a, b)
+#define FASTBOT_TRACE_SPAN_(name) ::fastbotx::trace::Span FASTBOT_TRACE_CONCAT(fastbotTraceSpan, __LINE__)(name)
+
+#endif
+
+#if FASTBOT_TRACE_LEVEL >= FASTBOT_TRACE_STAGES
+#define FASTBOT_TRACE_STAGE(name) FASTBOT_TRACE_SPAN_(name)
+#else
+#define FASTBOT_TRACE_STAGE(name) ((void) 0)
+#endif
+
+#if FASTBOT_TRACE_LEVEL >= FASTBOT_TRACE_FUNCTIONS
+#define FASTBOT_TRACE_FUNCTION() FASTBOT_TRACE_SPAN_(__FUNCTION__)
+#else
+#define FASTBOT_TRACE_FUNCTION() ((void) 0)
+#endif
+
+#endif //Trace_H_
@@ -28,7 +28,8 @@ namespace fastbotx {
             : _validateFilter(validDatePriorityFilter), _graphStableCounter(0),
               _stateStableCounter(0), _activityStableCounter(0), _disableFuzz(false),
               _requestRestart(false), _currentStateBlockTimes(0),
-              _algorithmType(AlgorithmType::Random) {
+              _algorithmType(AlgorithmType::Random),
+              _rng(RandomStreams::nextStream("agent")) {  // One stream per agent under the global seed
 
     }
 
@@ -107,6 +108,11 @@ namespace fastbotx {
      * @param nextState Next state, uses move semantics to avoid unnecessary copies
      */
     void AbstractAgent::moveForward(StatePtr nextState) {
+        // The executed action was just visited: its priority changes next time its state is adjusted
+        if (_newState && _newAction) {
+            _newState->markActionDirty(_newAction);
+        }
+
         // Update state history
         _lastState = _currentState;
         _currentState = _newState;
@@ -143,66 +149,89 @@ namespace fastbotx {
      *    - Set state priority to total priority
      * 
      * Performance optimization:
-     * - Uses references to avoid unnecessary copies
-     * - Early continue to skip invalid actions
+     * - A priority only depends on the action's visit count, validity and its state's
+     *   merge groups, so after the first pass over a state only the actions marked
+     *   dirty since (the one executed from it, see moveForward) are recomputed, and
+     *   the state priority is kept as a running sum
+     * - Pushes each action's new weight into the state's Fenwick samplers, so the
+     *   random picks that follow are O(log n) instead of rescanning all actions
      * 
-     * @note Time complexity: O(n), where n is the number of actions in the state
+     * @note Time complexity: O(n) on a state's first visit (or after its details
+     *       changed), O(dirty actions * log n) afterwards
      */
     void AbstractAgent::adjustActions() {
-        using namespace ActionPriorityConstants;
-        
-        // Accumulate priority increments for all actions (for calculating total state priority)
-        double totalPriority = 0;
-        
-        // Iterate through all actions in state and adjust priorities
-        for (const ActivityStateActionPtr &action: _newState->getActions()) {
-            // Get and set base priority
-            int basePriority = action->getPriorityByActionType();
-            action->setPriority(basePriority);
-            
-            // Handle no-target actions (e.g., BACK, FEED system actions)
-            if (!action->requireTarget()) {
-                if (!action->isVisited()) {
-                    // Unvisited no-target action, add bonus
-                    int priority = action->getPriority();
-                    priority += NoTargetUnvisitedBonus;
-                    action->setPriority(priority);
-                }
-                continue;  // No-target action processing complete, skip subsequent logic
+        const ActivityStateActionPtrVec &actions = _newState->getActions();
+        if (_newState->allActionsDirty()) {
+            // Accumulate priority increments for all actions (for calculating total state priority)
+            int totalPriority = 0;
+            for (size_t index = 0; index < actions.size(); index++) {
+                totalPriority += this->adjustActionPriority(actions[index]);
+                _newState->refreshActionWeight(index);
             }
-            
-            // Target actions must be valid
-            if (!action->isValid()) {
-                continue;  // Skip invalid actions
+            _newState->setPriority(totalPriority);
+        } else {
+            int totalPriority = _newState->getPriority();
+            for (size_t index: _newState->dirtyActions()) {
+                const ActivityStateActionPtr &action = actions[index];
+                // Swap the action's old increment for its new one
+                totalPriority -= priorityIncrement(action);
+                totalPriority += this->adjustActionPriority(action);
+                _newState->refreshActionWeight(index);
             }
-            
-            // Calculate priority for target actions
-            int priority = action->getPriority();
-            
-            // Unvisited actions get bonus, encouraging exploration
+            _newState->setPriority(totalPriority);
+        }
+        _newState->clearDirtyActions();
+    }
+
+    int AbstractAgent::priorityIncrement(const ActivityStateActionPtr &action) {
+        if (!action->requireTarget() || !action->isValid()) {
+            return 0;
+        }
+        return action->getPriority() - action->getPriorityByActionType();
+    }
+
+    int AbstractAgent::adjustActionPriority(const ActivityStateActionPtr &action) const {
+        using namespace ActionPriorityConstants;
+
+        // Get and set base priority
+        int basePriority = action->getPriorityByActionType();
+        action->setPriority(basePriority);
+
+        // Handle no-target actions (e.g., BACK, FEED system actions)
+        if (!action->requireTarget()) {
             if (!action->isVisited()) {
-                priority += UnvisitedActionBonus;
-            }
-            
-            // If new action (state not saturated), significantly increase priority
-            if (!this->_newState->isSaturated(action)) {
-                priority += NewActionMultiplier * action->getPriorityByActionType();
+                // Unvisited no-target action, add bonus
+                action->setPriority(basePriority + NoTargetUnvisitedBonus);
             }
+            return 0;  // No-target actions do not count towards the state priority
+        }
 
-            // Ensure priority is not negative
-            if (priority <= 0) {
-                priority = 0;
-            }
+        // Target actions must be valid
+        if (!action->isValid()) {
+            return 0;  // Skip invalid actions
+        }
 
-            // Set adjusted priority
-            action->setPriority(priority);
-            
-            // Accumulate priority increment (for calculating total state priority)
-            totalPriority += (priority - basePriority);
+        // Calculate priority for target actions
+        int priority = basePriority;
+
+        // Unvisited actions get bonus, encouraging exploration
+        if (!action->isVisited()) {
+            priority += UnvisitedActionBonus;
         }
-        
-        // Set total state priority
-        _newState->setPriority(static_cast<int>(totalPriority));
+
+        // If new action (state not saturated), significantly increase priority
+        if (!this->_newState->isSaturated(action)) {
+            priority += NewActionMultiplier * basePriority;
+        }
+
+        // Ensure priority is not negative
+        if (priority <= 0) {
+            priority = 0;
+        }
+
+        // Set adjusted priority
+        action->setPriority(priority);
+        return priority - basePriority;
     }
 
     /**
@@ -228,6 +257,20 @@ namespace fastbotx {
         return action;
     }
 
+    ActionPtr AbstractAgent::speculateNewAction(const StatePtr &predicted) {
+        StatePtr newState = this->_newState;
+        ActivityStateActionPtr newAction = this->_newAction;
+        this->_newState = predicted;
+        ActionPtr action = this->resolveNewAction();
+        this->_newState = newState;
+        this->_newAction = newAction;
+        return action;
+    }
+
+    void AbstractAgent::adoptSpeculativeAction(const ActionPtr &action) {
+        this->_newAction = std::dynamic_pointer_cast<ActivityStateAction>(action);
+    }
+
     /**
      * @brief Handle null action situation
      * 
@@ -244,7 +287,7 @@ namespace fastbotx {
      */
     ActivityStateActionPtr AbstractAgent::handleNullAction() const {
         // Attempt to randomly select a valid action
-        ActivityStateActionPtr action = this->_newState->randomPickAction(this->_validateFilter);
+        ActivityStateActionPtr action = this->_newState->randomPickAction(this->_validateFilter, this->_rng);
         
         if (nullptr != action) {
             // Get model pointer (use weak_ptr to avoid circular references)
@@ -79,11 +79,30 @@ namespace fastbotx {
          */
         virtual ActionPtr resolveNewAction();
 
+        /**
+         * @brief Select ahead the action for a state the device is predicted to reach next
+         * 
+         * Runs resolveNewAction on predicted as if it were the next page, then puts _newState
+         * and _newAction back. Called after moveForward, under the Graph write lock, by
+         * speculative steps (FASTBOT_SPECULATIVE_STEPS).
+         * 
+         * @return The action, to be passed to adoptSpeculativeAction if the page arrives as predicted
+         */
+        virtual ActionPtr speculateNewAction(const StatePtr &predicted);
+
+        /// The page arrived as predicted: action stands for what resolveNewAction would select
+        virtual void adoptSpeculativeAction(const ActionPtr &action);
+
+        /// The last speculation will not be used: undo what it drew from the agent's random generator
+        virtual void discardSpeculativeAction() {}
+
         /**
          * @brief Update strategy (pure virtual, implemented by subclasses)
          * 
          * Called after action execution to update internal strategy.
          * For example, update Q-values in reinforcement learning, update reuse model, etc.
+         * Runs once the step's operation was returned (Model::finishStep), before the
+         * agent sees the next page, under the Graph write lock.
          */
         virtual void updateStrategy() = 0;
 
@@ -131,6 +150,14 @@ namespace fastbotx {
          */
         virtual AlgorithmType getAlgorithmType() { return this->_algorithmType; }
 
+        /**
+         * @brief Add the agent's own structures (Q-values, reuse model...) to footprint
+         * 
+         * Called under the Graph read lock, so the agent's step updates are excluded.
+         * The states it refers to are accounted by the Graph.
+         */
+        virtual void accountMemory(MemoryFootprint &) const {}
+
         /**
          * @brief Get current state (state before last moveForward).
          * Used by Model for transition logging (dynamic state abstraction).
@@ -179,9 +206,21 @@ namespace fastbotx {
          * 5. Final priority cannot be less than 0
          * 
          * Also calculates total state priority (sum of all action priorities)
+         *
+         * Only recomputes the actions the state marked dirty once it was adjusted in full.
          */
         virtual void adjustActions();
 
+        /**
+         * @brief Recompute one action's priority of _newState (rules of adjustActions)
+         *
+         * @return The action's contribution to the state priority
+         */
+        int adjustActionPriority(const ActivityStateActionPtr &action) const;
+
+        /// Contribution of an action's current priority to its state's priority
+        static int priorityIncrement(const ActivityStateActionPtr &action);
+
         /**
          * @brief Default constructor
          * 
@@ -245,6 +284,9 @@ namespace fastbotx {
         /// Algorithm type
         AlgorithmType _algorithmType;
 
+        /// This agent's stream of RandomStreams: its own draws and its state sampling
+        mutable Rng _rng;
+
     };
 
 
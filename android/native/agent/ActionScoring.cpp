@@ -0,0 +1,157 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef ActionScoring_CPP_
+#define ActionScoring_CPP_
+
+#include "ActionScoring.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define FASTBOT_SCORING_NEON 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FASTBOT_SCORING_SSE2 1
+#endif
+
+namespace fastbotx {
+
+    namespace {
+        // Cephes expf: exp(x) = 2^n * exp(r), n = round(x / ln2), |r| <= ln2 / 2
+        constexpr float ExpLowerBound = -87.3f;  // exp() of anything lower is below FLT_MIN
+        constexpr float Log2e = 1.44269504088896341f;
+        constexpr float Ln2Hi = 0.693359375f;
+        constexpr float Ln2Lo = -2.12194440e-4f;
+        constexpr float ExpP0 = 1.9875691500e-4f;
+        constexpr float ExpP1 = 1.3981999507e-3f;
+        constexpr float ExpP2 = 8.3334519073e-3f;
+        constexpr float ExpP3 = 4.1665795894e-2f;
+        constexpr float ExpP4 = 1.6666665459e-1f;
+        constexpr float ExpP5 = 5.0000001201e-1f;
+
+        /// Scalar version of the vector kernels (tails and other targets); x <= 0
+        inline float expNonPositive(float x) {
+            x = std::max(x, ExpLowerBound);
+            float fx = x * Log2e + 0.5f;
+            auto n = static_cast<int32_t>(fx);
+            if (static_cast<float>(n) > fx) {
+                n--;  // floor
+            }
+            float nf = static_cast<float>(n);
+            float r = x - nf * Ln2Hi - nf * Ln2Lo;
+            float p = ((((ExpP0 * r + ExpP1) * r + ExpP2) * r + ExpP3) * r + ExpP4) * r + ExpP5;
+            p = p * r * r + r + 1.0f;
+            uint32_t bits = static_cast<uint32_t>(n + 127) << 23;
+            float scale;
+            std::memcpy(&scale, &bits, sizeof(scale));
+            return p * scale;
+        }
+    }
+
+    void expShifted(const float *x, float shift, float *out, size_t n) {
+        size_t i = 0;
+#if FASTBOT_SCORING_NEON
+        const float32x4_t vshift = vdupq_n_f32(shift);
+        const float32x4_t one = vdupq_n_f32(1.0f);
+        for (; i + 4 <= n; i += 4) {
+            float32x4_t v = vmaxq_f32(vsubq_f32(vld1q_f32(x + i), vshift), vdupq_n_f32(ExpLowerBound));
+            float32x4_t fx = vmlaq_f32(vdupq_n_f32(0.5f), v, vdupq_n_f32(Log2e));
+            float32x4_t t = vcvtq_f32_s32(vcvtq_s32_f32(fx));
+            // Truncation rounds negative values up; step back to floor
+            uint32x4_t above = vcgtq_f32(t, fx);
+            t = vsubq_f32(t, vreinterpretq_f32_u32(vandq_u32(above, vreinterpretq_u32_f32(one))));
+            float32x4_t r = vmlsq_f32(v, t, vdupq_n_f32(Ln2Hi));
+            r = vmlsq_f32(r, t, vdupq_n_f32(Ln2Lo));
+            float32x4_t p = vdupq_n_f32(ExpP0);
+            p = vmlaq_f32(vdupq_n_f32(ExpP1), p, r);
+            p = vmlaq_f32(vdupq_n_f32(ExpP2), p, r);
+            p = vmlaq_f32(vdupq_n_f32(ExpP3), p, r);
+            p = vmlaq_f32(vdupq_n_f32(ExpP4), p, r);
+            p = vmlaq_f32(vdupq_n_f32(ExpP5), p, r);
+            p = vaddq_f32(vmlaq_f32(r, p, vmulq_f32(r, r)), one);
+            int32x4_t bits = vshlq_n_s32(vaddq_s32(vcvtq_s32_f32(t), vdupq_n_s32(127)), 23);
+            vst1q_f32(out + i, vmulq_f32(p, vreinterpretq_f32_s32(bits)));
+        }
+#elif FASTBOT_SCORING_SSE2
+        const __m128 vshift = _mm_set1_ps(shift);
+        const __m128 one = _mm_set1_ps(1.0f);
+        for (; i + 4 <= n; i += 4) {
+            __m128 v = _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(x + i), vshift), _mm_set1_ps(ExpLowerBound));
+            __m128 fx = _mm_add_ps(_mm_mul_ps(v, _mm_set1_ps(Log2e)), _mm_set1_ps(0.5f));
+            __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(fx));
+            // Truncation rounds negative values up; step back to floor
+            t = _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, fx), one));
+            __m128 r = _mm_sub_ps(v, _mm_mul_ps(t, _mm_set1_ps(Ln2Hi)));
+            r = _mm_sub_ps(r, _mm_mul_ps(t, _mm_set1_ps(Ln2Lo)));
+            __m128 p = _mm_set1_ps(ExpP0);
+            p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(ExpP1));
+            p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(ExpP2));
+            p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(ExpP3));
+            p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(ExpP4));
+            p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(ExpP5));
+            p = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p, _mm_mul_ps(r, r)), r), one);
+            __m128i bits = _mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(t), _mm_set1_epi32(127)), 23);
+            _mm_storeu_ps(out + i, _mm_mul_ps(p, _mm_castsi128_ps(bits)));
+        }
+#endif
+        for (; i < n; i++) {
+            out[i] = expNonPositive(x[i] - shift);
+        }
+    }
+
+    float maxOf(const float *x, size_t n) {
+        size_t i = 0;
+        float result = x[0];
+#if FASTBOT_SCORING_NEON
+        if (n >= 4) {
+            float32x4_t vmax = vld1q_f32(x);
+            for (i = 4; i + 4 <= n; i += 4) {
+                vmax = vmaxq_f32(vmax, vld1q_f32(x + i));
+            }
+            float lanes[4];
+            vst1q_f32(lanes, vmax);
+            result = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+        }
+#elif FASTBOT_SCORING_SSE2
+        if (n >= 4) {
+            __m128 vmax = _mm_loadu_ps(x);
+            for (i = 4; i + 4 <= n; i += 4) {
+                vmax = _mm_max_ps(vmax, _mm_loadu_ps(x + i));
+            }
+            float lanes[4];
+            _mm_storeu_ps(lanes, vmax);
+            result = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+        }
+#endif
+        for (; i < n; i++) {
+            result = std::max(result, x[i]);
+        }
+        return result;
+    }
+
+    size_t ScoreBatch::sampleSoftmax(float uniform) {
+        size_t n = this->_scores.size();
+        if (0 == n) {
+            return 0;
+        }
+        this->_weights.resize(n);
+        float *weights = this->_weights.data();
+        // Shift by the maximum: every weight is in (0, 1] and the best one is exactly 1
+        expShifted(this->_scores.data(), maxOf(this->_scores.data(), n), weights, n);
+        for (size_t i = 1; i < n; i++) {
+            weights[i] += weights[i - 1];
+        }
+        float target = uniform * weights[n - 1];
+        size_t picked = static_cast<size_t>(std::upper_bound(weights, weights + n, target) - weights);
+        return std::min(picked, n - 1);
+    }
+
+}
+
+#endif //ActionScoring_CPP_
@@ -0,0 +1,63 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef ActionScoring_H_
+#define ActionScoring_H_
+
+#include <cstddef>
+#include <vector>
+
+namespace fastbotx {
+
+    /**
+     * @brief Batched softmax sampling over contiguous action scores
+     *
+     * The agents pick actions by Gumbel-max: argmax(score[i] - log(-log(u[i]))) with
+     * one uniform draw and two logarithms per action. That is a sample from
+     * softmax(score), which this kernel draws directly: one max reduction, one
+     * exp per action (NEON on ARM, SSE2 on x86, scalar otherwise), a prefix sum and a
+     * single uniform draw with binary search.
+     *
+     * Callers gather scores into a ScoreBatch (hash / Q / reuse lookups stay scalar)
+     * and keep the mapping from batch index back to their action.
+     */
+    class ScoreBatch {
+    public:
+        void clear() { this->_scores.clear(); }
+
+        void reserve(size_t n) { this->_scores.reserve(n); }
+
+        void push(float score) { this->_scores.push_back(score); }
+
+        size_t size() const { return this->_scores.size(); }
+
+        bool empty() const { return this->_scores.empty(); }
+
+        const std::vector<float> &scores() const { return this->_scores; }
+
+        /**
+         * @brief Pick an index with probability proportional to exp(score[i])
+         *
+         * @param uniform Draw from [0, 1)
+         * @return Index into the batch, or size() if the batch is empty
+         */
+        size_t sampleSoftmax(float uniform);
+
+    private:
+        std::vector<float> _scores;
+        /// exp(score - max), then its inclusive prefix sum
+        std::vector<float> _weights;
+    };
+
+    /// Vectorized exp(x[i] - shift) into out[i]; max relative error about 2e-7 for results above 1e-38
+    void expShifted(const float *x, float shift, float *out, size_t n);
+
+    /// Vectorized maximum of x[0..n) (n > 0)
+    float maxOf(const float *x, size_t n);
+
+}
+
+#endif //ActionScoring_H_
@@ -25,6 +25,8 @@ namespace fastbotx {
      * 
      * Supported algorithm types:
      * - All types: Creates DoubleSarsaAgent (Double SARSA) - ModelReusableAgent temporarily disabled for testing
+     * - Server: The DoubleSarsaAgent is the local fallback; Model::addAgent also connects to the
+     *   decision server, which decides the steps it answers in time (Model::getRemoteOperate)
      * 
      * Creation flow:
      * 1. Create Agent instance based on algorithm type
@@ -0,0 +1,370 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef CompactReuseModel_CPP_
+#define CompactReuseModel_CPP_
+
+#include "CompactReuseModel.h"
+#include "../utils.hpp"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+namespace fastbotx {
+
+    constexpr uint32_t CompactReuseModel::Magic;
+    constexpr size_t CompactReuseModel::HeaderSize;
+    constexpr size_t CompactReuseModel::BlockIndexEntrySize;
+    constexpr uint32_t CompactReuseModel::BlockEntries;
+    constexpr uint8_t CompactReuseModel::HasQValues;
+
+    namespace {
+        uint32_t getU32(const uint8_t *in) {
+            return static_cast<uint32_t>(in[0]) | static_cast<uint32_t>(in[1]) << 8 |
+                   static_cast<uint32_t>(in[2]) << 16 | static_cast<uint32_t>(in[3]) << 24;
+        }
+
+        uint64_t getU64(const uint8_t *in) {
+            return static_cast<uint64_t>(getU32(in)) | static_cast<uint64_t>(getU32(in + 4)) << 32;
+        }
+
+        double getDouble(const uint8_t *in) {
+            uint64_t bits = getU64(in);
+            double value;
+            memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+
+        void putU32(std::string &out, uint32_t value) {
+            for (int shift = 0; shift < 32; shift += 8) {
+                out.push_back(static_cast<char>(value >> shift));
+            }
+        }
+
+        void putU64(std::string &out, uint64_t value) {
+            putU32(out, static_cast<uint32_t>(value));
+            putU32(out, static_cast<uint32_t>(value >> 32));
+        }
+
+        void putDouble(std::string &out, double value) {
+            uint64_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            putU64(out, bits);
+        }
+
+        void setU32(std::string &out, size_t offset, uint32_t value) {
+            for (int i = 0; i < 4; i++) {
+                out[offset + i] = static_cast<char>(value >> (8 * i));
+            }
+        }
+
+        void putVarint(std::string &out, uint64_t value) {
+            while (value >= 0x80) {
+                out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+                value >>= 7;
+            }
+            out.push_back(static_cast<char>(value));
+        }
+
+        /// Decode a varint of unverified data; false if it runs past end or is too long
+        bool readCheckedVarint(const uint8_t *&in, const uint8_t *end, uint64_t &value) {
+            value = 0;
+            for (int shift = 0; shift < 64 && in < end; shift += 7) {
+                uint8_t byte = *in++;
+                value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+                if (0 == (byte & 0x80)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+    }
+
+    bool CompactReuseModel::isCompact(const uint8_t *data, size_t size) {
+        return size >= HeaderSize && getU32(data) == Magic;
+    }
+
+    bool CompactReuseModel::open(const uint8_t *data, size_t size) {
+        if (!isCompact(data, size)) {
+            return false;
+        }
+        uint32_t dictionaryOffset = getU32(data + 28);
+        uint32_t indexOffset = getU32(data + 32);
+        uint32_t entriesOffset = getU32(data + 36);
+        this->_version = getU32(data + 4);
+        this->_checkpoint = getU64(data + 8);
+        this->_entryCount = getU32(data + 16);
+        this->_activityCount = getU32(data + 20);
+        this->_blockCount = getU32(data + 24);
+
+        // Sections in order, inside the file (64-bit sums: no overflow)
+        uint64_t namesOffset = dictionaryOffset + 4 * (static_cast<uint64_t>(this->_activityCount) + 1);
+        if (dictionaryOffset < HeaderSize || namesOffset > indexOffset ||
+            indexOffset + BlockIndexEntrySize * static_cast<uint64_t>(this->_blockCount) > entriesOffset ||
+            entriesOffset > size) {
+            BLOGE("reuse model: compact file sections out of bounds");
+            return false;
+        }
+        this->_dictionary = data + dictionaryOffset;
+        this->_names = data + namesOffset;
+        this->_index = data + indexOffset;
+        this->_entries = data + entriesOffset;
+
+        uint32_t previousName = 0;
+        for (uint32_t id = 0; id <= this->_activityCount; id++) {
+            uint32_t nameOffset = getU32(this->_dictionary + 4 * id);
+            if ((0 == id && nameOffset != 0) || nameOffset < previousName ||
+                namesOffset + nameOffset > indexOffset) {
+                BLOGE("reuse model: compact file has an invalid activity dictionary");
+                return false;
+            }
+            previousName = nameOffset;
+        }
+
+        // Decode every entry once: blocks contiguous, actions strictly increasing
+        const uint8_t *end = data + size;
+        const uint8_t *in = this->_entries;
+        uint64_t entries = 0;
+        uint64_t previousAction = 0;
+        for (uint32_t block = 0; block < this->_blockCount; block++) {
+            const uint8_t *indexEntry = this->_index + BlockIndexEntrySize * block;
+            uint64_t action = getU64(indexEntry);
+            uint32_t count = getU32(indexEntry + 12);
+            if (this->_entries + getU32(indexEntry + 8) != in || 0 == count ||
+                (entries > 0 && action <= previousAction)) {
+                BLOGE("reuse model: compact file has an invalid block %u", block);
+                return false;
+            }
+            for (uint32_t i = 0; i < count; i++) {
+                uint64_t delta = 0;
+                uint64_t value = 0;
+                if (!readCheckedVarint(in, end, delta) || (i > 0 && 0 == delta) || (0 == i && delta != 0) ||
+                    action + delta < action || in >= end) {
+                    BLOGE("reuse model: compact file entries are not sorted");
+                    return false;
+                }
+                action += delta;
+                uint8_t flags = *in++;
+                if ((flags & ~HasQValues) != 0) {
+                    return false;
+                }
+                if ((flags & HasQValues) != 0) {
+                    if (end - in < 16) {
+                        return false;
+                    }
+                    in += 16;
+                    if (!readCheckedVarint(in, end, value) || value > UINT32_MAX) {
+                        return false;
+                    }
+                }
+                uint64_t targetCount = 0;
+                uint64_t targetBytes = 0;
+                if (!readCheckedVarint(in, end, targetCount) || !readCheckedVarint(in, end, targetBytes) ||
+                    targetCount > UINT32_MAX || targetBytes > static_cast<uint64_t>(end - in)) {
+                    return false;
+                }
+                const uint8_t *targetsEnd = in + targetBytes;
+                for (uint64_t t = 0; t < targetCount; t++) {
+                    uint64_t id = 0;
+                    if (!readCheckedVarint(in, targetsEnd, id) || id >= this->_activityCount ||
+                        !readCheckedVarint(in, targetsEnd, value) || value > INT_MAX) {
+                        BLOGE("reuse model: compact file has an invalid target");
+                        return false;
+                    }
+                }
+                if (in != targetsEnd) {
+                    return false;
+                }
+            }
+            entries += count;
+            previousAction = action;
+        }
+        if (entries != this->_entryCount || in != end) {
+            BLOGE("reuse model: compact file has %llu entries, header says %u",
+                  static_cast<unsigned long long>(entries), this->_entryCount);
+            return false;
+        }
+        return true;
+    }
+
+    uint64_t CompactReuseModel::blockStart(uint32_t block, const uint8_t *&in, uint32_t &count) const {
+        const uint8_t *indexEntry = this->_index + BlockIndexEntrySize * block;
+        in = this->_entries + getU32(indexEntry + 8);
+        count = getU32(indexEntry + 12);
+        return getU64(indexEntry);
+    }
+
+    void CompactReuseModel::readEntry(const uint8_t *&in, uint64_t &action, ReuseEntryView &entry) const {
+        action += readVarint(in);
+        entry.action = action;
+        uint8_t flags = *in++;
+        if ((flags & HasQValues) != 0) {
+            entry.q1 = getDouble(in);
+            entry.q2 = getDouble(in + 8);
+            in += 16;
+            entry.visits = static_cast<uint32_t>(readVarint(in));
+        } else {
+            entry.q1 = 0.0;
+            entry.q2 = 0.0;
+            entry.visits = 0;
+        }
+        entry.targetCount = static_cast<uint32_t>(readVarint(in));
+        entry.packedBytes = static_cast<size_t>(readVarint(in));
+        entry.packedTargets = in;
+        entry.table = nullptr;
+        in += entry.packedBytes;
+    }
+
+    bool CompactReuseModel::find(uint64_t actionHash, ReuseEntryView &entry) const {
+        // Last block whose first action is not above actionHash
+        uint32_t low = 0;
+        uint32_t high = this->_blockCount;
+        while (low < high) {
+            uint32_t middle = low + (high - low) / 2;
+            if (getU64(this->_index + BlockIndexEntrySize * middle) <= actionHash) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        if (0 == low) {
+            return false;
+        }
+        const uint8_t *in = nullptr;
+        uint32_t count = 0;
+        uint64_t action = blockStart(low - 1, in, count);
+        for (uint32_t i = 0; i < count; i++) {
+            readEntry(in, action, entry);
+            if (action >= actionHash) {
+                return action == actionHash;
+            }
+        }
+        return false;
+    }
+
+    const char *CompactReuseModel::activityName(uint32_t id, size_t &length) const {
+        uint32_t begin = getU32(this->_dictionary + 4 * id);
+        length = getU32(this->_dictionary + 4 * (id + 1)) - begin;
+        return reinterpret_cast<const char *>(this->_names + begin);
+    }
+
+    void CompactReuseModelWriter::beginEntry(uint64_t actionHash) {
+        this->_entries.push_back(PendingEntry{actionHash, 0.0, 0.0, 0,
+                                              static_cast<uint32_t>(this->_targets.size()), 0});
+    }
+
+    void CompactReuseModelWriter::addTarget(const char *activity, size_t length, int times) {
+        this->_targets.emplace_back(activityId(activity, length), static_cast<uint32_t>(std::max(times, 0)));
+        this->_entries.back().targetCount++;
+    }
+
+    void CompactReuseModelWriter::endEntry(double q1, double q2, uint32_t visits) {
+        PendingEntry &entry = this->_entries.back();
+        entry.q1 = q1;
+        entry.q2 = q2;
+        entry.visits = visits;
+    }
+
+    uint32_t CompactReuseModelWriter::activityId(const char *activity, size_t length) {
+        // An empty name of a mapped dictionary starts where the next one does: not cached
+        auto byPointer = length > 0 ? this->_idsByPointer.find(activity) : this->_idsByPointer.end();
+        if (byPointer != this->_idsByPointer.end()) {
+            return byPointer->second;
+        }
+        auto id = static_cast<uint32_t>(this->_names.size());
+        auto inserted = this->_ids.emplace(std::string(activity, length), id);
+        if (inserted.second) {
+            this->_names.push_back(inserted.first->first);
+        }
+        if (length > 0) {
+            this->_idsByPointer.emplace(activity, inserted.first->second);
+        }
+        return inserted.first->second;
+    }
+
+    void CompactReuseModelWriter::finish(uint32_t version, uint64_t checkpoint) {
+        std::stable_sort(this->_entries.begin(), this->_entries.end(),
+                         [](const PendingEntry &left, const PendingEntry &right) {
+                             return left.action < right.action;
+                         });
+        std::vector<const PendingEntry *> entries;
+        entries.reserve(this->_entries.size());
+        for (size_t i = 0; i < this->_entries.size(); i++) {
+            if (i + 1 < this->_entries.size() && this->_entries[i + 1].action == this->_entries[i].action) {
+                continue;  // replaced by a later one
+            }
+            entries.push_back(&this->_entries[i]);
+        }
+        auto blockCount = static_cast<uint32_t>((entries.size() + CompactReuseModel::BlockEntries - 1) /
+                                                CompactReuseModel::BlockEntries);
+
+        std::string &out = this->_encoded;
+        out.clear();
+        putU32(out, CompactReuseModel::Magic);
+        putU32(out, version);
+        putU64(out, checkpoint);
+        putU32(out, static_cast<uint32_t>(entries.size()));
+        putU32(out, static_cast<uint32_t>(this->_names.size()));
+        putU32(out, blockCount);
+        out.resize(CompactReuseModel::HeaderSize, '\0');
+        setU32(out, 28, static_cast<uint32_t>(out.size()));
+
+        uint32_t nameOffset = 0;
+        putU32(out, nameOffset);
+        for (const std::string &name: this->_names) {
+            nameOffset += static_cast<uint32_t>(name.size());
+            putU32(out, nameOffset);
+        }
+        for (const std::string &name: this->_names) {
+            out.append(name);
+        }
+
+        // The index is filled in once the block offsets are known
+        size_t indexOffset = out.size();
+        setU32(out, 32, static_cast<uint32_t>(indexOffset));
+        out.resize(indexOffset + CompactReuseModel::BlockIndexEntrySize * blockCount, '\0');
+        size_t entriesOffset = out.size();
+        setU32(out, 36, static_cast<uint32_t>(entriesOffset));
+
+        std::string targets;
+        uint64_t previousAction = 0;
+        for (size_t i = 0; i < entries.size(); i++) {
+            const PendingEntry &entry = *entries[i];
+            if (0 == i % CompactReuseModel::BlockEntries) {
+                size_t indexEntry = indexOffset + CompactReuseModel::BlockIndexEntrySize *
+                                                  (i / CompactReuseModel::BlockEntries);
+                std::string blockHeader;
+                putU64(blockHeader, entry.action);
+                putU32(blockHeader, static_cast<uint32_t>(out.size() - entriesOffset));
+                putU32(blockHeader, static_cast<uint32_t>(
+                        std::min<size_t>(CompactReuseModel::BlockEntries, entries.size() - i)));
+                out.replace(indexEntry, blockHeader.size(), blockHeader);
+                previousAction = entry.action;
+            }
+            putVarint(out, entry.action - previousAction);
+            previousAction = entry.action;
+            bool hasQValues = entry.q1 != 0.0 || entry.q2 != 0.0 || entry.visits != 0;
+            out.push_back(static_cast<char>(hasQValues ? CompactReuseModel::HasQValues : 0));
+            if (hasQValues) {
+                putDouble(out, entry.q1);
+                putDouble(out, entry.q2);
+                putVarint(out, entry.visits);
+            }
+            targets.clear();
+            for (uint32_t t = 0; t < entry.targetCount; t++) {
+                const std::pair<uint32_t, uint32_t> &target = this->_targets[entry.firstTarget + t];
+                putVarint(targets, target.first);
+                putVarint(targets, target.second);
+            }
+            putVarint(out, entry.targetCount);
+            putVarint(out, targets.size());
+            out.append(targets);
+        }
+    }
+
+}
+
+#endif //CompactReuseModel_CPP_
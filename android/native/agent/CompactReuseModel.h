@@ -0,0 +1,191 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef CompactReuseModel_H_
+#define CompactReuseModel_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace fastbotx {
+
+    struct ReuseEntry;
+
+    /**
+     * @brief One entry of a mapped reuse model file, read in place
+     *
+     * Filled by MappedReuseModel whichever the file's encoding; the targets stay in the
+     * file and are read with MappedReuseModel::forEachTarget.
+     */
+    struct ReuseEntryView {
+        uint64_t action{0};
+        double q1{0.0};
+        double q2{0.0};
+        uint32_t visits{0};
+        /// Number of (activity, times) targets
+        uint32_t targetCount{0};
+        /// FlatBuffers file: the entry table
+        const ReuseEntry *table{nullptr};
+        /// Compact file: the packed (activity id, times) pairs
+        const uint8_t *packedTargets{nullptr};
+        size_t packedBytes{0};
+    };
+
+    /**
+     * @brief Reader of the compact reuse model encoding (.fbm files starting with "FBMC")
+     *
+     * Layout, little-endian:
+     *   header      magic, version, checkpoint, entry / activity / block counts and the
+     *               offsets of the three sections (HeaderSize bytes)
+     *   dictionary  activityCount + 1 u32 offsets into the activity name bytes that follow
+     *   block index per block of up to BlockEntries entries: first action (u64), offset of
+     *               its first entry in the entry section (u32), entry count (u32)
+     *   entries     sorted by action; per entry: varint action delta to the previous entry of
+     *               the block (the first one: to the block's first action), a flags byte
+     *               (HasQValues: q1, q2 as raw doubles and varint visits follow), varint
+     *               target count, varint byte size of the targets, then the targets as
+     *               (varint activity id, varint times) pairs
+     *
+     * Activity names are stored once instead of once per target, and hashes and counts
+     * take a few bytes instead of FlatBuffers tables and offsets. The file stays searchable
+     * in place: binary search over the block index, then a scan of one block.
+     * open() checks every offset, id and varint, so queries need no further checks.
+     */
+    class CompactReuseModel {
+    public:
+        static constexpr uint32_t Magic = 0x434d4246;  // "FBMC"
+        static constexpr size_t HeaderSize = 40;
+        static constexpr size_t BlockIndexEntrySize = 16;
+        static constexpr uint32_t BlockEntries = 32;
+        static constexpr uint8_t HasQValues = 0x01;
+
+        /// Whether data starts like a compact file (FlatBuffers files never do)
+        static bool isCompact(const uint8_t *data, size_t size);
+
+        /// Attach to a mapped file and verify it; false if it is malformed
+        bool open(const uint8_t *data, size_t size);
+
+        uint32_t version() const { return this->_version; }
+
+        uint64_t checkpoint() const { return this->_checkpoint; }
+
+        size_t size() const { return this->_entryCount; }
+
+        /// Entry of the given action hash (O(log blocks + BlockEntries), no allocation)
+        bool find(uint64_t actionHash, ReuseEntryView &entry) const;
+
+        /// Call fn(const ReuseEntryView &) for each entry, in action order
+        template<typename Fn>
+        void forEach(Fn fn) const {
+            ReuseEntryView entry;
+            for (uint32_t block = 0; block < this->_blockCount; block++) {
+                const uint8_t *in = nullptr;
+                uint32_t count = 0;
+                uint64_t action = blockStart(block, in, count);
+                for (uint32_t i = 0; i < count; i++) {
+                    readEntry(in, action, entry);
+                    fn(static_cast<const ReuseEntryView &>(entry));
+                }
+            }
+        }
+
+        /// Call fn(const char *activity, size_t length, int times) for each target of entry
+        template<typename Fn>
+        void forEachTarget(const ReuseEntryView &entry, Fn fn) const {
+            const uint8_t *in = entry.packedTargets;
+            for (uint32_t i = 0; i < entry.targetCount; i++) {
+                auto id = static_cast<uint32_t>(readVarint(in));
+                auto times = static_cast<int>(readVarint(in));
+                size_t length = 0;
+                const char *activity = activityName(id, length);
+                fn(activity, length, times);
+            }
+        }
+
+    private:
+        /// Decode a varint of verified data
+        static uint64_t readVarint(const uint8_t *&in) {
+            uint64_t value = 0;
+            for (int shift = 0;; shift += 7) {
+                uint8_t byte = *in++;
+                value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+                if (0 == (byte & 0x80)) {
+                    return value;
+                }
+            }
+        }
+
+        /// First action of block; in and count are set to its entries
+        uint64_t blockStart(uint32_t block, const uint8_t *&in, uint32_t &count) const;
+
+        /// Decode the entry at in (verified data); action holds the previous entry's action
+        void readEntry(const uint8_t *&in, uint64_t &action, ReuseEntryView &entry) const;
+
+        const char *activityName(uint32_t id, size_t &length) const;
+
+        uint32_t _version{0};
+        uint64_t _checkpoint{0};
+        uint32_t _entryCount{0};
+        uint32_t _activityCount{0};
+        uint32_t _blockCount{0};
+        const uint8_t *_dictionary{nullptr};
+        const uint8_t *_names{nullptr};
+        const uint8_t *_index{nullptr};
+        const uint8_t *_entries{nullptr};
+    };
+
+    /**
+     * @brief Encoder of the compact reuse model file
+     *
+     * Entries are added in any order (beginEntry, addTarget for each target, endEntry)
+     * and sorted by finish(). Activity strings are referenced, not copied, until finish().
+     */
+    class CompactReuseModelWriter {
+    public:
+        void beginEntry(uint64_t actionHash);
+
+        void addTarget(const char *activity, size_t length, int times);
+
+        void endEntry(double q1, double q2, uint32_t visits);
+
+        /// Number of entries added (an action added twice counts once in the file)
+        size_t size() const { return this->_entries.size(); }
+
+        /// Encode the file; a later entry of the same action replaces an earlier one
+        void finish(uint32_t version, uint64_t checkpoint);
+
+        const uint8_t *data() const { return reinterpret_cast<const uint8_t *>(this->_encoded.data()); }
+
+        size_t byteSize() const { return this->_encoded.size(); }
+
+    private:
+        struct PendingEntry {
+            uint64_t action;
+            double q1;
+            double q2;
+            uint32_t visits;
+            uint32_t firstTarget;
+            uint32_t targetCount;
+        };
+
+        uint32_t activityId(const char *activity, size_t length);
+
+        std::vector<PendingEntry> _entries;
+        /// (activity id, times) of all entries
+        std::vector<std::pair<uint32_t, uint32_t>> _targets;
+        /// Ids by string pointer first: the interned / mapped names repeat the same pointers
+        std::unordered_map<const char *, uint32_t> _idsByPointer;
+        std::unordered_map<std::string, uint32_t> _ids;
+        std::vector<std::string> _names;
+        std::string _encoded;
+    };
+
+}
+
+#endif //CompactReuseModel_H_
@@ -0,0 +1,161 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef DoubleQTable_H_
+#define DoubleQTable_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace fastbotx {
+
+    /**
+     * @brief Flat open-addressing table of Double SARSA values keyed by action hash
+     *
+     * Replaces two std::map<uint64_t, double> (one per Q-function): Q1, Q2 and the
+     * visit count of an action live in the same 32-byte slot, so one probe returns
+     * both values and an update touches a single cache line. Absent actions read as
+     * Q1 = Q2 = 0.
+     *
+     * Key 0 marks an empty slot; an action whose hash is 0 is kept out of line.
+     * Entries are never erased (Q-values only grow in number during a run), so linear
+     * probing needs no tombstones. The table doubles at 50% load.
+     *
+     * Not thread-safe: owned by the agent thread. Other threads read copies published
+     * by DoubleSarsaAgent (see DoubleSarsaAgent::acquireQSnapshot).
+     */
+    class DoubleQTable {
+    public:
+        struct Entry {
+            uint64_t key;
+            double q1;
+            double q2;
+            /// Times the action was executed, accumulated across sessions
+            uint32_t visits;
+        };
+
+        DoubleQTable() = default;
+
+        size_t size() const { return this->_size + (this->_hasZeroKey ? 1 : 0); }
+
+        bool empty() const { return 0 == size(); }
+
+        /// Heap bytes of the slot array
+        size_t tableBytes() const { return this->_slots.capacity() * sizeof(Entry); }
+
+        /// Entry of the given action hash, or nullptr if it has no Q-values yet
+        const Entry *find(uint64_t key) const {
+            if (0 == key) {
+                return this->_hasZeroKey ? &this->_zeroKey : nullptr;
+            }
+            if (0 == this->_size) {
+                return nullptr;
+            }
+            size_t mask = this->_slots.size() - 1;
+            for (size_t i = mix(key) & mask;; i = (i + 1) & mask) {
+                const Entry &slot = this->_slots[i];
+                if (slot.key == key) {
+                    return &slot;
+                }
+                if (0 == slot.key) {
+                    return nullptr;
+                }
+            }
+        }
+
+        /// Entry of the given action hash, inserted with Q1 = Q2 = 0 and no visits if absent
+        Entry &findOrInsert(uint64_t key) {
+            if (0 == key) {
+                if (!this->_hasZeroKey) {
+                    this->_zeroKey = Entry{0, 0.0, 0.0, 0};
+                    this->_hasZeroKey = true;
+                }
+                return this->_zeroKey;
+            }
+            if ((this->_size + 1) * 2 > this->_slots.size()) {
+                rehash(this->_slots.empty() ? static_cast<size_t>(InitialCapacity) : this->_slots.size() * 2);
+            }
+            size_t mask = this->_slots.size() - 1;
+            size_t i = mix(key) & mask;
+            while (this->_slots[i].key != key) {
+                if (0 == this->_slots[i].key) {
+                    this->_slots[i] = Entry{key, 0.0, 0.0, 0};
+                    this->_size++;
+                    break;
+                }
+                i = (i + 1) & mask;
+            }
+            return this->_slots[i];
+        }
+
+        double getQ1(uint64_t key) const {
+            const Entry *entry = find(key);
+            return entry ? entry->q1 : 0.0;
+        }
+
+        double getQ2(uint64_t key) const {
+            const Entry *entry = find(key);
+            return entry ? entry->q2 : 0.0;
+        }
+
+        void clear() {
+            this->_slots.clear();
+            this->_size = 0;
+            this->_hasZeroKey = false;
+        }
+
+        /// Visit every entry (unspecified order)
+        template<typename Func>
+        void forEach(Func func) const {
+            if (this->_hasZeroKey) {
+                func(this->_zeroKey);
+            }
+            for (const auto &slot: this->_slots) {
+                if (slot.key != 0) {
+                    func(slot);
+                }
+            }
+        }
+
+    private:
+        enum : size_t {
+            InitialCapacity = 256
+        };
+
+        /// Action hashes of related widgets share low bits; spread them before masking
+        static size_t mix(uint64_t h) {
+            h ^= h >> 33;
+            h *= 0xff51afd7ed558ccdULL;
+            h ^= h >> 33;
+            return static_cast<size_t>(h);
+        }
+
+        void rehash(size_t capacity) {
+            std::vector<Entry> slots(capacity, Entry{0, 0.0, 0.0, 0});
+            slots.swap(this->_slots);
+            size_t mask = capacity - 1;
+            for (const auto &slot: slots) {
+                if (0 == slot.key) {
+                    continue;
+                }
+                size_t i = mix(slot.key) & mask;
+                while (this->_slots[i].key != 0) {
+                    i = (i + 1) & mask;
+                }
+                this->_slots[i] = slot;
+            }
+        }
+
+        std::vector<Entry> _slots;
+        size_t _size{0};
+        Entry _zeroKey{0, 0.0, 0.0, 0};
+        bool _hasZeroKey{false};
+    };
+
+}
+
+#endif //DoubleQTable_H_
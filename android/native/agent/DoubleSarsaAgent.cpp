@@ -12,6 +12,8 @@
 #include <cmath>
 #include "ActivityNameAction.h"
 #include "../storage/ReuseModel_generated.h"
+#include "../Trace.h"
+#include "MemoryFootprint.h"
 #include <iostream>
 #include <fstream>
 #include <limits>
@@ -23,6 +25,8 @@
 #include <chrono>
 #include <cstdio>
 #include <cinttypes>
+#include <fcntl.h>
+#include <unistd.h>
 
 namespace ModelStorageConstants {
 #ifdef __ANDROID__
@@ -32,8 +36,12 @@ namespace ModelStorageConstants {
 #endif
     constexpr const char* ModelFileExtension = ".fbm";
     constexpr const char* TempModelFileExtension = ".tmp.fbm";
+    /// Appended to the model file path to name its delta journal
+    constexpr const char* JournalFileExtension = ".journal";
     /// Max length for activity name when serializing (security: prevent unbounded string)
     constexpr size_t MaxActivityNameLength = 4096;
+    /// ReuseModel.version from which ReuseEntry carries q1/q2/visits (older files: 0)
+    constexpr uint32_t QValueFormatVersion = 2;
 }  // namespace ModelStorageConstants
 
 namespace fastbotx {
@@ -52,15 +60,78 @@ namespace fastbotx {
             : AbstractAgent(model), 
               _alpha(DoubleSarsaRLConstants::DefaultAlpha),  // Initial learning rate 0.25
               _epsilon(DoubleSarsaRLConstants::DefaultEpsilon),  // Initial exploration rate 0.05
-              _rng(std::random_device{}()),  // Initialize random number generator with random device
+              _reuseModel(SharedReuseModel::forFile(DefaultModelSavePath)),
+              _qSnapshot(std::make_shared<const DoubleQTable>()),  // Saves before the first step see an empty table
               _modelSavePath(DefaultModelSavePath),  // Set model save path
-              _defaultModelSavePath(DefaultModelSavePath) {  // Set default save path
+              _defaultModelSavePath(DefaultModelSavePath),  // Set default save path
+              _storageScheduler(std::make_shared<ModelStorageScheduler>(
+                      std::chrono::milliseconds(DoubleSarsaRLConstants::ModelSaveIntervalMs),
+                      DoubleSarsaRLConstants::ModelSaveDirtyThreshold,
+                      std::chrono::milliseconds(DoubleSarsaRLConstants::ModelSaveMinSpacingMs))) {
         this->_algorithmType = AlgorithmType::DoubleSarsa;  // Set algorithm type to DoubleSarsa
+        // Save schedule overrides from max.config
+        PreferencePtr preference = model ? model->getPreference() : nullptr;
+        if (preference && (preference->getModelSaveIntervalMs() > 0 || preference->getModelSaveDirtyThreshold() >= 0)) {
+            long intervalMs = preference->getModelSaveIntervalMs() > 0 ? preference->getModelSaveIntervalMs()
+                                                                      : DoubleSarsaRLConstants::ModelSaveIntervalMs;
+            size_t dirtyThreshold = preference->getModelSaveDirtyThreshold() >= 0
+                                    ? static_cast<size_t>(preference->getModelSaveDirtyThreshold())
+                                    : DoubleSarsaRLConstants::ModelSaveDirtyThreshold;
+            this->_storageScheduler->configure(std::chrono::milliseconds(intervalMs), dirtyThreshold);
+            BLOG("Double SARSA: model save interval %ld ms, dirty threshold %zu", intervalMs, dirtyThreshold);
+        }
+        if (preference && preference->getNStep() > 0) {
+            this->setNStep(preference->getNStep());
+        }
+        this->_ownsReuseStorage = this->_reuseModel->claimStorage(this, this->_storageScheduler);
         BLOG("Double SARSA: Agent initialized with alpha=%.4f, epsilon=%.4f, gamma=%.4f, NStep=%d", 
              DoubleSarsaRLConstants::DefaultAlpha, 
              DoubleSarsaRLConstants::DefaultEpsilon,
              DoubleSarsaRLConstants::DefaultGamma,
-             DoubleSarsaRLConstants::NStep);
+             this->_nStep);
+    }
+
+    void DoubleSarsaAgent::accountMemory(MemoryFootprint &footprint) const {
+        footprint.add("agent.qTable", this->_qTable.size(), this->_qTable.tableBytes());
+        footprint.add("agent.history", this->_previousActions.size(),
+                      MemoryFootprint::bytesOf(this->_previousActions) + MemoryFootprint::bytesOf(this->_rewardCache));
+        std::shared_ptr<const DoubleQTable> published = std::atomic_load(&this->_qSnapshot);
+        SharedReuseModelPtr reuseModel;
+        {
+            std::lock_guard<std::mutex> storageGuard(this->_storageLock);
+            // Published copies of the Q-table; the one on disk is often the published one
+            size_t snapshots = 0;
+            size_t snapshotBytes = 0;
+            for (const DoubleQTable *snapshot: {published.get(), this->_persistedQ.get()}) {
+                if (snapshot && footprint.firstVisit(snapshot)) {
+                    snapshots++;
+                    snapshotBytes += sizeof(DoubleQTable) + snapshot->tableBytes();
+                }
+            }
+            footprint.add("agent.qSnapshots", snapshots, snapshotBytes);
+            size_t overlayBytes = MemoryFootprint::bytesOf(this->_storageOverlay) +
+                                  MemoryFootprint::bytesOf(this->_unsavedActions);
+            for (const auto &entry: this->_storageOverlay) {
+                overlayBytes += MemoryFootprint::bytesOf(entry.second);
+            }
+            footprint.add("agent.storageOverlay", this->_storageOverlay.size(), overlayBytes);
+            reuseModel = this->_reuseModel;
+        }
+        if (reuseModel) {
+            reuseModel->accountMemory(footprint);
+        }
+    }
+
+    void DoubleSarsaAgent::setNStep(int nStep) {
+        this->_nStep = std::max(1, std::min(nStep, DoubleSarsaRLConstants::MaxNStep));
+        auto window = static_cast<size_t>(this->_nStep);
+        if (this->_previousActions.size() > window) {
+            this->_previousActions.erase(this->_previousActions.begin(),
+                                         this->_previousActions.end() - window);
+        }
+        if (this->_rewardCache.size() > window) {
+            this->_rewardCache.erase(this->_rewardCache.begin(), this->_rewardCache.end() - window);
+        }
     }
 
     /**
@@ -69,12 +140,15 @@ namespace fastbotx {
      * Saves reuse model and cleans up resources.
      */
     DoubleSarsaAgent::~DoubleSarsaAgent() {
-        BLOG("Double SARSA: Destructor called, saving model (reuse entries=%zu, Q1 entries=%zu, Q2 entries=%zu)", 
-             this->_reuseModel.size(), this->_reuseQValue1.size(), this->_reuseQValue2.size());
+        BLOG("Double SARSA: Destructor called, saving model (overlay entries=%zu, Q entries=%zu)", 
+             this->_reuseModel->size(), this->_qTable.size());
+        // Wake the storage thread so it exits now instead of at its next deadline
+        this->_storageScheduler->shutdown();
+        // No other thread uses the agent any more, so the current table can be published directly
+        this->publishQSnapshot();
         this->saveReuseModel(this->_modelSavePath);
-        this->_reuseModel.clear();
-        this->_reuseQValue1.clear();
-        this->_reuseQValue2.clear();
+        this->_reuseModel->releaseStorage(this);
+        this->_qTable.clear();
         BLOG("Double SARSA: Agent destructed, all resources cleaned up");
     }
 
@@ -157,6 +231,7 @@ namespace fastbotx {
      * @return Reward value for the latest executed action
      */
     double DoubleSarsaAgent::computeRewardOfLatestAction() {
+        FASTBOT_TRACE_FUNCTION();
         double rewardValue = 0.0;
         
         if (nullptr != this->_newState) {
@@ -172,7 +247,7 @@ namespace fastbotx {
             
             // Get set of visited activities (after reaching _newState)
             const GraphPtr &graphRef = modelPtr->getGraph();
-            auto visitedActivities = graphRef->getVisitedActivities();
+            const InternedStringSet &visitedActivities = graphRef->getVisitedActivityIds();
             
             // Get latest executed action (last in action history)
             if (auto lastSelectedAction = std::dynamic_pointer_cast<ActivityStateAction>(
@@ -218,8 +293,8 @@ namespace fastbotx {
         // Add reward value to cache
         this->_rewardCache.emplace_back(rewardValue);
         
-        // Ensure cache size doesn't exceed NStep
-        if (this->_rewardCache.size() > DoubleSarsaRLConstants::NStep) {
+        // Ensure cache size doesn't exceed the N-step window
+        if (this->_rewardCache.size() > static_cast<size_t>(this->_nStep)) {
             this->_rewardCache.erase(this->_rewardCache.begin());
         }
         
@@ -232,14 +307,9 @@ namespace fastbotx {
      * @param action Action pointer
      * @return Q1-value
      */
-    double DoubleSarsaAgent::getQ1Value(const ActionPtr &action) {
-        uintptr_t actionHash = action->hash();
-        std::lock_guard<std::mutex> reuseGuard(this->_reuseModelLock);
-        auto it = this->_reuseQValue1.find(actionHash);
-        if (it != this->_reuseQValue1.end()) {
-            return it->second;
-        }
-        return 0.0;  // Default Q-value
+    double DoubleSarsaAgent::getQ1Value(const ActionPtr &action) const {
+        // Performance: agent-thread-owned flat table, no lock (default Q-value is 0)
+        return this->_qTable.getQ1(action->hash());
     }
     
     /**
@@ -248,14 +318,8 @@ namespace fastbotx {
      * @param action Action pointer
      * @return Q2-value
      */
-    double DoubleSarsaAgent::getQ2Value(const ActionPtr &action) {
-        uintptr_t actionHash = action->hash();
-        std::lock_guard<std::mutex> reuseGuard(this->_reuseModelLock);
-        auto it = this->_reuseQValue2.find(actionHash);
-        if (it != this->_reuseQValue2.end()) {
-            return it->second;
-        }
-        return 0.0;  // Default Q-value
+    double DoubleSarsaAgent::getQ2Value(const ActionPtr &action) const {
+        return this->_qTable.getQ2(action->hash());
     }
     
     /**
@@ -269,7 +333,7 @@ namespace fastbotx {
      */
     double DoubleSarsaAgent::getQValue(const ActionPtr &action) {
         // Randomly choose Q1 or Q2
-        int choice = _uniformIntDist(_rng);  // 0 or 1
+        int choice = static_cast<int>(_rng.nextBelow(2));  // 0 or 1
         if (choice == 0) {
             return getQ1Value(action);
         } else {
@@ -284,9 +348,8 @@ namespace fastbotx {
      * @param qValue Q1-value
      */
     void DoubleSarsaAgent::setQ1Value(const ActionPtr &action, double qValue) {
-        uintptr_t actionHash = action->hash();
-        std::lock_guard<std::mutex> reuseGuard(this->_reuseModelLock);
-        this->_reuseQValue1[actionHash] = qValue;
+        this->_qTable.findOrInsert(action->hash()).q1 = qValue;
+        this->_qEpoch++;
     }
     
     /**
@@ -296,9 +359,36 @@ namespace fastbotx {
      * @param qValue Q2-value
      */
     void DoubleSarsaAgent::setQ2Value(const ActionPtr &action, double qValue) {
-        uintptr_t actionHash = action->hash();
-        std::lock_guard<std::mutex> reuseGuard(this->_reuseModelLock);
-        this->_reuseQValue2[actionHash] = qValue;
+        this->_qTable.findOrInsert(action->hash()).q2 = qValue;
+        this->_qEpoch++;
+    }
+
+    void DoubleSarsaAgent::publishQSnapshotIfRequested() {
+        if (!this->_qSnapshotRequested.load(std::memory_order_acquire)) {
+            return;
+        }
+        this->publishQSnapshot();
+        this->_qSnapshotRequested.store(false, std::memory_order_release);
+    }
+
+    void DoubleSarsaAgent::publishQSnapshot() {
+        if (std::atomic_load(&this->_qSnapshot) != nullptr && this->_qSnapshotEpoch == this->_qEpoch) {
+            return;
+        }
+        // One flat copy per request (every few minutes), instead of a lock on every Q access
+        std::shared_ptr<const DoubleQTable> snapshot = std::make_shared<const DoubleQTable>(this->_qTable);
+        std::atomic_store(&this->_qSnapshot, snapshot);
+        this->_qSnapshotEpoch = this->_qEpoch;
+    }
+
+    std::shared_ptr<const DoubleQTable> DoubleSarsaAgent::acquireQSnapshot() {
+        using namespace DoubleSarsaRLConstants;
+        this->_qSnapshotRequested.store(true, std::memory_order_release);
+        for (int waited = 0; waited < QSnapshotWaitMs &&
+                             this->_qSnapshotRequested.load(std::memory_order_acquire); waited += QSnapshotPollMs) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(QSnapshotPollMs));
+        }
+        return std::atomic_load(&this->_qSnapshot);
     }
 
     /**
@@ -323,8 +413,14 @@ namespace fastbotx {
      * - Uses the OTHER Q-function for bootstrapping to reduce overestimation bias
      * - Each action's update independently randomly selects Q1 or Q2
      * - This ensures Q1 and Q2 are updated in a balanced manner
+     * 
+     * Performance optimization:
+     * - All returns come from one backward pass (discounted reward tail and γ^k carried
+     *   between actions): O(N) instead of O(N²) for a window of N = getNStep() actions
+     * - _newAction's Q1/Q2 are read once as the bootstrap of every return in the window
      */
     void DoubleSarsaAgent::updateQValues() {
+        FASTBOT_TRACE_FUNCTION();
         using namespace DoubleSarsaRLConstants;
         
         // Validate array sizes match
@@ -346,6 +442,7 @@ namespace fastbotx {
         BDLOG("Double SARSA: Window size=%d, alpha=%.4f, gamma=%.4f, epsilon=%.4f", 
               windowSize, this->_alpha, DefaultGamma, this->_epsilon);
         
+#if FASTBOT_DEBUG_LOG
         // Log action history and rewards for debugging
         BDLOG("Double SARSA: Action history (from oldest to newest):");
         for (int idx = 0; idx < windowSize; idx++) {
@@ -353,113 +450,58 @@ namespace fastbotx {
             double reward = (idx < static_cast<int>(this->_rewardCache.size())) ? this->_rewardCache[idx] : 0.0;
             BDLOG("Double SARSA:   [%d] action_hash=0x%" PRIxPTR ", reward=%.4f", idx, actionHash, reward);
         }
+#endif
         
-        // Log _newAction (used for bootstrapping)
+        // Bootstrap values Q1/Q2(s_{t+n}, a_{t+n}) of _newAction: one probe for the whole window
+        double bootstrapQ1 = 0.0;
+        double bootstrapQ2 = 0.0;
         if (_newAction != nullptr) {
-            uintptr_t newActionHash = _newAction->hash();
-            double q1New = getQ1Value(_newAction);
-            double q2New = getQ2Value(_newAction);
+            const DoubleQTable::Entry *bootstrapEntry = this->_qTable.find(_newAction->hash());
+            bootstrapQ1 = bootstrapEntry ? bootstrapEntry->q1 : 0.0;
+            bootstrapQ2 = bootstrapEntry ? bootstrapEntry->q2 : 0.0;
             BDLOG("Double SARSA: Bootstrap action (_newAction): hash=0x%" PRIxPTR ", Q1=%.4f, Q2=%.4f", 
-                  newActionHash, q1New, q2New);
+                  _newAction->hash(), bootstrapQ1, bootstrapQ2);
         }
         
         // Counters for Q1 and Q2 updates
         int q1UpdateCount = 0;
         int q2UpdateCount = 0;
         
-        // Traverse action history from back to front (from latest to oldest)
-        // For EACH action, independently:
-        //   1. Randomly choose to update Q1 or Q2
-        //   2. Compute n-step return using the OTHER Q-function for bootstrapping
-        //   3. Update the chosen Q-function
-        // 
-        // Key: Each action independently selects Q1 or Q2, ensuring balanced updates
+        // One pass from the latest action to the oldest. For action i with k = windowSize - i:
+        //   G_i = R_i + γR_{i+1} + ... + γ^(k-1)R_{windowSize-1} + γ^k * Q_other(_newAction)
+        // The discounted reward tail and γ^k are carried over from i + 1:
+        //   tail_i = R_i + γ * tail_{i+1},  discount_i = γ * discount_{i+1}
+        // For EACH action, independently randomly choose to update Q1 or Q2, and bootstrap
+        // with the OTHER Q-function (Double SARSA key idea)
+        double rewardTail = 0.0;
+        double bootstrapDiscount = 1.0;
         for (int i = windowSize - 1; i >= 0; i--) {
-            // Safety check: ensure index is valid
-            if (i >= static_cast<int>(this->_rewardCache.size())) {
-                BLOGE("Double SARSA: Index %d out of bounds for reward cache (size %zu)", i, this->_rewardCache.size());
-                break;
-            }
-            
-            // For each action, independently randomly choose which Q-function to update
-            // This is the core of Double SARSA: each (s,a) pair independently selects Q1 or Q2
-            // This ensures Q1 and Q2 are updated in a balanced manner over time
-            int updateQ1 = _uniformIntDist(_rng);  // 0 = update Q1, 1 = update Q2
+            rewardTail = this->_rewardCache[i] + DefaultGamma * rewardTail;
+            bootstrapDiscount *= DefaultGamma;
             
-            // Get action hash for logging
-            uintptr_t actionHash = this->_previousActions[i]->hash();
+            int updateQ1 = static_cast<int>(_rng.nextBelow(2));  // 0 = update Q1, 1 = update Q2
+            double bootstrapQValue = (updateQ1 == 0) ? bootstrapQ2 : bootstrapQ1;
+            double nStepReturn = rewardTail + bootstrapDiscount * bootstrapQValue;
             
-            // Get current Q1 and Q2 values for this action (before update)
-            double currentQ1Value = getQ1Value(this->_previousActions[i]);
-            double currentQ2Value = getQ2Value(this->_previousActions[i]);
-            
-            // Compute n-step return for this action
-            // Start from _newAction's Q-value using the OTHER Q-function for bootstrapping
-            // This represents Q(s_{i+k}, a_{i+k}) in the n-step return formula
-            // where k is the number of steps from i+1 to the end of window
-            // 
-            // We need to compute: R_i + γR_{i+1} + ... + γ^(k-1)R_{i+k-1} + γ^k * Q_other(s_{i+k}, a_{i+k})
-            // The standard way (like ModelReusableAgent) is to accumulate from back to front
-            // But since each action uses a different Q-function for bootstrapping, we compute independently
-            double nStepReturn;
-            double bootstrapQValue;
+            // Current value of the chosen Q-function, one probe (earlier iterations may have
+            // updated the same action)
+            const ActionPtr &action = this->_previousActions[i];
+            DoubleQTable::Entry &entry = this->_qTable.findOrInsert(action->hash());
+            double &qValue = (updateQ1 == 0) ? entry.q1 : entry.q2;
+            double currentQValue = qValue;
+            double qUpdate = this->_alpha * (nStepReturn - currentQValue);
+            qValue = currentQValue + qUpdate;
             if (updateQ1 == 0) {
-                // Updating Q1, use Q2 for bootstrapping (Double SARSA key idea)
-                bootstrapQValue = getQ2Value(_newAction);
-                nStepReturn = bootstrapQValue;
                 q1UpdateCount++;
             } else {
-                // Updating Q2, use Q1 for bootstrapping (Double SARSA key idea)
-                bootstrapQValue = getQ1Value(_newAction);
-                nStepReturn = bootstrapQValue;
                 q2UpdateCount++;
             }
             
-            BDLOG("Double SARSA: Action[%d] hash=0x%" PRIxPTR ": updating %s (Q1=%.4f, Q2=%.4f), bootstrap using Q_%s=%.4f", 
-                  i, actionHash, (updateQ1 == 0 ? "Q1" : "Q2"), currentQ1Value, currentQ2Value, 
-                  (updateQ1 == 0 ? "2" : "1"), bootstrapQValue);
-            
-            // Accumulate n-step return from action i to end of window
-            // Build: R_i + γR_{i+1} + ... + γ^(k-1)R_{i+k-1} + γ^k * Q_other(s_{i+k}, a_{i+k})
-            // We traverse from the end (windowSize-1) back to i, accumulating rewards
-            // This matches the standard N-step SARSA accumulation pattern
-            // For action i, we need rewards from i to windowSize-1, then bootstrapping value
-            for (int j = windowSize - 1; j >= i; j--) {
-                if (j < static_cast<int>(this->_rewardCache.size())) {
-                    // Accumulate: R_j + γ * (future return)
-                    // At each step j (from back to front), we add reward R_j and multiply by gamma
-                    // This builds: R_j + γ * (R_{j+1} + γ * (R_{j+2} + ... + γ^k * Q_other))
-                    double prevReturn = nStepReturn;
-                    nStepReturn = this->_rewardCache[j] + DefaultGamma * nStepReturn;
-                    BDLOG("Double SARSA: Action[%d] step[%d] reward=%.4f, return: %.4f -> %.4f", 
-                          i, j, this->_rewardCache[j], prevReturn, nStepReturn);
-                }
-            }
-            
-            // Get current Q-value (from the Q-function being updated)
-            double currentQValue = (updateQ1 == 0) ? currentQ1Value : currentQ2Value;
-            
-            // Update Q-value for this action using n-step return
-            // Update the chosen Q-function (Q1 or Q2)
-            // The bootstrapping used the OTHER Q-function (Double SARSA key idea)
-            // This reduces overestimation bias by decorrelating action selection from value estimation
-            double qUpdate = this->_alpha * (nStepReturn - currentQValue);
-            double newQValue = currentQValue + qUpdate;
-            if (updateQ1 == 0) {
-                setQ1Value(this->_previousActions[i], newQValue);
-            } else {
-                setQ2Value(this->_previousActions[i], newQValue);
-            }
-            
-            // Get updated Q values for logging
-            double updatedQ1Value = getQ1Value(this->_previousActions[i]);
-            double updatedQ2Value = getQ2Value(this->_previousActions[i]);
-            
-            BDLOG("Double SARSA: Action[%d] hash=0x%" PRIxPTR " %s updated: Q_old=%.4f, nStepReturn=%.4f, alpha=%.4f, delta=%.4f, Q_new=%.4f", 
-                  i, actionHash, (updateQ1 == 0 ? "Q1" : "Q2"), currentQValue, nStepReturn, this->_alpha, qUpdate, newQValue);
-            BDLOG("Double SARSA: Action[%d] hash=0x%" PRIxPTR " after update: Q1=%.4f, Q2=%.4f", 
-                  i, actionHash, updatedQ1Value, updatedQ2Value);
+            BDLOG("Double SARSA: Action[%d] hash=0x%" PRIxPTR " %s updated: Q_old=%.4f, nStepReturn=%.4f, alpha=%.4f, delta=%.4f, Q_new=%.4f (Q1=%.4f, Q2=%.4f)", 
+                  i, action->hash(), (updateQ1 == 0 ? "Q1" : "Q2"), currentQValue, nStepReturn,
+                  this->_alpha, qUpdate, qValue, entry.q1, entry.q2);
         }
+        this->_qEpoch++;
         
         // Log update statistics
         BDLOG("Double SARSA: ===== Q-value update completed =====");
@@ -481,6 +523,7 @@ namespace fastbotx {
      * 4. Add new action to action history cache
      */
     void DoubleSarsaAgent::updateStrategy() {
+        FASTBOT_TRACE_FUNCTION();
         // If no new action, return directly
         if (nullptr == this->_newAction) {
             BDLOG("Double SARSA: updateStrategy called but _newAction is null");
@@ -507,14 +550,18 @@ namespace fastbotx {
             BDLOG("Double SARSA: Action history is empty, skipping Q-value update");
         }
         
+        // Q-values of this step are final: hand a copy to the storage thread if it asked
+        this->publishQSnapshotIfRequested();
+
         // 4. Add new action to end of action history cache
+        this->_qTable.findOrInsert(this->_newAction->hash()).visits++;
+        this->_qEpoch++;
         this->_previousActions.emplace_back(this->_newAction);
         BDLOG("Double SARSA: Added new action to history, history size=%zu", this->_previousActions.size());
         
-        // Ensure cache size doesn't exceed NStep
-        if (this->_previousActions.size() > DoubleSarsaRLConstants::NStep) {
-            BDLOG("Double SARSA: Action history exceeds NStep=%d, removing oldest action", 
-                  DoubleSarsaRLConstants::NStep);
+        // Ensure cache size doesn't exceed the N-step window
+        if (this->_previousActions.size() > static_cast<size_t>(this->_nStep)) {
+            BDLOG("Double SARSA: Action history exceeds NStep=%d, removing oldest action", this->_nStep);
             this->_previousActions.erase(this->_previousActions.begin());
         }
     }
@@ -526,33 +573,17 @@ namespace fastbotx {
      * to total visit counts among activities that this action can reach.
      */
     double DoubleSarsaAgent::probabilityOfVisitingNewActivities(const ActivityStateActionPtr &action,
-                                                                 const stringPtrSet &visitedActivities) const {
+                                                                 const InternedStringSet &visitedActivities) const {
         double value = 0.0;
         int total = 0;
         int unvisited = 0;
         
-        // Lock to protect concurrent access to reuse model
-        std::lock_guard<std::mutex> reuseGuard(this->_reuseModelLock);
-        
-        // Find action in reuse model (by hash value)
-        auto actionMapIterator = this->_reuseModel.find(action->hash());
-        
-        if (actionMapIterator != this->_reuseModel.end()) {
-            // Iterate through all activities this action can reach and their visit counts
-            for (const auto &activityCountMapIterator: actionMapIterator->second) {
-                total += activityCountMapIterator.second;
-                stringPtr activity = activityCountMapIterator.first;
-                
-                // Check if this activity is unvisited
-                if (visitedActivities.count(activity) == 0) {
-                    unvisited += activityCountMapIterator.second;
-                }
-            }
+        // The overlay supersedes the mapped file; other devices may be counting meanwhile
+        this->_reuseModel->countVisits(action->hash(), visitedActivities, total, unvisited);
             
-            // Calculate probability: unvisited activity visit counts / total visit counts
-            if (total > 0 && unvisited > 0) {
-                value = static_cast<double>(unvisited) / total;
-            }
+        // Calculate probability: unvisited activity visit counts / total visit counts
+        if (total > 0 && unvisited > 0) {
+            value = static_cast<double>(unvisited) / total;
         }
         
         return value;
@@ -562,8 +593,7 @@ namespace fastbotx {
      * @brief Check if action is in reuse model
      */
     bool DoubleSarsaAgent::isActionInReuseModel(uintptr_t actionHash) const {
-        std::lock_guard<std::mutex> reuseGuard(this->_reuseModelLock);
-        return this->_reuseModel.count(actionHash) > 0;
+        return this->_reuseModel->contains(actionHash);
     }
 
     /**
@@ -572,7 +602,7 @@ namespace fastbotx {
      * Evaluates expected value of reaching unvisited activities after executing actions from this state.
      */
     double DoubleSarsaAgent::getStateActionExpectationValue(const StatePtr &state,
-                                                            const stringPtrSet &visitedActivities) const {
+                                                            const InternedStringSet &visitedActivities) const {
         double value = 0.0;
         
         // Iterate through all actions in state
@@ -626,28 +656,11 @@ namespace fastbotx {
                 return;
             }
             
-            // Lock to protect concurrent access to reuse model
-            {
-                std::lock_guard<std::mutex> reuseGuard(this->_reuseModelLock);
-                
-                // Find action in reuse model
-                auto iter = this->_reuseModel.find(hash);
-                
-                if (iter == this->_reuseModel.end()) {
-                    // Action not in reuse model, create new entry
-                    BDLOG("Double SARSA: Adding new action %s (hash=%" PRIu64 ") to reuse model, activity=%s", 
-                          modelAction->getId().c_str(), hash, activity->c_str());
-                    ReuseEntryM entryMap;
-                    entryMap.emplace(activity, 1);
-                    this->_reuseModel[hash] = entryMap;
-                } else {
-                    // Action in reuse model, increment this activity's visit count
-                    int oldCount = iter->second[activity];
-                    iter->second[activity] += 1;
-                    BDLOG("Double SARSA: Updating reuse model - action %s (hash=%" PRIu64 "), activity=%s, count: %d -> %d", 
-                          modelAction->getId().c_str(), hash, activity->c_str(), oldCount, iter->second[activity]);
-                }
-            }
+            // Counted in the shared model, so the agents of other devices learn from it at once;
+            // the storage owner's scheduler hears of new (action, activity) pairs
+            int count = this->_reuseModel->addVisit(hash, InternedString::intern(*activity));
+            BDLOG("Double SARSA: Updating reuse model - action %s (hash=%" PRIu64 "), activity=%s, count: %d",
+                  modelAction->getId().c_str(), hash, activity->c_str(), count);
         }
     }
 
@@ -663,7 +676,7 @@ namespace fastbotx {
             BDLOG("Double SARSA: Try to select the max value action");
             
             // Randomly choose Q1 or Q2
-            int choice = _uniformIntDist(_rng);  // 0 or 1
+            int choice = static_cast<int>(_rng.nextBelow(2));  // 0 or 1
             BDLOG("Double SARSA: Epsilon-greedy greedy selection using %s", (choice == 0 ? "Q1" : "Q2"));
             
             // Find action with maximum Q-value from chosen Q-function
@@ -679,9 +692,10 @@ namespace fastbotx {
                     continue;
                 }
                 
-                // Get both Q1 and Q2 values for comparison
-                double q1Value = nonConstThis->getQ1Value(action);
-                double q2Value = nonConstThis->getQ2Value(action);
+                // Get both Q1 and Q2 values for comparison (one probe)
+                const DoubleQTable::Entry *entry = this->_qTable.find(action->hash());
+                double q1Value = entry ? entry->q1 : 0.0;
+                double q2Value = entry ? entry->q2 : 0.0;
                 double qValue = (choice == 0) ? q1Value : q2Value;
                 
                 actionCount++;
@@ -713,14 +727,14 @@ namespace fastbotx {
         
         // Use random strategy: randomly select action
         BDLOG("Double SARSA: Try to randomly select a value action");
-        return this->_newState->randomPickAction(enableValidValuePriorityFilter);
+        return this->_newState->randomPickAction(enableValidValuePriorityFilter, this->_rng);
     }
 
     /**
      * @brief Determine whether to use greedy strategy
      */
     bool DoubleSarsaAgent::eGreedy() const {
-        double randomValue = _uniformDist(_rng);
+        double randomValue = _rng.nextDouble();
         bool useGreedy = randomValue >= this->_epsilon;
         BDLOG("Double SARSA: eGreedy decision - random=%.4f, epsilon=%.4f, useGreedy=%s", 
               randomValue, this->_epsilon, (useGreedy ? "true" : "false"));
@@ -731,90 +745,35 @@ namespace fastbotx {
      * @brief Select unexecuted action not in reuse model
      */
     ActionPtr DoubleSarsaAgent::selectUnperformedActionNotInReuseModel() const {
-        std::vector<ActionPtr> actionsNotInModel;
-        int totalActions = 0;
-        int modelActions = 0;
-        int inReuseModel = 0;
-        int visitedActions = 0;
-        
-        for (const auto &action: this->_newState->getActions()) {
-            totalActions++;
-            
-            if (!action->isModelAct()) {
-                continue;  // Skip non-model actions
-            }
-            
-            modelActions++;
-            uintptr_t actionHash = action->hash();
-            bool inModel = this->isActionInReuseModel(actionHash);
-            bool visited = action->getVisitedCount() > 0;
-            
-            if (inModel) {
-                inReuseModel++;
-            }
-            if (visited) {
-                visitedActions++;
-            }
-            
-            // Match condition: model action, not in reuse model, and not visited
-            bool matched = !inModel && !visited;
-            
-            if (matched) {
-                actionsNotInModel.emplace_back(action);
-            }
-        }
-        
-        if (actionsNotInModel.empty()) {
-            BDLOG("Double SARSA: Cannot find unexecuted action not in reuse model - total actions=%d, model actions=%d, in reuse model=%d, visited=%d (this is normal, will try next strategy)", 
-                   totalActions, modelActions, inReuseModel, visitedActions);
-            return nullptr;
-        }
-        
-        // Build cumulative weight array
-        std::vector<int> cumulativeWeights;
-        int totalWeight = 0;
-        for (const auto &action: actionsNotInModel) {
-            totalWeight += action->getPriority();
-            cumulativeWeights.push_back(totalWeight);
-        }
-        
-        if (totalWeight <= 0) {
-            BDLOGE("Double SARSA: total weights is 0");
-            return nullptr;
-        }
-        
-        // Use binary search to select action
-        int randI = randomInt(0, totalWeight);
-        auto it = std::lower_bound(cumulativeWeights.begin(), 
-                                  cumulativeWeights.end(), randI);
-        size_t index = std::distance(cumulativeWeights.begin(), it);
-        
-        if (index < actionsNotInModel.size()) {
-            return actionsNotInModel[index];
+        // Weighted by priority from the state's sampler; actions found in the reuse
+        // model are dropped from it for good (reuse entries are never removed)
+        ActivityStateActionPtr action = this->_newState->randomPickUnknownModelAction(
+                [this](const ActivityStateActionPtr &candidate) {
+                    return this->isActionInReuseModel(candidate->hash());
+                }, this->_rng);
+        if (nullptr == action) {
+            BDLOG("Double SARSA: Cannot find unexecuted action not in reuse model - %zu actions (this is normal, will try next strategy)",
+                  this->_newState->getActions().size());
         }
-        
-        BDLOGE("Double SARSA: rand a null action");
-        return nullptr;
+        return action;
     }
 
     /**
      * @brief Select unvisited unexecuted action in reuse model
      */
     ActionPtr DoubleSarsaAgent::selectUnperformedActionInReuseModel() const {
-        float maxValue = -MAXFLOAT;
-        ActionPtr nextAction = nullptr;
-        
         // Cache visitedActivities
         auto modelPointer = this->_model.lock();
-        stringPtrSet visitedActivities;
-        if (modelPointer) {
-            const GraphPtr &graphRef = modelPointer->getGraph();
-            visitedActivities = graphRef->getVisitedActivities();
-        } else {
+        if (!modelPointer) {
             return nullptr;
         }
+        const GraphPtr &graphRef = modelPointer->getGraph();
+        const InternedStringSet &visitedActivities = graphRef->getVisitedActivityIds();
         
-        // Use humble-gumbel distribution to influence sampling
+        // Batch the quality values of unvisited reuse-model actions, then sample
+        // softmax(quality) once (same distribution as the humble-gumbel argmax)
+        ActivityStateActionPtrVec candidates;
+        this->_scoreBatch.clear();
         for (const auto &action: this->_newState->targetActions()) {
             uintptr_t actionHash = action->hash();
             
@@ -830,34 +789,21 @@ namespace fastbotx {
                         visitedActivities));
                 
                 if (qualityValue > DoubleSarsaRLConstants::QualityValueThreshold) {
-                    qualityValue = DoubleSarsaRLConstants::QualityValueMultiplier * qualityValue;
-                    
-                    auto uniform = _uniformFloatDist(_rng);
-                    
-                    if (uniform < std::numeric_limits<float>::min()) {
-                        uniform = std::numeric_limits<float>::min();
-                    }
-                    
-                    qualityValue -= log(-log(uniform));
-
-                    if (qualityValue > maxValue) {
-                        maxValue = qualityValue;
-                        nextAction = action;
-                    }
+                    this->_scoreBatch.push(DoubleSarsaRLConstants::QualityValueMultiplier * qualityValue);
+                    candidates.push_back(action);
                 }
             }
         }
-        
-        return nextAction;
+        if (candidates.empty()) {
+            return nullptr;
+        }
+        return candidates[this->_scoreBatch.sampleSoftmax(_rng.nextFloat())];
     }
 
     /**
      * @brief Select action based on Q-value (using randomly chosen Q1 or Q2)
      */
     ActionPtr DoubleSarsaAgent::selectActionByQValue() {
-        ActionPtr returnAction = nullptr;
-        float maxQ = -MAXFLOAT;
-        
         // Get model pointer and set of visited activities
         auto modelPtr = this->_model.lock();
         if (!modelPtr) {
@@ -866,25 +812,27 @@ namespace fastbotx {
         }
         
         const GraphPtr &graphRef = modelPtr->getGraph();
-        auto visitedActivities = graphRef->getVisitedActivities();
+        const InternedStringSet &visitedActivities = graphRef->getVisitedActivityIds();
         
         // Randomly choose Q1 or Q2 for this selection
-        int choice = _uniformIntDist(_rng);  // 0 or 1
+        int choice = static_cast<int>(_rng.nextBelow(2));  // 0 or 1
         BDLOG("Double SARSA: selectActionByQValue using %s", (choice == 0 ? "Q1" : "Q2"));
         
-        // Iterate through all actions, select action with maximum adjusted Q-value
-        int actionIndex = 0;
-        for (const auto &action: this->_newState->getActions()) {
+        // Performance optimization: gather the normalized Q-values of all actions into one
+        // contiguous batch and sample softmax(qv / EntropyAlpha) once (the distribution
+        // the per-action Gumbel-max draw samples from), instead of two logs and one
+        // uniform draw per action
+        const ActivityStateActionPtrVec &actions = this->_newState->getActions();
+        this->_scoreBatch.clear();
+        this->_scoreBatch.reserve(actions.size());
+        for (const auto &action: actions) {
             double qv = 0.0;
             uintptr_t actionHash = action->hash();
             
             // If action unvisited
             if (action->getVisitedCount() <= 0) {
                 if (this->isActionInReuseModel(actionHash)) {
-                    double prob = this->probabilityOfVisitingNewActivities(action, visitedActivities);
-                    qv += prob;
-                    BDLOG("Double SARSA: Action[%d] %s unvisited, prob=%.4f, qv=%.4f", 
-                          actionIndex, action->toString().c_str(), prob, qv);
+                    qv += this->probabilityOfVisitingNewActivities(action, visitedActivities);
                 } else {
                     // Not in reuse model (new action), directly return
                     BDLOG("Double SARSA: selectActionByQValue returning new action: %s", action->toString().c_str());
@@ -892,55 +840,23 @@ namespace fastbotx {
                 }
             }
             
-            // Add action's Q-value (from chosen Q-function)
-            // Get both Q1 and Q2 for comparison
-            double q1Value = getQ1Value(action);
-            double q2Value = getQ2Value(action);
-            double baseQValue = (choice == 0) ? q1Value : q2Value;
-            qv += baseQValue;
+            // Add action's Q-value (from chosen Q-function, one probe)
+            const DoubleQTable::Entry *entry = this->_qTable.find(actionHash);
+            qv += entry ? (choice == 0 ? entry->q1 : entry->q2) : 0.0;
             
             // Divide by EntropyAlpha for normalization
-            double normalizedQv = qv / DoubleSarsaRLConstants::EntropyAlpha;
-            
-            // Use member random number generator
-            float uniform = _uniformFloatDist(_rng);
-            
-            if (uniform < std::numeric_limits<float>::min()) {
-                uniform = std::numeric_limits<float>::min();
-            }
-            
-            // Add humble-gumbel distribution random term
-            double gumbelTerm = log(-log(uniform));
-            double adjustedQv = normalizedQv - gumbelTerm;
-            
-            // actionHash already defined above, reuse it
-            // Suppress format warning for PRIxPTR macro - the macro expands correctly at runtime
-            #pragma GCC diagnostic push
-            #pragma GCC diagnostic ignored "-Wformat"
-            BDLOG("Double SARSA: Action[%d] hash=0x%" PRIxPTR " %s: Q1=%.4f, Q2=%.4f, using %s=%.4f, Q_base=%.4f, Q_norm=%.4f, gumbel=%.4f, Q_adj=%.4f (max=%.4f)", 
-                  actionIndex, actionHash, action->toString().c_str(), q1Value, q2Value, 
-                  (choice == 0 ? "Q1" : "Q2"), baseQValue, normalizedQv, gumbelTerm, adjustedQv, static_cast<double>(maxQ));
-            #pragma GCC diagnostic pop
-            
-            // Select action with maximum adjusted Q-value
-            if (adjustedQv > maxQ) {
-                maxQ = static_cast<float>(adjustedQv);
-                returnAction = action;
-                BDLOG("Double SARSA: New best action: %s with adjusted Q=%.4f", 
-                      action->toString().c_str(), adjustedQv);
-            }
-            
-            actionIndex++;
+            this->_scoreBatch.push(static_cast<float>(qv / DoubleSarsaRLConstants::EntropyAlpha));
         }
-        
-        if (returnAction != nullptr) {
-            uintptr_t returnActionHash = returnAction->hash();
-            double returnQ1 = getQ1Value(returnAction);
-            double returnQ2 = getQ2Value(returnAction);
-            BDLOG("Double SARSA: selectActionByQValue selected: hash=0x%" PRIxPTR " %s with max adjusted Q=%.4f from %s (Q1=%.4f, Q2=%.4f)", 
-                  returnActionHash, returnAction->toString().c_str(), maxQ, (choice == 0 ? "Q1" : "Q2"), returnQ1, returnQ2);
+        if (this->_scoreBatch.empty()) {
+            return nullptr;
         }
         
+        size_t picked = this->_scoreBatch.sampleSoftmax(_rng.nextFloat());
+        ActivityStateActionPtr returnAction = actions[picked];
+        BDLOG("Double SARSA: selectActionByQValue selected: hash=0x%" PRIxPTR " %s with score %.4f of %zu from %s (Q1=%.4f, Q2=%.4f)", 
+              returnAction->hash(), returnAction->toString().c_str(), this->_scoreBatch.scores()[picked],
+              actions.size(), (choice == 0 ? "Q1" : "Q2"), getQ1Value(returnAction), getQ2Value(returnAction));
+        
         return returnAction;
     }
 
@@ -948,6 +864,7 @@ namespace fastbotx {
      * @brief Select new action (implements AbstractAgent's pure virtual function)
      */
     ActionPtr DoubleSarsaAgent::selectNewAction() {
+        FASTBOT_TRACE_FUNCTION();
         ActionPtr action = nullptr;
         
         // Strategy 1: Select unexecuted actions not in reuse model
@@ -965,7 +882,7 @@ namespace fastbotx {
         }
 
         // Strategy 3: Select unvisited actions
-        action = this->_newState->randomPickUnvisitedAction();
+        action = this->_newState->randomPickUnvisitedAction(this->_rng);
         if (nullptr != action) {
             BLOG("Double SARSA: select action in unvisited action - %s", action->toString().c_str());
             return action;
@@ -994,14 +911,44 @@ namespace fastbotx {
      * @brief Adjust action priorities (overrides parent class method)
      */
     void DoubleSarsaAgent::adjustActions() {
+        FASTBOT_TRACE_FUNCTION();
         AbstractAgent::adjustActions();
     }
 
+    ActionPtr DoubleSarsaAgent::speculateNewAction(const StatePtr &predicted) {
+        this->_rngBeforeSpeculation = this->_rng;
+        this->_speculationPending = true;
+        return AbstractAgent::speculateNewAction(predicted);
+    }
+
+    void DoubleSarsaAgent::adoptSpeculativeAction(const ActionPtr &action) {
+        this->_speculationPending = false;
+        AbstractAgent::adoptSpeculativeAction(action);
+    }
+
+    void DoubleSarsaAgent::discardSpeculativeAction() {
+        if (this->_speculationPending) {
+            this->_rng = this->_rngBeforeSpeculation;
+            this->_speculationPending = false;
+        }
+    }
+
+    void DoubleSarsaAgent::prefetchReuseModel(const std::string &packageName) {
+        MappedReuseModel::prefetch(std::string(ModelStorageConstants::StoragePrefix) + packageName +
+                                   ModelStorageConstants::ModelFileExtension,
+                                   DoubleSarsaRLConstants::MaxModelFileSize);
+    }
+
     /**
      * @brief Load reuse model
      * 
-     * Loads previously saved reuse model from file system.
-     * Note: Q-values (Q1 and Q2) are not loaded from file, they start from 0.
+     * Loads previously saved reuse model from file system, together with the Q1/Q2
+     * values and visit counts of files written with QValueFormatVersion or later.
+     * Older files load as before and leave the Q-values at 0. Then replays the
+     * journal of changes saved after the file (see persistReuseModel).
+     * 
+     * The reuse entries go into the SharedReuseModel of the file. Only the agent that
+     * owns it loads them; an agent joining later reads just the Q-values.
      */
     void DoubleSarsaAgent::loadReuseModel(const std::string &packageName) {
         // Build model file path
@@ -1018,142 +965,312 @@ namespace fastbotx {
         }
         
         BLOG("Double SARSA: begin load model: %s", this->_modelSavePath.c_str());
+        std::lock_guard<std::mutex> storageGuard(this->_storageLock);
 
-        // Open model file
-        std::ifstream modelFile(modelFilePath, std::ios::binary | std::ios::in);
-        if (!modelFile.is_open()) {
-            BLOGE("Double SARSA: Failed to open model file: %s", modelFilePath.c_str());
-            return;
+        // Agents of other devices testing the same package share one reuse model
+        SharedReuseModelPtr sharedModel = SharedReuseModel::forFile(modelFilePath);
+        if (sharedModel != this->_reuseModel) {
+            this->_reuseModel->releaseStorage(this);
+            this->_reuseModel = sharedModel;
+            this->_ownsReuseStorage = sharedModel->claimStorage(this, this->_storageScheduler);
+        }
+        bool loadReuseEntries = this->_ownsReuseStorage;
+        if (!loadReuseEntries) {
+            BLOG("Double SARSA: reuse model %s is shared with another agent, loading Q-values only",
+                 modelFilePath.c_str());
         }
 
-        // Get file size
-        std::filebuf *fileBuffer = modelFile.rdbuf();
-        std::size_t filesize = fileBuffer->pubseekoff(0, modelFile.end, modelFile.in);
-        fileBuffer->pubseekpos(0, modelFile.in);
-        
-        // Check if file size is valid
-        if (filesize <= 0 || filesize > DoubleSarsaRLConstants::MaxModelFileSize) {
-            BLOGE("Double SARSA: Invalid model file size: %zu", filesize);
+        // Performance optimization: map the file and query it in place instead of copying
+        // every entry into std::map (init time and peak memory no longer grow with the model)
+        MappedReuseModelPtr mapped = MappedReuseModel::open(modelFilePath, DoubleSarsaRLConstants::MaxModelFileSize);
+        if (!mapped) {
+            BLOGE("Double SARSA: Failed to load model file: %s", modelFilePath.c_str());
+            // A run that never compacted leaves only a journal (of checkpoint 0)
+            this->_checkpoint = 0;
+            this->_fullModelBytes = 0;
+            this->replayJournal(journalPathOf(modelFilePath));
+            this->_qEpoch++;
+            this->publishQSnapshot();
+            this->_persistedQ = std::atomic_load(&this->_qSnapshot);
             return;
         }
-        
-        // Read file content
-        std::unique_ptr<char[]> modelFileData(new char[filesize]);
-        std::streamsize bytesRead = fileBuffer->sgetn(modelFileData.get(), static_cast<int>(filesize));
-        
-        if (bytesRead != static_cast<std::streamsize>(filesize)) {
-            BLOGE("Double SARSA: Failed to read complete model file: read %lld bytes, expected %zu bytes", 
-                  static_cast<long long>(bytesRead), filesize);
-            return;
+
+        // Clear existing reuse model
+        if (loadReuseEntries) {
+            this->_reuseModel->reset();
         }
+        this->_storageOverlay.clear();
+        this->_unsavedActions.clear();
+        this->_qTable.clear();
+        this->_qEpoch++;
+        this->_checkpoint = mapped->checkpoint();
+        this->_fullModelBytes = mapped->byteSize();
+
+        bool hasQValues = mapped->version() >= ModelStorageConstants::QValueFormatVersion;
+        // Binary search needs sorted keys; other files are copied into memory as before
+        bool queryInPlace = mapped->sorted();
         
-        // Verify buffer before deserializing (security: prevent OOB/malformed data)
-        flatbuffers::Verifier verifier(reinterpret_cast<const uint8_t*>(modelFileData.get()), filesize);
-        if (!VerifyReuseModelBuffer(verifier)) {
-            BLOGE("Double SARSA: Invalid or corrupted model buffer");
-            return;
-        }
-        auto reuseFBModel = GetReuseModel(modelFileData.get());
-        if (!reuseFBModel) {
-            BLOGE("Double SARSA: GetReuseModel returned null");
-            return;
+        // Iterate through all reuse entries: restore Q-values, and copy targets only if unsorted
+        mapped->forEachEntry([&](const ReuseEntryView &reuseEntry) {
+            uint64_t actionHash = reuseEntry.action;
+
+            // Warm start: restore the learned values of this action
+            if (hasQValues && (reuseEntry.q1 != 0.0 || reuseEntry.q2 != 0.0 || reuseEntry.visits != 0)) {
+                DoubleQTable::Entry &qEntry = this->_qTable.findOrInsert(actionHash);
+                qEntry.q1 = reuseEntry.q1;
+                qEntry.q2 = reuseEntry.q2;
+                qEntry.visits = reuseEntry.visits;
+            }
+            if (queryInPlace || !loadReuseEntries) {
+                return;
+            }
+            
+            // If entry not empty, add to reuse model (entries holding only Q-values have no targets)
+            ReuseEntryM entryPtr = SharedReuseModel::readTargets(*mapped, reuseEntry);
+            if (!entryPtr.empty()) {
+                this->_storageOverlay.emplace(actionHash, entryPtr);
+                this->_reuseModel->putEntry(actionHash, entryPtr);
+            }
+        });
+        if (queryInPlace && loadReuseEntries) {
+            this->_reuseModel->setBase(mapped);
         }
+        this->replayJournal(journalPathOf(modelFilePath));
+        this->_qEpoch++;
+        // Loading happens before the first step; make the loaded values visible to saves at once
+        this->publishQSnapshot();
+        // Everything loaded is already on disk
+        this->_persistedQ = std::atomic_load(&this->_qSnapshot);
+        
+        BLOG("Double SARSA: loaded %s model (version %u, checkpoint %" PRIu64 ", %s) contains %zu entries, Q entries=%zu",
+             mapped->compact() ? "compact" : "FlatBuffers", mapped->version(), this->_checkpoint,
+             queryInPlace ? "mapped" : "copied", mapped->size(), this->_qTable.size());
+    }
 
-        // Clear existing reuse model
-        {
-            std::lock_guard<std::mutex> reuseGuard(this->_reuseModelLock);
-            this->_reuseModel.clear();
-            this->_reuseQValue1.clear();
-            this->_reuseQValue2.clear();
+    std::string DoubleSarsaAgent::journalPathOf(const std::string &modelFilepath) {
+        return modelFilepath + ModelStorageConstants::JournalFileExtension;
+    }
+
+    void DoubleSarsaAgent::replayJournal(const std::string &journalPath) {
+        this->_journalBytes = 0;
+        std::ifstream journalFile(journalPath, std::ios::binary | std::ios::ate);
+        if (!journalFile.is_open()) {
+            return;  // Nothing saved since the last compaction
         }
-        
-        // Get model data pointer
-        auto reusedModelDataPtr = reuseFBModel->model();
-        if (!reusedModelDataPtr) {
-            BLOG("Double SARSA: model data is null");
+        std::streamoff fileSize = journalFile.tellg();
+        if (fileSize <= 0 || static_cast<size_t>(fileSize) > DoubleSarsaRLConstants::MaxModelFileSize) {
+            BLOGE("Double SARSA: ignoring journal %s of size %lld", journalPath.c_str(), static_cast<long long>(fileSize));
+            journalFile.close();
+            std::remove(journalPath.c_str());
             return;
         }
-        
-        // Iterate through all reuse entries, load to memory
-        for (flatbuffers::uoffset_t entryIndex = 0; entryIndex < reusedModelDataPtr->size(); entryIndex++) {
-            auto reuseEntryInReuseModel = reusedModelDataPtr->Get(entryIndex);
-            uint64_t actionHash = reuseEntryInReuseModel->action();
-            auto activityEntry = reuseEntryInReuseModel->targets();
-            
-            // Build activity mapping
-            ReuseEntryM entryPtr;
-            for (flatbuffers::uoffset_t targetIndex = 0; targetIndex < activityEntry->size(); targetIndex++) {
-                auto targetEntry = activityEntry->Get(targetIndex);
-                BDLOG("Double SARSA: load model hash: %" PRIu64 " %s %d", actionHash,
-                      targetEntry->activity()->str().c_str(), static_cast<int>(targetEntry->times()));
-                
-                entryPtr.emplace(
-                        std::make_shared<std::string>(targetEntry->activity()->str()),
-                        static_cast<int>(targetEntry->times()));
+        std::vector<uint8_t> journal(static_cast<size_t>(fileSize));
+        journalFile.seekg(0);
+        journalFile.read(reinterpret_cast<char *>(journal.data()), fileSize);
+        journalFile.close();
+
+        size_t offset = 0;
+        size_t appliedRecords = 0;
+        size_t staleRecords = 0;
+        while (journal.size() - offset >= sizeof(flatbuffers::uoffset_t)) {
+            size_t recordSize = sizeof(flatbuffers::uoffset_t) +
+                                flatbuffers::ReadScalar<flatbuffers::uoffset_t>(journal.data() + offset);
+            if (recordSize > journal.size() - offset) {
+                break;  // Truncated by a crash while appending
             }
-            
-            // If entry not empty, add to reuse model
-            if (!entryPtr.empty()) {
-                std::lock_guard<std::mutex> reuseGuard(this->_reuseModelLock);
-                this->_reuseModel.emplace(actionHash, entryPtr);
-                // Note: Q-values start from 0, not loaded from file
+            flatbuffers::Verifier verifier(journal.data() + offset, recordSize);
+            if (!VerifySizePrefixedReuseModelBuffer(verifier)) {
+                break;
+            }
+            const ReuseModel *record = GetSizePrefixedReuseModel(journal.data() + offset);
+            offset += recordSize;
+            // Written before the full model was last compacted, which already contains it
+            if (record->checkpoint() != this->_checkpoint) {
+                staleRecords++;
+                continue;
+            }
+            const auto *entries = record->model();
+            bool hasQValues = record->version() >= ModelStorageConstants::QValueFormatVersion;
+            for (flatbuffers::uoffset_t i = 0; entries && i < entries->size(); i++) {
+                const ReuseEntry *entry = entries->Get(i);
+                // Absent targets: only the Q-values of the action changed
+                if (entry->targets() && this->_ownsReuseStorage) {
+                    ReuseEntryM targets = SharedReuseModel::readTargets(entry);
+                    this->_storageOverlay[entry->action()] = targets;
+                    this->_reuseModel->putEntry(entry->action(), targets);
+                }
+                if (hasQValues && (this->_qTable.find(entry->action()) != nullptr || entry->q1() != 0.0 ||
+                                   entry->q2() != 0.0 || entry->visits() != 0)) {
+                    DoubleQTable::Entry &qEntry = this->_qTable.findOrInsert(entry->action());
+                    qEntry.q1 = entry->q1();
+                    qEntry.q2 = entry->q2();
+                    qEntry.visits = entry->visits();
+                }
             }
+            appliedRecords++;
         }
-        
-        BLOG("Double SARSA: loaded model contains %zu actions, Q1 entries=%zu, Q2 entries=%zu", 
-             this->_reuseModel.size(), this->_reuseQValue1.size(), this->_reuseQValue2.size());
-        BDLOG("Double SARSA: Note - Q-values (Q1 and Q2) are not loaded from file, starting from 0");
+        if (offset < journal.size()) {
+            BLOGE("Double SARSA: journal %s has a torn tail at %zu of %zu bytes, cutting it",
+                  journalPath.c_str(), offset, journal.size());
+            if (truncate(journalPath.c_str(), static_cast<off_t>(offset)) != 0) {
+                std::remove(journalPath.c_str());
+                offset = 0;
+            }
+        }
+        this->_journalBytes = offset;
+        BLOG("Double SARSA: replayed %zu journal records (%zu stale) from %s",
+             appliedRecords, staleRecords, journalPath.c_str());
     }
 
     /**
      * @brief Save reuse model
      * 
-     * Serializes and saves current reuse model to file system.
-     * Note: Q-values (Q1 and Q2) are not saved to file.
+     * Serializes and saves current reuse model to file system, with the Q1/Q2 values
+     * and visit counts of the last published Q snapshot (QValueFormatVersion).
+     * Actions that have Q-values but no reuse entry are saved with empty targets.
+     * Entries of the mapped model file that were not updated are carried over, and
+     * entries are written sorted by action hash so the next load can map the file
+     * (compact encoding unless FASTBOT_COMPACT_REUSE_MODEL is 0). The file gets the next checkpoint and replaces the journal (compaction).
      */
     void DoubleSarsaAgent::saveReuseModel(const std::string &modelFilepath) {
-        // Create FlatBuffers builder
-        flatbuffers::FlatBufferBuilder builder;
-        std::vector<flatbuffers::Offset<fastbotx::ReuseEntry>> actionActivityVector;
-        
-        // Lock to protect concurrent access to reuse model
-        {
-            std::lock_guard<std::mutex> reuseGuard(this->_reuseModelLock);
-            
-            // Iterate through reuse model, build FlatBuffers data structure
-            for (const auto &actionIterator: this->_reuseModel) {
-                uint64_t actionHash = actionIterator.first;
-                ReuseEntryM activityCountEntryMap = actionIterator.second;
-                
+        std::lock_guard<std::mutex> storageGuard(this->_storageLock);
+        if (!this->_ownsReuseStorage) {
+            return;  // The owner of the shared reuse model saves it
+        }
+        this->writeFullModel(modelFilepath);
+    }
+
+    namespace {
+        /// Serialize one action; null targets leave ReuseEntry.targets absent (journal: unchanged)
+        flatbuffers::Offset<ReuseEntry> createReuseEntry(flatbuffers::FlatBufferBuilder &builder, uint64_t actionHash,
+                                                         const ReuseEntryM *targets,
+                                                         const DoubleQTable::Entry *qEntry) {
+            flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<ActivityTimes>>> targetsOffset = 0;
+            if (targets) {
                 // FlatBuffers needs vector instead of map
                 std::vector<flatbuffers::Offset<fastbotx::ActivityTimes>> activityCountEntryVector;
-                
-                // Iterate through activity mapping
-                for (const auto &activityCountEntry: activityCountEntryMap) {
+                activityCountEntryVector.reserve(targets->size());
+                for (const auto &activityCountEntry: *targets) {
                     const std::string &actName = *(activityCountEntry.first);
                     size_t actLen = std::min(actName.size(), ModelStorageConstants::MaxActivityNameLength);
-                    auto sentryActT = CreateActivityTimes(
+                    activityCountEntryVector.push_back(CreateActivityTimes(
                             builder,
                             builder.CreateString(actName.c_str(), actLen),  // Activity name (length capped)
-                            activityCountEntry.second);
-                    activityCountEntryVector.push_back(sentryActT);
+                            activityCountEntry.second));
                 }
-                
-                // Create ReuseEntry object
-                auto savedActivityCountEntries = CreateReuseEntry(
-                        builder, 
-                        actionHash,
-                        builder.CreateVector(activityCountEntryVector.data(),
-                                          activityCountEntryVector.size()));
-                actionActivityVector.push_back(savedActivityCountEntries);
+                targetsOffset = builder.CreateVector(activityCountEntryVector);
+            }
+            return CreateReuseEntry(builder, actionHash, targetsOffset,
+                                    qEntry ? qEntry->q1 : 0.0,
+                                    qEntry ? qEntry->q2 : 0.0,
+                                    qEntry ? qEntry->visits : 0);
+        }
+
+        /// Full model file in the FlatBuffers encoding, with the interface of CompactReuseModelWriter
+        class FlatBuffersModelWriter {
+        public:
+            void beginEntry(uint64_t actionHash) {
+                this->_action = actionHash;
+                this->_targets.clear();
+            }
+
+            void addTarget(const char *activity, size_t length, int times) {
+                this->_targets.push_back(CreateActivityTimes(
+                        this->_builder, this->_builder.CreateString(activity, length), times));
+            }
+
+            void endEntry(double q1, double q2, uint32_t visits) {
+                this->_entries.push_back(CreateReuseEntry(this->_builder, this->_action,
+                                                          this->_builder.CreateVector(this->_targets),
+                                                          q1, q2, visits));
+            }
+
+            size_t size() const { return this->_entries.size(); }
+
+            void finish(uint32_t version, uint64_t checkpoint) {
+                this->_builder.Finish(CreateReuseModel(
+                        this->_builder, this->_builder.CreateVectorOfSortedTables(&this->_entries),
+                        version, checkpoint));
+            }
+
+            const uint8_t *data() const { return this->_builder.GetBufferPointer(); }
+
+            size_t byteSize() const { return this->_builder.GetSize(); }
+
+        private:
+            flatbuffers::FlatBufferBuilder _builder;
+            uint64_t _action{0};
+            std::vector<flatbuffers::Offset<ActivityTimes>> _targets;
+            std::vector<flatbuffers::Offset<ReuseEntry>> _entries;
+        };
+
+#if FASTBOT_COMPACT_REUSE_MODEL
+        typedef CompactReuseModelWriter FullModelWriter;
+#else
+        typedef FlatBuffersModelWriter FullModelWriter;
+#endif
+
+        void endFullModelEntry(FullModelWriter &writer, const DoubleQTable::Entry *qEntry) {
+            writer.endEntry(qEntry ? qEntry->q1 : 0.0, qEntry ? qEntry->q2 : 0.0, qEntry ? qEntry->visits : 0);
+        }
+    }
+
+    bool DoubleSarsaAgent::writeFullModel(const std::string &modelFilepath) {
+        // Compact encoding by default (see FASTBOT_COMPACT_REUSE_MODEL); loads read both
+        FullModelWriter writer;
+        // Runs on the storage thread too: Q-values come from the published snapshot
+        std::shared_ptr<const DoubleQTable> qSnapshot = std::atomic_load(&this->_qSnapshot);
+        static const DoubleQTable emptyQTable;
+        const DoubleQTable &qTable = qSnapshot ? *qSnapshot : emptyQTable;
+
+        // Performance optimization: serialize the storage thread's own copy, so the agent
+        // thread only waits for the swap of the pending counts, not for the whole walk
+        this->collectPendingReuseCounts();
+
+        // Entries of the mapped file that this session did not touch
+        MappedReuseModelPtr reuseModelBase = this->_reuseModel->base();
+        if (reuseModelBase) {
+            reuseModelBase->forEachEntry([&](const ReuseEntryView &baseEntry) {
+                if (0 == baseEntry.targetCount || this->_storageOverlay.count(baseEntry.action) != 0) {
+                    return;  // Q-only entries are written from the Q table below
+                }
+                writer.beginEntry(baseEntry.action);
+                reuseModelBase->forEachTarget(baseEntry, [&writer](const char *activity, size_t length, int times) {
+                    writer.addTarget(activity, length, times);
+                });
+                endFullModelEntry(writer, qTable.find(baseEntry.action));
+            });
+        }
+        
+        // Iterate through reuse model
+        for (const auto &actionIterator: this->_storageOverlay) {
+            writer.beginEntry(actionIterator.first);
+            for (const auto &activityCountEntry: actionIterator.second) {
+                const std::string &actName = *(activityCountEntry.first);
+                // Activity name (length capped)
+                writer.addTarget(actName.c_str(), std::min(actName.size(), ModelStorageConstants::MaxActivityNameLength),
+                                 activityCountEntry.second);
             }
+            endFullModelEntry(writer, qTable.find(actionIterator.first));
         }
+
+        // Q-values of actions that never led to a recorded activity (empty, not null,
+        // targets: FlatBuffers readers before QValueFormatVersion dereference the vector)
+        qTable.forEach([&](const DoubleQTable::Entry &qEntry) {
+            if (this->_storageOverlay.count(qEntry.key) != 0) {
+                return;
+            }
+            ReuseEntryView baseEntry;
+            if (reuseModelBase && reuseModelBase->find(qEntry.key, baseEntry) && baseEntry.targetCount > 0) {
+                return;  // written with the mapped entries above
+            }
+            writer.beginEntry(qEntry.key);
+            endFullModelEntry(writer, &qEntry);
+        });
         
-        // Create ReuseModel root object and complete serialization
-        auto savedActionActivityEntries = CreateReuseModel(
-                builder, 
-                builder.CreateVector(actionActivityVector.data(), actionActivityVector.size()));
-        builder.Finish(savedActionActivityEntries);
+        // Complete serialization, sorted by action hash
+        uint64_t checkpoint = this->_checkpoint + 1;
+        writer.finish(ModelStorageConstants::QValueFormatVersion, checkpoint);
 
         // Determine output file path
         std::string outputFilePath = modelFilepath;
@@ -1163,7 +1280,7 @@ namespace fastbotx {
         
         if (outputFilePath.empty()) {
             BLOGE("Double SARSA: Cannot save model: output file path is empty");
-            return;
+            return false;
         }
         
         // First write to temporary file
@@ -1173,19 +1290,19 @@ namespace fastbotx {
         std::ofstream outputFile(tempFilePath, std::ios::binary);
         if (!outputFile.is_open()) {
             BLOGE("Double SARSA: Failed to open temporary file for writing: %s", tempFilePath.c_str());
-            return;
+            return false;
         }
         
         // Write serialized data
-        outputFile.write(reinterpret_cast<const char*>(builder.GetBufferPointer()), 
-                        static_cast<int>(builder.GetSize()));
+        outputFile.write(reinterpret_cast<const char*>(writer.data()), 
+                        static_cast<std::streamsize>(writer.byteSize()));
         outputFile.close();
         
         // Check if write was successful
         if (outputFile.fail()) {
             BLOGE("Double SARSA: Failed to write model to temporary file: %s", tempFilePath.c_str());
             std::remove(tempFilePath.c_str());
-            return;
+            return false;
         }
         
         // Atomically replace original file
@@ -1193,55 +1310,159 @@ namespace fastbotx {
             BLOGE("Double SARSA: Failed to rename temporary file to final file: %s -> %s", 
                   tempFilePath.c_str(), outputFilePath.c_str());
             std::remove(tempFilePath.c_str());
-            return;
+            return false;
         }
         
-        BLOG("Double SARSA: Model saved successfully to: %s (reuse entries=%zu, Q1 entries=%zu, Q2 entries=%zu)", 
-             outputFilePath.c_str(), this->_reuseModel.size(), this->_reuseQValue1.size(), this->_reuseQValue2.size());
-        BDLOG("Double SARSA: Note - Q-values (Q1 and Q2) are not saved to file, only reuse model is persisted");
+        // The journal only holds changes up to this file now
+        this->_unsavedActions.clear();
+        this->_checkpoint = checkpoint;
+        this->_fullModelBytes = writer.byteSize();
+        this->_persistedQ = qSnapshot;
+        std::remove(journalPathOf(outputFilePath).c_str());
+        this->_journalBytes = 0;
+        
+        BLOG("Double SARSA: Model saved successfully to: %s (entries=%zu, Q entries=%zu, checkpoint %" PRIu64 ")", 
+             outputFilePath.c_str(), writer.size(), qTable.size(), checkpoint);
+        return true;
+    }
+
+    void DoubleSarsaAgent::collectPendingReuseCounts() {
+        // Counts are absolute: an action first reached in this session already holds its
+        // mapped file entry, so changed actions are copied whole
+        this->_reuseModel->collectChanges(this->_storageOverlay, this->_unsavedActions);
+    }
+
+    bool DoubleSarsaAgent::persistReuseModel(const std::string &modelFilepath) {
+        std::string outputFilePath = modelFilepath.empty() ? this->_defaultModelSavePath : modelFilepath;
+        if (outputFilePath.empty()) {
+            BLOGE("Double SARSA: Cannot persist model: output file path is empty");
+            return false;
+        }
+        std::lock_guard<std::mutex> storageGuard(this->_storageLock);
+        if (!this->_ownsReuseStorage) {
+            return true;  // The owner of the shared reuse model saves it
+        }
+        // Replaying a journal costs about as much as reading the model; keep it the smaller part
+        if (this->_journalBytes > std::max(DoubleSarsaRLConstants::JournalCompactionMinBytes,
+                                           this->_fullModelBytes / 2)) {
+            BLOG("Double SARSA: journal reached %zu bytes, compacting", this->_journalBytes);
+            return this->writeFullModel(outputFilePath);
+        }
+        return this->appendJournal(journalPathOf(outputFilePath));
+    }
+
+    bool DoubleSarsaAgent::flushReuseModel() {
+        this->publishQSnapshot();
+        bool persisted = this->persistReuseModel(this->_modelSavePath);
+        if (persisted) {
+            // The next periodic save counts from here
+            this->_storageScheduler->saved();
+        }
+        return persisted;
+    }
+
+    bool DoubleSarsaAgent::appendJournal(const std::string &journalPath) {
+        std::shared_ptr<const DoubleQTable> qSnapshot = std::atomic_load(&this->_qSnapshot);
+
+        this->collectPendingReuseCounts();
+
+        // Snapshots are immutable: diff against the persisted one without any lock
+        std::vector<const DoubleQTable::Entry *> changedQValues;
+        if (qSnapshot && qSnapshot != this->_persistedQ) {
+            const DoubleQTable *persistedQ = this->_persistedQ.get();
+            qSnapshot->forEach([&](const DoubleQTable::Entry &qEntry) {
+                const DoubleQTable::Entry *persisted = persistedQ ? persistedQ->find(qEntry.key) : nullptr;
+                if (nullptr == persisted || persisted->q1 != qEntry.q1 || persisted->q2 != qEntry.q2 ||
+                    persisted->visits != qEntry.visits) {
+                    changedQValues.push_back(&qEntry);
+                }
+            });
+        }
+        if (this->_unsavedActions.empty() && changedQValues.empty()) {
+            return true;
+        }
+
+        flatbuffers::FlatBufferBuilder builder;
+        std::vector<flatbuffers::Offset<fastbotx::ReuseEntry>> recordEntries;
+        recordEntries.reserve(this->_unsavedActions.size() + changedQValues.size());
+        for (uint64_t actionHash: this->_unsavedActions) {
+            recordEntries.push_back(createReuseEntry(builder, actionHash, &this->_storageOverlay[actionHash],
+                                                     qSnapshot ? qSnapshot->find(actionHash) : nullptr));
+        }
+        for (const DoubleQTable::Entry *qEntry: changedQValues) {
+            if (this->_unsavedActions.count(qEntry->key) == 0) {
+                recordEntries.push_back(createReuseEntry(builder, qEntry->key, nullptr, qEntry));
+            }
+        }
+        builder.FinishSizePrefixed(CreateReuseModel(
+                builder,
+                builder.CreateVectorOfSortedTables(&recordEntries),
+                ModelStorageConstants::QValueFormatVersion,
+                this->_checkpoint));
+
+        // One write per record; a crash mid-write leaves a tail that replay cuts off
+        bool written = false;
+        int fd = ::open(journalPath.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (fd >= 0) {
+            ssize_t writtenBytes = ::write(fd, builder.GetBufferPointer(), builder.GetSize());
+            written = writtenBytes == static_cast<ssize_t>(builder.GetSize()) && 0 == fsync(fd);
+            close(fd);
+            if (!written && writtenBytes > 0 && truncate(journalPath.c_str(),
+                                                         static_cast<off_t>(this->_journalBytes)) != 0) {
+                // Cannot drop the partial record: start over from a full save next time
+                this->_journalBytes = std::numeric_limits<size_t>::max();
+            }
+        }
+        if (!written) {
+            BLOGE("Double SARSA: Failed to append to journal: %s", journalPath.c_str());
+            return false;
+        }
+        this->_unsavedActions.clear();
+        this->_persistedQ = qSnapshot;
+        this->_journalBytes += builder.GetSize();
+        BLOG("Double SARSA: journaled %zu entries (%zu bytes, journal %zu bytes)",
+             recordEntries.size(), static_cast<size_t>(builder.GetSize()), this->_journalBytes);
+        return true;
     }
 
     /**
      * @brief Background thread function for periodic model saving
      * 
-     * Periodically saves the reuse model to disk every 10 minutes (ModelSaveIntervalMs).
-     * Runs in a background thread until the agent is destructed.
+     * Saves the reuse model whenever _storageScheduler says a save is due: every
+     * 10 minutes (ModelSaveIntervalMs) or, while learning is hot, after
+     * ModelSaveDirtyThreshold new reuse entries. Runs until the agent is destructed.
      * 
      * Implementation details:
-     * 1. Saves model every 10 minutes (ModelSaveIntervalMs)
+     * 1. Each save appends the changes to the journal, and compacts into the full
+     *    model file once the journal grows large
      * 2. Uses weak_ptr to avoid circular references
-     * 3. Thread automatically exits when agent is destructed (weak_ptr becomes invalid)
-     * 4. Briefly locks agent to get save path, then releases lock before IO operations
+     * 3. Waits on the scheduler only, so the agent is not kept alive while waiting;
+     *    the destructor wakes the thread up and it exits at once
+     * 4. Holds the agent only for the duration of a save
      * 
      * @param agent Weak pointer to DoubleSarsaAgent instance
      */
     void DoubleSarsaAgent::threadModelStorage(const std::weak_ptr<DoubleSarsaAgent> &agent) {
-        constexpr int saveInterval = DoubleSarsaRLConstants::ModelSaveIntervalMs;  // 10 minutes
-        constexpr auto interval = std::chrono::milliseconds(saveInterval);
+        ModelStorageSchedulerPtr scheduler;
+        if (auto agentPtr = agent.lock()) {
+            scheduler = agentPtr->_storageScheduler;
+        }
+        if (!scheduler) {
+            return;
+        }
         
-        // Loop to save until Agent is destructed (weak_ptr becomes invalid)
-        while (true) {
-            // Briefly lock Agent to get save path
+        // Loop to save until Agent is destructed
+        while (scheduler->waitForNextSave() != ModelStorageScheduler::Trigger::Shutdown) {
             auto agentPtr = agent.lock();
             if (!agentPtr) {
                 // Agent has been destructed, exit thread
                 break;
             }
-            
-            // Copy save path
-            std::string savePath = agentPtr->_modelSavePath;
-            
-            // Immediately release lock to avoid holding for long time
-            agentPtr.reset();
-            
-            // Save model outside lock (IO operations may be slow)
-            if (auto locked = agent.lock()) {
-                locked->saveReuseModel(savePath);
-            }
-            
-            // Wait for specified interval before saving again
-            std::this_thread::sleep_for(interval);
+            // IO does not block the agents; only changes are written
+            agentPtr->acquireQSnapshot();
+            agentPtr->persistReuseModel(agentPtr->_modelSavePath);
         }
+        BLOG("Double SARSA: model storage thread exits");
     }
 
 }  // namespace fastbotx
@@ -10,6 +10,14 @@
 #include "AbstractAgent.h"
 #include "State.h"
 #include "Action.h"
+#include "ActionScoring.h"
+#include "DoubleQTable.h"
+#include "MappedReuseModel.h"
+#include "ModelStorageScheduler.h"
+#include "SharedReuseModel.h"
+#include <atomic>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <map>
 #include <random>
@@ -30,8 +38,10 @@ namespace fastbotx {
         constexpr double DefaultEpsilon = 0.05;
         /// Default discount factor (gamma), controls importance of future rewards, range [0,1]
         constexpr double DefaultGamma = 0.8;
-        /// N-step Double SARSA step count, uses N-step returns to update Q-values
+        /// Default N-step Double SARSA step count, uses N-step returns to update Q-values
         constexpr int NStep = 5;
+        /// Largest window accepted by setNStep (max.nStep)
+        constexpr int MaxNStep = 256;
         
         // ========== Alpha Dynamic Adjustment Parameters ==========
         /// Initial moving average alpha value
@@ -68,20 +78,20 @@ namespace fastbotx {
         // ========== Model Storage Constants ==========
         /// Model save interval (milliseconds), background thread saves model every 10 minutes
         constexpr int ModelSaveIntervalMs = 1000 * 60 * 10; // 10 minutes
+        /// New reuse entries (action or action -> activity pairs) that trigger a save before the interval
+        constexpr size_t ModelSaveDirtyThreshold = 200;
+        /// Minimum time between two saves triggered by ModelSaveDirtyThreshold (1 minute)
+        constexpr int ModelSaveMinSpacingMs = 1000 * 60; // 1 minute
         /// Maximum model file size (100MB), prevents loading overly large model files
         constexpr size_t MaxModelFileSize = 100 * 1024 * 1024; // 100MB
+        /// How long the storage thread waits for the agent thread to publish a Q-value snapshot
+        constexpr int QSnapshotWaitMs = 2000;
+        /// Polling step while waiting for a Q-value snapshot
+        constexpr int QSnapshotPollMs = 20;
+        /// Journal size below which persistReuseModel never compacts (1MB)
+        constexpr size_t JournalCompactionMinBytes = 1024 * 1024; // 1MB
     }
 
-    // ========== Reuse Model Data Structure Type Definitions ==========
-    /// Reuse entry mapping: Activity name -> visit count
-    typedef std::map<stringPtr, int> ReuseEntryM;
-    /// Reuse model mapping: action hash -> (Activity name -> visit count)
-    typedef std::map<uint64_t, ReuseEntryM> ReuseEntryIntMap;
-    /// Q-value mapping: action hash -> Q-value (for Q1)
-    typedef std::map<uint64_t, double> ReuseEntryQValueMap;
-    /// Q-value mapping: action hash -> Q-value (for Q2)
-    typedef std::map<uint64_t, double> ReuseEntryQValueMap2;
-
     /**
      * @brief Double SARSA reinforcement learning agent
      * 
@@ -115,7 +125,10 @@ namespace fastbotx {
      * 
      * Performance optimizations:
      * - Uses member random number generator to avoid creating new generators each time
-     * - Uses mutex to protect concurrent access to reuse model and Q-functions
+     * - Shares the reuse model with the other agents of the same model file (see
+     *   SharedReuseModel); the first of them loads and saves it
+     * - Keeps Q1/Q2 in one flat table owned by the agent thread (no lock); the storage
+     *   thread reads snapshots the agent thread publishes on request
      * - Uses binary search to optimize action selection
      * - Caches visitedActivities to avoid repeated queries
      */
@@ -137,10 +150,21 @@ namespace fastbotx {
          * Loads previously saved reuse model from file system.
          * Model file path: /sdcard/fastbot_{packageName}.fbm
          * 
+         * If another agent of this process already uses the file, its reuse model is
+         * shared instead and only the Q-values are read from the file.
+         * 
          * @param packageName Application package name, used to construct model file path
          */
         virtual void loadReuseModel(const std::string &packageName);
 
+        /**
+         * @brief Start mapping and verifying the model file of packageName in the background
+         *
+         * Needs no agent: called at startup while the configs load, so loadReuseModel
+         * finds the file ready.
+         */
+        static void prefetchReuseModel(const std::string &packageName);
+
         /**
          * @brief Save reuse model
          * 
@@ -151,21 +175,70 @@ namespace fastbotx {
          */
         void saveReuseModel(const std::string &modelFilepath);
 
+        /**
+         * @brief Persist what changed since the last save
+         * 
+         * Appends the reuse entries and Q-values changed since the previous save to the
+         * journal next to the model file (<model>.journal), as one size-prefixed
+         * ReuseModel record. Once the journal outgrows half of the full model (and at
+         * least JournalCompactionMinBytes), compacts instead: saveReuseModel rewrites
+         * the full file and the journal is removed.
+         * 
+         * Agents that share a reuse model they do not own write nothing: the owner
+         * saves the shared entries (with its own Q-values).
+         * 
+         * @param modelFilepath Model file path, uses _defaultModelSavePath if empty
+         * @return false if the changes could not be written
+         */
+        bool persistReuseModel(const std::string &modelFilepath);
+
         /**
          * @brief Background thread function for periodic model saving
          * 
-         * Static method that runs in a background thread to periodically save the reuse model.
-         * Saves model every 10 minutes (ModelSaveIntervalMs) until the agent is destructed.
+         * Static method that runs in a background thread to save the reuse model when
+         * _storageScheduler says so: every ModelSaveIntervalMs (10 minutes), or earlier
+         * after ModelSaveDirtyThreshold new reuse entries. Both can be overridden in
+         * max.config (max.modelSaveIntervalSeconds, max.modelSaveDirtyThreshold).
          * 
          * @param agent Weak pointer to DoubleSarsaAgent instance
          * 
          * @note
          * - Uses weak_ptr to avoid circular references
-         * - Thread automatically exits when agent is destructed (weak_ptr becomes invalid)
-         * - Model should have been saved by periodic save thread (threadModelStorage)
+         * - Waits on the scheduler without holding the agent; the destructor wakes it up
+         *   and the thread exits at once
          */
         static void threadModelStorage(const std::weak_ptr<DoubleSarsaAgent> &agent);
 
+        /**
+         * @brief Persist the reuse model now (flush on demand)
+         * 
+         * Call with no step of the agent running, e.g. through Model::withIdleAgent, which
+         * holds the device's step lock: the current Q-values are copied directly instead
+         * of waiting for the next step to publish them.
+         * 
+         * @return true if the changes were written
+         */
+        bool flushReuseModel();
+
+        /**
+         * @brief Change the N-step window length
+         * 
+         * Clamped to [1, MaxNStep]; a shorter window drops the oldest history at once.
+         * Defaults to NStep, or max.nStep from max.config.
+         */
+        void setNStep(int nStep);
+
+        int getNStep() const { return this->_nStep; }
+
+        void accountMemory(MemoryFootprint &footprint) const override;
+
+        /// Also keeps the random generator as it was, for discardSpeculativeAction
+        ActionPtr speculateNewAction(const StatePtr &predicted) override;
+
+        void adoptSpeculativeAction(const ActionPtr &action) override;
+
+        void discardSpeculativeAction() override;
+
         /**
          * @brief Destructor
          * 
@@ -243,7 +316,7 @@ namespace fastbotx {
          * @return Probability value, range [0,1]
          */
         double probabilityOfVisitingNewActivities(const ActivityStateActionPtr &action,
-                                                  const stringPtrSet &visitedActivities) const;
+                                                  const InternedStringSet &visitedActivities) const;
 
         /**
          * @brief Compute state action expectation value
@@ -255,7 +328,7 @@ namespace fastbotx {
          * @return Expectation value
          */
         double getStateActionExpectationValue(const StatePtr &state,
-                                              const stringPtrSet &visitedActivities) const;
+                                              const InternedStringSet &visitedActivities) const;
 
         /**
          * @brief Update reuse model
@@ -289,8 +362,8 @@ namespace fastbotx {
         /**
          * @brief Select action based on Q-value (using randomly chosen Q1 or Q2)
          * 
-         * Uses humble-gumbel distribution to add randomness, selects action with maximum adjusted Q-value.
-         * Randomly chooses Q1 or Q2 for Q-value calculation.
+         * Samples softmax(Q / EntropyAlpha) over the state's actions (the distribution of the
+         * humble-gumbel argmax) with one batched draw. Randomly chooses Q1 or Q2 for Q-value calculation.
          * 
          * @return Selected action, or nullptr if none
          */
@@ -315,45 +388,50 @@ namespace fastbotx {
          * @brief Action history cache
          * 
          * Stores recently executed actions of last N steps, used for N-step Double SARSA algorithm to update Q-values.
-         * Length does not exceed NStep (5).
+         * Length does not exceed _nStep.
          */
         std::vector<ActionPtr> _previousActions;
 
+        /// N-step window length (NStep unless configured)
+        int _nStep{DoubleSarsaRLConstants::NStep};
+
     private:
         // ========== Random Number Generators (Performance Optimization) ==========
-        /// Mersenne Twister random number generator, thread-safe and performant
-        mutable std::mt19937 _rng;
-        /// Uniform distribution for double in range [0,1)
-        mutable std::uniform_real_distribution<double> _uniformDist{0.0, 1.0};
-        /// Uniform distribution for float in range [0,1)
-        mutable std::uniform_real_distribution<float> _uniformFloatDist{0.0f, 1.0f};
-        /// Uniform distribution for int in range [0,1) for choosing Q1 or Q2
-        mutable std::uniform_int_distribution<int> _uniformIntDist{0, 1};
+        /// AbstractAgent::_rng before the pending speculation (speculateNewAction), restored if it is discarded
+        Rng _rngBeforeSpeculation;
+        bool _speculationPending{false};
+
+        /// Scores of the action selection in progress (reused to avoid per-step allocation)
+        mutable ScoreBatch _scoreBatch;
         
         // ========== Reuse Model Data ==========
         /**
-         * @brief Reuse model
+         * @brief Reuse model, shared with the agents of other devices using the same file
          * 
          * Records activities that each action (identified by hash) can reach and their visit counts.
          * Structure: action hash -> (Activity name -> visit count)
          */
-        ReuseEntryIntMap _reuseModel;
-        
-        /**
-         * @brief Q1-value mapping
-         * 
-         * Records Q1-value (quality value) of each action.
-         * Structure: action hash -> Q1-value
-         */
-        ReuseEntryQValueMap _reuseQValue1;
+        SharedReuseModelPtr _reuseModel;
         
         /**
-         * @brief Q2-value mapping
+         * @brief Q1 and Q2 values of each action
          * 
-         * Records Q2-value (quality value) of each action.
-         * Structure: action hash -> Q2-value
+         * Structure: action hash -> (Q1-value, Q2-value). Read and written only by the
+         * agent thread, so lookups take no lock.
          */
-        ReuseEntryQValueMap2 _reuseQValue2;
+        DoubleQTable _qTable;
+
+        /// Incremented on every change of _qTable; identifies its content
+        uint64_t _qEpoch{0};
+
+        /// Last copy of _qTable published for other threads (atomic_load / atomic_store only)
+        std::shared_ptr<const DoubleQTable> _qSnapshot;
+
+        /// _qEpoch of _qSnapshot (agent thread only); an unchanged table is not copied again
+        uint64_t _qSnapshotEpoch{0};
+
+        /// Set by a reader that wants a fresh snapshot, cleared by the agent thread on publishing
+        std::atomic<bool> _qSnapshotRequested{false};
         
         // ========== Model File Paths ==========
         /// Model save path (main path)
@@ -363,10 +441,38 @@ namespace fastbotx {
         /// Static default model save path
         static std::string DefaultModelSavePath;
         
-        // ========== Thread Safety ==========
-        /// Reuse model mutex, protects concurrent access to _reuseModel and Q-value maps
-        /// Uses mutable to allow locking in const methods
-        mutable std::mutex _reuseModelLock;
+        // ========== Incremental Persistence ==========
+        /// Serializes load, journal appends and compaction; guards the members below
+        mutable std::mutex _storageLock;
+
+        /// This agent loads and writes the model file of _reuseModel (claimed first)
+        bool _ownsReuseStorage{false};
+
+        /**
+         * @brief Storage thread's copy of _reuseModel
+         * 
+         * Kept up to date by SharedReuseModel::collectChanges, so saves serialize it
+         * while the agents keep updating _reuseModel.
+         */
+        ReuseEntryIntMap _storageOverlay;
+
+        /// Actions of _storageOverlay not written to the journal or the full model yet
+        std::unordered_set<uint64_t> _unsavedActions;
+
+        /// Q snapshot covered by the files on disk; the next record holds the entries that differ
+        std::shared_ptr<const DoubleQTable> _persistedQ;
+
+        /// Checkpoint of the full model on disk; journal records of another checkpoint are stale
+        uint64_t _checkpoint{0};
+
+        /// Valid bytes in the journal
+        size_t _journalBytes{0};
+
+        /// Size of the last full model written or loaded
+        size_t _fullModelBytes{0};
+
+        /// When the storage thread saves; shared with it so waiting does not keep the agent alive
+        ModelStorageSchedulerPtr _storageScheduler;
 
         /**
          * @brief Compute alpha value
@@ -390,7 +496,7 @@ namespace fastbotx {
          * @param action Action pointer
          * @return Q1-value
          */
-        double getQ1Value(const ActionPtr &action);
+        double getQ1Value(const ActionPtr &action) const;
         
         /**
          * @brief Get action's Q2-value
@@ -398,7 +504,7 @@ namespace fastbotx {
          * @param action Action pointer
          * @return Q2-value
          */
-        double getQ2Value(const ActionPtr &action);
+        double getQ2Value(const ActionPtr &action) const;
         
         /**
          * @brief Get action's Q-value (from randomly chosen Q1 or Q2)
@@ -442,6 +548,57 @@ namespace fastbotx {
          */
         void updateQValues();
         
+        /// Journal file that accompanies a model file
+        static std::string journalPathOf(const std::string &modelFilepath);
+
+        /// Full save (caller holds _storageLock); returns false if the file could not be written
+        bool writeFullModel(const std::string &modelFilepath);
+
+        /**
+         * @brief Copy the reuse entries changed since the last save into _storageOverlay
+         *        (caller holds _storageLock)
+         */
+        void collectPendingReuseCounts();
+
+        /**
+         * @brief Append one record of the changes since the last save (caller holds _storageLock)
+         * 
+         * Reuse entries come from _storageOverlay, Q-value changes from comparing the
+         * published snapshot with _persistedQ; neither blocks the agents.
+         * 
+         * @return false if the record could not be written (the changes stay dirty)
+         */
+        bool appendJournal(const std::string &journalPath);
+
+        /**
+         * @brief Apply the journal records of the loaded checkpoint (caller holds _storageLock)
+         * 
+         * Records are applied in order, later ones superseding earlier ones. Replay stops
+         * at the first truncated or corrupted record, and the journal is cut there so new
+         * records are not appended behind a torn tail.
+         */
+        void replayJournal(const std::string &journalPath);
+
+        /**
+         * @brief Publish a copy of _qTable if another thread asked for one (agent thread)
+         *
+         * Called at the end of each step, after the Q-values of the step are final, so a
+         * snapshot never contains a half-applied N-step update.
+         */
+        void publishQSnapshotIfRequested();
+
+        /// Publish a copy of _qTable unless the last snapshot is still current (agent thread)
+        void publishQSnapshot();
+
+        /**
+         * @brief Get a Q-value snapshot from a thread other than the agent thread
+         *
+         * Asks the agent thread to publish the current table and waits up to
+         * QSnapshotWaitMs for it. If the agent does not step in time, the previous
+         * snapshot is returned (nullptr if none was ever published).
+         */
+        std::shared_ptr<const DoubleQTable> acquireQSnapshot();
+
         /**
          * @brief Check if action is in reuse model
          * 
@@ -0,0 +1,177 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef MappedReuseModel_CPP_
+#define MappedReuseModel_CPP_
+
+#include "MappedReuseModel.h"
+#include "../utils.hpp"
+#include <future>
+#include <map>
+#include <mutex>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fastbotx {
+
+    MappedReuseModel::MappedReuseModel(void *data, size_t size)
+            : _data(data), _size(size) {
+    }
+
+    MappedReuseModel::~MappedReuseModel() {
+        if (this->_data != nullptr) {
+            munmap(this->_data, this->_size);
+        }
+    }
+
+    namespace {
+        struct Prefetched {
+            size_t maxSize;
+            std::shared_future<MappedReuseModelPtr> model;
+        };
+
+        std::mutex &prefetchLock() {
+            static std::mutex lock;
+            return lock;
+        }
+
+        /// Prefetches not taken by open() yet, by path (under prefetchLock)
+        std::map<std::string, Prefetched> &prefetches() {
+            static std::map<std::string, Prefetched> pending;
+            return pending;
+        }
+    }
+
+    void MappedReuseModel::prefetch(const std::string &path, size_t maxSize) {
+        std::lock_guard<std::mutex> guard(prefetchLock());
+        if (prefetches().count(path) != 0) {
+            return;
+        }
+        std::shared_future<MappedReuseModelPtr> model =
+                std::async(std::launch::async, &MappedReuseModel::load, path, maxSize).share();
+        prefetches().emplace(path, Prefetched{maxSize, model});
+    }
+
+    std::shared_ptr<MappedReuseModel> MappedReuseModel::open(const std::string &path, size_t maxSize) {
+        // Taken out under the lock; waited for (or dropped) outside it
+        Prefetched prefetched{0, {}};
+        {
+            std::lock_guard<std::mutex> guard(prefetchLock());
+            auto pending = prefetches().find(path);
+            if (pending != prefetches().end()) {
+                prefetched = std::move(pending->second);
+                prefetches().erase(pending);
+            }
+        }
+        if (prefetched.model.valid() && prefetched.maxSize == maxSize) {
+            return prefetched.model.get();
+        }
+        return load(path, maxSize);
+    }
+
+    std::shared_ptr<MappedReuseModel> MappedReuseModel::load(const std::string &path, size_t maxSize) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            BLOGE("reuse model: cannot open %s", path.c_str());
+            return nullptr;
+        }
+        struct stat fileStat{};
+        if (fstat(fd, &fileStat) != 0 || fileStat.st_size <= 0 ||
+            static_cast<size_t>(fileStat.st_size) > maxSize) {
+            BLOGE("reuse model: invalid model file size: %lld", static_cast<long long>(fileStat.st_size));
+            close(fd);
+            return nullptr;
+        }
+        auto size = static_cast<size_t>(fileStat.st_size);
+        void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        // The mapping keeps its own reference to the file
+        close(fd);
+        if (data == MAP_FAILED) {
+            BLOGE("reuse model: mmap failed for %s", path.c_str());
+            return nullptr;
+        }
+        std::shared_ptr<MappedReuseModel> mapped(new MappedReuseModel(data, size));
+
+        if (CompactReuseModel::isCompact(static_cast<const uint8_t *>(data), size)) {
+            if (!mapped->_compact.open(static_cast<const uint8_t *>(data), size)) {
+                BLOGE("reuse model: invalid or corrupted compact model %s", path.c_str());
+                return nullptr;
+            }
+            mapped->_sorted = true;
+            return mapped;
+        }
+
+        // Verify buffer before use (security: prevent OOB/malformed data)
+        flatbuffers::Verifier verifier(static_cast<const uint8_t *>(data), size);
+        if (!VerifyReuseModelBuffer(verifier)) {
+            BLOGE("reuse model: invalid or corrupted model buffer");
+            return nullptr;
+        }
+        mapped->_root = GetReuseModel(data);
+        if (nullptr == mapped->_root) {
+            return nullptr;
+        }
+
+        // One pass over the keys (no allocation) decides whether binary search is usable
+        mapped->_sorted = true;
+        const auto *entries = mapped->_root->model();
+        for (flatbuffers::uoffset_t i = 1; entries && i < entries->size(); i++) {
+            if (entries->Get(i - 1)->action() >= entries->Get(i)->action()) {
+                mapped->_sorted = false;
+                break;
+            }
+        }
+        return mapped;
+    }
+
+    uint32_t MappedReuseModel::version() const {
+        return this->compact() ? this->_compact.version() : this->_root->version();
+    }
+
+    uint64_t MappedReuseModel::checkpoint() const {
+        return this->compact() ? this->_compact.checkpoint() : this->_root->checkpoint();
+    }
+
+    size_t MappedReuseModel::size() const {
+        if (this->compact()) {
+            return this->_compact.size();
+        }
+        const auto *entries = this->_root->model();
+        return entries ? entries->size() : 0;
+    }
+
+    bool MappedReuseModel::find(uint64_t actionHash, ReuseEntryView &entry) const {
+        if (this->compact()) {
+            return this->_compact.find(actionHash, entry);
+        }
+        const auto *entries = this->_root->model();
+        if (nullptr == entries || !this->_sorted) {
+            return false;
+        }
+        const ReuseEntry *table = entries->LookupByKey(actionHash);
+        if (nullptr == table) {
+            return false;
+        }
+        readTable(table, entry);
+        return true;
+    }
+
+    void MappedReuseModel::readTable(const ReuseEntry *table, ReuseEntryView &entry) {
+        entry.action = table->action();
+        entry.q1 = table->q1();
+        entry.q2 = table->q2();
+        entry.visits = table->visits();
+        entry.targetCount = table->targets() ? table->targets()->size() : 0;
+        entry.table = table;
+        entry.packedTargets = nullptr;
+        entry.packedBytes = 0;
+    }
+
+}
+
+#endif //MappedReuseModel_CPP_
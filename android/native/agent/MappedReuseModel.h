@@ -0,0 +1,130 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef MappedReuseModel_H_
+#define MappedReuseModel_H_
+
+#include "../storage/ReuseModel_generated.h"
+#include "CompactReuseModel.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace fastbotx {
+
+    /**
+     * @brief Read-only, memory-mapped view of a saved reuse model (.fbm)
+     *
+     * The file is mapped and verified once; entries are then read in place instead of
+     * being copied into std::map / std::string. Two encodings are read: the compact one
+     * (CompactReuseModel, always sorted) and the FlatBuffers ReuseModel, where lookups
+     * use binary search on ReuseEntry.action (the schema's key) and so need the entries
+     * to be sorted: sorted() reports whether they are (files written by std::map
+     * iteration or CreateVectorOfSortedTables are).
+     *
+     * The mapping stays valid when the file is replaced (save writes a temp file and
+     * renames it over the old one), so a model can be mapped for the whole session.
+     */
+    class MappedReuseModel {
+    public:
+        /**
+         * @brief Map and verify a model file
+         *
+         * @param path Model file path
+         * @param maxSize Files larger than this are rejected
+         * @return The mapped model, or nullptr if the file is missing, too large or invalid
+         */
+        static std::shared_ptr<MappedReuseModel> open(const std::string &path, size_t maxSize);
+
+        /**
+         * @brief Start open(path, maxSize) on a background thread
+         *
+         * Verifying touches every page of the file, the bulk of loading a large model; the
+         * next open of path takes the prefetched result (waiting for it if needed) instead
+         * of mapping the file again. Meant for startup, before the file is written.
+         */
+        static void prefetch(const std::string &path, size_t maxSize);
+
+        ~MappedReuseModel();
+
+        MappedReuseModel(const MappedReuseModel &) = delete;
+
+        MappedReuseModel &operator=(const MappedReuseModel &) = delete;
+
+        /// Whether the file uses the compact encoding
+        bool compact() const { return nullptr == this->_root; }
+
+        /// ReuseModel.version of the file (QValueFormatVersion and later carry Q-values)
+        uint32_t version() const;
+
+        uint64_t checkpoint() const;
+
+        /// Number of reuse entries in the file
+        size_t size() const;
+
+        /// Whether entries are ordered by action hash (find() only works if so)
+        bool sorted() const { return this->_sorted; }
+
+        /// Entry of the given action hash (O(log n), no allocation); false if there is none
+        bool find(uint64_t actionHash, ReuseEntryView &entry) const;
+
+        /// Call fn(const ReuseEntryView &) for each entry, in file order
+        template<typename Fn>
+        void forEachEntry(Fn fn) const {
+            if (this->compact()) {
+                this->_compact.forEach(fn);
+                return;
+            }
+            const auto *entries = this->_root->model();
+            ReuseEntryView entry;
+            for (flatbuffers::uoffset_t i = 0; entries && i < entries->size(); i++) {
+                readTable(entries->Get(i), entry);
+                fn(static_cast<const ReuseEntryView &>(entry));
+            }
+        }
+
+        /// Call fn(const char *activity, size_t length, int times) for each target of entry
+        template<typename Fn>
+        void forEachTarget(const ReuseEntryView &entry, Fn fn) const {
+            if (nullptr == entry.table) {
+                this->_compact.forEachTarget(entry, fn);
+                return;
+            }
+            const auto *targets = entry.table->targets();
+            for (flatbuffers::uoffset_t i = 0; targets && i < targets->size(); i++) {
+                const ActivityTimes *target = targets->Get(i);
+                if (nullptr != target->activity()) {
+                    fn(target->activity()->c_str(), static_cast<size_t>(target->activity()->size()),
+                       static_cast<int>(target->times()));
+                }
+            }
+        }
+
+        /// Size of the mapped file in bytes
+        size_t byteSize() const { return this->_size; }
+
+    private:
+        MappedReuseModel(void *data, size_t size);
+
+        /// open() without looking for a prefetched result
+        static std::shared_ptr<MappedReuseModel> load(const std::string &path, size_t maxSize);
+
+        static void readTable(const ReuseEntry *table, ReuseEntryView &entry);
+
+        void *_data;
+        size_t _size;
+        /// FlatBuffers file: its root; compact file: nullptr and _compact is used
+        const ReuseModel *_root{nullptr};
+        CompactReuseModel _compact;
+        bool _sorted{false};
+    };
+
+    typedef std::shared_ptr<MappedReuseModel> MappedReuseModelPtr;
+
+}
+
+#endif //MappedReuseModel_H_
@@ -51,7 +51,6 @@ namespace fastbotx {
             : AbstractAgent(model), 
               _alpha(SarsaRLConstants::DefaultAlpha),  // Initial learning rate 0.25
               _epsilon(SarsaRLConstants::DefaultEpsilon),  // Initial exploration rate 0.05
-              _rng(std::random_device{}()),  // Initialize random number generator with random device
               _modelSavePath(DefaultModelSavePath),  // Set model save path
               _defaultModelSavePath(DefaultModelSavePath) {  // Set default save path
         this->_algorithmType = AlgorithmType::Reuse;  // Set algorithm type to Reuse
@@ -375,6 +374,12 @@ namespace fastbotx {
      */
     void ModelReusableAgent::setQValue(const ActionPtr &action, double qValue) {
         action->setQValue(qValue);
+        // Q values are saved with the state's actions in the session snapshot
+        if (auto stateAction = std::dynamic_pointer_cast<ActivityStateAction>(action)) {
+            if (StatePtr state = stateAction->getState().lock()) {
+                state->markSessionDirty();
+            }
+        }
     }
 
     /**
@@ -617,7 +622,7 @@ namespace fastbotx {
         
         // Use random strategy: randomly select action
         BDLOG("%s", "Try to randomly select a value action.");
-        return this->_newState->randomPickAction(enableValidValuePriorityFilter);
+        return this->_newState->randomPickAction(enableValidValuePriorityFilter, this->_rng);
     }
 
     /**
@@ -627,13 +632,13 @@ namespace fastbotx {
      * 
      * Performance optimization:
      * - Uses member random number generator to avoid creating new generator each time
-     * - Uses uniform_real_distribution, performant and thread-safe
+     * - Draws from the agent's own RandomStreams stream
      * 
      * @return true means use greedy strategy (select action with highest Q-value), false means use random strategy
      */
     bool ModelReusableAgent::eGreedy() const {
         // Use member random number generator for better performance and thread safety
-        return _uniformDist(_rng) >= this->_epsilon;
+        return _rng.nextDouble() >= this->_epsilon;
     }
 
 
@@ -682,7 +687,7 @@ namespace fastbotx {
         }
 
         // Strategy 3: Select unvisited actions
-        action = this->_newState->randomPickUnvisitedAction();
+        action = this->_newState->randomPickUnvisitedAction(this->_rng);
         if (nullptr != action) {
             BLOG("%s", "select action in unvisited action");
             return action;
@@ -719,61 +724,22 @@ namespace fastbotx {
      * Uses weighted random selection, weights are action priorities.
      * 
      * Performance optimization:
-     * - Uses cumulative distribution function (CDF) and binary search, time complexity O(n log n)
-     * - First collects candidate actions, then selects once, avoids repeated traversal
+     * - Samples the state's Fenwick tree of unvisited model action priorities, which
+     *   adjustActions() keeps current: O(log n) per pick instead of a rebuilt CDF
      * 
      * @return Selected action, or nullptr if none
      */
     ActionPtr ModelReusableAgent::selectUnperformedActionNotInReuseModel() const {
-        // Step 1: Collect all unexecuted actions not in reuse model
-        std::vector<ActionPtr> actionsNotInModel;
-        for (const auto &action: this->_newState->getActions()) {
-            // Check if action satisfies conditions:
-            // 1. Is a model action (CLICK, SCROLL, etc.)
-            // 2. Not in reuse model
-            // 3. Not executed
-            bool matched = action->isModelAct()  // Must be model action
-                           && !this->isActionInReuseModel(action->hash())  // Not in reuse model
-                           && action->getVisitedCount() <= 0;  // Not executed
-            
-            if (matched) {
-                actionsNotInModel.emplace_back(action);
-            }
-        }
-        
-        // If no candidate actions, return nullptr
-        if (actionsNotInModel.empty()) {
+        // Unexecuted model actions, weighted by priority (O(log n) from the state's
+        // sampler); candidates already in the reuse model are rejected and dropped
+        ActivityStateActionPtr action = this->_newState->randomPickUnknownModelAction(
+                [this](const ActivityStateActionPtr &candidate) {
+                    return this->isActionInReuseModel(candidate->hash());
+                }, this->_rng);
+        if (nullptr == action) {
             BDLOGE("%s", " no actions not in model");
-            return nullptr;
         }
-        
-        // Step 2: Build cumulative weight array (for weighted random selection)
-        std::vector<int> cumulativeWeights;
-        int totalWeight = 0;
-        for (const auto &action: actionsNotInModel) {
-            totalWeight += action->getPriority();
-            cumulativeWeights.push_back(totalWeight);
-        }
-        
-        // If total weight is 0, return nullptr
-        if (totalWeight <= 0) {
-            BDLOGE("%s", " total weights is 0");
-            return nullptr;
-        }
-        
-        // Step 3: Use binary search to select action (O(log n))
-        int randI = randomInt(0, totalWeight);  // Generate random number in [0, totalWeight)
-        auto it = std::lower_bound(cumulativeWeights.begin(), 
-                                  cumulativeWeights.end(), randI);
-        size_t index = std::distance(cumulativeWeights.begin(), it);
-        
-        // Return selected action
-        if (index < actionsNotInModel.size()) {
-            return actionsNotInModel[index];
-        }
-        
-        BDLOGE("%s", " rand a null action");
-        return nullptr;
+        return action;
     }
 
     /**
@@ -839,7 +805,7 @@ namespace fastbotx {
                     qualityValue = SarsaRLConstants::QualityValueMultiplier * qualityValue;
                     
                     // Use member random number generator to generate random number (performance optimization)
-                    auto uniform = _uniformFloatDist(_rng);
+                    auto uniform = _rng.nextFloat();
                     
                     // Ensure random number is not 0 to avoid log(0) causing INF
                     if (uniform < std::numeric_limits<float>::min()) {
@@ -924,7 +890,7 @@ namespace fastbotx {
             qv /= SarsaRLConstants::EntropyAlpha;
             
             // Use member random number generator to generate random number (performance optimization)
-            float uniform = _uniformFloatDist(_rng);
+            float uniform = _rng.nextFloat();
             
             // Ensure random number is not 0 to avoid log(0) causing INF
             if (uniform < std::numeric_limits<float>::min()) {
@@ -1118,7 +1084,7 @@ namespace fastbotx {
                 
                 // Use emplace to avoid unnecessary copies
                 entryPtr.emplace(
-                        std::make_shared<std::string>(targetEntry->activity()->str()),
+                        InternedString::intern(targetEntry->activity()->str()).ptr(),
                         static_cast<int>(targetEntry->times()));
             }
             
@@ -333,14 +333,6 @@ namespace fastbotx {
         std::vector<ActionPtr> _previousActions;
 
     private:
-        // ========== Random Number Generators (Performance Optimization) ==========
-        /// Mersenne Twister random number generator, thread-safe and performant
-        mutable std::mt19937 _rng;
-        /// Uniform distribution for double in range [0,1)
-        mutable std::uniform_real_distribution<double> _uniformDist{0.0, 1.0};
-        /// Uniform distribution for float in range [0,1)
-        mutable std::uniform_real_distribution<float> _uniformFloatDist{0.0f, 1.0f};
-        
         // ========== Reuse Model Data ==========
         /**
          * @brief Reuse model
@@ -0,0 +1,130 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef ModelStorageScheduler_H_
+#define ModelStorageScheduler_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+
+namespace fastbotx {
+
+    /**
+     * @brief Decides when the model storage thread saves
+     *
+     * A save is due when the interval since the last save has elapsed, or earlier
+     * once the agent reported dirtyThreshold new reuse entries (but never sooner than
+     * minSpacing after the previous save, so a hot phase cannot turn into continuous
+     * I/O). shutdown() wakes the waiting thread at once.
+     *
+     * Shared by the agent and its storage thread, so the thread can wait on it
+     * without keeping the agent alive.
+     */
+    class ModelStorageScheduler {
+    public:
+        typedef std::chrono::steady_clock Clock;
+
+        enum class Trigger {
+            Interval,
+            Dirty,
+            Shutdown
+        };
+
+        ModelStorageScheduler(std::chrono::milliseconds interval, size_t dirtyThreshold,
+                              std::chrono::milliseconds minSpacing)
+                : _interval(interval), _dirtyThreshold(dirtyThreshold), _minSpacing(minSpacing),
+                  _lastSave(Clock::now()), _dirtyThresholdHint(dirtyThreshold) {
+        }
+
+        /// Change the schedule; a waiting thread re-evaluates at once
+        void configure(std::chrono::milliseconds interval, size_t dirtyThreshold) {
+            std::lock_guard<std::mutex> guard(this->_mutex);
+            this->_interval = interval;
+            this->_dirtyThreshold = dirtyThreshold;
+            this->_dirtyThresholdHint.store(dirtyThreshold, std::memory_order_relaxed);
+            this->_wakeup.notify_all();
+        }
+
+        /// Agent thread: count new entries; takes the mutex only when crossing the threshold
+        void noteChanges(size_t count) {
+            size_t before = this->_dirty.fetch_add(count, std::memory_order_relaxed);
+            size_t threshold = this->_dirtyThresholdHint.load(std::memory_order_relaxed);
+            if (threshold != 0 && before < threshold && before + count >= threshold) {
+                // Under the mutex so the waiter cannot miss it between its check and its wait
+                std::lock_guard<std::mutex> guard(this->_mutex);
+                this->_wakeup.notify_all();
+            }
+        }
+
+        /// Record a save done outside the storage thread (e.g. an explicit flush)
+        void saved() {
+            std::lock_guard<std::mutex> guard(this->_mutex);
+            this->_lastSave = Clock::now();
+            this->_dirty.store(0, std::memory_order_relaxed);
+        }
+
+        void shutdown() {
+            std::lock_guard<std::mutex> guard(this->_mutex);
+            this->_shutdown = true;
+            this->_wakeup.notify_all();
+        }
+
+        /**
+         * @brief Storage thread: block until the next save is due
+         *
+         * Resets the dirty count and the interval when a save is due; changes made
+         * while saving count towards the next one.
+         */
+        Trigger waitForNextSave() {
+            std::unique_lock<std::mutex> lock(this->_mutex);
+            while (true) {
+                if (this->_shutdown) {
+                    return Trigger::Shutdown;
+                }
+                Clock::time_point now = Clock::now();
+                Clock::time_point due = this->_lastSave + this->_interval;
+                Trigger trigger = Trigger::Interval;
+                if (this->_dirtyThreshold != 0 &&
+                    this->_dirty.load(std::memory_order_relaxed) >= this->_dirtyThreshold) {
+                    Clock::time_point dirtyDue = this->_lastSave + this->_minSpacing;
+                    if (dirtyDue < due) {
+                        due = dirtyDue;
+                        trigger = Trigger::Dirty;
+                    }
+                }
+                if (now >= due) {
+                    this->_lastSave = now;
+                    this->_dirty.store(0, std::memory_order_relaxed);
+                    return trigger;
+                }
+                this->_wakeup.wait_until(lock, due);
+            }
+        }
+
+    private:
+        std::mutex _mutex;
+        std::condition_variable _wakeup;
+        std::chrono::milliseconds _interval;
+        size_t _dirtyThreshold;
+        std::chrono::milliseconds _minSpacing;
+        Clock::time_point _lastSave;
+        bool _shutdown{false};
+
+        /// New entries since the last save (written by the agent thread without the mutex)
+        std::atomic<size_t> _dirty{0};
+        /// Copy of _dirtyThreshold readable without the mutex
+        std::atomic<size_t> _dirtyThresholdHint;
+    };
+
+    typedef std::shared_ptr<ModelStorageScheduler> ModelStorageSchedulerPtr;
+
+}
+
+#endif //ModelStorageScheduler_H_
@@ -0,0 +1,287 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef SharedReuseModel_CPP_
+#define SharedReuseModel_CPP_
+
+#include "SharedReuseModel.h"
+#include "../StringInterner.h"
+#include "MemoryFootprint.h"
+#include <utility>
+
+namespace fastbotx {
+
+    constexpr size_t SharedReuseModel::StripeCount;
+
+    SharedReuseModelPtr SharedReuseModel::forFile(const std::string &modelFilePath) {
+        static std::mutex registryLock;
+        static std::map<std::string, std::weak_ptr<SharedReuseModel>> registry;
+        std::lock_guard<std::mutex> guard(registryLock);
+        std::weak_ptr<SharedReuseModel> &slot = registry[modelFilePath];
+        SharedReuseModelPtr model = slot.lock();
+        if (!model) {
+            model = std::make_shared<SharedReuseModel>(modelFilePath);
+            slot = model;
+        }
+        return model;
+    }
+
+    SharedReuseModel::SharedReuseModel(std::string modelFilePath)
+            : _modelFilePath(std::move(modelFilePath)) {
+    }
+
+    bool SharedReuseModel::claimStorage(const void *owner, const ModelStorageSchedulerPtr &scheduler) {
+        std::lock_guard<std::mutex> guard(this->_ownerLock);
+        if (this->_storageOwner != nullptr && this->_storageOwner != owner) {
+            return false;
+        }
+        this->_storageOwner = owner;
+        this->_storageScheduler = scheduler;
+        return true;
+    }
+
+    void SharedReuseModel::releaseStorage(const void *owner) {
+        std::lock_guard<std::mutex> guard(this->_ownerLock);
+        if (this->_storageOwner == owner) {
+            this->_storageOwner = nullptr;
+            this->_storageScheduler.reset();
+        }
+    }
+
+    SharedReuseModel::Target *SharedReuseModel::findTarget(Targets &targets, InternedString activity) {
+        // Activity names are interned: id equality is string equality
+        for (Target &target: targets) {
+            if (target.activity == activity) {
+                return &target;
+            }
+        }
+        return nullptr;
+    }
+
+    InternedString SharedReuseModel::resolveBaseActivity(const char *activity, size_t length) const {
+        if (0 == length) {
+            // An empty name of a compact file starts where the next one does: not cached
+            return InternedString::intern(activity, length);
+        }
+        std::lock_guard<std::mutex> guard(this->_baseActivityLock);
+        auto cached = this->_baseActivityCache.find(activity);
+        if (cached != this->_baseActivityCache.end()) {
+            return cached->second;
+        }
+        InternedString interned = InternedString::intern(activity, length);
+        return this->_baseActivityCache.emplace(activity, interned).first->second;
+    }
+
+    bool SharedReuseModel::contains(uint64_t actionHash) const {
+        Stripe &stripe = stripeOf(actionHash);
+        {
+            std::shared_lock<std::shared_timed_mutex> guard(stripe.lock);
+            if (stripe.entries.count(actionHash) != 0) {
+                return true;
+            }
+        }
+        MappedReuseModelPtr mapped = this->base();
+        ReuseEntryView baseEntry;
+        return mapped && mapped->find(actionHash, baseEntry) && baseEntry.targetCount > 0;
+    }
+
+    void SharedReuseModel::countVisits(uint64_t actionHash, const InternedStringSet &visitedActivities,
+                                       int &total, int &unvisited) const {
+        total = 0;
+        unvisited = 0;
+        Stripe &stripe = stripeOf(actionHash);
+        {
+            std::shared_lock<std::shared_timed_mutex> guard(stripe.lock);
+            auto entry = stripe.entries.find(actionHash);
+            if (entry != stripe.entries.end()) {
+                for (const Target &target: entry->second) {
+                    int times = target.times.load(std::memory_order_relaxed);
+                    total += times;
+                    if (!visitedActivities.contains(target.activity)) {
+                        unvisited += times;
+                    }
+                }
+                return;
+            }
+        }
+        // Not reached in this session: the loaded file answers in place
+        MappedReuseModelPtr mapped = this->base();
+        ReuseEntryView baseEntry;
+        if (!mapped || !mapped->find(actionHash, baseEntry)) {
+            return;
+        }
+        mapped->forEachTarget(baseEntry, [&](const char *activity, size_t length, int times) {
+            total += times;
+            if (!visitedActivities.contains(resolveBaseActivity(activity, length))) {
+                unvisited += times;
+            }
+        });
+    }
+
+    int SharedReuseModel::addVisit(uint64_t actionHash, InternedString activity) {
+        Stripe &stripe = stripeOf(actionHash);
+        {
+            // Hot path: a pair seen before is counted without blocking other devices
+            std::shared_lock<std::shared_timed_mutex> guard(stripe.lock);
+            auto entry = stripe.entries.find(actionHash);
+            if (entry != stripe.entries.end()) {
+                Target *target = findTarget(entry->second, activity);
+                if (target) {
+                    return target->times.fetch_add(1, std::memory_order_relaxed) + 1;
+                }
+            }
+        }
+        int times = 1;
+        bool newPair = false;
+        {
+            std::unique_lock<std::shared_timed_mutex> guard(stripe.lock);
+            auto entry = stripe.entries.find(actionHash);
+            if (entry == stripe.entries.end()) {
+                // Action not in the overlay: start from its loaded file entry, if any
+                entry = stripe.entries.emplace(actionHash, Targets()).first;
+                MappedReuseModelPtr mapped = this->base();
+                ReuseEntryView baseEntry;
+                if (mapped && mapped->find(actionHash, baseEntry)) {
+                    Targets &targets = entry->second;
+                    mapped->forEachTarget(baseEntry, [&](const char *name, size_t length, int baseTimes) {
+                        targets.emplace_back(resolveBaseActivity(name, length), baseTimes, baseTimes);
+                    });
+                }
+            }
+            // Another device may have added the pair since the shared lookup
+            Target *target = findTarget(entry->second, activity);
+            if (target) {
+                times = target->times.fetch_add(1, std::memory_order_relaxed) + 1;
+            } else {
+                entry->second.emplace_back(activity, 1, 0);
+                newPair = true;
+            }
+        }
+        if (newPair) {
+            ModelStorageSchedulerPtr scheduler;
+            {
+                std::lock_guard<std::mutex> guard(this->_ownerLock);
+                scheduler = this->_storageScheduler;
+            }
+            if (scheduler) {
+                scheduler->noteChanges(1);
+            }
+        }
+        return times;
+    }
+
+    size_t SharedReuseModel::size() const {
+        size_t entries = 0;
+        for (const Stripe &stripe: this->_stripes) {
+            std::shared_lock<std::shared_timed_mutex> guard(stripe.lock);
+            entries += stripe.entries.size();
+        }
+        return entries;
+    }
+
+    void SharedReuseModel::accountMemory(MemoryFootprint &footprint) const {
+        if (!footprint.firstVisit(this)) {
+            return;
+        }
+        size_t entries = 0;
+        size_t bytes = 0;
+        for (const Stripe &stripe: this->_stripes) {
+            std::shared_lock<std::shared_timed_mutex> guard(stripe.lock);
+            entries += stripe.entries.size();
+            bytes += MemoryFootprint::bytesOf(stripe.entries);
+            for (const auto &entry: stripe.entries) {
+                bytes += MemoryFootprint::bytesOf(entry.second);
+            }
+        }
+        {
+            std::lock_guard<std::mutex> guard(this->_baseActivityLock);
+            bytes += MemoryFootprint::bytesOf(this->_baseActivityCache);
+        }
+        footprint.add("agent.reuseModel", entries, bytes);
+        // File-backed pages: resident only while read, and reclaimable
+        MappedReuseModelPtr mapped = this->base();
+        if (mapped) {
+            footprint.add("agent.reuseModelMapped", mapped->size(), mapped->byteSize());
+        }
+    }
+
+    void SharedReuseModel::reset() {
+        for (Stripe &stripe: this->_stripes) {
+            std::unique_lock<std::shared_timed_mutex> guard(stripe.lock);
+            stripe.entries.clear();
+        }
+        std::atomic_store(&this->_base, MappedReuseModelPtr());
+        std::lock_guard<std::mutex> guard(this->_baseActivityLock);
+        this->_baseActivityCache.clear();
+    }
+
+    void SharedReuseModel::setBase(const MappedReuseModelPtr &base) {
+        std::atomic_store(&this->_base, base);
+    }
+
+    void SharedReuseModel::putEntry(uint64_t actionHash, const ReuseEntryM &targets) {
+        Stripe &stripe = stripeOf(actionHash);
+        std::unique_lock<std::shared_timed_mutex> guard(stripe.lock);
+        Targets &entry = stripe.entries[actionHash];
+        entry.clear();
+        for (const auto &activityCount: targets) {
+            entry.emplace_back(InternedString::intern(*activityCount.first), activityCount.second,
+                               activityCount.second);
+        }
+    }
+
+    void SharedReuseModel::collectChanges(ReuseEntryIntMap &storageOverlay,
+                                          std::unordered_set<uint64_t> &changedActions) {
+        for (Stripe &stripe: this->_stripes) {
+            std::shared_lock<std::shared_timed_mutex> guard(stripe.lock);
+            for (auto &entry: stripe.entries) {
+                bool changed = false;
+                for (Target &target: entry.second) {
+                    int times = target.times.load(std::memory_order_relaxed);
+                    if (times != target.collectedTimes) {
+                        target.collectedTimes = times;
+                        changed = true;
+                    }
+                }
+                if (!changed) {
+                    continue;
+                }
+                ReuseEntryM &stored = storageOverlay[entry.first];
+                for (const Target &target: entry.second) {
+                    stored[target.activity.ptr()] = target.collectedTimes;
+                }
+                changedActions.insert(entry.first);
+            }
+        }
+    }
+
+    ReuseEntryM SharedReuseModel::readTargets(const ReuseEntry *entry) {
+        ReuseEntryM entryMap;
+        auto activityEntry = entry->targets();
+        for (flatbuffers::uoffset_t targetIndex = 0;
+             activityEntry && targetIndex < activityEntry->size(); targetIndex++) {
+            auto targetEntry = activityEntry->Get(targetIndex);
+            if (nullptr == targetEntry->activity()) {
+                continue;
+            }
+            entryMap.emplace(
+                    InternedString::intern(targetEntry->activity()->c_str(), targetEntry->activity()->size()).ptr(),
+                    static_cast<int>(targetEntry->times()));
+        }
+        return entryMap;
+    }
+
+    ReuseEntryM SharedReuseModel::readTargets(const MappedReuseModel &model, const ReuseEntryView &entry) {
+        ReuseEntryM entryMap;
+        model.forEachTarget(entry, [&entryMap](const char *activity, size_t length, int times) {
+            entryMap.emplace(InternedString::intern(activity, length).ptr(), times);
+        });
+        return entryMap;
+    }
+
+}
+
+#endif //SharedReuseModel_CPP_
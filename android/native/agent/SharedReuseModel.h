@@ -0,0 +1,187 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef SharedReuseModel_H_
+#define SharedReuseModel_H_
+
+#include "Base.h"
+#include "MappedReuseModel.h"
+#include "ModelStorageScheduler.h"
+#include "../StringInterner.h"
+#include <atomic>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace fastbotx {
+
+    class MemoryFootprint;
+
+    // ========== Reuse Model Data Structure Type Definitions ==========
+
+    /// Reuse entry mapping: Activity name -> visit count
+    typedef std::map<stringPtr, int> ReuseEntryM;
+
+    /// Reuse model mapping: action hash -> (Activity name -> visit count)
+    typedef std::map<uint64_t, ReuseEntryM> ReuseEntryIntMap;
+
+    /**
+     * @brief Reuse model of one model file, shared by every agent of the process using it
+     *
+     * Records which activities each action (identified by hash) reached and how often.
+     * The loaded file is queried in place (base); actions reached in this session live
+     * in an in-memory overlay whose entry supersedes the base entry of its action.
+     *
+     * Agents of several devices testing the same package update it concurrently, so
+     * they learn from each other's exploration instead of each overwriting the file
+     * with its own view. The overlay is split into stripes, each behind a
+     * shared_timed_mutex: counting one more visit of a known (action, activity) pair
+     * is an atomic increment under the shared lock, so devices only take a stripe
+     * exclusively to add an action or an activity it had not reached before.
+     *
+     * The first agent to claim the storage loads and writes the file; the other agents
+     * of the file only query and update the shared counts.
+     */
+    class SharedReuseModel {
+    public:
+        /// The reuse model of modelFilePath, created on first use and kept while agents hold it
+        static std::shared_ptr<SharedReuseModel> forFile(const std::string &modelFilePath);
+
+        explicit SharedReuseModel(std::string modelFilePath);
+
+        SharedReuseModel(const SharedReuseModel &) = delete;
+
+        SharedReuseModel &operator=(const SharedReuseModel &) = delete;
+
+        const std::string &modelFilePath() const { return this->_modelFilePath; }
+
+        /**
+         * @brief Make owner the one agent that loads and writes the file
+         *
+         * @param scheduler Told about the new (action, activity) pairs of every agent
+         * @return true if owner holds the storage now (it was free or owner's already)
+         */
+        bool claimStorage(const void *owner, const ModelStorageSchedulerPtr &scheduler);
+
+        /// Give the storage up; the file is no longer written in this process
+        void releaseStorage(const void *owner);
+
+        // ---------- Queries and updates (any thread) ----------
+
+        /// Whether actionHash reached any activity (base entries with Q-values only do not count)
+        bool contains(uint64_t actionHash) const;
+
+        /**
+         * @brief Visits recorded for actionHash: all of them, and those of activities not visited
+         *
+         * Each target is a bit probe of visitedActivities by its interned id.
+         */
+        void countVisits(uint64_t actionHash, const InternedStringSet &visitedActivities,
+                         int &total, int &unvisited) const;
+
+        /**
+         * @brief Count one more visit of actionHash reaching activity
+         *
+         * An action first reached in this session starts from its base entry.
+         *
+         * @return The visit count of the pair after this one
+         */
+        int addVisit(uint64_t actionHash, InternedString activity);
+
+        /// Actions in the overlay
+        size_t size() const;
+
+        /// Add the overlay and the mapped model file to footprint, once per model
+        void accountMemory(MemoryFootprint &footprint) const;
+
+        // ---------- Loading and saving (storage owner) ----------
+
+        /// Drop the overlay and the base
+        void reset();
+
+        /// Query a loaded model file in place from now on
+        void setBase(const MappedReuseModelPtr &base);
+
+        MappedReuseModelPtr base() const { return std::atomic_load(&this->_base); }
+
+        /// Replace the overlay entry of actionHash with targets already on disk
+        void putEntry(uint64_t actionHash, const ReuseEntryM &targets);
+
+        /**
+         * @brief Copy the entries counted since the last collect into storageOverlay
+         *
+         * Each changed action is copied whole (counts are absolute) and added to
+         * changedActions. Holds each stripe shared only, so updates go on meanwhile.
+         */
+        void collectChanges(ReuseEntryIntMap &storageOverlay, std::unordered_set<uint64_t> &changedActions);
+
+        /// Copy the targets of a file entry into an in-memory entry
+        static ReuseEntryM readTargets(const ReuseEntry *entry);
+
+        /// Copy the targets of a mapped file entry into an in-memory entry
+        static ReuseEntryM readTargets(const MappedReuseModel &model, const ReuseEntryView &entry);
+
+    private:
+        /// One activity reached by an action: (id, count), 12 bytes
+        struct Target {
+            Target(InternedString activityOfTarget, int timesOfTarget, int collectedTimesOfTarget)
+                    : activity(activityOfTarget), times(timesOfTarget),
+                      collectedTimes(collectedTimesOfTarget) {
+            }
+
+            InternedString activity;
+            std::atomic<int> times;
+            /// times when the storage owner last collected this target
+            int collectedTimes;
+        };
+
+        /// Targets of one action; a deque so that adding one never moves the others
+        typedef std::deque<Target> Targets;
+
+        struct Stripe {
+            mutable std::shared_timed_mutex lock;
+            std::unordered_map<uint64_t, Targets> entries;
+        };
+
+        static constexpr size_t StripeCount = 64;
+
+        Stripe &stripeOf(uint64_t actionHash) const {
+            return this->_stripes[(actionHash ^ (actionHash >> 29)) % StripeCount];
+        }
+
+        /// Target of activity in targets, or nullptr (caller holds the stripe)
+        static Target *findTarget(Targets &targets, InternedString activity);
+
+        /// Interned activity name of a target in the base
+        InternedString resolveBaseActivity(const char *activity, size_t length) const;
+
+        std::string _modelFilePath;
+
+        mutable Stripe _stripes[StripeCount];
+
+        /// Model file loaded at startup (atomic_load / atomic_store only)
+        MappedReuseModelPtr _base;
+
+        /// Activity names of _base (by their address in the mapping) resolved to interned pointers
+        mutable std::unordered_map<const char *, InternedString> _baseActivityCache;
+        mutable std::mutex _baseActivityLock;
+
+        /// Agent holding the storage, and its scheduler (guarded by _ownerLock)
+        const void *_storageOwner{nullptr};
+        ModelStorageSchedulerPtr _storageScheduler;
+        mutable std::mutex _ownerLock;
+    };
+
+    typedef std::shared_ptr<SharedReuseModel> SharedReuseModelPtr;
+
+}
+
+#endif //SharedReuseModel_H_
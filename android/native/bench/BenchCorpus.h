@@ -0,0 +1,93 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef BenchCorpus_H_
+#define BenchCorpus_H_
+
+#include "../utils.hpp"
+#include "../model/GuiTraceRecorder.h"
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace fastbotx {
+    namespace bench {
+
+        /// One recorded page of a host benchmark corpus
+        struct Page {
+            std::string activity;
+            std::vector<char> dump;
+            bool binary{false};
+        };
+
+        inline bool readFile(const std::string &path, std::vector<char> &content) {
+            std::ifstream file(path, std::ios::binary);
+            if (!file) {
+                return false;
+            }
+            content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            return true;
+        }
+
+        inline bool isBinaryDump(const std::vector<char> &dump) {
+            return dump.size() >= 4 && dump[0] == 'F' && dump[1] == 'B' && dump[2] == 0 &&
+                   (dump[3] == 1 || dump[3] == 2 || dump[3] == 3);
+        }
+
+        /**
+         * @brief Load a corpus, either a GUI trace (see GuiTraceRecorder) or a directory
+         * holding corpus.txt, one "<activity>\t<dump file>" line per page in replay order
+         *
+         * Empty lines and lines starting with '#' are skipped; dump files are relative to
+         * the directory.
+         */
+        inline bool loadCorpus(const std::string &path, std::vector<Page> &pages) {
+            std::vector<GuiTraceRecord> records;
+            if (GuiTraceRecorder::read(path, records)) {
+                for (GuiTraceRecord &record: records) {
+                    Page page;
+                    page.activity = std::move(record.activity);
+                    page.dump.assign(record.dump.begin(), record.dump.end());
+                    page.binary = isBinaryDump(page.dump);
+                    pages.push_back(std::move(page));
+                }
+                return !pages.empty();
+            }
+            std::ifstream manifest(path + "/corpus.txt");
+            if (!manifest) {
+                BLOGE("corpus: %s is neither a GUI trace nor a directory with corpus.txt", path.c_str());
+                return false;
+            }
+            std::string line;
+            int lineNumber = 0;
+            while (std::getline(manifest, line)) {
+                lineNumber++;
+                if (line.empty() || line[0] == '#') {
+                    continue;
+                }
+                size_t tab = line.find('\t');
+                if (tab == std::string::npos) {
+                    BLOGE("corpus: corpus.txt:%d: expected <activity>\\t<dump file>", lineNumber);
+                    return false;
+                }
+                Page page;
+                page.activity = line.substr(0, tab);
+                std::string dumpPath = path + "/" + line.substr(tab + 1);
+                if (!readFile(dumpPath, page.dump) || page.dump.empty()) {
+                    BLOGE("corpus: cannot read dump %s", dumpPath.c_str());
+                    return false;
+                }
+                page.binary = isBinaryDump(page.dump);
+                pages.push_back(std::move(page));
+            }
+            return !pages.empty();
+        }
+
+    }
+}
+
+#endif //BenchCorpus_H_
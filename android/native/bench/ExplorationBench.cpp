@@ -0,0 +1,353 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+/**
+ * Host-side exploration-efficiency benchmark (Linux / macOS).
+ *
+ * fastbot_replay_bench feeds the recorded pages in their recorded order, whatever the
+ * agent decides, so it measures latency but not exploration. Here the corpus becomes a
+ * simulated app the agent drives: every distinct page (activity and Element::hash())
+ * is a screen, and the transitions recorded between consecutive pages are its edges.
+ * An operate on a screen leads to:
+ *   - BACK (or no operate): the screen it was reached from, the same screen at the root
+ *   - START / RESTART / CLEAN_RESTART: the first screen of the corpus
+ *   - anything else: one recorded successor, or the same screen (the action did nothing),
+ *     picked by a hash of the action type and target bounds. Distinct actions thus reach
+ *     distinct successors, and an agent that keeps choosing new actions covers more.
+ *
+ * For every agent configuration the run reports coverage curves, the visited activities
+ * (Graph::getVisitedActivities), distinct states and distinct visited actions, against
+ * the steps and the cumulative native CPU time, and when the last new activity was
+ * reached. That CPU time is the CPU time of the process (the decision thread and the
+ * model's background threads) minus the time the driver itself spends cloning pages,
+ * picking transitions and sampling. Parsing is not part of it: pages are cloned from a
+ * decoded copy (fastbot_replay_bench measures the parsers).
+ *
+ * Corpus: as for fastbot_replay_bench, a GUI trace or a directory holding corpus.txt.
+ *
+ * Usage: fastbot_exploration_bench <corpus dir | GUI trace> [--steps N] [--seed S]
+ *            [--n-step N[,N...]] [--samples N] [--max-states N]
+ *
+ * Each --n-step value is one DoubleSarsaAgent configuration (default: the agent's own
+ * N-step window). Every configuration starts from an empty model and the same seed, so
+ * runs are reproducible and differ only by the configuration.
+ */
+
+#include "../Base.h"
+#include "../utils.hpp"
+#include "../Random.h"
+#include "../agent/DoubleSarsaAgent.h"
+#include "../model/Model.h"
+#include "../desc/DeltaDumpDecoder.h"
+#include "../desc/Element.h"
+#include "../desc/ElementArena.h"
+#include "BenchCorpus.h"
+#include <algorithm>
+#include <ctime>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+    using fastbotx::bench::Page;
+    using fastbotx::bench::loadCorpus;
+
+    double cpuMs(clockid_t clock) {
+        struct timespec now{};
+        clock_gettime(clock, &now);
+        return static_cast<double>(now.tv_sec) * 1e3 + static_cast<double>(now.tv_nsec) / 1e6;
+    }
+
+    /// One screen of the simulated app, kept as a decoded tree that each visit clones
+    struct Screen {
+        std::string activity;
+        /// Declared before tree: outlives it
+        std::unique_ptr<fastbotx::ElementArena> arena;
+        fastbotx::ElementPtr tree;
+        /// Screens recorded right after this one, in order of first appearance
+        std::vector<size_t> successors;
+    };
+
+    /// The corpus as a navigable app (see the file comment for the transition rules)
+    class SimulatedApp {
+    public:
+        bool build(const std::vector<Page> &pages) {
+            fastbotx::DeltaDumpDecoder deltaDecoder;
+            std::unordered_map<std::string, size_t> screenIds;
+            size_t previous = SIZE_MAX;
+            for (const Page &page: pages) {
+                fastbotx::ElementPtr element;
+                if (fastbotx::Element::isBinaryDelta(page.dump.data(), page.dump.size())) {
+                    element = deltaDecoder.decode(page.dump.data(), page.dump.size());
+                } else {
+                    element = page.binary
+                              ? fastbotx::Element::createFromBinary(page.dump.data(), page.dump.size())
+                              : fastbotx::Element::createFromXml(page.dump.data(), page.dump.size());
+                }
+                if (nullptr == element) {
+                    BLOGE("exploration: cannot parse a dump of %s", page.activity.c_str());
+                    previous = SIZE_MAX;
+                    continue;
+                }
+                std::string key = page.activity + '\t' + std::to_string(element->hash());
+                auto found = screenIds.find(key);
+                size_t id;
+                if (found == screenIds.end()) {
+                    id = this->_screens.size();
+                    Screen screen;
+                    screen.activity = page.activity;
+                    screen.arena.reset(new fastbotx::ElementArena());
+                    screen.tree = element->cloneInto(screen.arena.get(), nullptr);
+                    this->_screens.push_back(std::move(screen));
+                    screenIds.emplace(key, id);
+                } else {
+                    id = found->second;
+                }
+                if (previous != SIZE_MAX) {
+                    std::vector<size_t> &successors = this->_screens[previous].successors;
+                    if (std::find(successors.begin(), successors.end(), id) == successors.end()) {
+                        successors.push_back(id);
+                    }
+                }
+                previous = id;
+            }
+            return !this->_screens.empty();
+        }
+
+        size_t size() const { return this->_screens.size(); }
+
+        const Screen &screen(size_t id) const { return this->_screens[id]; }
+
+        /// A fresh tree of the screen, in the thread's dump arena as a parsed dump would be
+        fastbotx::ElementPtr open(size_t id) const {
+            fastbotx::ElementArena::recycle();
+            return this->_screens[id].tree->cloneInto(fastbotx::ElementArena::current(), nullptr);
+        }
+
+        /// Screen that operate on screen current leads to; backStack holds the screens left
+        size_t next(size_t current, const fastbotx::OperatePtr &operate, std::vector<size_t> &backStack) const {
+            if (nullptr == operate || operate->act == fastbotx::ActionType::BACK) {
+                if (backStack.empty()) {
+                    return current;
+                }
+                size_t back = backStack.back();
+                backStack.pop_back();
+                return back;
+            }
+            switch (operate->act) {
+                case fastbotx::ActionType::START:
+                case fastbotx::ActionType::RESTART:
+                case fastbotx::ActionType::CLEAN_RESTART:
+                    backStack.clear();
+                    return 0;
+                case fastbotx::ActionType::NOP:
+                    return current;
+                default:
+                    break;
+            }
+            // FNV-1a of the action type and target, so one action always does the same thing
+            int fields[] = {static_cast<int>(operate->act), operate->pos.left, operate->pos.top,
+                            operate->pos.right, operate->pos.bottom};
+            uint64_t key = 1469598103934665603ULL;
+            const auto *bytes = reinterpret_cast<const unsigned char *>(fields);
+            for (size_t i = 0; i < sizeof(fields); i++) {
+                key = (key ^ bytes[i]) * 1099511628211ULL;
+            }
+            const std::vector<size_t> &successors = this->_screens[current].successors;
+            size_t choice = static_cast<size_t>(key % (successors.size() + 1));
+            if (choice == successors.size()) {
+                return current;
+            }
+            backStack.push_back(current);
+            return successors[choice];
+        }
+
+    private:
+        std::vector<Screen> _screens;
+    };
+
+    /// Coverage after a number of steps
+    struct CurvePoint {
+        long step{0};
+        double cpuMs{0};
+        size_t activities{0};
+        size_t states{0};
+        size_t actions{0};
+        size_t visitedActions{0};
+    };
+
+    CurvePoint sampleCoverage(const fastbotx::ModelPtr &model, long step, double cpu) {
+        CurvePoint point;
+        point.step = step;
+        point.cpuMs = cpu;
+        const fastbotx::GraphPtr &graph = model->getGraph();
+        fastbotx::Graph::ReadLock graphLock = graph->readLock();
+        point.activities = graph->getVisitedActivities().size();
+        point.states = graph->stateSize();
+        point.actions = graph->getActionRecordCount();
+        point.visitedActions = graph->getVisitedActionCount();
+        return point;
+    }
+
+    /// Coverage curve of one configuration
+    struct ExplorationRun {
+        std::vector<CurvePoint> curve;
+        /// Step and CPU time at which the last new activity was reached
+        long lastNewActivityStep{0};
+        double lastNewActivityCpuMs{0};
+    };
+
+    /// Drive the simulated app for steps steps under one N-step window
+    ExplorationRun explore(const SimulatedApp &app, uint64_t seed, int nStep, long steps, long samples,
+                           long maxStates) {
+        fastbotx::RandomStreams::setGlobalSeed(seed);
+        fastbotx::ModelPtr model = fastbotx::Model::create();
+        fastbotx::AbstractAgentPtr agent = model->addAgent("", fastbotx::AlgorithmType::DoubleSarsa);
+        auto doubleSarsa = std::dynamic_pointer_cast<fastbotx::DoubleSarsaAgent>(agent);
+        if (doubleSarsa && nStep > 0) {
+            doubleSarsa->setNStep(nStep);
+        }
+        if (maxStates > 0) {
+            fastbotx::Graph::WriteLock graphLock = model->getGraph()->writeLock();
+            model->getGraph()->setMaxStates(static_cast<size_t>(maxStates));
+        }
+
+        long sampleEvery = std::max(1L, steps / std::max(1L, samples));
+        ExplorationRun run;
+        size_t activities = 0;
+        std::vector<size_t> backStack;
+        size_t current = 0;
+        double driverMs = 0;
+        double processStart = cpuMs(CLOCK_PROCESS_CPUTIME_ID);
+        for (long step = 1; step <= steps; step++) {
+            double driverStart = cpuMs(CLOCK_THREAD_CPUTIME_ID);
+            fastbotx::ElementPtr element = app.open(current);
+            driverMs += cpuMs(CLOCK_THREAD_CPUTIME_ID) - driverStart;
+
+            fastbotx::OperatePtr operate = model->getOperateOpt(element, app.screen(current).activity);
+
+            driverStart = cpuMs(CLOCK_THREAD_CPUTIME_ID);
+            element.reset();
+            current = app.next(current, operate, backStack);
+            bool sample = step % sampleEvery == 0 || step == steps;
+            size_t visited;
+            {
+                fastbotx::Graph::ReadLock graphLock = model->getGraph()->readLock();
+                visited = model->getGraph()->getVisitedActivities().size();
+            }
+            if (sample || visited > activities) {
+                double cpu = cpuMs(CLOCK_PROCESS_CPUTIME_ID) - processStart - driverMs;
+                if (visited > activities) {
+                    activities = visited;
+                    run.lastNewActivityStep = step;
+                    run.lastNewActivityCpuMs = cpu;
+                }
+                if (sample) {
+                    run.curve.push_back(sampleCoverage(model, step, cpu));
+                }
+            }
+            driverMs += cpuMs(CLOCK_THREAD_CPUTIME_ID) - driverStart;
+        }
+        model->finishPendingSteps();
+        return run;
+    }
+
+    bool parseNSteps(const char *list, std::vector<int> &nSteps) {
+        nSteps.clear();
+        for (const char *cursor = list; *cursor;) {
+            char *end = nullptr;
+            long value = std::strtol(cursor, &end, 10);
+            if (end == cursor || value <= 0 || value > fastbotx::DoubleSarsaRLConstants::MaxNStep) {
+                return false;
+            }
+            nSteps.push_back(static_cast<int>(value));
+            cursor = (*end == ',') ? end + 1 : end;
+            if (*end != ',' && *end != '\0') {
+                return false;
+            }
+        }
+        return !nSteps.empty();
+    }
+
+    void printUsage(const char *program) {
+        printf("usage: %s <corpus dir | GUI trace> [--steps N] [--seed S] [--n-step N[,N...]] [--samples N]"
+               " [--max-states N]\n", program);
+    }
+
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    std::string corpusPath = argv[1];
+    long steps = 500;
+    long samples = 20;
+    long maxStates = 0;
+    uint64_t seed = 1;
+    std::vector<int> nSteps{fastbotx::DoubleSarsaRLConstants::NStep};
+    for (int i = 2; i < argc; i++) {
+        if (0 == strcmp(argv[i], "--steps") && i + 1 < argc) {
+            steps = std::max(1L, atol(argv[++i]));
+        } else if (0 == strcmp(argv[i], "--seed") && i + 1 < argc) {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (0 == strcmp(argv[i], "--n-step") && i + 1 < argc) {
+            if (!parseNSteps(argv[++i], nSteps)) {
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (0 == strcmp(argv[i], "--samples") && i + 1 < argc) {
+            samples = std::max(1L, atol(argv[++i]));
+        } else if (0 == strcmp(argv[i], "--max-states") && i + 1 < argc) {
+            maxStates = std::max(0L, atol(argv[++i]));
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<Page> pages;
+    if (!loadCorpus(corpusPath, pages)) {
+        return 1;
+    }
+    SimulatedApp app;
+    if (!app.build(pages)) {
+        return 1;
+    }
+    size_t activities = 0;
+    {
+        std::unordered_map<std::string, bool> seen;
+        for (size_t id = 0; id < app.size(); id++) {
+            activities += seen.emplace(app.screen(id).activity, true).second ? 1 : 0;
+        }
+    }
+    printf("simulated app: %zu screens in %zu activities from %zu pages, %ld steps, seed %llu\n",
+           app.size(), activities, pages.size(), steps, static_cast<unsigned long long>(seed));
+
+    for (int nStep: nSteps) {
+        ExplorationRun run = explore(app, seed, nStep, steps, samples, maxStates);
+        const CurvePoint &last = run.curve.back();
+        printf("\nconfig n-step=%d: %.3f ms cpu, %.3f ms/step, %zu/%zu activities, %zu states, "
+               "%zu/%zu actions visited, %.3f activities per cpu second\n",
+               nStep, last.cpuMs, last.cpuMs / static_cast<double>(last.step), last.activities, activities,
+               last.states, last.visitedActions, last.actions,
+               last.cpuMs > 0 ? last.activities * 1000.0 / last.cpuMs : 0.0);
+        printf("last new activity: step %ld, %.3f ms cpu\n", run.lastNewActivityStep, run.lastNewActivityCpuMs);
+        printf("step\tcpu_ms\tactivities\tstates\tactions\tvisited_actions\n");
+        for (const CurvePoint &point: run.curve) {
+            printf("%ld\t%.3f\t%zu\t%zu\t%zu\t%zu\n", point.step, point.cpuMs, point.activities, point.states,
+                   point.actions, point.visitedActions);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,726 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+/**
+ * Microbenchmarks of the core data structures (Linux / macOS).
+ *
+ * Each benchmark runs for every size it is registered with (tree nodes, graph states,
+ * reuse model entries...) and is repeated until it has run for MinRunTimeMs; the time
+ * per iteration, and per item where an iteration handles several, is printed.
+ * The registration and State mimic Google Benchmark, which is not vendored here; the
+ * timed loop is a while over State::next(), which needs no unused loop variable:
+ *
+ *   static void benchParse(microbench::State &state) {
+ *       auto input = makeInput(state.range());        // not timed
+ *       while (state.next()) { parse(input); }        // timed
+ *   }
+ *   MICROBENCH(benchParse)->range({64, 512, 4096});
+ *
+ * Usage: fastbot_micro_bench [name filter] [--logs]
+ * The native logs (BLOG, on stdout) are discarded unless --logs is given.
+ */
+
+#include "../Base.h"
+#include "../utils.hpp"
+#include "../desc/DeltaDumpDecoder.h"
+#include "../desc/Element.h"
+#include "../desc/StateFactory.h"
+#include "../events/Preference.h"
+#include "../model/Graph.h"
+#include "../model/Model.h"
+#include "../agent/DoubleSarsaAgent.h"
+#include "../storage/ReuseModel_generated.h"
+#include <unistd.h>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace microbench {
+
+    /// Iterations of one benchmark run and its timer
+    class State {
+    public:
+        State(int64_t range, size_t iterations) : _range(range), _iterations(iterations), _left(iterations) {
+        }
+
+        int64_t range() const { return this->_range; }
+
+        /// Items handled per iteration, for the per-item time (default 1)
+        void setItemsPerIteration(int64_t items) { this->_itemsPerIteration = items; }
+
+        int64_t itemsPerIteration() const { return this->_itemsPerIteration; }
+
+        /// Exclude per-iteration setup from the timing
+        void pauseTiming() {
+            this->_elapsed += std::chrono::steady_clock::now() - this->_start;
+        }
+
+        void resumeTiming() {
+            this->_start = std::chrono::steady_clock::now();
+        }
+
+        double elapsedNs() const {
+            return std::chrono::duration<double, std::nano>(this->_elapsed).count();
+        }
+
+        size_t iterations() const { return this->_iterations; }
+
+        /// Loop condition of the timed loop: starts the clock on the first call and stops it after the last
+        bool next() {
+            if (this->_left == this->_iterations) {
+                this->resumeTiming();
+            }
+            if (this->_left > 0) {
+                this->_left--;
+                return true;
+            }
+            this->pauseTiming();
+            return false;
+        }
+
+    private:
+        int64_t _range;
+        size_t _iterations;
+        /// Iterations next() has still to hand out
+        size_t _left;
+        int64_t _itemsPerIteration{1};
+        std::chrono::steady_clock::time_point _start;
+        std::chrono::steady_clock::duration _elapsed{0};
+    };
+
+    typedef std::function<void(State &)> BenchmarkFunction;
+
+    class Benchmark {
+    public:
+        Benchmark(const char *name, BenchmarkFunction function) : _name(name), _function(std::move(function)) {
+        }
+
+        Benchmark *range(std::initializer_list<int64_t> ranges) {
+            this->_ranges.insert(this->_ranges.end(), ranges.begin(), ranges.end());
+            return this;
+        }
+
+        void run() const;
+
+        const std::string &name() const { return this->_name; }
+
+    private:
+        std::string _name;
+        BenchmarkFunction _function;
+        std::vector<int64_t> _ranges;
+    };
+
+    /// Where results go: stdout, which the native logs no longer share
+    FILE *report = stdout;
+
+    constexpr double MinRunTimeMs = 200;
+    constexpr size_t MaxIterations = 10000000;
+
+    std::vector<std::unique_ptr<Benchmark>> &registry() {
+        static std::vector<std::unique_ptr<Benchmark>> benchmarks;
+        return benchmarks;
+    }
+
+    Benchmark *registerBenchmark(const char *name, BenchmarkFunction function) {
+        registry().emplace_back(new Benchmark(name, std::move(function)));
+        return registry().back().get();
+    }
+
+    void Benchmark::run() const {
+        std::vector<int64_t> ranges = this->_ranges.empty() ? std::vector<int64_t>{0} : this->_ranges;
+        for (int64_t range: ranges) {
+            // Grow the iteration count until the run is long enough to be measured
+            size_t iterations = 1;
+            while (true) {
+                State state(range, iterations);
+                this->_function(state);
+                double elapsedMs = state.elapsedNs() / 1e6;
+                if (elapsedMs >= MinRunTimeMs || iterations >= MaxIterations) {
+                    double perIteration = state.elapsedNs() / iterations;
+                    fprintf(report, "%-36s %14.0f ns %14.1f ns/item %10zu iterations\n",
+                           (this->_name + "/" + std::to_string(range)).c_str(), perIteration,
+                           perIteration / std::max<int64_t>(1, state.itemsPerIteration()), iterations);
+                    fflush(report);
+                    break;
+                }
+                double scale = elapsedMs > 0 ? MinRunTimeMs * 1.4 / elapsedMs : 100;
+                iterations = std::min(MaxIterations, static_cast<size_t>(iterations * std::min(100.0, std::max(2.0, scale))));
+            }
+        }
+    }
+
+}
+
+#define MICROBENCH_CONCAT_(a, b) a##b
+#define MICROBENCH_CONCAT(a, b) MICROBENCH_CONCAT_(a, b)
+#define MICROBENCH(function) \
+    static microbench::Benchmark *MICROBENCH_CONCAT(microbench_, __LINE__) = \
+        microbench::registerBenchmark(#function, function)
+
+namespace {
+
+    using namespace fastbotx;
+
+    const char *BenchPackage = "com.bench";
+    const int ScreenWidth = 1080;
+    const int ScreenHeight = 2340;
+
+    /// Deterministic page: nodes widgets in a 4-ary tree, ids and texts unique to variant
+    class PageGenerator {
+    public:
+        PageGenerator(int nodes, int variant) : _nodes(nodes), _variant(variant) {
+        }
+
+        std::string xml() {
+            this->_next = 0;
+            std::string out = "<?xml version=\"1.0\" encoding=\"UTF-8\"?><hierarchy rotation=\"0\">";
+            this->appendXml(out, 0);
+            out += "</hierarchy>";
+            return out;
+        }
+
+        /// The same tree in the "FB\0\1" format of dumpBinary
+        std::string binary() {
+            this->_next = 0;
+            std::string out("FB\0\1", 4);
+            this->appendBinary(out, 0);
+            return out;
+        }
+
+        /// The same tree in the "FB\0\2" format: one string table, varints, bounds relative to the parent
+        std::string binaryV2() {
+            this->_next = 0;
+            StringTable table;
+            std::string nodes;
+            int32_t screen[4] = {0, 0, 0, 0};
+            this->appendBinaryV2(nodes, 0, screen, table);
+            std::string out("FB\0\2", 4);
+            putVarint(out, static_cast<uint64_t>(this->_next));
+            putVarint(out, table.strings.size());
+            for (const std::string &value: table.strings) {
+                putVarint(out, value.size());
+                out += value;
+            }
+            return out + nodes;
+        }
+
+        /**
+         * The same tree as a delta dump ("FB\0\3") whose node changed has a new text: with a base,
+         * every subtree not holding that node is a reference into the base dump's tree
+         */
+        std::string binaryDelta(uint64_t dumpId, uint64_t baseDumpId, int changed) {
+            this->_next = 0;
+            this->_changed = changed;
+            StringTable table;
+            std::string nodes;
+            int32_t screen[4] = {0, 0, 0, 0};
+            this->_delta = true;
+            this->_referenceBase = baseDumpId != 0;
+            this->appendBinaryV2(nodes, 0, screen, table);
+            this->_delta = false;
+            this->_changed = -1;
+            std::string out("FB\0\3", 4);
+            putVarint(out, dumpId);
+            putVarint(out, baseDumpId);
+            putVarint(out, static_cast<uint64_t>(this->subtreeEnd(0)));
+            putVarint(out, table.strings.size());
+            for (const std::string &value: table.strings) {
+                putVarint(out, value.size());
+                out += value;
+            }
+            return out + nodes;
+        }
+
+    private:
+        struct StringTable {
+            std::unordered_map<std::string, uint64_t> indexes;
+            std::vector<std::string> strings;
+
+            uint64_t indexOf(const std::string &value) {
+                auto inserted = this->indexes.emplace(value, this->strings.size());
+                if (inserted.second) {
+                    this->strings.push_back(value);
+                }
+                return inserted.first->second;
+            }
+        };
+
+        struct Node {
+            int left, top, right, bottom;
+            bool clickable;
+            std::string text, resourceId, className;
+        };
+
+        Node describe(int id) const {
+            Node node;
+            node.left = (id * 37) % (ScreenWidth - 200);
+            node.top = (id * 53) % (ScreenHeight - 120);
+            node.right = node.left + 200;
+            node.bottom = node.top + 120;
+            node.clickable = id % 3 != 0;
+            node.text = "item " + std::to_string(this->_variant) + "." + std::to_string(id) +
+                        (id == this->_changed ? "*" : "");
+            node.resourceId = std::string(BenchPackage) + ":id/w" + std::to_string(this->_variant) + "_" +
+                              std::to_string(id);
+            node.className = node.clickable ? "android.widget.Button" : "android.widget.TextView";
+            return node;
+        }
+
+        /// Children of the node taking id; the tree is filled breadth-first by four
+        int childrenOf(int id) const {
+            int first = id * 4 + 1;
+            return std::max(0, std::min(4, this->_nodes - first));
+        }
+
+        void appendXml(std::string &out, int index) {
+            int id = this->_next++;
+            Node node = this->describe(id);
+            out += "<node index=\"" + std::to_string(index) + "\" text=\"" + node.text + "\" resource-id=\"" +
+                   node.resourceId + "\" class=\"" + node.className + "\" package=\"" + BenchPackage +
+                   "\" content-desc=\"\" checkable=\"false\" checked=\"false\" clickable=\"" +
+                   (node.clickable ? "true" : "false") +
+                   "\" enabled=\"true\" focusable=\"false\" focused=\"false\" scrollable=\"false\" "
+                   "long-clickable=\"false\" password=\"false\" selected=\"false\" bounds=\"[" +
+                   std::to_string(node.left) + "," + std::to_string(node.top) + "][" + std::to_string(node.right) +
+                   "," + std::to_string(node.bottom) + "]\">";
+            int children = this->childrenOf(id);
+            for (int child = 0; child < children; child++) {
+                this->appendXml(out, child);
+            }
+            out += "</node>";
+        }
+
+        static void put(std::string &out, const void *value, size_t size) {
+            out.append(static_cast<const char *>(value), size);
+        }
+
+        static void putString(std::string &out, uint8_t tag, const std::string &value) {
+            auto length = static_cast<uint16_t>(value.size());
+            put(out, &tag, 1);
+            put(out, &length, 2);
+            out += value;
+        }
+
+        void appendBinary(std::string &out, int index) {
+            int id = this->_next++;
+            Node node = this->describe(id);
+            int32_t bounds[4] = {node.left, node.top, node.right, node.bottom};
+            auto nodeIndex = static_cast<int16_t>(index);
+            uint16_t flags = 8 | (node.clickable ? 4 : 0);  // enabled, clickable
+            uint8_t strings = 4;
+            put(out, bounds, sizeof(bounds));
+            put(out, &nodeIndex, 2);
+            put(out, &flags, 2);
+            put(out, &strings, 1);
+            putString(out, 0, node.text);
+            putString(out, 1, node.resourceId);
+            putString(out, 2, node.className);
+            putString(out, 3, BenchPackage);
+            auto children = static_cast<uint16_t>(this->childrenOf(id));
+            put(out, &children, 2);
+            for (int child = 0; child < children; child++) {
+                this->appendBinary(out, child);
+            }
+        }
+
+        static void putVarint(std::string &out, uint64_t value) {
+            while (value >= 0x80) {
+                out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+                value >>= 7;
+            }
+            out.push_back(static_cast<char>(value));
+        }
+
+        /// Ids are handed out in pre-order, so a subtree takes the ids from its root's to this one
+        int subtreeEnd(int id) const {
+            int end = id + 1;
+            int children = this->childrenOf(id);
+            for (int child = 0; child < children; child++) {
+                end = this->subtreeEnd(end);
+            }
+            return end;
+        }
+
+        void appendBinaryV2(std::string &out, int index, const int32_t (&parentBounds)[4], StringTable &table) {
+            int id = this->_next++;
+            if (this->_delta) {
+                int end = this->subtreeEnd(id);
+                if (this->_referenceBase && (this->_changed < id || this->_changed >= end)) {
+                    // Same tree shape in the base dump: the subtree's position there is its root's id
+                    this->_next = end;
+                    putVarint(out, static_cast<uint64_t>(id) + 1);
+                    putVarint(out, static_cast<uint64_t>(index));
+                    return;
+                }
+                putVarint(out, 0);
+            }
+            Node node = this->describe(id);
+            int32_t bounds[4] = {node.left, node.top, node.right, node.bottom};
+            for (int side = 0; side < 4; side++) {
+                int64_t delta = static_cast<int64_t>(bounds[side]) - parentBounds[side];
+                putVarint(out, (static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63));
+            }
+            putVarint(out, static_cast<uint64_t>(index));
+            putVarint(out, 8 | (node.clickable ? 4 : 0));  // enabled, clickable
+            out.push_back(0xf);  // text, resource-id, class, package
+            putVarint(out, table.indexOf(node.text));
+            putVarint(out, table.indexOf(node.resourceId));
+            putVarint(out, table.indexOf(node.className));
+            putVarint(out, table.indexOf(BenchPackage));
+            int children = this->childrenOf(id);
+            putVarint(out, static_cast<uint64_t>(children));
+            for (int child = 0; child < children; child++) {
+                this->appendBinaryV2(out, child, bounds, table);
+            }
+        }
+
+        int _nodes;
+        int _variant;
+        int _next{0};
+        /// Node whose text binaryDelta changes, -1 for none
+        int _changed{-1};
+        bool _delta{false};
+        bool _referenceBase{false};
+    };
+
+    const stringPtr &benchActivity() {
+        static stringPtr activity = std::make_shared<std::string>("com.bench.MainActivity");
+        return activity;
+    }
+
+    ElementPtr parsePage(int nodes, int variant) {
+        std::string xml = PageGenerator(nodes, variant).xml();
+        return Element::createFromXml(xml);
+    }
+
+    /// Model whose agent has taken steps over pages distinct pages
+    ModelPtr steppedModel(int pages, int nodesPerPage) {
+        ModelPtr model = Model::create();
+        model->addAgent("", AlgorithmType::DoubleSarsa);
+        for (int page = 0; page < pages; page++) {
+            model->getOperateOpt(parsePage(nodesPerPage, page), *benchActivity());
+        }
+        model->finishPendingSteps();
+        return model;
+    }
+
+    /// Model file of entries actions with Q-values, each reaching two activities
+    void writeReuseModelFile(const std::string &path, int entries) {
+        flatbuffers::FlatBufferBuilder builder;
+        std::vector<flatbuffers::Offset<ReuseEntry>> reuseEntries;
+        reuseEntries.reserve(static_cast<size_t>(entries));
+        for (int entry = 0; entry < entries; entry++) {
+            std::vector<flatbuffers::Offset<ActivityTimes>> targets;
+            for (int target = 0; target < 2; target++) {
+                std::string activity = "com.bench.Activity" + std::to_string((entry + target) % 64);
+                targets.push_back(CreateActivityTimes(builder, builder.CreateString(activity), entry % 7 + 1));
+            }
+            uint64_t actionHash = (static_cast<uint64_t>(entry) + 1) * 0x9E3779B97F4A7C15ULL;
+            reuseEntries.push_back(CreateReuseEntry(builder, actionHash, builder.CreateVector(targets),
+                                                    0.1 * (entry % 10), 0.05 * (entry % 10),
+                                                    static_cast<uint32_t>(entry % 5)));
+        }
+        builder.Finish(CreateReuseModel(builder, builder.CreateVectorOfSortedTables(&reuseEntries), 2, 0));
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(builder.GetBufferPointer()), builder.GetSize());
+    }
+
+    std::shared_ptr<DoubleSarsaAgent> agentOf(const ModelPtr &model) {
+        return std::dynamic_pointer_cast<DoubleSarsaAgent>(model->getAgent(""));
+    }
+
+    std::string benchFilePath(const std::string &name) {
+        const char *directory = getenv("TMPDIR");
+        return std::string(directory && *directory ? directory : "/tmp") + "/fastbot_microbench_" + name;
+    }
+
+    // ---------- Parsing ----------
+
+    void createFromBinary(microbench::State &state) {
+        std::string dump = PageGenerator(static_cast<int>(state.range()), 0).binary();
+        state.setItemsPerIteration(state.range());
+        while (state.next()) {
+            ElementPtr root = Element::createFromBinary(dump.data(), dump.size(), true);
+        }
+    }
+
+    MICROBENCH(createFromBinary)->range({64, 512, 4096});
+
+    void createFromBinaryV2(microbench::State &state) {
+        std::string dump = PageGenerator(static_cast<int>(state.range()), 0).binaryV2();
+        state.setItemsPerIteration(state.range());
+        while (state.next()) {
+            ElementPtr root = Element::createFromBinary(dump.data(), dump.size(), true);
+        }
+    }
+
+    MICROBENCH(createFromBinaryV2)->range({64, 512, 4096});
+
+    /// A page whose only change since the previous dump is one text, sent as a delta dump
+    void applyDeltaDump(microbench::State &state) {
+        PageGenerator generator(static_cast<int>(state.range()), 0);
+        int changed = static_cast<int>(state.range()) / 2;
+        std::string full = generator.binaryDelta(1, 0, -1);
+        // Each applies to the other's tree, so they can alternate
+        std::string deltas[2] = {generator.binaryDelta(2, 1, changed), generator.binaryDelta(1, 2, changed)};
+        DeltaDumpDecoder decoder;
+        decoder.decode(full.data(), full.size(), true);
+        state.setItemsPerIteration(state.range());
+        size_t next = 0;
+        while (state.next()) {
+            ElementPtr root = decoder.decode(deltas[next].data(), deltas[next].size(), true);
+            next ^= 1;
+        }
+    }
+
+    MICROBENCH(applyDeltaDump)->range({64, 512, 4096});
+
+    void createFromXml(microbench::State &state) {
+        std::string dump = PageGenerator(static_cast<int>(state.range()), 0).xml();
+        state.setItemsPerIteration(state.range());
+        while (state.next()) {
+            ElementPtr root = Element::createFromXml(dump.data(), dump.size(), true);
+        }
+    }
+
+    MICROBENCH(createFromXml)->range({64, 512, 4096});
+
+    // ---------- States and graph ----------
+
+    void createReuseState(microbench::State &state) {
+        ElementPtr root = parsePage(static_cast<int>(state.range()), 0);
+        state.setItemsPerIteration(state.range());
+        while (state.next()) {
+            StatePtr built = StateFactory::createState(AlgorithmType::DoubleSarsa, benchActivity(), root);
+        }
+    }
+
+    MICROBENCH(createReuseState)->range({64, 512, 4096});
+
+    /**
+     * Builds of two pages sharing no subtree, alternately, so the incremental build reuses nothing.
+     * The workers run either way, as a Model's do: a process with threads allocates more slowly
+     */
+    void createChangedReuseStates(microbench::State &state, bool parallel) {
+        ElementPtr roots[2] = {parsePage(static_cast<int>(state.range()), 0),
+                               parsePage(static_cast<int>(state.range()), 1)};
+        StepExecutor executor(StepExecutorThreads);
+        size_t page = 0;
+        state.setItemsPerIteration(state.range());
+        while (state.next()) {
+            StatePtr built = StateFactory::createState(AlgorithmType::DoubleSarsa, benchActivity(), roots[page++ & 1],
+                                                       DefaultWidgetKeyMask, true, parallel ? &executor : nullptr);
+        }
+    }
+
+    void createReuseStateChanged(microbench::State &state) {
+        createChangedReuseStates(state, false);
+    }
+
+    MICROBENCH(createReuseStateChanged)->range({512, 4096, 16384});
+
+    /// createReuseStateChanged with the workers helping build trees of FASTBOT_PARALLEL_STATE_BUILD nodes
+    /// (the same build unless compiled with it set, on a multi-core host)
+    void createReuseStateParallel(microbench::State &state) {
+        createChangedReuseStates(state, true);
+    }
+
+    MICROBENCH(createReuseStateParallel)->range({512, 4096, 16384});
+
+    /// Adds range distinct states to an empty graph per iteration
+    void graphAddState(microbench::State &state) {
+        std::vector<StatePtr> states;
+        for (int page = 0; page < state.range(); page++) {
+            states.push_back(StateFactory::createState(AlgorithmType::DoubleSarsa, benchActivity(),
+                                                       parsePage(48, page)));
+        }
+        state.setItemsPerIteration(state.range());
+        while (state.next()) {
+            state.pauseTiming();
+            GraphPtr graph = std::make_shared<Graph>();
+            state.resumeTiming();
+            for (const StatePtr &added: states) {
+                graph->addState(added);
+            }
+            state.pauseTiming();
+            graph.reset();
+            state.resumeTiming();
+        }
+    }
+
+    MICROBENCH(graphAddState)->range({16, 128, 1024});
+
+    // ---------- Preference ----------
+
+    /// Black widget rules: range rects of the bench activity, plus an xpath rule
+    void writeBlackWidgets(int64_t rects) {
+        std::string path = benchFilePath("widget.black");
+        std::ofstream file(path, std::ios::trunc);
+        file << "[{\"activity\":\"" << *benchActivity() << "\",\"xpath\":\"//*[@resource-id='" << BenchPackage
+             << ":id/w0_3']\"}";
+        for (int64_t rect = 0; rect < rects; rect++) {
+            int left = static_cast<int>((rect * 97) % (ScreenWidth - 100));
+            int top = static_cast<int>((rect * 131) % (ScreenHeight - 100));
+            file << ",{\"activity\":\"" << *benchActivity() << "\",\"bounds\":\"[" << left << "," << top << "]["
+                 << left + 100 << "," << top + 100 << "]\"}";
+        }
+        file << "]";
+        file.close();
+        Preference::BlackWidgetFilePath = path;
+        Preference::inst()->reloadRules(false);
+    }
+
+    void resolvePage(microbench::State &state) {
+        writeBlackWidgets(16);
+        std::string dump = PageGenerator(static_cast<int>(state.range()), 0).xml();
+        state.setItemsPerIteration(state.range());
+        Rng rng(1);
+        while (state.next()) {
+            // Resolving edits the tree: every iteration gets a fresh one
+            state.pauseTiming();
+            ElementPtr root = Element::createFromXml(dump.data(), dump.size(), true);
+            state.resumeTiming();
+            Preference::inst()->resolvePageAndGetSpecifiedAction(*benchActivity(), root, rng);
+        }
+    }
+
+    MICROBENCH(resolvePage)->range({64, 512, 4096});
+
+    /// range black rects on the page; one point check per iteration
+    void checkPointIsInBlackRects(microbench::State &state) {
+        writeBlackWidgets(state.range());
+        Rng rng(1);
+        Preference::inst()->resolvePageAndGetSpecifiedAction(*benchActivity(), parsePage(64, 0), rng);
+        uint32_t point = 12345;
+        while (state.next()) {
+            point = point * 1103515245 + 12345;
+            Preference::inst()->checkPointIsInBlackRects(*benchActivity(), static_cast<int>(point % ScreenWidth),
+                                                         static_cast<int>((point >> 12) % ScreenHeight));
+        }
+    }
+
+    MICROBENCH(checkPointIsInBlackRects)->range({4, 64, 1024});
+
+    /// Resolving a 512-node page against range valid texts, one in seven nodes matching
+    void resolvePageValidTexts(microbench::State &state) {
+        std::string path = benchFilePath("valid_" + std::to_string(state.range()));
+        std::ofstream file(path, std::ios::trunc);
+        for (int64_t text = 0; text < state.range(); text++) {
+            file << "String #" << text << ": item 0." << text * 7 << "\n";
+        }
+        file.close();
+        // Stays loaded: the benches after this one resolve no pages
+        Preference::inst()->loadValidTexts(path);
+        std::string dump = PageGenerator(512, 0).binary();
+        state.setItemsPerIteration(512);
+        Rng rng(1);
+        while (state.next()) {
+            state.pauseTiming();
+            ElementPtr root = Element::createFromBinary(dump.data(), dump.size(), true);
+            state.resumeTiming();
+            Preference::inst()->resolvePageAndGetSpecifiedAction(*benchActivity(), root, rng);
+        }
+    }
+
+    MICROBENCH(resolvePageValidTexts)->range({1000, 10000, 100000});
+
+    // ---------- Agent ----------
+
+    /// Agent that visited range pages choosing its next action
+    void selectNewAction(microbench::State &state) {
+        ModelPtr model = steppedModel(static_cast<int>(state.range()), 48);
+        AbstractAgentPtr agent = model->getAgent("");
+        while (state.next()) {
+            ActionPtr action = agent->resolveNewAction();
+        }
+    }
+
+    MICROBENCH(selectNewAction)->range({16, 128, 1024});
+
+    void saveReuseModel(microbench::State &state) {
+        std::string modelPath = benchFilePath("save_" + std::to_string(state.range()));
+        writeReuseModelFile(modelPath + ".fbm", static_cast<int>(state.range()));
+        ModelPtr model = Model::create();
+        model->addAgent("", AlgorithmType::DoubleSarsa);
+        std::shared_ptr<DoubleSarsaAgent> agent = agentOf(model);
+        agent->loadReuseModel(modelPath);
+        std::string outPath = benchFilePath("saved.fbm");
+        state.setItemsPerIteration(state.range());
+        while (state.next()) {
+            agent->saveReuseModel(outPath);
+        }
+    }
+
+    MICROBENCH(saveReuseModel)->range({1000, 10000, 100000});
+
+    void loadReuseModel(microbench::State &state) {
+        std::string modelPath = benchFilePath("load_" + std::to_string(state.range()));
+        writeReuseModelFile(modelPath + ".fbm", static_cast<int>(state.range()));
+        ModelPtr model = Model::create();
+        model->addAgent("", AlgorithmType::DoubleSarsa);
+        std::shared_ptr<DoubleSarsaAgent> agent = agentOf(model);
+        state.setItemsPerIteration(state.range());
+        while (state.next()) {
+            agent->loadReuseModel(modelPath);
+        }
+    }
+
+    MICROBENCH(loadReuseModel)->range({1000, 10000, 100000});
+
+    /// loadReuseModel of the same entries, saved again in the encoding of FASTBOT_COMPACT_REUSE_MODEL
+    void loadSavedReuseModel(microbench::State &state) {
+        std::string modelPath = benchFilePath("resaved_" + std::to_string(state.range()));
+        writeReuseModelFile(modelPath + ".fbm", static_cast<int>(state.range()));
+        ModelPtr model = Model::create();
+        model->addAgent("", AlgorithmType::DoubleSarsa);
+        std::shared_ptr<DoubleSarsaAgent> agent = agentOf(model);
+        agent->loadReuseModel(modelPath);
+        agent->saveReuseModel(modelPath + ".fbm");
+        state.setItemsPerIteration(state.range());
+        while (state.next()) {
+            agent->loadReuseModel(modelPath);
+        }
+    }
+
+    MICROBENCH(loadSavedReuseModel)->range({1000, 10000, 100000});
+
+}
+
+int main(int argc, char **argv) {
+    // Same decisions on every run (see fastbotx::RandomStreams)
+    setenv("FASTBOT_RANDOM_SEED", "1", 0);
+    const char *filter = "";
+    bool logs = false;
+    for (int i = 1; i < argc; i++) {
+        if (0 == strcmp(argv[i], "--logs")) {
+            logs = true;
+        } else {
+            filter = argv[i];
+        }
+    }
+    if (!logs) {
+        // Keep the results on the original stdout, send everything else printed there away
+        microbench::report = fdopen(dup(STDOUT_FILENO), "w");
+        if (nullptr == microbench::report || nullptr == freopen("/dev/null", "w", stdout)) {
+            microbench::report = stdout;
+        }
+    }
+    for (const auto &benchmark: microbench::registry()) {
+        if (benchmark->name().find(filter) != std::string::npos) {
+            benchmark->run();
+        }
+    }
+    return 0;
+}
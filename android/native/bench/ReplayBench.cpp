@@ -0,0 +1,203 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+/**
+ * Host-side replay benchmark of the decision loop (Linux / macOS).
+ *
+ * Replays a recorded corpus of GUI dumps through Model::getOperateOpt, the same path as
+ * getActionFromBufferNative, and reports the per-stage latencies of PerfStats, heap
+ * allocations, the peak resident set and the model's memory footprint, so that
+ * optimizations can be measured without a phone.
+ *
+ * Corpus, either:
+ *   - a GUI trace recorded on a device (max.guiTraceFile, see GuiTraceRecorder), or
+ *   - a directory holding corpus.txt, one page per line in replay order:
+ *       <activity>\t<dump file, relative to the directory>
+ *     Empty lines and lines starting with '#' are skipped.
+ * Dumps are binary trees ("FB\0\1" or "FB\0\2"), delta dumps ("FB\0\3", applied to the page before) or
+ * XML, told apart by their magic as on the device.
+ *
+ * Usage: fastbot_replay_bench <corpus dir | GUI trace> [--iterations N] [--seed S] [--max-states N]
+ *
+ * The seed (default 1) is exported as FASTBOT_RANDOM_SEED before the model exists, so two
+ * runs over the same corpus take the same decisions; the printed decision digest tells.
+ * --max-states bounds the graph as max.graphMaxStates does on a device.
+ */
+
+#include "../Base.h"
+#include "../utils.hpp"
+#include "../model/Model.h"
+#include "../model/PerfStats.h"
+#include "../desc/DeltaDumpDecoder.h"
+#include "../desc/Element.h"
+#include "BenchCorpus.h"
+#include <sys/resource.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// ---------- Allocation counting: every operator new of the process goes through here ----------
+
+static std::atomic<uint64_t> allocationCount{0};
+static std::atomic<uint64_t> allocatedBytes{0};
+
+static void *countedAllocate(size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    void *memory = std::malloc(size ? size : 1);
+    if (nullptr == memory) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void *operator new(size_t size) { return countedAllocate(size); }
+
+void *operator new[](size_t size) { return countedAllocate(size); }
+
+void operator delete(void *memory) noexcept { std::free(memory); }
+
+void operator delete[](void *memory) noexcept { std::free(memory); }
+
+void operator delete(void *memory, size_t) noexcept { std::free(memory); }
+
+void operator delete[](void *memory, size_t) noexcept { std::free(memory); }
+
+namespace {
+
+    using fastbotx::bench::Page;
+    using fastbotx::bench::loadCorpus;
+
+    /// Peak resident set of the process in KiB
+    long peakRssKb() {
+        struct rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+        return usage.ru_maxrss / 1024;  // bytes on macOS
+#else
+        return usage.ru_maxrss;
+#endif
+    }
+
+    /// FNV-1a over the decisions, to compare the runs of a corpus
+    void digestOperate(uint64_t &digest, const fastbotx::OperatePtr &operate) {
+        int fields[] = {operate ? static_cast<int>(operate->act) : -1,
+                        operate ? operate->pos.left : 0, operate ? operate->pos.top : 0,
+                        operate ? operate->pos.right : 0, operate ? operate->pos.bottom : 0};
+        const auto *bytes = reinterpret_cast<const unsigned char *>(fields);
+        for (size_t i = 0; i < sizeof(fields); i++) {
+            digest = (digest ^ bytes[i]) * 1099511628211ULL;
+        }
+    }
+
+    void printUsage(const char *program) {
+        printf("usage: %s <corpus dir | GUI trace> [--iterations N] [--seed S] [--max-states N]\n", program);
+    }
+
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        printUsage(argv[0]);
+        return 2;
+    }
+    std::string corpusPath = argv[1];
+    int iterations = 1;
+    std::string seed = "1";
+    long maxStates = 0;
+    for (int i = 2; i < argc; i++) {
+        if (0 == strcmp(argv[i], "--iterations") && i + 1 < argc) {
+            iterations = std::max(1, atoi(argv[++i]));
+        } else if (0 == strcmp(argv[i], "--seed") && i + 1 < argc) {
+            seed = argv[++i];
+        } else if (0 == strcmp(argv[i], "--max-states") && i + 1 < argc) {
+            maxStates = std::max(0L, atol(argv[++i]));
+        } else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+    // Before anything draws a seed (see fastbotx::RandomStreams)
+    setenv("FASTBOT_RANDOM_SEED", seed.c_str(), 1);
+
+    std::vector<Page> pages;
+    if (!loadCorpus(corpusPath, pages)) {
+        return 1;
+    }
+    size_t binaryPages = 0;
+    for (const Page &page: pages) {
+        binaryPages += page.binary ? 1 : 0;
+    }
+
+    fastbotx::ModelPtr model = fastbotx::Model::create();
+    model->addAgent("", fastbotx::AlgorithmType::DoubleSarsa);
+    if (maxStates > 0) {
+        fastbotx::Graph::WriteLock graphLock = model->getGraph()->writeLock();
+        model->getGraph()->setMaxStates(static_cast<size_t>(maxStates));
+    }
+    fastbotx::PerfStats &perfStats = model->getPerfStats();
+
+    // Dumps are parsed in place, as from the Direct ByteBuffer: each step gets a fresh copy
+    std::vector<char> buffer;
+    fastbotx::DeltaDumpDecoder deltaDecoder;
+    uint64_t digest = 1469598103934665603ULL;
+    uint64_t allocationsBefore = allocationCount.load();
+    uint64_t bytesBefore = allocatedBytes.load();
+    auto replayStart = std::chrono::steady_clock::now();
+    for (int iteration = 0; iteration < iterations; iteration++) {
+        for (const Page &page: pages) {
+            buffer.assign(page.dump.begin(), page.dump.end());
+            fastbotx::ElementPtr element;
+            {
+                fastbotx::StageTimer parseTimer(perfStats, fastbotx::PerfStage::Parse);
+                if (fastbotx::Element::isBinaryDelta(buffer.data(), buffer.size())) {
+                    element = deltaDecoder.decode(buffer.data(), buffer.size(), true);
+                } else {
+                    element = page.binary
+                              ? fastbotx::Element::createFromBinary(buffer.data(), buffer.size(), true)
+                              : fastbotx::Element::createFromXml(buffer.data(), buffer.size(), true);
+                }
+            }
+            if (nullptr == element) {
+                BLOGE("replay: cannot parse a dump of %s", page.activity.c_str());
+                continue;
+            }
+            digestOperate(digest, model->getOperateOpt(element, page.activity));
+        }
+    }
+    model->finishPendingSteps();
+    double replayMs = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - replayStart).count();
+
+    auto steps = static_cast<double>(pages.size()) * iterations;
+    uint64_t allocations = allocationCount.load() - allocationsBefore;
+    uint64_t bytes = allocatedBytes.load() - bytesBefore;
+    printf("corpus: %zu pages (%zu binary, %zu xml) x %d iterations, seed %s\n",
+           pages.size(), binaryPages, pages.size() - binaryPages, iterations, seed.c_str());
+    printf("replay: %.3f ms, %.3f ms/step, %zu states\n", replayMs, replayMs / steps, model->stateSize());
+    if (maxStates > 0) {
+        printf("graph bound: %ld states, %zu evicted\n", maxStates, model->getGraph()->getEvictedStateCount());
+    }
+    printf("allocations: %llu (%.1f/step), %llu bytes (%.1f/step)\n",
+           static_cast<unsigned long long>(allocations), allocations / steps,
+           static_cast<unsigned long long>(bytes), bytes / steps);
+    printf("peak rss: %ld KiB\n", peakRssKb());
+#if FASTBOT_SPECULATIVE_STEPS
+    printf("speculation: %llu hits, %llu misses\n", static_cast<unsigned long long>(model->getSpeculationHits()),
+           static_cast<unsigned long long>(model->getSpeculationMisses()));
+#endif
+    printf("decision digest: %016llx\n", static_cast<unsigned long long>(digest));
+    printf("%s\n", perfStats.toJson().c_str());
+    printf("%s\n", model->getMemoryFootprintJson().c_str());
+    return 0;
+}
@@ -11,6 +11,7 @@
 
 #include <utility>
 #include "State.h"
+#include "MemoryFootprint.h"
 
 
 namespace fastbotx {
@@ -107,14 +108,18 @@ namespace fastbotx {
         return strs.str();
     }
 
-    OperatePtr Action::toOperate() const {
+    OperatePtr Action::toOperate(Rng &rng) const {
         OperatePtr opt = std::make_shared<DeviceOperateWrapper>();
         opt->act = this->_actionType;
         opt->aid = this->getId();
+        this->patchOperate(*opt, rng);
+        return opt;
+    }
+
+    void Action::patchOperate(DeviceOperateWrapper &opt, Rng &rng) const {
         if (this->_visitedCount <= 1) {
-            opt->throttle = static_cast<float>(randomInt(10, Action::_throttle));
+            opt.throttle = static_cast<float>(rng.nextInt(10, Action::_throttle));
         }
-        return opt;
     }
 
     std::shared_ptr<Action> Action::NOP = std::make_shared<Action>(ActionType::NOP);
@@ -147,17 +152,13 @@ namespace fastbotx {
     }
 
     bool ActivityStateAction::isValid() const {
-        return (this->_target == nullptr || !this->_target->getBounds()->isEmpty());
+        return (this->_target == nullptr || !this->_target->getBounds().isEmpty());
     }
 
     bool ActivityStateAction::getEnabled() const {
         return (this->_target == nullptr || this->_target->getEnabled());
     }
 
-    uintptr_t ActivityStateAction::hash() const {
-        return this->_hashcode;
-    }
-
 /// check if two actions are the same
 /// \param action the action to compare with
 /// \return if two actions are the same return true
@@ -171,8 +172,7 @@ namespace fastbotx {
 
 
     bool ActivityStateAction::isEmpty() const {
-        auto rect = this->getTarget()->getBounds();
-        return rect->isEmpty();
+        return this->getTarget()->getBounds().isEmpty();
     }
 
     ActivityStateAction::~ActivityStateAction() {
@@ -180,16 +180,40 @@ namespace fastbotx {
         this->_target = nullptr;
     }
 
-    OperatePtr ActivityStateAction::toOperate() const {
-        auto opt = Action::toOperate(); // call base virtual method
-        opt->sid = this->getState().expired() ? "" : this->getState().lock()->getId();
-        if (this->getTarget()) {
-            opt->pos = *(this->getTarget()->getBounds());
-            opt->editable = this->getTarget()->isEditable();
+    void ActivityStateAction::setTarget(WidgetPtr widget) {
+        this->_target = std::move(widget);
+        this->_operateTemplate.reset();
+    }
+
+    OperatePtr ActivityStateAction::toOperate(Rng &rng) const {
+        // The template goes stale when the target's bounds change (details cleared or
+        // refilled from a revisit), the only part of it that can
+        if (this->_operateTemplate == nullptr ||
+            (this->_target && !(this->_operateTemplate->pos == this->_target->getBounds()))) {
+            auto operateTemplate = std::make_shared<DeviceOperateWrapper>();
+            operateTemplate->act = this->_actionType;
+            operateTemplate->aid = this->getId();
+            operateTemplate->sid = this->getState().expired() ? "" : this->getState().lock()->getId();
+            if (this->_target) {
+                operateTemplate->pos = this->_target->getBounds();
+                operateTemplate->editable = this->_target->isEditable();
+            }
+            this->_operateTemplate = std::move(operateTemplate);
         }
+        auto opt = std::make_shared<DeviceOperateWrapper>(*this->_operateTemplate);
+        this->patchOperate(*opt, rng);
         return opt;
     }
 
+    size_t ActivityStateAction::heapBytes() const {
+        if (this->_operateTemplate == nullptr) {
+            return 0;
+        }
+        return MemoryFootprint::sharedBytes<DeviceOperateWrapper>() +
+               MemoryFootprint::bytesOf(this->_operateTemplate->sid) +
+               MemoryFootprint::bytesOf(this->_operateTemplate->aid);
+    }
+
     std::string ActivityStateAction::toString() const {
         std::stringstream strs;
         strs << "{" << Action::toString() <<
@@ -68,11 +68,17 @@ namespace fastbotx {
 
         virtual bool isValid() const;
 
-        virtual OperatePtr toOperate() const;
+        /// Operate of this action; rng is the stepping device's generator
+        virtual OperatePtr toOperate(Rng &rng) const;
 
+        /// Per-step part of toOperate(): the throttle of a new action (draws from rng)
+        void patchOperate(DeviceOperateWrapper &opt, Rng &rng) const;
+
+        /// Identity of the action, computed once by the constructors
         uintptr_t _hashcode{};
 
-        uintptr_t hash() const override { return _hashcode; }
+        /// Final, so calls through Action and its subclasses are inlined loads of _hashcode
+        uintptr_t hash() const final { return _hashcode; }
 
         bool isModelAct() const;
 
@@ -138,17 +144,27 @@ namespace fastbotx {
         bool isValid() const override;
 
         // set target widget without updating hash code
-        void setTarget(WidgetPtr widget) { this->_target = std::move(widget); }
+        void setTarget(WidgetPtr widget);
+
+        /// Row of the target in the owning state's WidgetColumns (-1 for no target)
+        int getTargetIndex() const { return this->_targetIndex; }
+
+        void setTargetIndex(int index) { this->_targetIndex = index; }
+
+        /// Copy of the cached operate template with the per-step fields patched in
+        OperatePtr toOperate(Rng &rng) const override;
+
+        /// Drop the operate template, e.g. with the details of the state
+        void clearOperateTemplate() { this->_operateTemplate.reset(); }
 
-        OperatePtr toOperate() const override;
+        /// Heap bytes of the operate template, 0 before the action is first chosen
+        size_t heapBytes() const;
 
 
         // from ResolveNode
         bool isEmpty() const;
 
 
-        uintptr_t hash() const override;
-
         bool operator==(const ActivityStateAction &action) const;
 
         bool operator<(const ActivityStateAction &action) const;
@@ -157,7 +173,7 @@ namespace fastbotx {
 
         std::weak_ptr<State> _state;
         std::shared_ptr<Widget> _target;
-        uintptr_t _hashcode{};
+        int _targetIndex{-1};
 
         ~ActivityStateAction() override;
 
@@ -165,11 +181,16 @@ namespace fastbotx {
         ActivityStateAction();
 
     private:
+        /**
+         * Operate of this action without the per-step fields, built when first chosen.
+         * Actions are converted under the graph write lock, which guards it.
+         */
+        mutable std::shared_ptr<const DeviceOperateWrapper> _operateTemplate;
     };
 
     typedef std::shared_ptr<ActivityStateAction> ActivityStateActionPtr;
     typedef std::vector<ActivityStateActionPtr> ActivityStateActionPtrVec;
-    typedef std::set<ActivityStateActionPtr, Comparator<ActivityStateAction>> ActivityStateActionPtrSet;
+    typedef std::set<ActivityStateActionPtr, HashComparator<ActivityStateAction>> ActivityStateActionPtrSet;
 
 
 }
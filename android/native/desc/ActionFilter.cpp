@@ -41,6 +41,9 @@ namespace fastbotx {
         return ret;
     }
 
+    constexpr ActionTypeSet ActionFilterValidDatePriority::SystemActions;
+    constexpr ActionTypeSet ActionFilterValidDatePriority::WidgetActions;
+
     ActionFilterPtr allFilter = ActionFilterPtr(new ActionFilterALL());
     ActionFilterPtr targetFilter = ActionFilterPtr(new ActionFilterTarget());
     ActionFilterPtr validFilter = ActionFilterPtr(new ActionFilterValid());
@@ -163,33 +163,31 @@ namespace fastbotx {
         bool include(ActivityStateActionPtr action) const override {
             if (nullptr == action)
                 return false;
-            switch (action->getActionType()) {
+            // Performance: one mask test per category instead of a switch over types
+            ActionType type = action->getActionType();
+            if (SystemActions.contains(type)) {
                 // System actions are always included
-                case ActionType::START:
-                case ActionType::RESTART:
-                case ActionType::CLEAN_RESTART:
-                case ActionType::NOP:
-                case ActionType::ACTIVATE:
-                case ActionType::BACK:
-                    return true;
+                return true;
+            }
+            if (WidgetActions.contains(type)) {
                 // UI actions must be enabled, valid, and non-empty
-                case ActionType::CLICK:
-                case ActionType::LONG_CLICK:
-                case ActionType::SCROLL_BOTTOM_UP:
-                case ActionType::SCROLL_TOP_DOWN:
-                case ActionType::SCROLL_LEFT_RIGHT:
-                case ActionType::SCROLL_RIGHT_LEFT:
-                case ActionType::SCROLL_BOTTOM_UP_N:
-                    return action->getEnabled() && action->isValid() && !action->isEmpty();
-                default:
-                    BLOGE("Should not reach here");
-                    return false;
-
+                return action->getEnabled() && action->isValid() && !action->isEmpty();
             }
+            BLOGE("Should not reach here");
+            return false;
         }
 
     private:
-
+        static constexpr ActionTypeSet SystemActions{
+                ActionTypeSet::bit(ActionType::START) | ActionTypeSet::bit(ActionType::RESTART) |
+                ActionTypeSet::bit(ActionType::CLEAN_RESTART) | ActionTypeSet::bit(ActionType::NOP) |
+                ActionTypeSet::bit(ActionType::ACTIVATE) | ActionTypeSet::bit(ActionType::BACK)};
+
+        static constexpr ActionTypeSet WidgetActions{
+                ActionTypeSet::bit(ActionType::CLICK) | ActionTypeSet::bit(ActionType::LONG_CLICK) |
+                ActionTypeSet::bit(ActionType::SCROLL_BOTTOM_UP) | ActionTypeSet::bit(ActionType::SCROLL_TOP_DOWN) |
+                ActionTypeSet::bit(ActionType::SCROLL_LEFT_RIGHT) | ActionTypeSet::bit(ActionType::SCROLL_RIGHT_LEFT) |
+                ActionTypeSet::bit(ActionType::SCROLL_BOTTOM_UP_N)};
     };
 
 
@@ -0,0 +1,57 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef DeltaDumpDecoder_CPP_
+#define DeltaDumpDecoder_CPP_
+
+#include "DeltaDumpDecoder.h"
+#include "../utils.hpp"
+
+namespace fastbotx {
+
+    DeltaDumpDecoder::DeltaDumpDecoder() {
+        this->_arenas[0].reset(new ElementArena());
+        this->_arenas[1].reset(new ElementArena());
+    }
+
+    ElementPtr DeltaDumpDecoder::decode(const char *buf, size_t len, bool borrowStrings) {
+        std::lock_guard<std::mutex> lock(this->_mutex);
+        uint64_t dumpId = 0;
+        ElementPtr root = Element::parseBinaryDelta(buf, len, borrowStrings, this->_base, &dumpId);
+        if (!root || 0 == dumpId) {
+            this->_base = BinaryDeltaBase();
+            return nullptr;
+        }
+        // The other arena held the tree retained before the current one, released since
+        int next = 1 - this->_activeArena;
+        if (!this->_arenas[next]->rewind()) {
+            // A node of that tree is still referenced somewhere: leak its arena rather than free it
+            BDLOG("delta base arena still has %zu live nodes", this->_arenas[next]->liveCount());
+            this->_arenas[next].release();
+            this->_arenas[next].reset(new ElementArena());
+        }
+        BinaryDeltaBase retained;
+        retained.dumpId = dumpId;
+        root->cloneInto(this->_arenas[next].get(), nullptr, &retained);
+        this->_base = std::move(retained);
+        this->_activeArena = next;
+        Element::finishBinaryTree(root);
+        return root;
+    }
+
+    uint64_t DeltaDumpDecoder::baseDumpId() const {
+        std::lock_guard<std::mutex> lock(this->_mutex);
+        return this->_base.dumpId;
+    }
+
+    void DeltaDumpDecoder::reset() {
+        std::lock_guard<std::mutex> lock(this->_mutex);
+        this->_base = BinaryDeltaBase();
+    }
+
+}
+
+#endif //DeltaDumpDecoder_CPP_
@@ -0,0 +1,60 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef DeltaDumpDecoder_H_
+#define DeltaDumpDecoder_H_
+
+#include "Element.h"
+#include "ElementArena.h"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+namespace fastbotx {
+
+    /**
+     * @brief Applies delta GUI dumps ("FB\0\3") to the tree of the previous one
+     *
+     * The Java dumper sends the subtrees that did not change since the last dump as
+     * references to their pre-order position in it, so the decoder keeps that tree as
+     * sent: a copy in its own arenas, since Preference rewrites attributes of the tree
+     * handed to the model. Each dump that decodes replaces it; one based on another
+     * dump (e.g. the previous one failed to parse) is rejected and the dumper starts
+     * over from a dump without references, which baseDumpId() tells it to send.
+     *
+     * Thread-safe: dumps may be parsed on the caller's thread or on the StepExecutor.
+     */
+    class DeltaDumpDecoder {
+    public:
+        DeltaDumpDecoder();
+
+        /**
+         * @brief Tree of a delta dump, with the same fixes as createFromBinary
+         *
+         * @param borrowStrings As for Element::createFromBinary; the retained copy never borrows
+         * @return nullptr if the dump does not parse or its base is not the retained dump
+         */
+        ElementPtr decode(const char *buf, size_t len, bool borrowStrings = false);
+
+        /// ID of the retained dump, which the next delta may reference (0 for none)
+        uint64_t baseDumpId() const;
+
+        /// Drop the retained dump
+        void reset();
+
+    private:
+        mutable std::mutex _mutex;
+        /// The retained tree lives in one, the next one is copied into the other (declared first: outlive _base)
+        std::unique_ptr<ElementArena> _arenas[2];
+        int _activeArena{0};
+        BinaryDeltaBase _base;
+    };
+
+    typedef std::shared_ptr<DeltaDumpDecoder> DeltaDumpDecoderPtr;
+
+}
+
+#endif //DeltaDumpDecoder_H_
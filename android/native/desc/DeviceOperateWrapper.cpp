@@ -8,6 +8,7 @@
 #include "utils.hpp"
 #include "../Base.h"
 #include "json.hpp"
+#include <cstring>
 
 namespace fastbotx {
 
@@ -24,31 +25,6 @@ namespace fastbotx {
 
     }
 
-    DeviceOperateWrapper::DeviceOperateWrapper(const DeviceOperateWrapper &opt) {
-        this->act = opt.act;
-        this->pos = opt.pos;
-        this->sid = opt.sid;
-        this->aid = opt.aid;
-        this->waitTime = opt.waitTime;
-        this->throttle = opt.throttle;
-        this->_text = opt._text;
-        this->extra0 = opt.extra0;
-        this->name = opt.name;
-    }
-
-    DeviceOperateWrapper &DeviceOperateWrapper::operator=(const DeviceOperateWrapper &opt) {
-        this->act = opt.act;
-        this->pos = opt.pos;
-        this->sid = opt.sid;
-        this->aid = opt.aid;
-        this->waitTime = opt.waitTime;
-        this->throttle = opt.throttle;
-        this->_text = opt._text;
-        this->extra0 = opt.extra0;
-        this->name = opt.name;
-        return *this;
-    }
-
     /**
      * @brief Set text content for text input operations
      * 
@@ -171,6 +147,131 @@ namespace fastbotx {
     }
 
 
+    constexpr size_t DeviceOperateWrapper::BinaryFixedSize;
+    constexpr size_t DeviceOperateWrapper::BinaryStringCount;
+    constexpr size_t DeviceOperateWrapper::BinaryHeaderSize;
+
+    namespace {
+        template<typename T>
+        void putBinary(std::string &out, size_t offset, T value) {
+            memcpy(&out[offset], &value, sizeof(value));
+        }
+
+        template<typename T>
+        T getBinary(const char *data, size_t offset) {
+            T value;
+            memcpy(&value, data + offset, sizeof(value));
+            return value;
+        }
+    }
+
+    void DeviceOperateWrapper::writeBinary(std::string &out) const {
+        static const char BinaryMagic[] = {'F', 'O', 0, 1};
+        const std::string *strings[BinaryStringCount] = {&this->_text, &this->sid, &this->aid,
+                                                         &this->jAction, &this->widget};
+        size_t size = BinaryHeaderSize;
+        for (const std::string *value: strings) {
+            size += value->size();
+        }
+        out.assign(size, '\0');
+        memcpy(&out[0], BinaryMagic, sizeof(BinaryMagic));
+        putBinary<int32_t>(out, 4, static_cast<int32_t>(this->act));
+        // Positions beyond the i16 range are sent as an empty rect (as the structured JNI result did)
+        if (this->pos.left >= -32768 && this->pos.left <= 32767) {
+            putBinary<int16_t>(out, 8, static_cast<int16_t>(this->pos.left));
+            putBinary<int16_t>(out, 10, static_cast<int16_t>(this->pos.top));
+            putBinary<int16_t>(out, 12, static_cast<int16_t>(this->pos.right));
+            putBinary<int16_t>(out, 14, static_cast<int16_t>(this->pos.bottom));
+        }
+        putBinary<int32_t>(out, 16, static_cast<int32_t>(this->throttle));
+        out[20] = static_cast<char>((this->clear ? 1 : 0) | (this->adbInput ? 2 : 0) |
+                                    (this->rawInput ? 4 : 0) | (this->allowFuzzing ? 8 : 0) |
+                                    (this->editable ? 16 : 0));
+        putBinary<int64_t>(out, 24, static_cast<int64_t>(this->waitTime));
+        size_t data = BinaryHeaderSize;
+        for (size_t i = 0; i < BinaryStringCount; i++) {
+            const std::string &value = *strings[i];
+            size_t entry = BinaryFixedSize + i * 8;
+            putBinary<uint32_t>(out, entry, static_cast<uint32_t>(data));
+            putBinary<int32_t>(out, entry + 4, value.empty() ? -1 : static_cast<int32_t>(value.size()));
+            if (!value.empty()) {
+                memcpy(&out[data], value.data(), value.size());
+                data += value.size();
+            }
+        }
+    }
+
+    std::shared_ptr<DeviceOperateWrapper> DeviceOperateWrapper::readBinary(const char *data, size_t size) {
+        if (data == nullptr || size < BinaryHeaderSize || data[0] != 'F' || data[1] != 'O' ||
+            data[2] != 0 || data[3] != 1) {
+            return nullptr;
+        }
+        auto operate = std::make_shared<DeviceOperateWrapper>();
+        operate->act = static_cast<ActionType>(getBinary<int32_t>(data, 4));
+        operate->pos.left = getBinary<int16_t>(data, 8);
+        operate->pos.top = getBinary<int16_t>(data, 10);
+        operate->pos.right = getBinary<int16_t>(data, 12);
+        operate->pos.bottom = getBinary<int16_t>(data, 14);
+        operate->throttle = static_cast<float>(getBinary<int32_t>(data, 16));
+        auto flags = static_cast<uint8_t>(data[20]);
+        operate->clear = (flags & 1) != 0;
+        operate->adbInput = (flags & 2) != 0;
+        operate->rawInput = (flags & 4) != 0;
+        operate->allowFuzzing = (flags & 8) != 0;
+        operate->editable = (flags & 16) != 0;
+        operate->waitTime = static_cast<int>(getBinary<int64_t>(data, 24));
+        std::string *strings[BinaryStringCount] = {&operate->_text, &operate->sid, &operate->aid,
+                                                   &operate->jAction, &operate->widget};
+        for (size_t i = 0; i < BinaryStringCount; i++) {
+            size_t entry = BinaryFixedSize + i * 8;
+            auto offset = getBinary<uint32_t>(data, entry);
+            auto length = getBinary<int32_t>(data, entry + 4);
+            if (length < 0) {
+                continue;
+            }
+            if (offset < BinaryHeaderSize || offset > size || static_cast<size_t>(length) > size - offset) {
+                return nullptr;
+            }
+            strings[i]->assign(data + offset, static_cast<size_t>(length));
+        }
+        return operate;
+    }
+
+    uint64_t PlannedOperate::widgetGuardHash(const std::string &className, const Rect &bounds) {
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (unsigned char c: className) {
+            hash = (hash ^ c) * 0x100000001b3ULL;
+        }
+        for (int value: {bounds.left, bounds.top, bounds.right, bounds.bottom}) {
+            uint32_t bits = static_cast<uint32_t>(value);
+            for (int shift = 0; shift < 32; shift += 8) {
+                hash = (hash ^ ((bits >> shift) & 0xFF)) * 0x100000001b3ULL;
+            }
+        }
+        return hash;
+    }
+
+    std::string PlannedOperate::planToString(const std::vector<PlannedOperate> &plan) {
+        // The operations keep the exact form of toString(), which the device already parses
+        std::string ret = "{\"steps\":[";
+        for (size_t i = 0; i < plan.size(); i++) {
+            const PlannedOperate &step = plan[i];
+            if (i > 0) {
+                ret += ',';
+            }
+            ret += "{\"activity\":";
+            ret += nlohmann::json(step.expectedActivity).dump(-1, ' ', false,
+                                                              nlohmann::json::error_handler_t::replace);
+            ret += ",\"widgetHash\":";
+            ret += std::to_string(static_cast<int64_t>(step.expectedWidgetHash));
+            ret += ",\"operate\":";
+            ret += step.operate ? step.operate->toString() : DeviceOperateWrapper::OperateNop->toString();
+            ret += '}';
+        }
+        ret += "]}";
+        return ret;
+    }
+
     std::shared_ptr<DeviceOperateWrapper> DeviceOperateWrapper::OperateNop = std::make_shared<DeviceOperateWrapper>();
 
 }
@@ -8,6 +8,7 @@
 #define Operate_H_
 
 #include <string>
+#include <vector>
 #include "../Base.h"
 
 namespace fastbotx {
@@ -62,11 +63,12 @@ namespace fastbotx {
 
         DeviceOperateWrapper();
 
-        DeviceOperateWrapper(const DeviceOperateWrapper &opt);
+        /// Copies every field, so a cached operate template can be copied and patched per step
+        DeviceOperateWrapper(const DeviceOperateWrapper &opt) = default;
 
         explicit DeviceOperateWrapper(const std::string &optJsonStr);
 
-        DeviceOperateWrapper &operator=(const DeviceOperateWrapper &node);
+        DeviceOperateWrapper &operator=(const DeviceOperateWrapper &node) = default;
 
         std::string setText(const std::string &text);
 
@@ -78,6 +80,29 @@ namespace fastbotx {
 
         std::string toString() const;
 
+        /**
+         * @brief Compact binary form of this operation, the JSON-free counterpart of toString()
+         * 
+         * Little-endian, mirroring the "FB\0\1" input tree format:
+         * magic "FO\0\1" (4) | act i32 | pos i16 x 4 | throttle i32 | flags u8 (clear, adbInput,
+         * rawInput, allowFuzzing, editable from bit 0) + 3 padding | waitTime i64 |
+         * string table of text, sid, aid, jAction, widget: (offset u32, length i32; -1 = none) x 5 |
+         * string bytes (UTF-8). Offsets are from the start of the encoding.
+         * 
+         * @param out Replaced with the encoding; its capacity is reused across calls
+         */
+        void writeBinary(std::string &out) const;
+
+        /**
+         * @brief Decode an operation encoded by writeBinary (e.g. by a decision server)
+         * @return The operation, null if data is not a well-formed encoding
+         */
+        static std::shared_ptr<DeviceOperateWrapper> readBinary(const char *data, size_t size);
+
+        static constexpr size_t BinaryFixedSize = 32;
+        static constexpr size_t BinaryStringCount = 5;
+        static constexpr size_t BinaryHeaderSize = BinaryFixedSize + BinaryStringCount * 8;
+
         virtual ~DeviceOperateWrapper() = default;
 
         static std::shared_ptr<DeviceOperateWrapper> OperateNop;
@@ -90,6 +115,32 @@ namespace fastbotx {
 
     typedef std::shared_ptr<DeviceOperateWrapper> OperatePtr;
 
+    /**
+     * @brief One step of an action plan, with the guard the device checks before running it
+     * 
+     * The first step of a plan runs on the page it was planned on and has no guard. A later
+     * step runs only while the device is still in expectedActivity and, for a step with a
+     * target, still shows a widget at its position whose widgetGuardHash is expectedWidgetHash;
+     * the device dumps the page instead at the first guard that fails.
+     */
+    struct PlannedOperate {
+        OperatePtr operate;
+        /// Activity the step expects, empty for no check
+        std::string expectedActivity;
+        /// widgetGuardHash of the target the step was planned on, 0 for no check
+        uint64_t expectedWidgetHash{0};
+
+        /**
+         * @brief 64-bit FNV-1a over the class name bytes, then left, top, right, bottom as
+         * little-endian int32: the identity of a widget that the device can recompute from its
+         * live accessibility node without dumping the page
+         */
+        static uint64_t widgetGuardHash(const std::string &className, const Rect &bounds);
+
+        /// {"steps":[{"activity":"...","widgetHash":N,"operate":{...toString()...}},...]}, widgetHash as int64
+        static std::string planToString(const std::vector<PlannedOperate> &plan);
+    };
+
 }
 
 #endif
@@ -8,7 +8,10 @@
 #define Element_CPP_
 
 #include "../utils.hpp"
+#include "../Trace.h"
 #include "Element.h"
+#include "WidgetText.h"
+#include "XmlStreamReader.h"
 #include "../thirdpart/tinyxml2/tinyxml2.h"
 #include "../thirdpart/json/json.hpp"
 #include <cstdio>
@@ -27,6 +30,23 @@ namespace fastbotx {
         return neg ? -v : v;
     }
 
+    /// Parse bounds "[xl,yl][xr,yr]" (p at '['); false if malformed
+    static bool parseBounds(const char *p, int (&out)[4]) {
+        if (*p != '[') return false;
+        ++p;
+        out[0] = parseIntAndAdvance(p);
+        if (*p != ',') return false;
+        ++p;
+        out[1] = parseIntAndAdvance(p);
+        if (p[0] != ']' || p[1] != '[') return false;
+        p += 2;
+        out[2] = parseIntAndAdvance(p);
+        if (*p != ',') return false;
+        ++p;
+        out[3] = parseIntAndAdvance(p);
+        return *p == ']';
+    }
+
     /// Try short then long attribute name (SECURITY_AND_OPTIMIZATION §7 - Java outputs rid/cd/bnd etc.)
     static bool queryStringAttr(const tinyxml2::XMLElement *node, const char *shortName, const char *longName, const char *&out) {
         if (node->QueryStringAttribute(shortName, &out) == tinyxml2::XML_SUCCESS && out && *out != '\0') return true;
@@ -44,14 +64,39 @@ namespace fastbotx {
         return false;
     }
 
-    Element::Element()
-            : _enabled(false), _checked(false), _checkable(false), _clickable(false),
+    /// Block size of a stand-alone element's own arena: a few string payloads
+    static const size_t StandaloneArenaBlockSize = 256;
+
+    Element::Element(ElementArena *arena)
+            : _arena(arena), _ownedArena(arena ? nullptr : new ElementArena(StandaloneArenaBlockSize)), _enabled(false), _checked(false), _checkable(false), _clickable(false),
               _focusable(false), _scrollable(false), _longClickable(false), _childCount(0),
               _focused(false), _index(0), _password(false), _selected(false), _isEditable(false),
               _cachedScrollType(ScrollType::NONE), _scrollTypeCached(false),
-              _cachedHash(0), _hashCached(false) {
+              _cachedHash(0), _hashCached(false),
+              _fusedHashes{0, 0, 0, 0}, _fusedHashesValid(false),
+              _cachedSubtreeSignature(0), _cachedSubtreeSize(1), _subtreeSignatureCached(false) {
+        if (this->_ownedArena) {
+            this->_arena = this->_ownedArena.get();
+        }
         _children.clear();
-        this->_bounds = Rect::RectZero;
+    }
+
+    /**
+     * @brief Allocate an Element together with its control block in the arena
+     *
+     * Performance optimization: replaces std::make_shared<Element>() (one heap
+     * allocation per node) with a pointer bump; the node still behaves as a normal
+     * ElementPtr for Preference/State callers.
+     */
+    ElementPtr Element::newInArena(ElementArena *arena) {
+        if (nullptr == arena) {
+            return std::make_shared<Element>();
+        }
+        return std::allocate_shared<Element>(ArenaAllocator<Element>(arena), arena);
+    }
+
+    ElementString Element::storeString(const char *data, size_t size) {
+        return this->_arena->copyString(data, size);
     }
 
     /**
@@ -92,6 +137,18 @@ namespace fastbotx {
         
         // Clear this element's parent reference
         this->_parent.reset();
+        // The parent's subtree changed; neither its hash nor its ancestors' are valid
+        parentLocked->invalidateHashCache();
+    }
+
+    void Element::invalidateHashCache() {
+        Element *node = this;
+        while (node != nullptr && (node->_hashCached || node->_subtreeSignatureCached)) {
+            node->_hashCached = false;
+            node->_subtreeSignatureCached = false;
+            auto parent = node->_parent.lock();
+            node = parent.get();
+        }
     }
 
 /// According to given xpath selector, containing text, content, classname, resource id, test if
@@ -110,7 +167,7 @@ namespace fastbotx {
         // Most elements don't have ContentDesc, so check emptiness first
         bool isContentEqual = false;
         if (!xpathSelector->contentDescription.empty()) {
-            const std::string &contentDesc = this->getContentDesc();
+            const ElementString &contentDesc = this->getContentDesc();
             // Performance: Check length first to avoid string comparison if lengths differ
             if (contentDesc.length() == xpathSelector->contentDescription.length()) {
                 isContentEqual = (contentDesc == xpathSelector->contentDescription);
@@ -131,10 +188,10 @@ namespace fastbotx {
               xpathSelector->contentDescription.c_str(),
               xpathSelector->clazz.c_str(),
               xpathSelector->index,
-              this->getResourceID().c_str(),
-              this->getText().c_str(),
-              this->getContentDesc().c_str(),
-              this->getClassname().c_str(),
+              this->getResourceID().str().c_str(),
+              this->getText().str().c_str(),
+              this->getContentDesc().str().c_str(),
+              this->getClassname().str().c_str(),
               this->getIndex(),
               isResourceIDEqual,
               isTextEqual,
@@ -225,7 +282,9 @@ namespace fastbotx {
         }
     }
 
-    bool Element::_allClickableFalse = false;
+    thread_local bool Element::_allClickableFalse = false;
+
+    thread_local bool Element::_borrowBinaryStrings = false;
 
     /**
      * @brief Create an Element tree from XML string content
@@ -242,8 +301,6 @@ namespace fastbotx {
      * @return Shared pointer to root Element, or nullptr if parsing fails
      */
     ElementPtr Element::createFromXml(const std::string &xmlContent) {
-        tinyxml2::XMLDocument doc;
-        
         // Raw guitree log for debugging: log XML line by line (same format as logcat)
         // Performance optimization: Only log when FASTBOT_LOG_RAW_GUITREE is enabled
 #if FASTBOT_LOG_RAW_GUITREE
@@ -264,16 +321,48 @@ namespace fastbotx {
         // Only log size summary when detailed logging is disabled
         BLOG("guitree size=%zu", xmlContent.size());
 #endif
-        
+#if FASTBOT_STREAMING_XML
+        ElementPtr streamed = Element::createFromXmlStream(xmlContent.data(), xmlContent.size(), false);
+        if (streamed) {
+            return streamed;
+        }
+#endif
+        return Element::createFromXmlDom(xmlContent.data(), xmlContent.size());
+    }
+
+    /**
+     * @brief Create Element tree from XML bytes that need not be null-terminated
+     * 
+     * @param borrowStrings As for createFromBinary: text and content-desc without entities
+     *                      point into data instead of being copied (streaming parser only)
+     */
+    ElementPtr Element::createFromXml(const char *data, size_t size, bool borrowStrings) {
+        FASTBOT_TRACE_FUNCTION();
+        BLOG("guitree size=%zu", size);
+#if FASTBOT_STREAMING_XML
+        ElementPtr streamed = Element::createFromXmlStream(data, size, borrowStrings);
+        if (streamed) {
+            return streamed;
+        }
+#else
+        (void) borrowStrings;
+#endif
+        return Element::createFromXmlDom(data, size);
+    }
+
+    /// tinyxml2 DOM parse, then fromXml (the streaming parser's fallback for malformed dumps)
+    ElementPtr Element::createFromXmlDom(const char *data, size_t size) {
+        tinyxml2::XMLDocument doc;
         // Parse XML content
-        tinyxml2::XMLError errXml = doc.Parse(xmlContent.c_str());
+        ElementArena::recycle();
+        tinyxml2::XMLError errXml = doc.Parse(data, size);
 
         if (errXml != tinyxml2::XML_SUCCESS) {
             BLOGE("parse xml error %d", static_cast<int>(errXml));
             return nullptr;
         }
 
-        ElementPtr elementPtr = std::make_shared<Element>();
+        ElementPtr elementPtr = Element::newInArena(ElementArena::current());
 
         // Track if any element is clickable during parsing. Root has no parent (nullptr).
         _allClickableFalse = true;
@@ -295,8 +384,248 @@ namespace fastbotx {
         return elementPtr;
     }
 
+#if FASTBOT_FUSED_PARSE_HASH
+    /// Hash the payload as Widget normalises it (digits and blanks removed), no allocation
+    static uintptr_t hashStrippedText(const char *data, size_t size, uint32_t *strippedSize) {
+        thread_local std::string scratch;
+        bool overMaxLen = false;
+        uintptr_t hash = 0;
+        *strippedSize = static_cast<uint32_t>(normalizeWidgetText(data, size, false, scratch, overMaxLen, &hash));
+        return hash;
+    }
+#endif
+
+    namespace {
+        /// Attributes fromXmlStream reads, each with its short and long name
+        enum XmlField {
+            XmlIndex, XmlBounds, XmlText, XmlResourceID, XmlClass, XmlPackage, XmlContentDesc,
+            XmlCheckable, XmlClickable, XmlChecked, XmlEnabled, XmlFocused, XmlFocusable,
+            XmlScrollable, XmlLongClickable, XmlPassword, XmlSelected, XmlFieldCount
+        };
+
+        const struct {
+            const char *shortName;
+            size_t shortSize;
+            const char *longName;
+            size_t longSize;
+        } XmlFieldNames[XmlFieldCount] = {
+                {"idx", 3, "index", 5}, {"bnd", 3, "bounds", 6}, {"t", 1, "text", 4},
+                {"rid", 3, "resource-id", 11}, {"class", 5, "class", 5}, {"pkg", 3, "package", 7},
+                {"cd", 2, "content-desc", 12}, {"ck", 2, "checkable", 9}, {"clk", 3, "clickable", 9},
+                {"cked", 4, "checked", 7}, {"en", 2, "enabled", 7}, {"fcd", 3, "focused", 7},
+                {"foc", 3, "focusable", 9}, {"scl", 3, "scrollable", 10},
+                {"lclk", 4, "long-clickable", 14}, {"pwd", 3, "password", 8}, {"sel", 3, "selected", 8}};
+
+        /// tinyxml2 XMLUtil::ToInt: optional blanks, then "%d" or a 0x-prefixed "%x"
+        bool parseXmlInt(const char *p, const char *end, int &out) {
+            while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) p++;
+            bool neg = p < end && *p == '-';
+            if (p < end && (*p == '-' || *p == '+')) p++;
+            bool hex = !neg && end - p >= 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X');
+            if (hex) p += 2;
+            const char *digits = p;
+            unsigned int v = 0;
+            for (; p < end; p++) {
+                char c = *p;
+                unsigned int digit;
+                if (c >= '0' && c <= '9') digit = static_cast<unsigned int>(c - '0');
+                else if (hex && c >= 'a' && c <= 'f') digit = static_cast<unsigned int>(c - 'a' + 10);
+                else if (hex && c >= 'A' && c <= 'F') digit = static_cast<unsigned int>(c - 'A' + 10);
+                else break;
+                v = v * (hex ? 16 : 10) + digit;
+            }
+            if (p == digits) return false;
+            out = neg ? -static_cast<int>(v) : static_cast<int>(v);
+            return true;
+        }
+
+        /// tinyxml2 XMLUtil::ToBool: an integer (non-zero is true), or true/True/TRUE, false/False/FALSE
+        bool parseXmlBool(const char *p, const char *end, bool &out) {
+            int v = 0;
+            if (parseXmlInt(p, end, v)) {
+                out = v != 0;
+                return true;
+            }
+            size_t size = static_cast<size_t>(end - p);
+            if (size == 4 && (0 == memcmp(p, "true", 4) || 0 == memcmp(p, "True", 4) || 0 == memcmp(p, "TRUE", 4))) {
+                out = true;
+                return true;
+            }
+            if (size == 5 && (0 == memcmp(p, "false", 5) || 0 == memcmp(p, "False", 5) || 0 == memcmp(p, "FALSE", 5))) {
+                out = false;
+                return true;
+            }
+            return false;
+        }
+    }
+
+    /**
+     * @brief Build the tree straight from XML bytes with XmlStreamReader (no DOM)
+     * 
+     * Same Elements as createFromXmlDom: attributes are resolved the way fromXMLNode
+     * queries them (short name first, empty strings ignored) and finishXmlAttributes
+     * runs as soon as a node's start tag is read, since only the parent's flags matter.
+     * 
+     * @return nullptr if the document is malformed (the caller falls back to the DOM)
+     */
+    ElementPtr Element::createFromXmlStream(const char *data, size_t size, bool borrowStrings) {
+        XmlStreamReader reader(data, size);
+        ElementArena::recycle();
+        _allClickableFalse = true;
+        ElementPtr root;
+        std::vector<ElementPtr> openElements;
+        openElements.reserve(64);
+        while (true) {
+            XmlStreamReader::Event event = reader.next();
+            if (event == XmlStreamReader::Event::StartElement) {
+                ElementPtr parent = openElements.empty() ? nullptr : openElements.back();
+                ElementPtr element = Element::newInArena(parent ? parent->childArena() : ElementArena::current());
+                if (parent) {
+                    if (parent->_children.empty()) {
+                        parent->_children.reserve(8);
+                    }
+                    parent->_children.emplace_back(element);
+                } else {
+                    root = element;
+                }
+                element->fromXmlStream(reader, parent, borrowStrings);
+                openElements.push_back(std::move(element));
+            } else if (event == XmlStreamReader::Event::EndElement) {
+                Element *element = openElements.back().get();
+                element->_childCount = static_cast<int>(element->_children.size());
+                openElements.pop_back();
+            } else if (event == XmlStreamReader::Event::EndOfDocument) {
+                break;
+            } else {
+                BLOG("streaming xml parse stopped at offset %zu, using DOM parser", reader.offset());
+                return nullptr;
+            }
+        }
+        if (!root) {
+            return nullptr;
+        }
+        if (_allClickableFalse) {
+            root->recursiveDoElements([](const ElementPtr &elm) {
+                elm->_clickable = true;
+            });
+        }
+        root->_scrollable = true;
+        return root;
+    }
+
+    /// Fill this node from the attributes of the start tag reader just reported
+    void Element::fromXmlStream(const XmlStreamReader &reader, const ElementPtr &parentOfNode,
+                                bool borrowStrings) {
+        if (parentOfNode)
+            this->_parent = parentOfNode;
+        // [field][0]: short name, [field][1]: long name; the first occurrence counts
+        const XmlStreamReader::Attribute *found[XmlFieldCount][2] = {};
+        for (const XmlStreamReader::Attribute &attribute: reader.attributes()) {
+            for (int field = 0; field < XmlFieldCount; field++) {
+                if (attribute.nameIs(XmlFieldNames[field].shortName, XmlFieldNames[field].shortSize)) {
+                    if (!found[field][0]) found[field][0] = &attribute;
+                    break;
+                }
+                if (attribute.nameIs(XmlFieldNames[field].longName, XmlFieldNames[field].longSize)) {
+                    if (!found[field][1]) found[field][1] = &attribute;
+                    break;
+                }
+            }
+        }
+        // Values with entities or carriage returns are decoded here (rare in GUI dumps)
+        thread_local std::string decoded;
+        auto valueOf = [](const XmlStreamReader::Attribute *attribute, const char *&value, size_t &valueSize) {
+            if (attribute->needsDecode) {
+                XmlStreamReader::decode(attribute->value, attribute->valueSize, decoded);
+                value = decoded.data();
+                valueSize = decoded.size();
+            } else {
+                value = attribute->value;
+                valueSize = attribute->valueSize;
+            }
+        };
+        // queryStringAttr: the short name unless its value is empty, then the long name
+        auto stringField = [&](int field, const char *&value, size_t &valueSize, bool &isDecoded) {
+            for (const XmlStreamReader::Attribute *attribute: found[field]) {
+                if (attribute && attribute->valueSize > 0) {
+                    valueOf(attribute, value, valueSize);
+                    isDecoded = attribute->needsDecode;
+                    if (valueSize > 0) return true;
+                }
+            }
+            return false;
+        };
+        auto boolField = [&](int field, bool &out) {
+            for (const XmlStreamReader::Attribute *attribute: found[field]) {
+                const char *value = nullptr;
+                size_t valueSize = 0;
+                if (attribute) {
+                    valueOf(attribute, value, valueSize);
+                    if (parseXmlBool(value, value + valueSize, out)) return true;
+                }
+            }
+            return false;
+        };
+
+        const char *value = nullptr;
+        size_t valueSize = 0;
+        bool isDecoded = false;
+        for (const XmlStreamReader::Attribute *attribute: found[XmlIndex]) {
+            int indexOfNode = 0;
+            if (attribute) {
+                valueOf(attribute, value, valueSize);
+                if (parseXmlInt(value, value + valueSize, indexOfNode)) {
+                    this->_index = indexOfNode;
+                    break;
+                }
+            }
+        }
+        int bounds[4];
+        if (stringField(XmlBounds, value, valueSize, isDecoded)) {
+            // parseBounds stops at the closing quote (or the decoded string's terminator)
+            if (parseBounds(value, bounds)) this->setXmlBounds(bounds);
+        }
+        if (stringField(XmlText, value, valueSize, isDecoded)) {
+            this->_text = (borrowStrings && !isDecoded) ? ElementString(value, valueSize) : storeString(value, valueSize);
+#if FASTBOT_FUSED_PARSE_HASH
+            this->_fusedHashes.strippedText = hashStrippedText(this->_text.data(), this->_text.size(),
+                                                               &this->_fusedHashes.strippedTextSize);
+            this->_fusedHashes.text = this->_text.hash();
+#endif
+        }
+        if (stringField(XmlResourceID, value, valueSize, isDecoded))
+            this->_resourceID = internString(this->_internedResourceID, value, valueSize);
+        if (stringField(XmlClass, value, valueSize, isDecoded))
+            this->_classname = internString(this->_internedClassname, value, valueSize);
+        if (stringField(XmlPackage, value, valueSize, isDecoded))
+            this->_packageName = internString(this->_internedPackageName, value, valueSize);
+        if (stringField(XmlContentDesc, value, valueSize, isDecoded)) {
+            this->_contentDesc = (borrowStrings && !isDecoded) ? ElementString(value, valueSize)
+                                                               : storeString(value, valueSize);
+#if FASTBOT_FUSED_PARSE_HASH
+            this->_fusedHashes.contentDesc = this->_contentDesc.hash();
+#endif
+        }
+#if FASTBOT_FUSED_PARSE_HASH
+        this->_fusedHashesValid = true;
+#endif
+        bool b = false;
+        if (boolField(XmlCheckable, b)) this->_checkable = b;
+        if (boolField(XmlClickable, b)) { this->_clickable = b; if (b) _allClickableFalse = false; }
+        if (boolField(XmlChecked, b)) this->_checked = b;
+        if (boolField(XmlEnabled, b)) this->_enabled = b;
+        if (boolField(XmlFocused, b)) this->_focused = b;
+        if (boolField(XmlFocusable, b)) this->_focusable = b;
+        if (boolField(XmlScrollable, b)) this->_scrollable = b;
+        if (boolField(XmlLongClickable, b)) this->_longClickable = b;
+        if (boolField(XmlPassword, b)) this->_password = b;
+        if (boolField(XmlSelected, b)) this->_selected = b;
+        this->finishXmlAttributes(parentOfNode);
+    }
+
     ElementPtr Element::createFromXml(const tinyxml2::XMLDocument &doc) {
-        ElementPtr elementPtr = std::make_shared<Element>(); // Root element has no parent
+        ElementArena::recycle();
+        ElementPtr elementPtr = Element::newInArena(ElementArena::current()); // Root element has no parent
         _allClickableFalse = true;
         elementPtr->fromXml(doc, nullptr);
         if (_allClickableFalse) {
@@ -319,7 +648,7 @@ namespace fastbotx {
 
     ElementPtr Element::parseBinaryNode(const char *buf, size_t len, size_t *offset, const ElementPtr &parent) {
         if (*offset + 21 > len) return nullptr;  // min header
-        ElementPtr elm = std::make_shared<Element>();
+        ElementPtr elm = Element::newInArena(parent ? parent->childArena() : ElementArena::current());
         if (!elm->parseBinaryNodeSelf(buf, len, offset, parent)) return nullptr;
         return elm;
     }
@@ -335,30 +664,39 @@ namespace fastbotx {
             !readBytes(buf, len, offset, &numStrings, 1)) return false;
         if (parent) _parent = parent;
         _index = idx;
-        _bounds = std::make_shared<Rect>(left, top, right, bottom);
-        _checkable = (flags & 1) != 0;
-        _checked = (flags & 2) != 0;
-        _clickable = (flags & 4) != 0;
-        if (_clickable) _allClickableFalse = false;
-        _enabled = (flags & 8) != 0;
-        _focusable = (flags & 16) != 0;
-        _focused = (flags & 32) != 0;
-        _scrollable = (flags & 64) != 0;
-        _longClickable = (flags & 128) != 0;
-        _password = (flags & 256) != 0;
-        _selected = (flags & 512) != 0;
+        _bounds = Rect(left, top, right, bottom);
+        setBinaryFlags(flags);
         for (uint8_t i = 0; i < numStrings && *offset + 3 <= len; i++) {
             uint8_t tag;
             uint16_t slen;
             if (!readBytes(buf, len, offset, &tag, 1) || !readBytes(buf, len, offset, &slen, 2) || *offset + slen > len) break;
-            std::string s(buf + *offset, slen);
+            // Performance optimization: in borrow mode the payload is used in place (no copy);
+            // class and package names repeat on every node, so this removes most per-step copies
+            // Resource IDs, class and package names are interned instead (see below).
+            bool interned = (tag == TAG_RID || tag == TAG_CLASS || tag == TAG_PKG);
+            ElementString s = (_borrowBinaryStrings || interned) ? ElementString(buf + *offset, slen)
+                                                                 : storeString(buf + *offset, slen);
             *offset += slen;
-            if (tag == TAG_TEXT) _text = std::move(s);
-            else if (tag == TAG_RID) _resourceID = std::move(s);
-            else if (tag == TAG_CLASS) _classname = std::move(s);
-            else if (tag == TAG_PKG) _packageName = std::move(s);
-            else if (tag == TAG_CD) _contentDesc = std::move(s);
+            if (tag == TAG_TEXT) {
+                _text = s;
+#if FASTBOT_FUSED_PARSE_HASH
+                _fusedHashes.strippedText = hashStrippedText(s.data(), s.size(), &_fusedHashes.strippedTextSize);
+                _fusedHashes.text = s.hash();
+#endif
+            }
+            else if (tag == TAG_RID) _resourceID = internString(_internedResourceID, s.data(), s.size());
+            else if (tag == TAG_CLASS) _classname = internString(_internedClassname, s.data(), s.size());
+            else if (tag == TAG_PKG) _packageName = internString(_internedPackageName, s.data(), s.size());
+            else if (tag == TAG_CD) {
+                _contentDesc = s;
+#if FASTBOT_FUSED_PARSE_HASH
+                _fusedHashes.contentDesc = s.hash();
+#endif
+            }
         }
+#if FASTBOT_FUSED_PARSE_HASH
+        _fusedHashesValid = true;
+#endif
         uint16_t numChildren;
         if (!readBytes(buf, len, offset, &numChildren, 2)) return true;
         _children.reserve(numChildren > 32 ? 32 : numChildren);
@@ -367,27 +705,354 @@ namespace fastbotx {
             if (!child) break;
             _children.push_back(child);
         }
+        finishBinaryNode();
+        return true;
+    }
+
+    void Element::setBinaryFlags(uint32_t flags) {
+        _checkable = (flags & 1) != 0;
+        _checked = (flags & 2) != 0;
+        _clickable = (flags & 4) != 0;
+        if (_clickable) _allClickableFalse = false;
+        _enabled = (flags & 8) != 0;
+        _focusable = (flags & 16) != 0;
+        _focused = (flags & 32) != 0;
+        _scrollable = (flags & 64) != 0;
+        _longClickable = (flags & 128) != 0;
+        _password = (flags & 256) != 0;
+        _selected = (flags & 512) != 0;
+    }
+
+    void Element::finishBinaryNode() {
         _childCount = static_cast<int>(_children.size());
         _isEditable = (_classname == "android.widget.EditText");
         if (_isEditable) _longClickable = _clickable = _enabled = true;
         _cachedScrollType = _computeScrollType();
         _scrollTypeCached = true;
+    }
+
+    // Binary format v2: magic "FB\0\2" (4), node_count(varint), string_count(varint), [len(varint) data(len)]*,
+    // then nodes in pre-order: bounds as zigzag varint deltas from the parent's left/top/right/bottom (the
+    // root's from 0), index(varint), flags(varint), field_mask(1, bit per TAG_*), [string_index(varint)] per
+    // set bit in tag order, num_children(varint, may be zero-padded for back-patching), children*
+    static const char BINARY_MAGIC_V2[] = {'F', 'B', 0, 2};
+
+    static bool readVarint(const char *buf, size_t len, size_t *offset, uint64_t *out) {
+        uint64_t value = 0;
+        for (unsigned shift = 0; shift < 64 && *offset < len; shift += 7) {
+            auto byte = static_cast<uint8_t>(buf[(*offset)++]);
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                *out = value;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool readZigzag(const char *buf, size_t len, size_t *offset, int64_t *out) {
+        uint64_t value;
+        if (!readVarint(buf, len, offset, &value)) return false;
+        *out = static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
         return true;
     }
 
-    ElementPtr Element::createFromBinary(const char *buf, size_t len) {
-        if (len < 4 || memcmp(buf, BINARY_MAGIC, 4) != 0) return nullptr;
-        size_t offset = 4;
+    /**
+     * @brief String table of one v2 dump, and the base tree when it is a delta dump
+     *
+     * Each entry is resolved on first use and shared by every node that references it:
+     * interned once for resource IDs, class and package names, copied into the arena once
+     * (unless borrowing) and hashed once for text and content-desc.
+     */
+    struct BinaryDumpContext {
+        struct Entry {
+            ElementString value;
+            InternedString atom;
+            bool interned{false};
+            bool stored{false};
+#if FASTBOT_FUSED_PARSE_HASH
+            bool hashed{false};
+            uintptr_t hash{0};
+            bool textHashed{false};
+            uintptr_t strippedTextHash{0};
+            uint32_t strippedTextSize{0};
+#endif
+        };
+
+        std::vector<Entry> entries;
+        ElementArena *arena{nullptr};
+        bool borrow{false};
+        /// Nodes the header announced and not yet parsed; a node beyond them is corrupt input
+        uint64_t remainingNodes{0};
+        /// Tree that node references resolve against; null for a v2 dump
+        const BinaryDeltaBase *base{nullptr};
+
+        /// Text or content-desc payload: in place when borrowing, else one arena copy per entry
+        ElementString payload(Entry &entry) const {
+            if (!this->borrow && !entry.stored) {
+                entry.value = this->arena->copyString(entry.value.data(), entry.value.size());
+                entry.stored = true;
+            }
+            return entry.value;
+        }
+
+        static ElementString intern(Entry &entry, InternedString &atom) {
+            if (!entry.interned) {
+                entry.atom = InternedString::intern(entry.value.data(), entry.value.size());
+                entry.interned = true;
+            }
+            atom = entry.atom;
+            const std::string &interned = atom.str();
+            return {interned.data(), interned.size()};
+        }
+    };
+
+    ElementPtr Element::parseBinaryNodeV2(const char *buf, size_t len, size_t *offset, const ElementPtr &parent,
+                                          BinaryDumpContext &context) {
+        if (context.base) {
+            uint64_t reference, index;
+            if (!readVarint(buf, len, offset, &reference)) return nullptr;
+            if (reference != 0) {
+                // Unchanged subtree of the base dump: copied as it is, only its position is new
+                const BinaryDeltaBase &base = *context.base;
+                if (reference > base.nodes.size() || !readVarint(buf, len, offset, &index) ||
+                    base.subtreeSizes[reference - 1] > context.remainingNodes) return nullptr;
+                context.remainingNodes -= base.subtreeSizes[reference - 1];
+                ElementPtr elm = base.nodes[reference - 1]->cloneInto(context.arena, parent);
+                elm->_index = static_cast<int>(index);
+                return elm;
+            }
+        }
+        if (context.remainingNodes == 0) return nullptr;
+        context.remainingNodes--;
+        ElementPtr elm = Element::newInArena(context.arena);
+        if (!elm->parseBinaryNodeSelfV2(buf, len, offset, parent, context)) return nullptr;
+        return elm;
+    }
+
+    bool Element::parseBinaryNodeSelfV2(const char *buf, size_t len, size_t *offset, const ElementPtr &parent,
+                                        BinaryDumpContext &context) {
+        int64_t bounds[4];
+        for (int64_t &value: bounds) {
+            if (!readZigzag(buf, len, offset, &value)) return false;
+        }
+        if (parent) {
+            _parent = parent;
+            const Rect &parentBounds = parent->_bounds;
+            bounds[0] += parentBounds.left;
+            bounds[1] += parentBounds.top;
+            bounds[2] += parentBounds.right;
+            bounds[3] += parentBounds.bottom;
+        }
+        uint64_t idx, flags;
+        if (!readVarint(buf, len, offset, &idx) || !readVarint(buf, len, offset, &flags) || *offset >= len) {
+            return false;
+        }
+        auto fieldMask = static_cast<uint8_t>(buf[(*offset)++]);
+        _index = static_cast<int>(idx);
+        _bounds = Rect(static_cast<int>(bounds[0]), static_cast<int>(bounds[1]), static_cast<int>(bounds[2]),
+                       static_cast<int>(bounds[3]));
+        setBinaryFlags(static_cast<uint32_t>(flags));
+        for (int tag = TAG_TEXT; tag <= TAG_CD; tag++) {
+            if (!(fieldMask & (1 << tag))) continue;
+            uint64_t stringIndex;
+            if (!readVarint(buf, len, offset, &stringIndex) || stringIndex >= context.entries.size()) return false;
+            BinaryDumpContext::Entry &entry = context.entries[stringIndex];
+            if (tag == TAG_TEXT) {
+                _text = context.payload(entry);
+#if FASTBOT_FUSED_PARSE_HASH
+                if (!entry.textHashed) {
+                    entry.strippedTextHash = hashStrippedText(entry.value.data(), entry.value.size(),
+                                                              &entry.strippedTextSize);
+                    entry.textHashed = true;
+                }
+                _fusedHashes.strippedText = entry.strippedTextHash;
+                _fusedHashes.strippedTextSize = entry.strippedTextSize;
+                if (!entry.hashed) {
+                    entry.hash = entry.value.hash();
+                    entry.hashed = true;
+                }
+                _fusedHashes.text = entry.hash;
+#endif
+            }
+            else if (tag == TAG_RID) _resourceID = BinaryDumpContext::intern(entry, _internedResourceID);
+            else if (tag == TAG_CLASS) _classname = BinaryDumpContext::intern(entry, _internedClassname);
+            else if (tag == TAG_PKG) _packageName = BinaryDumpContext::intern(entry, _internedPackageName);
+            else {
+                _contentDesc = context.payload(entry);
+#if FASTBOT_FUSED_PARSE_HASH
+                if (!entry.hashed) {
+                    entry.hash = entry.value.hash();
+                    entry.hashed = true;
+                }
+                _fusedHashes.contentDesc = entry.hash;
+#endif
+            }
+        }
+#if FASTBOT_FUSED_PARSE_HASH
+        _fusedHashesValid = true;
+#endif
+        uint64_t numChildren;
+        if (!readVarint(buf, len, offset, &numChildren) || numChildren > context.remainingNodes) return false;
+        _children.reserve(static_cast<size_t>(numChildren));
+        ElementPtr self = shared_from_this();
+        for (uint64_t c = 0; c < numChildren; c++) {
+            ElementPtr child = Element::parseBinaryNodeV2(buf, len, offset, self, context);
+            if (!child) break;
+            _children.push_back(child);
+        }
+        finishBinaryNode();
+        return true;
+    }
+
+    /// Arena bytes one node takes besides its strings: the Element (bounds inline) and its shared_ptr control block
+    static constexpr size_t BinaryNodeArenaBytes = sizeof(Element) + 4 * sizeof(void *);
+
+    ElementPtr Element::parseBinaryDumpV2(const char *buf, size_t len, size_t offset, bool borrowStrings,
+                                          const BinaryDeltaBase *base) {
+        uint64_t nodeCount, stringCount;
+        // Every string and every node sent in full takes at least one byte, which bounds both counts
+        if (!readVarint(buf, len, &offset, &nodeCount) || nodeCount == 0 || (!base && nodeCount > len) ||
+            !readVarint(buf, len, &offset, &stringCount) || stringCount > len) return nullptr;
+        BinaryDumpContext context;
+        context.entries.resize(static_cast<size_t>(stringCount));
+        size_t stringBytes = 0;
+        for (BinaryDumpContext::Entry &entry: context.entries) {
+            uint64_t size;
+            if (!readVarint(buf, len, &offset, &size) || size > len - offset) return nullptr;
+            entry.value = ElementString(buf + offset, static_cast<size_t>(size));
+            offset += static_cast<size_t>(size);
+            stringBytes += static_cast<size_t>(size);
+        }
+        ElementArena::recycle();
+        context.arena = ElementArena::current();
+        context.borrow = borrowStrings;
+        context.remainingNodes = nodeCount;
+        context.base = base;
+        // Nodes, rects and copied strings of the whole dump in at most one new block
+        context.arena->reserve(static_cast<size_t>(std::min<uint64_t>(nodeCount, len)) * BinaryNodeArenaBytes +
+                               (borrowStrings ? 0 : stringBytes));
         Element::_allClickableFalse = true;
-        ElementPtr root = Element::parseBinaryNode(buf, len, &offset, nullptr);
-        if (!root) return nullptr;
+        return Element::parseBinaryNodeV2(buf, len, &offset, nullptr, context);
+    }
+
+    void Element::finishBinaryTree(const ElementPtr &root) {
         if (Element::_allClickableFalse) {
             root->recursiveDoElements([](const ElementPtr &elm) { elm->_clickable = true; });
         }
         root->_scrollable = true;
+    }
+
+    ElementPtr Element::createFromBinary(const char *buf, size_t len, bool borrowStrings) {
+        FASTBOT_TRACE_FUNCTION();
+        if (len < 4 || memcmp(buf, BINARY_MAGIC, 3) != 0) return nullptr;
+        size_t offset = 4;
+        ElementPtr root;
+        if (buf[3] == BINARY_MAGIC[3]) {
+            ElementArena::recycle();
+            Element::_allClickableFalse = true;
+            Element::_borrowBinaryStrings = borrowStrings;
+            root = Element::parseBinaryNode(buf, len, &offset, nullptr);
+            Element::_borrowBinaryStrings = false;
+        } else if (buf[3] == BINARY_MAGIC_V2[3]) {
+            root = Element::parseBinaryDumpV2(buf, len, offset, borrowStrings, nullptr);
+        }
+        if (!root) return nullptr;
+        finishBinaryTree(root);
         return root;
     }
 
+    // Delta dump: magic "FB\0\3" (4), dump_id(varint), base_dump_id(varint, 0 for none), then the rest of a
+    // v2 dump (node_count counts the nodes of the resulting tree) except that every node starts with
+    // reference(varint): 0 for a node sent in full, k > 0 for the subtree of the base dump's tree at
+    // pre-order position k - 1, followed only by its index(varint) under its new parent
+    static const char BINARY_MAGIC_DELTA[] = {'F', 'B', 0, 3};
+
+    bool Element::isBinaryDelta(const char *buf, size_t len) {
+        return len >= 4 && memcmp(buf, BINARY_MAGIC_DELTA, 4) == 0;
+    }
+
+    ElementPtr Element::parseBinaryDelta(const char *buf, size_t len, bool borrowStrings, const BinaryDeltaBase &base,
+                                         uint64_t *dumpId) {
+        FASTBOT_TRACE_FUNCTION();
+        if (!isBinaryDelta(buf, len)) return nullptr;
+        size_t offset = 4;
+        uint64_t baseDumpId;
+        if (!readVarint(buf, len, &offset, dumpId) || !readVarint(buf, len, &offset, &baseDumpId)) return nullptr;
+        if (baseDumpId != 0 && baseDumpId != base.dumpId) {
+            BDLOG("delta dump %llu is based on dump %llu, not on the retained %llu", (unsigned long long) *dumpId,
+                  (unsigned long long) baseDumpId, (unsigned long long) base.dumpId);
+            return nullptr;
+        }
+        // A dump without a base has no references, which the empty base enforces
+        static const BinaryDeltaBase noBase;
+        return Element::parseBinaryDumpV2(buf, len, offset, borrowStrings, baseDumpId != 0 ? &base : &noBase);
+    }
+
+    ElementPtr Element::cloneInto(ElementArena *arena, const ElementPtr &parent, BinaryDeltaBase *record) const {
+        ElementPtr copy = Element::newInArena(arena);
+        size_t position = record ? record->nodes.size() : 0;
+        if (record) {
+            record->nodes.push_back(copy);
+            record->subtreeSizes.push_back(1);
+        }
+        copy->_parent = parent;
+        copy->_resourceID = this->_resourceID;
+        copy->_classname = this->_classname;
+        copy->_packageName = this->_packageName;
+        copy->_internedResourceID = this->_internedResourceID;
+        copy->_internedClassname = this->_internedClassname;
+        copy->_internedPackageName = this->_internedPackageName;
+        copy->_text = copy->storeString(this->_text.data(), this->_text.size());
+        copy->_contentDesc = copy->storeString(this->_contentDesc.data(), this->_contentDesc.size());
+        copy->_inputText = this->_inputText;
+        copy->_activity = this->_activity;
+        copy->_validText = this->_validText;
+        copy->_enabled = this->_enabled;
+        copy->_checked = this->_checked;
+        copy->_checkable = this->_checkable;
+        copy->_clickable = this->_clickable;
+        if (copy->_clickable) _allClickableFalse = false;
+        copy->_focusable = this->_focusable;
+        copy->_scrollable = this->_scrollable;
+        copy->_longClickable = this->_longClickable;
+        copy->_focused = this->_focused;
+        copy->_index = this->_index;
+        copy->_password = this->_password;
+        copy->_selected = this->_selected;
+        copy->_isEditable = this->_isEditable;
+        copy->_bounds = this->_bounds;
+        copy->_cachedScrollType = this->_cachedScrollType;
+        copy->_scrollTypeCached = this->_scrollTypeCached;
+        copy->_fusedHashes = this->_fusedHashes;
+        copy->_fusedHashesValid = this->_fusedHashesValid;
+        copy->_children.reserve(this->_children.size());
+        for (const auto &child: this->_children) {
+            copy->_children.push_back(child->cloneInto(arena, copy, record));
+        }
+        copy->_childCount = static_cast<int>(copy->_children.size());
+        if (record) {
+            record->subtreeSizes[position] = static_cast<uint32_t>(record->nodes.size() - position);
+        }
+        return copy;
+    }
+
+    /**
+     * @brief Re-home borrowed string fields into the arena
+     *
+     * Needed only for trees built with createFromBinary(..., true) that are kept
+     * after the source buffer is released. Fields already in the arena are copied
+     * again, which is harmless and keeps this method stateless.
+     */
+    void Element::detachStrings() {
+        // Resource ID, class and package already point at interned storage
+        this->_text = storeString(this->_text.data(), this->_text.size());
+        this->_contentDesc = storeString(this->_contentDesc.data(), this->_contentDesc.size());
+        for (const auto &child: this->_children) {
+            child->detachStrings();
+        }
+    }
+
     void Element::fromJson(const std::string &/*jsonData*/) {
         //nlohmann::json
     }
@@ -399,13 +1064,12 @@ namespace fastbotx {
 
     std::string Element::toJson() const {
         nlohmann::json j;
-        RectPtr bounds = this->getBounds();
-        j["bounds"] = bounds ? bounds->toString().c_str() : "";
+        j["bounds"] = this->_bounds.toString();
         j["index"] = this->getIndex();
-        j["class"] = this->getClassname().c_str();
-        j["resource-id"] = this->getResourceID().c_str();
-        j["package"] =  this->getPackageName().c_str();
-        j["content-desc"] = this->getContentDesc().c_str();
+        j["class"] = this->getClassname().str();
+        j["resource-id"] = this->getResourceID().str();
+        j["package"] =  this->getPackageName().str();
+        j["content-desc"] = this->getContentDesc().str();
         j["checkable"] = this->getCheckable() ? "true" : "false";
         j["checked"] = this->_checked ? "true" : "false";
         j["clickable"] = this->getClickable() ? "true" : "false";
@@ -419,20 +1083,16 @@ namespace fastbotx {
     }
 
     void Element::recursiveToXML(tinyxml2::XMLElement *xml, const Element *elm) const {
-        RectPtr bounds = elm->getBounds();
-        if (bounds) {
-            char boundsBuf[48];
-            std::snprintf(boundsBuf, sizeof(boundsBuf), "[%d,%d][%d,%d]",
-                          bounds->left, bounds->top, bounds->right, bounds->bottom);
-            xml->SetAttribute("bounds", boundsBuf);
-        } else {
-            xml->SetAttribute("bounds", "");
-        }
+        const Rect &bounds = elm->getBounds();
+        char boundsBuf[48];
+        std::snprintf(boundsBuf, sizeof(boundsBuf), "[%d,%d][%d,%d]",
+                      bounds.left, bounds.top, bounds.right, bounds.bottom);
+        xml->SetAttribute("bounds", boundsBuf);
         xml->SetAttribute("index", elm->getIndex());
-        xml->SetAttribute("class", elm->getClassname().c_str());
-        xml->SetAttribute("resource-id", elm->getResourceID().c_str());
-        xml->SetAttribute("package", elm->getPackageName().c_str());
-        xml->SetAttribute("content-desc", elm->getContentDesc().c_str());
+        xml->SetAttribute("class", elm->getClassname().str().c_str());
+        xml->SetAttribute("resource-id", elm->getResourceID().str().c_str());
+        xml->SetAttribute("package", elm->getPackageName().str().c_str());
+        xml->SetAttribute("content-desc", elm->getContentDesc().str().c_str());
         xml->SetAttribute("checkable", elm->getCheckable() ? "true" : "false");
         xml->SetAttribute("checked", elm->_checked ? "true" : "false");
         xml->SetAttribute("clickable", elm->getClickable() ? "true" : "false");
@@ -485,37 +1145,21 @@ namespace fastbotx {
         if (queryIntAttr(xmlNode, "idx", "index", indexOfNode))
             this->_index = indexOfNode;
         const char *boundingBoxStr = nullptr;
-        if (queryStringAttr(xmlNode, "bnd", "bounds", boundingBoxStr) && boundingBoxStr && *boundingBoxStr == '[') {
-            const char *p = boundingBoxStr + 1;
-            int xl = parseIntAndAdvance(p);
-            if (*p == ',') {
-                ++p;
-                int yl = parseIntAndAdvance(p);
-                if (p[0] == ']' && p[1] == '[') {
-                    p += 2;
-                    int xr = parseIntAndAdvance(p);
-                    if (*p == ',') {
-                        ++p;
-                        int yr = parseIntAndAdvance(p);
-                        if (*p == ']') {
-                            this->_bounds = std::make_shared<Rect>(xl, yl, xr, yr);
-                            if (this->_bounds->isEmpty())
-                                this->_bounds = Rect::RectZero;
-                        }
-                    }
-                }
-            }
+        int bounds[4];
+        if (queryStringAttr(xmlNode, "bnd", "bounds", boundingBoxStr) && boundingBoxStr &&
+            parseBounds(boundingBoxStr, bounds)) {
+            this->setXmlBounds(bounds);
         }
         const char *text = nullptr;
-        if (queryStringAttr(xmlNode, "t", "text", text)) this->_text = std::string(text);
+        if (queryStringAttr(xmlNode, "t", "text", text)) this->_text = storeString(text, std::strlen(text));
         const char *resource_id = nullptr;
-        if (queryStringAttr(xmlNode, "rid", "resource-id", resource_id)) this->_resourceID = std::string(resource_id);
+        if (queryStringAttr(xmlNode, "rid", "resource-id", resource_id)) this->_resourceID = internString(this->_internedResourceID, resource_id, std::strlen(resource_id));
         const char *tclassname = nullptr;
-        if (queryStringAttr(xmlNode, "class", "class", tclassname)) this->_classname = std::string(tclassname);
+        if (queryStringAttr(xmlNode, "class", "class", tclassname)) this->_classname = internString(this->_internedClassname, tclassname, std::strlen(tclassname));
         const char *pkgname = nullptr;
-        if (queryStringAttr(xmlNode, "pkg", "package", pkgname)) this->_packageName = std::string(pkgname);
+        if (queryStringAttr(xmlNode, "pkg", "package", pkgname)) this->_packageName = internString(this->_internedPackageName, pkgname, std::strlen(pkgname));
         const char *content_desc = nullptr;
-        if (queryStringAttr(xmlNode, "cd", "content-desc", content_desc)) this->_contentDesc = std::string(content_desc);
+        if (queryStringAttr(xmlNode, "cd", "content-desc", content_desc)) this->_contentDesc = storeString(content_desc, std::strlen(content_desc));
         bool b = false;
         if (queryBoolAttr(xmlNode, "ck", "checkable", b)) this->_checkable = b;
         if (queryBoolAttr(xmlNode, "clk", "clickable", b)) { this->_clickable = b; if (b) _allClickableFalse = false; }
@@ -527,7 +1171,30 @@ namespace fastbotx {
         if (queryBoolAttr(xmlNode, "lclk", "long-clickable", b)) this->_longClickable = b;
         if (queryBoolAttr(xmlNode, "pwd", "password", b)) this->_password = b;
         if (queryBoolAttr(xmlNode, "sel", "selected", b)) this->_selected = b;
+        this->finishXmlAttributes(parentOfNode);
 
+        // Performance: Only call shared_from_this() and reserve when node has children (most nodes are leaves).
+        if (!xmlNode->NoChildren()) {
+            this->_children.reserve(8);
+            const ElementPtr self = shared_from_this();
+            for (const tinyxml2::XMLElement *childNode = xmlNode->FirstChildElement();
+                 childNode != nullptr; childNode = childNode->NextSiblingElement()) {
+                ElementPtr childElement = Element::newInArena(this->childArena());
+                this->_children.emplace_back(childElement);
+                childElement->fromXMLNode(childNode, self);
+            }
+        }
+        this->_childCount = static_cast<int>(this->_children.size());
+    }
+
+    void Element::setXmlBounds(const int (&bounds)[4]) {
+        this->_bounds = Rect(bounds[0], bounds[1], bounds[2], bounds[3]);
+        if (this->_bounds.isEmpty())
+            this->_bounds = Rect();
+    }
+
+    /// Flags derived from the attributes of an XML node (fromXMLNode and fromXmlStream)
+    void Element::finishXmlAttributes(const ElementPtr &parentOfNode) {
         this->_isEditable = "android.widget.EditText" == this->_classname;
         if (FORCE_EDITTEXT_CLICK_TRUE && this->_isEditable) {
             this->_longClickable = this->_clickable = this->_enabled = true;
@@ -545,19 +1212,6 @@ namespace fastbotx {
 
         this->_cachedScrollType = this->_computeScrollType();
         this->_scrollTypeCached = true;
-
-        // Performance: Only call shared_from_this() and reserve when node has children (most nodes are leaves).
-        if (!xmlNode->NoChildren()) {
-            this->_children.reserve(8);
-            const ElementPtr self = shared_from_this();
-            for (const tinyxml2::XMLElement *childNode = xmlNode->FirstChildElement();
-                 childNode != nullptr; childNode = childNode->NextSiblingElement()) {
-                ElementPtr childElement = std::make_shared<Element>();
-                this->_children.emplace_back(childElement);
-                childElement->fromXMLNode(childNode, self);
-            }
-        }
-        this->_childCount = static_cast<int>(this->_children.size());
     }
 
     bool Element::isWebView() const {
@@ -584,7 +1238,7 @@ namespace fastbotx {
                    || "android.support.v4.view.ViewPager" == _classname) {
             return ScrollType::Horizontal;
         }
-        if (this->_classname.find("ScrollView") != std::string::npos) {
+        if (this->_classname.contains("ScrollView")) {
             return ScrollType::ALL;
         }
 
@@ -620,6 +1274,9 @@ namespace fastbotx {
      * - Uses bit shifting and XOR for efficient hash combination
      * - Caches individual property hashes before combining
      * - Only processes children if recursive flag is set
+     * - Merkle caching: each node caches its recursive hash and setters mark the
+     *   path to the root dirty, so rehashing a page after Preference edits only
+     *   recomputes the changed nodes and their ancestors
      * 
      * @param recursive If true, include children in hash computation
      * @return Hash code as long integer
@@ -639,17 +1296,17 @@ namespace fastbotx {
         // Performance optimization: Use fast string hash function instead of std::hash
         // This provides better performance for typical UI strings (short to medium length)
         // Compute individual property hashes with different bit shifts for better distribution
-        uintptr_t hashcode1 = 127U * fastbotx::fastStringHash(this->_resourceID) << 1;
-        uintptr_t hashcode2 = fastbotx::fastStringHash(this->_classname) << 2;
-        uintptr_t hashcode3 = fastbotx::fastStringHash(this->_packageName) << 3;
-        uintptr_t hashcode4 = 256U * fastbotx::fastStringHash(this->_text) << 4;
+        uintptr_t hashcode1 = 127U * this->_internedResourceID.hash() << 1;
+        uintptr_t hashcode2 = this->_internedClassname.hash() << 2;
+        uintptr_t hashcode3 = this->_internedPackageName.hash() << 3;
+        uintptr_t hashcode4 = 256U * this->_text.hash() << 4;
         
         // Performance optimization: Only compute ContentDesc hash if not empty
         // Most elements don't have ContentDesc, so this avoids unnecessary hash computation
         // Use fast string hash for better performance
         uintptr_t hashcode5 = 0;
         if (!this->_contentDesc.empty()) {
-            hashcode5 = fastbotx::fastStringHash(this->_contentDesc) << 5;
+            hashcode5 = this->_contentDesc.hash() << 5;
         }
         
         uintptr_t hashcode6 = fastbotx::fastStringHash(this->_activity) << 2;
@@ -677,6 +1334,51 @@ namespace fastbotx {
         return static_cast<long>(hashcode);
     }
 
+    namespace {
+        /// boost::hash_combine style mixing in 64 bits, whatever the width of uintptr_t
+        inline uint64_t mixSignature(uint64_t seed, uint64_t value) {
+            return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+        }
+    }
+
+    uint64_t Element::widgetSignature() const {
+        uint64_t flags = (this->_checkable ? 1U : 0U) | (this->_enabled ? 2U : 0U) |
+                          (this->_clickable ? 4U : 0U) | (this->_scrollable ? 8U : 0U) |
+                          (this->_longClickable ? 16U : 0U);
+        uint64_t signature = mixSignature(0x1, flags);
+        // Interned fields: the hash is precomputed, no string walk
+        signature = mixSignature(signature, this->_internedClassname.hash());
+        signature = mixSignature(signature, this->_internedResourceID.hash());
+        // Reuse the parser's hashes when the strings are the parsed ones
+        const FusedHashes *fused = getFusedHashes();
+        signature = mixSignature(signature, fused ? fused->text : this->_text.hash());
+        signature = mixSignature(signature, fused ? fused->contentDesc : this->_contentDesc.hash());
+        signature = mixSignature(signature, this->_validText.empty() ? 0 : fastStringHash(this->_validText));
+        signature = mixSignature(signature, static_cast<uintptr_t>(this->_index));
+        signature = mixSignature(signature, static_cast<uintptr_t>(this->_bounds.left));
+        signature = mixSignature(signature, static_cast<uintptr_t>(this->_bounds.top));
+        signature = mixSignature(signature, static_cast<uintptr_t>(this->_bounds.right));
+        signature = mixSignature(signature, static_cast<uintptr_t>(this->_bounds.bottom));
+        return signature;
+    }
+
+    uint64_t Element::subtreeSignature() {
+        if (this->_subtreeSignatureCached) {
+            return this->_cachedSubtreeSignature;
+        }
+        uint64_t signature = widgetSignature();
+        signature = mixSignature(signature, this->_children.size());
+        uint32_t size = 1;
+        for (const auto &child: this->_children) {
+            signature = mixSignature(signature, child->subtreeSignature());
+            size += child->_cachedSubtreeSize;
+        }
+        this->_cachedSubtreeSignature = signature;
+        this->_cachedSubtreeSize = size;
+        this->_subtreeSignatureCached = true;
+        return signature;
+    }
+
 }
 
 #endif //Element_CPP_
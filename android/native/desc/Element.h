@@ -8,6 +8,8 @@
 #define Element_H_
 
 #include "../Base.h"
+#include "ElementArena.h"
+#include "../StringInterner.h"
 #include <string>
 #include <utility>
 #include <vector>
@@ -20,6 +22,16 @@ namespace tinyxml2 {
     class XMLDocument;
 }
 
+namespace fastbotx {
+    class XmlStreamReader;
+
+    struct BinaryDumpContext;
+
+    struct BinaryDeltaBase;
+
+    class DeltaDumpDecoder;
+}
+
 
 namespace fastbotx {
 
@@ -94,7 +106,16 @@ namespace fastbotx {
      */
     class Element : public Serializable, public std::enable_shared_from_this<Element> {
     public:
-        Element();
+        /**
+         * @param arena Arena holding this node's string payloads. Elements built by
+         *              createFromBinary / createFromXml live in the same arena; a null
+         *              arena (stand-alone element) stores strings in a small arena of its
+         *              own, freed with the element.
+         */
+        explicit Element(ElementArena *arena = nullptr);
+
+        /// Allocate a node (and its shared_ptr control block) inside the given arena
+        static std::shared_ptr<Element> newInArena(ElementArena *arena);
 
         bool matchXpathSelector(const XpathPtr &xpathSelector) const;
 
@@ -116,17 +137,26 @@ namespace fastbotx {
 
         std::weak_ptr<Element> getParent() const { return this->_parent; }
 
-        const std::string &getClassname() const { return this->_classname; }
+        // String fields are arena slices valid while the tree is alive; copy with str() to keep them
+        const ElementString &getClassname() const { return this->_classname; }
 
-        const std::string &getResourceID() const { return this->_resourceID; }
+        const ElementString &getResourceID() const { return this->_resourceID; }
 
-        const std::string &getText() const { return this->_text; }
+        const ElementString &getText() const { return this->_text; }
 
-        const std::string &getContentDesc() const { return this->_contentDesc; }
+        const ElementString &getContentDesc() const { return this->_contentDesc; }
 
-        const std::string &getPackageName() const { return this->_packageName; }
+        const ElementString &getPackageName() const { return this->_packageName; }
 
-        RectPtr getBounds() const { return this->_bounds; };
+        /// Interned handles of the highly repetitive fields (integer equality, precomputed hash)
+        InternedString getInternedClassname() const { return this->_internedClassname; }
+
+        InternedString getInternedResourceID() const { return this->_internedResourceID; }
+
+        InternedString getInternedPackageName() const { return this->_internedPackageName; }
+
+        /// Bounds live inline in the element: reading them takes no reference count
+        const Rect &getBounds() const { return this->_bounds; }
 
         int getIndex() const { return this->_index; }
 
@@ -146,65 +176,75 @@ namespace fastbotx {
         ScrollType _computeScrollType() const;
 
         // reset properties, in Preference
-        // Performance: Clear hash cache when properties change
+        // Performance: Clear hash caches when properties change; ancestors are marked dirty too
         void reSetResourceID(const std::string &resourceID) { 
-            this->_resourceID = resourceID; 
-            this->_hashCached = false; // Invalidate hash cache
+            this->_resourceID = internString(this->_internedResourceID, resourceID.data(), resourceID.size());
+            this->invalidateHashCache(); // Invalidate hash cache
+        }
+
+        /// Same, with an already interned id (no hashing or intern table lookup)
+        void reSetResourceID(InternedString resourceID) {
+            this->_internedResourceID = resourceID;
+            const std::string &interned = resourceID.str();
+            this->_resourceID = ElementString(interned.data(), interned.size());
+            this->invalidateHashCache(); // Invalidate hash cache
         }
 
         void reSetContentDesc(const std::string &content) { 
-            this->_contentDesc = content; 
-            this->_hashCached = false; // Invalidate hash cache
+            this->_contentDesc = storeString(content);
+            this->_fusedHashesValid = false;
+            this->invalidateHashCache(); // Invalidate hash cache
         }
 
         void reSetText(const std::string &text) { 
-            this->_text = text; 
-            this->_hashCached = false; // Invalidate hash cache
+            this->_text = storeString(text);
+            this->_fusedHashesValid = false;
+            this->invalidateHashCache(); // Invalidate hash cache
         }
 
         void reSetIndex(const int &index) { 
             this->_index = index; 
             // Index doesn't affect hash in current implementation, but clear cache for safety
-            this->_hashCached = false;
+            this->invalidateHashCache();
         }
 
         void reSetClassname(const std::string &className) { 
-            this->_classname = className; 
-            this->_hashCached = false; // Invalidate hash cache
+            this->_classname = internString(this->_internedClassname, className.data(), className.size());
+            this->invalidateHashCache(); // Invalidate hash cache
         }
 
         void reSetClickable(bool clickable) { 
             this->_clickable = clickable; 
-            this->_hashCached = false; // Invalidate hash cache
+            this->invalidateHashCache(); // Invalidate hash cache
         }
 
         void reSetScrollable(bool scrollable) { 
             this->_scrollable = scrollable; 
             // Scrollable doesn't affect hash, but clear cache for consistency
-            this->_hashCached = false;
+            this->invalidateHashCache();
         }
 
         void reSetEnabled(bool enable) { 
             this->_enabled = enable; 
             // Enabled doesn't affect hash, but clear cache for consistency
-            this->_hashCached = false;
+            this->invalidateHashCache();
         }
 
-        void reSetBounds(RectPtr rect) { 
-            this->_bounds = std::move(rect); 
+        void reSetBounds(const Rect &rect) { 
+            this->_bounds = rect; 
             // Bounds doesn't affect hash, but clear cache for consistency
-            this->_hashCached = false;
+            this->invalidateHashCache();
         }
 
         void reSetParent(const std::shared_ptr<Element> &parent) { 
             this->_parent = parent; 
             // Parent doesn't affect hash, but clear cache for consistency
-            this->_hashCached = false;
+            this->invalidateHashCache();
         }
 
         void reAddChild(const std::shared_ptr<Element> &child) {
             this->_children.emplace_back(child);
-            this->_hashCached = false; // Invalidate hash cache (children affect recursive hash)
+            this->invalidateHashCache(); // Invalidate hash cache (children affect recursive hash)
         }
 
         std::string toJson() const;
@@ -219,8 +259,30 @@ namespace fastbotx {
 
         static std::shared_ptr<Element> createFromXml(const tinyxml2::XMLDocument &doc);
 
-        /** Create tree from compact binary (SECURITY_AND_OPTIMIZATION §7 opt1). Magic "FB\\0\\1" then nodes. */
-        static std::shared_ptr<Element> createFromBinary(const char *buf, size_t len);
+        /**
+         * Create tree from XML bytes (not necessarily null-terminated), e.g. a JNI buffer.
+         * Uses the streaming parser (FASTBOT_STREAMING_XML), the tinyxml2 DOM if it fails.
+         *
+         * @param borrowStrings As for createFromBinary: text and content-desc point into data
+         */
+        static std::shared_ptr<Element> createFromXml(const char *data, size_t size,
+                                                      bool borrowStrings = false);
+
+        /**
+         * Create tree from compact binary (SECURITY_AND_OPTIMIZATION §7 opt1). Magic "FB\\0\\1" then nodes,
+         * or "FB\\0\\2": node count, one string table for the whole dump, then nodes whose strings
+         * are varint indexes into the table and whose bounds are deltas from the parent's.
+         *
+         * @param borrowStrings If true, string fields point straight into buf instead of being copied
+         *                      into the arena (zero-copy). Only valid while buf stays alive and unchanged,
+         *                      e.g. a JNI Direct ByteBuffer for the duration of one getAction call; call
+         *                      detachStrings() on trees that must outlive the buffer.
+         */
+        static std::shared_ptr<Element> createFromBinary(const char *buf, size_t len,
+                                                         bool borrowStrings = false);
+
+        /** Copy every borrowed string field of this subtree into the arena so it no longer references the source buffer. */
+        void detachStrings();
 
         /** Parse one node from binary buffer; used by createFromBinary. */
         static std::shared_ptr<Element> parseBinaryNode(const char *buf, size_t len, size_t *offset,
@@ -230,9 +292,84 @@ namespace fastbotx {
         bool parseBinaryNodeSelf(const char *buf, size_t len, size_t *offset,
                                  const std::shared_ptr<Element> &parent);
 
+        /** Parse one v2 node and its subtree; used by createFromBinary. */
+        static std::shared_ptr<Element> parseBinaryNodeV2(const char *buf, size_t len, size_t *offset,
+                                                          const std::shared_ptr<Element> &parent,
+                                                          BinaryDumpContext &context);
+
+        /** Instance helper: fill this node from a v2 buffer; used by parseBinaryNodeV2. */
+        bool parseBinaryNodeSelfV2(const char *buf, size_t len, size_t *offset,
+                                   const std::shared_ptr<Element> &parent, BinaryDumpContext &context);
+
+        /** True if buf holds a delta dump ("FB\\0\\3"), which DeltaDumpDecoder applies. */
+        static bool isBinaryDelta(const char *buf, size_t len);
+
+        /**
+         * @brief Deep copy of this subtree into arena, under parent
+         *
+         * String fields are copied into the arena (interned ones are shared); cached
+         * hashes are left to be recomputed.
+         *
+         * @param record If set, every copied node is appended to it in pre-order with its subtree size
+         */
+        std::shared_ptr<Element> cloneInto(ElementArena *arena, const std::shared_ptr<Element> &parent,
+                                           BinaryDeltaBase *record = nullptr) const;
+
         long hash(bool recursive = true);
 
-        std::string validText;
+        /**
+         * @brief Hash of every attribute a Widget is built from, for this node only
+         *
+         * Covers flags, class, resource-id, text, content-desc, valid text, index and
+         * bounds, i.e. everything Widget/RichWidget read from an Element. Unlike hash(),
+         * which identifies a page, this changes whenever the built Widget would change.
+         * 64 bits wide on every ABI (uintptr_t is 32 bits on armv7).
+         */
+        uint64_t widgetSignature() const;
+
+        /**
+         * @brief Merkle signature of this subtree: widgetSignature() of every node plus child order
+         *
+         * Cached on the node; every setter (including setValidText) marks the node and
+         * its ancestors dirty, so only changed paths are recomputed. A key, not an identity:
+         * the incremental build checks size, class and resource-id before trusting a hit.
+         */
+        uint64_t subtreeSignature();
+
+        /// Number of nodes of this subtree, itself included; cached with subtreeSignature()
+        uint32_t subtreeSize() {
+            subtreeSignature();
+            return this->_cachedSubtreeSize;
+        }
+
+        /**
+         * @brief Attribute hashes computed by createFromBinary (or the streaming XML parser)
+         *        while reading the payloads
+         *
+         * strippedText is fastStringHash of the text with digits and blanks removed (the
+         * Widget text normalisation before the text-model length cut); strippedTextSize is
+         * that text's length. text and contentDesc are fastStringHash of the raw text and
+         * content-desc. Empty strings hash to 0.
+         */
+        struct FusedHashes {
+            uintptr_t strippedText;
+            uint32_t strippedTextSize;
+            uintptr_t text;
+            uintptr_t contentDesc;
+        };
+
+        /// Parser-computed hashes, or nullptr if not available (XML input, or text reset since)
+        const FusedHashes *getFusedHashes() const {
+            return this->_fusedHashesValid ? &this->_fusedHashes : nullptr;
+        }
+
+        /// Text from Preference's valid-text list matched on this node (RichWidget hashing)
+        const std::string &getValidText() const { return this->_validText; }
+
+        void setValidText(const std::string &text) {
+            this->_validText = text;
+            this->invalidateHashCache();
+        }
 
         virtual ~Element();
 
@@ -243,13 +380,70 @@ namespace fastbotx {
         void fromXml(const tinyxml2::XMLDocument &nodeOfDoc,
                      const std::shared_ptr<Element> &parentOfNode);
 
+        static std::shared_ptr<Element> createFromXmlDom(const char *data, size_t size);
+
+        static std::shared_ptr<Element> createFromXmlStream(const char *data, size_t size,
+                                                            bool borrowStrings);
+
+        void fromXmlStream(const XmlStreamReader &reader, const std::shared_ptr<Element> &parentOfNode,
+                           bool borrowStrings);
+
+        void setXmlBounds(const int (&bounds)[4]);
+
+        void finishXmlAttributes(const std::shared_ptr<Element> &parentOfNode);
+
         void recursiveToXML(tinyxml2::XMLElement *xml, const Element *elm) const;
 
-        std::string _resourceID;
-        std::string _classname;
-        std::string _packageName;
-        std::string _text;
-        std::string _contentDesc;
+        /// Tree of a v2 dump whose body starts at offset; with a base, nodes may reference its subtrees
+        static std::shared_ptr<Element> parseBinaryDumpV2(const char *buf, size_t len, size_t offset,
+                                                          bool borrowStrings, const BinaryDeltaBase *base);
+
+        /**
+         * Tree of a delta dump before finishBinaryTree, i.e. with the attributes as sent, or
+         * nullptr if it does not parse or is based on a dump other than base.
+         *
+         * @param dumpId Out: ID of this dump
+         */
+        static std::shared_ptr<Element> parseBinaryDelta(const char *buf, size_t len, bool borrowStrings,
+                                                         const BinaryDeltaBase &base, uint64_t *dumpId);
+
+        /// Tree-wide fixes of a parsed binary dump: all nodes clickable if none is, root scrollable
+        static void finishBinaryTree(const std::shared_ptr<Element> &root);
+
+        /// Apply the flag bits shared by both binary formats (1 checkable ... 512 selected)
+        void setBinaryFlags(uint32_t flags);
+
+        /// Derived fields set once a binary node's children are parsed
+        void finishBinaryNode();
+
+        /// Copy a payload into this element's arena
+        ElementString storeString(const char *data, size_t size);
+
+        ElementString storeString(const std::string &s) { return storeString(s.data(), s.size()); }
+
+        /// Intern a payload and return a view of the interned copy (no arena bytes used)
+        static ElementString internString(InternedString &atom, const char *data, size_t size) {
+            atom = InternedString::intern(data, size);
+            const std::string &interned = atom.str();
+            return {interned.data(), interned.size()};
+        }
+
+        /// Arena for new children: none (stand-alone children) if this node's arena is its own
+        ElementArena *childArena() const { return this->_ownedArena ? nullptr : this->_arena; }
+
+        /// Arena owning this node's storage (never null)
+        ElementArena *_arena;
+        /// Stand-alone element: the arena behind _arena, owned by this node alone
+        std::unique_ptr<ElementArena> _ownedArena;
+
+        ElementString _resourceID;
+        ElementString _classname;
+        ElementString _packageName;
+        ElementString _text;
+        ElementString _contentDesc;
+        InternedString _internedResourceID;
+        InternedString _internedClassname;
+        InternedString _internedPackageName;
         std::string _inputText;
         std::string _activity;
 
@@ -267,7 +461,7 @@ namespace fastbotx {
         bool _selected;
         bool _isEditable;
 
-        RectPtr _bounds;
+        Rect _bounds;
         std::vector<std::shared_ptr<Element> > _children;
         std::weak_ptr<Element> _parent;
 
@@ -279,12 +473,45 @@ namespace fastbotx {
         mutable long _cachedHash;
         mutable bool _hashCached;
 
-        // a construct helper
-        static bool _allClickableFalse;
+        /// Filled by parseBinaryNodeSelf when FASTBOT_FUSED_PARSE_HASH is on
+        FusedHashes _fusedHashes;
+        bool _fusedHashesValid;
+
+        /// Cached subtreeSignature() for incremental state building
+        uint64_t _cachedSubtreeSignature;
+        uint32_t _cachedSubtreeSize;
+        bool _subtreeSignatureCached;
+
+        /**
+         * @brief Mark this node's cached hashes stale, and every ancestor's with it
+         *
+         * A recursive hash stays cached until its subtree changes, so a dirty node
+         * implies dirty ancestors; the walk stops at the first already-dirty one.
+         */
+        void invalidateHashCache();
+
+        std::string _validText;
+
+        // a construct helper (per thread: devices may parse their dumps concurrently)
+        static thread_local bool _allClickableFalse;
+
+        // a construct helper: createFromBinary was asked to keep string fields as views into the buffer
+        static thread_local bool _borrowBinaryStrings;
+
+        friend class DeltaDumpDecoder;
     };
 
     typedef std::shared_ptr<Element> ElementPtr;
 
+    /// Tree the references of a delta dump resolve against: the dump it is based on, as sent
+    struct BinaryDeltaBase {
+        uint64_t dumpId{0};
+        /// Nodes in pre-order, the position a reference names
+        std::vector<ElementPtr> nodes;
+        /// Nodes of the subtree rooted at each position, itself included
+        std::vector<uint32_t> subtreeSizes;
+    };
+
 
 }
 
@@ -0,0 +1,156 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef ElementArena_CPP_
+#define ElementArena_CPP_
+
+#include "ElementArena.h"
+#include "../utils.hpp"
+#include <algorithm>
+
+namespace fastbotx {
+
+    bool ElementString::contains(const char *needle) const {
+        size_t needleSize = std::strlen(needle);
+        if (needleSize == 0) {
+            return true;
+        }
+        if (needleSize > this->_size) {
+            return false;
+        }
+        const char *end = this->_data + this->_size;
+        return std::search(this->_data, end, needle, needle + needleSize) != end;
+    }
+
+    ElementArena::ElementArena(size_t blockSize)
+            : _blockSize(blockSize) {
+    }
+
+    void ElementArena::addBlock(size_t minSize) {
+        size_t size = std::max(this->_blockSize, minSize);
+        Block block;
+        block.data.reset(new char[size]);
+        block.size = size;
+        this->_blocks.push_back(std::move(block));
+    }
+
+    void *ElementArena::allocate(size_t bytes, size_t alignment) {
+        while (true) {
+            if (this->_blockIndex < this->_blocks.size()) {
+                Block &block = this->_blocks[this->_blockIndex];
+                auto base = reinterpret_cast<uintptr_t>(block.data.get());
+                uintptr_t aligned = (base + this->_offset + alignment - 1) & ~(uintptr_t) (alignment - 1);
+                size_t newOffset = static_cast<size_t>(aligned - base) + bytes;
+                if (newOffset <= block.size) {
+                    this->_offset = newOffset;
+                    return reinterpret_cast<void *>(aligned);
+                }
+                // Block exhausted: move on to the next one (kept from previous dumps) or grow
+                if (this->_blockIndex + 1 < this->_blocks.size()) {
+                    this->_blockIndex++;
+                    this->_offset = 0;
+                    continue;
+                }
+            }
+            addBlock(bytes + alignment);
+            this->_blockIndex = this->_blocks.size() - 1;
+            this->_offset = 0;
+        }
+    }
+
+    void ElementArena::reserve(size_t bytes) {
+        size_t available = 0;
+        for (size_t i = this->_blockIndex; i < this->_blocks.size(); i++) {
+            available += this->_blocks[i].size - (i == this->_blockIndex ? this->_offset : 0);
+        }
+        if (available < bytes) {
+            addBlock(bytes - available);
+        }
+    }
+
+    ElementString ElementArena::copyString(const char *data, size_t size) {
+        if (nullptr == data || 0 == size) {
+            return {};
+        }
+        auto *dst = static_cast<char *>(allocate(size, 1));
+        std::memcpy(dst, data, size);
+        return {dst, size};
+    }
+
+    bool ElementArena::rewind() {
+        // Acquire: the last release on another thread is done with the memory
+        if (this->liveCount() != 0) {
+            return false;
+        }
+        this->_blockIndex = 0;
+        this->_offset = 0;
+        return true;
+    }
+
+    size_t ElementArena::bytesUsed() const {
+        size_t used = 0;
+        for (size_t i = 0; i < this->_blockIndex && i < this->_blocks.size(); i++) {
+            used += this->_blocks[i].size;
+        }
+        return used + this->_offset;
+    }
+
+    namespace {
+        /// Thread-local arena pool: one active arena plus arenas still referenced by old trees
+        struct ElementArenaPool {
+            std::unique_ptr<ElementArena> active{new ElementArena()};
+            std::vector<std::unique_ptr<ElementArena>> retired;
+
+            ~ElementArenaPool() {
+                // Trees still alive at thread exit keep pointing into their arena; leak it
+                // rather than free memory that is still referenced.
+                if (active && active->liveCount() != 0) {
+                    active.release();
+                }
+                for (auto &arena: retired) {
+                    if (arena && arena->liveCount() != 0) {
+                        arena.release();
+                    }
+                }
+            }
+        };
+
+        ElementArenaPool &arenaPool() {
+            thread_local ElementArenaPool pool;
+            return pool;
+        }
+    }
+
+    ElementArena *ElementArena::current() {
+        return arenaPool().active.get();
+    }
+
+    void ElementArena::recycle() {
+        ElementArenaPool &pool = arenaPool();
+        if (pool.active->rewind()) {
+            return;
+        }
+        // Previous tree is still referenced somewhere: retire its arena and take a free one
+        BDLOG("element arena still has %zu live nodes, retiring it", pool.active->liveCount());
+        std::unique_ptr<ElementArena> next;
+        for (auto &arena: pool.retired) {
+            if (arena->rewind()) {
+                next = std::move(arena);
+                break;
+            }
+        }
+        pool.retired.erase(std::remove(pool.retired.begin(), pool.retired.end(), nullptr),
+                           pool.retired.end());
+        if (!next) {
+            next.reset(new ElementArena());
+        }
+        pool.retired.push_back(std::move(pool.active));
+        pool.active = std::move(next);
+    }
+
+}  // namespace fastbotx
+
+#endif  // ElementArena_CPP_
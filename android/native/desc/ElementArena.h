@@ -0,0 +1,207 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef ElementArena_H_
+#define ElementArena_H_
+
+#include "../Base.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace fastbotx {
+
+    /**
+     * @brief Non-owning string slice used for Element string fields
+     *
+     * The bytes live in the ElementArena of the owning Element tree, so an
+     * ElementString is only valid while that tree is alive. Callers that keep
+     * the value beyond the current step (Widget, Preference caches) must copy
+     * it with str() or the implicit std::string conversion.
+     *
+     * The data is not guaranteed to be NUL-terminated; use str() when a C string
+     * is needed.
+     */
+    class ElementString {
+    public:
+        ElementString() = default;
+
+        ElementString(const char *data, size_t size)
+                : _data(data), _size(static_cast<uint32_t>(size)) {}
+
+        const char *data() const { return this->_data; }
+
+        size_t size() const { return this->_size; }
+
+        size_t length() const { return this->_size; }
+
+        bool empty() const { return 0 == this->_size; }
+
+        std::string str() const { return empty() ? std::string() : std::string(_data, _size); }
+
+        operator std::string() const { return str(); }
+
+        bool equals(const char *other, size_t otherSize) const {
+            return this->_size == otherSize &&
+                   (0 == otherSize || 0 == std::memcmp(this->_data, other, otherSize));
+        }
+
+        /// true if the given literal occurs anywhere in this string
+        bool contains(const char *needle) const;
+
+        uintptr_t hash() const { return empty() ? 0 : fastStringHash(this->_data, this->_size); }
+
+    private:
+        const char *_data{nullptr};
+        uint32_t _size{0};
+    };
+
+    inline bool operator==(const ElementString &a, const ElementString &b) {
+        return a.equals(b.data(), b.size());
+    }
+
+    inline bool operator==(const ElementString &a, const std::string &b) {
+        return a.equals(b.data(), b.size());
+    }
+
+    inline bool operator==(const std::string &a, const ElementString &b) { return b == a; }
+
+    inline bool operator==(const ElementString &a, const char *b) {
+        return a.equals(b, std::strlen(b));
+    }
+
+    inline bool operator==(const char *a, const ElementString &b) { return b == a; }
+
+    template<typename T>
+    inline bool operator!=(const ElementString &a, const T &b) { return !(a == b); }
+
+    /**
+     * @brief Per-dump bump allocator backing Element nodes, bounds and string payloads
+     *
+     * Every GUI dump used to cost one heap allocation per Element, one per Rect and
+     * one per non-SSO string field. The arena replaces them with pointer bumps into
+     * a few large blocks that are rewound (not freed) between steps.
+     *
+     * Lifetime model:
+     * - Elements and Rects are still handed out as std::shared_ptr (through
+     *   ArenaAllocator + std::allocate_shared), so Preference/State callers keep
+     *   the old API. Each live shared_ptr allocation is counted in liveCount().
+     * - recycle() is called at the start of each dump: if the previous tree has been
+     *   released the active arena is rewound, otherwise it is retired and a spare
+     *   arena is used instead. A retired arena is rewound once all its nodes die,
+     *   so a caller that holds an ElementPtr longer than expected never dangles.
+     * - Arenas are thread-local, one pool per parsing thread. Allocation and rewind()
+     *   belong to that thread; nodes may be released on any thread (step workers,
+     *   parallel widget building), so the live count is atomic.
+     */
+    class ElementArena {
+    public:
+        /// Size of one arena block; a 300-node screen fits in one or two blocks
+        static constexpr size_t DefaultBlockSize = 64 * 1024;
+
+        explicit ElementArena(size_t blockSize = DefaultBlockSize);
+
+        ~ElementArena() = default;
+
+        ElementArena(const ElementArena &) = delete;
+
+        ElementArena &operator=(const ElementArena &) = delete;
+
+        /// Bump-allocate raw storage; never returns nullptr
+        void *allocate(size_t bytes, size_t alignment);
+
+        /// Allocation backing a shared_ptr (counted for lifetime tracking)
+        void *allocateObject(size_t bytes, size_t alignment) {
+            this->_liveCount.fetch_add(1, std::memory_order_relaxed);
+            return allocate(bytes, alignment);
+        }
+
+        /// Matching release for allocateObject, on any thread; memory is reclaimed by rewind()
+        void releaseObject() { this->_liveCount.fetch_sub(1, std::memory_order_release); }
+
+        /// Make sure the next bytes of allocations need at most one new block
+        void reserve(size_t bytes);
+
+        /// Copy a payload into the arena and return a slice pointing at the copy
+        ElementString copyString(const char *data, size_t size);
+
+        ElementString copyString(const std::string &s) { return copyString(s.data(), s.size()); }
+
+        /// Rewind all blocks to empty; only legal when liveCount() == 0
+        bool rewind();
+
+        size_t liveCount() const { return this->_liveCount.load(std::memory_order_acquire); }
+
+        size_t bytesUsed() const;
+
+        /// Arena new dumps on this thread allocate from
+        static ElementArena *current();
+
+        /**
+         * @brief Start a new dump: rewind or swap out the current arena
+         *
+         * Called by Element::createFromBinary / createFromXml before parsing so the
+         * previous step's tree (released after Model::getOperateOpt returned) is reused.
+         */
+        static void recycle();
+
+    private:
+        struct Block {
+            std::unique_ptr<char[]> data;
+            size_t size;
+        };
+
+        void addBlock(size_t minSize);
+
+        std::vector<Block> _blocks;
+        size_t _blockIndex{0};
+        size_t _offset{0};
+        size_t _blockSize;
+        std::atomic<size_t> _liveCount{0};
+    };
+
+    /**
+     * @brief Minimal std allocator over ElementArena, used with std::allocate_shared
+     *
+     * The allocator copy stored in the shared_ptr control block keeps only a raw
+     * arena pointer; the arena itself is kept alive by the thread-local pool until
+     * its live count drops to zero.
+     */
+    template<typename T>
+    class ArenaAllocator {
+    public:
+        typedef T value_type;
+
+        explicit ArenaAllocator(ElementArena *arena) : _arena(arena) {}
+
+        template<typename U>
+        ArenaAllocator(const ArenaAllocator<U> &other) : _arena(other.arena()) {}
+
+        T *allocate(size_t n) {
+            return static_cast<T *>(this->_arena->allocateObject(n * sizeof(T), alignof(T)));
+        }
+
+        void deallocate(T *, size_t) { this->_arena->releaseObject(); }
+
+        ElementArena *arena() const { return this->_arena; }
+
+        template<typename U>
+        bool operator==(const ArenaAllocator<U> &other) const { return this->_arena == other.arena(); }
+
+        template<typename U>
+        bool operator!=(const ArenaAllocator<U> &other) const { return this->_arena != other.arena(); }
+
+    private:
+        ElementArena *_arena;
+    };
+
+}  // namespace fastbotx
+
+#endif  // ElementArena_H_
@@ -89,6 +89,9 @@ namespace fastbotx {
          */
         int getVisitedCount() const { return this->_visitedCount; }
 
+        /// Restore a visit count saved elsewhere (e.g. by State::compact)
+        void setVisitedCount(int count) { this->_visitedCount = count; }
+
         /**
          * @brief Convert node to string representation (implements Serializable)
          * 
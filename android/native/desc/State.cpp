@@ -11,6 +11,7 @@
 #include  "State.h"
 #include "../utils.hpp"
 #include "ActionFilter.h"
+#include "MemoryFootprint.h"
 #include <regex>
 #include <map>
 #include <algorithm>
@@ -18,6 +19,7 @@
 #include <cmath>
 #include <sstream>
 #include <cinttypes>
+#include <cstring>
 
 namespace fastbotx {
 
@@ -100,6 +102,7 @@ namespace fastbotx {
         // and make_shared cannot access protected constructors from outside the class
         StatePtr sharedPtr = std::shared_ptr<State>(new State(std::move(activityName)));
         sharedPtr->buildFromElement(nullptr, std::move(elem));
+        bool withWidgetOrder = StateAbstractionOptions::current().withWidgetOrder;
         
         // Compute hash based on activity name
         // Performance optimization: Use fast string hash instead of std::hash
@@ -128,7 +131,7 @@ namespace fastbotx {
             // If widget order matters for hash computation, sort by hash to ensure consistency
             // This ensures that same set of widgets always produces same hash regardless of
             // the order they were inserted into the set
-            if (STATE_WITH_WIDGET_ORDER) {
+            if (withWidgetOrder) {
                 std::sort(sharedPtr->_widgets.begin(), sharedPtr->_widgets.end(),
                           [](const WidgetPtr& a, const WidgetPtr& b) {
                               if (a == nullptr || b == nullptr) {
@@ -139,31 +142,28 @@ namespace fastbotx {
             }
         }
         
-        // Combine activity hash with widget hash
-        activityHash ^= (combineHash<Widget>(sharedPtr->_widgets, STATE_WITH_WIDGET_ORDER) << 1);
+        // Combine activity hash with widget hash, reduced over the contiguous hash column
+        sharedPtr->buildWidgetColumns();
+        const std::vector<uintptr_t> &widgetHashes = sharedPtr->_widgetColumns.hashes;
+        activityHash ^= (combineHashes(widgetHashes.data(), widgetHashes.size(), withWidgetOrder) << 1);
         sharedPtr->_hashcode = activityHash;
         
         // Build actions for all widgets
-        // Performance: Pre-allocate capacity to avoid reallocations
-        // Estimate: average 1-2 actions per widget, plus back action
-        size_t estimatedActionCount = sharedPtr->_widgets.size() * 2 + 1;
-        sharedPtr->_actions.reserve(estimatedActionCount);
+        // Performance: Exact capacity from the action bit column, plus back action
+        sharedPtr->_actions.reserve(sharedPtr->countWidgetActions() + 1);
         
-        for (const auto &w: sharedPtr->_widgets) {
+        for (size_t row = 0; row < sharedPtr->_widgets.size(); row++) {
+            const WidgetPtr &w = sharedPtr->_widgets[row];
             // Null pointer check for widget itself
             if (w == nullptr) {
                 BLOGE("NULL Widget happened");
                 continue;
             }
-            // Null pointer check for bounds
-            if (w->getBounds() == nullptr) {
-                BLOGE("NULL Bounds happened for widget");
-                continue;
-            }
             // Create action for each action type supported by this widget
             for (ActionType act: w->getActions()) {
                 ActivityStateActionPtr modelAction = std::make_shared<ActivityStateAction>(
                         sharedPtr, w, act);
+                modelAction->setTargetIndex(static_cast<int>(row));
                 sharedPtr->_actions.emplace_back(modelAction);
             }
         }
@@ -176,6 +176,54 @@ namespace fastbotx {
         return sharedPtr;
     }
 
+    void State::buildWidgetColumns() {
+        size_t count = this->_widgets.size();
+        this->_widgetColumns.clear();
+        this->_widgetColumns.hashes.reserve(count);
+        this->_widgetColumns.actionMasks.reserve(count);
+        this->_widgetColumns.mergedCounts.reserve(count);
+        for (const auto &widget: this->_widgets) {
+            uintptr_t h = widget ? widget->hash() : 0;
+            uint32_t actionMask = 0;
+            uint32_t mergedCount = 0;
+            if (widget) {
+                actionMask = widget->getActions().bits();
+                auto mergedIt = this->_mergedWidgets.find(h);
+                if (mergedIt != this->_mergedWidgets.end()) {
+                    mergedCount = static_cast<uint32_t>(mergedIt->second.size());
+                }
+            }
+            this->_widgetColumns.hashes.push_back(h);
+            this->_widgetColumns.actionMasks.push_back(actionMask);
+            this->_widgetColumns.mergedCounts.push_back(mergedCount);
+        }
+    }
+
+    size_t State::countWidgetActions() const {
+        size_t total = 0;
+        for (uint32_t actionMask: this->_widgetColumns.actionMasks) {
+            total += static_cast<size_t>(__builtin_popcount(actionMask));
+        }
+        return total;
+    }
+
+    int State::targetRowOf(const ActivityStateActionPtr &action) const {
+        const WidgetPtr &target = action->getTarget();
+        if (target == nullptr) {
+            return -1;
+        }
+        int row = action->getTargetIndex();
+        // The index is only trusted while the target still carries that row's hash; a
+        // foreign action, or one re-targeted by resolveAt to a differently hashed merged
+        // widget, falls back to a column scan by hash
+        uintptr_t h = target->hash();
+        if (row >= 0 && static_cast<size_t>(row) < this->_widgetColumns.size()
+            && this->_widgetColumns.hashes[row] == h) {
+            return row;
+        }
+        return this->_widgetColumns.find(h);
+    }
+
     /**
      * @brief Check if an action is saturated (visited too many times)
      * 
@@ -185,7 +233,8 @@ namespace fastbotx {
      *   with the same hash (to account for duplicate widgets)
      * 
      * Performance optimization:
-     * - Uses find instead of count + at to avoid double lookup
+     * - Reads the merge group size from the mergedCounts column by the action's
+     *   target row instead of a _mergedWidgets map lookup
      * 
      * @param action Action to check
      * @return true if action is saturated (should be avoided)
@@ -207,11 +256,11 @@ namespace fastbotx {
             return action->getVisitedCount() >= 1;
         }
         
-        uintptr_t h = target->hash();
-        auto mergedIt = this->_mergedWidgets.find(h);
-        if (mergedIt != this->_mergedWidgets.end()) {
+        int row = targetRowOf(action);
+        uint32_t mergedCount = row < 0 ? 0 : this->_widgetColumns.mergedCounts[row];
+        if (mergedCount != 0) {
             // Action is saturated if visited more times than merged widget count
-            return action->getVisitedCount() > static_cast<int>(mergedIt->second.size());
+            return action->getVisitedCount() > static_cast<int>(mergedCount);
         }
         
         // Target not found in merged widgets: default to saturated if visited at least once
@@ -220,20 +269,13 @@ namespace fastbotx {
 
     size_t State::getMaxWidgetsPerModelAction() const {
         size_t maxCount = 1;
-        for (const auto &w : this->_widgets) {
-            if (!w) continue;
-            size_t n = 1;
-            auto it = this->_mergedWidgets.find(w->hash());
-            if (it != this->_mergedWidgets.end()) {
-                n += it->second.size();
-            }
+        for (uint32_t mergedCount : this->_widgetColumns.mergedCounts) {
+            size_t n = 1 + static_cast<size_t>(mergedCount);
             if (n > maxCount) maxCount = n;
         }
         return maxCount;
     }
 
-    RectPtr State::_sameRootBounds = std::make_shared<Rect>();
-
     namespace {
         // Helper function to estimate widget count from element tree
         // Counts elements that are likely to become widgets (clickable, scrollable, checkable, etc.)
@@ -256,20 +298,9 @@ namespace fastbotx {
     void State::buildFromElement(WidgetPtr parentWidget, ElementPtr elem) {
         // Handle root element bounds
         if (elem != nullptr && elem->getParent().expired()) {
-            RectPtr elemBounds = elem->getBounds();
-            if (elemBounds != nullptr && !elemBounds->isEmpty()) {
-                // Initialize static root bounds (only on first call)
-                if (_sameRootBounds->isEmpty()) {
-                    _sameRootBounds = elemBounds;
-                }
-                
-                // If current bounds match static bounds, use static reference (save memory)
-                if (equals(_sameRootBounds, elemBounds)) {
-                    this->_rootBounds = _sameRootBounds;
-                } else {
-                    // Different bounds, use current bounds
-                    this->_rootBounds = elemBounds;
-                }
+            const Rect &elemBounds = elem->getBounds();
+            if (!elemBounds.isEmpty()) {
+                this->_rootBounds = elemBounds;
             }
             
             // Performance optimization: Pre-allocate widgets vector capacity for root element
@@ -295,10 +326,6 @@ namespace fastbotx {
         }
     }
 
-    uintptr_t State::hash() const {
-        return this->_hashcode;
-    }
-
 #if DYNAMIC_STATE_ABSTRACTION_ENABLED
     uintptr_t State::getHashUnderMask(WidgetKeyMask /*mask*/) const {
         return this->hash();
@@ -337,30 +364,243 @@ namespace fastbotx {
                 widget->clearDetails();
             }
         }
+        for (const auto &action: this->_actions) {
+            action->clearOperateTemplate();
+        }
         this->_mergedWidgets.clear();
+        // Merge groups are gone with the details; keep saturation consistent with that
+        std::fill(this->_widgetColumns.mergedCounts.begin(), this->_widgetColumns.mergedCounts.end(), 0U);
+        // Saturation reads mergedCounts, so every priority may change
+        this->_allActionsDirty = true;
         _hasNoDetail = true;
     }
 
+    namespace {
+
+        void putVarint(std::string &out, uint64_t value) {
+            while (value >= 0x80) {
+                out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+                value >>= 7;
+            }
+            out.push_back(static_cast<char>(value));
+        }
+
+        uint64_t getVarint(const char *&in, const char *end) {
+            uint64_t value = 0;
+            for (int shift = 0; in < end && shift < 64; shift += 7) {
+                auto byte = static_cast<uint8_t>(*in++);
+                value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+                if (byte < 0x80) {
+                    break;
+                }
+            }
+            return value;
+        }
+
+        /// Saved values of one action of a compacted state
+        struct ColdAction {
+            int visitedCount;
+            int priority;
+            float qValue;
+        };
+
+        /// Action hash -> values, from a buffer packed by State::compact
+        std::unordered_map<uintptr_t, ColdAction> unpackColdActions(const std::string &packed) {
+            std::unordered_map<uintptr_t, ColdAction> values;
+            const char *in = packed.data();
+            const char *end = in + packed.size();
+            while (end - in >= 8) {
+                uint64_t hash = 0;
+                for (int shift = 0; shift < 64; shift += 8) {
+                    hash |= static_cast<uint64_t>(static_cast<uint8_t>(*in++)) << shift;
+                }
+                ColdAction action{};
+                action.visitedCount = static_cast<int>(getVarint(in, end));
+                auto zigzag = static_cast<uint32_t>(getVarint(in, end));
+                action.priority = static_cast<int32_t>(zigzag >> 1) ^ -static_cast<int32_t>(zigzag & 1);
+                auto qBits = static_cast<uint32_t>(getVarint(in, end));
+                memcpy(&action.qValue, &qBits, sizeof(qBits));
+                values.emplace(static_cast<uintptr_t>(hash), action);
+            }
+            return values;
+        }
+
+    }
+
+    std::string State::packActions() const {
+        // An unvisited action with a zero Q value packs into about 11 bytes instead of an object
+        std::string packed;
+        packed.reserve(this->_actions.size() * 12);
+        for (const auto &action: this->_actions) {
+            uint64_t hash = static_cast<uint64_t>(action->hash());
+            for (int shift = 0; shift < 64; shift += 8) {
+                packed.push_back(static_cast<char>((hash >> shift) & 0xff));
+            }
+            putVarint(packed, static_cast<uint32_t>(action->getVisitedCount()));
+            int32_t priority = action->getPriority();
+            putVarint(packed, (static_cast<uint32_t>(priority) << 1) ^ static_cast<uint32_t>(priority >> 31));
+            auto qValue = static_cast<float>(action->getQValue());
+            uint32_t qBits;
+            memcpy(&qBits, &qValue, sizeof(qBits));
+            putVarint(packed, qBits);
+        }
+        packed.shrink_to_fit();
+        return packed;
+    }
+
+    ColdStateRecord State::toColdRecord() const {
+        ColdStateRecord record;
+        record.hash = this->_hashcode;
+        record.visitedCount = this->getVisitedCount();
+        record.actions = this->_compacted ? this->_coldActions : this->packActions();
+        return record;
+    }
+
+    void State::compact() {
+        if (this->_compacted || !this->_hasNoDetail) {
+            return;
+        }
+        this->_coldActions = this->packActions();
+
+        ActivityStateActionPtrVec().swap(this->_actions);
+        this->_backAction.reset();
+        WidgetPtrVec().swap(this->_widgets);
+        WidgetPtrVecMap().swap(this->_mergedWidgets);
+        this->_widgetColumns = WidgetColumns();
+        this->_unvisitedSampler = WeightedSampler();
+        this->_unknownModelSampler = WeightedSampler();
+        std::vector<size_t>().swap(this->_dirtyActions);
+        this->_rootBounds = Rect();
+        this->_compacted = true;
+    }
+
+    void State::rehydrate(const std::shared_ptr<State> &copy) {
+        // copy has this state's hash, so it is built from the same widgets; it is dropped after
+        // Graph::addState. Merge groups stay empty, as for a state refilled after clearDetails.
+        this->_widgets = copy->_widgets;
+        this->_widgetColumns = copy->_widgetColumns;
+        std::fill(this->_widgetColumns.mergedCounts.begin(), this->_widgetColumns.mergedCounts.end(), 0U);
+        this->_rootBounds = copy->_rootBounds;
+        this->_compacted = false;
+        this->materializeActions();
+
+        std::unordered_map<uintptr_t, ColdAction> saved = unpackColdActions(this->_coldActions);
+        for (const auto &action: this->_actions) {
+            auto value = saved.find(action->hash());
+            if (value == saved.end()) {
+                continue;
+            }
+            action->setVisitedCount(value->second.visitedCount);
+            action->setPriority(value->second.priority);
+            action->setQValue(value->second.qValue);
+        }
+        std::string().swap(this->_coldActions);
+        this->_allActionsDirty = true;
+        _hasNoDetail = false;
+    }
+
+    void State::absorb(const State &other) {
+        this->_sessionDirty = true;
+        this->setVisitedCount(this->getVisitedCount() + other.getVisitedCount());
+        std::unordered_map<uintptr_t, ColdAction> values;
+        if (other._compacted) {
+            values = unpackColdActions(other._coldActions);
+        } else {
+            values.reserve(other._actions.size());
+            for (const auto &action: other._actions) {
+                values.emplace(action->hash(), ColdAction{action->getVisitedCount(), action->getPriority(),
+                                                          static_cast<float>(action->getQValue())});
+            }
+        }
+        for (const auto &action: this->_actions) {
+            auto value = values.find(action->hash());
+            if (value == values.end() || value->second.visitedCount <= 0) {
+                continue;
+            }
+            int visits = action->getVisitedCount();
+            int otherVisits = value->second.visitedCount;
+            action->setQValue((action->getQValue() * visits + value->second.qValue * otherVisits) /
+                              (visits + otherVisits));
+            action->setVisitedCount(visits + otherVisits);
+        }
+        // Visited and unvisited sets and priorities change with the counts
+        this->_allActionsDirty = true;
+    }
+
+    void State::accountMemory(MemoryFootprint &footprint) const {
+        if (this->_compacted) {
+            footprint.add("graph.coldStates", 1,
+                          MemoryFootprint::sharedBytes<State>() + MemoryFootprint::bytesOf(this->_coldActions));
+            return;
+        }
+        size_t stateBytes = MemoryFootprint::sharedBytes<State>() + MemoryFootprint::bytesOf(this->_actions) +
+                            MemoryFootprint::bytesOf(this->_widgets) + MemoryFootprint::bytesOf(this->_dirtyActions) +
+                            MemoryFootprint::bytesOf(this->_widgetColumns.hashes) +
+                            MemoryFootprint::bytesOf(this->_widgetColumns.actionMasks) +
+                            MemoryFootprint::bytesOf(this->_widgetColumns.mergedCounts) +
+                            this->_unvisitedSampler.heapBytes() + this->_unknownModelSampler.heapBytes() +
+                            MemoryFootprint::bytesOf(this->_mergedWidgets);
+        size_t widgets = 0;
+        size_t widgetBytes = 0;
+        auto addWidget = [&widgets, &widgetBytes](const WidgetPtr &widget) {
+            if (widget) {
+                widgets++;
+                widgetBytes += MemoryFootprint::sharedBytes<Widget>() + widget->heapBytes();
+            }
+        };
+        for (const WidgetPtr &widget: this->_widgets) {
+            addWidget(widget);
+        }
+        for (const auto &merged: this->_mergedWidgets) {
+            stateBytes += MemoryFootprint::bytesOf(merged.second);
+            for (const WidgetPtr &widget: merged.second) {
+                addWidget(widget);
+            }
+        }
+        size_t actions = this->_actions.size();  // back action included
+        size_t actionBytes = actions * MemoryFootprint::sharedBytes<ActivityStateAction>();
+        for (const auto &action: this->_actions) {
+            actionBytes += action->heapBytes();
+        }
+        footprint.add("graph.states", 1, stateBytes);
+        footprint.add("graph.widgets", widgets, widgetBytes);
+        footprint.add("graph.actions", actions, actionBytes);
+    }
+
+    std::unordered_map<uintptr_t, size_t> &State::fillDetailsIndex() {
+        // Kept per thread so that its buckets are reused from one refill to the next
+        static thread_local std::unordered_map<uintptr_t, size_t> index;
+        return index;
+    }
+
     void State::fillDetails(const std::shared_ptr<State> &copy) {
         if (copy == nullptr) {
             BLOGE("fillDetails: copy state is nullptr");
             return;
         }
+        if (this->_compacted) {
+            this->rehydrate(copy);
+            return;
+        }
         
-        for (const auto &widgetPtr: this->_widgets) {
+        // Performance: one pass indexes the copy by widget hash, one pass refills, so a
+        // revisited state costs O(widgets) instead of a scan of the copy per widget.
+        // The first widget of a hash wins, as with the scans this replaces.
+        std::unordered_map<uintptr_t, size_t> &copyRows = fillDetailsIndex();
+        copyRows.clear();
+        const std::vector<uintptr_t> &copyHashes = copy->_widgetColumns.hashes;
+        for (size_t copyRow = 0; copyRow < copyHashes.size(); copyRow++) {
+            copyRows.emplace(copyHashes[copyRow], copyRow);
+        }
+        for (size_t row = 0; row < this->_widgets.size(); row++) {
+            const WidgetPtr &widgetPtr = this->_widgets[row];
             if (widgetPtr == nullptr) {
                 BLOGE("fillDetails: found nullptr widget, skipping");
                 continue;
             }
-            auto widgetIterator = std::find_if(copy->_widgets.begin(), copy->_widgets.end(),
-                                               [&widgetPtr](const WidgetPtr &cw) {
-                                                   if (cw == nullptr || widgetPtr == nullptr) {
-                                                       return false;
-                                                   }
-                                                   return *(cw.get()) == *widgetPtr;
-                                               });
-            if (widgetIterator != copy->_widgets.end() && *widgetIterator != nullptr) {
-                widgetPtr->fillDetails(*widgetIterator);
+            auto copyRow = copyRows.find(this->_widgetColumns.hashes[row]);
+            if (copyRow != copyRows.end() && copy->_widgets[copyRow->second] != nullptr) {
+                widgetPtr->fillDetails(copy->_widgets[copyRow->second]);
             } else {
                 LOGE("ERROR can not refill widget");
             }
@@ -369,23 +609,24 @@ namespace fastbotx {
             auto mkw = copy->_mergedWidgets.find(miter.first);
             if (mkw == copy->_mergedWidgets.end())
                 continue;
+            const WidgetPtrVec &copyWidgets = mkw->second;
+            copyRows.clear();
+            for (size_t position = 0; position < copyWidgets.size(); position++) {
+                if (copyWidgets[position] != nullptr) {
+                    copyRows.emplace(copyWidgets[position]->hash(), position);
+                }
+            }
             for (const auto &widgetPtr: miter.second) {
                 if (widgetPtr == nullptr) {
                     continue;
                 }
-                auto widgetIterator = std::find_if((*mkw).second.begin(), (*mkw).second.end(),
-                                                   [&widgetPtr](const WidgetPtr &cw) {
-                                                       if (cw == nullptr || widgetPtr == nullptr) {
-                                                           return false;
-                                                       }
-                                                       return *(cw.get()) == *widgetPtr;
-                                                   });
-                if (widgetIterator != (*mkw).second.end() && *widgetIterator != nullptr) {
-                    widgetPtr->fillDetails(*widgetIterator);
+                auto position = copyRows.find(widgetPtr->hash());
+                if (position != copyRows.end()) {
+                    widgetPtr->fillDetails(copyWidgets[position->second]);
                 }
             }
-
         }
+        this->_allActionsDirty = true;
         _hasNoDetail = false;
     }
 
@@ -456,17 +697,16 @@ namespace fastbotx {
         return retA;
     }
 
-    ActivityStateActionPtr State::randomPickAction(const ActionFilterPtr &filter) const {
-        return this->randomPickAction(filter, true);
+    ActivityStateActionPtr State::randomPickAction(const ActionFilterPtr &filter, Rng &rng) const {
+        return this->randomPickAction(filter, true, rng);
     }
 
     ActivityStateActionPtr
-    State::randomPickAction(const ActionFilterPtr &filter, bool includeBack) const {
+    State::randomPickAction(const ActionFilterPtr &filter, bool includeBack, Rng &rng) const {
         int total = this->countActionPriority(filter, includeBack);
         if (total == 0)
             return nullptr;
-        // Use thread-local random number generator for better performance
-        int index = randomInt(0, total);
+        int index = rng.nextInt(0, total);
         return pickAction(filter, includeBack, index);
     }
 
@@ -488,14 +728,99 @@ namespace fastbotx {
         return nullptr;
     }
 
-    ActivityStateActionPtr State::randomPickUnvisitedAction() const {
-        ActivityStateActionPtr action = this->randomPickAction(enableValidUnvisitedFilter, false);
+    void State::computeActionWeight(size_t index) const {
+        const ActivityStateActionPtr &action = this->_actions[index];
+        int priority = action->getPriority();
+        bool unvisited = !action->isVisited();
+        // Same candidates as randomPickAction(enableValidUnvisitedFilter, false)
+        bool unvisitedCandidate = unvisited && !action->isBack()
+                                  && action->getEnabled() && action->isValid();
+        this->_unvisitedSampler.setWeight(index, unvisitedCandidate ? priority : 0);
+        this->_unknownModelSampler.setWeight(index, unvisited && action->isModelAct() ? priority : 0);
+    }
+
+    void State::ensureActionWeights() const {
+        if (this->_unvisitedSampler.size() == this->_actions.size()) {
+            return;
+        }
+        this->_unvisitedSampler.reset(this->_actions.size());
+        this->_unknownModelSampler.reset(this->_actions.size());
+        for (size_t i = 0; i < this->_actions.size(); i++) {
+            this->computeActionWeight(i);
+        }
+    }
+
+    int State::indexOfAction(const ActivityStateActionPtr &action) const {
+        if (this->_actions.empty() || action == nullptr) {
+            return -1;
+        }
+        // Builders append each widget row's actions in row order, then back
+        size_t last = this->_actions.size() - 1;
+        if (this->_actions[last] == action) {
+            return static_cast<int>(last);
+        }
+        int row = action->getTargetIndex();
+        auto begin = this->_actions.begin();
+        auto it = std::lower_bound(begin, begin + last, row,
+                                   [](const ActivityStateActionPtr &candidate, int targetRow) {
+                                       return candidate->getTargetIndex() < targetRow;
+                                   });
+        for (; it != begin + last && (*it)->getTargetIndex() == row; ++it) {
+            if (*it == action) {
+                return static_cast<int>(it - begin);
+            }
+        }
+        return -1;
+    }
+
+    void State::markActionDirty(const ActivityStateActionPtr &action) {
+        if (this->_allActionsDirty) {
+            return;
+        }
+        int index = this->indexOfAction(action);
+        if (index >= 0) {
+            this->_dirtyActions.push_back(static_cast<size_t>(index));
+        }
+    }
+
+    void State::refreshActionWeight(size_t index) {
+        if (this->_unvisitedSampler.size() != this->_actions.size()) {
+            // Not sampled yet: ensureActionWeights() reads every action on first use
+            return;
+        }
+        this->computeActionWeight(index);
+    }
+
+    ActivityStateActionPtr State::randomPickUnvisitedAction(Rng &rng) const {
+        this->ensureActionWeights();
+        ActivityStateActionPtr action;
+        int64_t total = this->_unvisitedSampler.total();
+        if (total > 0) {
+            action = this->_actions[this->_unvisitedSampler.find(rng.nextInt(0, static_cast<int>(total)))];
+        }
         if (action == nullptr && enableValidUnvisitedFilter->include(getBackAction())) {
             action = getBackAction();
         }
         return action;
     }
 
+    ActivityStateActionPtr
+    State::randomPickUnknownModelAction(const std::function<bool(const ActivityStateActionPtr &)> &isKnown,
+                                        Rng &rng) {
+        this->ensureActionWeights();
+        int64_t total;
+        while ((total = this->_unknownModelSampler.total()) > 0) {
+            size_t index = this->_unknownModelSampler.find(rng.nextInt(0, static_cast<int>(total)));
+            const ActivityStateActionPtr &action = this->_actions[index];
+            if (!isKnown(action)) {
+                return action;
+            }
+            // Rejecting and removing a known candidate leaves the others' odds as they were
+            this->_unknownModelSampler.exclude(index);
+        }
+        return nullptr;
+    }
+
 
     ActivityStateActionPtr State::resolveAt(ActivityStateActionPtr action, time_t /*t*/) {
         if (action == nullptr) {
@@ -529,11 +854,7 @@ namespace fastbotx {
         if (widget == nullptr) {
             return false;
         }
-        for (const auto &w: this->_widgets) {
-            if (equals(w, widget))
-                return true;
-        }
-        return false;
+        return this->_widgetColumns.find(widget->hash()) >= 0;
     }
 
     PropertyIDPrefixImpl(State, "g0s");
@@ -25,11 +25,71 @@
 #include "Widget.h"
 #include "Element.h"
 #include "ActionFilter.h"
+#include "WeightedSampler.h"
+#include <functional>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 
 namespace fastbotx {
 
+    class MemoryFootprint;
+
+    /**
+     * @brief Struct-of-arrays summary of a State's widgets
+     *
+     * Row i describes State::_widgets[i]. Saturation checks, α refinement and
+     * fillDetails matching only need a widget's hash and merge group size, so
+     * they scan these contiguous columns instead of dereferencing every WidgetPtr
+     * and looking up _mergedWidgets. Actions reference rows by index
+     * (ActivityStateAction::getTargetIndex()).
+     */
+    struct WidgetColumns {
+        /// Widget::hash() of each widget
+        std::vector<uintptr_t> hashes;
+        /// One bit per ActionType the widget supports
+        std::vector<uint32_t> actionMasks;
+        /// Size of _mergedWidgets[hash] (0 when the widget has no merge group)
+        std::vector<uint32_t> mergedCounts;
+
+        size_t size() const { return this->hashes.size(); }
+
+        void clear() {
+            this->hashes.clear();
+            this->actionMasks.clear();
+            this->mergedCounts.clear();
+        }
+
+        /// First row with the given hash, or -1
+        int find(uintptr_t hash) const {
+            for (size_t i = 0; i < this->hashes.size(); i++) {
+                if (this->hashes[i] == hash) {
+                    return static_cast<int>(i);
+                }
+            }
+            return -1;
+        }
+    };
+
+    /**
+     * @brief What cold storage keeps of a state, written to the session snapshot
+     *
+     * A state built from a record (StateFactory::createColdState) is in cold storage
+     * and refills like any compacted state once its page is seen again.
+     */
+    struct ColdStateRecord {
+        uintptr_t hash{0};
+        int visitedCount{0};
+        /// Widget key mask the state was built under
+        WidgetKeyMask mask{DefaultWidgetKeyMask};
+        /// Hash terms of ReuseState, so getHashUnderMask works before the state is refilled
+        uintptr_t activityKeyHash{0};
+        WidgetKeyHashAggregate widgetKeyHashes;
+        /// Actions packed as by State::compact
+        std::string actions;
+    };
+
 
     /**
      * @brief State class representing a UI state/screen in the application
@@ -73,9 +133,11 @@ namespace fastbotx {
         /**
          * @brief Get hash code of this state
          * 
+         * Final, so calls through State and ReuseState are inlined loads of _hashcode.
+         *
          * @return Hash code as uintptr_t
          */
-        uintptr_t hash() const override;
+        uintptr_t hash() const final { return this->_hashcode; }
 
 #if DYNAMIC_STATE_ABSTRACTION_ENABLED
         /**
@@ -131,17 +193,66 @@ namespace fastbotx {
         /**
          * @brief Randomly pick an unvisited action
          * 
+         * Weighted by priority over the enabled, valid, unvisited non-back actions
+         * (O(log n) from the state's sampler); falls back to back.
+         *
+         * @param rng Generator of the picking agent
          * @return Random unvisited action, or nullptr if all visited
          */
-        ActivityStateActionPtr randomPickUnvisitedAction() const;
+        ActivityStateActionPtr randomPickUnvisitedAction(Rng &rng) const;
+
+        /**
+         * @brief Randomly pick an unvisited model action the caller does not know yet
+         *
+         * Samples unvisited model actions by priority. A sampled action for which
+         * isKnown returns true is excluded from this state's sampler for good, so
+         * isKnown must stay true once it was (e.g. "already in the reuse model").
+         *
+         * @param isKnown Predicate rejecting candidates
+         * @param rng Generator of the picking agent
+         * @return Picked action, or nullptr if every candidate is known or has priority 0
+         */
+        ActivityStateActionPtr
+        randomPickUnknownModelAction(const std::function<bool(const ActivityStateActionPtr &)> &isKnown, Rng &rng);
+
+        /**
+         * @brief Record that an action's priority inputs changed (it was visited or re-targeted)
+         *
+         * The agent then recomputes only this action's priority on its next adjustActions().
+         * Actions of other states are ignored.
+         */
+        void markActionDirty(const ActivityStateActionPtr &action);
+
+        /// Every action needs its priority recomputed (new state, or merge groups changed)
+        bool allActionsDirty() const { return this->_allActionsDirty; }
+
+        /// Indices (into getActions()) of the actions marked dirty since clearDirtyActions()
+        const std::vector<size_t> &dirtyActions() const { return this->_dirtyActions; }
+
+        /// The agent adjusted the dirty actions
+        void clearDirtyActions() {
+            this->_allActionsDirty = false;
+            this->_dirtyActions.clear();
+        }
+
+        /**
+         * @brief Update the sampling weights of one action
+         *
+         * Call after the action's priority, visit count or validity changed (the agent
+         * does from adjustActions); O(log n), free if the weights are unchanged.
+         *
+         * @param index Index of the action in getActions()
+         */
+        void refreshActionWeight(size_t index);
 
         /**
          * @brief Randomly pick an action matching the filter
          * 
          * @param filter Action filter to apply
+         * @param rng Generator of the picking agent
          * @return Random matching action, or nullptr if none found
          */
-        ActivityStateActionPtr randomPickAction(const ActionFilterPtr &filter) const;
+        ActivityStateActionPtr randomPickAction(const ActionFilterPtr &filter, Rng &rng) const;
 
         /**
          * @brief Resolve action at a specific timestamp
@@ -220,6 +331,9 @@ namespace fastbotx {
          */
         virtual void clearDetails();
 
+        /// Add the state, its widgets and its actions to footprint (graph lock held)
+        void accountMemory(MemoryFootprint &footprint) const;
+
         /**
          * @brief Fill details from another state
          * 
@@ -237,6 +351,52 @@ namespace fastbotx {
          */
         bool hasNoDetail() const { return this->_hasNoDetail; }
 
+        /**
+         * @brief Move a detail-dropped state to cold storage
+         *
+         * Keeps the state's own hash, activity and visit statistics, and of each action
+         * only its hash, visit count, priority and Q value, varint-packed into one buffer.
+         * Widgets, actions, columns and samplers are released; the next fillDetails()
+         * rebuilds them from the revisiting state and restores the packed values.
+         * The caller makes sure nothing outside the state holds its actions.
+         */
+        virtual void compact();
+
+        /// Whether the state is in cold storage (see compact)
+        bool isCompacted() const { return this->_compacted; }
+
+        /// The state as compact() would keep it, without compacting it (graph lock held)
+        virtual ColdStateRecord toColdRecord() const;
+
+        /**
+         * @brief Whether toColdRecord() may have changed since the session snapshot last took it
+         *
+         * Set under the graph write lock by whoever visits the state or updates its actions'
+         * statistics; cleared by the session capture, which alone reads it, under the read lock.
+         */
+        bool isSessionDirty() const { return this->_sessionDirty; }
+
+        void markSessionDirty() { this->_sessionDirty = true; }
+
+        void clearSessionDirty() { this->_sessionDirty = false; }
+
+        /**
+         * @brief Take over the statistics of a state this one supersedes
+         *
+         * Adds other's visits to this state's, and to each action those of other's action
+         * with the same hash; Q values are averaged weighted by visits. other may be in
+         * cold storage, this state may not.
+         */
+        void absorb(const State &other);
+
+        /**
+         * @brief Create the actions of a state built without them
+         *
+         * Revisited states are thrown away after Graph::addState, so their actions are
+         * only created once the state is known to be new. No-op if already created.
+         */
+        virtual void materializeActions() {}
+
         FuncGetID(State);
 
     protected:
@@ -249,6 +409,15 @@ namespace fastbotx {
         /// \return
         int mergeWidgetAndStoreMergedOnes(WidgetPtrSet &mergeWidgets);
 
+        /// Fill _widgetColumns from _widgets and _mergedWidgets; call once both are final
+        void buildWidgetColumns();
+
+        /// Total number of widget actions (sum of action bits over _widgetColumns)
+        size_t countWidgetActions() const;
+
+        /// Row of an action's target in _widgetColumns, or -1 if the action does not point into this state
+        int targetRowOf(const ActivityStateActionPtr &action) const;
+
         ///
         /// \param parentWidget
         /// \param elem
@@ -257,9 +426,10 @@ namespace fastbotx {
         ///
         /// \param filter
         /// \param includeBack
+        /// \param rng
         /// \return
         ActivityStateActionPtr
-        randomPickAction(const ActionFilterPtr &filter, bool includeBack) const;
+        randomPickAction(const ActionFilterPtr &filter, bool includeBack, Rng &rng) const;
 
         ///
         /// \param filter
@@ -276,8 +446,8 @@ namespace fastbotx {
         /// Activity name string pointer (shared for memory efficiency)
         stringPtr _activity;
         
-        /// Bounds of the root element
-        RectPtr _rootBounds;
+        /// Bounds of the root element (inline: four ints need no shared copy)
+        Rect _rootBounds;
         
         /// Vector of all available actions in this state
         ActivityStateActionPtrVec _actions;
@@ -288,14 +458,54 @@ namespace fastbotx {
         /// Map from widget hash to vector of merged widgets (for widget deduplication)
         WidgetPtrVecMap _mergedWidgets;
 
+        /// Hot per-widget data in contiguous columns, parallel to _widgets
+        WidgetColumns _widgetColumns;
+
         /// Flag indicating if detailed information has been cleared
         bool _hasNoDetail;
         
-        /// Static shared root bounds (used for comparison across states)
-        static RectPtr _sameRootBounds;
-        
         /// Back action for navigating away from this state
         ActivityStateActionPtr _backAction;
+
+        /// Priority of enabled, valid, unvisited non-back actions, by action index
+        mutable WeightedSampler _unvisitedSampler;
+
+        /// Priority of unvisited model actions, by action index (see randomPickUnknownModelAction)
+        mutable WeightedSampler _unknownModelSampler;
+
+        /// Actions to re-adjust; unused while _allActionsDirty
+        std::vector<size_t> _dirtyActions;
+
+        /// No priority was computed yet, or saturation inputs changed for every action
+        bool _allActionsDirty{true};
+
+        /// Packed actions of a compacted state: per action, 8 raw hash bytes then varints of
+        /// the visit count, the zigzagged priority and the bits of the float Q value
+        std::string _coldActions;
+
+        /// Widgets and actions were released by compact()
+        bool _compacted{false};
+
+        /// New states have never been captured
+        bool _sessionDirty{true};
+
+        /// Index of action in _actions, or -1
+        int indexOfAction(const ActivityStateActionPtr &action) const;
+
+        /// _actions packed for cold storage (see _coldActions)
+        std::string packActions() const;
+
+        /// Scratch index of fillDetails (widget hash -> row of the copy), reused per thread
+        static std::unordered_map<uintptr_t, size_t> &fillDetailsIndex();
+
+        /// Leave cold storage: take copy's widgets, rebuild the actions and restore their values
+        void rehydrate(const std::shared_ptr<State> &copy);
+
+        /// Size the samplers to _actions and fill every weight (first use)
+        void ensureActionWeights() const;
+
+        /// Write action index's weights into the samplers
+        void computeActionWeight(size_t index) const;
     private:
         static std::shared_ptr<State> create(ElementPtr elem, stringPtr activityName);
 
@@ -305,7 +515,7 @@ namespace fastbotx {
 
     typedef std::shared_ptr<State> StatePtr;
     typedef std::vector<StatePtr> StatePtrVec;
-    typedef std::set<StatePtr, Comparator<State>> StatePtrSet;
+    typedef std::set<StatePtr, HashComparator<State>> StatePtrSet;
 
 }
 
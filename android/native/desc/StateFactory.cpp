@@ -12,10 +12,21 @@
 namespace fastbotx {
 
     StatePtr StateFactory::createState(AlgorithmType /*agentT*/, const stringPtr &activity,
-                                       const ElementPtr &element, WidgetKeyMask mask) {
+                                       const ElementPtr &element, WidgetKeyMask mask,
+                                       bool materializeActions, StepExecutor *executor) {
         StatePtr state = nullptr;
-        state = ReuseState::create(element, activity, mask);
+        state = ReuseState::create(element, activity, mask, materializeActions, executor);
         return state;
     }
 
+    uintptr_t StateFactory::computeStateHash(AlgorithmType /*agentT*/, const stringPtr &activity,
+                                             const ElementPtr &element, WidgetKeyMask mask) {
+        return ReuseState::computeHash(element, activity, mask);
+    }
+
+    StatePtr StateFactory::createColdState(AlgorithmType /*agentT*/, const stringPtr &activity,
+                                           ColdStateRecord record) {
+        return ReuseState::createCold(activity, std::move(record));
+    }
+
 }
@@ -13,6 +13,8 @@
 
 namespace fastbotx {
 
+    class StepExecutor;
+
     /**
      * @brief Factory class for creating State objects
      * 
@@ -32,11 +34,29 @@ namespace fastbotx {
          * @param activity Activity name string pointer
          * @param element Root Element of the UI hierarchy
          * @param mask Widget key mask for dynamic state abstraction (default: DefaultWidgetKeyMask)
+         * @param materializeActions If false, only widgets and the hash are built; call
+         *                           State::materializeActions() before the state is used
+         *                           as a new graph node
+         * @param executor Workers that may help build a large tree, or nullptr (see ReuseState::create)
          * @return Shared pointer to created State
          */
         static StatePtr
         createState(AlgorithmType agentT, const stringPtr &activity, const ElementPtr &element,
-                   WidgetKeyMask mask = DefaultWidgetKeyMask);
+                   WidgetKeyMask mask = DefaultWidgetKeyMask, bool materializeActions = true,
+                   StepExecutor *executor = nullptr);
+
+        /**
+         * @brief Hash of the state createState() would build, computed from the Element tree alone
+         *
+         * @return The state hash, or 0 when the state type cannot compute it without building
+         */
+        static uintptr_t
+        computeStateHash(AlgorithmType agentT, const stringPtr &activity, const ElementPtr &element,
+                         WidgetKeyMask mask = DefaultWidgetKeyMask);
+
+        /// State in cold storage built from a record of State::toColdRecord (session resume)
+        static StatePtr
+        createColdState(AlgorithmType agentT, const stringPtr &activity, ColdStateRecord record);
     };
 }
 #endif /* SateFactory_H_ */
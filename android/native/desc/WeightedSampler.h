@@ -0,0 +1,105 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef WeightedSampler_H_
+#define WeightedSampler_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace fastbotx {
+
+    /**
+     * @brief Fenwick tree over non-negative slot weights for weighted random picks
+     *
+     * Replaces "sum the weights, draw r in [0, total), walk until r < weight" when the
+     * weights persist between picks: setWeight() is O(log n) (and free when the weight
+     * did not change), total() is O(1) and find() descends the tree in O(log n).
+     *
+     * A slot can be excluded: it keeps weight 0 whatever setWeight() says until the
+     * next reset(). Used for candidates the caller learned can never be picked again.
+     */
+    class WeightedSampler {
+    public:
+        size_t size() const { return this->_weights.size(); }
+
+        int64_t total() const { return this->_total; }
+
+        /// Heap bytes of the tree and weight arrays
+        size_t heapBytes() const {
+            return (this->_tree.capacity() + this->_weights.capacity()) * sizeof(int64_t) +
+                   this->_excluded.capacity() * sizeof(uint8_t);
+        }
+
+        int64_t weight(size_t slot) const { return this->_weights[slot]; }
+
+        /// n slots, all of weight 0 and none excluded
+        void reset(size_t n) {
+            this->_tree.assign(n + 1, 0);
+            this->_weights.assign(n, 0);
+            this->_excluded.assign(n, 0);
+            this->_total = 0;
+            this->_topBit = 1;
+            while ((this->_topBit << 1) <= n) {
+                this->_topBit <<= 1;
+            }
+        }
+
+        /// Change a slot's weight (negative weights count as 0)
+        void setWeight(size_t slot, int64_t weight) {
+            if (weight < 0 || this->_excluded[slot]) {
+                weight = 0;
+            }
+            int64_t delta = weight - this->_weights[slot];
+            if (0 == delta) {
+                return;
+            }
+            this->_weights[slot] = weight;
+            this->_total += delta;
+            for (size_t i = slot + 1; i < this->_tree.size(); i += i & (~i + 1)) {
+                this->_tree[i] += delta;
+            }
+        }
+
+        /// Pin a slot at weight 0 until reset()
+        void exclude(size_t slot) {
+            this->setWeight(slot, 0);
+            this->_excluded[slot] = 1;
+        }
+
+        /**
+         * @brief Slot whose weight interval contains target
+         *
+         * @param target Value in [0, total())
+         * @return Slot s with weight(0) + ... + weight(s - 1) <= target < ... + weight(s)
+         */
+        size_t find(int64_t target) const {
+            size_t position = 0;
+            for (size_t step = this->_topBit; step != 0; step >>= 1) {
+                size_t next = position + step;
+                if (next < this->_tree.size() && this->_tree[next] <= target) {
+                    position = next;
+                    target -= this->_tree[next];
+                }
+            }
+            // position counts the slots whose cumulative weight is <= target
+            return position;
+        }
+
+    private:
+        /// 1-based Fenwick tree of partial sums
+        std::vector<int64_t> _tree;
+        std::vector<int64_t> _weights;
+        std::vector<uint8_t> _excluded;
+        int64_t _total{0};
+        /// Highest power of two <= size(), where find() starts descending
+        size_t _topBit{1};
+    };
+
+}
+
+#endif //WeightedSampler_H_
@@ -9,8 +9,11 @@
 
 
 #include "Widget.h"
+#include "WidgetText.h"
 #include "../utils.hpp"
 #include "Preference.h"
+#include "MemoryFootprint.h"
+#include "json.hpp"
 #include <algorithm>
 #include <utility>
 #include <vector>
@@ -20,10 +23,60 @@ namespace fastbotx {
 
     Widget::Widget() = default;
 
-    const auto ifCharIsDigitOrBlank = [](const char &c) -> bool {
-        return c == ' ' || (c >= '0' && c <= '9');
-    };
+    namespace {
+        int operateMaskOf(const Element &element) {
+            int operateMask = OperateType::None;
+            if (element.getCheckable())
+                operateMask |= OperateType::Checkable;
+            if (element.getEnable())
+                operateMask |= OperateType::Enable;
+            if (element.getClickable())
+                operateMask |= OperateType::Clickable;
+            if (element.getScrollable())
+                operateMask |= OperateType::Scrollable;
+            if (element.getLongClickable())
+                operateMask |= OperateType::LongClickable;
+            return operateMask;
+        }
+
+        /// Whether initFormElement will give the widget at least one action
+        bool operateOrScrollHasAction(int operateMask, ScrollType scrollType) {
+            return (operateMask & (OperateType::LongClickable | OperateType::Checkable | OperateType::Clickable)) != 0
+                   || scrollType == ScrollType::ALL || scrollType == ScrollType::Horizontal
+                   || scrollType == ScrollType::Vertical;
+        }
+
+        inline uintptr_t textKeyFromHash(size_t size, uintptr_t stringHash) {
+            return 0 == size ? 0 : (0x79b9U + (stringHash << 5));
+        }
+
+        inline uintptr_t textKeyHash(const char *data, size_t size) {
+            return 0 == size ? 0 : textKeyFromHash(size, fastbotx::fastStringHash(data, size));
+        }
+
+        /// Parser hashes usable for the text key: the text-model cut does not apply to them
+        inline const Element::FusedHashes *fusedTextHashes(const Element &element, bool useTextModel) {
+            const Element::FusedHashes *fused = element.getFusedHashes();
+            if (fused && useTextModel && fused->strippedTextSize > STATE_TEXT_MAX_LEN) {
+                return nullptr;
+            }
+            return fused;
+        }
+
+        inline uintptr_t indexKeyHash(int index) {
+            return (0x79b9U + (static_cast<uintptr_t>(std::hash<int>{}(index)) << 6)) << 1;
+        }
+    }
+
 
+    StateAbstractionOptions StateAbstractionOptions::current() {
+        PreferencePtr pref = Preference::inst();
+        StateAbstractionOptions options;
+        options.useTextModel = STATE_WITH_TEXT || pref->isForceUseTextModel();
+        options.withIndex = STATE_WITH_INDEX || pref->isStateWithIndex();
+        options.withWidgetOrder = STATE_WITH_WIDGET_ORDER || pref->isStateWithWidgetOrder();
+        return options;
+    }
 
     /**
      * @brief Constructor creates a Widget from an Element
@@ -32,10 +85,8 @@ namespace fastbotx {
      * and computing the widget's hash code. The text is processed to remove
      * digits and spaces, and may be truncated for Chinese text handling.
      * 
-     * Performance optimizations:
-     * - Uses move semantics for parent to avoid copying
-     * - Efficient string processing with remove_if algorithm
-     * - Hash computation only when needed (based on configuration flags)
+     * Reads StateAbstractionOptions for this one widget; state builders read them once
+     * and use the WidgetHashPolicy constructor instead.
      * 
      * @param parent Parent widget (nullptr for root widgets)
      * @param element The Element to create widget from
@@ -43,86 +94,70 @@ namespace fastbotx {
     Widget::Widget(std::shared_ptr<Widget> parent, const ElementPtr &element) {
         // Move parent to avoid copying shared_ptr
         this->_parent = std::move(parent);
-        
-        // Performance optimization: Cache Preference instance to avoid repeated inst() calls
-        // Preference::inst() is thread-safe singleton, but caching avoids repeated function calls
-        PreferencePtr pref = Preference::inst();
-        
-        // Initialize widget properties from element
         this->initFormElement(element);
-        
-        // Performance: Remove digits and blank spaces from text using efficient algorithm
-        // remove_if moves matching elements to end, returns iterator to new end
-        auto removeIterator = std::remove_if(this->_text.begin(), 
-                                             this->_text.end(), 
-                                             ifCharIsDigitOrBlank);
-        // Erase removed elements
-        this->_text.erase(removeIterator, this->_text.end());
-        
-        // Process text for hash computation if text-based state is enabled
-        // Use cached Preference instance instead of calling inst() again
-        bool useTextModel = STATE_WITH_TEXT || pref->isForceUseTextModel();
-        bool overMaxLen = false;
-        std::string finalText = this->_text; // Keep original for hash computation
-        
-        if (useTextModel) {
-            overMaxLen = this->_text.size() > STATE_TEXT_MAX_LEN;
-            
-            // Performance optimization: Compute cut length first, then do single substr
-            size_t cutLength = static_cast<size_t>(STATE_TEXT_MAX_LEN);
-            
-            // Handle Chinese characters: if cut point is in middle of Chinese char, adjust
-            // Check if we need to adjust cut point for Chinese characters
-            if (this->_text.length() > cutLength) {
-                // Check a bit beyond cutLength to see if we're in middle of Chinese char
-                size_t checkLen = std::min(cutLength + 4, this->_text.length());
-                std::string tempText = this->_text.substr(0, checkLen);
-                if (tempText.length() > cutLength && isZhCn(tempText[cutLength])) {
-                    size_t ci = 0;
-                    // Find safe cut point that doesn't split Chinese characters
-                    for (; ci < cutLength && ci < tempText.length(); ci++) {
-                        if (isZhCn(tempText[ci])) {
-                            ci += 2; // Chinese chars are typically 2-3 bytes in UTF-8
-                        }
-                    }
-                    cutLength = ci;
-                }
+        StateAbstractionOptions options = StateAbstractionOptions::current();
+        if (options.useTextModel) {
+            if (options.withIndex) {
+                this->initTextAndIndex<true, true>(element);
+            } else {
+                this->initTextAndIndex<true, false>(element);
             }
-
-            // Final text truncation (single substr operation)
-            finalText = this->_text.substr(0, cutLength);
-            this->_text = finalText;
+        } else if (options.withIndex) {
+            this->initTextAndIndex<false, true>(element);
+        } else {
+            this->initTextAndIndex<false, false>(element);
         }
+    }
 
-        // Performance optimization: Compute text hash only once and reuse
+    template<class Policy>
+    Widget::Widget(std::shared_ptr<Widget> parent, const ElementPtr &element, Policy /*policy*/) {
+        this->_parent = std::move(parent);
+        this->initFormElement(element);
+        this->initTextAndIndex<Policy::useTextModel, Policy::withIndex>(element);
+    }
+
+    /**
+     * @brief Normalize the text and add the text and index terms to the hash
+     *
+     * Performance optimizations:
+     * - The text is normalized straight from the element into the widget's storage
+     *   by one kernel (normalizeWidgetText), which also yields its hash
+     * - The options are template parameters, so the branches on them fold away
+     */
+    template<bool UseTextModel, bool WithIndex>
+    void Widget::initTextAndIndex(const ElementPtr &element) {
+        bool overMaxLen = false;
         // Component hash for Text (for dynamic abstraction hashWithMask)
-        // Use fast string hash for better performance
-        uintptr_t textHash = finalText.empty() ? 0 : (0x79b9U + (fastbotx::fastStringHash(finalText) << 5));
+        // Performance optimization: reuse the hash computed while parsing when available
+        const Element::FusedHashes *fused = fusedTextHashes(*element, UseTextModel);
+        const ElementString &rawText = element->getText();
+        uintptr_t strippedHash = 0;
+        normalizeWidgetText(rawText.data(), rawText.size(), UseTextModel, this->_text, overMaxLen,
+                            fused ? nullptr : &strippedHash);
+        uintptr_t textHash = fused ? textKeyFromHash(fused->strippedTextSize, fused->strippedText)
+                                   : textKeyFromHash(this->_text.size(), strippedHash);
         this->_hashText = textHash;
         
         // Only include text in hash if it wasn't truncated
         // (truncated text would make hash unstable)
-        if (useTextModel && !overMaxLen) {
+        if (UseTextModel && !overMaxLen) {
             this->_hashcode ^= textHash;
         }
 
-        // Include index in hash if configured
-        if (STATE_WITH_INDEX) {
-            this->_hashcode ^= ((0x79b9 + (std::hash<int>{}(this->_index) << 6)) << 1);
+        // Include index in hash if configured (_hashIndex is set by initFormElement)
+        if (WithIndex) {
+            this->_hashcode ^= this->_hashIndex;
         }
     }
 
+    template Widget::Widget(std::shared_ptr<Widget>, const ElementPtr &, WidgetHashPolicy<false, false>);
+    template Widget::Widget(std::shared_ptr<Widget>, const ElementPtr &, WidgetHashPolicy<false, true>);
+    template Widget::Widget(std::shared_ptr<Widget>, const ElementPtr &, WidgetHashPolicy<true, false>);
+    template Widget::Widget(std::shared_ptr<Widget>, const ElementPtr &, WidgetHashPolicy<true, true>);
+
     void Widget::initFormElement(const ElementPtr &element) {
-        if (element->getCheckable())
-            enableOperate(OperateType::Checkable);
-        if (element->getEnable())
-            enableOperate(OperateType::Enable);
-        if (element->getClickable())
-            enableOperate(OperateType::Clickable);
-        if (element->getScrollable())
-            enableOperate(OperateType::Scrollable);
-        if (element->getLongClickable()) {
-            enableOperate(OperateType::LongClickable);
+        enableOperate(static_cast<OperateType>(operateMaskOf(*element)));
+        if (this->hasOperate(OperateType::LongClickable)) {
             this->_actions.insert(ActionType::LONG_CLICK);
         }
         if (this->hasOperate(OperateType::Checkable) ||
@@ -153,11 +188,11 @@ namespace fastbotx {
         }
 
         if (this->hasAction()) {
-            this->_clazz = (element->getClassname());
+            this->_clazz = element->getInternedClassname();
             
             // Performance optimization: Use length check and pointer comparison for common class names
             // This avoids multiple string comparisons and allocations
-            const std::string &clazz = this->_clazz;
+            const std::string &clazz = this->_clazz.str();
             const char *clazzPtr = clazz.c_str();
             size_t clazzLen = clazz.length();
             
@@ -176,23 +211,17 @@ namespace fastbotx {
                     this->_actions.insert(ActionType::SCROLL_BOTTOM_UP_N);
                 }
             }
-            this->_resourceID = (element->getResourceID());
-        }
-        if (element->getBounds()) {
-            this->_bounds = element->getBounds();
-        } else {
-            this->_bounds = Rect::RectZero;
-            BLOGE("Widget::initFormElement: element->getBounds() returned null, using RectZero");
+            this->_resourceID = element->getInternedResourceID();
         }
+        this->_bounds = element->getBounds();
         this->_index = element->getIndex();
         this->_enabled = element->getEnable();
-        this->_text = element->getText();
         
         // Performance optimization: Use const reference to avoid string copy
         // Only copy if ContentDesc is actually used (non-empty)
-        const std::string &contentDescRef = element->getContentDesc();
+        const ElementString &contentDescRef = element->getContentDesc();
         if (!contentDescRef.empty()) {
-            this->_contextDesc = contentDescRef; // Copy only when needed
+            this->_contextDesc = contentDescRef.str(); // Copy only when needed
         } else {
             this->_contextDesc.clear(); // Explicitly clear to avoid unnecessary allocation
         }
@@ -200,8 +229,9 @@ namespace fastbotx {
         // Performance optimization: Use fast string hash function instead of std::hash
         // This provides better performance for typical UI strings (short to medium length)
         // compute for only 1 time (base + component hashes for dynamic abstraction)
-        uintptr_t hashcode1 = fastbotx::fastStringHash(this->_clazz);
-        uintptr_t hashcode2 = fastbotx::fastStringHash(this->_resourceID);
+        // Interned strings carry their fastStringHash, so no rehash per widget
+        uintptr_t hashcode1 = this->_clazz.hash();
+        uintptr_t hashcode2 = this->_resourceID.hash();
         uintptr_t hashcode3 = std::hash<int>{}(this->_operateMask);
         uintptr_t hashcode4 = std::hash<int>{}(scrollType);
 
@@ -213,13 +243,11 @@ namespace fastbotx {
         // Performance optimization: Compute ContentDesc hash only if not empty
         // Most widgets don't have ContentDesc, so this avoids unnecessary hash computation
         // Use fast string hash for better performance
-        if (!this->_contextDesc.empty()) {
-            this->_hashContentDesc = 0x79b9U + (fastbotx::fastStringHash(this->_contextDesc) << 5);
-        } else {
-            this->_hashContentDesc = 0; // Fast path for empty ContentDesc
-        }
+        const Element::FusedHashes *fused = element->getFusedHashes();
+        this->_hashContentDesc = fused ? textKeyFromHash(this->_contextDesc.size(), fused->contentDesc)
+                                       : textKeyHash(this->_contextDesc.data(), this->_contextDesc.size());
         
-        this->_hashIndex = (0x79b9U + (static_cast<uintptr_t>(std::hash<int>{}(this->_index)) << 6)) << 1;
+        this->_hashIndex = indexKeyHash(this->_index);
 
         this->_hashcode = ((hashcode1 ^ (hashcode2 << 4)) >> 2) ^
                           (((127U * hashcode3 << 1) ^ (256U * hashcode4 << 3)) >> 1);
@@ -230,15 +258,21 @@ namespace fastbotx {
     }
 
     void Widget::clearDetails() {
-        this->_clazz.clear();
+        this->_clazz = InternedString();
         this->_text.clear();
         this->_contextDesc.clear();
-        this->_resourceID.clear();
-        this->_bounds = Rect::RectZero;
+        this->_resourceID = InternedString();
+        this->_bounds = Rect();
+        std::string().swap(this->_descriptor);
         this->_hashClazz = this->_hashResourceID = this->_hashOperateMask = this->_hashScrollType = 0;
         this->_hashText = this->_hashContentDesc = this->_hashIndex = 0;
     }
 
+    size_t Widget::heapBytes() const {
+        return MemoryFootprint::bytesOf(this->_text) + MemoryFootprint::bytesOf(this->_contextDesc)
+               + MemoryFootprint::bytesOf(this->_descriptor);
+    }
+
     void Widget::fillDetails(const std::shared_ptr<Widget> &copy) {
         this->_text = copy->_text;
         this->_clazz = copy->_clazz;
@@ -253,6 +287,13 @@ namespace fastbotx {
         this->_hashText = copy->_hashText;
         this->_hashContentDesc = copy->_hashContentDesc;
         this->_hashIndex = copy->_hashIndex;
+        this->_descriptor.clear();
+    }
+
+    std::shared_ptr<Widget> Widget::cloneWithParent(std::shared_ptr<Widget> parent) const {
+        auto widget = std::make_shared<Widget>(*this);
+        widget->_parent = std::move(parent);
+        return widget;
     }
 
     std::string Widget::toString() const {
@@ -267,20 +308,14 @@ namespace fastbotx {
             return "";
         }
 
-        // Make local copies to avoid issues if strings are modified during formatting
-        std::string clazzCopy = this->_clazz;
-        std::string resourceIDCopy = this->_resourceID;
+        // Interned strings are immutable, only the per-widget text fields are copied
+        const std::string &clazzCopy = this->_clazz.str();
+        const std::string &resourceIDCopy = this->_resourceID.str();
         std::string textCopy = this->_text;
         std::string contextDescCopy = this->_contextDesc;
         
         std::stringstream stringStream;
-        std::string boundsStr = "";
-        if (this->_bounds != nullptr) {
-            boundsStr = this->_bounds->toString();
-        } else {
-            boundsStr = "[null]";
-            BLOGE("Widget::toXPath: _bounds is null for widget");
-        }
+        std::string boundsStr = this->_bounds.toString();
         stringStream << "{xpath: /*" <<
                      "[@class=\"" << clazzCopy << "\"]" <<
                      "[@resource-id=\"" << resourceIDCopy << "\"]" <<
@@ -291,26 +326,41 @@ namespace fastbotx {
         return stringStream.str();
     }
 
-    std::string Widget::toJson() const {
+    /// A JSON string literal of value; invalid UTF-8 is replaced rather than thrown on
+    static void appendJsonString(std::string &out, const std::string &value) {
+        out += nlohmann::json(value).dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+    }
+
+    const std::string &Widget::toJson() const {
         // Details cleared for memory (e.g. after state merge); skip per-call log to avoid noise
         if (this->_text.empty() && this->_clazz.empty()
             && this->_resourceID.empty()) {
-            return "";
+            return this->_descriptor;
         }
-
-        nlohmann::json j;
-        j["index"] = this->_index;
-        j["class"] = this->_clazz;
-        j["resource-id"] = this->_resourceID;
-        j["text"] =  this->_text;
-        j["content-desc"] = this->_contextDesc;
-        if (this->_bounds != nullptr) {
-            j["bounds"] = this->_bounds->toString();
-        } else {
-            j["bounds"] = "[null]";
-            BLOGE("Widget::toJson: _bounds is null for widget");
+        if (!this->_descriptor.empty()) {
+            return this->_descriptor;
         }
-        return j.dump();
+
+        // Same text as dumping a json object of these fields (keys sorted, compact),
+        // written directly instead of through a json object per call
+        std::string boundsStr = this->_bounds.toString();
+        std::string &out = this->_descriptor;
+        out.reserve(96 + boundsStr.size() + this->_clazz.str().size() + this->_resourceID.str().size()
+                    + this->_text.size() + this->_contextDesc.size());
+        out += "{\"bounds\":";
+        appendJsonString(out, boundsStr);
+        out += ",\"class\":";
+        appendJsonString(out, this->_clazz.str());
+        out += ",\"content-desc\":";
+        appendJsonString(out, this->_contextDesc);
+        out += ",\"index\":";
+        out += std::to_string(this->_index);
+        out += ",\"resource-id\":";
+        appendJsonString(out, this->_resourceID.str());
+        out += ",\"text\":";
+        appendJsonString(out, this->_text);
+        out += '}';
+        return out;
     }
 
     std::string Widget::buildFullXpath() const {
@@ -336,29 +386,129 @@ namespace fastbotx {
         this->_parent = nullptr;
     }
 
-    uintptr_t Widget::hash() const {
-        return _hashcode;
+    uintptr_t Widget::hashWithMask(WidgetKeyMask mask) const {
+        return combineKeyHashes(mask, _hashClazz, _hashResourceID, _hashOperateMask, _hashScrollType,
+                                _hashText, _hashContentDesc, _hashIndex);
     }
 
-    uintptr_t Widget::hashWithMask(WidgetKeyMask mask) const {
-        uintptr_t h;
+    namespace {
+
+        // Terms of combineKeyHashes; WidgetKeyHashAggregate XORs the same terms
+
+        inline uintptr_t resourceIDTerm(uintptr_t resourceID) { return resourceID << 4; }
+
+        inline uintptr_t operateMaskTerm(uintptr_t operateMask) { return 127U * operateMask << 1; }
+
+        inline uintptr_t scrollTypeTerm(uintptr_t scrollType) { return 256U * scrollType << 3; }
+
+        inline uintptr_t defaultBaseTerm(uintptr_t clazz, uintptr_t resourceID, uintptr_t operateMask,
+                                         uintptr_t scrollType) {
+            return ((clazz ^ resourceIDTerm(resourceID)) >> 2) ^
+                   ((operateMaskTerm(operateMask) ^ scrollTypeTerm(scrollType)) >> 1);
+        }
+
+        /// Selected terms onto a base; clazz..scrollType are only read when the base is not the default one
+        inline uintptr_t combineTerms(WidgetKeyMask mask, uintptr_t defaultBase, uintptr_t base, uintptr_t clazz,
+                                      uintptr_t resourceID, uintptr_t operateMask, uintptr_t scrollType,
+                                      uintptr_t text, uintptr_t contentDesc, uintptr_t index) {
+            uintptr_t h;
+            const auto defaultMask = static_cast<WidgetKeyMask>(DefaultWidgetKeyMask);
+            if ((mask & defaultMask) == defaultMask) {
+                h = defaultBase;
+            } else {
+                h = base;
+                if (mask & static_cast<WidgetKeyMask>(WidgetKeyAttr::Clazz)) h ^= clazz;
+                if (mask & static_cast<WidgetKeyMask>(WidgetKeyAttr::ResourceID)) h ^= resourceID;
+                if (mask & static_cast<WidgetKeyMask>(WidgetKeyAttr::OperateMask)) h ^= operateMask;
+                if (mask & static_cast<WidgetKeyMask>(WidgetKeyAttr::ScrollType)) h ^= scrollType;
+            }
+            if (mask & static_cast<WidgetKeyMask>(WidgetKeyAttr::Text)) h ^= text;
+            if (mask & static_cast<WidgetKeyMask>(WidgetKeyAttr::ContentDesc)) h ^= contentDesc;
+            if (mask & static_cast<WidgetKeyMask>(WidgetKeyAttr::Index)) h ^= index;
+            return h;
+        }
+
+    }
+
+    uintptr_t Widget::combineKeyHashes(WidgetKeyMask mask, uintptr_t clazz, uintptr_t resourceID,
+                                       uintptr_t operateMask, uintptr_t scrollType, uintptr_t text,
+                                       uintptr_t contentDesc, uintptr_t index) {
         const auto defaultMask = static_cast<WidgetKeyMask>(DefaultWidgetKeyMask);
-        if ((mask & defaultMask) == defaultMask) {
-            h = ((_hashClazz ^ (_hashResourceID << 4)) >> 2) ^
-                (((127U * _hashOperateMask << 1) ^ (256U * _hashScrollType << 3)) >> 1);
-        } else {
-            h = 0x1;
-            if (mask & static_cast<WidgetKeyMask>(WidgetKeyAttr::Clazz)) h ^= _hashClazz;
-            if (mask & static_cast<WidgetKeyMask>(WidgetKeyAttr::ResourceID)) h ^= (_hashResourceID << 4);
-            if (mask & static_cast<WidgetKeyMask>(WidgetKeyAttr::OperateMask)) h ^= (127U * _hashOperateMask << 1);
-            if (mask & static_cast<WidgetKeyMask>(WidgetKeyAttr::ScrollType)) h ^= (256U * _hashScrollType << 3);
+        uintptr_t defaultBase = (mask & defaultMask) == defaultMask
+                                ? defaultBaseTerm(clazz, resourceID, operateMask, scrollType) : 0;
+        return combineTerms(mask, defaultBase, 0x1, clazz, resourceIDTerm(resourceID),
+                            operateMaskTerm(operateMask), scrollTypeTerm(scrollType), text, contentDesc, index);
+    }
+
+    void WidgetKeyHashAggregate::add(const Widget &widget) {
+        this->clazz ^= widget._hashClazz;
+        this->resourceID ^= resourceIDTerm(widget._hashResourceID);
+        this->operateMask ^= operateMaskTerm(widget._hashOperateMask);
+        this->scrollType ^= scrollTypeTerm(widget._hashScrollType);
+        this->text ^= widget._hashText;
+        this->contentDesc ^= widget._hashContentDesc;
+        this->index ^= widget._hashIndex;
+        this->defaultBase ^= defaultBaseTerm(widget._hashClazz, widget._hashResourceID,
+                                             widget._hashOperateMask, widget._hashScrollType);
+        this->odd = !this->odd;
+    }
+
+    uintptr_t WidgetKeyHashAggregate::hashWithMask(WidgetKeyMask mask) const {
+        return combineTerms(mask, this->defaultBase, this->odd ? 0x1 : 0, this->clazz, this->resourceID,
+                            this->operateMask, this->scrollType, this->text, this->contentDesc, this->index);
+    }
+
+    /**
+     * @brief hashWithMask() of the Widget that would be built from element, without building it
+     *
+     * Derives each component exactly as the constructor does (same operate mask,
+     * action presence, text normalization and hash formulas), but only computes the
+     * components selected by mask.
+     */
+    uintptr_t Widget::hashWithMaskFromElement(const ElementPtr &element, WidgetKeyMask mask,
+                                              bool useTextModel) {
+        return useTextModel ? hashWithMaskFromElement<true>(element, mask)
+                            : hashWithMaskFromElement<false>(element, mask);
+    }
+
+    template<bool UseTextModel>
+    uintptr_t Widget::hashWithMaskFromElement(const ElementPtr &element, WidgetKeyMask mask) {
+        int operateMask = operateMaskOf(*element);
+        ScrollType scrollType = element->getScrollType();
+        // Class and resource-id are only kept for widgets with actions (see initFormElement)
+        bool hasAction = operateOrScrollHasAction(operateMask, scrollType);
+        uintptr_t clazz = hasAction ? element->getInternedClassname().hash() : 0;
+        uintptr_t resourceID = hasAction ? element->getInternedResourceID().hash() : 0;
+        uintptr_t text = 0;
+        if ((mask & static_cast<WidgetKeyMask>(WidgetKeyAttr::Text)) && !element->getText().empty()) {
+            const Element::FusedHashes *fused = fusedTextHashes(*element, UseTextModel);
+            if (fused) {
+                text = textKeyFromHash(fused->strippedTextSize, fused->strippedText);
+            } else {
+                const ElementString &rawText = element->getText();
+                std::string normalized;
+                bool overMaxLen = false;
+                uintptr_t strippedHash = 0;
+                size_t length = normalizeWidgetText(rawText.data(), rawText.size(), UseTextModel, normalized,
+                                                    overMaxLen, &strippedHash);
+                text = textKeyFromHash(length, strippedHash);
+            }
         }
-        if (mask & static_cast<WidgetKeyMask>(WidgetKeyAttr::Text)) h ^= _hashText;
-        if (mask & static_cast<WidgetKeyMask>(WidgetKeyAttr::ContentDesc)) h ^= _hashContentDesc;
-        if (mask & static_cast<WidgetKeyMask>(WidgetKeyAttr::Index)) h ^= _hashIndex;
-        return h;
+        uintptr_t contentDesc = 0;
+        if (mask & static_cast<WidgetKeyMask>(WidgetKeyAttr::ContentDesc)) {
+            const ElementString &desc = element->getContentDesc();
+            const Element::FusedHashes *fused = element->getFusedHashes();
+            contentDesc = fused ? textKeyFromHash(desc.size(), fused->contentDesc)
+                                : textKeyHash(desc.data(), desc.size());
+        }
+        return combineKeyHashes(mask, clazz, resourceID, std::hash<int>{}(operateMask),
+                                std::hash<int>{}(scrollType), text, contentDesc,
+                                indexKeyHash(element->getIndex()));
     }
 
+    template uintptr_t Widget::hashWithMaskFromElement<false>(const ElementPtr &, WidgetKeyMask);
+    template uintptr_t Widget::hashWithMaskFromElement<true>(const ElementPtr &, WidgetKeyMask);
+
 }
 
 #endif //Widget_CPP_
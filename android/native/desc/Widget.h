@@ -17,6 +17,38 @@
 
 namespace fastbotx {
 
+    /**
+     * @brief State abstraction options that change how widgets and states hash
+     *
+     * The build-time defaults STATE_WITH_TEXT, STATE_WITH_INDEX and STATE_WITH_WIDGET_ORDER,
+     * each or'ed with its max.config switch. Read once per state: the widgets of the state
+     * are then built under the matching WidgetHashPolicy.
+     */
+    struct StateAbstractionOptions {
+        bool useTextModel{false};
+        bool withIndex{false};
+        bool withWidgetOrder{false};
+
+        static StateAbstractionOptions current();
+
+        /// Whether widgets built under either options hash alike (widget order only affects states)
+        bool sameWidgetHashing(const StateAbstractionOptions &other) const {
+            return this->useTextModel == other.useTextModel && this->withIndex == other.withIndex;
+        }
+    };
+
+    /**
+     * @brief Widget hashing options fixed at compile time
+     *
+     * The Widget constructor is instantiated once per combination (Widget.cpp), so
+     * building a widget tests neither the preferences nor these options.
+     */
+    template<bool UseTextModel, bool WithIndex>
+    struct WidgetHashPolicy {
+        static constexpr bool useTextModel = UseTextModel;
+        static constexpr bool withIndex = WithIndex;
+    };
+
     /**
      * @brief Widget class representing an actionable UI widget
      * 
@@ -46,12 +78,17 @@ namespace fastbotx {
          */
         Widget(std::shared_ptr<Widget> parent, const ElementPtr &element);
 
+        /// Constructor under the options of Policy (a WidgetHashPolicy), for builders that
+        /// read StateAbstractionOptions once per state
+        template<class Policy>
+        Widget(std::shared_ptr<Widget> parent, const ElementPtr &element, Policy policy);
+
         std::shared_ptr<Widget> getParent() const { return this->_parent; }
 
-        std::shared_ptr<Rect> getBounds() const { return this->_bounds; }
+        const Rect &getBounds() const { return this->_bounds; }
 
-        /// Returns const reference to avoid copying the set on every call (performance).
-        const std::set<ActionType> &getActions() const { return this->_actions; }
+        /// Action types supported by this widget (a 32-bit mask, cheap to copy)
+        ActionTypeSet getActions() const { return this->_actions; }
 
         std::string getText() const { return this->_text; }
 
@@ -63,21 +100,47 @@ namespace fastbotx {
 
         bool isEditable() const;
 
-        uintptr_t hash() const override;
+        /// Identity of the widget (RichWidget stores its own embedding in _hashcode).
+        /// Final, so calls through Widget and RichWidget are inlined loads
+        uintptr_t hash() const final { return this->_hashcode; }
 
         /// Hash using only the attributes specified by mask (for dynamic state abstraction).
         virtual uintptr_t hashWithMask(WidgetKeyMask mask) const;
 
+        /**
+         * @brief hashWithMask(mask) of the widget element would produce, computed without building it
+         * @param useTextModel StateAbstractionOptions::useTextModel, hoisted by the caller
+         */
+        static uintptr_t hashWithMaskFromElement(const ElementPtr &element, WidgetKeyMask mask,
+                                                 bool useTextModel);
+
+        /// hashWithMaskFromElement with the text model fixed at compile time (instantiated in Widget.cpp)
+        template<bool UseTextModel>
+        static uintptr_t hashWithMaskFromElement(const ElementPtr &element, WidgetKeyMask mask);
+
         std::string toString() const override;
 
-        std::string toJson() const;
+        /**
+         * @brief Compact JSON descriptor of the widget (bounds, class, content-desc, index, resource-id, text)
+         *
+         * Built on first use and kept until the details change or are cleared, so a widget
+         * chosen again does not serialize again. Empty once details are cleared.
+         * Not thread-safe: callers hold the graph write lock.
+         */
+        const std::string &toJson() const;
 
         std::string buildFullXpath() const;
 
         virtual void clearDetails();
 
+        /// Heap bytes owned by the widget beyond the object (text, content description, bounds)
+        size_t heapBytes() const;
+
         void fillDetails(const std::shared_ptr<Widget> &copy);
 
+        /// Copy of this widget attached to another parent (incremental state building)
+        virtual std::shared_ptr<Widget> cloneWithParent(std::shared_ptr<Widget> parent) const;
+
         virtual ~Widget();
 
 
@@ -88,6 +151,10 @@ namespace fastbotx {
 
         void initFormElement(const ElementPtr &element);
 
+        /// Text and index parts of the hash, after initFormElement
+        template<bool UseTextModel, bool WithIndex>
+        void initTextAndIndex(const ElementPtr &element);
+
         uintptr_t _hashcode{};
         /// Component hashes for hashWithMask (dynamic state abstraction)
         uintptr_t _hashClazz{};
@@ -100,23 +167,61 @@ namespace fastbotx {
         std::shared_ptr<Widget> _parent;
         std::string _text;
         int _index{};
-        std::string _clazz;
-        std::string _resourceID;
+        /// Interned: widgets of the same class/resource-id share one string and hash
+        InternedString _clazz;
+        InternedString _resourceID;
         bool _enabled{};
         bool _isEditable{};
         int _operateMask{OperateType::None};
     private:
         std::string toXPath() const;
 
-        RectPtr _bounds;
+        /// Single definition of how component hashes combine under a mask
+        static uintptr_t combineKeyHashes(WidgetKeyMask mask, uintptr_t clazz, uintptr_t resourceID,
+                                          uintptr_t operateMask, uintptr_t scrollType, uintptr_t text,
+                                          uintptr_t contentDesc, uintptr_t index);
+
+        Rect _bounds;
         std::string _contextDesc;
-        std::set<ActionType> _actions;
+        ActionTypeSet _actions;
+        /// Cache of toJson(), empty until first asked for
+        mutable std::string _descriptor;
+
+        friend struct WidgetKeyHashAggregate;
+    };
+
+    /**
+     * @brief XOR of every component term of Widget::hashWithMask over a set of widgets
+     *
+     * Under any mask a widget's hash XORs the terms the mask selects onto a base (0x1,
+     * or one non-linear term when the mask covers DefaultWidgetKeyMask), so the XOR of
+     * hashWithMask over the widgets is the XOR of per-term aggregates plus the base's
+     * parity. Filled once per state; the hash under any of the 128 masks is then O(1)
+     * and keeps working after the widgets dropped their details.
+     */
+    struct WidgetKeyHashAggregate {
+        uintptr_t clazz{};
+        uintptr_t resourceID{};
+        uintptr_t operateMask{};
+        uintptr_t scrollType{};
+        uintptr_t text{};
+        uintptr_t contentDesc{};
+        uintptr_t index{};
+        /// Base term of masks covering DefaultWidgetKeyMask
+        uintptr_t defaultBase{};
+        /// Whether an odd number of widgets was added (the 0x1 base of the other masks)
+        bool odd{false};
+
+        void add(const Widget &widget);
+
+        /// XOR of hashWithMask(mask) over the widgets added
+        uintptr_t hashWithMask(WidgetKeyMask mask) const;
     };
 
 
     typedef std::shared_ptr<Widget> WidgetPtr;
     typedef std::vector<WidgetPtr> WidgetPtrVec;
-    typedef std::set<WidgetPtr, Comparator<Widget>> WidgetPtrSet;
+    typedef std::set<WidgetPtr, HashComparator<Widget>> WidgetPtrSet;
     typedef std::map<uintptr_t, WidgetPtrVec> WidgetPtrVecMap;
 
 }
@@ -0,0 +1,104 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef WidgetText_CPP_
+#define WidgetText_CPP_
+
+#include "WidgetText.h"
+#include "../Base.h"
+#include "../utils.hpp"
+#include <cstring>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define FASTBOT_TEXT_NEON 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FASTBOT_TEXT_SSE2 1
+#endif
+
+namespace fastbotx {
+
+    namespace {
+        inline bool isDigitOrBlank(char c) {
+            return c == ' ' || (c >= '0' && c <= '9');
+        }
+
+        /// Whether any of the 16 bytes at data is a digit or a blank
+        inline bool blockHasDigitOrBlank(const char *data) {
+#if FASTBOT_TEXT_NEON
+            uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t *>(data));
+            uint8x16_t hits = vorrq_u8(vceqq_u8(v, vdupq_n_u8(' ')),
+                                       vcleq_u8(vsubq_u8(v, vdupq_n_u8('0')), vdupq_n_u8(9)));
+            uint64x2_t lanes = vreinterpretq_u64_u8(hits);
+            return (vgetq_lane_u64(lanes, 0) | vgetq_lane_u64(lanes, 1)) != 0;
+#elif FASTBOT_TEXT_SSE2
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+            // Unsigned v - '0' <= 9, as min(d, 9) == d
+            __m128i digits = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+            __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                                        _mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)), digits));
+            return _mm_movemask_epi8(hits) != 0;
+#else
+            for (int i = 0; i < 16; i++) {
+                if (isDigitOrBlank(data[i])) return true;
+            }
+            return false;
+#endif
+        }
+    }
+
+    size_t stripDigitsAndBlanks(const char *data, size_t size, char *out) {
+        size_t written = 0;
+        size_t i = 0;
+        for (; i + 16 <= size; i += 16) {
+            if (!blockHasDigitOrBlank(data + i)) {
+                std::memcpy(out + written, data + i, 16);
+                written += 16;
+                continue;
+            }
+            for (size_t j = i; j < i + 16; j++) {
+                out[written] = data[j];
+                written += isDigitOrBlank(data[j]) ? 0 : 1;
+            }
+        }
+        for (; i < size; i++) {
+            out[written] = data[i];
+            written += isDigitOrBlank(data[i]) ? 0 : 1;
+        }
+        return written;
+    }
+
+    size_t textModelCut(const char *text, size_t size) {
+        auto cut = static_cast<size_t>(STATE_TEXT_MAX_LEN);
+        if (size <= cut) {
+            return size;
+        }
+        // A continuation byte (10xxxxxx) at the cut belongs to the character before it
+        while (cut < size && (static_cast<unsigned char>(text[cut]) & 0xC0U) == 0x80U) {
+            cut++;
+        }
+        return cut;
+    }
+
+    size_t normalizeWidgetText(const char *data, size_t size, bool useTextModel, std::string &text,
+                               bool &overMaxLen, uintptr_t *hash) {
+        text.resize(size);
+        size_t length = stripDigitsAndBlanks(data, size, &text[0]);
+        overMaxLen = useTextModel && length > STATE_TEXT_MAX_LEN;
+        if (overMaxLen) {
+            length = textModelCut(text.data(), length);
+        }
+        text.resize(length);
+        if (hash) {
+            *hash = length == 0 ? 0 : fastStringHash(text.data(), length);
+        }
+        return length;
+    }
+
+}
+
+#endif //WidgetText_CPP_
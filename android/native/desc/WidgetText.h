@@ -0,0 +1,46 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef WidgetText_H_
+#define WidgetText_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace fastbotx {
+
+    /**
+     * @brief Copy data to out without its digits and blanks
+     *
+     * Runs free of both are copied 16 bytes at a time (NEON on ARM, SSE2 on x86,
+     * scalar otherwise). out has room for size bytes and may not overlap data.
+     * @return Bytes written
+     */
+    size_t stripDigitsAndBlanks(const char *data, size_t size, char *out);
+
+    /**
+     * @brief Text-model cut of normalized text: STATE_TEXT_MAX_LEN bytes, moved forward
+     * to the next UTF-8 character boundary so that no character is split
+     * @return Bytes to keep, size if the text is short enough
+     */
+    size_t textModelCut(const char *text, size_t size);
+
+    /**
+     * @brief Widget text normalization in one pass: digits and blanks stripped, and in
+     * text-model mode the cut of textModelCut
+     *
+     * Writes into text, reusing its capacity (the widget's own storage, no temporary).
+     * @param overMaxLen Set if the text model cut the text
+     * @param hash If not null, receives fastStringHash of the normalized text (0 if empty)
+     * @return Size of the normalized text
+     */
+    size_t normalizeWidgetText(const char *data, size_t size, bool useTextModel, std::string &text,
+                               bool &overMaxLen, uintptr_t *hash = nullptr);
+
+}
+
+#endif //WidgetText_H_
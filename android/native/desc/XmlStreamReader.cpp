@@ -0,0 +1,303 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef XmlStreamReader_CPP_
+#define XmlStreamReader_CPP_
+
+#include "XmlStreamReader.h"
+#include <cstring>
+
+namespace fastbotx {
+
+    namespace {
+        inline bool isSpace(char c) {
+            return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+        }
+
+        inline bool endsName(char c) {
+            return isSpace(c) || c == '/' || c == '>' || c == '=';
+        }
+
+        /// Append code point cp as UTF-8
+        void appendUtf8(uint32_t cp, std::string &out) {
+            if (cp < 0x80) {
+                out.push_back(static_cast<char>(cp));
+            } else if (cp < 0x800) {
+                out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+                out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+            } else if (cp < 0x10000) {
+                out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+                out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+                out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+            } else {
+                out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+                out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+                out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+                out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+            }
+        }
+
+        /// Character reference at p ("#123;" or "#x1F;" after '&'); advances p past ';'
+        bool decodeCharReference(const char *&p, const char *end, std::string &out) {
+            const char *q = p + 1;
+            bool hex = q < end && (*q == 'x' || *q == 'X');
+            if (hex) {
+                q++;
+            }
+            uint32_t cp = 0;
+            const char *digits = q;
+            for (; q < end && *q != ';'; q++) {
+                char c = *q;
+                uint32_t digit;
+                if (c >= '0' && c <= '9') {
+                    digit = static_cast<uint32_t>(c - '0');
+                } else if (hex && c >= 'a' && c <= 'f') {
+                    digit = static_cast<uint32_t>(c - 'a' + 10);
+                } else if (hex && c >= 'A' && c <= 'F') {
+                    digit = static_cast<uint32_t>(c - 'A' + 10);
+                } else {
+                    return false;
+                }
+                cp = cp * (hex ? 16 : 10) + digit;
+                if (cp > 0x10FFFF) {
+                    return false;
+                }
+            }
+            if (q == end || q == digits) {
+                return false;
+            }
+            appendUtf8(cp, out);
+            p = q + 1;
+            return true;
+        }
+    }
+
+    bool XmlStreamReader::Attribute::nameIs(const char *literal, size_t literalSize) const {
+        return this->nameSize == literalSize && 0 == std::memcmp(this->name, literal, literalSize);
+    }
+
+    XmlStreamReader::XmlStreamReader(const char *data, size_t size)
+            : _begin(data), _cursor(data), _end(data + size) {
+        this->_openElements.reserve(64);
+        this->_attributes.reserve(24);
+    }
+
+    void XmlStreamReader::decode(const char *value, size_t size, std::string &out) {
+        static const struct {
+            const char *name;
+            size_t size;
+            char value;
+        } Entities[] = {{"quot;", 5, '"'}, {"amp;", 4, '&'}, {"apos;", 5, '\''},
+                        {"lt;", 3, '<'}, {"gt;", 3, '>'}};
+        out.clear();
+        out.reserve(size);
+        const char *p = value;
+        const char *end = value + size;
+        while (p < end) {
+            char c = *p;
+            if (c == '\r') {
+                // "\r\n" and a lone "\r" both become "\n"
+                out.push_back('\n');
+                p += (p + 1 < end && p[1] == '\n') ? 2 : 1;
+                continue;
+            }
+            if (c == '&' && p + 1 < end) {
+                const char *reference = p + 1;
+                if (*reference == '#') {
+                    if (decodeCharReference(reference, end, out)) {
+                        p = reference;
+                        continue;
+                    }
+                } else {
+                    bool matched = false;
+                    for (const auto &entity: Entities) {
+                        if (static_cast<size_t>(end - reference) >= entity.size &&
+                            0 == std::memcmp(reference, entity.name, entity.size)) {
+                            out.push_back(entity.value);
+                            p = reference + entity.size;
+                            matched = true;
+                            break;
+                        }
+                    }
+                    if (matched) {
+                        continue;
+                    }
+                }
+            }
+            // Unknown entities are kept as written
+            out.push_back(c);
+            p++;
+        }
+    }
+
+    bool XmlStreamReader::skipPast(const char *terminator, size_t terminatorSize) {
+        while (this->_cursor < this->_end) {
+            const void *found = std::memchr(this->_cursor, terminator[0],
+                                            static_cast<size_t>(this->_end - this->_cursor));
+            if (nullptr == found) {
+                break;
+            }
+            const char *p = static_cast<const char *>(found);
+            if (static_cast<size_t>(this->_end - p) >= terminatorSize &&
+                0 == std::memcmp(p, terminator, terminatorSize)) {
+                this->_cursor = p + terminatorSize;
+                return true;
+            }
+            this->_cursor = p + 1;
+        }
+        this->_cursor = this->_end;
+        return false;
+    }
+
+    /// "<!DOCTYPE ...>" and similar, including an internal subset in brackets
+    bool XmlStreamReader::skipDeclaration() {
+        int brackets = 0;
+        for (; this->_cursor < this->_end; this->_cursor++) {
+            char c = *this->_cursor;
+            if (c == '[') {
+                brackets++;
+            } else if (c == ']') {
+                brackets--;
+            } else if (c == '>' && brackets <= 0) {
+                this->_cursor++;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    XmlStreamReader::Event XmlStreamReader::next() {
+        if (this->_pendingEnd) {
+            this->_pendingEnd = false;
+            this->_openElements.pop_back();
+            this->_rootClosed = this->_openElements.empty();
+            return Event::EndElement;
+        }
+        while (true) {
+            if (this->_rootClosed) {
+                // Anything after the root element is not part of the tree
+                return Event::EndOfDocument;
+            }
+            // Character data between tags is not used
+            const void *found = std::memchr(this->_cursor, '<', static_cast<size_t>(this->_end - this->_cursor));
+            if (nullptr == found) {
+                this->_cursor = this->_end;
+                return Event::Error;
+            }
+            this->_cursor = static_cast<const char *>(found) + 1;
+            size_t remaining = static_cast<size_t>(this->_end - this->_cursor);
+            if (remaining == 0) {
+                return Event::Error;
+            }
+            char c = *this->_cursor;
+            if (c == '?') {
+                if (!this->skipPast("?>", 2)) return Event::Error;
+            } else if (c == '!') {
+                if (remaining >= 3 && 0 == std::memcmp(this->_cursor, "!--", 3)) {
+                    if (!this->skipPast("-->", 3)) return Event::Error;
+                } else if (remaining >= 8 && 0 == std::memcmp(this->_cursor, "![CDATA[", 8)) {
+                    if (!this->skipPast("]]>", 3)) return Event::Error;
+                } else if (!this->skipDeclaration()) {
+                    return Event::Error;
+                }
+            } else if (c == '/') {
+                return this->readEndTag();
+            } else {
+                return this->readStartTag();
+            }
+        }
+    }
+
+    XmlStreamReader::Event XmlStreamReader::readEndTag() {
+        const char *name = ++this->_cursor;
+        while (this->_cursor < this->_end && !endsName(*this->_cursor)) {
+            this->_cursor++;
+        }
+        size_t nameSize = static_cast<size_t>(this->_cursor - name);
+        while (this->_cursor < this->_end && isSpace(*this->_cursor)) {
+            this->_cursor++;
+        }
+        if (this->_cursor == this->_end || *this->_cursor != '>' || this->_openElements.empty()) {
+            return Event::Error;
+        }
+        this->_cursor++;
+        const Name &open = this->_openElements.back();
+        if (open.size != nameSize || 0 != std::memcmp(open.data, name, nameSize)) {
+            return Event::Error;
+        }
+        this->_openElements.pop_back();
+        this->_rootClosed = this->_openElements.empty();
+        return Event::EndElement;
+    }
+
+    XmlStreamReader::Event XmlStreamReader::readStartTag() {
+        const char *name = this->_cursor;
+        while (this->_cursor < this->_end && !endsName(*this->_cursor)) {
+            this->_cursor++;
+        }
+        size_t nameSize = static_cast<size_t>(this->_cursor - name);
+        if (0 == nameSize) {
+            return Event::Error;
+        }
+        this->_attributes.clear();
+        while (true) {
+            while (this->_cursor < this->_end && isSpace(*this->_cursor)) {
+                this->_cursor++;
+            }
+            if (this->_cursor == this->_end) {
+                return Event::Error;
+            }
+            char c = *this->_cursor;
+            if (c == '>') {
+                this->_cursor++;
+                break;
+            }
+            if (c == '/') {
+                if (this->_cursor + 1 == this->_end || this->_cursor[1] != '>') {
+                    return Event::Error;
+                }
+                this->_cursor += 2;
+                this->_pendingEnd = true;
+                break;
+            }
+            Attribute attribute{};
+            attribute.name = this->_cursor;
+            while (this->_cursor < this->_end && !endsName(*this->_cursor)) {
+                this->_cursor++;
+            }
+            attribute.nameSize = static_cast<uint32_t>(this->_cursor - attribute.name);
+            while (this->_cursor < this->_end && isSpace(*this->_cursor)) {
+                this->_cursor++;
+            }
+            if (0 == attribute.nameSize || this->_cursor == this->_end || *this->_cursor != '=') {
+                return Event::Error;
+            }
+            this->_cursor++;
+            while (this->_cursor < this->_end && isSpace(*this->_cursor)) {
+                this->_cursor++;
+            }
+            if (this->_cursor == this->_end || (*this->_cursor != '"' && *this->_cursor != '\'')) {
+                return Event::Error;
+            }
+            char quote = *this->_cursor++;
+            const void *closing = std::memchr(this->_cursor, quote, static_cast<size_t>(this->_end - this->_cursor));
+            if (nullptr == closing) {
+                return Event::Error;
+            }
+            attribute.value = this->_cursor;
+            attribute.valueSize = static_cast<uint32_t>(static_cast<const char *>(closing) - this->_cursor);
+            attribute.needsDecode = nullptr != std::memchr(attribute.value, '&', attribute.valueSize) ||
+                                    nullptr != std::memchr(attribute.value, '\r', attribute.valueSize);
+            this->_cursor = static_cast<const char *>(closing) + 1;
+            this->_attributes.push_back(attribute);
+        }
+        this->_openElements.push_back({name, nameSize});
+        return Event::StartElement;
+    }
+
+}
+
+#endif //XmlStreamReader_CPP_
@@ -0,0 +1,87 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef XmlStreamReader_H_
+#define XmlStreamReader_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace fastbotx {
+
+    /**
+     * @brief Pull parser over an XML buffer, without building a DOM
+     *
+     * Reports the start and end of every element of the document's root element;
+     * attribute names and values are views into the buffer (valid while it is).
+     * Prolog, comments, DOCTYPE, CDATA and character data are skipped, which is all
+     * Element needs from a GUI tree dump. Values are raw: call decode() for those
+     * with needsDecode set (entities or carriage returns, as tinyxml2 would process).
+     *
+     * A self-closing element is reported as StartElement then EndElement. Mismatched
+     * or unclosed tags end the stream with Error.
+     */
+    class XmlStreamReader {
+    public:
+        enum class Event {
+            StartElement,
+            EndElement,
+            EndOfDocument,
+            Error
+        };
+
+        struct Attribute {
+            const char *name;
+            uint32_t nameSize;
+            const char *value;
+            uint32_t valueSize;
+            bool needsDecode;
+
+            bool nameIs(const char *literal, size_t literalSize) const;
+        };
+
+        XmlStreamReader(const char *data, size_t size);
+
+        Event next();
+
+        /// Attributes of the element reported by the last StartElement
+        const std::vector<Attribute> &attributes() const { return this->_attributes; }
+
+        /// Offset of the parse position, for error logs
+        size_t offset() const { return static_cast<size_t>(this->_cursor - this->_begin); }
+
+        /// Expand entities and normalize newlines of a raw attribute value into out
+        static void decode(const char *value, size_t size, std::string &out);
+
+    private:
+        struct Name {
+            const char *data;
+            size_t size;
+        };
+
+        bool skipPast(const char *terminator, size_t terminatorSize);
+
+        bool skipDeclaration();
+
+        Event readEndTag();
+
+        Event readStartTag();
+
+        const char *_begin;
+        const char *_cursor;
+        const char *_end;
+        std::vector<Name> _openElements;
+        std::vector<Attribute> _attributes;
+        /// The last StartElement was self-closing; the next event is its EndElement
+        bool _pendingEnd{false};
+        bool _rootClosed{false};
+    };
+
+}
+
+#endif //XmlStreamReader_H_
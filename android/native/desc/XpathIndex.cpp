@@ -0,0 +1,91 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef XpathIndex_CPP_
+#define XpathIndex_CPP_
+
+#include "XpathIndex.h"
+#include <algorithm>
+
+namespace fastbotx {
+
+    void XpathIndex::file(Field field, const std::string &value, uint32_t id) {
+        this->_buckets[field][fastStringHash(value.data(), value.size())].push_back(id);
+    }
+
+    void XpathIndex::add(const XpathPtr &xpath) {
+        auto id = static_cast<uint32_t>(this->_rules.size());
+        this->_rules.push_back(xpath);
+        if (!xpath) {
+            return;
+        }
+        if (xpath->operationAND) {
+            // Any one required field rules out every node without it; prefer the selective ones
+            if (!xpath->resourceID.empty()) {
+                this->file(ResourceIdField, xpath->resourceID, id);
+            } else if (!xpath->contentDescription.empty()) {
+                this->file(ContentDescField, xpath->contentDescription, id);
+            } else if (!xpath->text.empty()) {
+                this->file(TextField, xpath->text, id);
+            } else if (!xpath->clazz.empty()) {
+                this->file(ClassField, xpath->clazz, id);
+            } else {
+                this->_unkeyed.push_back(id);
+            }
+            return;
+        }
+        if (!xpath->resourceID.empty()) {
+            this->file(ResourceIdField, xpath->resourceID, id);
+        }
+        if (!xpath->contentDescription.empty()) {
+            this->file(ContentDescField, xpath->contentDescription, id);
+        }
+        if (!xpath->text.empty()) {
+            this->file(TextField, xpath->text, id);
+        }
+        if (!xpath->clazz.empty()) {
+            this->file(ClassField, xpath->clazz, id);
+        }
+    }
+
+    void XpathIndex::clear() {
+        for (auto &buckets: this->_buckets) {
+            buckets.clear();
+        }
+        this->_unkeyed.clear();
+        this->_rules.clear();
+    }
+
+    void XpathIndex::match(const Element &element, std::vector<uint32_t> &ruleIds, uint32_t firstId) const {
+        ruleIds.clear();
+        const ElementString *values[FieldCount] = {
+                &element.getResourceID(), &element.getContentDesc(), &element.getText(), &element.getClassname()
+        };
+        for (int field = 0; field < FieldCount; field++) {
+            // Empty fields never satisfy a rule, and fields no rule mentions are not hashed
+            if (this->_buckets[field].empty() || values[field]->empty()) {
+                continue;
+            }
+            auto bucket = this->_buckets[field].find(values[field]->hash());
+            if (bucket != this->_buckets[field].end()) {
+                ruleIds.insert(ruleIds.end(), bucket->second.begin(), bucket->second.end());
+            }
+        }
+        ruleIds.insert(ruleIds.end(), this->_unkeyed.begin(), this->_unkeyed.end());
+        if (ruleIds.empty()) {
+            return;
+        }
+        // Rules apply in file order; an OR rule may have come from more than one bucket
+        std::sort(ruleIds.begin(), ruleIds.end());
+        ruleIds.erase(std::unique(ruleIds.begin(), ruleIds.end()), ruleIds.end());
+        ruleIds.erase(std::remove_if(ruleIds.begin(), ruleIds.end(), [&](uint32_t id) {
+            return id < firstId || !element.matchXpathSelector(this->_rules[id]);
+        }), ruleIds.end());
+    }
+
+}
+
+#endif //XpathIndex_CPP_
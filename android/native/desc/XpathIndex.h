@@ -0,0 +1,73 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef XpathIndex_H_
+#define XpathIndex_H_
+
+#include "Element.h"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace fastbotx {
+
+    /**
+     * @brief Xpath rules compiled into hash buckets, so a node only tests rules it could match
+     *
+     * Element::matchXpathSelector compares up to four strings per rule; running every
+     * rule against every node is O(rules x nodes) string compares per page. Here each
+     * rule is filed under the hash of the fields a match requires:
+     * - AND rules under one required field (resource-id, content-desc, text, then class);
+     * - OR rules under each of their fields, since any of them matching is enough.
+     * A node hashes its own fields once, collects the rules in those buckets and
+     * confirms them with matchXpathSelector (hash collisions never produce a match).
+     * AND rules without string fields are tested on every node; OR rules without
+     * string fields never match and are not filed at all.
+     */
+    class XpathIndex {
+    public:
+        /// Append a rule; its id is the number of rules added before it (null rules never match)
+        void add(const XpathPtr &xpath);
+
+        void clear();
+
+        size_t size() const { return this->_rules.size(); }
+
+        bool empty() const { return this->_rules.empty(); }
+
+        const XpathPtr &rule(uint32_t id) const { return this->_rules[id]; }
+
+        /**
+         * @brief Rules the element matches
+         *
+         * @param element Node to test, with its current field values
+         * @param ruleIds Out: ids of the matching rules in ascending order (cleared first)
+         * @param firstId Only report rules with id >= firstId
+         */
+        void match(const Element &element, std::vector<uint32_t> &ruleIds, uint32_t firstId = 0) const;
+
+    private:
+        enum Field {
+            ResourceIdField = 0,
+            ContentDescField,
+            TextField,
+            ClassField,
+            FieldCount
+        };
+
+        typedef std::unordered_map<uintptr_t, std::vector<uint32_t>> Buckets;
+
+        void file(Field field, const std::string &value, uint32_t id);
+
+        Buckets _buckets[FieldCount];
+        /// AND rules without string fields (index only, or nothing): candidates on every node
+        std::vector<uint32_t> _unkeyed;
+        std::vector<XpathPtr> _rules;
+    };
+
+}
+
+#endif //XpathIndex_H_
@@ -36,10 +36,15 @@ namespace fastbotx {
      */
     ActivityNameAction::ActivityNameAction(stringPtr activity, const WidgetPtr &widget,
                                            ActionType act)
-            : ActivityStateAction(nullptr, widget, act), _activity(std::move(activity)) {
+            : ActivityNameAction(InternedString::intern(activity ? *activity : std::string()), widget, act) {
+    }
+
+    ActivityNameAction::ActivityNameAction(const InternedString &activity, const WidgetPtr &widget,
+                                           ActionType act)
+            : ActivityStateAction(nullptr, widget, act), _activity(activity.ptr()) {
         // Compute hash components
-        // Performance optimization: Use fast string hash instead of std::hash
-        uintptr_t activityHashCode = fastbotx::fastStringHash(*(_activity.get()));
+        // Performance optimization: activity hash is precomputed by the intern table
+        uintptr_t activityHashCode = activity.hash();
         uintptr_t actionHashCode = std::hash<int>{}(static_cast<int>(this->getActionType()));
         uintptr_t targetHash = (widget != nullptr) ? widget->hash() : 0x1;
 
@@ -32,6 +32,18 @@ namespace fastbotx {
          */
         ActivityNameAction(stringPtr activity, const WidgetPtr &widget, ActionType act);
 
+        /**
+         * @brief Constructor from an interned activity name
+         *
+         * Preferred when building many actions of one state: the activity hash is
+         * read from the intern table instead of rehashing the name per action.
+         *
+         * @param activity Interned activity name
+         * @param widget Target widget (nullptr for actions without targets)
+         * @param act Action type
+         */
+        ActivityNameAction(const InternedString &activity, const WidgetPtr &widget, ActionType act);
+
         /**
          * @brief Get the activity name
          * 
@@ -53,7 +65,7 @@ namespace fastbotx {
 
     typedef std::shared_ptr<ActivityNameAction> ActivityNameActionPtr;
     typedef std::vector<ActivityNameActionPtr> ActivityNameActionPtrVec;
-    typedef std::set<ActivityNameActionPtr, Comparator<ActivityNameAction>> ActivityNameActionPtrSet;
+    typedef std::set<ActivityNameActionPtr, HashComparator<ActivityNameAction>> ActivityNameActionPtrSet;
 
 }
 
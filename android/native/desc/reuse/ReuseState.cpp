@@ -9,13 +9,20 @@
 
 #include "ReuseState.h"
 
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <thread>
 #include <utility>
 #include <unordered_map>
 #include <unordered_set>
 #include "RichWidget.h"
 #include "ActivityNameAction.h"
 #include "../utils.hpp"
+#include "../../Trace.h"
 #include "ActionFilter.h"
+#include "Preference.h"
+#include "StepExecutor.h"
 
 namespace fastbotx {
 
@@ -33,30 +40,16 @@ namespace fastbotx {
      * @brief Build bounding box for root element
      * 
      * Sets the root bounds for this state. If the element is the root (no parent)
-     * and has valid bounds, stores them. Uses shared root bounds if available.
-     * 
-     * Performance optimization:
-     * - Checks bounds validity before accessing
-     * - Avoids multiple getBounds() calls
+     * and has valid bounds, stores them.
      * 
      * @param element Element to get bounds from
      */
     void ReuseState::buildBoundingBox(const ElementPtr &element) {
         // Check if this is the root element (no parent)
         if (element->getParent().expired()) {
-            RectPtr bounds = element->getBounds();
-            // Check bounds validity before using
-            if (bounds != nullptr && !bounds->isEmpty()) {
-                // Initialize shared root bounds if empty
-                if (_sameRootBounds->isEmpty() && element) {
-                    _sameRootBounds = bounds;
-                }
-                // Use shared bounds if they match, otherwise use element's bounds
-                if (equals(_sameRootBounds, bounds)) {
-                    this->_rootBounds = _sameRootBounds;
-                } else {
-                    this->_rootBounds = bounds;
-                }
+            const Rect &bounds = element->getBounds();
+            if (!bounds.isEmpty()) {
+                this->_rootBounds = bounds;
             }
         }
     }
@@ -107,22 +100,537 @@ namespace fastbotx {
      * 
      * @param element Root Element of the UI hierarchy (XML of this page)
      * @param activityName Activity name string pointer
+     * @param materializeActions If false, step 4 is deferred to materializeActions()
+     * @param executor Workers that may help build a large tree in step 1, or nullptr
      * @return Shared pointer to newly created ReuseState
      */
     ReuseStatePtr ReuseState::create(const ElementPtr &element, const stringPtr &activityName,
-                                     WidgetKeyMask mask) {
+                                     WidgetKeyMask mask, bool materializeActions, StepExecutor *executor) {
         // Use new + shared_ptr instead of make_shared because constructor is protected
         ReuseStatePtr statePointer = std::shared_ptr<ReuseState>(new ReuseState(activityName));
         statePointer->_widgetKeyMask = mask;
-        statePointer->buildState(element);
+        statePointer->buildState(element, executor);
+        if (materializeActions) {
+            statePointer->materializeActions();
+        }
         return statePointer;
     }
 
-    void ReuseState::buildState(const ElementPtr &element) {
-        buildStateFromElement(nullptr, element);
+    /**
+     * @brief Build widgets, merge groups, columns and hash of this state
+     *
+     * The abstraction options are read once here and select the WidgetHashPolicy the
+     * widget tree is built under, so the per-widget loop tests no configuration.
+     */
+    void ReuseState::buildState(const ElementPtr &element, StepExecutor *executor) {
+        FASTBOT_TRACE_FUNCTION();
+        StateAbstractionOptions options = StateAbstractionOptions::current();
+        if (options.useTextModel) {
+            if (options.withIndex) {
+                buildWidgets<WidgetHashPolicy<true, true>>(element, executor);
+            } else {
+                buildWidgets<WidgetHashPolicy<true, false>>(element, executor);
+            }
+        } else if (options.withIndex) {
+            buildWidgets<WidgetHashPolicy<false, true>>(element, executor);
+        } else {
+            buildWidgets<WidgetHashPolicy<false, false>>(element, executor);
+        }
         mergeWidgetsInState();
+        // Columns first: buildHashForState may reduce over their hashes
+        buildWidgetColumns();
         buildHashForState();
+    }
+
+    template<class Policy>
+    void ReuseState::buildWidgets(const ElementPtr &element, StepExecutor *executor) {
+#if FASTBOT_PARALLEL_STATE_BUILD
+        // With one core the workers only take turns with this thread
+        static const bool multiCore = std::thread::hardware_concurrency() > 1;
+        if (multiCore && executor && executor->threadCount() > 0 && element) {
+            // Sizes are cached with the subtree signatures the incremental build needs anyway
+            if (element->subtreeSize() >= FASTBOT_PARALLEL_STATE_BUILD) {
+                buildWidgetsInParallel<Policy>(element, *executor);
+                return;
+            }
+        }
+#else
+        (void) executor;
+#endif
+#if FASTBOT_INCREMENTAL_STATE_BUILD
+        buildStateIncrementally<Policy>(element);
+#else
+        buildWidgetsFromElement<Policy>(nullptr, element, true, this->_widgets);
+#endif
+    }
+
+    template<class Policy>
+    void ReuseState::buildWidgetsFromElement(const WidgetPtr &parentWidget, const ElementPtr &elem, bool isRoot,
+                                             WidgetPtrVec &widgets) {
+        buildBoundingBox(elem);
+        WidgetPtr widget;
+        if (isRoot) {
+            widget = std::make_shared<RichWidget>(parentWidget, elem, Policy());
+        } else {
+            widget = std::make_shared<Widget>(parentWidget, elem, Policy());
+        }
+        widgets.emplace_back(widget);
+        for (const auto &childElement: elem->getChildren()) {
+            buildWidgetsFromElement<Policy>(widget, childElement, false, widgets);
+        }
+    }
+
+    void ReuseState::materializeActions() {
+        if (this->_actionsBuilt) {
+            return;
+        }
         buildActionForState();
+        this->_actionsBuilt = true;
+    }
+
+    ReuseStatePtr ReuseState::createCold(const stringPtr &activityName, ColdStateRecord record) {
+        ReuseStatePtr statePointer = std::shared_ptr<ReuseState>(new ReuseState(activityName));
+        statePointer->_hashcode = record.hash;
+        statePointer->setVisitedCount(record.visitedCount);
+        statePointer->_widgetKeyMask = record.mask;
+#if DYNAMIC_STATE_ABSTRACTION_ENABLED
+        statePointer->_activityKeyHash = record.activityKeyHash;
+        statePointer->_widgetKeyHashes = record.widgetKeyHashes;
+#endif
+        statePointer->_coldActions = std::move(record.actions);
+        statePointer->_hasNoDetail = true;
+        statePointer->_compacted = true;
+        return statePointer;
+    }
+
+    ColdStateRecord ReuseState::toColdRecord() const {
+        ColdStateRecord record = State::toColdRecord();
+        record.mask = this->_widgetKeyMask;
+#if DYNAMIC_STATE_ABSTRACTION_ENABLED
+        record.activityKeyHash = this->_activityKeyHash;
+        record.widgetKeyHashes = this->_widgetKeyHashes;
+#endif
+        return record;
+    }
+
+    void ReuseState::compact() {
+        State::compact();
+        if (this->_compacted) {
+            // fillDetails rebuilds the actions through materializeActions
+            this->_actionsBuilt = false;
+        }
+    }
+
+    /**
+     * @brief Compute the state hash straight from the Element tree
+     *
+     * Mirrors buildHashForState: mergeWidgetsInState keeps one widget per distinct
+     * hashWithMask value, and the state hash XORs those distinct values. Here each
+     * node's value comes from Widget::hashWithMaskFromElement, so a revisit can be
+     * recognised before any Widget is allocated.
+     */
+#if DYNAMIC_STATE_ABSTRACTION_ENABLED
+    namespace {
+        /// XOR of the distinct Widget::hashWithMaskFromElement values of the tree, with the base 0x1
+        template<bool UseTextModel>
+        uintptr_t distinctWidgetsHash(const ElementPtr &element, WidgetKeyMask mask) {
+            std::unordered_set<uintptr_t> distinct;
+            uintptr_t widgetsHash = 0x1;
+            std::vector<Element *> stack;
+            stack.reserve(64);
+            stack.push_back(element.get());
+            while (!stack.empty()) {
+                Element *node = stack.back();
+                stack.pop_back();
+                uintptr_t h = Widget::hashWithMaskFromElement<UseTextModel>(node->shared_from_this(), mask);
+                if (distinct.insert(h).second) {
+                    widgetsHash ^= h;
+                }
+                for (const auto &child: node->getChildren()) {
+                    stack.push_back(child.get());
+                }
+            }
+            return widgetsHash;
+        }
+    }
+#endif
+
+    uintptr_t ReuseState::computeHash(const ElementPtr &element, const stringPtr &activityName,
+                                      WidgetKeyMask mask) {
+#if DYNAMIC_STATE_ABSTRACTION_ENABLED
+        if (nullptr == element) {
+            return 0;
+        }
+        const std::string &activityString = (activityName && activityName.get()) ? *activityName : std::string();
+        uintptr_t activityHash = (fastbotx::fastStringHash(activityString) * 31U) << 5;
+        uintptr_t widgetsHash = StateAbstractionOptions::current().useTextModel
+                                ? distinctWidgetsHash<true>(element, mask)
+                                : distinctWidgetsHash<false>(element, mask);
+        return activityHash ^ (widgetsHash << 1);
+#else
+        (void) element;
+        (void) activityName;
+        (void) mask;
+        return 0;
+#endif
+    }
+
+    void ReuseState::BuildCache::clear() {
+        this->prototypes.clear();
+        this->parents.clear();
+        this->signatures.clear();
+        this->sizes.clear();
+        this->classes.clear();
+        this->resourceIDs.clear();
+        this->subtrees.clear();
+    }
+
+    void ReuseState::BuildCache::pushSlot(int parent, uint64_t signature, const ElementPtr &element) {
+        this->parents.push_back(parent);
+        this->signatures.push_back(signature);
+        this->sizes.push_back(1);
+        this->classes.push_back(element->getInternedClassname());
+        this->resourceIDs.push_back(element->getInternedResourceID());
+    }
+
+    ReuseState::BuildCache &ReuseState::lastBuild() {
+        thread_local BuildCache cache;
+        return cache;
+    }
+
+    /**
+     * @brief Build the widget tree, reusing Widgets of subtrees unchanged since the last step
+     *
+     * Consecutive GUI dumps usually differ in a few nodes (a text field, one list row).
+     * Each subtree is looked up by Element::subtreeSignature() in the previous step's
+     * cache; on a hit whose node count, class and resource-id also match (the signature
+     * is only a hash) its widgets are cloned from the cached prototypes (no text
+     * processing, class matching or hashing), otherwise the node is built from the
+     * Element and its children are tried one by one. An unchanged screen is a single
+     * hit at the root; a changed structure degrades to the full build.
+     *
+     * Produces exactly the _widgets sequence of buildStateFromElement(nullptr, element).
+     * Actions are still created per state in buildActionForState: each ActivityNameAction
+     * carries its own visit/Q bookkeeping and targets this state's widgets.
+     *
+     * @param element Root Element of the UI hierarchy
+     */
+    template<class Policy>
+    void ReuseState::buildStateIncrementally(const ElementPtr &element) {
+        BuildCache &previous = lastBuild();
+        StateAbstractionOptions options;
+        options.useTextModel = Policy::useTextModel;
+        options.withIndex = Policy::withIndex;
+        if (!previous.options.sameWidgetHashing(options)) {
+            previous.clear();
+        }
+        BuildCache next;
+        next.options = options;
+        size_t expected = previous.prototypes.size();
+        next.prototypes.reserve(expected);
+        next.parents.reserve(expected);
+        next.signatures.reserve(expected);
+        next.sizes.reserve(expected);
+        next.classes.reserve(expected);
+        next.resourceIDs.reserve(expected);
+        next.subtrees.reserve(expected);
+        this->_widgets.reserve(expected);
+
+        size_t reused = buildFromElementIncrementally<Policy>(nullptr, -1, element, true, previous, next,
+                                                              this->_widgets);
+        BDLOG("incremental state build reused %zu of %zu widgets", reused, this->_widgets.size());
+        previous = std::move(next);
+    }
+
+    template<class Policy>
+    size_t ReuseState::buildFromElementIncrementally(const WidgetPtr &parentWidget, int parentSlot,
+                                                     const ElementPtr &elem, bool isRoot,
+                                                     const BuildCache &previous, BuildCache &next,
+                                                     WidgetPtrVec &widgets) {
+        buildBoundingBox(elem);
+        uint64_t signature = elem->subtreeSignature();
+        auto hit = previous.subtrees.find(signature);
+        // Slot 0 holds the RichWidget root; never reuse it for a child or vice versa
+        if (hit != previous.subtrees.end() && (hit->second == 0) == isRoot &&
+            previous.holds(hit->second, elem)) {
+            return cloneCachedSubtree(parentWidget, parentSlot, hit->second, previous, next, widgets);
+        }
+
+        WidgetPtr widget;
+        if (isRoot) {
+            widget = std::make_shared<RichWidget>(parentWidget, elem, Policy());
+        } else {
+            widget = std::make_shared<Widget>(parentWidget, elem, Policy());
+        }
+        widgets.emplace_back(widget);
+        auto slot = static_cast<uint32_t>(next.prototypes.size());
+        next.prototypes.emplace_back(widget->cloneWithParent(nullptr));
+        next.pushSlot(parentSlot, signature, elem);
+
+        size_t reused = 0;
+        for (const auto &childElement: elem->getChildren()) {
+            reused += buildFromElementIncrementally<Policy>(widget, static_cast<int>(slot), childElement, false,
+                                                            previous, next, widgets);
+        }
+        next.sizes[slot] = static_cast<uint32_t>(next.prototypes.size() - slot);
+        if (next.indexSubtrees) {
+            next.subtrees.emplace(signature, slot);
+        }
+        return reused;
+    }
+
+    /**
+     * @brief Append clones of the cached subtree starting at slot first
+     *
+     * Parent links inside the range are rebuilt from the cached parent slots; the
+     * prototypes themselves are immutable and carried over to the next cache as is.
+     */
+    size_t ReuseState::cloneCachedSubtree(const WidgetPtr &parentWidget, int parentSlot, uint32_t first,
+                                          const BuildCache &previous, BuildCache &next, WidgetPtrVec &widgets) {
+        uint32_t count = previous.sizes[first];
+        // widgets and next.prototypes grow in lockstep, so slots and widget indices coincide
+        size_t base = next.prototypes.size();
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t source = first + i;
+            WidgetPtr parent = parentWidget;
+            int slotParent = parentSlot;
+            if (i != 0) {
+                slotParent = static_cast<int>(base + (previous.parents[source] - first));
+                parent = widgets[slotParent];
+            }
+            widgets.emplace_back(previous.prototypes[source]->cloneWithParent(parent));
+            next.prototypes.push_back(previous.prototypes[source]);
+            next.parents.push_back(slotParent);
+            next.signatures.push_back(previous.signatures[source]);
+            next.sizes.push_back(previous.sizes[source]);
+            next.classes.push_back(previous.classes[source]);
+            next.resourceIDs.push_back(previous.resourceIDs[source]);
+            if (next.indexSubtrees) {
+                next.subtrees.emplace(previous.signatures[source], static_cast<uint32_t>(base + i));
+            }
+        }
+        return count;
+    }
+
+    /**
+     * @brief Spine and chunks of one parallel build (see buildWidgetsInParallel)
+     *
+     * Pieces are in the tree's pre-order: a spine node (a subtree too large for one chunk,
+     * its own widget built on the calling thread) or a chunk (consecutive siblings of about
+     * grain nodes in all, built by whichever thread claims it). Concatenating the widgets
+     * of the pieces in order gives the _widgets of the serial build.
+     */
+    struct ReuseState::ParallelBuild {
+        struct SpineNode {
+            ElementPtr element;
+            WidgetPtr widget;
+            /// Spine index of the parent, -1 for the root
+            int parent;
+            /// Last piece of its subtree
+            size_t lastPiece;
+            /// Index in _widgets, set when the pieces are joined
+            uint32_t slot;
+        };
+
+        struct Chunk {
+            /// Spine index of the parent of the roots
+            int parent{-1};
+            std::vector<ElementPtr> roots;
+            size_t nodes{0};
+            WidgetPtrVec widgets;
+            /// Cache slots of the chunk alone (not indexed); parent -1 stands for the spine parent
+            BuildCache next;
+            size_t reused{0};
+        };
+
+        struct Piece {
+            bool spine;
+            uint32_t index;
+        };
+
+        /// Largest subtree put in a chunk, and about the nodes of one
+        size_t grain{1};
+        std::vector<SpineNode> spine;
+        std::vector<Chunk> chunks;
+        std::vector<Piece> pieces;
+    };
+
+    template<class Policy>
+    void ReuseState::planParallelBuild(const WidgetPtr &parentWidget, int parentSpine, const ElementPtr &elem,
+                                       bool isRoot, ParallelBuild &build) {
+        buildBoundingBox(elem);
+        WidgetPtr widget;
+        if (isRoot) {
+            widget = std::make_shared<RichWidget>(parentWidget, elem, Policy());
+        } else {
+            widget = std::make_shared<Widget>(parentWidget, elem, Policy());
+        }
+        auto spineIndex = static_cast<int>(build.spine.size());
+        build.spine.push_back(ParallelBuild::SpineNode{elem, widget, parentSpine, 0, 0});
+        build.pieces.push_back(ParallelBuild::Piece{true, static_cast<uint32_t>(spineIndex)});
+        // Chunk taking the current run of small siblings, -1 after a spine child ended it
+        int openChunk = -1;
+        for (const auto &childElement: elem->getChildren()) {
+            uint32_t size = childElement->subtreeSize();
+            if (size > build.grain) {
+                openChunk = -1;
+                planParallelBuild<Policy>(widget, spineIndex, childElement, false, build);
+                continue;
+            }
+            if (openChunk < 0 || build.chunks[openChunk].nodes >= build.grain) {
+                openChunk = static_cast<int>(build.chunks.size());
+                build.chunks.emplace_back();
+                build.chunks.back().parent = spineIndex;
+                build.pieces.push_back(ParallelBuild::Piece{false, static_cast<uint32_t>(openChunk)});
+            }
+            ParallelBuild::Chunk &chunk = build.chunks[openChunk];
+            chunk.next.indexSubtrees = false;
+            chunk.roots.push_back(childElement);
+            chunk.nodes += size;
+        }
+        build.spine[spineIndex].lastPiece = build.pieces.size() - 1;
+    }
+
+    /**
+     * @brief Build the widgets of a large tree with the executor's workers helping
+     *
+     * WebView and RecyclerView pages reach thousands of nodes, and each Widget is built
+     * (flags, text normalisation, hashing) from its own Element alone. So the tree is cut
+     * into chunks of sibling subtrees of about nodes / (4 * threads) nodes; the nodes above
+     * them (the spine, a few per level) are built here first. Then this thread and up to
+     * threadCount() helper tasks claim chunks from a shared cursor until none is left, each
+     * building into the chunk's own vector: a worker busy with another step only means one
+     * helper less, and a helper no worker picked up finds nothing left when waited on.
+     * The chunks are joined in pre-order, so _widgets, the merge groups, the columns and
+     * the state hash are the serial build's.
+     *
+     * With FASTBOT_INCREMENTAL_STATE_BUILD, an unchanged tree is cloned by the serial build;
+     * otherwise chunks clone their unchanged subtrees from the previous step's cache as the
+     * serial build does, and their cache slots are joined into the next one. Spine nodes are
+     * always built.
+     */
+    template<class Policy>
+    void ReuseState::buildWidgetsInParallel(const ElementPtr &element, StepExecutor &executor) {
+#if FASTBOT_INCREMENTAL_STATE_BUILD
+        BuildCache &previous = lastBuild();
+        StateAbstractionOptions options;
+        options.useTextModel = Policy::useTextModel;
+        options.withIndex = Policy::withIndex;
+        if (!previous.options.sameWidgetHashing(options)) {
+            previous.clear();
+        }
+        // An unchanged screen is one clone of the previous tree: nothing to share out
+        auto hit = previous.subtrees.find(element->subtreeSignature());
+        if (hit != previous.subtrees.end() && hit->second == 0 && previous.holds(0, element)) {
+            buildStateIncrementally<Policy>(element);
+            return;
+        }
+#endif
+        ParallelBuild build;
+        size_t nodeCount = element->subtreeSize();
+        build.grain = std::max<size_t>(nodeCount / (4 * (executor.threadCount() + 1)), 1);
+        planParallelBuild<Policy>(nullptr, -1, element, true, build);
+
+        std::atomic<size_t> cursor{0};
+        auto buildChunks = [&]() {
+            for (size_t index = cursor.fetch_add(1); index < build.chunks.size(); index = cursor.fetch_add(1)) {
+                ParallelBuild::Chunk &chunk = build.chunks[index];
+                const WidgetPtr &parentWidget = build.spine[chunk.parent].widget;
+                chunk.widgets.reserve(chunk.nodes);
+#if FASTBOT_INCREMENTAL_STATE_BUILD
+                chunk.next.prototypes.reserve(chunk.nodes);
+                chunk.next.parents.reserve(chunk.nodes);
+                chunk.next.signatures.reserve(chunk.nodes);
+                chunk.next.sizes.reserve(chunk.nodes);
+                chunk.next.classes.reserve(chunk.nodes);
+                chunk.next.resourceIDs.reserve(chunk.nodes);
+#endif
+                for (const ElementPtr &root: chunk.roots) {
+#if FASTBOT_INCREMENTAL_STATE_BUILD
+                    chunk.reused += buildFromElementIncrementally<Policy>(parentWidget, -1, root, false, previous,
+                                                                          chunk.next, chunk.widgets);
+#else
+                    buildWidgetsFromElement<Policy>(parentWidget, root, false, chunk.widgets);
+#endif
+                }
+            }
+        };
+        size_t helperCount = std::min(executor.threadCount(),
+                                      build.chunks.empty() ? size_t{0} : build.chunks.size() - 1);
+        std::vector<StepTaskPtr> helpers;
+        helpers.reserve(helperCount);
+        for (size_t i = 0; i < helperCount; i++) {
+            helpers.push_back(executor.submit(buildChunks));
+        }
+        buildChunks();
+        for (const StepTaskPtr &helper: helpers) {
+            helper->wait();
+        }
+
+        // Join the pieces in pre-order
+        std::vector<size_t> pieceEnds(build.pieces.size());
+        this->_widgets.reserve(nodeCount);
+#if FASTBOT_INCREMENTAL_STATE_BUILD
+        BuildCache next;
+        next.options = options;
+        next.prototypes.reserve(nodeCount);
+        next.parents.reserve(nodeCount);
+        next.signatures.reserve(nodeCount);
+        next.sizes.reserve(nodeCount);
+        next.classes.reserve(nodeCount);
+        next.resourceIDs.reserve(nodeCount);
+        next.subtrees.reserve(nodeCount);
+        size_t reused = 0;
+#endif
+        for (size_t pieceIndex = 0; pieceIndex < build.pieces.size(); pieceIndex++) {
+            const ParallelBuild::Piece &piece = build.pieces[pieceIndex];
+            if (piece.spine) {
+                ParallelBuild::SpineNode &node = build.spine[piece.index];
+                node.slot = static_cast<uint32_t>(this->_widgets.size());
+                this->_widgets.push_back(node.widget);
+#if FASTBOT_INCREMENTAL_STATE_BUILD
+                next.prototypes.emplace_back(node.widget->cloneWithParent(nullptr));
+                // The chunks below hashed their subtrees already: only the spine is left
+                next.pushSlot(node.parent < 0 ? -1 : static_cast<int>(build.spine[node.parent].slot),
+                              node.element->subtreeSignature(), node.element);
+#endif
+            } else {
+                ParallelBuild::Chunk &chunk = build.chunks[piece.index];
+                auto base = static_cast<int>(this->_widgets.size());
+                this->_widgets.insert(this->_widgets.end(), std::make_move_iterator(chunk.widgets.begin()),
+                                      std::make_move_iterator(chunk.widgets.end()));
+#if FASTBOT_INCREMENTAL_STATE_BUILD
+                BuildCache &part = chunk.next;
+                auto parentSlot = static_cast<int>(build.spine[chunk.parent].slot);
+                next.prototypes.insert(next.prototypes.end(), std::make_move_iterator(part.prototypes.begin()),
+                                       std::make_move_iterator(part.prototypes.end()));
+                for (int parent: part.parents) {
+                    next.parents.push_back(parent < 0 ? parentSlot : parent + base);
+                }
+                next.signatures.insert(next.signatures.end(), part.signatures.begin(), part.signatures.end());
+                next.sizes.insert(next.sizes.end(), part.sizes.begin(), part.sizes.end());
+                next.classes.insert(next.classes.end(), part.classes.begin(), part.classes.end());
+                next.resourceIDs.insert(next.resourceIDs.end(), part.resourceIDs.begin(), part.resourceIDs.end());
+                for (size_t slot = 0; slot < part.signatures.size(); slot++) {
+                    next.subtrees.emplace(part.signatures[slot], static_cast<uint32_t>(slot + base));
+                }
+                reused += chunk.reused;
+#endif
+            }
+            pieceEnds[pieceIndex] = this->_widgets.size();
+        }
+#if FASTBOT_INCREMENTAL_STATE_BUILD
+        for (const ParallelBuild::SpineNode &node: build.spine) {
+            next.sizes[node.slot] = static_cast<uint32_t>(pieceEnds[node.lastPiece] - node.slot);
+            next.subtrees.emplace(next.signatures[node.slot], node.slot);
+        }
+        BDLOG("parallel state build: %zu widgets, %zu spine, %zu chunks, %zu helpers, reused %zu", nodeCount,
+              build.spine.size(), build.chunks.size(), helperCount, reused);
+        previous = std::move(next);
+#else
+        BDLOG("parallel state build: %zu widgets, %zu spine, %zu chunks, %zu helpers", nodeCount,
+              build.spine.size(), build.chunks.size(), helperCount);
+#endif
     }
 
     /**
@@ -143,16 +651,20 @@ namespace fastbotx {
         uintptr_t activityHash = (fastbotx::fastStringHash(activityString) * 31U) << 5;
 
 #if DYNAMIC_STATE_ABSTRACTION_ENABLED
-        uintptr_t widgetsHash = 0x1;
+        // Aggregated once, so getHashUnderMask never walks the widgets again
+        _activityKeyHash = activityHash;
+        _widgetKeyHashes = WidgetKeyHashAggregate();
         for (const auto &w : _widgets) {
             if (w) {
-                widgetsHash ^= w->hashWithMask(_widgetKeyMask);
+                _widgetKeyHashes.add(*w);
             }
         }
-        activityHash ^= (widgetsHash << 1);
+        activityHash ^= ((0x1 ^ _widgetKeyHashes.hashWithMask(_widgetKeyMask)) << 1);
 #else
-        // Combine with widget hash (may include order if STATE_WITH_WIDGET_ORDER is enabled)
-        activityHash ^= (combineHash<Widget>(_widgets, STATE_WITH_WIDGET_ORDER) << 1);
+        // Combine with widget hash (may include order if StateAbstractionOptions::withWidgetOrder)
+        const std::vector<uintptr_t> &widgetHashes = _widgetColumns.hashes;
+        activityHash ^= (combineHashes(widgetHashes.data(), widgetHashes.size(),
+                                       StateAbstractionOptions::current().withWidgetOrder) << 1);
 #endif
         _hashcode = activityHash;
     }
@@ -171,21 +683,20 @@ namespace fastbotx {
      * - Skips widgets with null bounds
      */
     void ReuseState::buildActionForState() {
-        // Performance: Cache activity string (shared_ptr copy) once instead of per action
-        stringPtr activityStr = getActivityString();
-        // Performance: Heuristic reserve to avoid first-pass count; typical ~2–4 actions per widget
-        _actions.reserve(_widgets.size() * 4 + 1);
-
-        for (const auto &widget : _widgets) {
-            RectPtr bounds = widget->getBounds();
-            if (bounds == nullptr) {
-                BLOGE("NULL Bounds happened");
-                continue;
-            }
-            // getActions() returns const ref — no set copy per widget
-            const std::set<ActionType> &actions = widget->getActions();
+        // Performance: Intern activity once per state; every action reuses its precomputed hash
+        stringPtr activityPtr = getActivityString();
+        InternedString activityStr = InternedString::intern(activityPtr ? *activityPtr : std::string());
+        // Performance: Exact reserve from the action bit column (no per-widget set walk)
+        _actions.reserve(countWidgetActions() + 1);
+
+        for (size_t row = 0; row < _widgets.size(); row++) {
+            const WidgetPtr &widget = _widgets[row];
+            // getActions() is a bitmask; iteration walks the set bits in enum order
+            ActionTypeSet actions = widget->getActions();
             for (ActionType action : actions) {
-                _actions.emplace_back(std::make_shared<ActivityNameAction>(activityStr, widget, action));
+                auto modelAction = std::make_shared<ActivityNameAction>(activityStr, widget, action);
+                modelAction->setTargetIndex(static_cast<int>(row));
+                _actions.emplace_back(std::move(modelAction));
             }
         }
 
@@ -246,10 +757,11 @@ namespace fastbotx {
 
     size_t ReuseState::getMaxWidgetsPerModelAction() const {
 #if DYNAMIC_STATE_ABSTRACTION_ENABLED
+        // Group sizes are mirrored per representative in the mergedCounts column
         size_t maxCount = 1;
-        for (const auto &p : _mergedWidgets) {
-            if (p.second.size() > maxCount) {
-                maxCount = p.second.size();
+        for (uint32_t mergedCount : _widgetColumns.mergedCounts) {
+            if (mergedCount > maxCount) {
+                maxCount = mergedCount;
             }
         }
         return maxCount;
@@ -260,16 +772,8 @@ namespace fastbotx {
 
 #if DYNAMIC_STATE_ABSTRACTION_ENABLED
     uintptr_t ReuseState::getHashUnderMask(WidgetKeyMask mask) const {
-        std::string activityString = (_activity && _activity.get()) ? *_activity : "";
-        // Performance optimization: Use fast string hash instead of std::hash
-        uintptr_t activityHash = (fastbotx::fastStringHash(activityString) * 31U) << 5;
-        uintptr_t widgetsHash = 0x1;
-        for (const auto &w : _widgets) {
-            if (w) {
-                widgetsHash ^= w->hashWithMask(mask);
-            }
-        }
-        return activityHash ^ (widgetsHash << 1);
+        // O(1) from the aggregates of buildHashForState; valid after clearDetails and compact too
+        return _activityKeyHash ^ ((0x1 ^ _widgetKeyHashes.hashWithMask(mask)) << 1);
     }
 
     size_t ReuseState::getUniqueWidgetCountUnderMask(WidgetKeyMask mask) const {
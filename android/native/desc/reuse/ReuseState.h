@@ -11,10 +11,13 @@
 #include "RichWidget.h"
 #include "../Base.h"
 #include <vector>
+#include <unordered_map>
 
 
 namespace fastbotx {
 
+    class StepExecutor;
+
     /**
      * @brief ReuseState class for building states with RichWidgets
      * 
@@ -32,11 +35,37 @@ namespace fastbotx {
          * @param element Root Element of the UI hierarchy
          * @param activityName Activity name string pointer
          * @param mask Widget key mask for dynamic state abstraction (default: DefaultWidgetKeyMask)
+         * @param executor Workers that may help build a large tree (FASTBOT_PARALLEL_STATE_BUILD);
+         *                 nullptr builds it on the calling thread
          * @return Shared pointer to created ReuseState
          */
         static std::shared_ptr<ReuseState>
         create(const ElementPtr &element, const stringPtr &activityName,
-               WidgetKeyMask mask = DefaultWidgetKeyMask);
+               WidgetKeyMask mask = DefaultWidgetKeyMask, bool materializeActions = true,
+               StepExecutor *executor = nullptr);
+
+        /**
+         * @brief State hash create() would produce, in one pass over the Element tree
+         *
+         * No Widget, merge group or action is built. Returns 0 when the hash depends on
+         * widget construction (DYNAMIC_STATE_ABSTRACTION_ENABLED off).
+         */
+        static uintptr_t computeHash(const ElementPtr &element, const stringPtr &activityName,
+                                     WidgetKeyMask mask = DefaultWidgetKeyMask);
+
+        /**
+         * @brief State in cold storage built from a session snapshot record
+         *
+         * Holds no widgets or actions: they are rebuilt, and the recorded action values
+         * restored, when a page with this hash is added to the graph.
+         */
+        static std::shared_ptr<ReuseState> createCold(const stringPtr &activityName, ColdStateRecord record);
+
+        void materializeActions() override;
+
+        void compact() override;
+
+        ColdStateRecord toColdRecord() const override;
 
     protected:
         virtual void buildStateFromElement(WidgetPtr parentWidget, ElementPtr element);
@@ -68,15 +97,98 @@ namespace fastbotx {
 
         ReuseState();
 
-        virtual void buildState(const ElementPtr &element);
+        virtual void buildState(const ElementPtr &element, StepExecutor *executor = nullptr);
 
         virtual void buildBoundingBox(const ElementPtr &element);
 
+        /**
+         * @brief Widgets built on the previous step, kept for incremental state building
+         *
+         * Slots are in the same DFS pre-order as _widgets, so a subtree is the contiguous
+         * range [slot, slot + sizes[slot]). Prototypes are private copies: states clear
+         * and refill the details of their own widgets, never of these.
+         */
+        struct BuildCache {
+            WidgetPtrVec prototypes;
+            /// Parent slot of each slot, -1 for the root of the tree
+            std::vector<int> parents;
+            std::vector<uint64_t> signatures;
+            std::vector<uint32_t> sizes;
+            /// Class and resource-id of each slot's Element, checked with sizes before a hit is reused
+            std::vector<InternedString> classes;
+            std::vector<InternedString> resourceIDs;
+            /// Element::subtreeSignature() -> first slot of that subtree
+            std::unordered_map<uint64_t, uint32_t> subtrees;
+            /// Whether building fills subtrees; off for the chunks of a parallel build, indexed when joined
+            bool indexSubtrees{true};
+            /// Options the prototypes were hashed under; a change invalidates the cache
+            StateAbstractionOptions options;
+
+            void clear();
+
+            /// Append slot bookkeeping for element (its size is set once its subtree is built)
+            void pushSlot(int parent, uint64_t signature, const ElementPtr &element);
+
+            /// Whether the subtree at slot can stand for element: a signature hit is only a hash match
+            bool holds(uint32_t slot, const ElementPtr &element) const {
+                return this->sizes[slot] == element->subtreeSize() &&
+                       this->classes[slot] == element->getInternedClassname() &&
+                       this->resourceIDs[slot] == element->getInternedResourceID();
+            }
+        };
+
+        /// Per-thread cache of the last tree built (one GUI tree per device thread)
+        static BuildCache &lastBuild();
+
+        /// Build _widgets under one WidgetHashPolicy, chosen by buildState
+        template<class Policy>
+        void buildWidgets(const ElementPtr &element, StepExecutor *executor);
+
+        /// Build _widgets reusing unchanged subtrees of the previous step's tree
+        template<class Policy>
+        void buildStateIncrementally(const ElementPtr &element);
+
+        /// Build _widgets of a large tree on the executor's workers and this thread (see the .cpp)
+        template<class Policy>
+        void buildWidgetsInParallel(const ElementPtr &element, StepExecutor &executor);
+
         /// Widget key mask for dynamic state abstraction (used in buildHashForState and mergeWidgetsInState)
         WidgetKeyMask _widgetKeyMask{DefaultWidgetKeyMask};
 
+#if DYNAMIC_STATE_ABSTRACTION_ENABLED
+        /// Activity term of the state hash, and the widget terms under every mask (see buildHashForState)
+        uintptr_t _activityKeyHash{0};
+        WidgetKeyHashAggregate _widgetKeyHashes;
+#endif
+
+        /// Whether buildActionForState has run (see materializeActions)
+        bool _actionsBuilt{false};
+
     private:
+        /// Parts of a parallel build: the serially built spine and the chunks run concurrently
+        struct ParallelBuild;
+
         void buildFromElement(WidgetPtr parentWidget, ElementPtr elem) override;
+
+        /// Build the subtree of elem from scratch (RichWidget at the root, Widget below) into widgets
+        template<class Policy>
+        void buildWidgetsFromElement(const WidgetPtr &parentWidget, const ElementPtr &elem, bool isRoot,
+                                     WidgetPtrVec &widgets);
+
+        /// Returns the number of widgets that were cloned from the cache instead of built
+        template<class Policy>
+        size_t buildFromElementIncrementally(const WidgetPtr &parentWidget, int parentSlot,
+                                             const ElementPtr &elem, bool isRoot,
+                                             const BuildCache &previous, BuildCache &next,
+                                             WidgetPtrVec &widgets);
+
+        size_t cloneCachedSubtree(const WidgetPtr &parentWidget, int parentSlot, uint32_t first,
+                                  const BuildCache &previous, BuildCache &next, WidgetPtrVec &widgets);
+
+        /// Build the spine of a parallel build from elem down and cut the rest into chunks
+        template<class Policy>
+        void planParallelBuild(const WidgetPtr &parentWidget, int parentSpine, const ElementPtr &elem,
+                               bool isRoot, ParallelBuild &build);
     };
 
     typedef std::shared_ptr<ReuseState> ReuseStatePtr;
@@ -34,10 +34,25 @@ namespace fastbotx {
      */
     RichWidget::RichWidget(WidgetPtr parent, const ElementPtr &element)
             : Widget(std::move(parent), element) {
+        this->initRichHash(element);
+    }
+
+    template<class Policy>
+    RichWidget::RichWidget(WidgetPtr parent, const ElementPtr &element, Policy policy)
+            : Widget(std::move(parent), element, policy) {
+        this->initRichHash(element);
+    }
+
+    template RichWidget::RichWidget(WidgetPtr, const ElementPtr &, WidgetHashPolicy<false, false>);
+    template RichWidget::RichWidget(WidgetPtr, const ElementPtr &, WidgetHashPolicy<false, true>);
+    template RichWidget::RichWidget(WidgetPtr, const ElementPtr &, WidgetHashPolicy<true, false>);
+    template RichWidget::RichWidget(WidgetPtr, const ElementPtr &, WidgetHashPolicy<true, true>);
+
+    void RichWidget::initRichHash(const ElementPtr &element) {
         // Performance optimization: Use fast string hash function instead of std::hash
         // Compute hash components
-        uintptr_t hashcode1 = fastbotx::fastStringHash(this->_clazz);
-        uintptr_t hashcode2 = fastbotx::fastStringHash(this->_resourceID);
+        uintptr_t hashcode1 = this->_clazz.hash();
+        uintptr_t hashcode2 = this->_resourceID.hash();
         
         // Combine action types into hash
         uintptr_t hashcode3 = 0x1;
@@ -45,14 +60,14 @@ namespace fastbotx {
             hashcode3 ^= (127U * std::hash<int>{}(static_cast<int>(actionType)));
         }
         
-        // Combine class, resource ID, and actions
-        this->_widgetHashcode = ((hashcode1 ^ (hashcode2 << 4)) >> 2) ^ ((127U * hashcode3 << 1));
+        // Combine class, resource ID, and actions; replaces Widget's hash as the identity (hash())
+        this->_hashcode = ((hashcode1 ^ (hashcode2 << 4)) >> 2) ^ ((127U * hashcode3 << 1));
         
         // Include text from widget or children if available
         // Use fast string hash for better performance
         std::string elementText = this->getValidTextFromWidgetAndChildren(element);
         if (!elementText.empty()) {
-            this->_widgetHashcode ^= (0x79b9 + (fastbotx::fastStringHash(elementText) << 1));
+            this->_hashcode ^= (0x79b9 + (fastbotx::fastStringHash(elementText) << 1));
         }
     }
 
@@ -74,8 +89,8 @@ namespace fastbotx {
      */
     std::string RichWidget::getValidTextFromWidgetAndChildren(const ElementPtr &element) const {
         // First check if this element has valid text (fast path)
-        if (!element->validText.empty()) {
-            return element->validText;
+        if (!element->getValidText().empty()) {
+            return element->getValidText();
         }
         
         // Use iterative search instead of recursion for better performance
@@ -93,8 +108,8 @@ namespace fastbotx {
             stack.pop_back();
             
             // Check current element's valid text
-            if (!current->validText.empty()) {
-                return current->validText;
+            if (!current->getValidText().empty()) {
+                return current->getValidText();
             }
             
             // Add children to stack for further search
@@ -110,8 +125,10 @@ namespace fastbotx {
 
     }
 
-    uintptr_t RichWidget::hash() const {
-        return getActHashCode();
+    WidgetPtr RichWidget::cloneWithParent(WidgetPtr parent) const {
+        auto widget = std::make_shared<RichWidget>(*this);
+        widget->_parent = std::move(parent);
+        return widget;
     }
 
     uintptr_t RichWidget::hashWithMask(WidgetKeyMask mask) const {
@@ -35,18 +35,21 @@ namespace fastbotx {
          */
         RichWidget(WidgetPtr parent, const ElementPtr &element);
 
-        uintptr_t hash() const override;
+        /// Constructor under the options of Policy (a WidgetHashPolicy, see Widget)
+        template<class Policy>
+        RichWidget(WidgetPtr parent, const ElementPtr &element, Policy policy);
 
         uintptr_t hashWithMask(WidgetKeyMask mask) const override;
 
-        uintptr_t getActHashCode() const { return this->_widgetHashcode; }
+        WidgetPtr cloneWithParent(WidgetPtr parent) const override;
 
     protected:
         RichWidget();
 
-        uintptr_t _widgetHashcode{};
-
     private:
+        /// Replace Widget's hash with the one of actions, class, resource ID and text
+        void initRichHash(const ElementPtr &element);
+
         /// Get Element valid text. If parent widget are not clickable, get children's valid text
         /// \param element
         /// \return valid text from widget or its children or offspring.
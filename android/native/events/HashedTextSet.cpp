@@ -0,0 +1,68 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef HashedTextSet_CPP_
+#define HashedTextSet_CPP_
+
+#include "HashedTextSet.h"
+#include <algorithm>
+
+namespace fastbotx {
+
+    constexpr size_t HashedTextSet::BloomBitsPerText;
+
+    void HashedTextSet::assign(std::vector<std::string> texts) {
+        std::sort(texts.begin(), texts.end());
+        texts.erase(std::unique(texts.begin(), texts.end()), texts.end());
+        this->_texts.swap(texts);
+        this->build();
+    }
+
+    void HashedTextSet::clear() {
+        this->_texts.clear();
+        this->_bloom.clear();
+        this->_slots.clear();
+        this->_bloomMask = 0;
+        this->_slotMask = 0;
+    }
+
+    void HashedTextSet::build() {
+        this->_bloom.clear();
+        this->_slots.clear();
+        if (this->_texts.empty()) {
+            this->_bloomMask = 0;
+            this->_slotMask = 0;
+            return;
+        }
+        size_t words = 1;
+        while (words * 64 < this->_texts.size() * BloomBitsPerText) {
+            words <<= 1;
+        }
+        size_t slots = 2;
+        while (slots < this->_texts.size() * 2) {
+            slots <<= 1;
+        }
+        this->_bloom.assign(words, 0);
+        this->_bloomMask = words - 1;
+        this->_slots.assign(slots, Slot{0, 0});
+        this->_slotMask = slots - 1;
+        for (size_t index = 0; index < this->_texts.size(); index++) {
+            const std::string &text = this->_texts[index];
+            uintptr_t hash = fastStringHash(text.data(), text.size());
+            uint64_t mixed = mix(hash);
+            this->_bloom[(mixed >> 32) & this->_bloomMask] |=
+                    (uint64_t(1) << (mixed & 63)) | (uint64_t(1) << ((mixed >> 6) & 63));
+            size_t slot = (mixed >> 12) & this->_slotMask;
+            while (0 != this->_slots[slot].text) {
+                slot = (slot + 1) & this->_slotMask;
+            }
+            this->_slots[slot] = Slot{hash, static_cast<uint32_t>(index + 1)};
+        }
+    }
+
+}
+
+#endif //HashedTextSet_CPP_
@@ -0,0 +1,105 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef HashedTextSet_H_
+#define HashedTextSet_H_
+
+#include "Base.h"
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace fastbotx {
+
+    /**
+     * @brief Set of strings queried by their fastStringHash, mostly for strings it lacks
+     *
+     * Holds the valid texts of an APK (tens of thousands) that every node's text and
+     * content-desc are looked up in. A query takes the hash the parser already computed:
+     * a blocked Bloom filter (BloomBitsPerText bits per text, two bits of one 64-bit word
+     * per query) rejects most absent strings with one load. The rest probe an open
+     * addressing table of (hash, text index) slots, and a hash hit is confirmed by
+     * comparing the bytes, so answers are exact.
+     */
+    class HashedTextSet {
+    public:
+        /// Index these texts, replacing the previous ones; they are sorted and deduplicated
+        void assign(std::vector<std::string> texts);
+
+        void clear();
+
+        bool empty() const { return this->_texts.empty(); }
+
+        size_t size() const { return this->_texts.size(); }
+
+        /// The texts, sorted
+        const std::vector<std::string> &texts() const { return this->_texts; }
+
+        /// Heap bytes of the text vector, the filter and the table (not the strings' own buffers)
+        size_t heapBytes() const {
+            return this->_texts.capacity() * sizeof(std::string) +
+                   this->_bloom.capacity() * sizeof(uint64_t) +
+                   this->_slots.capacity() * sizeof(Slot);
+        }
+
+        /**
+         * @brief The stored text equal to (data, size), or nullptr
+         *
+         * @param hash fastStringHash(data, size)
+         */
+        const std::string *find(const char *data, size_t size, uintptr_t hash) const {
+            if (this->_texts.empty()) {
+                return nullptr;
+            }
+            uint64_t mixed = mix(hash);
+            uint64_t word = this->_bloom[(mixed >> 32) & this->_bloomMask];
+            uint64_t bits = (uint64_t(1) << (mixed & 63)) | (uint64_t(1) << ((mixed >> 6) & 63));
+            if ((word & bits) != bits) {
+                return nullptr;
+            }
+            for (size_t slot = (mixed >> 12) & this->_slotMask;; slot = (slot + 1) & this->_slotMask) {
+                const Slot &entry = this->_slots[slot];
+                if (0 == entry.text) {
+                    return nullptr;
+                }
+                if (entry.hash == hash) {
+                    const std::string &text = this->_texts[entry.text - 1];
+                    if (text.size() == size && 0 == std::memcmp(text.data(), data, size)) {
+                        return &text;
+                    }
+                }
+            }
+        }
+
+    private:
+        struct Slot {
+            uintptr_t hash;
+            /// Index into _texts plus one; 0 marks an empty slot
+            uint32_t text;
+        };
+
+        static constexpr size_t BloomBitsPerText = 16;
+
+        /// Spread hash over 64 bits: uintptr_t is 32 bits wide on 32-bit ABIs
+        static uint64_t mix(uintptr_t hash) {
+            uint64_t mixed = static_cast<uint64_t>(hash) * 0x9E3779B97F4A7C15ULL;
+            return mixed ^ (mixed >> 29);
+        }
+
+        void build();
+
+        std::vector<std::string> _texts;
+        std::vector<uint64_t> _bloom;
+        size_t _bloomMask{0};
+        /// At most half full, so probe runs stay short
+        std::vector<Slot> _slots;
+        size_t _slotMask{0};
+    };
+
+}
+
+#endif //HashedTextSet_H_
@@ -11,11 +11,14 @@
 #include <mutex>
 #include <cstring>
 #include <climits>
+#include <cstdlib>
 #include "utils.hpp"
+#include "Trace.h"
 #include "Preference.h"
+#include "MemoryFootprint.h"
 #include "../thirdpart/json/json.hpp"
 
-// Performance optimization: Maximum number of page texts to cache
+// Performance optimization: Maximum number of page texts to cache (slots of the page text ring)
 #define PageTextsMaxCount 300
 
 namespace fastbotx {
@@ -54,8 +57,8 @@ namespace fastbotx {
      *       - Checks action type first to determine which text to set
      *       - Caches bounds size check to avoid repeated vector operations
      */
-    OperatePtr CustomAction::toOperate() const {
-        OperatePtr opt = Action::toOperate();
+    OperatePtr CustomAction::toOperate(Rng &rng) const {
+        OperatePtr opt = Action::toOperate(rng);
         opt->sid = "customact";
         opt->aid = "customact";
         opt->editable = true;
@@ -121,6 +124,126 @@ namespace fastbotx {
             static const std::regex r("class='(.*?)'");
             return r;
         }
+
+        /// Whether element is root or still linked to it (deleteElement detaches a subtree)
+        bool isInTree(const ElementPtr &element, const ElementPtr &root) {
+            const Element *node = element.get();
+            while (node != nullptr && node != root.get()) {
+                node = node->getParent().lock().get();
+            }
+            return node != nullptr;
+        }
+
+#if defined(__ANDROID__) || defined(_DEBUG_)
+        // Encoding of the loaders' results in the compiled preference cache (PreferenceCache),
+        // used by loadConfigs only
+
+        void writeStrings(PreferenceCache::Writer &out, const std::vector<std::string> &strings) {
+            out.u32(static_cast<uint32_t>(strings.size()));
+            for (const std::string &value: strings) {
+                out.str(value);
+            }
+        }
+
+        bool readStrings(PreferenceCache::Reader &in, std::vector<std::string> &strings) {
+            uint32_t count = 0;
+            if (!in.count(count, sizeof(uint32_t))) {
+                return false;
+            }
+            strings.clear();
+            strings.reserve(count);
+            for (uint32_t i = 0; i < count; i++) {
+                std::string value;
+                if (!in.str(value)) {
+                    return false;
+                }
+                strings.push_back(std::move(value));
+            }
+            return true;
+        }
+
+        void writeActions(PreferenceCache::Writer &out, const CustomActionPtrVec &actions) {
+            out.u32(static_cast<uint32_t>(actions.size()));
+            for (const CustomActionPtr &action: actions) {
+                out.i32(static_cast<int32_t>(action->getActionType()));
+                // Xpaths are stored as their source string; parsing one is a few finds
+                out.u8(action->xpath ? 1 : 0);
+                if (action->xpath) {
+                    out.str(action->xpath->toString());
+                }
+                out.str(action->resourceID);
+                out.str(action->contentDescription);
+                out.str(action->text);
+                out.str(action->classname);
+                out.str(action->activity);
+                out.str(action->command);
+                out.u32(static_cast<uint32_t>(action->bounds.size()));
+                for (float bound: action->bounds) {
+                    out.f32(bound);
+                }
+                out.u8(action->allowFuzzing ? 1 : 0);
+                out.u8(action->clearText ? 1 : 0);
+                out.u8(action->adbInput ? 1 : 0);
+                out.i32(action->throttle);
+                out.i32(action->waitTime);
+            }
+        }
+
+        bool readActions(PreferenceCache::Reader &in, CustomActionPtrVec &actions) {
+            uint32_t count = 0;
+            if (!in.count(count, 8)) {
+                return false;
+            }
+            actions.clear();
+            actions.reserve(count);
+            for (uint32_t i = 0; i < count; i++) {
+                int32_t actionType = 0;
+                uint8_t hasXpath = 0;
+                if (!in.i32(actionType) || actionType < 0 || actionType >= ActionType::ActTypeSize ||
+                    !in.u8(hasXpath)) {
+                    return false;
+                }
+                auto action = std::make_shared<CustomAction>(static_cast<ActionType>(actionType));
+                if (hasXpath) {
+                    std::string xpathString;
+                    if (!in.str(xpathString)) {
+                        return false;
+                    }
+                    action->xpath = std::make_shared<Xpath>(xpathString);
+                }
+                uint32_t boundsCount = 0;
+                in.str(action->resourceID);
+                in.str(action->contentDescription);
+                in.str(action->text);
+                in.str(action->classname);
+                in.str(action->activity);
+                in.str(action->command);
+                if (!in.count(boundsCount, sizeof(float))) {
+                    return false;
+                }
+                action->bounds.resize(boundsCount);
+                for (float &bound: action->bounds) {
+                    in.f32(bound);
+                }
+                uint8_t allowFuzzing = 0;
+                uint8_t clearText = 0;
+                uint8_t adbInput = 0;
+                in.u8(allowFuzzing);
+                in.u8(clearText);
+                in.u8(adbInput);
+                in.i32(action->throttle);
+                in.i32(action->waitTime);
+                if (!in.ok()) {
+                    return false;
+                }
+                action->allowFuzzing = allowFuzzing != 0;
+                action->clearText = clearText != 0;
+                action->adbInput = adbInput != 0;
+                actions.push_back(action);
+            }
+            return true;
+        }
+#endif
     }
 
     /**
@@ -157,15 +280,12 @@ namespace fastbotx {
         int equalsCount = 0;
         bool hasAndKeyword = false;
         
-        // Helper lambda to extract quoted value: key='value'
+        // Helper lambda to extract quoted value: key (including the opening quote) then value'
         auto extractQuotedValue = [&xpathString](const std::string& key, std::string& out) -> bool {
             size_t keyPos = xpathString.find(key);
             if (keyPos == std::string::npos) return false;
             
             size_t quoteStart = keyPos + key.length();
-            if (quoteStart >= xpathString.length() || xpathString[quoteStart] != '\'') return false;
-            
-            quoteStart++; // Skip opening quote
             size_t quoteEnd = xpathString.find('\'', quoteStart);
             if (quoteEnd == std::string::npos) return false;
             
@@ -240,13 +360,13 @@ namespace fastbotx {
      * - _doInputFuzzing: true
      * - _pruningValidTexts: false
      * - _skipAllActionsFromModel: false
-     * - _rootScreenSize: nullptr
+     * - _rootScreenSize: empty
      * 
      * Automatically calls loadConfigs() to load all configuration files.
      */
     Preference::Preference()
             : _randomInputText(false), _doInputFuzzing(true), _pruningValidTexts(false),
-              _skipAllActionsFromModel(false), _rootScreenSize(nullptr) {
+              _skipAllActionsFromModel(false) {
         loadConfigs();
     }
 
@@ -274,8 +394,6 @@ namespace fastbotx {
     Preference::~Preference() {
         this->_resMixedMapping.clear();
         this->_resMapping.clear();
-        this->_blackWidgetActions.clear();
-        this->_treePrunings.clear();
         this->_inputTexts.clear();
         this->_blackList.clear();
         std::queue<ActionPtr> empty;
@@ -295,6 +413,7 @@ namespace fastbotx {
      * 
      * @param activity Current activity name
      * @param rootXML Root Element of the UI tree
+     * @param rng Generator of the stepping device, drawn for the event probabilities
      * 
      * @return ActionPtr - Custom action if available, nullptr otherwise
      * 
@@ -304,39 +423,35 @@ namespace fastbotx {
      *       - Remaining times > 0
      * 
      * @note Performance optimizations:
-     *       - Early activity check to avoid unnecessary random number generation
+     *       - Events indexed by interned activity at load, so only this page's events are checked
      *       - Removed redundant empty() check inside loop
      *       - Moved logging after matching checks to reduce overhead
      */
-    ActionPtr Preference::resolvePageAndGetSpecifiedAction(const std::string &activity,
-                                                           const ElementPtr &rootXML) {
+    ActionPtr Preference::resolvePageAndGetSpecifiedAction(InternedString activity,
+                                                           const ElementPtr &rootXML, Rng &rng) {
         if (nullptr != rootXML)
             this->resolvePage(activity, rootXML);
 
         // resolve action
         ActionPtr returnAction = nullptr;
-        if (this->_currentActions.empty()) {
-            // Performance: Check activity match first to avoid unnecessary random number generation
-            // Most events won't match the current activity, so early exit saves computation
-            for (const CustomEventPtr &customEvent: this->_customEvents) {
-                // Early exit: Check activity match first (fastest check)
-                if (customEvent->activity != activity) {
-                    continue;
-                }
-                
+        auto activityEvents = this->_customEventsByActivity.find(activity);
+        if (this->_currentActions.empty() && activityEvents != this->_customEventsByActivity.end()) {
+            // Performance: Only the events of this activity, so pages without events draw
+            // no random numbers and scan nothing
+            for (const CustomEventPtr &customEvent: activityEvents->second) {
                 // Early exit: Check times before generating random number
                 if (customEvent->times <= 0) {
                     continue;
                 }
                 
                 // Only generate random number if activity matches and times > 0
-                float eventRate = randomInt(0, 10) / 10.0;
+                float eventRate = rng.nextInt(0, 10) / 10.0;
                 
                 // Check probability match
                 if (eventRate < customEvent->prob) {
                     // Performance: Removed redundant empty() check - we know queue is empty here
                     // (entered this block only if _currentActions.empty() was true)
-                    BLOG("custom event matched: %s actions size: %d", activity.c_str(),
+                    BLOG("custom event matched: %s actions size: %d", activity.str().c_str(),
                          (int) customEvent->actions.size());
                     
                     // Add all actions to queue
@@ -348,7 +463,7 @@ namespace fastbotx {
                     
                     // Performance: Log detailed info only when event matches
                     BLOG("customEvent activities %s, page event is %s, event times %d , rate is %f/%f",
-                         customEvent->activity.c_str(), activity.c_str(), 
+                         customEvent->activity.c_str(), activity.str().c_str(), 
                          customEvent->times, eventRate, customEvent->prob);
                 }
             }
@@ -385,6 +500,50 @@ namespace fastbotx {
         return returnAction;
     }
 
+    std::vector<CustomActionPtr> Preference::planQueuedActions(const ElementPtr &rootXML, size_t maxCount,
+                                                               std::vector<ElementPtr> &targets) {
+        std::vector<CustomActionPtr> planned;
+        targets.clear();
+        while (planned.size() < maxCount && rootXML && !this->_currentActions.empty()) {
+            ActionType actionType = this->_currentActions.front()->getActionType();
+            if (actionType < ActionType::CLICK || actionType > ActionType::SCROLL_RIGHT_LEFT) {
+                break;
+            }
+            auto customAction = std::dynamic_pointer_cast<CustomAction>(this->_currentActions.front());
+            if (!customAction || !customAction->xpath) {
+                break;
+            }
+            ElementPtr target = this->findFirstMatchedElement(customAction->xpath, rootXML);
+            if (!target) {
+                break;
+            }
+            const Rect &rect = target->getBounds();
+            customAction->bounds = {static_cast<float>(rect.left), static_cast<float>(rect.top),
+                                    static_cast<float>(rect.right), static_cast<float>(rect.bottom)};
+            this->_currentActions.pop();
+            BLOG("custom action planned ahead: %s", customAction->toString().c_str());
+            planned.push_back(customAction);
+            targets.push_back(target);
+        }
+        return planned;
+    }
+
+    void Preference::requeueActions(const std::vector<CustomActionPtr> &actions) {
+        if (actions.empty()) {
+            return;
+        }
+        std::queue<ActionPtr> requeued;
+        for (const auto &action: actions) {
+            requeued.push(action);
+        }
+        while (!this->_currentActions.empty()) {
+            requeued.push(this->_currentActions.front());
+            this->_currentActions.pop();
+        }
+        this->_currentActions.swap(requeued);
+        BLOG("requeued %d custom actions planned ahead", (int) actions.size());
+    }
+
     /**
      * @brief Patch action bounds by finding matching element in UI tree
      * 
@@ -422,19 +581,15 @@ namespace fastbotx {
             return false;
         }
         
-        RectPtr rect = matchedElement->getBounds();
-        if (rect == nullptr) {
-            BLOGE("action xpath matched but bounds is null %s", action->xpath->toString().c_str());
-            return false;
-        }
+        const Rect &rect = matchedElement->getBounds();
         
         // Performance optimization: Pre-allocate vector to avoid multiple reallocations
         // Using resize + direct assignment is faster than 4 push_back calls
         action->bounds.resize(4);
-        action->bounds[0] = static_cast<float>(rect->left);
-        action->bounds[1] = static_cast<float>(rect->top);
-        action->bounds[2] = static_cast<float>(rect->right);
-        action->bounds[3] = static_cast<float>(rect->bottom);
+        action->bounds[0] = static_cast<float>(rect.left);
+        action->bounds[1] = static_cast<float>(rect.top);
+        action->bounds[2] = static_cast<float>(rect.right);
+        action->bounds[3] = static_cast<float>(rect.bottom);
         
         return true;
     }
@@ -445,7 +600,7 @@ namespace fastbotx {
      * For editable widgets with empty text, fills in text based on configuration:
      * 1. If _randomInputText is true: use user preset strings (_inputTexts)
      * 2. Otherwise: 50% probability use fuzzing texts (_fuzzingTexts)
-     * 3. Otherwise: 35% probability use page texts (_pageTextsCache)
+     * 3. Otherwise: 35% probability use page texts (_pageTexts ring)
      * 
      * Only applies to CLICK and LONG_CLICK actions on editable widgets.
      * 
@@ -461,7 +616,7 @@ namespace fastbotx {
      *       - Uses string literals instead of strcpy for better performance
      *       - Only generates random numbers when needed
      */
-    void Preference::patchOperate(const OperatePtr &opt) {
+    void Preference::patchOperate(const OperatePtr &opt, Rng &rng) {
         // Performance: Early exit if input fuzzing is disabled
         if (!this->_doInputFuzzing) {
             return;
@@ -493,7 +648,7 @@ namespace fastbotx {
             // Performance: Cache size to avoid repeated size() calls
             const int n = static_cast<int>(this->_inputTexts.size());
             if (n > 0) {
-                int randIdx = randomInt(0, n);
+                int randIdx = rng.nextInt(0, n);
                 opt->setText(this->_inputTexts[randIdx]);
                 prelog = "user preset strings";
                 textSet = true;
@@ -501,24 +656,26 @@ namespace fastbotx {
         } else {
             // Priority 2 & 3: Use fuzzing texts or page texts based on probability
             // Performance: Only generate random number when needed
-            int rate = randomInt(0, 100);
+            int rate = rng.nextInt(0, 100);
             
             // 50% probability: Use fuzzing texts
             if (rate < 50 && !this->_fuzzingTexts.empty()) {
                 const int n = static_cast<int>(this->_fuzzingTexts.size());
                 if (n > 0) {
-                    int randIdx = randomInt(0, n);
+                    int randIdx = rng.nextInt(0, n);
                     opt->setText(this->_fuzzingTexts[randIdx]);
                     prelog = "fuzzing text";
                     textSet = true;
                 }
             }
             // 35% probability (rate 50-84): Use page texts cache
-            else if (rate < 85 && !this->_pageTextsCache.empty()) {
-                const int n = static_cast<int>(this->_pageTextsCache.size());
+            // Performance optimization: the ring fills slots [0, n) first, so any index
+            // below n is a cached text and no string is copied until one is picked
+            else if (rate < 85 && this->_pageTextsCount > 0) {
+                const int n = static_cast<int>(this->_pageTextsCount);
                 if (n > 0) {
-                    int randIdx = randomInt(0, n);
-                    opt->setText(this->_pageTextsCache[randIdx]);
+                    int randIdx = rng.nextInt(0, n);
+                    opt->setText(this->_pageTexts[randIdx]);
                     prelog = "page text";
                     textSet = true;
                 }
@@ -536,254 +693,368 @@ namespace fastbotx {
      * 
      * Main entry point for page preprocessing. Performs the following operations:
      * 1. Gets and caches root screen size
-     * 2. Resolves black widgets (deletes blacklisted controls/regions)
-     * 3. Resolves element tree (resource mapping, tree pruning, valid texts)
+     * 2. One traversal (resolveNode) runs every per-node stage: black widget matching,
+     *    resource ID de-mixing, page text caching, tree pruning and valid text pruning
+     * 3. Deletes the matched black widgets and caches their rects (applyBlackWidgets)
      * 
      * This function is called once per page before the UI tree is used for exploration.
      * 
      * @param activity Current activity name
      * @param rootXML Root Element of the UI tree
      * 
-     * @note Performance: Tree traversal reduced from 3 passes to 2 passes
-     *       (resolveBlackWidgets + resolveElement which includes deMixResMapping)
+     * @note Performance: Tree traversal reduced from 2 passes (plus a subtree walk per node
+     *       for valid texts) to 1. Black widgets are matched on each node before the other
+     *       stages rewrite it and deleted after the traversal, so they see the raw tree as
+     *       when they ran in a pass of their own.
      * 
      * @note Performance optimizations:
      *       - Early validation of rootXML
      *       - Simplified root size caching logic
-     *       - Reduced redundant bounds checks
+     *       - Per-activity rule lookups done once per page instead of once per node
      *       - Cached children reference
      */
-    void Preference::resolvePage(const std::string &activity, const ElementPtr &rootXML) {
+    void Preference::resolvePage(InternedString activity, const ElementPtr &rootXML) {
+        FASTBOT_TRACE_FUNCTION();
         // Performance: Early validation
         if (nullptr == rootXML) {
             return;
         }
 
-        BDLOG("preference resolve page: %s black widget %zu tree pruning %zu", activity.c_str(),
-              this->_blackWidgetActions.size(), this->_treePrunings.size());
+        PageResolution &page = this->_pageResolution;
+        // The rule set of this page; a concurrent reload publishes a new one for later pages
+        page.rules = this->rules();
+        BDLOG("preference resolve page: %s black widget %zu tree pruning %zu", activity.str().c_str(),
+              page.rules->blackWidgetActions.size(), page.rules->treePrunings.size());
 
         // Performance: Get and cache root size only if not already cached or if cached size is invalid
         // Fix: Check isEmpty() instead of (left + top) != 0, which was incorrect logic
-        if (nullptr == this->_rootScreenSize || this->_rootScreenSize->isEmpty()) {
-            RectPtr rootSize = rootXML->getBounds();
+        if (this->_rootScreenSize.isEmpty()) {
+            this->_rootScreenSize = rootXML->getBounds();
             
             // Performance: If root bounds are empty, try to get from first child
-            if (!rootSize || rootSize->isEmpty()) {
+            if (this->_rootScreenSize.isEmpty()) {
                 // Performance: Cache children reference to avoid repeated getChildren() calls
                 const auto &children = rootXML->getChildren();
                 if (!children.empty()) {
-                    rootSize = children[0]->getBounds();
+                    this->_rootScreenSize = children[0]->getBounds();
                 }
             }
             
-            this->_rootScreenSize = rootSize;
-            
             // Performance: Log error only once when root size cannot be determined
-            if (!this->_rootScreenSize || this->_rootScreenSize->isEmpty()) {
+            if (this->_rootScreenSize.isEmpty()) {
                 BLOGE("%s", "No root size in current page");
             }
         }
         
-        // recursively resolve black widgets
-        this->resolveBlackWidgets(rootXML, activity);
-        // Performance optimization: deMixResMapping is now merged into resolveElement
-        // This reduces tree traversal from 3 passes to 2 passes (resolveBlackWidgets + resolveElement)
-        // recursively deal all rootXML tree (includes deMixResMapping)
-        this->resolveElement(rootXML, activity);
+        this->beginPageResolution(activity, rootXML, page);
+        // one DFS for all per-node stages
+        this->resolveNode(rootXML, page);
+        bool deleted = this->applyBlackWidgets(rootXML, activity, page);
+        
+        // Texts seen under deleted black widgets are not page texts
+        for (auto &element: page.pendingTexts) {
+            if (!deleted || isInTree(element, rootXML)) {
+                this->cachePageText(element->getText());
+            }
+        }
+        page.pendingTexts.clear();
+        for (auto &matches: page.matchesByRule) {
+            matches.clear();
+        }
+        page.rules.reset();
     }
 
     /**
-     * @brief Recursively resolve element and its children
+     * @brief Look up the rules of activity that resolveNode applies to every node
      * 
-     * Processes a single Element and recursively processes all its children.
-     * Performs the following operations in a single traversal:
-     * 1. Resource ID mapping (deMixResMapping): Maps obfuscated resource IDs back to original
-     * 2. Page text caching: Collects page texts for input fuzzing
-     * 3. Tree pruning: Modifies element properties based on xpath rules
-     * 4. Valid text pruning: Marks valid texts and sets clickable if needed
+     * Picks the compiled black widget rules of the activity from the page's rule set,
+     * converts the bounds of bounds-based black widgets to absolute reject rects and picks
+     * the tree prunings of the activity, so none of it is looked up again per node.
      * 
-     * @param element Current Element to process
      * @param activity Current activity name
+     * @param rootXML Root Element of the UI tree
+     * @param page Per-page state, reset here
+     */
+    void Preference::beginPageResolution(InternedString activity, const ElementPtr &rootXML,
+                                         PageResolution &page) {
+        page.root = rootXML.get();
+        page.blackWidgets = nullptr;
+        page.rejectRects.clear();
+        page.boundsOnlyRules.clear();
+        page.prunings = nullptr;
+        page.pruningIndex = nullptr;
+
+        const PreferenceRules &rules = *page.rules;
+        if (this->_cachedRectsRules != page.rules.get()) {
+            // Rules were reloaded: rects cached from the previous rule set no longer apply
+            this->_cachedRectsRules = page.rules.get();
+            this->_cachedBlackWidgetRects.clear();
+            this->_blackRectGridByActivity.clear();
+        }
+        if (!rules.blackWidgetActions.empty()) {
+            // Performance optimization: blackWidgetActions for current activity, compiled once per rule set
+            page.blackWidgets = rules.blackWidgetsFor(activity);
+        }
+        if (page.blackWidgets != nullptr) {
+            const CustomActionPtrVec &actions = page.blackWidgets->actions;
+            if (page.matchesByRule.size() < actions.size()) {
+                page.matchesByRule.resize(actions.size());
+            }
+            page.rejectRects.resize(actions.size());
+            for (size_t rule = 0; rule < actions.size(); rule++) {
+                const CustomActionPtr &action = actions[rule];
+                if (action->bounds.size() < 4) {
+                    continue; // xpath-only widget
+                }
+                std::vector<float> bounds = action->bounds;
+                
+                // Convert relative bounds to absolute bounds if needed
+                // Security: More accurate check - all bounds should be in [0, 1.1] range for relative coordinates
+                bool isRelative = (bounds[0] >= 0.0f && bounds[0] <= 1.1f &&
+                                  bounds[1] >= 0.0f && bounds[1] <= 1.1f &&
+                                  bounds[2] >= 0.0f && bounds[2] <= 1.1f &&
+                                  bounds[3] >= 0.0f && bounds[3] <= 1.1f);
+                
+                if (isRelative) {
+                    int rootWidth = this->_rootScreenSize.right;
+                    int rootHeight = this->_rootScreenSize.bottom;
+                    bounds[0] = bounds[0] * static_cast<float>(rootWidth);
+                    bounds[1] = bounds[1] * static_cast<float>(rootHeight);
+                    bounds[2] = bounds[2] * static_cast<float>(rootWidth);
+                    bounds[3] = bounds[3] * static_cast<float>(rootHeight);
+                }
+                
+                page.rejectRects[rule] = std::make_shared<Rect>(bounds[0], bounds[1], bounds[2], bounds[3]);
+                if (!action->xpath) {
+                    page.boundsOnlyRules.push_back(static_cast<uint32_t>(rule));
+                }
+            }
+        }
+
+        // Performance optimization: Only the prunings of the current activity, and of
+        // those only the rules the node's fields can match (compiled XpathIndex)
+        rules.treePruningsFor(activity, page.prunings, page.pruningIndex);
+    }
+
+    /**
+     * @brief Run every per-node preference stage on element, then recurse into its children
      * 
-     * @note Performance optimization: Merges multiple operations into single traversal
-     *       to reduce tree traversal overhead.
+     * Stages, in order:
+     * 1. Black widget matching: records the node under each xpath rule it matches and
+     *    under each xpath-less bounds rule whose reject rect contains its center
+     *    (deletion waits for applyBlackWidgets)
+     * 2. Resource ID mapping (de-mix): Maps obfuscated resource IDs back to original
+     * 3. Page text caching: Collects page texts for input fuzzing
+     * 4. Tree pruning: Modifies element properties based on xpath rules
+     * 5. Valid text pruning: Marks valid texts and sets clickable if needed
+     * 
+     * @param element Current Element to process
+     * @param page Rules of the page, from beginPageResolution
      */
-    void Preference::resolveElement(const ElementPtr &element, const std::string &activity) {
+    void Preference::resolveNode(const ElementPtr &element, PageResolution &page) {
         if (!element)
             return;
+
+        if (page.blackWidgets != nullptr) {
+            const XpathIndex &xpaths = page.blackWidgets->xpaths;
+            if (!xpaths.empty()) {
+                xpaths.match(*element, this->_matchedRuleIds);
+                for (uint32_t rule: this->_matchedRuleIds) {
+                    page.matchesByRule[rule].push_back(element);
+                }
+            }
+            // Bounds-only rules never matched the root (they searched its descendants)
+            if (!page.boundsOnlyRules.empty() && element.get() != page.root) {
+                Point center = element->getBounds().center();
+                for (uint32_t rule: page.boundsOnlyRules) {
+                    if (page.rejectRects[rule]->contains(center)) {
+                        page.matchesByRule[rule].push_back(element);
+                    }
+                }
+            }
+        }
             
-        // Performance optimization: Merge deMixResMapping into resolveElement traversal
-        // This reduces tree traversal from 3 passes to 2 passes
         // Process resource ID mapping (deMixResMapping logic)
+        // Performance optimization: keyed by interned id, which the parser already set on
+        // the node, so the lookup is an integer probe with no string copy or compare
         if (!this->_resMixedMapping.empty()) {
-            std::string stringOfResourceID = element->getResourceID();
-            if (!stringOfResourceID.empty()) {
-                auto iterator = this->_resMixedMapping.find(stringOfResourceID);
+            InternedString resourceID = element->getInternedResourceID();
+            if (!resourceID.empty()) {
+                auto iterator = this->_resMixedMapping.find(resourceID);
                 if (iterator != this->_resMixedMapping.end()) {
-                    element->reSetResourceID((*iterator).second);
-                    BDLOG("de-mixed %s as %s", stringOfResourceID.c_str(), (*iterator).second.c_str());
+                    element->reSetResourceID(iterator->second);
+                    BDLOG("de-mixed %s as %s", resourceID.str().c_str(), iterator->second.str().c_str());
                 }
             }
         }
             
-        // Performance optimization: Cache page texts during resolveElement traversal
-        // This avoids a separate full tree traversal in cachePageTexts
-        if (!element->getText().empty()) {
-            if (this->_pageTextsCache.size() > PageTextsMaxCount) {
-                for (int i = 0; i < 20 && !this->_pageTextsCache.empty(); i++)
-                    this->_pageTextsCache.pop_front();
+        // Cache page texts during the traversal; with black widgets on the page they wait
+        // until we know whether the node survives
+        const ElementString &text = element->getText();
+        if (!text.empty()) {
+            if (page.blackWidgets != nullptr) {
+                page.pendingTexts.emplace_back(element);
+            } else {
+                this->cachePageText(text);
             }
-            this->_pageTextsCache.push_back(element->getText());
         }
         
         // resolve tree pruning
-        this->resolveTreePruning(element, activity);
+        if (page.prunings != nullptr) {
+            this->applyTreePruning(element, *page.prunings, *page.pruningIndex);
+        }
         // pruning Valid Texts
         if (this->_pruningValidTexts)
             this->pruningValidTexts(element);
             
         for (const auto &child: element->getChildren()) {
-            this->resolveElement(child, activity);
+            this->resolveNode(child, page);
+        }
+    }
+    /**
+     * @brief Group the rules by activity and compile each group's xpaths
+     * 
+     * Black widgets of activity A apply on pages of A; pages without an activity name
+     * get all of them. Tree prunings apply on the pages of their activity.
+     */
+    void PreferenceRules::compile() {
+        this->_blackWidgetsByActivity.clear();
+        this->_allBlackWidgets = BlackWidgets();
+        for (const CustomActionPtr &blackWidgetAction: this->blackWidgetActions) {
+            BlackWidgets &group = this->_blackWidgetsByActivity[InternedString::intern(blackWidgetAction->activity)];
+            group.actions.push_back(blackWidgetAction);
+            group.xpaths.add(blackWidgetAction->xpath);
+            this->_allBlackWidgets.actions.push_back(blackWidgetAction);
+            this->_allBlackWidgets.xpaths.add(blackWidgetAction->xpath);
+        }
+        
+        // Performance optimization: Group by activity for faster lookup
+        this->_treePruningsByActivity.clear();
+        for (const CustomActionPtr &prun: this->treePrunings) {
+            this->_treePruningsByActivity[InternedString::intern(prun->activity)].push_back(prun);
+        }
+        
+        // Compile each activity's xpaths; rule ids follow the grouped vectors
+        this->_treePruningIndexByActivity.clear();
+        for (const auto &activityPrunings: this->_treePruningsByActivity) {
+            XpathIndex &index = this->_treePruningIndexByActivity[activityPrunings.first];
+            for (const CustomActionPtr &prun: activityPrunings.second) {
+                index.add(prun->xpath);
+            }
+        }
+    }
+
+    const PreferenceRules::BlackWidgets *PreferenceRules::blackWidgetsFor(InternedString activity) const {
+        if (activity.empty()) {
+            return this->_allBlackWidgets.actions.empty() ? nullptr : &this->_allBlackWidgets;
         }
+        auto iter = this->_blackWidgetsByActivity.find(activity);
+        return iter == this->_blackWidgetsByActivity.end() ? nullptr : &iter->second;
+    }
+
+    bool PreferenceRules::treePruningsFor(InternedString activity, const CustomActionPtrVec *&prunings,
+                                          const XpathIndex *&index) const {
+        auto activityIt = this->_treePruningsByActivity.find(activity);
+        auto indexIt = this->_treePruningIndexByActivity.find(activity);
+        if (activityIt == this->_treePruningsByActivity.end() ||
+            indexIt == this->_treePruningIndexByActivity.end()) {
+            return false;
+        }
+        prunings = &activityIt->second;
+        index = &indexIt->second;
+        return true;
     }
 
     /**
-     * @brief Resolve and delete black widgets (blacklisted controls/regions)
+     * @brief Delete the black widgets resolveNode matched (blacklisted controls/regions)
      * 
      * Black widgets are pre-configured controls or regions that should be avoided
      * during exploration (e.g., logout button). This function:
-     * 1. Collects all blackWidgetActions for the current activity
-     * 2. Phase 1: Deletes xpath-only black widgets (no bounds specified)
-     * 3. Phase 2: Deletes bounds-based black widgets (with bounds)
-     * 4. Caches all black widget rects for point checking
+     * 1. Phase 1: Deletes xpath-only black widgets (no bounds specified)
+     * 2. Phase 2: Deletes bounds-based black widgets (with bounds)
+     * 3. Caches all black widget rects for point checking
      * 
      * @param rootXML Root Element of the UI tree
      * @param activity Current activity name
+     * @param page Matches collected by resolveNode
+     * @return true if any node was deleted
      * 
      * @note Performance optimization:
-     *       - Two-phase processing reduces redundant tree traversals
+     *       - Matches come from the page traversal itself, through the compiled XpathIndex
+     *         (O(nodes) hash lookups instead of O(rules x nodes) compares)
+     *       - Two-phase processing with no extra tree traversal
      *       - Unified caching prevents overwriting previous results
      *       - Early activity filtering reduces processing overhead
+     * 
+     * @note Per-rule match lists keep the DFS order. A node deleted by an earlier rule is
+     *       no longer in the tree, so each rule skips matches that were detached in the
+     *       meantime, as a fresh search would.
      */
-    void Preference::resolveBlackWidgets(const ElementPtr &rootXML, const std::string &activity) {
-        if (this->_blackWidgetActions.empty() || !rootXML) {
-            return;
-        }
-        
-        if (nullptr == this->_rootScreenSize) {
-            BLOGE("black widget match failed %s", "No root node in current page");
-            return;
-        }
-        
-        // Performance optimization: Collect all blackWidgetActions for current activity first
-        // This avoids repeated activity checks in the loop
-        std::vector<CustomActionPtr> actionsForActivity;
-        for (const CustomActionPtr &blackWidgetAction: this->_blackWidgetActions) {
-            if (activity.empty() || blackWidgetAction->activity == activity) {
-                actionsForActivity.push_back(blackWidgetAction);
-            }
-        }
-        if (actionsForActivity.empty()) {
-            return;
+    bool Preference::applyBlackWidgets(const ElementPtr &rootXML, InternedString activity,
+                                       PageResolution &page) {
+        if (nullptr == page.blackWidgets) {
+            return false;
         }
-        
-        // Performance optimization: Two-phase processing
-        // Phase 1: Process xpath-only blackWidgets (no bounds specified)
-        // Phase 2: Process bounds-based blackWidgets (with bounds)
-        // This reduces redundant tree traversals and simplifies logic
+        const CustomActionPtrVec &actionsForActivity = page.blackWidgets->actions;
+        bool deleted = false;
         
         std::vector<RectPtr> allCachedRects;  // Unified cache for all black widget rects
         
         // Phase 1: Process xpath-only blackWidgets
-        for (const CustomActionPtr &action: actionsForActivity) {
+        for (size_t rule = 0; rule < actionsForActivity.size(); rule++) {
+            const CustomActionPtr &action = actionsForActivity[rule];
             if (!action->xpath || action->bounds.size() >= 4) {
                 continue; // Skip bounds-based widgets in phase 1
             }
             
-            std::vector<ElementPtr> matchedElements;
-            this->findMatchedElements(matchedElements, action->xpath, rootXML);
-            
+            const std::vector<ElementPtr> &matchedElements = page.matchesByRule[rule];
             if (!matchedElements.empty()) {
-                // Security: Check xpath before accessing (defensive programming)
-                if (action->xpath) {
-                    BDLOG("black widget xpath %s, matched %d nodes", 
-                          action->xpath->toString().c_str(), (int) matchedElements.size());
-                } else {
-                    BDLOG("black widget (no xpath), matched %d nodes", (int) matchedElements.size());
-                }
+                BDLOG("black widget xpath %s, matched %d nodes", 
+                      action->xpath->toString().c_str(), (int) matchedElements.size());
                 
                 for (const auto &matchedElement: matchedElements) {
-                    if (matchedElement) {
+                    if (matchedElement && isInTree(matchedElement, rootXML)) {
                         BLOG("black widget, delete node: %s depends xpath",
-                             matchedElement->getResourceID().c_str());
-                        RectPtr bounds = matchedElement->getBounds();
-                        if (bounds) {
-                            allCachedRects.push_back(bounds);
-                        }
+                             matchedElement->getResourceID().str().c_str());
+                        // The cache (StringRectsMap) shares its rects; elements hold theirs inline
+                        allCachedRects.push_back(std::make_shared<Rect>(matchedElement->getBounds()));
                         matchedElement->deleteElement();
+                        deleted = true;
                     }
                 }
             }
         }
         
         // Phase 2: Process bounds-based blackWidgets
-        for (const CustomActionPtr &action: actionsForActivity) {
-            if (action->bounds.size() < 4) {
+        for (size_t rule = 0; rule < actionsForActivity.size(); rule++) {
+            const CustomActionPtr &action = actionsForActivity[rule];
+            const RectPtr &rejectRect = page.rejectRects[rule];
+            if (!rejectRect) {
                 continue; // Skip xpath-only widgets in phase 2
             }
-            
-            // Security: Double-check bounds size (defensive programming)
-            if (action->bounds.size() < 4) {
-                BLOGE("Invalid bounds size: %zu (expected 4)", action->bounds.size());
-                continue;
-            }
-            
-            std::vector<float> bounds = action->bounds;
-            
-            // Convert relative bounds to absolute bounds if needed
-            // Security: More accurate check - all bounds should be in [0, 1.1] range for relative coordinates
-            bool isRelative = (bounds[0] >= 0.0f && bounds[0] <= 1.1f &&
-                              bounds[1] >= 0.0f && bounds[1] <= 1.1f &&
-                              bounds[2] >= 0.0f && bounds[2] <= 1.1f &&
-                              bounds[3] >= 0.0f && bounds[3] <= 1.1f);
-            
-            if (isRelative) {
-                int rootWidth = this->_rootScreenSize->right;
-                int rootHeight = this->_rootScreenSize->bottom;
-                bounds[0] = bounds[0] * static_cast<float>(rootWidth);
-                bounds[1] = bounds[1] * static_cast<float>(rootHeight);
-                bounds[2] = bounds[2] * static_cast<float>(rootWidth);
-                bounds[3] = bounds[3] * static_cast<float>(rootHeight);
-            }
-            
-            RectPtr rejectRect = std::make_shared<Rect>(bounds[0], bounds[1], bounds[2], bounds[3]);
             allCachedRects.push_back(rejectRect);
             
-            // If xpath is specified, first filter by xpath, then by bounds
+            // Matches are filtered by xpath (if specified) or by the reject rect already;
+            // keep those still in the tree
             std::vector<ElementPtr> candidates;
+            for (const auto &matchedElement: page.matchesByRule[rule]) {
+                if (isInTree(matchedElement, rootXML)) {
+                    candidates.push_back(matchedElement);
+                }
+            }
             if (action->xpath) {
-                // Collect elements matching xpath
-                this->findMatchedElements(candidates, action->xpath, rootXML);
-                // Security: xpath is already checked, but add defensive check for logging
                 BDLOG("black widget xpath %s with bounds, matched %d nodes",
-                      action->xpath ? action->xpath->toString().c_str() : "(null)",
-                      (int) candidates.size());
-            } else {
-                // No xpath, check all elements in the reject rect
-                rootXML->recursiveElements([&rejectRect](const ElementPtr &child) -> bool {
-                    RectPtr b = child->getBounds();
-                    return b && rejectRect->contains(b->center());
-                }, candidates);
+                      action->xpath->toString().c_str(), (int) candidates.size());
             }
             
             // Delete elements that are in the reject rect
             for (const auto &element: candidates) {
                 if (element) {
-                    RectPtr elementBounds = element->getBounds();
-                    if (elementBounds && rejectRect->contains(elementBounds->center())) {
+                    if (rejectRect->contains(element->getBounds().center())) {
                         BLOG("black widget, delete node: %s depends bounds",
-                             element->getResourceID().c_str());
+                             element->getResourceID().str().c_str());
                         element->deleteElement();
+                        deleted = true;
                     }
                 }
             }
@@ -792,8 +1063,11 @@ namespace fastbotx {
         // Unified cache: Store all black widget rects for this activity
         // This replaces the previous per-action caching which would overwrite previous results
         if (!allCachedRects.empty()) {
+            // The grid is rebuilt only when the rects differ from the last page's
+            this->_blackRectGridByActivity[activity].assign(allCachedRects);
             this->_cachedBlackWidgetRects[activity] = allCachedRects;
         }
+        return deleted;
     }
 
     /**
@@ -811,36 +1085,20 @@ namespace fastbotx {
      * 
      * @note Performance optimization:
      *       - Early return if no cached rects
-     *       - Inline coordinate comparison (avoids Point object creation)
-     *       - Early exit on first match
+     *       - RectGrid lookup: O(1) cell plus the few rects overlapping it, instead of
+     *         a scan of every rect of the activity
      *       - Logging controlled by FASTBOT_LOG_BLACK_RECT_CHECK macro
      * 
      * @note This function is called frequently (before every click action),
      *       so performance is critical.
      */
-    bool Preference::checkPointIsInBlackRects(const std::string &activity, int pointX, int pointY) {
+    bool Preference::checkPointIsInBlackRects(InternedString activity, int pointX, int pointY) {
         // Performance optimization: Early return if no cached rects for this activity
-        auto iter = this->_cachedBlackWidgetRects.find(activity);
-        if (iter == this->_cachedBlackWidgetRects.end() || iter->second.empty()) {
+        auto iter = this->_blackRectGridByActivity.find(activity);
+        if (iter == this->_blackRectGridByActivity.end()) {
             return false;
         }
-        
-        // Performance optimization: Direct point comparison instead of creating Point object
-        // Rect::contains checks: point.x >= left && point.x <= right && point.y >= top && point.y <= bottom
-        // We can inline this check to avoid Point object creation
-        bool isInsideBlackList = false;
-        const std::vector<RectPtr> &rects = iter->second;
-        
-        // Performance: Use range-based for loop with early exit
-        // Most points will not be in black rects, so early exit is common
-        for (const auto &rect : rects) {
-            if (rect && 
-                pointX >= rect->left && pointX <= rect->right &&
-                pointY >= rect->top && pointY <= rect->bottom) {
-                isInsideBlackList = true;
-                break;
-            }
-        }
+        bool isInsideBlackList = iter->second.contains(pointX, pointY);
         
         // Performance optimization: Only log when enabled (this function is called frequently)
 #if FASTBOT_LOG_BLACK_RECT_CHECK
@@ -850,6 +1108,31 @@ namespace fastbotx {
         return isInsideBlackList;
     }
 
+    /**
+     * @brief Batch version of checkPointIsInBlackRects
+     * 
+     * Looks the activity up once for the whole batch; each point then costs one grid
+     * lookup (fuzz, drag and pinch gestures check many points per call).
+     * 
+     * @param activity Current activity name
+     * @param xs X coordinates of the points
+     * @param ys Y coordinates of the points
+     * @param count Number of points
+     * @param out out[i] is set to 1 if point i is inside a black rect, else 0
+     */
+    void Preference::checkPointsInBlackRects(InternedString activity, const float *xs,
+                                             const float *ys, size_t count, uint8_t *out) {
+        auto iter = this->_blackRectGridByActivity.find(activity);
+        if (iter == this->_blackRectGridByActivity.end()) {
+            std::fill(out, out + count, static_cast<uint8_t>(0));
+            return;
+        }
+        const RectGrid &grid = iter->second;
+        for (size_t i = 0; i < count; i++) {
+            out[i] = grid.contains(static_cast<int>(xs[i]), static_cast<int>(ys[i])) ? 1 : 0;
+        }
+    }
+
     /**
      * @brief Resolve tree pruning: modify element properties based on xpath rules
      * 
@@ -864,7 +1147,8 @@ namespace fastbotx {
      * 
      * @note Performance optimization:
      *       - Uses activity-grouped tree prunings for faster lookup
-     *       - Early exit if xpath doesn't match
+     *       - Tests only the rules filed under the node's resource-id / class / text /
+     *         content-desc hashes (XpathIndex) instead of every rule of the activity
      *       - Uses != operator instead of compare() for string comparison
      * 
      * @note Only modifies properties that are not set to InvalidProperty
@@ -874,61 +1158,50 @@ namespace fastbotx {
             return;
         }
         
-        // Performance optimization: Use activity-grouped tree prunings for faster lookup
-        // Only iterate through prunings for the current activity instead of all prunings
-        const CustomActionPtrVec *pruningsForActivity = nullptr;
-        auto activityIt = this->_treePruningsByActivity.find(activity);
-        if (activityIt != this->_treePruningsByActivity.end()) {
-            pruningsForActivity = &activityIt->second;
-        } else if (this->_treePruningsByActivity.empty() && !this->_treePrunings.empty()) {
-            // Fallback: If activity-grouped map is empty, use original vector (for backward compatibility)
-            // This should not happen if loadTreePruning is called correctly
-            // Build temporary vector for current activity
-            static thread_local CustomActionPtrVec tempPrunings;
-            tempPrunings.clear();
-            for (const auto &prun: this->_treePrunings) {
-                if (prun->activity == activity) {
-                    tempPrunings.push_back(prun);
-                }
-            }
-            if (!tempPrunings.empty()) {
-                pruningsForActivity = &tempPrunings;
-            }
-        }
-        
-        if (!pruningsForActivity || pruningsForActivity->empty()) {
-            return;
+        // Performance optimization: Only the prunings of the current activity, and of
+        // those only the rules the node's fields can match (compiled XpathIndex)
+        PreferenceRulesPtr rules = this->rules();
+        const CustomActionPtrVec *prunings = nullptr;
+        const XpathIndex *index = nullptr;
+        if (rules->treePruningsFor(InternedString::intern(activity), prunings, index)) {
+            this->applyTreePruning(elem, *prunings, *index);
         }
-        
-        // Performance optimization: Extract common logic to avoid code duplication
-        // Process all prunings for the current activity
-        for (const auto &prun: *pruningsForActivity) {
-            XpathPtr xpath = prun->xpath;
-            if (!xpath) {
-                continue;
-            }
-            
-            // Performance: Early exit if xpath doesn't match
-            if (!elem->matchXpathSelector(xpath)) {
-                continue;
-            }
-            
-            BLOG("pruning node %s for xpath: %s", elem->getResourceID().c_str(),
-                 xpath->toString().c_str());
+    }
+
+    /// resolveTreePruning with the activity's rules already looked up (resolveNode)
+    void Preference::applyTreePruning(const ElementPtr &elem, const CustomActionPtrVec &prunings,
+                                      const XpathIndex &index) {
+        std::vector<uint32_t> &matched = this->_matchedRuleIds;
+        index.match(*elem, matched);
+        // Rules apply in file order; each one sees the properties earlier rules rewrote
+        for (size_t k = 0; k < matched.size(); k++) {
+            const CustomActionPtr &prun = prunings[matched[k]];
+            BLOG("pruning node %s for xpath: %s", elem->getResourceID().str().c_str(),
+                 prun->xpath->toString().c_str());
             
+            bool changed = false;
             // Performance optimization: Use != operator instead of compare for string comparison
             // InvalidProperty is a constant string, so direct comparison is safe
             if (prun->resourceID != InvalidProperty) {
                 elem->reSetResourceID(prun->resourceID);
+                changed = true;
             }
             if (prun->contentDescription != InvalidProperty) {
                 elem->reSetContentDesc(prun->contentDescription);
+                changed = true;
             }
             if (prun->text != InvalidProperty) {
                 elem->reSetText(prun->text);
+                changed = true;
             }
             if (prun->classname != InvalidProperty) {
                 elem->reSetClassname(prun->classname);
+                changed = true;
+            }
+            if (changed) {
+                // The node now may match other later rules (or no longer match some)
+                index.match(*elem, matched, matched[k] + 1);
+                k = static_cast<size_t>(-1);
             }
         }
     }
@@ -936,9 +1209,9 @@ namespace fastbotx {
     /**
      * @brief Prune valid texts: mark valid texts and set clickable
      * 
-     * Recursively processes elements to find valid texts (texts that appear in _validTexts set).
+     * Checks whether the element shows a valid text (one that appears in _validTexts).
      * If a valid text is found:
-     * 1. Sets element->validText to the found text
+     * 1. Sets the element's valid text (setValidText) to the found text
      * 2. If parent is not clickable, sets current element as clickable
      * 
      * Valid texts are typically extracted from APK resources and represent legitimate
@@ -948,7 +1221,10 @@ namespace fastbotx {
      * 
      * @note Performance optimization:
      *       - Checks text first, then contentDescription (most elements have text)
+     *       - Looks them up by the hashes computed while parsing, without copying them
      *       - Caches parent lock result to avoid repeated weak_ptr operations
+     *       - Not recursive: resolveNode calls it once per node (walking the subtree from
+     *         every node visited each node once per ancestor)
      * 
      * @note Only processes if _pruningValidTexts flag is enabled
      */
@@ -959,30 +1235,35 @@ namespace fastbotx {
         
         // Performance optimization: Check text first, then content description
         // Most elements have text, so checking text first is more efficient
+        // The parser's hashes are reused; most lookups are rejected by the set's Bloom filter
+        const Element::FusedHashes *fused = element->getFusedHashes();
         bool valid = false;
-        const std::string &originalTextOfElement = element->getText();
+        const ElementString &originalTextOfElement = element->getText();
         if (!originalTextOfElement.empty()) {
-            // Performance: Use find() which returns iterator, more efficient than count()
-            auto textIt = this->_validTexts.find(originalTextOfElement);
-            if (textIt != this->_validTexts.end()) {
-                element->validText = originalTextOfElement;
+            const std::string *validText = this->_validTexts.find(
+                    originalTextOfElement.data(), originalTextOfElement.size(),
+                    fused ? fused->text : originalTextOfElement.hash());
+            if (validText) {
+                element->setValidText(*validText);
                 valid = true;
             }
         }
         
         // If text is not valid, try content description
         if (!valid) {
-            const std::string &contentDescription = element->getContentDesc();
+            const ElementString &contentDescription = element->getContentDesc();
             if (!contentDescription.empty()) {
-                auto contentIt = this->_validTexts.find(contentDescription);
-                if (contentIt != this->_validTexts.end()) {
-                    element->validText = contentDescription;
+                const std::string *validText = this->_validTexts.find(
+                        contentDescription.data(), contentDescription.size(),
+                        fused ? fused->contentDesc : contentDescription.hash());
+                if (validText) {
+                    element->setValidText(*validText);
                     valid = true;
                 }
             }
         }
         
-        BDLOG("set valid Text: %s ", element->validText.c_str());
+        BDLOG("set valid Text: %s ", element->getValidText().c_str());
         
         // Performance optimization: Cache parent lock result to avoid repeated weak_ptr operations
         // if we find valid text from text field or content description field,
@@ -997,11 +1278,6 @@ namespace fastbotx {
                 }
             }
         }
-
-        // Recursively process children
-        for (const auto &child: element->getChildren()) {
-            pruningValidTexts(child);
-        }
     }
 
     /**
@@ -1127,11 +1403,11 @@ namespace fastbotx {
      * 
      * @param rootXML Root Element to process
      * 
-     * @note This function is now merged into resolveElement() to reduce tree traversals.
+     * @note This function is now merged into resolveNode() to reduce tree traversals.
      *       It's kept as a separate function for backward compatibility but is no longer
      *       called directly from resolvePage().
      * 
-     * @deprecated Use resolveElement() instead, which includes this functionality.
+     * @deprecated Use resolvePage() instead, which includes this functionality.
      * 
      * @note Performance optimizations:
      *       - Uses const reference for getResourceID() to avoid string copy
@@ -1145,14 +1421,14 @@ namespace fastbotx {
             return;
         }
         
-        // Performance: Use const reference instead of copy to avoid string allocation
-        const std::string &stringOfResourceID = rootXML->getResourceID();
-        if (!stringOfResourceID.empty()) {
-            auto iterator = this->_resMixedMapping.find(stringOfResourceID);
+        // Performance: Interned id lookup, no string allocation
+        InternedString resourceID = rootXML->getInternedResourceID();
+        if (!resourceID.empty()) {
+            auto iterator = this->_resMixedMapping.find(resourceID);
             if (iterator != this->_resMixedMapping.end()) {
                 // Performance: Use -> instead of (*) for iterator access
                 rootXML->reSetResourceID(iterator->second);
-                BDLOG("de-mixed %s as %s", stringOfResourceID.c_str(), iterator->second.c_str());
+                BDLOG("de-mixed %s as %s", resourceID.str().c_str(), iterator->second.str().c_str());
             }
         }
 
@@ -1200,12 +1476,19 @@ namespace fastbotx {
      *       - Early exit for lines without ".R.id."
      *       - Manual string processing to avoid multiple passes
      *       - Reduced string allocations
+     *       - Both ids are interned once here; nodes carry interned resource ids, so
+     *         de-mixing a node is an integer hash probe returning the interned target
      */
     void Preference::loadMixResMapping(const std::string &resourceMappingPath) {
+        this->applyMixResMapping(readMixResMapping(resourceMappingPath));
+    }
+
+    Preference::ResMappingPairs Preference::readMixResMapping(const std::string &resourceMappingPath) {
         BLOG("loading resource mapping : %s", resourceMappingPath.c_str());
+        ResMappingPairs pairs;
         std::string content = loadFileContent(resourceMappingPath);
         if (content.empty()) {
-            return;
+            return pairs;
         }
         
         std::vector<std::string> lines;
@@ -1249,8 +1532,15 @@ namespace fastbotx {
             }
             
             BDLOG("res id %s mixed to %s", resId.c_str(), mixedResid.c_str());
-            this->_resMapping[resId] = mixedResid;
-            this->_resMixedMapping[mixedResid] = resId;
+            pairs.emplace_back(InternedString::intern(resId), InternedString::intern(mixedResid));
+        }
+        return pairs;
+    }
+
+    void Preference::applyMixResMapping(const ResMappingPairs &pairs) {
+        for (const auto &pair: pairs) {
+            this->_resMapping[pair.first] = pair.second;
+            this->_resMixedMapping[pair.second] = pair.first;
         }
     }
 
@@ -1292,7 +1582,7 @@ namespace fastbotx {
             return;
         }
         
-        this->_validTexts.clear();
+        std::vector<std::string> validTexts;
         std::vector<std::string> validStringLines;
         splitString(fileContent, validStringLines, '\n');
         
@@ -1314,15 +1604,17 @@ namespace fastbotx {
                     std::string extractedText = line.substr(colonPos + 2);
                     // Performance: Only insert non-empty strings
                     if (!extractedText.empty()) {
-                        this->_validTexts.emplace(std::move(extractedText));
+                        validTexts.emplace_back(std::move(extractedText));
                     }
                 }
             } else {
                 // Regular text format: use the whole line
-                this->_validTexts.emplace(line);
+                validTexts.emplace_back(line);
             }
         }
         
+        this->_validTexts.assign(std::move(validTexts));
+
         // Performance: Set flag only if we actually loaded texts
         if (!this->_validTexts.empty()) {
             this->_pruningValidTexts = true;
@@ -1355,67 +1647,321 @@ namespace fastbotx {
         // This ensures that if one config fails to load, others can still be loaded
         // Critical configs are loaded first
         
+        // Performance optimization: Loaders whose source files did not change since the last
+        // run restore their result from the compiled cache instead of parsing JSON / text
+        PreferenceCache storage;
+        PreferenceCache *cache = nullptr;
+#if FASTBOT_PREFERENCE_CACHE
+        storage.open(PreferenceCacheFilePath);
+        cache = &storage;
+#endif
+        
         // 1. Resource mapping (used for de-obfuscation)
         try {
-            loadMixResMapping(DefaultResMappingFilePath);
+            this->loadCached(cache, "mapping", {DefaultResMappingFilePath},
+                             [this]() { this->loadMixResMapping(DefaultResMappingFilePath); },
+                             [this](PreferenceCache::Writer &out) {
+                                 out.u32(static_cast<uint32_t>(this->_resMapping.size()));
+                                 for (const auto &entry: this->_resMapping) {
+                                     out.str(entry.first.str());
+                                     out.str(entry.second.str());
+                                 }
+                                 out.u32(static_cast<uint32_t>(this->_resMixedMapping.size()));
+                                 for (const auto &entry: this->_resMixedMapping) {
+                                     out.str(entry.first.str());
+                                     out.str(entry.second.str());
+                                 }
+                             },
+                             [this](PreferenceCache::Reader &in) {
+                                 std::unordered_map<InternedString, InternedString> maps[2];
+                                 for (auto &map: maps) {
+                                     uint32_t count = 0;
+                                     in.count(count, 2 * sizeof(uint32_t));
+                                     map.reserve(in.ok() ? count : 0);
+                                     for (uint32_t i = 0; i < count && in.ok(); i++) {
+                                         std::string from;
+                                         std::string to;
+                                         if (in.str(from) && in.str(to)) {
+                                             map[InternedString::intern(from)] = InternedString::intern(to);
+                                         }
+                                     }
+                                 }
+                                 if (!in.atEnd()) {
+                                     return false;
+                                 }
+                                 this->_resMapping.swap(maps[0]);
+                                 this->_resMixedMapping.swap(maps[1]);
+                                 return true;
+                             });
         } catch (const std::exception &ex) {
             BLOGE("Failed to load resource mapping: %s", ex.what());
         }
         
         // 2. Valid texts (used for text pruning)
         try {
-            loadValidTexts(ValidTextFilePath);
+            this->loadCached(cache, "validTexts", {ValidTextFilePath},
+                             [this]() { this->loadValidTexts(ValidTextFilePath); },
+                             [this](PreferenceCache::Writer &out) {
+                                 writeStrings(out, this->_validTexts.texts());
+                             },
+                             [this](PreferenceCache::Reader &in) {
+                                 std::vector<std::string> texts;
+                                 if (!readStrings(in, texts) || !in.atEnd()) {
+                                     return false;
+                                 }
+                                 this->_validTexts.assign(std::move(texts));
+                                 if (!this->_validTexts.empty()) {
+                                     this->_pruningValidTexts = true;
+                                 }
+                                 return true;
+                             });
         } catch (const std::exception &ex) {
             BLOGE("Failed to load valid texts: %s", ex.what());
         }
         
         // 3. Base config (contains critical settings like input fuzzing flags)
+        // A few key=value lines: parsed every time
         try {
             loadBaseConfig();
         } catch (const std::exception &ex) {
             BLOGE("Failed to load base config: %s", ex.what());
         }
         
+        // Black widgets and tree prunings form one rule set, published once both are loaded
+        auto rules = std::make_shared<PreferenceRules>();
+        this->_ruleStamps = this->ruleSourceStamps();
+        
         // 4. Black widgets (used for avoiding certain UI elements)
         try {
-            loadBlackWidgets();
+            this->loadCached(cache, "blackWidgets", {BlackWidgetFilePath},
+                             [this, &rules]() { this->loadBlackWidgets(*rules); },
+                             [&rules](PreferenceCache::Writer &out) {
+                                 writeActions(out, rules->blackWidgetActions);
+                             },
+                             [&rules](PreferenceCache::Reader &in) {
+                                 CustomActionPtrVec actions;
+                                 if (!readActions(in, actions) || !in.atEnd()) {
+                                     return false;
+                                 }
+                                 rules->blackWidgetActions.swap(actions);
+                                 return true;
+                             });
         } catch (const std::exception &ex) {
             BLOGE("Failed to load black widgets: %s", ex.what());
         }
         
         // 5. Custom actions (user-defined actions)
         try {
-            loadActions();
+            this->loadCached(cache, "actions", {ActionConfigFilePath},
+                             [this]() { this->loadActions(); },
+                             [this](PreferenceCache::Writer &out) {
+                                 out.u32(static_cast<uint32_t>(this->_customEvents.size()));
+                                 for (const CustomEventPtr &event: this->_customEvents) {
+                                     out.f32(event->prob);
+                                     out.i32(event->times);
+                                     out.str(event->activity);
+                                     writeActions(out, event->actions);
+                                 }
+                             },
+                             [this](PreferenceCache::Reader &in) {
+                                 uint32_t count = 0;
+                                 CustomEventPtrVec events;
+                                 in.count(count, 16);
+                                 for (uint32_t i = 0; i < count && in.ok(); i++) {
+                                     CustomEventPtr event = std::make_shared<CustomEvent>();
+                                     in.f32(event->prob);
+                                     in.i32(event->times);
+                                     in.str(event->activity);
+                                     if (readActions(in, event->actions)) {
+                                         events.push_back(event);
+                                     }
+                                 }
+                                 if (!in.atEnd()) {
+                                     return false;
+                                 }
+                                 this->_customEvents.swap(events);
+                                 this->indexCustomEvents();
+                                 return true;
+                             });
         } catch (const std::exception &ex) {
             BLOGE("Failed to load custom actions: %s", ex.what());
         }
         
         // 6. White/black lists (currently not actively used)
         try {
-            loadWhiteBlackList();
+            this->loadCached(cache, "whiteBlackList", {BlackListFilePath, WhiteListFilePath},
+                             [this]() { this->loadWhiteBlackList(); },
+                             [this](PreferenceCache::Writer &out) {
+                                 writeStrings(out, this->_blackList);
+                                 writeStrings(out, this->_whiteList);
+                             },
+                             [this](PreferenceCache::Reader &in) {
+                                 std::vector<std::string> blackList;
+                                 std::vector<std::string> whiteList;
+                                 if (!readStrings(in, blackList) || !readStrings(in, whiteList) ||
+                                     !in.atEnd()) {
+                                     return false;
+                                 }
+                                 this->_blackList.swap(blackList);
+                                 this->_whiteList.swap(whiteList);
+                                 return true;
+                             });
         } catch (const std::exception &ex) {
             BLOGE("Failed to load white/black lists: %s", ex.what());
         }
         
         // 7. Tree pruning (used for modifying element properties)
         try {
-            loadTreePruning();
+            this->loadCached(cache, "treePruning", {TreePruningFilePath},
+                             [this, &rules]() { this->loadTreePruning(*rules); },
+                             [&rules](PreferenceCache::Writer &out) {
+                                 writeActions(out, rules->treePrunings);
+                             },
+                             [&rules](PreferenceCache::Reader &in) {
+                                 CustomActionPtrVec prunings;
+                                 if (!readActions(in, prunings) || !in.atEnd()) {
+                                     return false;
+                                 }
+                                 rules->treePrunings.swap(prunings);
+                                 return true;
+                             });
         } catch (const std::exception &ex) {
             BLOGE("Failed to load tree pruning: %s", ex.what());
         }
+        rules->compile();
+        std::atomic_store(&this->_rules, PreferenceRulesPtr(rules));
         
         // 8. Input texts (used for input fuzzing)
         try {
-            loadInputTexts();
+            this->loadCached(cache, "inputTexts", {InputTextConfigFilePath, FuzzingTextsFilePath},
+                             [this]() { this->loadInputTexts(); },
+                             [this](PreferenceCache::Writer &out) {
+                                 writeStrings(out, this->_inputTexts);
+                                 writeStrings(out, this->_fuzzingTexts);
+                             },
+                             [this](PreferenceCache::Reader &in) {
+                                 std::vector<std::string> inputTexts;
+                                 std::vector<std::string> fuzzingTexts;
+                                 if (!readStrings(in, inputTexts) || !readStrings(in, fuzzingTexts) ||
+                                     !in.atEnd()) {
+                                     return false;
+                                 }
+                                 this->_inputTexts.swap(inputTexts);
+                                 this->_fuzzingTexts.swap(fuzzingTexts);
+                                 return true;
+                             });
         } catch (const std::exception &ex) {
             BLOGE("Failed to load input texts: %s", ex.what());
         }
+        
+        if (cache != nullptr && cache->dirty()) {
+            cache->save(PreferenceCacheFilePath);
+        }
 #endif
     }
 
+    /**
+     * @brief Run one loader, or restore its result from the compiled preference cache
+     * 
+     * The section is used only if it was written when the source files had the size and
+     * mtime they have now; otherwise (or if it does not decode) the loader parses the
+     * sources and its result is put back into the cache.
+     * 
+     * @param cache Compiled cache, nullptr to always parse the sources
+     * @param section Cache section of this loader
+     * @param sources Files the loader reads
+     * @param load Parse the sources into the Preference members
+     * @param encode Write what load built
+     * @param decode Restore the members from a section; false (and no change) if malformed
+     */
+    void Preference::loadCached(PreferenceCache *cache, const char *section,
+                                const std::vector<std::string> &sources,
+                                const std::function<void()> &load,
+                                const std::function<void(PreferenceCache::Writer &)> &encode,
+                                const std::function<bool(PreferenceCache::Reader &)> &decode) {
+        if (nullptr == cache) {
+            load();
+            return;
+        }
+        std::vector<PreferenceCache::SourceStamp> stamps;
+        stamps.reserve(sources.size());
+        for (const std::string &source: sources) {
+            stamps.push_back(PreferenceCache::stamp(source));
+        }
+        PreferenceCache::Reader payload;
+        if (cache->find(section, stamps, payload)) {
+            if (decode(payload)) {
+                BLOG("preference %s restored from cache", section);
+                return;
+            }
+            BLOGE("preference cache: section %s is malformed, parsing its sources", section);
+        }
+        load();
+        PreferenceCache::Writer writer;
+        encode(writer);
+        cache->put(section, stamps, std::move(writer.bytes()));
+    }
+
+    std::vector<PreferenceCache::SourceStamp> Preference::ruleSourceStamps() {
+        return {PreferenceCache::stamp(BlackWidgetFilePath), PreferenceCache::stamp(TreePruningFilePath)};
+    }
+
+    /**
+     * @brief Reload black widgets and tree prunings into a new rule set and publish it
+     *
+     * Runs on the caller's thread (JNI), not on the step thread: the files are parsed and
+     * compiled into a private PreferenceRules, which is then swapped in with one atomic
+     * store. A page that is being resolved finishes with the rule set it started with;
+     * rects cached from the old rules are dropped on the next page (beginPageResolution).
+     *
+     * The compiled preference cache is not rewritten; its sections no longer match the
+     * stamps of the edited files, so the next start parses them again.
+     *
+     * @param onlyIfChanged Skip the reload when the stamps of both files are unchanged
+     * @return true if a new rule set was published
+     */
+    bool Preference::reloadRules(bool onlyIfChanged) {
+        std::lock_guard<std::mutex> reloadLock(this->_reloadMutex);
+        std::vector<PreferenceCache::SourceStamp> stamps = ruleSourceStamps();
+        if (onlyIfChanged && stamps == this->_ruleStamps) {
+            return false;
+        }
+        auto rules = std::make_shared<PreferenceRules>();
+        try {
+            this->loadBlackWidgets(*rules);
+        } catch (const std::exception &ex) {
+            BLOGE("Failed to reload black widgets: %s", ex.what());
+        }
+        try {
+            this->loadTreePruning(*rules);
+        } catch (const std::exception &ex) {
+            BLOGE("Failed to reload tree pruning: %s", ex.what());
+        }
+        rules->compile();
+        this->_ruleStamps = stamps;
+        BLOG("preference rules reloaded: black widget %zu tree pruning %zu",
+             rules->blackWidgetActions.size(), rules->treePrunings.size());
+        std::atomic_store(&this->_rules, PreferenceRulesPtr(rules));
+        return true;
+    }
+
 #define MaxRandomPickSTR  "max.randomPickFromStringList"
 #define InputFuzzSTR "max.doinputtextFuzzing"
 #define ListenMode "max.listenMode"
+#define ModelSaveIntervalSTR "max.modelSaveIntervalSeconds"
+#define ModelSaveDirtyThresholdSTR "max.modelSaveDirtyThreshold"
+#define NStepSTR "max.nStep"
+#define GraphMaxStatesSTR "max.graphMaxStates"
+#define LeanOperateSTR "max.leanOperate"
+#define NativeLogLevelSTR "max.nativeLogLevel"
+#define SessionSnapshotSTR "max.sessionSnapshotSeconds"
+#define DecisionServerSTR "max.decisionServer"
+#define DecisionServerTimeoutSTR "max.decisionServerTimeoutMs"
+#define DecisionServerConnectionsSTR "max.decisionServerConnections"
+#define DecisionServerDeviceIdSTR "max.decisionServerDeviceId"
+#define StateWithTextSTR "max.stateWithText"
+#define StateWithIndexSTR "max.stateWithIndex"
+#define StateWithWidgetOrderSTR "max.stateWithWidgetOrder"
 
     /**
      * @brief Load base configuration file
@@ -1440,6 +1986,21 @@ namespace fastbotx {
      * - max.randomPickFromStringList: Use random preset strings for input
      * - max.doinputtextFuzzing: Enable input text fuzzing
      * - max.listenMode: Enable listen mode (skip all model actions)
+     * - max.modelSaveIntervalSeconds: Reuse model save interval
+     * - max.modelSaveDirtyThreshold: New reuse entries that trigger an early save (0: never)
+     * - max.nStep: N-step window length of the Double SARSA agent
+     * - max.graphMaxStates: States kept in the graph before the least recently seen are evicted
+     * - max.leanOperate: Send operates without the target widget descriptor
+     * - max.nativeLogLevel: Runtime log level (0 error, 1 info, 2 debug), at most the compiled one
+     * - max.sessionSnapshotSeconds: Session snapshot interval; a process restarted after a crash
+     *   resumes from the snapshot (0, the default: no snapshots)
+     * - max.decisionServer: host:port of the decision server that AlgorithmType::Server forwards steps to
+     * - max.decisionServerTimeoutMs: Wait for its answer before deciding locally (default 500)
+     * - max.decisionServerConnections: Connections kept to it (default 2)
+     * - max.decisionServerDeviceId: ID of this device on the server (default: random per process)
+     * - max.stateWithText, max.stateWithIndex, max.stateWithWidgetOrder: Turn on the state
+     *   abstraction option that STATE_WITH_TEXT, STATE_WITH_INDEX, STATE_WITH_WIDGET_ORDER
+     *   enable at build time (default false)
      * 
      * @note File format: key=value, one per line
      * 
@@ -1498,6 +2059,56 @@ namespace fastbotx {
             } else if (key == ListenMode) {
                 BDLOG("set %s", ListenMode);
                 this->setListenMode(value == "true");
+            } else if (key == ModelSaveIntervalSTR) {
+                long seconds = std::strtol(value.c_str(), nullptr, 10);
+                this->_modelSaveIntervalMs = seconds > 0 ? seconds * 1000 : 0;
+                BLOG("set %s to %ld s", ModelSaveIntervalSTR, seconds);
+            } else if (key == ModelSaveDirtyThresholdSTR) {
+                long threshold = std::strtol(value.c_str(), nullptr, 10);
+                this->_modelSaveDirtyThreshold = threshold >= 0 ? threshold : -1;
+                BLOG("set %s to %ld", ModelSaveDirtyThresholdSTR, threshold);
+            } else if (key == NStepSTR) {
+                long nStep = std::strtol(value.c_str(), nullptr, 10);
+                this->_nStep = nStep > 0 && nStep <= INT_MAX ? static_cast<int>(nStep) : 0;
+                BLOG("set %s to %ld", NStepSTR, nStep);
+            } else if (key == GraphMaxStatesSTR) {
+                long maxStates = std::strtol(value.c_str(), nullptr, 10);
+                this->_graphMaxStates = maxStates > 0 ? static_cast<size_t>(maxStates) : 0;
+                BLOG("set %s to %ld", GraphMaxStatesSTR, maxStates);
+            } else if (key == LeanOperateSTR) {
+                this->_leanOperate = (value == "true");
+                BLOG("set %s to %s", LeanOperateSTR, value.c_str());
+            } else if (key == NativeLogLevelSTR) {
+                long level = std::strtol(value.c_str(), nullptr, 10);
+                BLOG("set %s to %ld", NativeLogLevelSTR, level);
+                setRuntimeLogLevel(static_cast<int>(std::max(0L, std::min(level, 2L))));
+            } else if (key == SessionSnapshotSTR) {
+                long seconds = std::strtol(value.c_str(), nullptr, 10);
+                this->_sessionSnapshotIntervalMs = seconds > 0 ? seconds * 1000 : 0;
+                BLOG("set %s to %ld s", SessionSnapshotSTR, seconds);
+            } else if (key == DecisionServerSTR) {
+                this->_decisionServer = value;
+                BLOG("set %s to %s", DecisionServerSTR, value.c_str());
+            } else if (key == DecisionServerTimeoutSTR) {
+                long timeoutMs = std::strtol(value.c_str(), nullptr, 10);
+                this->_decisionServerTimeoutMs = timeoutMs > 0 && timeoutMs <= INT_MAX ? static_cast<int>(timeoutMs) : 500;
+                BLOG("set %s to %ld ms", DecisionServerTimeoutSTR, timeoutMs);
+            } else if (key == DecisionServerConnectionsSTR) {
+                long connections = std::strtol(value.c_str(), nullptr, 10);
+                this->_decisionServerConnections = connections > 0 && connections <= 64 ? static_cast<int>(connections) : 2;
+                BLOG("set %s to %ld", DecisionServerConnectionsSTR, connections);
+            } else if (key == DecisionServerDeviceIdSTR) {
+                this->_decisionServerDeviceId = value;
+                BLOG("set %s to %s", DecisionServerDeviceIdSTR, value.c_str());
+            } else if (key == StateWithTextSTR) {
+                this->_forceUseTextModel = (value == "true");
+                BLOG("set %s to %s", StateWithTextSTR, value.c_str());
+            } else if (key == StateWithIndexSTR) {
+                this->_stateWithIndex = (value == "true");
+                BLOG("set %s to %s", StateWithIndexSTR, value.c_str());
+            } else if (key == StateWithWidgetOrderSTR) {
+                this->_stateWithWidgetOrder = (value == "true");
+                BLOG("set %s to %s", StateWithWidgetOrderSTR, value.c_str());
             }
         }
     }
@@ -1506,29 +2117,29 @@ namespace fastbotx {
      * @brief Cache page texts recursively
      * 
      * Recursively collects all non-empty text from elements and caches them
-     * in _pageTextsCache. If cache exceeds PageTextsMaxCount, removes oldest entries.
+     * in the _pageTexts ring, which keeps the latest PageTextsMaxCount texts.
      * 
      * @param rootElement Root Element to start caching from
      * 
-     * @note This function is now merged into resolveElement() to reduce tree traversals.
+     * @note This function is now merged into resolveNode() to reduce tree traversals.
      *       It's kept as a separate function for backward compatibility but is no longer
      *       called directly from resolvePage().
      * 
-     * @deprecated Use resolveElement() instead, which includes this functionality.
+     * @deprecated Use resolvePage() instead, which includes this functionality.
      */
     /**
      * @brief Cache page texts recursively
      * 
      * Recursively collects all non-empty text from elements and caches them
-     * in _pageTextsCache. If cache exceeds PageTextsMaxCount, removes oldest entries.
+     * in the _pageTexts ring, which keeps the latest PageTextsMaxCount texts.
      * 
      * @param rootElement Root Element to start caching from
      * 
-     * @note This function is now merged into resolveElement() to reduce tree traversals.
+     * @note This function is now merged into resolveNode() to reduce tree traversals.
      *       It's kept as a separate function for backward compatibility but is no longer
      *       called directly from resolvePage().
      * 
-     * @deprecated Use resolveElement() instead, which includes this functionality.
+     * @deprecated Use resolvePage() instead, which includes this functionality.
      * 
      * @note Performance optimizations:
      *       - Cached children reference to avoid repeated getChildren() calls
@@ -1540,17 +2151,10 @@ namespace fastbotx {
             return;
         }
         
-        // Performance: Check cache size and trim if needed
-        if (this->_pageTextsCache.size() > PageTextsMaxCount) {
-            for (int i = 0; i < 20 && !this->_pageTextsCache.empty(); i++) {
-                this->_pageTextsCache.pop_front();
-            }
-        }
-        
         // Performance: Cache text reference to avoid repeated getText() calls
-        const std::string &text = rootElement->getText();
+        const ElementString &text = rootElement->getText();
         if (!text.empty()) {
-            this->_pageTextsCache.push_back(text);
+            this->cachePageText(text);
         }
         
         // Performance: Cache children reference to avoid repeated getChildren() calls
@@ -1566,6 +2170,70 @@ namespace fastbotx {
         }
     }
 
+    /// Copy one text into the _pageTexts ring, overwriting the oldest one once it is full
+    void Preference::cachePageText(const ElementString &text) {
+        if (this->_pageTexts.empty()) {
+            this->_pageTexts.resize(PageTextsMaxCount);
+        }
+        // Performance optimization: assign reuses the slot's buffer once the ring is warm
+        this->_pageTexts[this->_pageTextsHead].assign(text.data(), text.size());
+        this->_pageTextsHead = (this->_pageTextsHead + 1) % this->_pageTexts.size();
+        if (this->_pageTextsCount < this->_pageTexts.size()) {
+            this->_pageTextsCount++;
+        }
+    }
+
+
+    /// Add the rules, the cached black rects and the text pools to footprint
+    void Preference::accountMemory(MemoryFootprint &footprint) const {
+        PreferenceRulesPtr rules = std::atomic_load(&this->_rules);
+        if (rules) {
+            size_t ruleCount = rules->blackWidgetActions.size() + rules->treePrunings.size();
+            footprint.add("preference.rules", ruleCount,
+                          ruleCount * MemoryFootprint::sharedBytes<CustomAction>() +
+                          MemoryFootprint::bytesOf(rules->blackWidgetActions) +
+                          MemoryFootprint::bytesOf(rules->treePrunings));
+        }
+        footprint.add("preference.customEvents", this->_customEvents.size(),
+                      this->_customEvents.size() * MemoryFootprint::sharedBytes<CustomEvent>() +
+                      MemoryFootprint::bytesOf(this->_customEvents) + MemoryFootprint::bytesOf(this->_eventTimes) +
+                      MemoryFootprint::bytesOf(this->_customEventsByActivity));
+
+        size_t rects = 0;
+        size_t rectBytes = MemoryFootprint::bytesOf(this->_cachedBlackWidgetRects) +
+                           MemoryFootprint::bytesOf(this->_blackRectGridByActivity);
+        for (const auto &activityRects: this->_cachedBlackWidgetRects) {
+            rects += activityRects.second.size();
+            rectBytes += MemoryFootprint::bytesOf(activityRects.second) +
+                         activityRects.second.size() * MemoryFootprint::sharedBytes<Rect>();
+        }
+        for (const auto &activityGrid: this->_blackRectGridByActivity) {
+            rectBytes += activityGrid.second.heapBytes();
+        }
+        footprint.add("preference.blackRects", rects, rectBytes);
+
+        size_t texts = 0;
+        size_t textBytes = MemoryFootprint::bytesOf(this->_pageTexts) + this->_validTexts.heapBytes();
+        for (const std::vector<std::string> *pool: {&this->_inputTexts, &this->_fuzzingTexts,
+                                                    &this->_whiteList, &this->_blackList}) {
+            texts += pool->size();
+            textBytes += MemoryFootprint::bytesOf(*pool);
+            for (const std::string &text: *pool) {
+                textBytes += MemoryFootprint::bytesOf(text);
+            }
+        }
+        for (const std::string &text: this->_validTexts.texts()) {
+            textBytes += MemoryFootprint::bytesOf(text);
+        }
+        for (const std::string &text: this->_pageTexts) {
+            textBytes += MemoryFootprint::bytesOf(text);
+        }
+        texts += this->_validTexts.size() + this->_pageTextsCount;
+        footprint.add("preference.texts", texts, textBytes);
+
+        footprint.add("preference.resMapping", this->_resMapping.size() + this->_resMixedMapping.size(),
+                      MemoryFootprint::bytesOf(this->_resMapping) + MemoryFootprint::bytesOf(this->_resMixedMapping));
+    }
 
     /**
      * @brief Set listen mode
@@ -1678,6 +2346,14 @@ namespace fastbotx {
         } catch (nlohmann::json::exception &ex) {
             BLOGE("parse actions error happened: id,%d: %s", ex.id, ex.what());
         }
+        this->indexCustomEvents();
+    }
+
+    void Preference::indexCustomEvents() {
+        this->_customEventsByActivity.clear();
+        for (const CustomEventPtr &customEvent: this->_customEvents) {
+            this->_customEventsByActivity[InternedString::intern(customEvent->activity)].push_back(customEvent);
+        }
     }
 
     /**
@@ -1715,7 +2391,7 @@ namespace fastbotx {
      *       - Optimized bounds parsing with format detection
      *       - Reduced logging overhead
      */
-    void Preference::loadBlackWidgets() {
+    void Preference::loadBlackWidgets(PreferenceRules &rules) {
         std::string fileContent = fastbotx::Preference::loadFileContent(BlackWidgetFilePath);
         if (fileContent.empty()) {
             return;
@@ -1733,7 +2409,7 @@ namespace fastbotx {
                 }
                 
                 act->activity = getJsonValue<std::string>(action, "activity", "");
-                this->_blackWidgetActions.push_back(act);
+                rules.blackWidgetActions.push_back(act);
                 
                 std::string boundsstr = getJsonValue<std::string>(action, "bounds", "");
                 if (!boundsstr.empty()) {
@@ -1914,7 +2590,7 @@ namespace fastbotx {
      *       - Pre-allocates vectors to avoid reallocations
      *       - Clears old data before loading new
      */
-    void Preference::loadTreePruning() {
+    void Preference::loadTreePruning(PreferenceRules &rules) {
         std::string fileContent = fastbotx::Preference::loadFileContent(TreePruningFilePath);
         if (fileContent.empty()) {
             return;
@@ -1923,14 +2599,12 @@ namespace fastbotx {
         try {
             ::nlohmann::json actions = ::nlohmann::json::parse(fileContent);
             
-            // Performance optimization: Clear and rebuild activity-grouped map
-            this->_treePruningsByActivity.clear();
-            this->_treePrunings.clear();
+            rules.treePrunings.clear();
             
             // Performance: Pre-allocate capacity if we know the size
             if (actions.is_array()) {
                 size_t estimatedSize = actions.size();
-                this->_treePrunings.reserve(estimatedSize);
+                rules.treePrunings.reserve(estimatedSize);
             }
             
             for (const ::nlohmann::json &action: actions) {
@@ -1943,10 +2617,7 @@ namespace fastbotx {
                 act->contentDescription = getJsonValue<std::string>(action, "contentdesc",
                                                                     InvalidProperty);
                 act->classname = getJsonValue<std::string>(action, "classname", InvalidProperty);
-                this->_treePrunings.push_back(act);
-                
-                // Performance optimization: Group by activity for faster lookup
-                this->_treePruningsByActivity[act->activity].push_back(act);
+                rules.treePrunings.push_back(act);
             }
         } catch (nlohmann::json::exception &ex) {
             BLOGE("parse tree pruning error happened: id,%d: %s", ex.id, ex.what());
@@ -2025,6 +2696,7 @@ namespace fastbotx {
     std::string Preference::TreePruningFilePath = "/sdcard/max.tree.pruning";
     std::string Preference::ValidTextFilePath = "/sdcard/max.valid.strings";
     std::string Preference::FuzzingTextsFilePath = "/sdcard/max.fuzzing.strings";
+    std::string Preference::PreferenceCacheFilePath = "/sdcard/max.preference.cache";
     std::string Preference::PackageName;
 
 } // namespace fastbotx
@@ -9,21 +9,30 @@
 
 #include <string>
 #include <map>
+#include <unordered_map>
 #include <vector>
 #include <deque>
 #include <queue>
+#include <mutex>
 #include "Base.h"
 #include "Action.h"
 #include "DeviceOperateWrapper.h"
 #include "Element.h"
+#include "XpathIndex.h"
+#include "RectGrid.h"
+#include "HashedTextSet.h"
+#include "PreferenceCache.h"
+#include <functional>
 
 
 namespace fastbotx {
 
+    class MemoryFootprint;
+
     /// The class for describing the actions that user specified in preference file
     class CustomAction : public Action {
     public:
-        OperatePtr toOperate() const override;
+        OperatePtr toOperate(Rng &rng) const override;
 
         CustomAction();
 
@@ -60,7 +69,48 @@ namespace fastbotx {
 
     typedef std::shared_ptr<CustomEvent> CustomEventPtr;
     typedef std::vector<CustomEventPtr> CustomEventPtrVec;
-    typedef std::map<std::string, std::vector<RectPtr>> StringRectsMap;
+
+    /**
+     * @brief Black widgets and tree prunings, compiled per activity
+     * 
+     * Immutable once compile() ran: Preference publishes a rule set through an atomic
+     * shared_ptr, and a reload builds a new one instead of editing the published one,
+     * so a page being resolved keeps a consistent set.
+     */
+    class PreferenceRules {
+    public:
+        /// Black widget rules of one activity; rule id i of xpaths is actions[i]
+        struct BlackWidgets {
+            CustomActionPtrVec actions;
+            XpathIndex xpaths;
+        };
+
+        CustomActionPtrVec blackWidgetActions;
+        CustomActionPtrVec treePrunings;
+
+        /// Build the per-activity groups from blackWidgetActions and treePrunings
+        void compile();
+
+        /// Black widgets applying on activity (all of them for an empty name), nullptr if none
+        const BlackWidgets *blackWidgetsFor(InternedString activity) const;
+
+        /// Tree prunings of activity and their compiled xpaths; false if there are none
+        bool treePruningsFor(InternedString activity, const CustomActionPtrVec *&prunings,
+                             const XpathIndex *&index) const;
+
+    private:
+        /// Keyed by interned activity: a page's lookup is an id hash, not a string compare
+        std::unordered_map<InternedString, BlackWidgets> _blackWidgetsByActivity;
+        BlackWidgets _allBlackWidgets;
+        // Performance optimization: Group tree prunings by activity for faster lookup
+        std::unordered_map<InternedString, CustomActionPtrVec> _treePruningsByActivity;
+        /// Xpaths of _treePruningsByActivity[activity], rule id = position in that vector
+        std::unordered_map<InternedString, XpathIndex> _treePruningIndexByActivity;
+    };
+
+    typedef std::shared_ptr<const PreferenceRules> PreferenceRulesPtr;
+    /// Black widget rects by interned activity (the id is the activity handle of the JNI layer)
+    typedef std::unordered_map<InternedString, std::vector<RectPtr>> StringRectsMap;
 
     class Preference {
     public:
@@ -69,46 +119,132 @@ namespace fastbotx {
         static std::shared_ptr<Preference> inst();
 
         //@brief use custom preference correct the root xml, and return a custom action,
+        //@param rng the stepping device's generator (custom event rates)
         //@return nullptr if no custom action happened
         ActionPtr
-        resolvePageAndGetSpecifiedAction(const std::string &activity, const ElementPtr &rootXML);
+        resolvePageAndGetSpecifiedAction(InternedString activity, const ElementPtr &rootXML, Rng &rng);
 
-        //@brief patch operate: 1. fuzz input text 2. ..
-        void patchOperate(const OperatePtr &opt);
+        ActionPtr
+        resolvePageAndGetSpecifiedAction(const std::string &activity, const ElementPtr &rootXML, Rng &rng) {
+            return resolvePageAndGetSpecifiedAction(InternedString::intern(activity), rootXML, rng);
+        }
+
+        /**
+         * @brief Resolve the queued custom actions ahead, on the page resolvePageAndGetSpecifiedAction just resolved
+         * 
+         * Pops up to maxCount actions from the front of the queue while they are widget actions
+         * whose xpath matches rootXML, patching their bounds; the rest stay queued for the next page.
+         * 
+         * @param targets Filled with the matched widget of each returned action
+         */
+        std::vector<CustomActionPtr> planQueuedActions(const ElementPtr &rootXML, size_t maxCount,
+                                                       std::vector<ElementPtr> &targets);
+
+        /// Put actions planned ahead that did not run back at the front of the queue, in order
+        void requeueActions(const std::vector<CustomActionPtr> &actions);
+
+        //@brief patch operate: 1. fuzz input text 2. ..; rng is the stepping device's generator
+        void patchOperate(const OperatePtr &opt, Rng &rng);
 
         // load resource mapping file, override the mapings from default file max.mapping,
         void loadMixResMapping(const std::string &resourceMappingPath);
 
+        /// (original, mixed) resource id pairs of a mapping file
+        typedef std::vector<std::pair<InternedString, InternedString>> ResMappingPairs;
+
+        /// Parse a mapping file without touching any Preference (safe on any thread, before inst())
+        static ResMappingPairs readMixResMapping(const std::string &resourceMappingPath);
+
+        /// Add pairs read by readMixResMapping; loadMixResMapping is the two in sequence
+        void applyMixResMapping(const ResMappingPairs &pairs);
+
         // load label, text, button valid text dumped from apk
         void loadValidTexts(const std::string &pathOfValidTexts);
 
-        bool checkPointIsInBlackRects(const std::string &activity, int pointX, int pointY);
+        bool checkPointIsInBlackRects(InternedString activity, int pointX, int pointY);
+
+        bool checkPointIsInBlackRects(const std::string &activity, int pointX, int pointY) {
+            return checkPointIsInBlackRects(InternedString::intern(activity), pointX, pointY);
+        }
+
+        void checkPointsInBlackRects(InternedString activity, const float *xs, const float *ys,
+                                     size_t count, uint8_t *out);
+
+        void checkPointsInBlackRects(const std::string &activity, const float *xs, const float *ys,
+                                     size_t count, uint8_t *out) {
+            checkPointsInBlackRects(InternedString::intern(activity), xs, ys, count, out);
+        }
 
         void setListenMode(bool listen);
 
         bool skipAllActionsFromModel() const { return this->_skipAllActionsFromModel; }
 
+        /// Whether widget text takes part in state abstraction (max.stateWithText)
         bool isForceUseTextModel() const { return this->_forceUseTextModel; }
 
+        /// Whether the widget index takes part in widget hashes (max.stateWithIndex)
+        bool isStateWithIndex() const { return this->_stateWithIndex; }
+
+        /// Whether state hashes depend on widget order (max.stateWithWidgetOrder)
+        bool isStateWithWidgetOrder() const { return this->_stateWithWidgetOrder; }
+
         int getForceMaxBlockStateTimes() const { return this->_forceMaxBlockStateTimes; }
 
+        /// Model save interval from max.config in milliseconds, 0 if not configured
+        long getModelSaveIntervalMs() const { return this->_modelSaveIntervalMs; }
+
+        /// New reuse entries that trigger an early model save, -1 if not configured (0 disables)
+        long getModelSaveDirtyThreshold() const { return this->_modelSaveDirtyThreshold; }
+
+        /// N-step window of the Double SARSA agent from max.config, 0 if not configured
+        int getNStep() const { return this->_nStep; }
+
+        /// Bound on the states of the Graph from max.config, 0 if not configured
+        size_t getGraphMaxStates() const { return this->_graphMaxStates; }
+
+        /// Whether operates are sent without the target widget descriptor (max.leanOperate)
+        bool isLeanOperate() const { return this->_leanOperate; }
+
+        /// Session snapshot interval from max.config in milliseconds, 0 (no snapshots) if not configured
+        long getSessionSnapshotIntervalMs() const { return this->_sessionSnapshotIntervalMs; }
+
+        /// Decision server "host:port" of AlgorithmType::Server (max.decisionServer), empty if not configured
+        const std::string &getDecisionServer() const { return this->_decisionServer; }
+
+        /// Wait for a decision server answer before deciding locally (max.decisionServerTimeoutMs)
+        int getDecisionServerTimeoutMs() const { return this->_decisionServerTimeoutMs; }
+
+        /// Connections to the decision server (max.decisionServerConnections)
+        int getDecisionServerConnections() const { return this->_decisionServerConnections; }
+
+        /// Device ID sent to the decision server (max.decisionServerDeviceId), empty for a random one
+        const std::string &getDecisionServerDeviceId() const { return this->_decisionServerDeviceId; }
+
+        /**
+         * @brief Reload max.widget.black and max.tree.pruning without restarting the agent
+         * 
+         * Parses and compiles the new rules on the calling thread and swaps them in
+         * atomically; pages resolved from then on use them.
+         * 
+         * @param onlyIfChanged Skip the reload when neither file's size or mtime changed
+         * @return true if a new rule set was published
+         */
+        bool reloadRules(bool onlyIfChanged);
+
+        /// Add the rules, the cached black rects and the text pools to footprint
+        void accountMemory(MemoryFootprint &footprint) const;
+
         ~Preference();
 
     protected:
 
         ///after the activity matches, resolve the black widgets, tree pruning, valid texts
-        void resolvePage(const std::string &activity, const ElementPtr &rootXML);
+        void resolvePage(InternedString activity, const ElementPtr &rootXML);
 
         void deMixResMapping(const ElementPtr &rootXML);
 
         bool patchActionBounds(const CustomActionPtr &action, const ElementPtr &);
 
-        // recursive resolve the elems, than resolve the black widgets, tree pruning, valid texts
-        void resolveElement(const ElementPtr &element, const std::string &activity);
-
-        // recursive
-        void resolveBlackWidgets(const ElementPtr &rootXML, const std::string &activity);
-
         //  not recursive
         void resolveTreePruning(const ElementPtr &elem, const std::string &activity);
 
@@ -127,27 +263,77 @@ namespace fastbotx {
 
         void cachePageTexts(const ElementPtr &rootElement);
 
+        void cachePageText(const ElementString &text);
+
         void loadConfigs();
 
         void loadBaseConfig();
 
         void loadActions();
 
-        void loadBlackWidgets();
+        /// Group _customEvents by activity into _customEventsByActivity
+        void indexCustomEvents();
+
+        void loadBlackWidgets(PreferenceRules &rules);
 
         void loadWhiteBlackList();
 
         void loadInputTexts();
 
-        void loadTreePruning();
+        void loadTreePruning(PreferenceRules &rules);
+
+        void loadCached(PreferenceCache *cache, const char *section, const std::vector<std::string> &sources,
+                        const std::function<void()> &load,
+                        const std::function<void(PreferenceCache::Writer &)> &encode,
+                        const std::function<bool(PreferenceCache::Reader &)> &decode);
 
     private:
+        typedef PreferenceRules::BlackWidgets BlackWidgetRules;
+
+        /// The published rule set
+        PreferenceRulesPtr rules() const { return std::atomic_load(&this->_rules); }
+
+        /// Stamps of the rule files, in the order BlackWidgetFilePath, TreePruningFilePath
+        static std::vector<PreferenceCache::SourceStamp> ruleSourceStamps();
+
+        /// State of the single resolvePage traversal; kept as a member to reuse its buffers
+        struct PageResolution {
+            /// Rule set of the page being resolved, held until resolvePage returns
+            PreferenceRulesPtr rules;
+            const Element *root{nullptr};
+            /// nullptr when no black widget applies to the page
+            const BlackWidgetRules *blackWidgets{nullptr};
+            /// Nodes matched by black widget rule i, in DFS order
+            std::vector<std::vector<ElementPtr>> matchesByRule;
+            /// Absolute reject rect of each bounds-based black widget (nullptr for xpath-only)
+            std::vector<RectPtr> rejectRects;
+            /// Bounds-based black widgets without xpath, matched by node center
+            std::vector<uint32_t> boundsOnlyRules;
+            const CustomActionPtrVec *prunings{nullptr};
+            const XpathIndex *pruningIndex{nullptr};
+            /// Nodes whose texts are held back until the black widgets were deleted
+            std::vector<ElementPtr> pendingTexts;
+        };
+
+        void beginPageResolution(InternedString activity, const ElementPtr &rootXML,
+                                 PageResolution &page);
+
+        // recursive: black widget matching, de-mix, page texts, tree pruning, valid texts
+        void resolveNode(const ElementPtr &element, PageResolution &page);
+
+        bool applyBlackWidgets(const ElementPtr &rootXML, InternedString activity,
+                               PageResolution &page);
+
+        void applyTreePruning(const ElementPtr &elem, const CustomActionPtrVec &prunings,
+                              const XpathIndex &index);
 
         static std::shared_ptr<Preference> _preferenceInst;
 
         std::queue<ActionPtr> _currentActions;
 
         CustomEventPtrVec _customEvents;
+        /// _customEvents grouped by interned activity, in file order; rebuilt by indexCustomEvents
+        std::unordered_map<InternedString, CustomEventPtrVec> _customEventsByActivity;
         // remember the times of this event being visited.
         std::map<CustomEventPtr, int> _eventTimes;
 
@@ -156,29 +342,57 @@ namespace fastbotx {
 
         std::vector<std::string> _inputTexts;
         std::vector<std::string> _fuzzingTexts;
-        std::deque<std::string> _pageTextsCache;
-
-        CustomActionPtrVec _blackWidgetActions;
-        CustomActionPtrVec _treePrunings;
-        // Performance optimization: Group tree prunings by activity for faster lookup
-        std::map<std::string, CustomActionPtrVec> _treePruningsByActivity;
-
-        std::map<std::string, std::string> _resMapping;
-        std::map<std::string, std::string> _resMixedMapping;
+        /// Ring of the latest page texts; slots [0, _pageTextsCount) are filled. Owned copies:
+        /// free-form UI text must not reach the never-evicting StringInterner
+        std::vector<std::string> _pageTexts;
+        size_t _pageTextsHead{0};
+        size_t _pageTextsCount{0};
+
+        /// Black widgets and tree prunings; read with std::atomic_load, replaced by reloadRules
+        PreferenceRulesPtr _rules{std::make_shared<PreferenceRules>()};
+        /// Serializes reloads; the step thread never takes it
+        std::mutex _reloadMutex;
+        /// Stamps of the rule files the published rules were loaded from
+        std::vector<PreferenceCache::SourceStamp> _ruleStamps;
+        /// Scratch list of matched rule ids (resolvePage runs on one thread)
+        std::vector<uint32_t> _matchedRuleIds;
+        PageResolution _pageResolution;
+
+        /// Resource id mappings between interned ids
+        std::unordered_map<InternedString, InternedString> _resMapping;
+        std::unordered_map<InternedString, InternedString> _resMixedMapping;
 
         bool _randomInputText;
         bool _doInputFuzzing;
 
-        std::set<std::string> _validTexts;
+        /// Valid texts of the APK (max.valid.strings), looked up by the parser's text hashes
+        HashedTextSet _validTexts;
         bool _pruningValidTexts;
         bool _skipAllActionsFromModel;
         bool _forceUseTextModel{};
+        bool _stateWithIndex{};
+        bool _stateWithWidgetOrder{};
         int _forceMaxBlockStateTimes{};
-        RectPtr _rootScreenSize;
+        long _modelSaveIntervalMs{0};
+        long _modelSaveDirtyThreshold{-1};
+        int _nStep{0};
+        size_t _graphMaxStates{0};
+        bool _leanOperate{false};
+        long _sessionSnapshotIntervalMs{0};
+        std::string _decisionServer;
+        int _decisionServerTimeoutMs{500};
+        int _decisionServerConnections{2};
+        std::string _decisionServerDeviceId;
+        /// Bounds of the first page root, to scale relative black widget bounds
+        Rect _rootScreenSize;
 
         static std::string loadFileContent(const std::string &fileAbsolutePath);
 
         StringRectsMap _cachedBlackWidgetRects;
+        /// _cachedBlackWidgetRects indexed for point checks
+        std::unordered_map<InternedString, RectGrid> _blackRectGridByActivity;
+        /// Rule set the cached rects were computed from (only compared, never dereferenced)
+        const PreferenceRules *_cachedRectsRules{nullptr};
 
     public:
         static std::string InvalidProperty;
@@ -193,6 +407,7 @@ namespace fastbotx {
         static std::string TreePruningFilePath;     // /sdcard/max.tree.pruning
         static std::string ValidTextFilePath;       // /sdcard/max.valid.strings
         static std::string FuzzingTextsFilePath;    // /sdcard/max.fuzzing.strings
+        static std::string PreferenceCacheFilePath; // /sdcard/max.preference.cache
         static std::string PackageName;
     };
 
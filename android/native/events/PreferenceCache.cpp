@@ -0,0 +1,239 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef PreferenceCache_CPP_
+#define PreferenceCache_CPP_
+
+#include "PreferenceCache.h"
+#include "../utils.hpp"
+#include "Base.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fastbotx {
+
+    constexpr uint32_t PreferenceCache::Magic;
+    constexpr uint32_t PreferenceCache::Version;
+
+    namespace {
+        /// magic, version, checksum (u64), body size (u64)
+        constexpr size_t HeaderSize = 4 + 4 + 8 + 8;
+    }
+
+    PreferenceCache::SourceStamp PreferenceCache::stamp(const std::string &path) {
+        SourceStamp result;
+        struct stat fileStat{};
+        if (::stat(path.c_str(), &fileStat) == 0) {
+            result.size = static_cast<int64_t>(fileStat.st_size);
+#if defined(__APPLE__)
+            result.mtimeNs = static_cast<int64_t>(fileStat.st_mtimespec.tv_sec) * 1000000000LL +
+                             fileStat.st_mtimespec.tv_nsec;
+#else
+            result.mtimeNs = static_cast<int64_t>(fileStat.st_mtim.tv_sec) * 1000000000LL +
+                             fileStat.st_mtim.tv_nsec;
+#endif
+        }
+        return result;
+    }
+
+    bool PreferenceCache::Reader::raw(void *out, size_t size) {
+        if (!this->_ok || static_cast<size_t>(this->_end - this->_cursor) < size) {
+            this->_ok = false;
+            return false;
+        }
+        std::memcpy(out, this->_cursor, size);
+        this->_cursor += size;
+        return true;
+    }
+
+    bool PreferenceCache::Reader::str(std::string &value) {
+        uint32_t size = 0;
+        if (!this->u32(size) || static_cast<size_t>(this->_end - this->_cursor) < size) {
+            this->_ok = false;
+            return false;
+        }
+        value.assign(this->_cursor, size);
+        this->_cursor += size;
+        return true;
+    }
+
+    bool PreferenceCache::Reader::view(const char *&data, size_t size) {
+        if (!this->_ok || static_cast<size_t>(this->_end - this->_cursor) < size) {
+            this->_ok = false;
+            return false;
+        }
+        data = this->_cursor;
+        this->_cursor += size;
+        return true;
+    }
+
+    bool PreferenceCache::Reader::count(uint32_t &value, size_t minSize) {
+        if (!this->u32(value)) {
+            return false;
+        }
+        // A corrupted count must not turn into a huge reserve()
+        if (minSize != 0 && value > static_cast<size_t>(this->_end - this->_cursor) / minSize) {
+            this->_ok = false;
+            return false;
+        }
+        return true;
+    }
+
+    PreferenceCache::~PreferenceCache() {
+        this->unmap();
+    }
+
+    void PreferenceCache::unmap() {
+        this->_sections.clear();
+        if (this->_mapped != nullptr) {
+            munmap(this->_mapped, this->_mappedSize);
+            this->_mapped = nullptr;
+            this->_mappedSize = 0;
+        }
+    }
+
+    bool PreferenceCache::open(const std::string &path) {
+        this->unmap();
+        this->_dirty = false;
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat fileStat{};
+        if (fstat(fd, &fileStat) != 0 || fileStat.st_size < static_cast<off_t>(HeaderSize)) {
+            close(fd);
+            return false;
+        }
+        auto size = static_cast<size_t>(fileStat.st_size);
+        void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        // The mapping keeps its own reference to the file
+        close(fd);
+        if (data == MAP_FAILED) {
+            BLOGE("preference cache: mmap failed for %s", path.c_str());
+            return false;
+        }
+        this->_mapped = data;
+        this->_mappedSize = size;
+
+        const char *bytes = static_cast<const char *>(data);
+        Reader header(bytes, HeaderSize);
+        uint32_t magic = 0;
+        uint32_t version = 0;
+        int64_t checksum = 0;
+        int64_t bodySize = 0;
+        header.u32(magic);
+        header.u32(version);
+        header.i64(checksum);
+        header.i64(bodySize);
+        if (!header.ok() || magic != Magic || version != Version ||
+            static_cast<uint64_t>(bodySize) != size - HeaderSize ||
+            static_cast<uint64_t>(checksum) != XXH3_64bits(bytes + HeaderSize, size - HeaderSize)) {
+            BLOG("preference cache: %s is stale or corrupted, ignored", path.c_str());
+            this->unmap();
+            return false;
+        }
+
+        Reader body(bytes + HeaderSize, size - HeaderSize);
+        uint32_t sectionCount = 0;
+        body.count(sectionCount, 12);
+        for (uint32_t i = 0; i < sectionCount && body.ok(); i++) {
+            std::string name;
+            Section section;
+            uint32_t stampCount = 0;
+            body.str(name);
+            body.count(stampCount, 16);
+            section.stamps.resize(body.ok() ? stampCount : 0);
+            for (SourceStamp &sourceStamp: section.stamps) {
+                body.i64(sourceStamp.size);
+                body.i64(sourceStamp.mtimeNs);
+            }
+            uint32_t payloadSize = 0;
+            body.count(payloadSize, 1);
+            section.size = payloadSize;
+            if (!body.view(section.data, payloadSize)) {
+                break;
+            }
+            this->_sections[name] = std::move(section);
+        }
+        if (!body.atEnd()) {
+            BLOGE("preference cache: malformed sections in %s, ignored", path.c_str());
+            this->unmap();
+            return false;
+        }
+        return true;
+    }
+
+    bool PreferenceCache::find(const std::string &name, const std::vector<SourceStamp> &stamps,
+                               Reader &payload) const {
+        auto iter = this->_sections.find(name);
+        if (iter == this->_sections.end() || iter->second.stamps != stamps) {
+            return false;
+        }
+        payload = Reader(iter->second.data, iter->second.size);
+        return true;
+    }
+
+    void PreferenceCache::put(const std::string &name, const std::vector<SourceStamp> &stamps,
+                              std::string payload) {
+        Section &section = this->_sections[name];
+        section.stamps = stamps;
+        section.owned = std::move(payload);
+        section.data = section.owned.data();
+        section.size = section.owned.size();
+        this->_dirty = true;
+    }
+
+    bool PreferenceCache::save(const std::string &path) const {
+        Writer body;
+        body.u32(static_cast<uint32_t>(this->_sections.size()));
+        for (const auto &entry: this->_sections) {
+            const Section &section = entry.second;
+            body.str(entry.first);
+            body.u32(static_cast<uint32_t>(section.stamps.size()));
+            for (const SourceStamp &sourceStamp: section.stamps) {
+                body.i64(sourceStamp.size);
+                body.i64(sourceStamp.mtimeNs);
+            }
+            body.u32(static_cast<uint32_t>(section.size));
+            body.bytes().append(section.data, section.size);
+        }
+        Writer header;
+        header.u32(Magic);
+        header.u32(Version);
+        header.i64(static_cast<int64_t>(XXH3_64bits(body.bytes().data(), body.bytes().size())));
+        header.i64(static_cast<int64_t>(body.bytes().size()));
+
+        // First write to temporary file, then atomically replace the cache
+        std::string tempFilePath = path + ".tmp";
+        std::ofstream outputFile(tempFilePath, std::ios::binary);
+        if (!outputFile.is_open()) {
+            BLOGE("preference cache: failed to open %s for writing", tempFilePath.c_str());
+            return false;
+        }
+        outputFile.write(header.bytes().data(), static_cast<std::streamsize>(header.bytes().size()));
+        outputFile.write(body.bytes().data(), static_cast<std::streamsize>(body.bytes().size()));
+        outputFile.close();
+        if (outputFile.fail()) {
+            BLOGE("preference cache: failed to write %s", tempFilePath.c_str());
+            std::remove(tempFilePath.c_str());
+            return false;
+        }
+        if (std::rename(tempFilePath.c_str(), path.c_str()) != 0) {
+            BLOGE("preference cache: failed to rename %s -> %s", tempFilePath.c_str(), path.c_str());
+            std::remove(tempFilePath.c_str());
+            return false;
+        }
+        return true;
+    }
+
+}
+
+#endif //PreferenceCache_CPP_
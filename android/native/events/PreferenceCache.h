@@ -0,0 +1,161 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef PreferenceCache_H_
+#define PreferenceCache_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace fastbotx {
+
+    /**
+     * @brief Compiled cache of the preference files, loaded with one mmap
+     *
+     * Each section holds what one Preference loader built from its source files,
+     * together with the size and mtime of those files when it was written. A loader
+     * whose sources are unchanged decodes its section instead of parsing JSON / text
+     * again; a stale or missing section is parsed from source and put() back, and
+     * save() rewrites the cache file.
+     *
+     * The file is a device-local artifact (native byte order). Layout:
+     * magic, version, body checksum, body size, then the sections
+     * (name, source stamps, payload). Anything that does not verify is ignored.
+     */
+    class PreferenceCache {
+    public:
+        /// Size and modification time of a source file (size -1: file missing)
+        struct SourceStamp {
+            int64_t size{-1};
+            int64_t mtimeNs{0};
+
+            bool operator==(const SourceStamp &other) const {
+                return size == other.size && mtimeNs == other.mtimeNs;
+            }
+        };
+
+        static SourceStamp stamp(const std::string &path);
+
+        /// Append-only payload encoder
+        class Writer {
+        public:
+            void u8(uint8_t value) { this->_bytes.push_back(static_cast<char>(value)); }
+
+            void u32(uint32_t value) { this->raw(&value, sizeof(value)); }
+
+            void i32(int32_t value) { this->raw(&value, sizeof(value)); }
+
+            void i64(int64_t value) { this->raw(&value, sizeof(value)); }
+
+            void f32(float value) { this->raw(&value, sizeof(value)); }
+
+            void str(const std::string &value) {
+                this->u32(static_cast<uint32_t>(value.size()));
+                this->_bytes.append(value);
+            }
+
+            std::string &bytes() { return this->_bytes; }
+
+        private:
+            void raw(const void *data, size_t size) {
+                this->_bytes.append(static_cast<const char *>(data), size);
+            }
+
+            std::string _bytes;
+        };
+
+        /// Bounds-checked payload decoder; any read past the end fails and sticks
+        class Reader {
+        public:
+            Reader() = default;
+
+            Reader(const char *data, size_t size) : _cursor(data), _end(data + size) {}
+
+            bool u8(uint8_t &value) { return this->raw(&value, sizeof(value)); }
+
+            bool u32(uint32_t &value) { return this->raw(&value, sizeof(value)); }
+
+            bool i32(int32_t &value) { return this->raw(&value, sizeof(value)); }
+
+            bool i64(int64_t &value) { return this->raw(&value, sizeof(value)); }
+
+            bool f32(float &value) { return this->raw(&value, sizeof(value)); }
+
+            bool str(std::string &value);
+
+            /// Skip size bytes, returning where they start
+            bool view(const char *&data, size_t size);
+
+            /// Element count that the remaining bytes could hold at minSize bytes each
+            bool count(uint32_t &value, size_t minSize);
+
+            bool ok() const { return this->_ok; }
+
+            bool atEnd() const { return this->_ok && this->_cursor == this->_end; }
+
+        private:
+            bool raw(void *out, size_t size);
+
+            const char *_cursor{nullptr};
+            const char *_end{nullptr};
+            bool _ok{true};
+        };
+
+        PreferenceCache() = default;
+
+        PreferenceCache(const PreferenceCache &) = delete;
+
+        PreferenceCache &operator=(const PreferenceCache &) = delete;
+
+        ~PreferenceCache();
+
+        /// Map and verify a cache file; returns false (and holds nothing) if it is unusable
+        bool open(const std::string &path);
+
+        /**
+         * @brief Payload of a section, if it was written from sources with these stamps
+         *
+         * @param payload Reader over the payload (valid while this cache lives)
+         */
+        bool find(const std::string &name, const std::vector<SourceStamp> &stamps,
+                  Reader &payload) const;
+
+        /// Replace a section; save() writes it
+        void put(const std::string &name, const std::vector<SourceStamp> &stamps, std::string payload);
+
+        /// Whether put() was called since open()
+        bool dirty() const { return this->_dirty; }
+
+        /// Write every section to path (through a temporary file renamed over it)
+        bool save(const std::string &path) const;
+
+        static constexpr uint32_t Magic = 0x43504246;  // "FBPC"
+        /// Bump when a section encoding changes
+        static constexpr uint32_t Version = 1;
+
+    private:
+        struct Section {
+            std::vector<SourceStamp> stamps;
+            /// Points into the mapping, or into owned once put() replaced it
+            const char *data{nullptr};
+            size_t size{0};
+            std::string owned;
+        };
+
+        void unmap();
+
+        void *_mapped{nullptr};
+        size_t _mappedSize{0};
+        std::map<std::string, Section> _sections;
+        bool _dirty{false};
+    };
+
+}
+
+#endif //PreferenceCache_H_
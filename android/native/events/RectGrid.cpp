@@ -0,0 +1,108 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef RectGrid_CPP_
+#define RectGrid_CPP_
+
+#include "RectGrid.h"
+#include <algorithm>
+
+namespace fastbotx {
+
+    constexpr int64_t RectGrid::GridSide;
+
+    bool RectGrid::assign(const std::vector<RectPtr> &rects) {
+        std::vector<Box> boxes;
+        boxes.reserve(rects.size());
+        for (const auto &rect: rects) {
+            // Inverted rects contain no point
+            if (rect && rect->left <= rect->right && rect->top <= rect->bottom) {
+                boxes.push_back(Box{rect->left, rect->top, rect->right, rect->bottom});
+            }
+        }
+        if (boxes == this->_boxes) {
+            return false;
+        }
+        this->_boxes.swap(boxes);
+        this->build();
+        return true;
+    }
+
+    void RectGrid::clear() {
+        this->_boxes.clear();
+        this->_cellStart.clear();
+        this->_cellBoxes.clear();
+        this->_covered.clear();
+    }
+
+    void RectGrid::build() {
+        if (this->_boxes.empty()) {
+            this->clear();
+            return;
+        }
+        this->_minX = this->_boxes[0].left;
+        this->_minY = this->_boxes[0].top;
+        this->_maxX = this->_boxes[0].right;
+        this->_maxY = this->_boxes[0].bottom;
+        for (const Box &box: this->_boxes) {
+            this->_minX = std::min(this->_minX, box.left);
+            this->_minY = std::min(this->_minY, box.top);
+            this->_maxX = std::max(this->_maxX, box.right);
+            this->_maxY = std::max(this->_maxY, box.bottom);
+        }
+        this->_width = static_cast<int64_t>(this->_maxX) - this->_minX + 1;
+        this->_height = static_cast<int64_t>(this->_maxY) - this->_minY + 1;
+        // A handful of rects is scanned faster than any grid
+        int64_t side = this->_boxes.size() <= 4 ? 1 : GridSide;
+        this->_cols = std::min(side, this->_width);
+        this->_rows = std::min(side, this->_height);
+        size_t cells = static_cast<size_t>(this->_cols * this->_rows);
+
+        this->_covered.assign(cells, 0);
+        std::vector<uint32_t> counts(cells + 1, 0);
+        // Two passes over the same cell ranges: count, then fill (CSR layout)
+        for (int pass = 0; pass < 2; pass++) {
+            if (1 == pass) {
+                // counts[c + 1] held the count of cell c; turn it into start offsets
+                for (size_t c = 0; c < cells; c++) {
+                    counts[c + 1] += counts[c];
+                }
+                this->_cellStart = counts;
+                this->_cellBoxes.assign(counts[cells], 0);
+            }
+            for (uint32_t i = 0; i < this->_boxes.size(); i++) {
+                const Box &box = this->_boxes[i];
+                size_t col0 = cellOf(box.left - this->_minX, this->_width, this->_cols);
+                size_t col1 = cellOf(box.right - this->_minX, this->_width, this->_cols);
+                size_t row0 = cellOf(box.top - this->_minY, this->_height, this->_rows);
+                size_t row1 = cellOf(box.bottom - this->_minY, this->_height, this->_rows);
+                for (size_t row = row0; row <= row1; row++) {
+                    int64_t top = this->_minY + cellBegin(row, this->_height, this->_rows);
+                    int64_t bottom = this->_minY + cellBegin(row + 1, this->_height, this->_rows) - 1;
+                    for (size_t col = col0; col <= col1; col++) {
+                        size_t cell = row * this->_cols + col;
+                        int64_t left = this->_minX + cellBegin(col, this->_width, this->_cols);
+                        int64_t right = this->_minX + cellBegin(col + 1, this->_width, this->_cols) - 1;
+                        bool covers = box.left <= left && box.right >= right &&
+                                      box.top <= top && box.bottom >= bottom;
+                        if (0 == pass) {
+                            if (covers) {
+                                this->_covered[cell] = 1;
+                            } else {
+                                counts[cell + 1]++;
+                            }
+                        } else if (!covers) {
+                            this->_cellBoxes[counts[cell]++] = i;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+}
+
+#endif //RectGrid_CPP_
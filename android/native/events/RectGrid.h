@@ -0,0 +1,111 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef RectGrid_H_
+#define RectGrid_H_
+
+#include "Base.h"
+#include <cstdint>
+#include <vector>
+
+namespace fastbotx {
+
+    /**
+     * @brief Uniform grid over a set of rects, for "is this point inside any of them" queries
+     *
+     * The bounding box of the rects is split into up to GridSide x GridSide cells. Each
+     * cell lists the rects that overlap it but do not cover it; a cell covered entirely
+     * by one rect answers true without any compare. A query maps the point to its cell
+     * in O(1) and tests only that cell's list, instead of every rect.
+     *
+     * Bounds are inclusive on all sides, as in Rect::contains.
+     */
+    class RectGrid {
+    public:
+        /**
+         * @brief Index these rects, replacing the previous ones
+         *
+         * @return false (and nothing is rebuilt) if the rects are the ones already indexed
+         */
+        bool assign(const std::vector<RectPtr> &rects);
+
+        void clear();
+
+        bool empty() const { return this->_boxes.empty(); }
+
+        /// Heap bytes of the boxes and the cell index
+        size_t heapBytes() const {
+            return this->_boxes.capacity() * sizeof(Box) +
+                   (this->_cellStart.capacity() + this->_cellBoxes.capacity()) * sizeof(uint32_t) +
+                   this->_covered.capacity() * sizeof(uint8_t);
+        }
+
+        /// Whether (x, y) is inside any indexed rect
+        bool contains(int x, int y) const {
+            if (this->_boxes.empty() || x < this->_minX || x > this->_maxX ||
+                y < this->_minY || y > this->_maxY) {
+                return false;
+            }
+            size_t cell = cellOf(y - this->_minY, this->_height, this->_rows) * this->_cols +
+                          cellOf(x - this->_minX, this->_width, this->_cols);
+            if (this->_covered[cell]) {
+                return true;
+            }
+            for (uint32_t k = this->_cellStart[cell]; k < this->_cellStart[cell + 1]; k++) {
+                const Box &box = this->_boxes[this->_cellBoxes[k]];
+                if (x >= box.left && x <= box.right && y >= box.top && y <= box.bottom) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+    private:
+        struct Box {
+            int left;
+            int top;
+            int right;
+            int bottom;
+
+            bool operator==(const Box &other) const {
+                return left == other.left && top == other.top && right == other.right &&
+                       bottom == other.bottom;
+            }
+        };
+
+        /// Cells per axis at most; fewer rects get a coarser grid
+        static constexpr int64_t GridSide = 16;
+
+        /// Cell of offset in [0, extent) when extent is split into count cells
+        static size_t cellOf(int64_t offset, int64_t extent, int64_t count) {
+            return static_cast<size_t>(offset * count / extent);
+        }
+
+        /// First offset belonging to cell (inverse of cellOf)
+        static int64_t cellBegin(int64_t cell, int64_t extent, int64_t count) {
+            return (cell * extent + count - 1) / count;
+        }
+
+        void build();
+
+        std::vector<Box> _boxes;
+        int _minX{0};
+        int _minY{0};
+        int _maxX{0};
+        int _maxY{0};
+        int64_t _width{1};
+        int64_t _height{1};
+        int64_t _cols{1};
+        int64_t _rows{1};
+        /// Rects of cell c are _boxes[_cellBoxes[_cellStart[c] .. _cellStart[c + 1])]
+        std::vector<uint32_t> _cellStart;
+        std::vector<uint32_t> _cellBoxes;
+        std::vector<uint8_t> _covered;
+    };
+
+}
+
+#endif //RectGrid_H_
@@ -0,0 +1,117 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef DecisionClient_CPP_
+#define DecisionClient_CPP_
+
+#include "DecisionClient.h"
+#include "DecisionProtocol.h"
+#include "../utils.hpp"
+#include <utility>
+
+namespace fastbotx {
+
+    constexpr int DecisionClient::FailuresBeforeBackoff;
+    constexpr int DecisionClient::BackoffMs;
+
+    DecisionClient::DecisionClient(std::string host, int port, std::string deviceId, int timeoutMs,
+                                   size_t maxConnections)
+            : _host(std::move(host)), _port(port), _deviceId(std::move(deviceId)),
+              _timeoutMs(timeoutMs > 0 ? timeoutMs : 1), _maxConnections(maxConnections > 0 ? maxConnections : 1) {
+        BLOG("decision server %s:%d, device %s, timeout %d ms, %zu connections", this->_host.c_str(),
+             this->_port, this->_deviceId.c_str(), this->_timeoutMs, this->_maxConnections);
+    }
+
+    DecisionClient::~DecisionClient() {
+        for (int fd: this->_idle) {
+            DecisionProtocol::closeSocket(fd);
+        }
+    }
+
+    int DecisionClient::acquire() {
+        {
+            std::lock_guard<std::mutex> guard(this->_mutex);
+            if (this->_failures >= FailuresBeforeBackoff && std::chrono::steady_clock::now() < this->_retryAt) {
+                return -1;
+            }
+            if (!this->_idle.empty()) {
+                int fd = this->_idle.back();
+                this->_idle.pop_back();
+                return fd;
+            }
+            if (this->_open >= this->_maxConnections) {
+                return -1;
+            }
+            this->_open++;
+        }
+        int fd = DecisionProtocol::connectTo(this->_host, this->_port, this->_timeoutMs);
+        if (fd < 0) {
+            std::lock_guard<std::mutex> guard(this->_mutex);
+            this->_open--;
+        }
+        return fd;
+    }
+
+    void DecisionClient::release(int fd, bool healthy) {
+        std::lock_guard<std::mutex> guard(this->_mutex);
+        if (healthy) {
+            this->_idle.push_back(fd);
+            return;
+        }
+        DecisionProtocol::closeSocket(fd);
+        this->_open--;
+    }
+
+    void DecisionClient::recordResult(bool remote) {
+        uint64_t remoteSteps = remote ? ++this->_remoteSteps : this->_remoteSteps.load();
+        uint64_t localSteps = remote ? this->_localSteps.load() : ++this->_localSteps;
+        {
+            std::lock_guard<std::mutex> guard(this->_mutex);
+            if (remote) {
+                this->_failures = 0;
+            } else if (++this->_failures == FailuresBeforeBackoff) {
+                this->_retryAt = std::chrono::steady_clock::now() + std::chrono::milliseconds(BackoffMs);
+                BLOGE("decision server %s:%d failed %d times in a row, deciding locally for %d ms",
+                      this->_host.c_str(), this->_port, FailuresBeforeBackoff, BackoffMs);
+            } else if (this->_failures > FailuresBeforeBackoff) {
+                this->_retryAt = std::chrono::steady_clock::now() + std::chrono::milliseconds(BackoffMs);
+            }
+        }
+        if ((remoteSteps + localSteps) % 100 == 0) {
+            BLOG("decision server: %llu steps remote, %llu local", static_cast<unsigned long long>(remoteSteps),
+                 static_cast<unsigned long long>(localSteps));
+        }
+    }
+
+    OperatePtr DecisionClient::decide(const std::string &activity, const std::string &packageName,
+                                      const char *dump, size_t size) {
+        int fd = this->acquire();
+        if (fd < 0) {
+            this->recordResult(false);
+            return nullptr;
+        }
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(this->_timeoutMs);
+        uint32_t id = this->_nextRequestId++;
+        thread_local std::string encoded;
+        uint32_t answered = 0;
+        auto status = DecisionProtocol::Error;
+        bool healthy = DecisionProtocol::writeRequest(fd, id, this->_deviceId, activity, packageName, dump, size,
+                                                      deadline) &&
+                       DecisionProtocol::readResponse(fd, answered, status, encoded, deadline) &&
+                       answered == id;
+        this->release(fd, healthy);
+        OperatePtr operate = healthy && status == DecisionProtocol::Ok
+                             ? DeviceOperateWrapper::readBinary(encoded.data(), encoded.size()) : nullptr;
+        if (!healthy) {
+            BDLOG("decision server: step %u not answered in time", id);
+        }
+        this->recordResult(operate != nullptr);
+        return operate;
+    }
+
+}
+
+#endif //DecisionClient_CPP_
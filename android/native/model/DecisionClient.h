@@ -0,0 +1,84 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef DecisionClient_H_
+#define DecisionClient_H_
+
+#include "DeviceOperateWrapper.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace fastbotx {
+
+    /**
+     * @brief Device side of AlgorithmType::Server: forwards getAction dumps to a
+     * DecisionServer, which runs the Model on a host
+     *
+     * Steps go out over a pool of up to maxConnections connections, so steps of several
+     * threads do not queue behind one socket and a connection is not set up per step.
+     * A step not answered within timeoutMs returns null and the caller decides it with
+     * its local agent; its connection is dropped, since the late answer would be read as
+     * the next one. After FailuresBeforeBackoff failures in a row the server is left
+     * alone for BackoffMs, so a down server costs one timeout per backoff, not per step.
+     */
+    class DecisionClient {
+    public:
+        DecisionClient(std::string host, int port, std::string deviceId, int timeoutMs, size_t maxConnections);
+
+        ~DecisionClient();
+
+        DecisionClient(const DecisionClient &) = delete;
+
+        DecisionClient &operator=(const DecisionClient &) = delete;
+
+        /**
+         * @brief The server's operate for one dump (XML or a full binary tree)
+         * @return The operate, null to decide locally (server down, slow or unable to parse)
+         */
+        OperatePtr decide(const std::string &activity, const std::string &packageName, const char *dump,
+                          size_t size);
+
+        const std::string &deviceId() const { return this->_deviceId; }
+
+        static constexpr int FailuresBeforeBackoff = 3;
+        static constexpr int BackoffMs = 5000;
+
+    private:
+        /// An idle connection, a new one while fewer than maxConnections are open, else -1
+        int acquire();
+
+        /// Return fd to the pool, or close it if it may hold a late answer
+        void release(int fd, bool healthy);
+
+        void recordResult(bool remote);
+
+        const std::string _host;
+        const int _port;
+        const std::string _deviceId;
+        const int _timeoutMs;
+        const size_t _maxConnections;
+
+        std::mutex _mutex;
+        /// Under _mutex
+        std::vector<int> _idle;
+        size_t _open{0};
+        int _failures{0};
+        std::chrono::steady_clock::time_point _retryAt;
+
+        std::atomic<uint32_t> _nextRequestId{1};
+        std::atomic<uint64_t> _remoteSteps{0};
+        std::atomic<uint64_t> _localSteps{0};
+    };
+
+    typedef std::shared_ptr<DecisionClient> DecisionClientPtr;
+
+}
+
+#endif //DecisionClient_H_
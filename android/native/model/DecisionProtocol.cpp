@@ -0,0 +1,229 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef DecisionProtocol_CPP_
+#define DecisionProtocol_CPP_
+
+#include "DecisionProtocol.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace fastbotx {
+
+    namespace DecisionProtocol {
+
+        namespace {
+            const char RequestMagic[] = {'F', 'Q', 0, 1};
+            const char ResponseMagic[] = {'F', 'A', 0, 1};
+
+            template<typename T>
+            void putValue(char *out, size_t offset, T value) {
+                memcpy(out + offset, &value, sizeof(value));
+            }
+
+            template<typename T>
+            T getValue(const char *data, size_t offset) {
+                T value;
+                memcpy(&value, data + offset, sizeof(value));
+                return value;
+            }
+
+            /// Milliseconds left before deadline, at least 0
+            int remainingMs(Deadline deadline) {
+                auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        deadline - std::chrono::steady_clock::now()).count();
+                return left > 0 ? static_cast<int>(left) : 0;
+            }
+
+            /// Wait until fd is ready for events or deadline passed
+            bool waitReady(int fd, short events, Deadline deadline) {
+                struct pollfd pfd{fd, events, 0};
+                for (;;) {
+                    int ready = poll(&pfd, 1, remainingMs(deadline));
+                    if (ready > 0) {
+                        return true;
+                    }
+                    if (ready == 0 || errno != EINTR) {
+                        return false;
+                    }
+                }
+            }
+        }
+
+        int connectTo(const std::string &host, int port, int timeoutMs) {
+            struct addrinfo hints{};
+            hints.ai_family = AF_UNSPEC;
+            hints.ai_socktype = SOCK_STREAM;
+            struct addrinfo *addresses = nullptr;
+            std::string service = std::to_string(port);
+            if (getaddrinfo(host.c_str(), service.c_str(), &hints, &addresses) != 0) {
+                return -1;
+            }
+            Deadline deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+            int fd = -1;
+            for (struct addrinfo *address = addresses; address != nullptr && fd < 0; address = address->ai_next) {
+                fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+                if (fd < 0) {
+                    continue;
+                }
+                int flags = fcntl(fd, F_GETFL, 0);
+                fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+                bool connected = connect(fd, address->ai_addr, address->ai_addrlen) == 0;
+                if (!connected && errno == EINPROGRESS && waitReady(fd, POLLOUT, deadline)) {
+                    int error = 0;
+                    socklen_t length = sizeof(error);
+                    connected = getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) == 0 && error == 0;
+                }
+                if (!connected) {
+                    close(fd);
+                    fd = -1;
+                    continue;
+                }
+                fcntl(fd, F_SETFL, flags);
+                int noDelay = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+            }
+            freeaddrinfo(addresses);
+            return fd;
+        }
+
+        bool parseAddress(const std::string &address, std::string &host, int &port) {
+            size_t colon = address.rfind(':');
+            if (colon == std::string::npos || colon == 0 || colon + 1 == address.size()) {
+                return false;
+            }
+            host = address.substr(0, colon);
+            port = static_cast<int>(std::strtol(address.c_str() + colon + 1, nullptr, 10));
+            return port > 0 && port < 65536;
+        }
+
+        bool writeFully(int fd, const char *data, size_t size, Deadline deadline) {
+            while (size > 0) {
+                if (!waitReady(fd, POLLOUT, deadline)) {
+                    return false;
+                }
+#ifdef MSG_NOSIGNAL
+                ssize_t written = send(fd, data, size, MSG_NOSIGNAL);
+#else
+                ssize_t written = send(fd, data, size, 0);
+#endif
+                if (written < 0) {
+                    if (errno == EINTR || errno == EAGAIN) {
+                        continue;
+                    }
+                    return false;
+                }
+                data += written;
+                size -= static_cast<size_t>(written);
+            }
+            return true;
+        }
+
+        bool readFully(int fd, char *data, size_t size, Deadline deadline) {
+            while (size > 0) {
+                if (!waitReady(fd, POLLIN, deadline)) {
+                    return false;
+                }
+                ssize_t received = recv(fd, data, size, 0);
+                if (received < 0) {
+                    if (errno == EINTR || errno == EAGAIN) {
+                        continue;
+                    }
+                    return false;
+                }
+                if (received == 0) {
+                    return false;
+                }
+                data += received;
+                size -= static_cast<size_t>(received);
+            }
+            return true;
+        }
+
+        bool writeRequest(int fd, uint32_t id, const std::string &deviceId, const std::string &activity,
+                          const std::string &packageName, const char *dump, size_t dumpSize,
+                          Deadline deadline) {
+            std::string head(RequestHeaderSize, '\0');
+            memcpy(&head[0], RequestMagic, sizeof(RequestMagic));
+            putValue<uint32_t>(&head[0], 4, id);
+            putValue<uint32_t>(&head[0], 8, static_cast<uint32_t>(deviceId.size()));
+            putValue<uint32_t>(&head[0], 12, static_cast<uint32_t>(activity.size()));
+            putValue<uint32_t>(&head[0], 16, static_cast<uint32_t>(packageName.size()));
+            putValue<uint32_t>(&head[0], 20, static_cast<uint32_t>(dumpSize));
+            head += deviceId;
+            head += activity;
+            head += packageName;
+            return writeFully(fd, head.data(), head.size(), deadline) &&
+                   writeFully(fd, dump, dumpSize, deadline);
+        }
+
+        bool readRequest(int fd, Request &request, Deadline deadline) {
+            char head[RequestHeaderSize];
+            if (!readFully(fd, head, sizeof(head), deadline) ||
+                memcmp(head, RequestMagic, sizeof(RequestMagic)) != 0) {
+                return false;
+            }
+            request.id = getValue<uint32_t>(head, 4);
+            std::string *fields[] = {&request.deviceId, &request.activity, &request.packageName, &request.dump};
+            for (size_t i = 0; i < 4; i++) {
+                auto size = getValue<uint32_t>(head, 8 + i * 4);
+                if (size > (i == 3 ? MaxDumpSize : MaxNameSize)) {
+                    return false;
+                }
+                fields[i]->resize(size);
+            }
+            for (std::string *field: fields) {
+                if (!field->empty() && !readFully(fd, &(*field)[0], field->size(), deadline)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        bool writeResponse(int fd, uint32_t id, Status status, const std::string &operate, Deadline deadline) {
+            char head[ResponseHeaderSize];
+            memcpy(head, ResponseMagic, sizeof(ResponseMagic));
+            putValue<uint32_t>(head, 4, id);
+            putValue<int32_t>(head, 8, status);
+            putValue<uint32_t>(head, 12, status == Ok ? static_cast<uint32_t>(operate.size()) : 0);
+            return writeFully(fd, head, sizeof(head), deadline) &&
+                   (status != Ok || writeFully(fd, operate.data(), operate.size(), deadline));
+        }
+
+        bool readResponse(int fd, uint32_t &id, Status &status, std::string &operate, Deadline deadline) {
+            char head[ResponseHeaderSize];
+            if (!readFully(fd, head, sizeof(head), deadline) ||
+                memcmp(head, ResponseMagic, sizeof(ResponseMagic)) != 0) {
+                return false;
+            }
+            id = getValue<uint32_t>(head, 4);
+            status = static_cast<Status>(getValue<int32_t>(head, 8));
+            auto size = getValue<uint32_t>(head, 12);
+            if (size > MaxDumpSize) {
+                return false;
+            }
+            operate.resize(size);
+            return size == 0 || readFully(fd, &operate[0], size, deadline);
+        }
+
+        void closeSocket(int fd) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+    }
+
+}
+
+#endif //DecisionProtocol_CPP_
@@ -0,0 +1,82 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef DecisionProtocol_H_
+#define DecisionProtocol_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace fastbotx {
+
+    /**
+     * @brief Frames exchanged by DecisionClient (device) and DecisionServer (host) over TCP
+     *
+     * Little-endian, one request and one response at a time per connection:
+     * - request: magic "FQ\0\1" | request id u32 | lengths u32 of device id, activity,
+     *   package name and dump | those four byte strings. The dump is the one getAction
+     *   received: XML or a full binary tree ("FB\0\1", "FB\0\2").
+     * - response: magic "FA\0\1" | request id u32 | status i32 | operate length u32 |
+     *   the operate as DeviceOperateWrapper::writeBinary encodes it (Ok only).
+     */
+    namespace DecisionProtocol {
+        constexpr size_t RequestHeaderSize = 24;
+        constexpr size_t ResponseHeaderSize = 16;
+        /// Largest dump a server accepts
+        constexpr uint32_t MaxDumpSize = 64U << 20U;
+        /// Largest device id, activity or package name a server accepts
+        constexpr uint32_t MaxNameSize = 4096;
+
+        enum Status : int32_t {
+            Ok = 0,
+            /// The dump did not parse: decide locally
+            NoAction = 1,
+            Error = 2
+        };
+
+        struct Request {
+            uint32_t id{0};
+            std::string deviceId;
+            std::string activity;
+            std::string packageName;
+            std::string dump;
+        };
+
+        typedef std::chrono::steady_clock::time_point Deadline;
+
+        /// A TCP connection to host:port with TCP_NODELAY, -1 if none within timeoutMs
+        int connectTo(const std::string &host, int port, int timeoutMs);
+
+        /// Split "host:port"; false if either part is missing
+        bool parseAddress(const std::string &address, std::string &host, int &port);
+
+        /// Write all of data before deadline; false on error or timeout
+        bool writeFully(int fd, const char *data, size_t size, Deadline deadline);
+
+        /// Read size bytes before deadline; false on error, timeout or end of stream
+        bool readFully(int fd, char *data, size_t size, Deadline deadline);
+
+        /// Send one request whose dump stays in the caller's buffer
+        bool writeRequest(int fd, uint32_t id, const std::string &deviceId, const std::string &activity,
+                          const std::string &packageName, const char *dump, size_t dumpSize,
+                          Deadline deadline);
+
+        /// Receive one request, reusing the capacity of request's strings
+        bool readRequest(int fd, Request &request, Deadline deadline);
+
+        bool writeResponse(int fd, uint32_t id, Status status, const std::string &operate, Deadline deadline);
+
+        /// Receive one response; operate receives the encoding of an Ok response
+        bool readResponse(int fd, uint32_t &id, Status &status, std::string &operate, Deadline deadline);
+
+        void closeSocket(int fd);
+    }
+
+}
+
+#endif //DecisionProtocol_H_
@@ -0,0 +1,243 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef DecisionServer_CPP_
+#define DecisionServer_CPP_
+
+#include "DecisionServer.h"
+#include "DecisionProtocol.h"
+#include "DoubleSarsaAgent.h"
+#include "Element.h"
+#include "../utils.hpp"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace fastbotx {
+
+    constexpr int DecisionServer::RequestTimeoutMs;
+    constexpr size_t DecisionServer::DefaultMaxDevices;
+
+    DecisionServer::DecisionServer(bool sharedModel, size_t workerThreads, size_t maxDevices)
+            : _sharedModel(sharedModel), _maxDevices(maxDevices > 0 ? maxDevices : 1),
+              _executor(new StepExecutor(workerThreads > 0 ? workerThreads : 1)) {
+        if (sharedModel) {
+            this->_model = Model::create();
+        }
+        if (pipe(this->_wakeup) == 0) {
+            fcntl(this->_wakeup[0], F_SETFL, O_NONBLOCK);
+            fcntl(this->_wakeup[1], F_SETFL, O_NONBLOCK);
+        }
+    }
+
+    DecisionServer::~DecisionServer() {
+        this->stop();
+        // Runs the steps still queued before the connections close
+        this->_executor.reset();
+        for (int fd: this->_connections) {
+            DecisionProtocol::closeSocket(fd);
+        }
+        for (int fd: this->_finished) {
+            DecisionProtocol::closeSocket(fd);
+        }
+        DecisionProtocol::closeSocket(this->_listenFd);
+        DecisionProtocol::closeSocket(this->_wakeup[0]);
+        DecisionProtocol::closeSocket(this->_wakeup[1]);
+    }
+
+    bool DecisionServer::listen(const std::string &address, int port) {
+        struct addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = AI_PASSIVE | AI_NUMERICHOST | AI_NUMERICSERV;
+        struct addrinfo *resolved = nullptr;
+        std::string service = std::to_string(port);
+        int error = getaddrinfo(address.c_str(), service.c_str(), &hints, &resolved);
+        if (error != 0 || resolved == nullptr) {
+            BLOGE("decision server: bad bind address %s: %s", address.c_str(), gai_strerror(error));
+            return false;
+        }
+        int fd = socket(resolved->ai_family, SOCK_STREAM, 0);
+        if (fd < 0) {
+            BLOGE("decision server: socket failed: %s", strerror(errno));
+            freeaddrinfo(resolved);
+            return false;
+        }
+        int yes = 1;
+        int no = 0;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+        if (resolved->ai_family == AF_INET6) {
+            setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &no, sizeof(no));
+        }
+        bool bound = bind(fd, resolved->ai_addr, resolved->ai_addrlen) == 0 && ::listen(fd, 64) == 0;
+        freeaddrinfo(resolved);
+        if (!bound) {
+            BLOGE("decision server: cannot listen on %s port %d: %s", address.c_str(), port, strerror(errno));
+            close(fd);
+            return false;
+        }
+        struct sockaddr_storage local{};
+        socklen_t length = sizeof(local);
+        getsockname(fd, reinterpret_cast<struct sockaddr *>(&local), &length);
+        this->_listenFd = fd;
+        this->_port = ntohs(local.ss_family == AF_INET6
+                            ? reinterpret_cast<struct sockaddr_in6 *>(&local)->sin6_port
+                            : reinterpret_cast<struct sockaddr_in *>(&local)->sin_port);
+        BLOG("decision server: listening on %s port %d, %s, %zu workers, at most %zu devices", address.c_str(),
+             this->_port, this->_sharedModel ? "one shared model" : "a model per device",
+             this->_executor->threadCount(), this->_maxDevices);
+        return true;
+    }
+
+    void DecisionServer::stop() {
+        this->_stopping.store(true);
+        char byte = 0;
+        ssize_t ignored = write(this->_wakeup[1], &byte, 1);
+        (void) ignored;
+    }
+
+    size_t DecisionServer::deviceCount() const {
+        std::lock_guard<std::mutex> guard(this->_devicesMutex);
+        return this->_devices.size();
+    }
+
+    DecisionServer::DevicePtr DecisionServer::device(const std::string &deviceId, const std::string &packageName) {
+        std::lock_guard<std::mutex> guard(this->_devicesMutex);
+        auto iter = this->_devices.find(deviceId);
+        if (iter != this->_devices.end()) {
+            return iter->second;
+        }
+        if (this->_devices.size() >= this->_maxDevices) {
+            BLOGE("decision server: refusing device %s, already serving %zu devices", deviceId.c_str(),
+                  this->_devices.size());
+            return nullptr;
+        }
+        auto device = std::make_shared<Device>();
+        device->model = this->_sharedModel ? this->_model : Model::create();
+        AbstractAgentPtr agent = device->model->addAgent(this->_sharedModel ? deviceId : "",
+                                                         AlgorithmType::DoubleSarsa);
+        if (device->model->getPackageName().empty()) {
+            device->model->setPackageName(packageName);
+        }
+        if (auto doubleSarsaAgent = std::dynamic_pointer_cast<DoubleSarsaAgent>(agent)) {
+            doubleSarsaAgent->loadReuseModel(packageName);
+        }
+        this->_devices.emplace(deviceId, device);
+        BLOG("decision server: device %s (%s) connected, %zu devices", deviceId.c_str(), packageName.c_str(),
+             this->_devices.size());
+        return device;
+    }
+
+    void DecisionServer::serve(int fd) {
+        thread_local DecisionProtocol::Request request;
+        thread_local std::string encoded;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(RequestTimeoutMs);
+        if (!DecisionProtocol::readRequest(fd, request, deadline)) {
+            // Closed by the client, or not speaking the protocol
+            DecisionProtocol::closeSocket(fd);
+            return;
+        }
+        const char *dump = request.dump.data();
+        size_t size = request.dump.size();
+        auto status = DecisionProtocol::NoAction;
+        // Delta dumps need the tree of the previous step, which the client may have decided locally
+        if (!Element::isBinaryDelta(dump, size)) {
+            DevicePtr device = this->device(request.deviceId, request.packageName);
+            if (nullptr == device) {
+                status = DecisionProtocol::Error;
+            } else {
+                std::lock_guard<std::mutex> stepGuard(device->stepMutex);
+                ElementPtr element;
+                {
+                    StageTimer parseTimer(device->model->getPerfStats(), PerfStage::Parse);
+                    // Parsed in place, strings borrowed from the request until the tree is dropped
+                    bool binary = size >= 4 && dump[0] == 'F' && dump[1] == 'B' && dump[2] == 0 &&
+                                  (dump[3] == 1 || dump[3] == 2);
+                    element = binary ? Element::createFromBinary(dump, size, true)
+                                     : Element::createFromXml(dump, size, true);
+                }
+                OperatePtr operate = element ? device->model->getOperateOpt(
+                        element, request.activity, this->_sharedModel ? request.deviceId : "") : nullptr;
+                element.reset();
+                if (operate) {
+                    operate->writeBinary(encoded);
+                    status = DecisionProtocol::Ok;
+                }
+            }
+        }
+        deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(RequestTimeoutMs);
+        if (!DecisionProtocol::writeResponse(fd, request.id, status, encoded, deadline)) {
+            DecisionProtocol::closeSocket(fd);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> guard(this->_finishedMutex);
+            this->_finished.push_back(fd);
+        }
+        char byte = 0;
+        ssize_t ignored = write(this->_wakeup[1], &byte, 1);
+        (void) ignored;
+    }
+
+    void DecisionServer::run() {
+        std::vector<struct pollfd> polled;
+        std::vector<int> batch;
+        std::vector<int> idle;
+        while (!this->_stopping.load()) {
+            polled.clear();
+            polled.push_back({this->_wakeup[0], POLLIN, 0});
+            polled.push_back({this->_listenFd, POLLIN, 0});
+            for (int fd: this->_connections) {
+                polled.push_back({fd, POLLIN, 0});
+            }
+            if (poll(polled.data(), polled.size(), -1) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                BLOGE("decision server: poll failed: %s", strerror(errno));
+                break;
+            }
+            // _connections are polled[2..]: those with a request (or a hang-up) go to the batch
+            batch.clear();
+            idle.clear();
+            for (size_t i = 2; i < polled.size(); i++) {
+                (polled[i].revents != 0 ? batch : idle).push_back(polled[i].fd);
+            }
+            if (polled[0].revents & POLLIN) {
+                char drain[64];
+                while (read(this->_wakeup[0], drain, sizeof(drain)) > 0) {
+                }
+                std::lock_guard<std::mutex> guard(this->_finishedMutex);
+                idle.insert(idle.end(), this->_finished.begin(), this->_finished.end());
+                this->_finished.clear();
+            }
+            if (polled[1].revents & POLLIN) {
+                int fd = accept(this->_listenFd, nullptr, nullptr);
+                if (fd >= 0) {
+                    int noDelay = 1;
+                    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+                    idle.push_back(fd);
+                }
+            }
+            this->_connections.swap(idle);
+            if (batch.size() > 1) {
+                BDLOG("decision server: batch of %zu steps", batch.size());
+            }
+            for (int fd: batch) {
+                this->_executor->submit([this, fd]() { this->serve(fd); });
+            }
+        }
+    }
+
+}
+
+#endif //DecisionServer_CPP_
@@ -0,0 +1,107 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef DecisionServer_H_
+#define DecisionServer_H_
+
+#include "Model.h"
+#include "StepExecutor.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace fastbotx {
+
+    /**
+     * @brief Host side of AlgorithmType::Server: runs the Model for the devices whose
+     * DecisionClient connects to it (server/DecisionServerMain.cpp)
+     *
+     * Each device gets its own Model, or with sharedModel its own agent in one Model, which
+     * then learns from every device (Model::addAgent per device ID). Steps of one device run
+     * one at a time; steps of different devices in parallel on the worker threads. Every poll
+     * round dispatches, as one batch, all the connections that have a request waiting, so a
+     * burst of devices does not cost one wake-up per device. A connection is not polled while
+     * its step runs, as the client waits for the answer before sending on it again.
+     *
+     * The protocol has no authentication: the server binds loopback unless told otherwise
+     * (devices reach it through adb reverse), and serves at most maxDevices distinct device IDs;
+     * requests of further devices get Error and are decided on the device.
+     */
+    class DecisionServer {
+    public:
+        DecisionServer(bool sharedModel, size_t workerThreads, size_t maxDevices = DefaultMaxDevices);
+
+        ~DecisionServer();
+
+        DecisionServer(const DecisionServer &) = delete;
+
+        DecisionServer &operator=(const DecisionServer &) = delete;
+
+        /**
+         * @brief Bind to a numeric IPv4 or IPv6 address and port (0: any free port)
+         *
+         * "0.0.0.0" or "::" accept any interface ("::" IPv4 clients too); false on error.
+         */
+        bool listen(const std::string &address, int port);
+
+        /// Port bound by listen
+        int port() const { return this->_port; }
+
+        /// Serve until stop(), from the calling thread
+        void run();
+
+        /// Make run() return; safe from a signal handler
+        void stop();
+
+        size_t deviceCount() const;
+
+        /// Longest a connection may take to send the rest of a request once it started one
+        static constexpr int RequestTimeoutMs = 10000;
+
+        static constexpr size_t DefaultMaxDevices = 64;
+
+    private:
+        struct Device {
+            ModelPtr model;
+            /// Steps of the device run one at a time
+            std::mutex stepMutex;
+        };
+
+        typedef std::shared_ptr<Device> DevicePtr;
+
+        /// The device's context, its agent created on its first request; nullptr past maxDevices
+        DevicePtr device(const std::string &deviceId, const std::string &packageName);
+
+        /// On a worker: read one request of fd, answer it, and hand fd back to the poll loop
+        void serve(int fd);
+
+        const bool _sharedModel;
+        const size_t _maxDevices;
+        ModelPtr _model;
+        std::unique_ptr<StepExecutor> _executor;
+
+        int _listenFd{-1};
+        int _port{0};
+        /// Self-pipe waking the poll loop: a step finished, or stop()
+        int _wakeup[2]{-1, -1};
+        std::atomic<bool> _stopping{false};
+
+        /// Connections polled for their next request; poll loop only
+        std::vector<int> _connections;
+        /// Connections whose step finished, to poll again
+        std::mutex _finishedMutex;
+        std::vector<int> _finished;
+
+        mutable std::mutex _devicesMutex;
+        std::unordered_map<std::string, DevicePtr> _devices;
+    };
+
+}
+
+#endif //DecisionServer_H_
@@ -10,6 +10,8 @@
 
 #include "Graph.h"
 #include "../utils.hpp"
+#include "../Trace.h"
+#include "MemoryFootprint.h"
 #include <vector>
 
 
@@ -25,51 +27,48 @@ namespace fastbotx {
 
     }
 
-    /**
-     * @brief Default distribution pair for activity statistics
-     * First value: count of how many times the state is visited
-     * Second value: percentage of times that this state been accessed over all states
-     */
-    const std::pair<int, double> Graph::_defaultDistri = std::make_pair(0, 0.0);
-
     /**
      * @brief Add a state to the graph, or return existing state if already present
      * 
      * This method performs the following operations:
-     * 1. Checks if the state already exists in the graph (by hash comparison)
-     * 2. If new: assigns an ID and adds to the state set
+     * 1. Checks if the state already exists in its activity's partition (by hash comparison)
+     * 2. If new: assigns an ID and adds it to the partition
      * 3. If existing: fills details if the existing state has no details
      * 4. Notifies all listeners about the new/existing state
-     * 5. Updates activity statistics (visit count and percentage)
+     * 5. Updates activity statistics (visit count)
      * 6. Processes and indexes all actions from this state
      * 
      * @param state The state to add to the graph
      * @return StatePtr The state that was added or the existing matching state
      * 
-     * @note Performance: O(log n) for state lookup, O(m log k) for action processing
-     *       where n is number of states, m is number of actions, k is number of unique actions
+     * @note Performance: O(1) expected for state lookup, O(m) for action processing
+     *       where m is number of actions in the state
      */
     StatePtr Graph::addState(StatePtr state) {
+        FASTBOT_TRACE_FUNCTION();
         // Get the activity name (activity class name) of this new state
         auto activity = state->getActivityString();
-        static const std::string kEmptyActivityStr;
-        const std::string& activityStrForCount = (activity && activity.get()) ? *activity : kEmptyActivityStr;
+        InternedString activityKey = activityOf(state);
+        ActivityPartition &partition = this->_partitions[activityKey];
 
-        // Try to find state in state cache using hash-based comparison
-        auto ifStateExists = this->_states.find(state);
+        // Try to find state in its partition by its precomputed hash (O(1))
+        StatePtr existingState = partition.states.find(state->hash());
         
-        if (ifStateExists == this->_states.end()) {
-            // This is a brand-new state, add it to the state cache
-            state->setId(static_cast<int>(this->_states.size()));
-            this->_states.emplace(state);
-            this->_activityStateCount[activityStrForCount]++;
+        if (existingState == nullptr) {
+            // This is a brand-new state, add it to the partition
+            state->setId(this->_nextStateId++);
+            partition.states.emplace(state);
+            this->_stateCount++;
         } else {
-            // State already exists, fill details if needed
-            if ((*ifStateExists)->hasNoDetail()) {
-                (*ifStateExists)->fillDetails(state);
+            // State already exists, fill details if needed (leaves cold storage too)
+            if (existingState->hasNoDetail()) {
+                if (existingState->isCompacted()) {
+                    this->_coldStateCount--;
+                }
+                existingState->fillDetails(state);
             }
             // Use the existing state instead of the new one
-            state = *ifStateExists;
+            state = existingState;
         }
 
         // Notify all registered listeners about the new/existing state
@@ -78,29 +77,31 @@ namespace fastbotx {
         // Add this activity name to the visited activities set (every name is unique)
         if (activity && activity.get()) {
             this->_visitedActivities.emplace(activity);
+            this->_visitedActivityIds.insert(activityKey);
         }
 
-        // Update total distribution count
+        // Update total and activity visit counts
         this->_totalDistri++;
-        
-        // Update activity distribution statistics
-        // Performance optimization: avoid creating string copy, use reference to shared_ptr's string
-        const std::string& activityStr = activityStrForCount;
-        auto distriIt = this->_activityDistri.find(activityStr);
-        
-        if (distriIt == this->_activityDistri.end()) {
-            // First time seeing this activity, initialize with default values
-            this->_activityDistri[activityStr] = _defaultDistri;
-            distriIt = this->_activityDistri.find(activityStr);
-        }
-        
-        // Update visit count and percentage
-        distriIt->second.first++;
-        distriIt->second.second = 1.0 * distriIt->second.first / this->_totalDistri;
+        partition.visitCount++;
         
         // Process and index all actions from this state
         addActionFromState(state);
-        
+
+#if DROP_DETAIL_AFTER_SATE && FASTBOT_COLD_STATE_STEPS > 0
+        this->_lastAddedStep[state->hash()] = this->_totalDistri;
+        this->_recentStates.emplace_back(this->_totalDistri, StateKey{activityKey, state->hash()});
+        compactColdStates();
+#endif
+        if (this->_maxStates > 0) {
+            auto position = this->_lruPositions.find(state->hash());
+            if (position != this->_lruPositions.end()) {
+                this->_lruStates.splice(this->_lruStates.end(), this->_lruStates, position->second);
+            } else {
+                this->_lruPositions.emplace(state->hash(), this->_lruStates.insert(this->_lruStates.end(),
+                                                                                   StateKey{activityKey, state->hash()}));
+            }
+            evictStates();
+        }
         return state;
     }
 
@@ -124,67 +125,243 @@ namespace fastbotx {
         this->_listeners.emplace_back(listener);
     }
 
-    size_t Graph::getStateCountByActivity(const std::string &activity) const {
-        auto it = this->_activityStateCount.find(activity);
-        return it != this->_activityStateCount.end() ? it->second : 0;
+    StatePtr Graph::findState(InternedString activity, uintptr_t hash) const {
+        auto partition = this->_partitions.find(activity);
+        return partition != this->_partitions.end() ? partition->second.states.find(hash) : nullptr;
+    }
+
+    size_t Graph::getStateCountByActivity(InternedString activity) const {
+        auto partition = this->_partitions.find(activity);
+        return partition != this->_partitions.end() ? partition->second.states.size() : 0;
+    }
+
+    long Graph::getVisitCountByActivity(InternedString activity) const {
+        auto partition = this->_partitions.find(activity);
+        return partition != this->_partitions.end() ? partition->second.visitCount : 0;
+    }
+
+    std::vector<std::pair<InternedString, long>> Graph::getVisitCountsByActivity() const {
+        std::vector<std::pair<InternedString, long>> counts;
+        counts.reserve(this->_partitions.size());
+        for (const auto &partition: this->_partitions) {
+            counts.emplace_back(partition.first, partition.second.visitCount);
+        }
+        return counts;
+    }
+
+    bool Graph::restoreState(const StatePtr &state) {
+        InternedString activityKey = activityOf(state);
+        ActivityPartition &partition = this->_partitions[activityKey];
+        if (partition.states.find(state->hash()) != nullptr) {
+            return false;
+        }
+        state->setId(this->_nextStateId++);
+        partition.states.emplace(state);
+        this->_stateCount++;
+        if (state->isCompacted()) {
+            this->_coldStateCount++;
+        }
+        auto activity = state->getActivityString();
+        if (activity && activity.get()) {
+            this->_visitedActivities.emplace(activity);
+            this->_visitedActivityIds.insert(activityKey);
+        }
+        if (this->_maxStates > 0) {
+            this->_lruPositions.emplace(state->hash(), this->_lruStates.insert(this->_lruStates.end(),
+                                                                               StateKey{activityKey, state->hash()}));
+            evictStates();
+        }
+        return true;
+    }
+
+    void Graph::restoreVisitCount(InternedString activity, long visits) {
+        this->_partitions[activity].visitCount += visits;
+        this->_totalDistri += visits;
+    }
+
+    ActivityPartition *Graph::findPartition(InternedString activity) {
+        auto partition = this->_partitions.find(activity);
+        return partition != this->_partitions.end() ? &partition->second : nullptr;
+    }
+
+    InternedString Graph::activityOf(const StatePtr &state) {
+        auto activity = state->getActivityString();
+        return (activity && activity.get()) ? InternedString::intern(*activity) : InternedString();
     }
 
     /**
      * @brief Process and index all actions from a state
      * 
-     * This method performs the following operations for each action in the state:
-     * 1. Checks if the action already exists in visited actions set
-     * 2. If not visited, checks if it exists in unvisited actions set
-     * 3. If new action, assigns a new ID and updates action counter
-     * 4. Updates the appropriate set (visited/unvisited) based on action status
-     * 
-     * Performance optimization:
-     * - Checks visited set first (typically smaller and more frequently accessed)
-     * - Only checks unvisited set if action is not found in visited set
-     * - Uses hash-based set lookup for O(log n) complexity
+     * Actions with the same hash share one ID, given the first time the hash is seen.
+     * The action counter counts each hash once, and a hash is marked visited the
+     * first time one of its actions is added visited.
      * 
      * @param node The state node containing actions to process
      * 
-     * @note Time complexity: O(m log k) where m is number of actions, k is number of unique actions
+     * @note Time complexity: O(m) expected where m is number of actions in the state
      */
     void Graph::addActionFromState(const StatePtr &node) {
-        auto nodeActions = node->getActions();
+        ActivityPartition &partition = this->_partitions[activityOf(node)];
+        for (const auto &action: node->getActions()) {
+            auto inserted = partition.actionRecords.emplace(action->hash(), ActionRecord{0, false});
+            ActionRecord &record = inserted.first->second;
+            if (inserted.second) {
+                // New action: assign new ID based on total action count
+                record.id = static_cast<int>(this->_actionCounter.getTotal());
+                this->_actionCounter.countAction(action);
+                this->_actionRecordCount++;
+            }
+            action->setId(record.id);
+            if (!record.visited && action->isVisited()) {
+                record.visited = true;
+                partition.visitedActionCount++;
+                this->_visitedActionCount++;
+            }
+        }
         
-        for (const auto &action: nodeActions) {
-            // Performance optimization: check visited set first (typically smaller)
-            auto itervisted = this->_visitedActions.find(action);
-            if (itervisted != this->_visitedActions.end()) {
-                // Action already exists in visited set, reuse its ID
-                action->setId((*itervisted)->getIdi());
-                // No need to check unvisited set
+        BDLOG("unvisited action: %zu, visited action %zu", this->_actionRecordCount - this->_visitedActionCount,
+              this->_visitedActionCount);
+    }
+
+    void Graph::compactColdStates() {
+        size_t compacted = 0;
+        while (!this->_recentStates.empty() &&
+               this->_recentStates.front().first + FASTBOT_COLD_STATE_STEPS <= this->_totalDistri) {
+            std::pair<long, StateKey> added = this->_recentStates.front();
+            this->_recentStates.pop_front();
+            auto lastAdded = this->_lastAddedStep.find(added.second.hash);
+            if (lastAdded == this->_lastAddedStep.end() || lastAdded->second != added.first) {
+                continue;  // added again since; a later entry stands for it
+            }
+            this->_lastAddedStep.erase(lastAdded);
+            StatePtr state = findState(added.second.activity, added.second.hash);
+            if (state == nullptr || !state->hasNoDetail() || state->isCompacted()) {
+                continue;
+            }
+            // Held by an agent or a pending step: keep it warm until its next addState,
+            // which tracks it again
+            if (isHeldOutsideGraph(state)) {
+                continue;
+            }
+            state->compact();
+            compacted++;
+        }
+        if (compacted > 0) {
+            this->_coldStateCount += compacted;
+            BDLOG("cold states: compacted %zu, %zu of %zu states in cold storage", compacted,
+                  this->_coldStateCount, this->_stateCount);
+        }
+    }
+
+    bool Graph::isHeldOutsideGraph(const StatePtr &state) {
+        // The caller's pointer and the index make two
+        if (state.use_count() > 2) {
+            return true;
+        }
+        const ActivityStateAction *back = state->getBackAction().get();
+        for (const auto &action: state->getActions()) {
+            if (action.use_count() > (action.get() == back ? 2 : 1)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Graph::setMaxStates(size_t maxStates) {
+        this->_maxStates = maxStates;
+        this->_lruStates.clear();
+        this->_lruPositions.clear();
+        if (maxStates == 0) {
+            return;
+        }
+        // States added before the bound was set count as equally old
+        for (const auto &partition: this->_partitions) {
+            InternedString activity = partition.first;
+            partition.second.states.forEach([this, activity](const StatePtr &state) {
+                this->_lruPositions.emplace(state->hash(), this->_lruStates.insert(this->_lruStates.end(),
+                                                                                   StateKey{activity, state->hash()}));
+            });
+        }
+        BLOG("graph: keeping at most %zu states", maxStates);
+        evictStates();
+    }
+
+    void Graph::evictStates() {
+        size_t evicted = 0;
+        auto it = this->_lruStates.begin();
+        while (this->_stateCount > this->_maxStates && it != this->_lruStates.end()) {
+            StateKey key = *it;
+            StatePtr state = findState(key.activity, key.hash);
+            if (state != nullptr && isHeldOutsideGraph(state)) {
+                // In use (the state just added always is); try the next least recent one
+                ++it;
+                continue;
+            }
+            ++it;
+            if (state != nullptr) {
+                removeState(state);
+                evicted++;
             } else {
-                // Action not in visited set, check unvisited set
-                auto iterunvisited = this->_unvisitedActions.find(action);
-                if (iterunvisited != this->_unvisitedActions.end()) {
-                    // Action exists in unvisited set, reuse its ID
-                    action->setId((*iterunvisited)->getIdi());
-                } else {
-                    // New action, not in either set
-                    // Assign new ID based on total action count
-                    action->setId(static_cast<int>(this->_actionCounter.getTotal()));
-                    // Update action counter statistics
-                    this->_actionCounter.countAction(action);
-                }
-                
-                // Update sets based on visited status
-                // Move action to appropriate set if its visited status changed
-                if (action->isVisited()) {
-                    this->_visitedActions.emplace(action);
-                    // Remove from unvisited if it was there (shouldn't happen, but safe)
-                    this->_unvisitedActions.erase(action);
-                } else {
-                    this->_unvisitedActions.emplace(action);
-                }
+                this->_lruStates.erase(this->_lruPositions[key.hash]);
+                this->_lruPositions.erase(key.hash);
             }
         }
-        
-        BDLOG("unvisited action: %zu, visited action %zu", this->_unvisitedActions.size(),
-              this->_visitedActions.size());
+        if (evicted > 0) {
+            this->_evictedStateCount += evicted;
+            BDLOG("graph: evicted %zu states, %zu kept, %zu evicted in total", evicted, this->_stateCount,
+                  this->_evictedStateCount);
+        }
+    }
+
+    bool Graph::mergeState(const StatePtr &from, const StatePtr &into) {
+        if (from == nullptr || into == nullptr || from == into || into->isCompacted() || isHeldOutsideGraph(from)) {
+            return false;
+        }
+        into->absorb(*from);
+        // Actions of into may have become visited
+        addActionFromState(into);
+        removeState(from);
+        this->_mergedStateCount++;
+        BDLOG("graph: merged state %lu into %lu, %zu merged in total", (unsigned long) from->hash(),
+              (unsigned long) into->hash(), this->_mergedStateCount);
+        return true;
+    }
+
+    void Graph::removeState(const StatePtr &state) {
+        uintptr_t hash = state->hash();
+        ActivityPartition *partition = findPartition(activityOf(state));
+        if (partition == nullptr || !partition->states.erase(hash)) {
+            return;
+        }
+        this->_stateCount--;
+        if (state->isCompacted()) {
+            this->_coldStateCount--;
+        }
+        this->_lastAddedStep.erase(hash);
+        auto position = this->_lruPositions.find(hash);
+        if (position != this->_lruPositions.end()) {
+            this->_lruStates.erase(position->second);
+            this->_lruPositions.erase(position);
+        }
+    }
+
+    /// Add the states (with their widgets and actions) and the graph indexes to footprint
+    void Graph::accountMemory(MemoryFootprint &footprint) const {
+        size_t indexBytes = MemoryFootprint::bytesOf(this->_partitions);
+        for (const auto &partition: this->_partitions) {
+            partition.second.states.forEach([&footprint](const StatePtr &state) {
+                state->accountMemory(footprint);
+            });
+            indexBytes += partition.second.states.tableBytes() +
+                          MemoryFootprint::bytesOf(partition.second.actionRecords);
+        }
+        indexBytes += MemoryFootprint::bytesOf(this->_recentStates) +
+                            MemoryFootprint::bytesOf(this->_lastAddedStep) +
+                            MemoryFootprint::bytesOf(this->_lruStates) +
+                            MemoryFootprint::bytesOf(this->_lruPositions) +
+                            MemoryFootprint::bytesOf(this->_visitedActivities) +
+                            this->_visitedActivityIds.heapBytes();
+        footprint.add("graph.index", this->_stateCount + this->_actionRecordCount, indexBytes);
     }
 
     /**
@@ -192,12 +369,12 @@ namespace fastbotx {
      * Clears all internal data structures to free memory
      */
     Graph::~Graph() {
-        this->_states.clear();
-        this->_unvisitedActions.clear();
-        this->_visitedActions.clear();
-        this->_widgetActions.clear();
+        this->_partitions.clear();
+        this->_recentStates.clear();
+        this->_lastAddedStep.clear();
+        this->_lruStates.clear();
+        this->_lruPositions.clear();
         this->_listeners.clear();
-        this->_activityStateCount.clear();
     }
 
 }
@@ -10,17 +10,18 @@
 #include "State.h"
 #include "Base.h"
 #include "Action.h"
+#include "HashIndex.h"
+#include "../StringInterner.h"
+#include <deque>
+#include <list>
 #include <map>
+#include <mutex>
+#include <shared_mutex>
 #include <unordered_map>
+#include <vector>
 
 namespace fastbotx {
 
-    /**
-     * @brief Map from widget to set of actions that can be performed on that widget
-     * Used for quick lookup of available actions for a specific widget
-     */
-    typedef std::map<WidgetPtr, ActivityStateActionPtrSet, Comparator<Widget>> ModelActionPtrWidgetMap;
-    
     /**
      * @brief Map from activity name string to set of states in that activity
      * Used for organizing states by their activity context
@@ -67,6 +68,40 @@ namespace fastbotx {
         long getTotal() const { return total; }
     };
 
+    /// What the graph keeps of every action hash it has seen
+    struct ActionRecord {
+        /// ID shared by every action with this hash
+        int id;
+        /// An action with this hash was visited when its state was added
+        bool visited;
+    };
+
+    /**
+     * @brief States of one activity and the graph's counters for them
+     *
+     * A state's hash includes its activity, and so do the hashes of its actions, so
+     * lookups, counts and removals scoped to an activity stay within its partition.
+     */
+    struct ActivityPartition {
+        /// States of the activity (deduplicated by hash, O(1) lookup)
+        HashIndex<State> states;
+
+        /// ID and visited flag of every action hash seen in the partition's states
+        std::unordered_map<uintptr_t, ActionRecord> actionRecords;
+
+        /// Entries of actionRecords that were visited
+        size_t visitedActionCount{0};
+
+        /// addState calls for the activity, revisits included
+        long visitCount{0};
+    };
+
+    /// Partition and hash of a state, for the graph-wide recency lists
+    struct StateKey {
+        InternedString activity;
+        uintptr_t hash;
+    };
+
     /**
      * @brief Interface for objects that want to be notified when new states are added to the graph
      * 
@@ -98,8 +133,13 @@ namespace fastbotx {
      * - Activity distribution statistics
      * - Listeners that need to be notified of state changes
      * 
-     * States are stored in a set and deduplicated by hash. Actions are indexed
-     * by their visited status for efficient lookup during action selection.
+     * States are partitioned by activity (ActivityPartition), and deduplicated by hash
+     * within their partition. Each action hash keeps its ID and visited flag; states not
+     * added for a while go to cold storage.
+     *
+     * One Graph is shared by the agents of all devices. Its methods do not lock: callers
+     * hold readLock() to look states up and writeLock() to add states or to change the
+     * shared states and actions (visits, details, agent action selection).
      */
     class Graph : Node {
     public:
@@ -108,12 +148,21 @@ namespace fastbotx {
          */
         Graph();
 
+        typedef std::shared_lock<std::shared_timed_mutex> ReadLock;
+        typedef std::unique_lock<std::shared_timed_mutex> WriteLock;
+
+        /// Lock for lookups; any number of devices may hold it at once
+        ReadLock readLock() const { return ReadLock(this->_mutex); }
+
+        /// Lock for adding states and changing shared states and actions
+        WriteLock writeLock() const { return WriteLock(this->_mutex); }
+
         /**
          * @brief Get the number of unique states in the graph
          * 
          * @return Number of states
          */
-        inline size_t stateSize() const { return this->_states.size(); }
+        inline size_t stateSize() const { return this->_stateCount; }
 
         /**
          * @brief Get the current timestamp of the graph
@@ -140,6 +189,15 @@ namespace fastbotx {
          */
         StatePtr addState(StatePtr state);
 
+        /**
+         * @brief Look up a state by its hash without adding anything
+         *
+         * @param activity Activity of the state, whose partition is searched
+         * @param hash State hash (State::hash())
+         * @return The stored state, or nullptr if the graph has none with this hash
+         */
+        StatePtr findState(InternedString activity, uintptr_t hash) const;
+
         /**
          * @brief Get total distribution count (total number of state accesses)
          * 
@@ -154,11 +212,77 @@ namespace fastbotx {
          */
         const stringPtrSet& getVisitedActivities() const { return this->_visitedActivities; };
 
+        /// The visited activities as a bitset over interned ids, for per-target membership probes
+        const InternedStringSet &getVisitedActivityIds() const { return this->_visitedActivityIds; }
+
         /**
          * @brief Get number of states that belong to the given activity.
          * Used for dynamic state abstraction (coarsening threshold).
          */
-        size_t getStateCountByActivity(const std::string &activity) const;
+        size_t getStateCountByActivity(InternedString activity) const;
+
+        /// addState calls for the activity so far, revisits included
+        long getVisitCountByActivity(InternedString activity) const;
+
+        /// getVisitCountByActivity of every activity with states
+        std::vector<std::pair<InternedString, long>> getVisitCountsByActivity() const;
+
+        /// Visit every state (unspecified order)
+        template<typename Func>
+        void forEachState(Func func) const {
+            for (const auto &partition: this->_partitions) {
+                partition.second.states.forEach(func);
+            }
+        }
+
+        /**
+         * @brief Add a state of an earlier session, in cold storage (StateFactory::createColdState)
+         *
+         * Counts no visit and notifies no listener; its activity counts as visited. Nothing
+         * changes, and false is returned, if the graph already has a state with its hash.
+         */
+        bool restoreState(const StatePtr &state);
+
+        /// Add the visits of an earlier session to the activity's count and the total
+        void restoreVisitCount(InternedString activity, long visits);
+
+        /**
+         * @brief Bound the number of states kept (0, the default, keeps every state)
+         *
+         * Past the bound, addState evicts the least recently added states. What the agents
+         * learnt about them is keyed by hash (Q values, reuse model) and survives; a state
+         * seen again after its eviction is added as a new state with unvisited actions.
+         */
+        void setMaxStates(size_t maxStates);
+
+        size_t getMaxStates() const { return this->_maxStates; }
+
+        /// States evicted since the graph was created
+        size_t getEvictedStateCount() const { return this->_evictedStateCount; }
+
+        /// Distinct actions (by hash) of the states added so far
+        size_t getActionRecordCount() const { return this->_actionRecordCount; }
+
+        /// Distinct actions seen visited when their state was added
+        size_t getVisitedActionCount() const { return this->_visitedActionCount; }
+
+        /**
+         * @brief Fold a state superseded by an abstraction change into its successor
+         *
+         * into absorbs the visits and action statistics of from (State::absorb), and from
+         * leaves the graph as an evicted state would. Nothing changes, and false is returned,
+         * when into is in cold storage or something outside the graph still holds from.
+         */
+        bool mergeState(const StatePtr &from, const StatePtr &into);
+
+        /// States merged into another since the graph was created
+        size_t getMergedStateCount() const { return this->_mergedStateCount; }
+
+        /// Add the states (with their widgets and actions) and the graph indexes to footprint
+        void accountMemory(MemoryFootprint &footprint) const;
+
+        /// Interned activity of the state, the key of its partition
+        static InternedString activityOf(const StatePtr &state);
 
         /**
          * @brief Destructor clears all internal data structures
@@ -183,29 +307,70 @@ namespace fastbotx {
          */
         void addActionFromState(const StatePtr &node);
 
-        /// Set of all unique states in the graph (deduplicated by hash)
-        StatePtrSet _states;
-        
+        /**
+         * @brief Move states not added in the last FASTBOT_COLD_STATE_STEPS steps to cold storage
+         *
+         * Only detail-dropped states whose actions nobody outside the graph holds (agent
+         * history, a pending step) are compacted; see State::compact.
+         */
+        void compactColdStates();
+
+        /// Evict least recently added states until at most _maxStates remain
+        void evictStates();
+
+        /// Drop a state from its partition and every index that refers to it
+        void removeState(const StatePtr &state);
+
+        /// Partition of the activity, nullptr if the graph has none
+        ActivityPartition *findPartition(InternedString activity);
+
+        /// Whether something besides the graph (an agent, a pending step) holds the state or its actions
+        static bool isHeldOutsideGraph(const StatePtr &state);
+
+        /// States by activity. Action records live with their states' activity too: values
+        /// rather than the actions themselves, so that the states stay the only owners of
+        /// their actions
+        std::unordered_map<InternedString, ActivityPartition> _partitions;
+
+        /// States in all partitions
+        size_t _stateCount{0};
+
+        /// Action records in all partitions, and how many of them were visited
+        size_t _actionRecordCount{0};
+        size_t _visitedActionCount{0};
+
         /// Set of all visited activity names (shared pointers to strings for memory efficiency)
         stringPtrSet _visitedActivities;
-        
-        /// Map from activity name to (visit_count, percentage) pair
-        /// Used for tracking activity distribution statistics
-        std::map<std::string, std::pair<int, double>> _activityDistri;
+        /// _visitedActivities by interned id
+        InternedStringSet _visitedActivityIds;
         
         /// Total count of state accesses (new states + revisits)
-        /// Used for calculating activity visit percentages
         long _totalDistri;
-        
-        /// Map from widget to set of actions that can be performed on that widget
-        /// Used for quick lookup of available actions for a specific widget
-        ModelActionPtrWidgetMap _widgetActions;
 
-        /// Set of actions that have not been visited yet
-        ActivityStateActionPtrSet _unvisitedActions;
-        
-        /// Set of actions that have been visited at least once
-        ActivityStateActionPtrSet _visitedActions;
+        /// (step, state) of each addState, oldest first, for compactColdStates
+        std::deque<std::pair<long, StateKey>> _recentStates;
+
+        /// Step of the latest addState of each state not compacted yet
+        std::unordered_map<uintptr_t, long> _lastAddedStep;
+
+        /// States currently in cold storage
+        size_t _coldStateCount{0};
+
+        /// ID of the next new state (IDs of evicted states are not reused)
+        int _nextStateId{0};
+
+        /// States, least recently added first (maintained while _maxStates > 0)
+        std::list<StateKey> _lruStates;
+
+        /// Position of each state (by hash) in _lruStates
+        std::unordered_map<uintptr_t, std::list<StateKey>::iterator> _lruPositions;
+
+        /// Bound on the number of states, 0 for none (see setMaxStates)
+        size_t _maxStates{0};
+
+        size_t _evictedStateCount{0};
+
+        size_t _mergedStateCount{0};
 
         /// Counter for tracking action statistics by type
         ActionCounter _actionCounter;
@@ -216,12 +381,8 @@ namespace fastbotx {
         /// Current timestamp of the graph (updated when states are added)
         time_t _timeStamp;
 
-        /// Per-activity count of unique states (updated only when a new state is added)
-        /// Used for dynamic state abstraction (coarsening threshold) - O(1) lookup
-        std::unordered_map<std::string, size_t> _activityStateCount;
-
-        /// Default distribution pair (0, 0.0) used for initializing new activities
-        const static std::pair<int, double> _defaultDistri;
+        /// Guards the graph and the states and actions it holds (see readLock/writeLock)
+        mutable std::shared_timed_mutex _mutex;
     };
 
     typedef std::shared_ptr<Graph> GraphPtr;
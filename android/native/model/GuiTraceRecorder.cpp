@@ -0,0 +1,209 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef GuiTraceRecorder_CPP_
+#define GuiTraceRecorder_CPP_
+
+#include "GuiTraceRecorder.h"
+#include "../utils.hpp"
+#include <chrono>
+#include <cstring>
+
+namespace fastbotx {
+
+    constexpr uint32_t GuiTraceRecorder::FileVersion;
+    constexpr size_t GuiTraceRecorder::DefaultQueueBytes;
+
+    namespace {
+
+        const char TraceMagic[4] = {'F', 'B', 'G', 'T'};
+
+        void putU32(std::string &out, uint32_t value) {
+            for (int shift = 0; shift < 32; shift += 8) {
+                out.push_back(static_cast<char>((value >> shift) & 0xFF));
+            }
+        }
+
+        void putI64(std::string &out, int64_t value) {
+            auto bits = static_cast<uint64_t>(value);
+            for (int shift = 0; shift < 64; shift += 8) {
+                out.push_back(static_cast<char>((bits >> shift) & 0xFF));
+            }
+        }
+
+        void putBytes(std::string &out, const char *data, size_t length) {
+            putU32(out, static_cast<uint32_t>(length));
+            out.append(data, length);
+        }
+
+        uint64_t getLittleEndian(const unsigned char *data, size_t size) {
+            uint64_t value = 0;
+            for (size_t i = 0; i < size; i++) {
+                value |= static_cast<uint64_t>(data[i]) << (8 * i);
+            }
+            return value;
+        }
+
+        /// Reads the fields of one record out of its bytes
+        class RecordReader {
+        public:
+            explicit RecordReader(const std::string &bytes) : _data(bytes.data()), _left(bytes.size()) {
+            }
+
+            bool readU32(uint32_t &value) {
+                if (this->_left < 4) return false;
+                value = static_cast<uint32_t>(getLittleEndian(reinterpret_cast<const unsigned char *>(this->_data), 4));
+                this->skip(4);
+                return true;
+            }
+
+            bool readI64(int64_t &value) {
+                if (this->_left < 8) return false;
+                value = static_cast<int64_t>(getLittleEndian(reinterpret_cast<const unsigned char *>(this->_data), 8));
+                this->skip(8);
+                return true;
+            }
+
+            bool readBytes(std::string &value) {
+                uint32_t length = 0;
+                if (!this->readU32(length) || this->_left < length) return false;
+                value.assign(this->_data, length);
+                this->skip(length);
+                return true;
+            }
+
+        private:
+            void skip(size_t size) {
+                this->_data += size;
+                this->_left -= size;
+            }
+
+            const char *_data;
+            size_t _left;
+        };
+
+    }
+
+    GuiTraceRecorder::GuiTraceRecorder(const std::string &path, size_t queueBytes)
+            : _queueBytesLimit(queueBytes) {
+        this->_file = fopen(path.c_str(), "wb");
+        if (nullptr == this->_file) {
+            BLOGE("gui trace: cannot open %s", path.c_str());
+            return;
+        }
+        std::string header(TraceMagic, sizeof(TraceMagic));
+        putU32(header, FileVersion);
+        fwrite(header.data(), 1, header.size(), this->_file);
+        this->_writer = std::thread(&GuiTraceRecorder::writeLoop, this);
+        BLOG("gui trace: recording to %s", path.c_str());
+    }
+
+    GuiTraceRecorder::~GuiTraceRecorder() {
+        {
+            std::lock_guard<std::mutex> lock(this->_mutex);
+            this->_stopping = true;
+        }
+        this->_queued.notify_all();
+        if (this->_writer.joinable()) {
+            this->_writer.join();
+        }
+        if (this->_file) {
+            fclose(this->_file);
+            BLOG("gui trace: %llu calls recorded, %llu dropped",
+                 static_cast<unsigned long long>(this->recordedCount()),
+                 static_cast<unsigned long long>(this->droppedCount()));
+        }
+    }
+
+    void GuiTraceRecorder::record(const char *activity, size_t activityLength, const char *dump,
+                                  size_t dumpLength, const std::string &operation, uint32_t stepCostUs) {
+        if (nullptr == this->_file) {
+            return;
+        }
+        size_t recordSize = 8 + 4 + 3 * 4 + activityLength + dumpLength + operation.size();
+        if (recordSize + 4 > this->_queueBytesLimit) {
+            this->_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        // Encode before taking the lock, so concurrent devices only contend on the queue
+        std::string encoded;
+        encoded.reserve(recordSize + 4);
+        putU32(encoded, static_cast<uint32_t>(recordSize));
+        auto now = std::chrono::system_clock::now().time_since_epoch();
+        putI64(encoded, std::chrono::duration_cast<std::chrono::microseconds>(now).count());
+        putU32(encoded, stepCostUs);
+        putBytes(encoded, activity, activityLength);
+        putBytes(encoded, dump, dumpLength);
+        putBytes(encoded, operation.data(), operation.size());
+        {
+            std::lock_guard<std::mutex> lock(this->_mutex);
+            if (this->_queueBytes + encoded.size() > this->_queueBytesLimit) {
+                this->_dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            this->_queueBytes += encoded.size();
+            this->_queue.push_back(std::move(encoded));
+        }
+        this->_recorded.fetch_add(1, std::memory_order_relaxed);
+        this->_queued.notify_one();
+    }
+
+    void GuiTraceRecorder::writeLoop() {
+        std::deque<std::string> batch;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(this->_mutex);
+                this->_queued.wait(lock, [this] { return this->_stopping || !this->_queue.empty(); });
+                if (this->_queue.empty()) {
+                    return;  // stopping, and everything is written
+                }
+                batch.swap(this->_queue);
+                this->_queueBytes = 0;
+            }
+            for (const std::string &encoded: batch) {
+                fwrite(encoded.data(), 1, encoded.size(), this->_file);
+            }
+            batch.clear();
+            // A killed run keeps every record written so far
+            fflush(this->_file);
+        }
+    }
+
+    bool GuiTraceRecorder::read(const std::string &path, std::vector<GuiTraceRecord> &records) {
+        FILE *file = fopen(path.c_str(), "rb");
+        if (nullptr == file) {
+            return false;
+        }
+        unsigned char header[8];
+        if (fread(header, 1, sizeof(header), file) != sizeof(header) ||
+            0 != memcmp(header, TraceMagic, sizeof(TraceMagic)) ||
+            getLittleEndian(header + 4, 4) != FileVersion) {
+            fclose(file);
+            return false;
+        }
+        std::string bytes;
+        unsigned char sizeBytes[4];
+        while (fread(sizeBytes, 1, sizeof(sizeBytes), file) == sizeof(sizeBytes)) {
+            bytes.resize(static_cast<size_t>(getLittleEndian(sizeBytes, 4)));
+            if (fread(&bytes[0], 1, bytes.size(), file) != bytes.size()) {
+                break;
+            }
+            RecordReader reader(bytes);
+            GuiTraceRecord record;
+            if (!reader.readI64(record.timestampUs) || !reader.readU32(record.stepCostUs) ||
+                !reader.readBytes(record.activity) || !reader.readBytes(record.dump) ||
+                !reader.readBytes(record.operation)) {
+                break;
+            }
+            records.push_back(std::move(record));
+        }
+        fclose(file);
+        return true;
+    }
+
+}
+
+#endif //GuiTraceRecorder_CPP_
@@ -0,0 +1,103 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef GuiTraceRecorder_H_
+#define GuiTraceRecorder_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fastbotx {
+
+    /// One getAction call of a recorded GUI trace
+    struct GuiTraceRecord {
+        /// Wall clock when the call returned, microseconds since the epoch
+        int64_t timestampUs{0};
+        /// Time spent in native for the call, microseconds
+        uint32_t stepCostUs{0};
+        std::string activity;
+        /// GUI tree as received: binary ("FB\0\1" or "FB\0\2"), delta ("FB\0\3") or XML
+        std::string dump;
+        /// Chosen operation as returned to Java (DeviceOperateWrapper::toString)
+        std::string operation;
+    };
+
+    /**
+     * @brief Appends the getAction calls of a run to a GUI trace file, the corpus of replays
+     *
+     * File: magic "FBGT", version u32, then one record per call, little-endian:
+     * size u32 (of the rest of the record) | timestampUs i64 | stepCostUs u32 |
+     * activity, dump, operation: each length u32 then bytes.
+     *
+     * record() only encodes the call and queues it; a background thread writes the
+     * queue out. The queue is bounded in bytes: when the disk falls behind, calls are
+     * dropped (and counted) rather than slowing the step down.
+     */
+    class GuiTraceRecorder {
+    public:
+        static constexpr uint32_t FileVersion = 1;
+        static constexpr size_t DefaultQueueBytes = 32 * 1024 * 1024;
+
+        /// Create or truncate path; isOpen() tells whether it worked
+        explicit GuiTraceRecorder(const std::string &path, size_t queueBytes = DefaultQueueBytes);
+
+        /// Writes out what is queued, then closes the file
+        ~GuiTraceRecorder();
+
+        GuiTraceRecorder(const GuiTraceRecorder &) = delete;
+
+        GuiTraceRecorder &operator=(const GuiTraceRecorder &) = delete;
+
+        bool isOpen() const { return this->_file != nullptr; }
+
+        /// Queue one call (any thread); never waits for the disk
+        void record(const char *activity, size_t activityLength, const char *dump, size_t dumpLength,
+                    const std::string &operation, uint32_t stepCostUs);
+
+        uint64_t recordedCount() const { return this->_recorded.load(std::memory_order_relaxed); }
+
+        uint64_t droppedCount() const { return this->_dropped.load(std::memory_order_relaxed); }
+
+        /**
+         * @brief Read a whole trace file
+         *
+         * @return false if path is not a trace; records holds the calls read until a
+         *         truncated tail, e.g. of a run that was killed
+         */
+        static bool read(const std::string &path, std::vector<GuiTraceRecord> &records);
+
+    private:
+        void writeLoop();
+
+        FILE *_file{nullptr};
+        size_t _queueBytesLimit;
+
+        std::mutex _mutex;
+        std::condition_variable _queued;
+        /// Encoded records waiting for the writer, and their total size (guarded by _mutex)
+        std::deque<std::string> _queue;
+        size_t _queueBytes{0};
+        bool _stopping{false};
+
+        std::atomic<uint64_t> _recorded{0};
+        std::atomic<uint64_t> _dropped{0};
+        std::thread _writer;
+    };
+
+    typedef std::shared_ptr<GuiTraceRecorder> GuiTraceRecorderPtr;
+
+}
+
+#endif //GuiTraceRecorder_H_
@@ -0,0 +1,187 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef HashIndex_H_
+#define HashIndex_H_
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace fastbotx {
+
+    /**
+     * @brief Open-addressing index of shared objects keyed by their precomputed hash()
+     *
+     * Drop-in replacement for std::set<std::shared_ptr<T>, Comparator<T>> where T is a
+     * HashNode whose identity is its hash (State, ActivityStateAction): same dedup
+     * semantics, but O(1) lookup on the cached hash value with no virtual calls while
+     * probing. The slot is picked from a mixed hash and every probe compares the full
+     * stored hash, so slot collisions never merge distinct keys.
+     *
+     * Keys are snapshotted at insertion; T::hash() must not change while indexed.
+     * Linear probing with tombstones; rehashes at 70% occupancy (live + deleted slots)
+     * and doubles once live entries exceed half the table.
+     */
+    template<typename T>
+    class HashIndex {
+    public:
+        typedef std::shared_ptr<T> Ptr;
+
+        HashIndex() = default;
+
+        size_t size() const { return this->_size; }
+
+        bool empty() const { return 0 == this->_size; }
+
+        /// Heap bytes of the table itself (control, hashes and pointers of every slot)
+        size_t tableBytes() const {
+            return this->_control.capacity() * sizeof(uint8_t) + this->_hashes.capacity() * sizeof(uintptr_t) +
+                   this->_values.capacity() * sizeof(Ptr);
+        }
+
+        /// Entry whose hash equals the given one, or nullptr
+        Ptr find(uintptr_t hash) const {
+            if (this->_size == 0) {
+                return nullptr;
+            }
+            size_t slot;
+            return findSlot(hash, slot) ? this->_values[slot] : nullptr;
+        }
+
+        bool contains(uintptr_t hash) const { return find(hash) != nullptr; }
+
+        /**
+         * @brief Insert value unless an entry with the same hash exists
+         * @return {entry now stored under value->hash(), true if value was inserted}
+         */
+        std::pair<Ptr, bool> emplace(const Ptr &value) {
+            uintptr_t hash = value->hash();
+            size_t slot;
+            if (this->_size != 0 && findSlot(hash, slot)) {
+                return std::make_pair(this->_values[slot], false);
+            }
+            size_t capacity = this->_control.size();
+            if ((this->_size + this->_deleted + 1) * 10 > capacity * 7) {
+                // Grow when live entries pass half the table, otherwise only drop tombstones
+                if (capacity == 0) {
+                    capacity = InitialCapacity;
+                } else if ((this->_size + 1) * 2 > capacity) {
+                    capacity *= 2;
+                }
+                rehash(capacity);
+            }
+            insertNew(hash, value);
+            return std::make_pair(value, true);
+        }
+
+        /// Remove the entry with the given hash; returns false if absent
+        bool erase(uintptr_t hash) {
+            size_t slot;
+            if (this->_size == 0 || !findSlot(hash, slot)) {
+                return false;
+            }
+            this->_control[slot] = SlotDeleted;
+            this->_values[slot].reset();
+            this->_size--;
+            this->_deleted++;
+            return true;
+        }
+
+        void clear() {
+            this->_control.clear();
+            this->_hashes.clear();
+            this->_values.clear();
+            this->_size = 0;
+            this->_deleted = 0;
+        }
+
+        /// Visit every entry (unspecified order)
+        template<typename Func>
+        void forEach(Func func) const {
+            for (size_t i = 0; i < this->_control.size(); i++) {
+                if (this->_control[i] == SlotFull) {
+                    func(this->_values[i]);
+                }
+            }
+        }
+
+    private:
+        enum : size_t {
+            InitialCapacity = 64
+        };
+
+        enum SlotState : uint8_t {
+            SlotEmpty = 0,
+            SlotFull,
+            SlotDeleted
+        };
+
+        /// Hashes of similar widgets/actions share low bits; spread them before masking
+        static size_t mix(uintptr_t hash) {
+            uint64_t h = static_cast<uint64_t>(hash);
+            h ^= h >> 33;
+            h *= 0xff51afd7ed558ccdULL;
+            h ^= h >> 33;
+            return static_cast<size_t>(h);
+        }
+
+        bool findSlot(uintptr_t hash, size_t &slot) const {
+            size_t mask = this->_control.size() - 1;
+            size_t i = mix(hash) & mask;
+            while (this->_control[i] != SlotEmpty) {
+                if (this->_control[i] == SlotFull && this->_hashes[i] == hash) {
+                    slot = i;
+                    return true;
+                }
+                i = (i + 1) & mask;
+            }
+            return false;
+        }
+
+        void insertNew(uintptr_t hash, const Ptr &value) {
+            size_t mask = this->_control.size() - 1;
+            size_t i = mix(hash) & mask;
+            while (this->_control[i] == SlotFull) {
+                i = (i + 1) & mask;
+            }
+            if (this->_control[i] == SlotDeleted) {
+                this->_deleted--;
+            }
+            this->_control[i] = SlotFull;
+            this->_hashes[i] = hash;
+            this->_values[i] = value;
+            this->_size++;
+        }
+
+        void rehash(size_t capacity) {
+            std::vector<uint8_t> control(capacity, SlotEmpty);
+            std::vector<uintptr_t> hashes(capacity, 0);
+            std::vector<Ptr> values(capacity);
+            control.swap(this->_control);
+            hashes.swap(this->_hashes);
+            values.swap(this->_values);
+            this->_size = 0;
+            this->_deleted = 0;
+            for (size_t i = 0; i < control.size(); i++) {
+                if (control[i] == SlotFull) {
+                    insertNew(hashes[i], values[i]);
+                }
+            }
+        }
+
+        /// Parallel slot arrays: probing touches only _control and _hashes
+        std::vector<uint8_t> _control;
+        std::vector<uintptr_t> _hashes;
+        std::vector<Ptr> _values;
+        size_t _size{0};
+        size_t _deleted{0};
+    };
+
+}
+
+#endif //HashIndex_H_
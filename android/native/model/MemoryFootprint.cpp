@@ -0,0 +1,59 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef MemoryFootprint_CPP_
+#define MemoryFootprint_CPP_
+
+#include "MemoryFootprint.h"
+#include "json.hpp"
+#include <unistd.h>
+#include <cstdio>
+
+namespace fastbotx {
+
+    const MemoryFootprint::Usage &MemoryFootprint::usageOf(const std::string &subsystem) const {
+        static const Usage none;
+        auto usage = this->_subsystems.find(subsystem);
+        return usage == this->_subsystems.end() ? none : usage->second;
+    }
+
+    size_t MemoryFootprint::totalBytes() const {
+        size_t total = 0;
+        for (const auto &subsystem: this->_subsystems) {
+            total += subsystem.second.bytes;
+        }
+        return total;
+    }
+
+    std::string MemoryFootprint::toJson() const {
+        nlohmann::json subsystems = nlohmann::json::object();
+        for (const auto &subsystem: this->_subsystems) {
+            subsystems[subsystem.first] = {{"count", subsystem.second.count},
+                                           {"bytes", subsystem.second.bytes}};
+        }
+        nlohmann::json j;
+        j["totalBytes"] = totalBytes();
+        j["processRssBytes"] = processRssBytes();
+        j["subsystems"] = subsystems;
+        return j.dump();
+    }
+
+    size_t MemoryFootprint::processRssBytes() {
+        FILE *statm = fopen("/proc/self/statm", "r");
+        if (nullptr == statm) {
+            return 0;
+        }
+        unsigned long sizePages = 0;
+        unsigned long residentPages = 0;
+        int fields = fscanf(statm, "%lu %lu", &sizePages, &residentPages);
+        fclose(statm);
+        long pageSize = sysconf(_SC_PAGESIZE);
+        return fields == 2 && pageSize > 0 ? residentPages * static_cast<size_t>(pageSize) : 0;
+    }
+
+}
+
+#endif //MemoryFootprint_CPP_
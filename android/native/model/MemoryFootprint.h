@@ -0,0 +1,118 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef MemoryFootprint_H_
+#define MemoryFootprint_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace fastbotx {
+
+    /**
+     * @brief Heap bytes held by each subsystem of the model, e.g. "graph.states"
+     *
+     * Filled on demand by the accountMemory() of Graph, State, the agents and Preference,
+     * from the sizes and capacities of what they own: an estimate of the live heap, not a
+     * count of every allocation (allocator overhead and interned strings shared across
+     * subsystems are left out), cheap enough to poll during a run and to compare runs.
+     */
+    class MemoryFootprint {
+    public:
+        struct Usage {
+            /// Objects of the subsystem (states, widgets, entries...)
+            size_t count{0};
+            size_t bytes{0};
+        };
+
+        void add(const char *subsystem, size_t count, size_t bytes) {
+            Usage &usage = this->_subsystems[subsystem];
+            usage.count += count;
+            usage.bytes += bytes;
+        }
+
+        const Usage &usageOf(const std::string &subsystem) const;
+
+        /// True the first time owner is seen: structures shared by several agents are counted once
+        bool firstVisit(const void *owner) { return this->_visited.insert(owner).second; }
+
+        size_t totalBytes() const;
+
+        /// {"totalBytes":N,"processRssBytes":N,"subsystems":{"graph.states":{"count":N,"bytes":N},...}}
+        std::string toJson() const;
+
+        // Heap bytes of a container's own storage (the elements' heap is not included)
+
+        static size_t bytesOf(const std::string &value) {
+            // Short strings live inside the object (libc++ and libstdc++ both keep >= 15 chars)
+            return value.capacity() > 15 ? value.capacity() + 1 : 0;
+        }
+
+        template<typename T>
+        static size_t bytesOf(const std::vector<T> &values) {
+            return values.capacity() * sizeof(T);
+        }
+
+        template<typename T>
+        static size_t bytesOf(const std::deque<T> &values) {
+            return values.size() * sizeof(T);
+        }
+
+        /// Doubly linked list: one node of two pointers per entry
+        template<typename T>
+        static size_t bytesOf(const std::list<T> &values) {
+            return values.size() * (sizeof(T) + 2 * sizeof(void *));
+        }
+
+        /// Red-black tree: one node of three pointers and a color per entry
+        template<typename K, typename V, typename C, typename A>
+        static size_t bytesOf(const std::map<K, V, C, A> &values) {
+            return values.size() * (sizeof(std::pair<const K, V>) + 4 * sizeof(void *));
+        }
+
+        template<typename K, typename C, typename A>
+        static size_t bytesOf(const std::set<K, C, A> &values) {
+            return values.size() * (sizeof(K) + 4 * sizeof(void *));
+        }
+
+        /// One node (next pointer, cached hash) per entry plus the bucket array
+        template<typename K, typename V, typename H, typename E, typename A>
+        static size_t bytesOf(const std::unordered_map<K, V, H, E, A> &values) {
+            return values.size() * (sizeof(std::pair<const K, V>) + 2 * sizeof(void *)) +
+                   values.bucket_count() * sizeof(void *);
+        }
+
+        template<typename K, typename H, typename E, typename A>
+        static size_t bytesOf(const std::unordered_set<K, H, E, A> &values) {
+            return values.size() * (sizeof(K) + 2 * sizeof(void *)) + values.bucket_count() * sizeof(void *);
+        }
+
+        /// Object made with std::make_shared: the object and its control block
+        template<typename T>
+        static size_t sharedBytes() {
+            return sizeof(T) + 2 * sizeof(void *) + 2 * sizeof(int);
+        }
+
+        /// Resident set of the process from /proc/self/statm, 0 where unavailable
+        static size_t processRssBytes();
+
+    private:
+        std::map<std::string, Usage> _subsystems;
+        std::unordered_set<const void *> _visited;
+    };
+
+}
+
+#endif //MemoryFootprint_H_
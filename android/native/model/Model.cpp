@@ -10,12 +10,19 @@
 #include "Model.h"
 #include "StateFactory.h"
 #include "../Base.h"
+#include "../StringInterner.h"
 #include "../utils.hpp"
+#include "../Trace.h"
+#include "MemoryFootprint.h"
+#include "DecisionProtocol.h"
 #include "../thirdpart/json/json.hpp"
 #include <algorithm>
+#include <chrono>
 #include <ctime>
+#include <cstring>
 #include <iostream>
 #include <map>
+#include <random>
 #if DYNAMIC_STATE_ABSTRACTION_ENABLED
 #include <utility>
 #include <sstream>
@@ -39,7 +46,12 @@ namespace {
 
 namespace fastbotx {
 
-    WidgetKeyMask Model::getActivityKeyMask(const std::string &activity) const {
+    WidgetKeyMask Model::getActivityKeyMask(InternedString activity) const {
+        std::lock_guard<std::mutex> abstractionLock(this->_abstractionMutex);
+        return findActivityKeyMask(activity);
+    }
+
+    WidgetKeyMask Model::findActivityKeyMask(InternedString activity) const {
         auto it = _activityKeyMask.find(activity);
         if (it != _activityKeyMask.end()) {
             return it->second;
@@ -47,7 +59,8 @@ namespace fastbotx {
         return DefaultWidgetKeyMask;
     }
 
-    void Model::setActivityKeyMask(const std::string &activity, WidgetKeyMask mask) {
+    void Model::setActivityKeyMask(InternedString activity, WidgetKeyMask mask) {
+        std::lock_guard<std::mutex> abstractionLock(this->_abstractionMutex);
         _activityKeyMask[activity] = mask;
     }
 
@@ -65,7 +78,11 @@ namespace fastbotx {
             BDLOGE("State is null, cannot log state information");
             return;
         }
-        
+#if FASTBOT_DEBUG_LOG
+        // Debug builds only: building every widget and action string is costly per step
+        if (!FASTBOT_LOG_ON(FASTBOT_LOG_LEVEL_DEBUG)) {
+            return;
+        }
         // Print state header with hash code
         BDLOG("{state: %lu", static_cast<unsigned long>(state->hash()));
         
@@ -97,6 +114,7 @@ namespace fastbotx {
         }
         
         BDLOG("}");
+#endif
     }
 
     /**
@@ -131,10 +149,14 @@ namespace fastbotx {
 #endif
         BLOG("----Fastbot native version " FASTBOT_VERSION "----\n");
         this->_graph = std::make_shared<Graph>();
+        this->_stepExecutor = std::make_shared<StepExecutor>(StepExecutorThreads);
         this->_preference = Preference::inst();
+        if (this->_preference && this->_preference->getGraphMaxStates() > 0) {
+            this->_graph->setMaxStates(this->_preference->getGraphMaxStates());
+        }
+        this->_leanOperate = this->_preference && this->_preference->isLeanOperate();
         this->_netActionParam.netActionTaskid = 0;
 #if DYNAMIC_STATE_ABSTRACTION_ENABLED
-        this->_transitionLog.resize(MaxTransitionLogSize);
         BLOG("state abstraction: enabled (check interval=%d, batch every %d steps)",
              (int)RefinementCheckInterval, (int)RefinementCheckInterval);
 #endif
@@ -156,7 +178,11 @@ namespace fastbotx {
     std::string Model::getOperate(const std::string &descContent, const std::string &activity,
                                   const std::string &deviceID) {
         // Parse XML string into Element object using tinyxml2
-        ElementPtr elem = Element::createFromXml(descContent);
+        ElementPtr elem;
+        {
+            StageTimer parseTimer(this->_perfStats, PerfStage::Parse);
+            elem = Element::createFromXml(descContent);
+        }
         if (nullptr == elem) {
             return "";
         }
@@ -167,8 +193,9 @@ namespace fastbotx {
     /**
      * @brief Create and add an agent to the model for a specific device
      * 
-     * Creates a new agent using the AgentFactory, adds it to the device-agent map,
-     * and registers it as a listener to the graph for state change notifications.
+     * Creates a new agent using the AgentFactory and adds it to the device shard map.
+     * The agent is not registered as a graph listener: the Graph is shared by all
+     * devices, so createAndAddState hands each new page to its own device's agent only.
      * 
      * @param deviceIDString Device ID string (empty string uses default device ID)
      * @param agentType The type of algorithm/agent to create
@@ -184,16 +211,46 @@ namespace fastbotx {
         const std::string &deviceID = deviceIDString.empty() ? ModelConstants::DefaultDeviceID
                                                              : deviceIDString;
         
-        // Add the device-agent pair to the map
-        this->_deviceIDAgentMap.emplace(deviceID, agent);
-        
-        // Register agent as a listener to graph updates
-        // This allows the agent to be notified when new states are added
-        this->_graph->addListener(agent);
-        
+        // Add the device shard to the map
+        auto shard = std::make_shared<DeviceShard>();
+        shard->agent = agent;
+        {
+            std::unique_lock<std::shared_timed_mutex> shardsLock(this->_deviceShardsMutex);
+            this->_deviceShards.emplace(deviceID, shard);
+        }
+
+        // Server: steps go to the decision server, the agent decides those it does not answer
+        if (agentType == AlgorithmType::Server && this->_preference) {
+            std::string host;
+            int port = 0;
+            const std::string &address = this->_preference->getDecisionServer();
+            if (DecisionProtocol::parseAddress(address, host, port)) {
+                std::string deviceId = this->_preference->getDecisionServerDeviceId();
+                if (deviceId.empty()) {
+                    std::random_device device;
+                    char randomId[24];
+                    snprintf(randomId, sizeof(randomId), "%08x%08x", device(), device());
+                    deviceId = randomId;
+                }
+                std::atomic_store(&this->_decisionClient, std::make_shared<DecisionClient>(
+                        host, port, deviceId, this->_preference->getDecisionServerTimeoutMs(),
+                        static_cast<size_t>(this->_preference->getDecisionServerConnections())));
+            } else {
+                BLOGE("server agent: no valid %s (\"%s\"), deciding locally", "max.decisionServer",
+                      address.c_str());
+            }
+        }
         return agent;
     }
 
+    OperatePtr Model::getRemoteOperate(const char *dump, size_t size, const std::string &activity) {
+        DecisionClientPtr client = std::atomic_load(&this->_decisionClient);
+        if (!client) {
+            return nullptr;
+        }
+        return client->decide(activity, this->getPackageName(), dump, size);
+    }
+
     /**
      * @brief Get the agent for a specific device ID
      * 
@@ -202,11 +259,30 @@ namespace fastbotx {
      */
     AbstractAgentPtr Model::getAgent(const std::string &deviceID) const {
         const std::string &d = deviceID.empty() ? ModelConstants::DefaultDeviceID : deviceID;
-        auto iter = this->_deviceIDAgentMap.find(d);
-        if (iter != this->_deviceIDAgentMap.end()) {
-            return iter->second;
+        std::shared_lock<std::shared_timed_mutex> shardsLock(this->_deviceShardsMutex);
+        DeviceShardPtr shard = findShard(d);
+        return shard ? shard->agent : nullptr;
+    }
+
+    bool Model::withIdleAgent(const std::string &deviceID,
+                              const std::function<bool(const AbstractAgentPtr &)> &fn) {
+        const std::string &d = deviceID.empty() ? ModelConstants::DefaultDeviceID : deviceID;
+        DeviceShardPtr shard;
+        {
+            std::shared_lock<std::shared_timed_mutex> shardsLock(this->_deviceShardsMutex);
+            shard = findShard(d);
         }
-        return nullptr;
+        if (!shard || !shard->agent) {
+            return false;
+        }
+        std::lock_guard<std::mutex> stepLock(shard->stepMutex);
+        waitForPendingStep(*shard);
+        return fn(shard->agent);
+    }
+
+    DeviceShardPtr Model::findShard(const std::string &deviceID) const {
+        auto iter = this->_deviceShards.find(deviceID);
+        return iter != this->_deviceShards.end() ? iter->second : nullptr;
     }
 
 
@@ -236,98 +312,56 @@ namespace fastbotx {
      * Checks if the user has specified a custom action for this activity/page
      * in the preference settings. Returns nullptr if no custom action is defined.
      * 
-     * @param activity Activity name string
+     * @param activity Interned activity name
      * @param element XML Element object of the current page
+     * @param rng Generator of the stepping device
      * @return Custom action if exists, nullptr otherwise
      */
-    ActionPtr Model::getCustomActionIfExists(const std::string &activity, const ElementPtr &element) const {
+    ActionPtr Model::getCustomActionIfExists(InternedString activity, const ElementPtr &element, Rng &rng) const {
         if (this->_preference) {
             BLOG("try get custom action from preference");
-            return this->_preference->resolvePageAndGetSpecifiedAction(activity, element);
+            std::lock_guard<std::mutex> preferenceLock(this->_preferenceMutex);
+            return this->_preference->resolvePageAndGetSpecifiedAction(activity, element, rng);
         }
         return nullptr;
     }
 
     /**
-     * @brief Get or create an activity string pointer
-     * 
-     * This method optimizes memory usage by reusing existing activity string pointers
-     * from the graph's visited activities set. If the activity already exists,
-     * returns the cached shared pointer. Otherwise, creates a new one.
-     * 
-     * Performance optimization:
-     * - Reuses existing string pointers to avoid duplicate string storage
-     * - Uses hash-based set lookup for O(log n) complexity
-     * 
-     * @param activity The activity name string
-     * @return Shared pointer to the activity string (cached or newly created)
-     * 
-     * @note The returned pointer may be from the cache or newly created.
-     *       Newly created pointers will be added to the graph's visited activities
-     *       when the state is added via createAndAddState().
-     */
-    stringPtr Model::getOrCreateActivityPtr(const std::string &activity) {
-        // Get the set of visited activities (returns by value, but set is typically small)
-        const stringPtrSet& activityStringPtrSet = this->_graph->getVisitedActivities();
-        
-        // Create temporary shared_ptr for lookup
-        // Note: This creates a temporary object for comparison only
-        // If not found, we'll return this pointer; if found, we'll return the cached one
-        stringPtr tempActivityPtr = std::make_shared<std::string>(activity);
-        
-        // Try to find existing activity pointer in the set
-        auto founded = activityStringPtrSet.find(tempActivityPtr);
-        
-        if (founded == activityStringPtrSet.end()) {
-            // This is a new activity, return the newly created pointer
-            return tempActivityPtr;
-        } else {
-            // Activity already exists, return the cached pointer to avoid duplication
-            return *founded;
-        }
-    }
-
-    /**
-     * @brief Get or create an agent for the given device ID
+     * @brief Get or create the shard for the given device ID
      * 
-     * This method retrieves an agent for the specified device ID. If no agent exists
-     * for the device ID, returns the default agent. If no agents exist at all,
-     * creates a default reuse agent.
+     * This method retrieves the shard (agent and step lock) for the specified device
+     * ID. If no shard exists for the device ID, returns the default one. If no agents
+     * exist at all, creates a default reuse agent.
      * 
      * Performance optimization:
      * - Uses find() instead of [] operator to avoid creating unnecessary map entries
-     * - Falls back to default device ID if device ID is not found
+     * - Steady state takes the shard map lock shared, so devices do not contend on it
      * 
      * @param deviceID The device ID string (empty string uses default device ID)
-     * @return Shared pointer to the agent for the device
+     * @return Shared pointer to the shard for the device
      * 
-     * @note If the device ID is not found, returns the default agent instead of
+     * @note If the device ID is not found, returns the default shard instead of
      *       creating a new one. This ensures all devices have an agent to use.
      */
-    AbstractAgentPtr Model::getOrCreateAgent(const std::string &deviceID) {
-        // Create a default agent if map is empty
-        if (this->_deviceIDAgentMap.empty()) {
-            BLOG("%s", "use reuseAgent as the default agent");
-            this->addAgent(ModelConstants::DefaultDeviceID, AlgorithmType::Reuse);
+    DeviceShardPtr Model::getOrCreateShard(const std::string &deviceID) {
+        {
+            std::shared_lock<std::shared_timed_mutex> shardsLock(this->_deviceShardsMutex);
+            if (!this->_deviceShards.empty()) {
+                DeviceShardPtr shard = findShard(deviceID);
+                return shard ? shard : findShard(ModelConstants::DefaultDeviceID);
+            }
         }
         
-        // Use find() instead of [] to avoid creating unnecessary map entries
-        // Performance: O(log n) lookup without side effects
-        auto agentIterator = this->_deviceIDAgentMap.find(deviceID);
-        
-        if (agentIterator == this->_deviceIDAgentMap.end()) {
-            // Device ID not found, return the default agent
-            // Use find() again to avoid [] operator side effects
-            auto defaultIterator = this->_deviceIDAgentMap.find(ModelConstants::DefaultDeviceID);
-            if (defaultIterator != this->_deviceIDAgentMap.end()) {
-                return defaultIterator->second;
-            }
-            // Should not reach here if addAgent worked correctly, but handle gracefully
-            return nullptr;
-        } else {
-            // Found the agent for this device ID
-            return agentIterator->second;
+        // Create a default agent if map is empty (checked again under the exclusive lock)
+        std::unique_lock<std::shared_timed_mutex> shardsLock(this->_deviceShardsMutex);
+        if (this->_deviceShards.empty()) {
+            BLOG("%s", "use reuseAgent as the default agent");
+            auto shard = std::make_shared<DeviceShard>();
+            shard->agent = AgentFactory::create(AlgorithmType::Reuse, shared_from_this(), DeviceType::Normal);
+            this->_deviceShards.emplace(ModelConstants::DefaultDeviceID, shard);
         }
+        DeviceShardPtr shard = findShard(deviceID);
+        return shard ? shard : findShard(ModelConstants::DefaultDeviceID);
     }
 
     /**
@@ -337,29 +371,77 @@ namespace fastbotx {
      * to the graph. The graph will deduplicate if a similar state already exists.
      * Marks the state as visited with the current graph timestamp.
      * 
+     * The state is built without holding the graph lock, so devices build their
+     * states in parallel; only the lookups and the insertion are serialized.
+     * 
+     * Building only reads the agent's algorithm type, so it overlaps the device's
+     * pending step (finishStep); adding the state waits for it, since that step still
+     * reads the previous state and drops its details. A pending state abstraction
+     * check may change the mask, so then the build waits as well.
+     * 
      * @param element XML Element object of the current page (must not be nullptr)
      * @param agent The agent to use for state creation (determines state type)
-     * @param activityPtr Shared pointer to activity name string
+     * @param activity Interned activity name
+     * @param shard The agent's shard (caller holds its stepMutex)
+     * @param waitCostMs Output parameter: time spent waiting for the pending step in ms
      * @return Shared pointer to the created/existing state, or nullptr if element is null
      */
     StatePtr Model::createAndAddState(const ElementPtr &element, const AbstractAgentPtr &agent,
-                                      const stringPtr &activityPtr) {
+                                      InternedString activity, DeviceShard &shard, double &waitCostMs) {
+        FASTBOT_TRACE_FUNCTION();
+        waitCostMs = 0.0;
         // Validate input
         if (nullptr == element) {
+            waitForPendingStep(shard);
             return nullptr;
         }
+        if (shard.pendingStepChecksAbstraction) {
+            double waitStartTimestamp = currentStamp();
+            waitForPendingStep(shard);
+            waitCostMs += currentStamp() - waitStartTimestamp;
+        }
+        auto buildStart = std::chrono::steady_clock::now();
         
-        // Create state according to the agent's algorithm type
-        // The state includes all possible actions based on widgets in the element
-        std::string activityStr = activityPtr ? *activityPtr : "";
-        WidgetKeyMask mask = getActivityKeyMask(activityStr);
-        StatePtr state = StateFactory::createState(agent->getAlgorithmType(), activityPtr, element, mask);
+        const stringPtr &activityPtr = activity.ptr();
+        WidgetKeyMask mask = getActivityKeyMask(activity);
+        StatePtr state = nullptr;
+
+#if !DROP_DETAIL_AFTER_SATE && DYNAMIC_STATE_ABSTRACTION_ENABLED
+        // Performance optimization: a revisited state that still holds its details needs
+        // nothing from the new page, so recognise it from the Element tree and skip the build
+        uintptr_t knownHash = StateFactory::computeStateHash(agent->getAlgorithmType(), activityPtr,
+                                                             element, mask);
+        if (knownHash != 0) {
+            Graph::ReadLock graphLock = this->_graph->readLock();
+            StatePtr knownState = this->_graph->findState(activity, knownHash);
+            if (knownState && !knownState->hasNoDetail()) {
+                state = knownState;
+            }
+        }
+#endif
+
+        if (nullptr == state) {
+            // Create state according to the agent's algorithm type.
+            // Performance optimization: actions are only created when the state is new to the
+            // graph; a revisit is replaced by the stored state, which already has its actions
+            state = StateFactory::createState(agent->getAlgorithmType(), activityPtr, element, mask,
+                                              false, this->_stepExecutor.get());
+            bool isNewState = false;
+            if (state) {
+                Graph::ReadLock graphLock = this->_graph->readLock();
+                isNewState = nullptr == this->_graph->findState(activity, state->hash());
+            }
+            if (isNewState) {
+                state->materializeActions();
+            }
+        }
 
 #if DYNAMIC_STATE_ABSTRACTION_ENABLED
         // Update text stats from newly built state (before addState) for accurate "skip Text" check (§22)
-        if (state && !activityStr.empty()) {
+        if (state && !activity.empty()) {
+            std::lock_guard<std::mutex> abstractionLock(this->_abstractionMutex);
             const auto textMask = static_cast<WidgetKeyMask>(WidgetKeyAttr::Text);
-            ActivityLastStateTextStats &st = _activityLastStateTextStats[activityStr];
+            ActivityLastStateTextStats &st = _activityLastStateTextStats[activity];
             st.widgetsWithNonEmptyText = state->getWidgetsWithNonEmptyTextCount();
             st.totalWidgets = state->getWidgets().size();
             if ((mask & textMask) == 0) {
@@ -369,13 +451,27 @@ namespace fastbotx {
             }
         }
 #endif
+        this->_perfStats.record(PerfStage::StateBuild, std::chrono::steady_clock::now() - buildStart);
 
-        // Add state to graph (may return existing state if duplicate)
-        // The graph handles deduplication based on state hash
-        state = this->_graph->addState(state);
+        // The agent must have learnt from the previous step before it sees this page
+        double waitStartTimestamp = currentStamp();
+        waitForPendingStep(shard);
+        waitCostMs += currentStamp() - waitStartTimestamp;
 
-        // Mark state as visited with current graph timestamp
-        state->visit(this->_graph->getTimestamp());
+        StageTimer insertTimer(this->_perfStats, PerfStage::GraphInsert);
+        {
+            Graph::WriteLock graphLock = this->_graph->writeLock();
+            // Add state to graph (may return existing state if duplicate)
+            // The graph handles deduplication based on state hash
+            state = this->_graph->addState(state);
+
+            // Mark state as visited with current graph timestamp
+            state->visit(this->_graph->getTimestamp());
+            state->markSessionDirty();
+        }
+
+        // Notify only this device's agent (other devices are on their own pages)
+        agent->onAddNode(state);
 
         return state;
     }
@@ -395,9 +491,11 @@ namespace fastbotx {
      * @param actionCost Output parameter: time cost for action generation in seconds
      * @return Selected action, or nullptr if selection failed
      */
-    ActionPtr Model::selectAction(StatePtr &state, AbstractAgentPtr &agent, ActionPtr customAction, double &actionCost) {
+    ActionPtr Model::selectAction(StatePtr &state, AbstractAgentPtr &agent, ActionPtr customAction,
+                                  ActionPtr speculativeAction, double &actionCost, bool &agentStep) {
         double startGeneratingActionTimestamp = currentStamp();
         actionCost = 0.0;
+        agentStep = false;
         ActionPtr action = customAction; // Use custom action if provided
 
         // Log state information for debugging
@@ -418,14 +516,17 @@ namespace fastbotx {
                 // Force restart action when stuck in blocked state
                 action = Action::RESTART;
                 BLOG("Ran into a block state %s", state ? state->getId().c_str() : "");
+            } else if (speculativeAction) {
+                // Selected ahead for this very state while the device executed the last step
+                agent->adoptSpeculativeAction(speculativeAction);
+                action = speculativeAction;
+                speculativeAction = nullptr;
             } else {
                 // Ask agent to resolve a new action (this is the main RL model entry point)
+                // The strategy learns from it in finishStep
                 auto resolvedAction = agent->resolveNewAction();
                 action = std::dynamic_pointer_cast<Action>(resolvedAction);
                 
-                // Update agent's strategy based on the new action
-                agent->updateStrategy();
-                
                 if (nullptr == action) {
                     BDLOGE("get null action!!!!");
                     return nullptr; // Handle null action gracefully
@@ -435,13 +536,10 @@ namespace fastbotx {
             // Calculate action generation time cost
             double endGeneratingActionTimestamp = currentStamp();
             actionCost = endGeneratingActionTimestamp - startGeneratingActionTimestamp;
-            
-            // If this is a model action and state exists, mark it as visited and update agent
-            if (action->isModelAct() && state) {
-                action->visit(this->_graph->getTimestamp());
-                // Update agent's current state/action with new state/action
-                agent->moveForward(state);
-            }
+            agentStep = true;
+        }
+        if (speculativeAction) {
+            agent->discardSpeculativeAction();
         }
         
         return action;
@@ -452,13 +550,12 @@ namespace fastbotx {
      * 
      * Converts an Action object to a DeviceOperateWrapper (OperatePtr) that can be
      * executed. If the action requires a target widget, extracts widget information.
-     * Applies preference patches and optionally clears state details for memory optimization.
+     * Applies preference patches.
      * 
      * @param action The action to convert (nullptr returns NOP operation)
-     * @param state The current state (used for detail clearing optimization)
      * @return OperatePtr The operation object ready for execution
      */
-    OperatePtr Model::convertActionToOperate(ActionPtr action, StatePtr state) {
+    OperatePtr Model::convertActionToOperate(ActionPtr action, Rng &rng) {
         if (action == nullptr) {
             // Return no-operation if action is null
             return DeviceOperateWrapper::OperateNop;
@@ -467,49 +564,171 @@ namespace fastbotx {
         BLOG("selected action %s", action->toString().c_str());
         
         // Convert action to operation object
-        OperatePtr opt = action->toOperate();
+        OperatePtr opt = action->toOperate(rng);
 
-        // If action requires a target widget, extract widget information
-        if (action->requireTarget()) {
+        // Attach the target widget's descriptor unless lean operates were asked for; the
+        // widget builds it once and keeps it while it has details
+        if (!this->_leanOperate && action->requireTarget()) {
             if (auto stateAction = std::dynamic_pointer_cast<fastbotx::ActivityStateAction>(action)) {
                 std::shared_ptr<Widget> widget = stateAction->getTarget();
                 if (widget) {
-                    // Serialize widget to JSON and attach to operation
-                    std::string widget_str = widget->toJson();
-                    opt->widget = widget_str;
-                    BLOG("stateAction Widget: %s", widget_str.c_str());
+                    opt->widget = widget->toJson();
+                    BLOG("stateAction Widget: %s", opt->widget.c_str());
                 }
             }
         }
 
         // Apply preference patches to the operation (e.g., custom modifications)
         if (this->_preference) {
-            this->_preference->patchOperate(opt);
+            std::lock_guard<std::mutex> preferenceLock(this->_preferenceMutex);
+            this->_preference->patchOperate(opt, rng);
         }
 
-        // Memory optimization: clear state details after use if enabled
-        // This reduces memory usage for states that are no longer needed in detail
-        if (DROP_DETAIL_AFTER_SATE && state && !state->hasNoDetail()) {
-            state->clearDetails();
+        return opt;
+    }
+
+    /**
+     * @brief Finish a step after its operation was selected
+     * 
+     * Kept in the order the step used to run it: the strategy learns from the step
+     * before the state loses its details, and the agent moves on last.
+     */
+    void Model::finishStep(const AbstractAgentPtr &agent, const StatePtr &state, const ActionPtr &action,
+                           bool agentStep, bool checkAbstraction, DeviceShard &shard) {
+        FASTBOT_TRACE_FUNCTION();
+        {
+            Graph::WriteLock graphLock = this->_graph->writeLock();
+            if (agentStep) {
+                // Update agent's strategy based on the new action
+                {
+                    StageTimer updateTimer(this->_perfStats, PerfStage::StrategyUpdate);
+                    agent->updateStrategy();
+                }
+
+                // If this is a model action and state exists, mark it as visited and update agent
+                if (action->isModelAct() && state) {
+                    action->visit(this->_graph->getTimestamp());
+                    state->markSessionDirty();
+#if FASTBOT_SPECULATIVE_STEPS
+                    StatePtr sourceState = agent->getCurrentState();
+                    ActivityStateActionPtr sourceAction = agent->getCurrentAction();
+                    if (sourceState && sourceAction) {
+                        shard.successors.record(sourceState->hash(), sourceAction->hash(), state->hash(),
+                                                Graph::activityOf(state));
+                    }
+#endif
+                    // Update agent's current state/action with new state/action
+                    agent->moveForward(state);
+#if FASTBOT_SPECULATIVE_STEPS
+                    speculateNextStep(agent, state, action, shard);
+#else
+                    (void) shard;
+#endif
+                }
+            }
+
+            // Memory optimization: clear state details after use if enabled
+            // This reduces memory usage for states that are no longer needed in detail
+            if (DROP_DETAIL_AFTER_SATE && state && !state->hasNoDetail()) {
+                state->clearDetails();
+            }
+        }
+#if DYNAMIC_STATE_ABSTRACTION_ENABLED
+        if (checkAbstraction) {
+            std::lock_guard<std::mutex> abstractionLock(this->_abstractionMutex);
+            runAbstractionTasks();
         }
+#else
+        (void) checkAbstraction;
+#endif
+    }
 
-        return opt;
+#if FASTBOT_SPECULATIVE_STEPS
+    void Model::speculateNextStep(const AbstractAgentPtr &agent, const StatePtr &state, const ActionPtr &action,
+                                  DeviceShard &shard) {
+        uintptr_t targetHash = 0;
+        InternedString targetActivity;
+        if (!shard.successors.predict(state->hash(), action->hash(), targetHash, targetActivity)) {
+            return;
+        }
+        StatePtr predicted = targetHash == state->hash() ? state : this->_graph->findState(targetActivity, targetHash);
+        if (nullptr == predicted || predicted->hasNoDetail()) {
+            return;
+        }
+        StageTimer speculateTimer(this->_perfStats, PerfStage::SpeculativeSelection);
+        // Selecting re-adjusts the priorities of predicted's actions
+        predicted->markSessionDirty();
+        ActionPtr speculative = agent->speculateNewAction(predicted);
+        if (nullptr == speculative) {
+            agent->discardSpeculativeAction();
+            return;
+        }
+        BDLOG("speculative step: state %s predicted after %s, selected %s", predicted->getId().c_str(),
+              action->toString().c_str(), speculative->toString().c_str());
+        shard.speculativeState = predicted;
+        shard.speculativeAction = speculative;
+    }
+
+    ActionPtr Model::takeSpeculativeAction(const AbstractAgentPtr &agent, const StatePtr &state, DeviceShard &shard) {
+        StatePtr predicted = std::move(shard.speculativeState);
+        ActionPtr speculative = std::move(shard.speculativeAction);
+        shard.speculativeState = nullptr;
+        shard.speculativeAction = nullptr;
+        if (nullptr == speculative) {
+            return nullptr;
+        }
+        // The action must still be one of the state's, with a target on the page that arrived
+        auto stateAction = std::dynamic_pointer_cast<ActivityStateAction>(speculative);
+        if (state && state == predicted && stateAction && stateAction->isValid() &&
+            std::find(state->getActions().begin(), state->getActions().end(), stateAction) !=
+            state->getActions().end()) {
+            this->_speculationHits++;
+            return speculative;
+        }
+        this->_speculationMisses++;
+        agent->discardSpeculativeAction();
+        return nullptr;
+    }
+#endif
+
+    void Model::waitForPendingStep(DeviceShard &shard) {
+        if (shard.pendingStep) {
+            shard.pendingStep->wait();
+            shard.pendingStep.reset();
+        }
+        shard.pendingStepChecksAbstraction = false;
+    }
+
+    void Model::finishPendingSteps() {
+        std::vector<DeviceShardPtr> shards;
+        {
+            std::shared_lock<std::shared_timed_mutex> shardsLock(this->_deviceShardsMutex);
+            shards.reserve(this->_deviceShards.size());
+            for (const auto &deviceShard: this->_deviceShards) {
+                shards.push_back(deviceShard.second);
+            }
+        }
+        for (const DeviceShardPtr &shard: shards) {
+            std::lock_guard<std::mutex> stepLock(shard->stepMutex);
+            waitForPendingStep(*shard);
+        }
     }
 
     /**
      * @brief Core method for getting next operation step and updating RL model
      * 
      * This is the main orchestration method that:
-     * 1. Gets custom action from preference if available
-     * 2. Gets or creates activity pointer (memory optimization)
-     * 3. Gets or creates agent for the device
-     * 4. Creates and adds state to the graph
-     * 5. Selects an action using the agent or custom action
-     * 6. Converts action to operation object
-     * 7. Logs performance metrics
+     * 1. Gets or creates agent for the device
+     * 2. Gets custom action from preference if available
+     * 3. Creates and adds state to the graph
+     * 4. Selects an action using the agent or custom action
+     * 5. Converts action to operation object
+     * 6. Logs performance metrics
+     * 7. Finishes the step (finishStep): on the StepExecutor when steps are pipelined,
+     *    so the strategy update overlaps the device executing the operation
      * 
      * @param element XML Element object of the current page
-     * @param activity Activity name string
+     * @param activity Interned activity name
      * @param deviceID Device ID string (default: empty string uses default device)
      * @return DeviceOperateWrapper object containing the next operation to perform
      * 
@@ -517,130 +736,213 @@ namespace fastbotx {
      */
     OperatePtr Model::getOperateOpt(const ElementPtr &element, const std::string &activity,
                                     const std::string &deviceID) {
+        return getOperateOpt(element, InternedString::intern(activity), deviceID);
+    }
+
+    OperatePtr Model::getOperateOpt(const ElementPtr &element, InternedString activity,
+                                    const std::string &deviceID) {
+        FASTBOT_TRACE_STAGE("getAction");
         // Record method start time for performance tracking
         double methodStartTimestamp = currentStamp();
         
-        // Step 1: Get custom action from preference if user specified one
-        ActionPtr customAction = getCustomActionIfExists(activity, element);
-        
-        // Step 2: Get or create activity pointer (reuses existing pointers for memory efficiency)
-        stringPtr activityPtr = getOrCreateActivityPtr(activity);
-        
-        // Step 3: Get or create agent for this device (creates default if needed)
-        AbstractAgentPtr agent = getOrCreateAgent(deviceID);
+        // Step 1: Get or create this device's shard (creates default agent if needed);
+        // steps of the same device run one at a time, other devices run concurrently
+        DeviceShardPtr shard = getOrCreateShard(deviceID);
+        if (nullptr == shard) {
+            return DeviceOperateWrapper::OperateNop;
+        }
+        std::lock_guard<std::mutex> stepLock(shard->stepMutex);
+        AbstractAgentPtr agent = shard->agent;
+
+        // Step 2: Get custom action from preference if user specified one
+        ActionPtr customAction;
+        {
+            StageTimer resolveTimer(this->_perfStats, PerfStage::PreferenceResolve);
+            customAction = getCustomActionIfExists(activity, element, shard->rng);
+        }
         
-        // Step 4: Create state from element and add to graph
-        // The graph handles deduplication if a similar state already exists
+        // Step 3: Create state from element and add to graph
+        // The graph handles deduplication if a similar state already exists; the state is
+        // built while the device's previous step finishes
         // currentStamp() returns ms; record build-state-only duration for log
         double buildStateStartTimestamp = currentStamp();
-        StatePtr state = createAndAddState(element, agent, activityPtr);
+        double waitCostMs = 0.0;
+        bool hadPendingStep = shard->pendingStep != nullptr;
+        StatePtr state = createAndAddState(element, agent, activity, *shard, waitCostMs);
         double buildStateEndTimestamp = currentStamp();
+        if (hadPendingStep) {
+            this->_perfStats.recordMillis(PerfStage::PendingStepWait, waitCostMs);
+        }
 #if DYNAMIC_STATE_ABSTRACTION_ENABLED
-        recordTransition(agent, state);
-        recordStateSplitIfRefined(activityPtr ? *activityPtr : "", state);
-        if (state && state->getActivityString() &&
-            state->getMaxWidgetsPerModelAction() > static_cast<size_t>(AlphaMaxGuiActionsPerModelAction)) {
-            _activitiesNeedingAlphaRefinement.insert(activityPtr ? *activityPtr : "");
+        {
+            std::lock_guard<std::mutex> abstractionLock(this->_abstractionMutex);
+            Graph::ReadLock graphLock = this->_graph->readLock();
+            recordTransition(agent, state);
+            recordStateSplitIfRefined(activity, state);
+            if (state && state->getActivityString() &&
+                state->getMaxWidgetsPerModelAction() > static_cast<size_t>(AlphaMaxGuiActionsPerModelAction)) {
+                _activitiesNeedingAlphaRefinement.insert(activity);
+            }
         }
 #endif
-        // Step 5: Select action (either custom, restart, or from agent)
         double actionCost = 0.0;
-        ActionPtr action = selectAction(state, agent, customAction, actionCost);
-        
-        // Handle null action gracefully
-        if (nullptr == action) {
-            return DeviceOperateWrapper::OperateNop;
+        bool agentStep = false;
+        ActionPtr action;
+        OperatePtr opt;
+        {
+            // Agents read and visit the shared states and actions while selecting
+            Graph::WriteLock graphLock = this->_graph->writeLock();
+
+            // Step 4: Select action (either custom, restart, or from agent)
+            {
+                StageTimer selectTimer(this->_perfStats, PerfStage::ActionSelection);
+                ActionPtr speculativeAction;
+#if FASTBOT_SPECULATIVE_STEPS
+                speculativeAction = takeSpeculativeAction(agent, state, *shard);
+#endif
+                action = selectAction(state, agent, customAction, speculativeAction, actionCost, agentStep);
+            }
+            // The agent re-adjusted the priorities of the state's actions
+            if (state) {
+                state->markSessionDirty();
+            }
+
+            // Handle null action gracefully
+            if (nullptr == action) {
+                return DeviceOperateWrapper::OperateNop;
+            }
+
+            // Step 5: Convert action to operation object and apply patches
+            StageTimer convertTimer(this->_perfStats, PerfStage::OperateConversion);
+            opt = convertActionToOperate(action, shard->rng);
         }
         
-        // Step 6: Convert action to operation object and apply patches
-        OperatePtr opt = convertActionToOperate(action, state);
-        
         // Record end time and log performance metrics (currentStamp returns ms, keep ms for log)
         double methodEndTimestamp = currentStamp();
-        double buildStateCostMs = buildStateEndTimestamp - buildStateStartTimestamp;
+        double buildStateCostMs = buildStateEndTimestamp - buildStateStartTimestamp - waitCostMs;
         double actionCostMs = actionCost;
         double totalCostMs = methodEndTimestamp - methodStartTimestamp;
+        this->_perfStats.recordMillis(PerfStage::Total, totalCostMs);
 #if DYNAMIC_STATE_ABSTRACTION_ENABLED
-        BLOG("build state cost: %.3fms action cost: %.3fms total cost: %.3fms dims=[%s]",
+        BLOG("build state cost: %.3fms action cost: %.3fms wait cost: %.3fms total cost: %.3fms dims=[%s]",
              buildStateCostMs,
              actionCostMs,
+             waitCostMs,
              totalCostMs,
              maskToDimensionString(getActivityKeyMask(activity)).c_str());
 #else
-        BLOG("build state cost: %.3fms action cost: %.3fms total cost: %.3fms",
+        BLOG("build state cost: %.3fms action cost: %.3fms wait cost: %.3fms total cost: %.3fms",
              buildStateCostMs,
              actionCostMs,
+             waitCostMs,
              totalCostMs);
 #endif
+
+        bool checkAbstraction = false;
 #if DYNAMIC_STATE_ABSTRACTION_ENABLED
-        _stepCountSinceLastCheck++;
-        if (_stepCountSinceLastCheck >= RefinementCheckInterval) {
-            runRefinementAndCoarseningIfScheduled();
-            _stepCountSinceLastCheck = 0;
+        {
+            std::lock_guard<std::mutex> abstractionLock(this->_abstractionMutex);
+            _stepCountSinceLastCheck++;
+            if (_stepCountSinceLastCheck >= RefinementCheckInterval) {
+                _stepCountSinceLastCheck = 0;
+                runRefinementAndCoarseningIfScheduled();
+            }
+            // The batch runs a few tasks per step, in finishStep
+            checkAbstraction = !_abstractionTasks.empty();
         }
 #endif
+
+        // Step 7: Finish the step while the device executes the operation
+#if FASTBOT_PIPELINED_STEPS
+        shard->pendingStep = this->_stepExecutor->submit([this, agent, state, action, agentStep, checkAbstraction,
+                                                          shard]() {
+            this->finishStep(agent, state, action, agentStep, checkAbstraction, *shard);
+        });
+        shard->pendingStepChecksAbstraction = checkAbstraction;
+#else
+        finishStep(agent, state, action, agentStep, checkAbstraction, *shard);
+#endif
         return opt;
     }
 
+    std::vector<PlannedOperate> Model::getOperatePlan(const ElementPtr &element, const std::string &activity,
+                                                      const std::string &deviceID, size_t maxSteps,
+                                                      size_t unexecutedSteps) {
+        DeviceShardPtr shard = getOrCreateShard(deviceID);
+        if (this->_preference && shard) {
+            // This device's planned steps it did not execute go back to the queue
+            std::lock_guard<std::mutex> stepLock(shard->stepMutex);
+            size_t requeued = std::min(unexecutedSteps, shard->plannedActions.size());
+            std::lock_guard<std::mutex> preferenceLock(this->_preferenceMutex);
+            this->_preference->requeueActions(std::vector<CustomActionPtr>(
+                    shard->plannedActions.end() - static_cast<std::ptrdiff_t>(requeued), shard->plannedActions.end()));
+            shard->plannedActions.clear();
+        }
+
+        std::vector<PlannedOperate> plan;
+        plan.push_back(PlannedOperate{getOperateOpt(element, activity, deviceID), "", 0});
+        if (maxSteps <= 1 || !this->_preference || !element || !shard) {
+            return plan;
+        }
+
+        std::vector<ElementPtr> targets;
+        std::vector<CustomActionPtr> plannedActions;
+        {
+            std::lock_guard<std::mutex> preferenceLock(this->_preferenceMutex);
+            plannedActions = this->_preference->planQueuedActions(element, maxSteps - 1, targets);
+        }
+        std::lock_guard<std::mutex> stepLock(shard->stepMutex);
+        shard->plannedActions = plannedActions;
+        for (size_t i = 0; i < plannedActions.size(); i++) {
+            const CustomActionPtr &customAction = plannedActions[i];
+            PlannedOperate step;
+            step.operate = convertActionToOperate(customAction, shard->rng);
+            step.expectedActivity = customAction->activity.empty() ? activity : customAction->activity;
+            step.expectedWidgetHash = PlannedOperate::widgetGuardHash(targets[i]->getClassname(),
+                                                                      targets[i]->getBounds());
+            plan.push_back(step);
+        }
+        BDLOG("planned %d steps ahead of the first", (int) (plan.size() - 1));
+        return plan;
+    }
+
 #if DYNAMIC_STATE_ABSTRACTION_ENABLED
     void Model::recordTransition(const AbstractAgentPtr &agent, const StatePtr &targetState) {
         if (!agent || !targetState) return;
         StatePtr srcState = agent->getCurrentState();
         ActivityStateActionPtr act = agent->getCurrentAction();
         if (!srcState || !act || !act->isModelAct() || !act->requireTarget()) return;
-        TransitionEntry e;
-        e.sourceStateHash = srcState->hash();
-        e.actionHash = act->hash();
-        e.targetStateHash = targetState->hash();
-        {
-            auto actPtr = srcState->getActivityString();
-            e.sourceActivity = (actPtr && actPtr.get()) ? *actPtr : "";
-        }
-        e.valid = true;
-        if (_transitionLog.empty()) return;
+        if (_transitionLog.capacity() == 0) return;
+        auto actPtr = srcState->getActivityString();
+        InternedString sourceActivity = (actPtr && actPtr.get()) ? InternedString::intern(*actPtr) : InternedString();
         BDLOG("state abstraction: transition src=%lu act=%lu tgt=%lu activity=%s",
-              (unsigned long)e.sourceStateHash, (unsigned long)e.actionHash, (unsigned long)e.targetStateHash,
-              e.sourceActivity.c_str());
-        _transitionLog[_transitionLogWriteIndex] = std::move(e);
-        _transitionLogWriteIndex = (_transitionLogWriteIndex + 1) % _transitionLog.size();
+              (unsigned long)srcState->hash(), (unsigned long)act->hash(), (unsigned long)targetState->hash(),
+              sourceActivity.str().c_str());
+        _transitionLog.record(srcState->hash(), act->hash(), targetState->hash(), sourceActivity);
     }
 
-    void Model::recordStateSplitIfRefined(const std::string &activity, const StatePtr &state) {
+    void Model::recordStateSplitIfRefined(InternedString activity, const StatePtr &state) {
         if (!state) return;
         auto it = _activityAbstractionContext.find(activity);
         if (it == _activityAbstractionContext.end()) return;
         ActivityAbstractionContext &ctx = it->second;
-        WidgetKeyMask cur = getActivityKeyMask(activity);
+        WidgetKeyMask cur = findActivityKeyMask(activity);
         if (ctx.previousMask == cur) return;  // not refined yet or already coarsened
         uintptr_t oldHash = state->getHashUnderMask(ctx.previousMask);
         uintptr_t newHash = state->hash();
         ctx.oldStateToNewStates[oldHash].insert(newHash);
         BDLOG("state abstraction: split activity=%s oldHash=%lu newHash=%lu setSize=%zu",
-              activity.c_str(), (unsigned long)oldHash, (unsigned long)newHash,
+              activity.str().c_str(), (unsigned long)oldHash, (unsigned long)newHash,
               ctx.oldStateToNewStates[oldHash].size());
     }
 
-    std::vector<std::string> Model::detectNonDeterminism() const {
-        using Key = std::pair<uintptr_t, uintptr_t>;
-        std::map<Key, std::pair<std::unordered_set<uintptr_t>, std::string>> saToTargets;
-        for (const auto &e : _transitionLog) {
-            if (!e.valid) continue;
-            if (e.sourceStateHash == e.targetStateHash) continue;
-            Key k(e.sourceStateHash, e.actionHash);
-            saToTargets[k].first.insert(e.targetStateHash);
-            saToTargets[k].second = e.sourceActivity;
-        }
-        std::set<std::string> activitiesSet;
-        for (const auto &p : saToTargets) {
-            if (p.second.first.size() >= static_cast<size_t>(MinNonDeterminismCount)) {
-                activitiesSet.insert(p.second.second);
-            }
-        }
-        return std::vector<std::string>(activitiesSet.begin(), activitiesSet.end());
+    std::vector<InternedString> Model::detectNonDeterminism() const {
+        // Pair targets are counted as transitions are recorded; nothing to scan here
+        return _transitionLog.nonDeterministicActivities();
     }
 
-    bool Model::refineActivity(const std::string &activity) {
-        WidgetKeyMask cur = getActivityKeyMask(activity);
+    bool Model::refineActivity(InternedString activity) {
+        WidgetKeyMask cur = findActivityKeyMask(activity);
         const auto tMask = static_cast<WidgetKeyMask>(WidgetKeyAttr::Text);
         const auto cMask = static_cast<WidgetKeyMask>(WidgetKeyAttr::ContentDesc);
         const auto iMask = static_cast<WidgetKeyMask>(WidgetKeyAttr::Index);
@@ -661,54 +963,63 @@ namespace fastbotx {
                 const ActivityLastStateTextStats &st = it->second;
                 if (st.widgetsWithNonEmptyText > static_cast<size_t>(MaxTextWidgetCount)) {
                     BDLOG("state abstraction: skip refine activity=%s (+Text) reason=textCount>%d",
-                          activity.c_str(), (int)MaxTextWidgetCount);
+                          activity.str().c_str(), (int)MaxTextWidgetCount);
                     return false;
                 }
                 if (st.totalWidgets > 0 &&
                     st.widgetsWithNonEmptyText * 100 > static_cast<size_t>(MaxTextWidgetRatioPercent) * st.totalWidgets) {
                     BDLOG("state abstraction: skip refine activity=%s (+Text) reason=textRatio>%d%%",
-                          activity.c_str(), (int)MaxTextWidgetRatioPercent);
+                          activity.str().c_str(), (int)MaxTextWidgetRatioPercent);
                     return false;
                 }
                 if (st.uniqueWidgetsIfAddText > static_cast<size_t>(MaxUniqueWidgetsAfterText)) {
                     BDLOG("state abstraction: skip refine activity=%s (+Text) reason=uniqueAfterText>%d",
-                          activity.c_str(), (int)MaxUniqueWidgetsAfterText);
+                          activity.str().c_str(), (int)MaxUniqueWidgetsAfterText);
                     return false;
                 }
             }
         } else {
-            BDLOG("state abstraction: skip refine activity=%s reason=already finest mask", activity.c_str());
+            BDLOG("state abstraction: skip refine activity=%s reason=already finest mask", activity.str().c_str());
             return false;
         }
         if (_coarseningBlacklist.count(std::make_pair(activity, newMask)) != 0) {
-            BDLOG("state abstraction: skip refine activity=%s newMask=%u reason=blacklisted", activity.c_str(), (unsigned)newMask);
+            BDLOG("state abstraction: skip refine activity=%s newMask=%u reason=blacklisted", activity.str().c_str(), (unsigned)newMask);
             return false;
         }
         ActivityAbstractionContext &ctx = _activityAbstractionContext[activity];
         ctx.previousMask = cur;
         ctx.stateCountAtLastRefinement = getGraph()->getStateCountByActivity(activity);
         ctx.oldStateToNewStates.clear();
-        setActivityKeyMask(activity, newMask);
+        _activityKeyMask[activity] = newMask;
         BLOG("state abstraction: refine activity=%s mask %u->%u (+%s) stateCount=%zu dims=[%s]->[%s]",
-             activity.c_str(), (unsigned)cur, (unsigned)newMask, addedAttr, ctx.stateCountAtLastRefinement,
+             activity.str().c_str(), (unsigned)cur, (unsigned)newMask, addedAttr, ctx.stateCountAtLastRefinement,
              maskToDimensionString(cur).c_str(), maskToDimensionString(newMask).c_str());
         return true;
     }
 
-    void Model::coarsenActivityIfNeeded(const std::string &activity) {
+    void Model::coarsenActivityIfNeeded(InternedString activity) {
         auto it = _activityAbstractionContext.find(activity);
         if (it == _activityAbstractionContext.end()) return;
         // APE coarsening: if any old state L′ splits into > β new states, roll back
         for (const auto &p : it->second.oldStateToNewStates) {
             if (p.second.size() > static_cast<size_t>(BetaMaxSplitCount)) {
-                WidgetKeyMask cur = getActivityKeyMask(activity);
+                WidgetKeyMask cur = findActivityKeyMask(activity);
                 WidgetKeyMask prev = it->second.previousMask;
-                setActivityKeyMask(activity, prev);
+                // Fold the states built under the rolled-back mask into the states they split from
+                for (const auto &split : it->second.oldStateToNewStates) {
+                    for (uintptr_t newHash : split.second) {
+                        StatePtr state = getGraph()->findState(activity, newHash);
+                        if (newHash != split.first && state && state->getHashUnderMask(prev) != newHash) {
+                            _supersededStates.push_back(SupersededState{activity, newHash, split.first});
+                        }
+                    }
+                }
+                _activityKeyMask[activity] = prev;
                 _coarseningBlacklist.insert(std::make_pair(activity, cur));
                 it->second.oldStateToNewStates.clear();
                 it->second.stateCountAtLastRefinement = getGraph()->getStateCountByActivity(activity);
                 BLOG("state abstraction: coarsen activity=%s mask %u->%u (split %zu>%d) dims=[%s]->[%s]",
-                     activity.c_str(), (unsigned)cur, (unsigned)prev, p.second.size(), (int)BetaMaxSplitCount,
+                     activity.str().c_str(), (unsigned)cur, (unsigned)prev, p.second.size(), (int)BetaMaxSplitCount,
                      maskToDimensionString(cur).c_str(), maskToDimensionString(prev).c_str());
                 return;
             }
@@ -717,37 +1028,29 @@ namespace fastbotx {
     }
 
     void Model::runRefinementAndCoarseningIfScheduled() {
-        if (_stepCountSinceLastCheck < static_cast<size_t>(RefinementCheckInterval)) return;
-        BLOG("state abstraction: batch at step %zu (interval=%d)", _stepCountSinceLastCheck, (int)RefinementCheckInterval);
+        if (!_abstractionTasks.empty()) {
+            BLOG("state abstraction: batch skipped, %zu tasks of the last one pending", _abstractionTasks.size());
+            return;
+        }
         // Coarsen check for activities refined in a previous batch (oldStateToNewStates accumulated over last K steps)
         for (const auto &kv : _activityAbstractionContext) {
-            const std::string &activity = kv.first;
-            const ActivityAbstractionContext &ctx = kv.second;
-            if (ctx.previousMask != getActivityKeyMask(activity)) {
-                coarsenActivityIfNeeded(activity);
+            if (kv.second.previousMask != findActivityKeyMask(kv.first)) {
+                _abstractionTasks.push_back(AbstractionTask{AbstractionTask::Coarsen, kv.first});
             }
         }
+        // Refine tasks run their activity's coarsening check right after refining, as both orders do
         if (UsePaperRefinementOrder) {
             // Paper order: (1) ActionRefinement(α) + Coarsening(β), (2) StateRefinement (non-determinism) + Coarsening(β)
-            std::vector<std::string> activitiesAlpha(_activitiesNeedingAlphaRefinement.begin(),
-                                                     _activitiesNeedingAlphaRefinement.end());
-            _activitiesNeedingAlphaRefinement.clear();
-            BLOG("state abstraction: paper order alpha=%zu", activitiesAlpha.size());
-            for (const auto &activity : activitiesAlpha) {
-                if (refineActivity(activity)) {
-                    coarsenActivityIfNeeded(activity);
-                }
-            }
-            std::vector<std::string> activitiesNonDet = detectNonDeterminism();
-            BLOG("state abstraction: paper order nonDet=%zu", activitiesNonDet.size());
-            for (const auto &activity : activitiesNonDet) {
-                if (refineActivity(activity)) {
-                    coarsenActivityIfNeeded(activity);
-                }
+            BLOG("state abstraction: batch, paper order alpha=%zu", _activitiesNeedingAlphaRefinement.size());
+            for (const auto &activity : _activitiesNeedingAlphaRefinement) {
+                _abstractionTasks.push_back(AbstractionTask{AbstractionTask::Refine, activity});
             }
+            _activitiesNeedingAlphaRefinement.clear();
+            // Non-determinism is detected once the α refinements ran
+            _abstractionTasks.push_back(AbstractionTask{AbstractionTask::DetectNonDeterminism, InternedString()});
         } else {
             // Per-K-step batch: merge α + non-determinism, refine all, then coarsen all refined
-            std::vector<std::string> activitiesToRefine = detectNonDeterminism();
+            std::vector<InternedString> activitiesToRefine = detectNonDeterminism();
             size_t nonDetCount = activitiesToRefine.size();
             size_t alphaCount = _activitiesNeedingAlphaRefinement.size();
             for (const auto &a : _activitiesNeedingAlphaRefinement) {
@@ -758,32 +1061,105 @@ namespace fastbotx {
             _activitiesNeedingAlphaRefinement.clear();
             BLOG("state abstraction: batch nonDet=%zu alpha=%zu toRefine=%zu",
                  nonDetCount, alphaCount, activitiesToRefine.size());
-            std::vector<std::string> activitiesJustRefined;
             for (const auto &activity : activitiesToRefine) {
-                if (refineActivity(activity)) {
-                    activitiesJustRefined.push_back(activity);
+                _abstractionTasks.push_back(AbstractionTask{AbstractionTask::Refine, activity});
+            }
+        }
+        _abstractionTasks.push_back(AbstractionTask{AbstractionTask::MergeSuperseded, InternedString()});
+    }
+
+    void Model::runAbstractionTasks() {
+        for (int run = 0; run < AbstractionTasksPerStep && !_abstractionTasks.empty(); run++) {
+            AbstractionTask task = std::move(_abstractionTasks.front());
+            _abstractionTasks.pop_front();
+            switch (task.kind) {
+                case AbstractionTask::Coarsen: {
+                    Graph::ReadLock graphLock = this->_graph->readLock();
+                    coarsenActivityIfNeeded(task.activity);
+                    break;
+                }
+                case AbstractionTask::Refine: {
+                    Graph::ReadLock graphLock = this->_graph->readLock();
+                    if (refineActivity(task.activity)) {
+                        coarsenActivityIfNeeded(task.activity);
+                    }
+                    break;
+                }
+                case AbstractionTask::DetectNonDeterminism: {
+                    std::vector<InternedString> activitiesNonDet = detectNonDeterminism();
+                    BLOG("state abstraction: paper order nonDet=%zu", activitiesNonDet.size());
+                    // Ahead of the MergeSuperseded task that closes the batch
+                    for (auto it = activitiesNonDet.rbegin(); it != activitiesNonDet.rend(); ++it) {
+                        _abstractionTasks.push_front(AbstractionTask{AbstractionTask::Refine, *it});
+                    }
+                    break;
+                }
+                case AbstractionTask::MergeSuperseded: {
+                    Graph::WriteLock graphLock = this->_graph->writeLock();
+                    mergeSupersededStates();
+                    break;
                 }
             }
-            for (const auto &activity : activitiesJustRefined) {
-                coarsenActivityIfNeeded(activity);
+        }
+    }
+
+    void Model::mergeSupersededStates() {
+        // A standing refinement: each old state goes into the first (smallest hash) state it split into
+        for (const auto &kv : _activityAbstractionContext) {
+            WidgetKeyMask cur = findActivityKeyMask(kv.first);
+            if (kv.second.previousMask == cur) continue;
+            for (const auto &split : kv.second.oldStateToNewStates) {
+                StatePtr oldState = this->_graph->findState(kv.first, split.first);
+                // Gone already, or the refinement does not tell its widgets apart
+                if (!oldState || oldState->getHashUnderMask(cur) == split.first) continue;
+                _supersededStates.push_back(SupersededState{kv.first, split.first,
+                                                            *std::min_element(split.second.begin(), split.second.end())});
             }
-            if (!activitiesJustRefined.empty()) {
-                BLOG("state abstraction: batch refined=%zu coarsenChecked=%zu",
-                     activitiesJustRefined.size(), activitiesJustRefined.size());
+        }
+        std::sort(_supersededStates.begin(), _supersededStates.end());
+        _supersededStates.erase(std::unique(_supersededStates.begin(), _supersededStates.end()),
+                                _supersededStates.end());
+        size_t merged = 0;
+        std::vector<SupersededState> waiting;
+        for (const auto &superseded : _supersededStates) {
+            StatePtr from = this->_graph->findState(superseded.activity, superseded.from);
+            if (!from) continue;  // merged or evicted
+            StatePtr into = this->_graph->findState(superseded.activity, superseded.into);
+            if (into && this->_graph->mergeState(from, into)) {
+                merged++;
             } else {
-                BLOG("state abstraction: batch done refined=0 (all already finest or skipped)");
+                // Held by an agent, or the successor is cold or not (re)built yet: retry next batch
+                waiting.push_back(superseded);
             }
         }
+        _supersededStates.swap(waiting);
+        if (merged > 0) {
+            BLOG("state abstraction: merged %zu superseded states, %zu waiting, graph has %zu states",
+                 merged, _supersededStates.size(), this->_graph->stateSize());
+        }
     }
 #endif
 
     void Model::reportActivity(const std::string &activity) {
         if (activity.empty()) return;
         std::lock_guard<std::mutex> lock(_coverageMutex);
-        _visitedActivities.insert(activity);
+        if (_visitedActivities.insert(activity).second) {
+            _activityOrder.push_back(activity);
+        }
         _coverageStepCount++;
     }
 
+    void Model::reportActivities(const std::vector<std::string> &activities) {
+        std::lock_guard<std::mutex> lock(_coverageMutex);
+        for (const auto &activity : activities) {
+            if (activity.empty()) continue;
+            if (_visitedActivities.insert(activity).second) {
+                _activityOrder.push_back(activity);
+            }
+            _coverageStepCount++;
+        }
+    }
+
     std::string Model::getCoverageJson() const {
         std::lock_guard<std::mutex> lock(_coverageMutex);
         nlohmann::json j;
@@ -796,15 +1172,235 @@ namespace fastbotx {
         return j.dump();
     }
 
+    uint32_t Model::writeCoverageDelta(uint32_t sinceVersion, std::string &out) const {
+        static const char CoverageMagic[] = {'F', 'C', 0, 1};
+        std::lock_guard<std::mutex> lock(_coverageMutex);
+        auto version = static_cast<uint32_t>(_activityOrder.size());
+        if (sinceVersion > version) {
+            sinceVersion = 0;
+        }
+        size_t size = 16;
+        for (size_t i = sinceVersion; i < version; i++) {
+            size += 2 + std::min<size_t>(_activityOrder[i].size(), UINT16_MAX);
+        }
+        out.resize(size);
+        char *data = &out[0];
+        auto steps = static_cast<uint32_t>(_coverageStepCount);
+        uint32_t count = version - sinceVersion;
+        memcpy(data, CoverageMagic, sizeof(CoverageMagic));
+        memcpy(data + 4, &version, sizeof(version));
+        memcpy(data + 8, &steps, sizeof(steps));
+        memcpy(data + 12, &count, sizeof(count));
+        size_t offset = 16;
+        for (size_t i = sinceVersion; i < version; i++) {
+            const std::string &activity = _activityOrder[i];
+            auto length = static_cast<uint16_t>(std::min<size_t>(activity.size(), UINT16_MAX));
+            memcpy(data + offset, &length, sizeof(length));
+            memcpy(data + offset + 2, activity.data(), length);
+            offset += 2 + length;
+        }
+        return version;
+    }
+
+    std::string Model::getMemoryFootprintJson() const {
+        MemoryFootprint footprint;
+        std::vector<AbstractAgentPtr> agents;
+        {
+            std::shared_lock<std::shared_timed_mutex> shardsLock(this->_deviceShardsMutex);
+            for (const auto &deviceShard: this->_deviceShards) {
+                agents.push_back(deviceShard.second->agent);
+            }
+        }
+        {
+            // Steps change states and agents under the write lock only
+            Graph::ReadLock graphLock = this->_graph->readLock();
+            this->_graph->accountMemory(footprint);
+            for (const AbstractAgentPtr &agent: agents) {
+                if (agent) {
+                    agent->accountMemory(footprint);
+                }
+            }
+        }
+        if (this->_preference) {
+            std::lock_guard<std::mutex> preferenceLock(this->_preferenceMutex);
+            this->_preference->accountMemory(footprint);
+        }
+#if DYNAMIC_STATE_ABSTRACTION_ENABLED
+        {
+            std::lock_guard<std::mutex> abstractionLock(this->_abstractionMutex);
+            size_t abstractionBytes = this->_transitionLog.heapBytes() +
+                                      MemoryFootprint::bytesOf(this->_activityAbstractionContext) +
+                                      MemoryFootprint::bytesOf(this->_activityLastStateTextStats) +
+                                      MemoryFootprint::bytesOf(this->_coarseningBlacklist) +
+                                      MemoryFootprint::bytesOf(this->_activitiesNeedingAlphaRefinement) +
+                                      MemoryFootprint::bytesOf(this->_supersededStates);
+            for (const auto &context: this->_activityAbstractionContext) {
+                abstractionBytes += MemoryFootprint::bytesOf(context.second.oldStateToNewStates);
+                for (const auto &split: context.second.oldStateToNewStates) {
+                    abstractionBytes += MemoryFootprint::bytesOf(split.second);
+                }
+            }
+            footprint.add("model.abstraction", this->_transitionLog.size(), abstractionBytes);
+        }
+#endif
+        return footprint.toJson();
+    }
+
+    void Model::startSession() {
+        long intervalMs = this->_preference ? this->_preference->getSessionSnapshotIntervalMs() : 0;
+        if (intervalMs <= 0 || this->getPackageName().empty()) {
+            return;
+        }
+        std::lock_guard<std::mutex> sessionLock(this->_sessionMutex);
+        if (this->_sessionSnapshot) {
+            return;
+        }
+        std::string path = SessionSnapshot::pathOf(this->getPackageName());
+        this->resumeSession(path);
+        this->_sessionSnapshot = std::make_shared<SessionSnapshot>(path);
+        this->_sessionScheduler = std::make_shared<ModelStorageScheduler>(
+                std::chrono::milliseconds(intervalMs), 0, std::chrono::milliseconds(intervalMs));
+        threadDelayExec(0, false, &Model::threadSessionSnapshot, std::weak_ptr<Model>(shared_from_this()));
+        BLOG("session: snapshot every %ld ms to %s", intervalMs, path.c_str());
+    }
+
+    bool Model::resumeSession(const std::string &path) {
+        double startTimestamp = currentStamp();
+        SessionData data;
+        if (!SessionSnapshot::load(path, data)) {
+            return false;
+        }
+        {
+            // Masks first: the restored state hashes were computed with them
+            std::lock_guard<std::mutex> abstractionLock(this->_abstractionMutex);
+            for (const auto &activityMask: data.activityKeyMasks) {
+                this->_activityKeyMask[activityMask.first] = activityMask.second;
+            }
+#if DYNAMIC_STATE_ABSTRACTION_ENABLED
+            for (const auto &blacklisted: data.coarseningBlacklist) {
+                this->_coarseningBlacklist.insert(std::make_pair(blacklisted.first, blacklisted.second));
+            }
+            for (const SessionData::Transition &transition: data.transitions) {
+                this->_transitionLog.record(static_cast<uintptr_t>(transition.source),
+                                            static_cast<uintptr_t>(transition.action),
+                                            static_cast<uintptr_t>(transition.target), transition.activity);
+            }
+#endif
+        }
+        size_t restored = 0;
+        {
+            Graph::WriteLock graphLock = this->_graph->writeLock();
+            for (auto &activityState: data.states) {
+                StatePtr state = StateFactory::createColdState(AlgorithmType::Reuse, activityState.first.ptr(),
+                                                               std::move(activityState.second));
+                if (state && this->_graph->restoreState(state)) {
+                    restored++;
+                }
+            }
+            for (const auto &activityVisits: data.activityVisits) {
+                this->_graph->restoreVisitCount(activityVisits.first, activityVisits.second);
+            }
+        }
+        BLOG("session: resumed %zu states, %zu masks, %zu transitions from %s in %.1f ms", restored,
+             data.activityKeyMasks.size(), data.transitions.size(), path.c_str(), currentStamp() - startTimestamp);
+        return true;
+    }
+
+    void Model::captureSession(SessionData &capture, bool complete) const {
+        {
+            std::lock_guard<std::mutex> abstractionLock(this->_abstractionMutex);
+            for (const auto &activityMask: this->_activityKeyMask) {
+                capture.activityKeyMasks.emplace_back(activityMask.first, activityMask.second);
+            }
+#if DYNAMIC_STATE_ABSTRACTION_ENABLED
+            for (const auto &blacklisted: this->_coarseningBlacklist) {
+                capture.coarseningBlacklist.emplace_back(blacklisted.first, blacklisted.second);
+            }
+            this->_transitionLog.forEachSince(0, [&capture](uintptr_t source, uintptr_t action, uintptr_t target,
+                                                            InternedString activity) {
+                capture.transitions.push_back(SessionData::Transition{source, action, target, activity});
+            });
+            capture.transitionsRecorded = this->_transitionLog.recorded();
+#endif
+        }
+        // Steps change states, and mark them dirty, under the write lock only
+        Graph::ReadLock graphLock = this->_graph->readLock();
+        capture.complete = complete;
+        if (complete) {
+            capture.states.reserve(this->_graph->stateSize());
+        }
+        this->_graph->forEachState([&capture, complete](const StatePtr &state) {
+            if (complete || state->isSessionDirty()) {
+                capture.states.emplace_back(Graph::activityOf(state), state->toColdRecord());
+                state->clearSessionDirty();
+            }
+        });
+        capture.activityVisits = this->_graph->getVisitCountsByActivity();
+    }
+
+    /**
+     * @brief Session snapshot thread: writes a snapshot every max.sessionSnapshotSeconds
+     *
+     * Like the agents' model storage threads it waits on the scheduler only, holds the
+     * model for the duration of a write, and exits once endSession shuts the scheduler down.
+     *
+     * @param model Weak pointer to the Model instance
+     */
+    void Model::threadSessionSnapshot(const std::weak_ptr<Model> &model) {
+        ModelStorageSchedulerPtr scheduler;
+        if (auto modelPtr = model.lock()) {
+            scheduler = modelPtr->_sessionScheduler;
+        }
+        if (!scheduler) {
+            return;
+        }
+        while (scheduler->waitForNextSave() != ModelStorageScheduler::Trigger::Shutdown) {
+            auto modelPtr = model.lock();
+            if (!modelPtr) {
+                break;
+            }
+            double startTimestamp = currentStamp();
+            std::lock_guard<std::mutex> sessionLock(modelPtr->_sessionMutex);
+            if (!modelPtr->_sessionSnapshot) {
+                break;
+            }
+            SessionData capture;
+            modelPtr->captureSession(capture, modelPtr->_sessionSnapshot->needsCompleteCapture());
+            if (modelPtr->_sessionSnapshot->write(capture)) {
+                BDLOG("session: snapshot of %zu %s, %zu bytes on file, in %.1f ms", capture.states.size(),
+                      capture.complete ? "states" : "changed states", modelPtr->_sessionSnapshot->fileBytes(),
+                      currentStamp() - startTimestamp);
+            } else {
+                BLOGE("session: failed to write %s", modelPtr->_sessionSnapshot->path().c_str());
+            }
+        }
+        BLOG("session: snapshot thread exits");
+    }
+
+    void Model::endSession() {
+        if (this->_sessionScheduler) {
+            this->_sessionScheduler->shutdown();
+        }
+        std::lock_guard<std::mutex> sessionLock(this->_sessionMutex);
+        if (this->_sessionSnapshot) {
+            this->_sessionSnapshot->remove();
+            this->_sessionSnapshot.reset();
+        }
+    }
+
     /**
      * @brief Destructor for Model class
      * 
-     * Clears the device-agent map to release all agent resources.
+     * Finishes the pipelined steps and ends the session, then clears the device shard
+     * map to release all agent resources.
      * The graph and preference are shared pointers and will be automatically
      * cleaned up when the last reference is released.
      */
     Model::~Model() {
-        this->_deviceIDAgentMap.clear();
+        // Pipelined steps refer to this model
+        this->finishPendingSteps();
+        this->endSession();
+        this->_deviceShards.clear();
     }
 
 }
@@ -7,6 +7,7 @@
 #ifndef  Model_H_
 #define  Model_H_
 
+#include <functional>
 #include <memory>
 #include "Base.h"
 #include "State.h"
@@ -16,24 +17,26 @@
 #include "AbstractAgent.h"
 #include "AgentFactory.h"
 #include "Preference.h"
+#include "StepExecutor.h"
+#include "PerfStats.h"
+#include "TransitionLog.h"
+#include "SuccessorPredictor.h"
+#include "SessionSnapshot.h"
+#include "ModelStorageScheduler.h"
+#include "DecisionClient.h"
+#include <atomic>
 #include <mutex>
+#include <shared_mutex>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
+#include <deque>
 #include <set>
+#include <tuple>
 
 namespace fastbotx {
 
 #if DYNAMIC_STATE_ABSTRACTION_ENABLED
-    /// Single transition log entry for non-determinism detection
-    struct TransitionEntry {
-        uintptr_t sourceStateHash{0};
-        uintptr_t actionHash{0};
-        uintptr_t targetStateHash{0};
-        std::string sourceActivity;
-        bool valid{false};
-    };
-
     /// Per-activity context for refinement/coarsening (previous mask and L′→L split tracking)
     struct ActivityAbstractionContext {
         WidgetKeyMask previousMask{DefaultWidgetKeyMask};
@@ -42,6 +45,37 @@ namespace fastbotx {
         std::unordered_map<uintptr_t, std::unordered_set<uintptr_t>> oldStateToNewStates;
     };
 
+    /// One unit of a refinement/coarsening batch, run by Model::runAbstractionTasks
+    struct AbstractionTask {
+        enum Kind {
+            /// coarsenActivityIfNeeded(activity)
+            Coarsen,
+            /// refineActivity(activity), then the coarsening check if refined
+            Refine,
+            /// Queue a Refine for each non-deterministic activity (paper order)
+            DetectNonDeterminism,
+            /// mergeSupersededStates(), under the graph's write lock
+            MergeSuperseded
+        };
+        Kind kind;
+        InternedString activity;
+    };
+
+    /// A state of activity superseded by a mask change, and the state to merge it into
+    struct SupersededState {
+        InternedString activity;
+        uintptr_t from;
+        uintptr_t into;
+
+        bool operator<(const SupersededState &other) const {
+            return std::tie(this->activity, this->from, this->into) < std::tie(other.activity, other.from, other.into);
+        }
+
+        bool operator==(const SupersededState &other) const {
+            return this->activity == other.activity && this->from == other.from && this->into == other.into;
+        }
+    };
+
     /// Per-activity last-seen state stats for "skip Text refinement" when text-heavy or would explode
     struct ActivityLastStateTextStats {
         size_t widgetsWithNonEmptyText{0};
@@ -58,6 +92,37 @@ namespace fastbotx {
         constexpr const char* DefaultDeviceID = "0000001";
     }
 
+    /**
+     * @brief Per-device slice of the Model
+     * 
+     * Steps of one device run one at a time under stepMutex (the agent is not
+     * thread-safe); steps of different devices run concurrently and only meet in
+     * the shared Graph, the state abstraction tables and the Preference.
+     */
+    struct DeviceShard {
+        AbstractAgentPtr agent;
+        std::mutex stepMutex;
+        /// Rest of the device's last step, still running on the StepExecutor (guarded by stepMutex)
+        StepTaskPtr pendingStep;
+        /// pendingStep runs the state abstraction check, which may change the next page's mask
+        bool pendingStepChecksAbstraction{false};
+        /// The device's stream of RandomStreams for its steps' draws outside the agent
+        /// (custom event rates, input texts, throttle); guarded by stepMutex
+        Rng rng{RandomStreams::nextStream("device")};
+        /// Custom actions of the device's last plan after its first step, in order; guarded by stepMutex
+        std::vector<CustomActionPtr> plannedActions;
+#if FASTBOT_SPECULATIVE_STEPS
+        /// States reached after each (state, action) of the device
+        SuccessorPredictor successors;
+        /// State predicted for the next page and the action the agent selected for it ahead;
+        /// written by the finished step, read by the next once it waited for that step
+        StatePtr speculativeState;
+        ActionPtr speculativeAction;
+#endif
+    };
+
+    typedef std::shared_ptr<DeviceShard> DeviceShardPtr;
+
     /**
      * @brief Model class representing the core RL (Reinforcement Learning) model
      * 
@@ -68,6 +133,12 @@ namespace fastbotx {
      * - Provides the main interface for getting next operations
      * 
      * It uses shared_from_this to allow agents to hold references to the model.
+     * 
+     * getOperateOpt may be called concurrently for different devices. Lock order:
+     * device shard, then state abstraction, then Graph, then Preference.
+     * 
+     * With FASTBOT_PIPELINED_STEPS a step returns its operation once selected and is
+     * finished on the StepExecutor while the device executes it (see finishStep).
      */
     class Model : public std::enable_shared_from_this<Model> {
     public:
@@ -83,7 +154,10 @@ namespace fastbotx {
          * 
          * @return Number of unique states in the graph
          */
-        inline size_t stateSize() const { return this->getGraph()->stateSize(); }
+        inline size_t stateSize() const {
+            Graph::ReadLock graphLock = this->_graph->readLock();
+            return this->_graph->stateSize();
+        }
 
         /**
          * @brief Get the graph object
@@ -95,8 +169,8 @@ namespace fastbotx {
         /**
          * @brief Create and add an agent to the model for a specific device
          * 
-         * Creates a new agent, adds it to the device-agent map, and registers it
-         * as a listener to the graph for state change notifications.
+         * Creates a new agent and gives it its own device shard; a device that
+         * already has an agent keeps it.
          * 
          * @param deviceIDString Device ID string (empty string uses default device ID)
          * @param agentType The type of algorithm/agent to create
@@ -114,6 +188,17 @@ namespace fastbotx {
          */
         AbstractAgentPtr getAgent(const std::string &deviceID) const;
 
+        /**
+         * @brief Run fn on a device's agent while none of its steps runs
+         *
+         * Waits for the device's pipelined step and holds its step lock for the whole call,
+         * so fn may read agent state that only steps write (e.g. to flush the model).
+         *
+         * @param deviceID Device ID string (empty string uses default device ID)
+         * @return What fn returned, or false if the device has no agent
+         */
+        bool withIdleAgent(const std::string &deviceID, const std::function<bool(const AbstractAgentPtr &)> &fn);
+
         /**
          * @brief Get next operation step from XML string, returning JSON format
          * 
@@ -145,7 +230,8 @@ namespace fastbotx {
          * @brief Core method for getting next operation and updating RL model
          * 
          * This is the main orchestration method that creates states, selects actions,
-         * and updates the reinforcement learning model.
+         * and updates the reinforcement learning model. Calls for different devices may
+         * run concurrently; calls for the same device are serialized.
          * 
          * @param element XML Element object of the current page
          * @param activity Activity name string
@@ -155,6 +241,52 @@ namespace fastbotx {
         OperatePtr getOperateOpt(const ElementPtr &element, const std::string &activity,
                                  const std::string &deviceID = "");
 
+        /**
+         * @brief getOperateOpt for an activity interned before, e.g. registered once through JNI
+         * 
+         * The per-activity tables (widget key masks, abstraction bookkeeping, preference rules
+         * and black rects) are keyed by the interned id, so the step does no string lookups.
+         */
+        OperatePtr getOperateOpt(const ElementPtr &element, InternedString activity,
+                                 const std::string &deviceID = "");
+
+        /**
+         * @brief getOperateOpt, followed by the queued custom actions that can be resolved on the same page
+         * 
+         * Saves the device a GUI dump per scripted action: the steps after the first come from
+         * the custom event queue of the preference, resolved ahead on element and guarded by
+         * their activity and target widget (see PlannedOperate). They are not seen by the agent.
+         * 
+         * @param maxSteps Steps at most, at least 1
+         * @param unexecutedSteps Trailing steps of this device's previous plan it did not run
+         *        because a guard failed; they are queued again before this page is resolved
+         * @return The plan, its first step the result of getOperateOpt
+         */
+        std::vector<PlannedOperate> getOperatePlan(const ElementPtr &element, const std::string &activity,
+                                                   const std::string &deviceID, size_t maxSteps,
+                                                   size_t unexecutedSteps);
+
+        /**
+         * @brief Wait until the steps returned so far are finished on every device
+         * 
+         * Agents are then up to date with every step, e.g. before saving their model.
+         */
+        void finishPendingSteps();
+
+        /// Worker pool finishing pipelined steps; also runs steps submitted through JNI
+        const StepExecutorPtr &getStepExecutor() const { return this->_stepExecutor; }
+
+        /// Latency histograms of the step stages (the JNI layer records parsing)
+        PerfStats &getPerfStats() { return this->_perfStats; }
+
+#if FASTBOT_SPECULATIVE_STEPS
+        /// Steps that arrived as predicted and took the action selected ahead
+        uint64_t getSpeculationHits() const { return this->_speculationHits.load(std::memory_order_relaxed); }
+
+        /// Steps whose action was selected ahead for a state that did not arrive
+        uint64_t getSpeculationMisses() const { return this->_speculationMisses.load(std::memory_order_relaxed); }
+#endif
+
         /**
          * @brief Get the preference object
          * 
@@ -166,12 +298,20 @@ namespace fastbotx {
          * @brief Get widget key mask for an activity (dynamic state abstraction).
          * Returns DefaultWidgetKeyMask if activity not found.
          */
-        WidgetKeyMask getActivityKeyMask(const std::string &activity) const;
+        WidgetKeyMask getActivityKeyMask(InternedString activity) const;
+
+        WidgetKeyMask getActivityKeyMask(const std::string &activity) const {
+            return getActivityKeyMask(InternedString::intern(activity));
+        }
 
         /**
          * @brief Set widget key mask for an activity (dynamic state abstraction).
          */
-        void setActivityKeyMask(const std::string &activity, WidgetKeyMask mask);
+        void setActivityKeyMask(InternedString activity, WidgetKeyMask mask);
+
+        void setActivityKeyMask(const std::string &activity, WidgetKeyMask mask) {
+            setActivityKeyMask(InternedString::intern(activity), mask);
+        }
 
         /**
          * @brief Set the package name for network action parameters
@@ -201,11 +341,66 @@ namespace fastbotx {
          */
         void reportActivity(const std::string &activity);
 
+        /**
+         * @brief reportActivity for several activity switches under one lock, in order
+         */
+        void reportActivities(const std::vector<std::string> &activities);
+
         /**
          * @brief Get coverage summary as JSON: {"stepsCount":N,"testedActivities":["a1",...]}
          */
         std::string getCoverageJson() const;
 
+        /**
+         * @brief Coverage changes since a version, in binary: the JSON-free, incremental
+         * counterpart of getCoverageJson
+         *
+         * The version is the number of distinct activities seen, so a poller passes back the
+         * version of its last delta and gets only the activities seen since. Little-endian:
+         * magic "FC\0\1" (4) | version u32 | stepsCount u32 | activity count u32 |
+         * (length u16, UTF-8 bytes) per activity first seen after sinceVersion, in order.
+         * A sinceVersion beyond the current version (another model) is taken as 0.
+         *
+         * @param out Replaced with the encoding; its capacity is reused across calls
+         * @return The current version
+         */
+        uint32_t writeCoverageDelta(uint32_t sinceVersion, std::string &out) const;
+
+        /**
+         * @brief Estimated heap bytes per subsystem as JSON (MemoryFootprint::toJson):
+         * {"totalBytes":N,"processRssBytes":N,"subsystems":{"graph.states":{"count":N,"bytes":N},...}}
+         * 
+         * Walks the graph, the agents and the preference, holding the Graph read lock
+         * meanwhile: meant to be polled every few minutes, not every step.
+         */
+        std::string getMemoryFootprintJson() const;
+
+        /**
+         * @brief Resume the session a crash interrupted, then snapshot this one periodically
+         *
+         * Call once the package name is set, before the first step. Does nothing unless
+         * max.sessionSnapshotSeconds is set. The snapshot of the package, if any, was left by
+         * a process that did not end its session: its graph comes back as cold states (their
+         * actions rehydrate on revisit), with the widget key masks, the coarsening blacklist
+         * and the transition ring of dynamic state abstraction. Q-values come back with the
+         * reuse model as usual.
+         */
+        void startSession();
+
+        /// Stop the snapshots and delete the file: the session ended cleanly and is not to be resumed
+        void endSession();
+
+        /**
+         * @brief AlgorithmType::Server: the operate the decision server chose for a raw dump
+         *
+         * The server parses the dump and runs the model, so the device does neither. Null when
+         * no server is configured (max.decisionServer) or it failed to answer in time: the
+         * caller then parses the dump and decides with the local agent, as for other types.
+         */
+        OperatePtr getRemoteOperate(const char *dump, size_t size, const std::string &activity);
+
+        bool hasDecisionServer() const { return std::atomic_load(&this->_decisionClient) != nullptr; }
+
         virtual ~Model();
 
     protected:
@@ -219,39 +414,37 @@ namespace fastbotx {
          * @param element XML Element object of the current page
          * @return Custom action if exists, nullptr otherwise
          */
-        ActionPtr getCustomActionIfExists(const std::string &activity, const ElementPtr &element) const;
-        
-        /**
-         * @brief Get or create an activity string pointer (memory optimization)
-         * 
-         * Reuses existing activity string pointers from the graph to avoid duplication.
-         * 
-         * @param activity The activity name string
-         * @return Shared pointer to the activity string (cached or newly created)
-         */
-        stringPtr getOrCreateActivityPtr(const std::string &activity);
+        ActionPtr getCustomActionIfExists(InternedString activity, const ElementPtr &element, Rng &rng) const;
         
         /**
-         * @brief Get or create an agent for the given device ID
+         * @brief Get or create the shard (agent) for the given device ID
          * 
-         * Returns existing agent or default agent if device ID not found.
-         * Creates default agent if no agents exist.
+         * Returns the device's shard or the default one if device ID not found.
+         * Creates the default agent if no agents exist.
          * 
          * @param deviceID Device ID string (empty string uses default device ID)
-         * @return Shared pointer to the agent
+         * @return Shared pointer to the shard, or nullptr if there is no default agent
          */
-        AbstractAgentPtr getOrCreateAgent(const std::string &deviceID);
+        DeviceShardPtr getOrCreateShard(const std::string &deviceID);
+
+        /// Shard of deviceID or nullptr; caller holds _deviceShardsMutex
+        DeviceShardPtr findShard(const std::string &deviceID) const;
+
+        /// Activity mask without locking; caller holds _abstractionMutex
+        WidgetKeyMask findActivityKeyMask(InternedString activity) const;
         
         /**
          * @brief Create a new state from element and add it to the graph
          * 
          * @param element XML Element object of the current page
          * @param agent The agent to use for state creation
-         * @param activityPtr Shared pointer to activity name string
+         * @param activity Interned activity name
+         * @param shard The agent's shard: the state is built while its pending step finishes
+         * @param waitCostMs Output parameter: time spent waiting for the pending step in ms
          * @return Shared pointer to the created/existing state
          */
         StatePtr createAndAddState(const ElementPtr &element, const AbstractAgentPtr &agent, 
-                                   const stringPtr &activityPtr);
+                                   InternedString activity, DeviceShard &shard, double &waitCostMs);
         
         /**
          * @brief Select an action based on state, agent, and custom preferences
@@ -259,68 +452,160 @@ namespace fastbotx {
          * @param state The current state (may be modified)
          * @param agent The agent to use for action selection (may be modified)
          * @param customAction Custom action from preference, if any
+         * @param speculativeAction Action the agent selected ahead for this state, if the page
+         *                          arrived as predicted; used instead of asking the agent again
          * @param actionCost Output parameter: time cost for action generation in seconds
+         * @param agentStep Output parameter: true if the agent chose the action (or restarted),
+         *                  so finishStep updates it
          * @return Selected action, or nullptr if selection failed
          */
-        ActionPtr selectAction(StatePtr &state, AbstractAgentPtr &agent, ActionPtr customAction, double &actionCost);
+        ActionPtr selectAction(StatePtr &state, AbstractAgentPtr &agent, ActionPtr customAction,
+                               ActionPtr speculativeAction, double &actionCost, bool &agentStep);
         
         /**
          * @brief Convert an action to an operate object and apply patches
          * 
          * @param action The action to convert
-         * @param state The current state (used for detail clearing optimization)
          * @return OperatePtr The operation object ready for execution
          */
-        OperatePtr convertActionToOperate(ActionPtr action, StatePtr state);
+        OperatePtr convertActionToOperate(ActionPtr action, Rng &rng);
+
+        /**
+         * @brief Finish a step whose operation is known: none of this changes the operation
+         * 
+         * Updates the agent's strategy, marks the action visited and moves the agent on
+         * (if agentStep), drops the state's details and runs the state abstraction checks
+         * (if checkAbstraction). Runs on the StepExecutor when steps are pipelined; the
+         * device's next step builds its state meanwhile and waits for it before adding
+         * the state to the graph.
+         */
+        void finishStep(const AbstractAgentPtr &agent, const StatePtr &state, const ActionPtr &action,
+                        bool agentStep, bool checkAbstraction, DeviceShard &shard);
+
+#if FASTBOT_SPECULATIVE_STEPS
+        /**
+         * @brief Predict the device's next state and let the agent select its action ahead
+         * 
+         * Part of finishStep, after the agent moved on and before the state's details are
+         * dropped; only a predicted state that still has its details can be speculated on.
+         */
+        void speculateNextStep(const AbstractAgentPtr &agent, const StatePtr &state, const ActionPtr &action,
+                               DeviceShard &shard);
+
+        /// The speculated action if the page arrived as the predicted state; a miss is discarded
+        ActionPtr takeSpeculativeAction(const AbstractAgentPtr &agent, const StatePtr &state, DeviceShard &shard);
+
+        std::atomic<uint64_t> _speculationHits{0};
+        std::atomic<uint64_t> _speculationMisses{0};
+#endif
+
+        /// Wait for the rest of the shard's last step; caller holds its stepMutex
+        static void waitForPendingStep(DeviceShard &shard);
 
 #if DYNAMIC_STATE_ABSTRACTION_ENABLED
         /// Record one transition (source, action, target) for non-determinism detection
         void recordTransition(const AbstractAgentPtr &agent, const StatePtr &targetState);
         /// Record state under previous mask for APE coarsening (one L′ state → > β new states)
-        void recordStateSplitIfRefined(const std::string &activity, const StatePtr &state);
-        /// Run refinement/coarsening batch if step count reached interval
+        void recordStateSplitIfRefined(InternedString activity, const StatePtr &state);
+        /**
+         * @brief Queue a refinement/coarsening batch (every RefinementCheckInterval steps)
+         *
+         * Only plans: the coarsening checks, refinements and the merge of superseded
+         * states become AbstractionTasks, run a few per step by runAbstractionTasks so no
+         * single step pays for the whole batch. Caller holds _abstractionMutex.
+         */
         void runRefinementAndCoarseningIfScheduled();
+        /// Run up to AbstractionTasksPerStep queued tasks; caller holds _abstractionMutex, not the graph lock
+        void runAbstractionTasks();
+        /**
+         * @brief Merge the states a mask change superseded into their successors
+         *
+         * After a refinement each old state goes into a state it split into; after a
+         * coarsening the split states go back into their old state. Visits and action
+         * statistics move along (Graph::mergeState), so the graph keeps one abstraction
+         * per activity. Caller holds _abstractionMutex and the graph's write lock.
+         */
+        void mergeSupersededStates();
         /// Detect (source, action) pairs that lead to multiple different targets; return activity names to refine
-        std::vector<std::string> detectNonDeterminism() const;
+        std::vector<InternedString> detectNonDeterminism() const;
         /// Refine activity mask (add Text/ContentDesc/Index); return true if refined
-        bool refineActivity(const std::string &activity);
+        bool refineActivity(InternedString activity);
         /// Coarsen activity mask if state count exceeded threshold (after refinement)
-        void coarsenActivityIfNeeded(const std::string &activity);
+        void coarsenActivityIfNeeded(InternedString activity);
 #endif
+
+        /// Load the snapshot at path into the graph and the abstraction state; false if there is none
+        bool resumeSession(const std::string &path);
+
+        /**
+         * @brief Copy what a session snapshot holds; takes the abstraction mutex, then the graph read lock
+         *
+         * Packs only the states marked session-dirty, unless complete, and clears their marks.
+         */
+        void captureSession(SessionData &capture, bool complete) const;
+
+        /// Write a snapshot every max.sessionSnapshotSeconds until endSession or the model is gone
+        static void threadSessionSnapshot(const std::weak_ptr<Model> &model);
         
         /// Smart pointer to the graph object managing all states and actions
         GraphPtr _graph;
+
+        /// Finishes pipelined steps and runs steps submitted asynchronously
+        StepExecutorPtr _stepExecutor;
+
+        /// Per-stage step latencies, read through getPerfStatsNative
+        PerfStats _perfStats;
         
-        /// Map from device ID to agent object
+        /// Map from device ID to its shard (agent and step lock)
         /// Allows multiple devices to have different agents with different strategies
-        AbstractAgentPtrStrMap _deviceIDAgentMap;
+        std::unordered_map<std::string, DeviceShardPtr> _deviceShards;
+        mutable std::shared_timed_mutex _deviceShardsMutex;
         
         /// User-specified preferences for customizing behavior
         PreferencePtr _preference;
+        /// Page resolution and operate patching reuse Preference scratch buffers
+        mutable std::mutex _preferenceMutex;
+        /// max.leanOperate: operates carry no target widget descriptor (Operate.widget stays empty)
+        bool _leanOperate{false};
 
         /// Parameters for communicating with network-based action models
         NetActionParam _netActionParam;
 
         /// Coverage tracking: visited activities and step count (performance optimization)
         std::unordered_set<std::string> _visitedActivities;
+        /// _visitedActivities in the order first seen; its size is the coverage version
+        std::vector<std::string> _activityOrder;
         int _coverageStepCount{0};
         mutable std::mutex _coverageMutex;
 
         /// Per-activity widget key mask for dynamic state abstraction
-        mutable std::unordered_map<std::string, WidgetKeyMask> _activityKeyMask;
+        mutable std::unordered_map<InternedString, WidgetKeyMask> _activityKeyMask;
+        /// Guards _activityKeyMask and the refinement bookkeeping below
+        mutable std::mutex _abstractionMutex;
 
 #if DYNAMIC_STATE_ABSTRACTION_ENABLED
-        std::vector<TransitionEntry> _transitionLog;
-        size_t _transitionLogWriteIndex{0};
+        TransitionLog _transitionLog{MaxTransitionLogSize, MinNonDeterminismCount};
         size_t _stepCountSinceLastCheck{0};
-        std::unordered_map<std::string, ActivityAbstractionContext> _activityAbstractionContext;
-        std::set<std::pair<std::string, WidgetKeyMask>> _coarseningBlacklist;
+        std::unordered_map<InternedString, ActivityAbstractionContext> _activityAbstractionContext;
+        std::set<std::pair<InternedString, WidgetKeyMask>> _coarseningBlacklist;
+        /// Batch work left for the next steps (see runRefinementAndCoarseningIfScheduled)
+        std::deque<AbstractionTask> _abstractionTasks;
+        /// States waiting for mergeSupersededStates
+        std::vector<SupersededState> _supersededStates;
         /// Activities that need refinement due to α (max widgets per model action > α)
-        std::set<std::string> _activitiesNeedingAlphaRefinement;
+        std::set<InternedString, InternedStringNameLess> _activitiesNeedingAlphaRefinement;
         /// Last-seen state stats per activity for "skip Text" when text-heavy or unique-after-Text would explode
-        std::unordered_map<std::string, ActivityLastStateTextStats> _activityLastStateTextStats;
+        std::unordered_map<InternedString, ActivityLastStateTextStats> _activityLastStateTextStats;
 #endif
 
+        /// Snapshot of this session (startSession); writes and endSession hold _sessionMutex
+        SessionSnapshotPtr _sessionSnapshot;
+        ModelStorageSchedulerPtr _sessionScheduler;
+        std::mutex _sessionMutex;
+
+        /// Set by addAgent for AlgorithmType::Server; atomic_load / atomic_store only
+        DecisionClientPtr _decisionClient;
+
     };
 
     typedef std::shared_ptr<Model> ModelPtr;
@@ -0,0 +1,158 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef PerfStats_CPP_
+#define PerfStats_CPP_
+
+#include "PerfStats.h"
+#include "../thirdpart/json/json.hpp"
+#include <cmath>
+#include <memory>
+
+namespace fastbotx {
+
+    constexpr unsigned LatencyHistogram::SubBucketBits;
+    constexpr uint64_t LatencyHistogram::SubBucketCount;
+    constexpr uint64_t LatencyHistogram::MaxTrackableMicros;
+    constexpr size_t LatencyHistogram::BucketCount;
+
+    size_t LatencyHistogram::bucketOf(uint64_t micros) {
+        if (micros > MaxTrackableMicros) {
+            micros = MaxTrackableMicros;
+        }
+        if (micros < SubBucketCount) {
+            return static_cast<size_t>(micros);
+        }
+        unsigned highestBit = 63U - static_cast<unsigned>(__builtin_clzll(micros));
+        unsigned shift = highestBit - SubBucketBits;
+        // micros >> shift is in [SubBucketCount, 2 * SubBucketCount)
+        return static_cast<size_t>((shift + 1) * SubBucketCount + ((micros >> shift) - SubBucketCount));
+    }
+
+    uint64_t LatencyHistogram::valueOf(size_t bucket) {
+        if (bucket < SubBucketCount) {
+            return bucket;
+        }
+        uint64_t shift = bucket / SubBucketCount - 1;
+        uint64_t top = SubBucketCount + bucket % SubBucketCount;
+        return (top << shift) + ((1ULL << shift) >> 1);
+    }
+
+    void LatencyHistogram::record(uint64_t micros) {
+        this->_buckets[bucketOf(micros)].fetch_add(1, std::memory_order_relaxed);
+        this->_sumMicros.fetch_add(micros, std::memory_order_relaxed);
+        uint64_t max = this->_maxMicros.load(std::memory_order_relaxed);
+        while (micros > max &&
+               !this->_maxMicros.compare_exchange_weak(max, micros, std::memory_order_relaxed)) {
+        }
+    }
+
+    void LatencyHistogram::snapshot(Snapshot &out) const {
+        out.count = 0;
+        for (size_t i = 0; i < BucketCount; i++) {
+            out.buckets[i] = this->_buckets[i].load(std::memory_order_relaxed);
+            out.count += out.buckets[i];
+        }
+        out.sumMicros = this->_sumMicros.load(std::memory_order_relaxed);
+        out.maxMicros = this->_maxMicros.load(std::memory_order_relaxed);
+    }
+
+    void LatencyHistogram::reset() {
+        for (auto &bucket: this->_buckets) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        this->_sumMicros.store(0, std::memory_order_relaxed);
+        this->_maxMicros.store(0, std::memory_order_relaxed);
+    }
+
+    uint64_t LatencyHistogram::Snapshot::percentile(double percent) const {
+        if (this->count == 0) {
+            return 0;
+        }
+        auto rank = static_cast<uint64_t>(std::ceil(percent / 100.0 * static_cast<double>(this->count)));
+        rank = rank == 0 ? 1 : rank;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BucketCount; i++) {
+            seen += this->buckets[i];
+            if (seen >= rank) {
+                // A bucket's middle can exceed the largest value recorded in it
+                uint64_t value = valueOf(i);
+                return value < this->maxMicros ? value : this->maxMicros;
+            }
+        }
+        return this->maxMicros;
+    }
+
+    void PerfStats::record(PerfStage stage, std::chrono::steady_clock::duration elapsed) {
+        auto micros = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+        this->_stages[static_cast<size_t>(stage)].record(micros > 0 ? static_cast<uint64_t>(micros) : 0);
+    }
+
+    void PerfStats::recordMillis(PerfStage stage, double millis) {
+        this->_stages[static_cast<size_t>(stage)].record(millis > 0 ? static_cast<uint64_t>(millis * 1000.0) : 0);
+    }
+
+    const char *PerfStats::stageName(PerfStage stage) {
+        switch (stage) {
+            case PerfStage::Parse:
+                return "parse";
+            case PerfStage::PreferenceResolve:
+                return "preferenceResolve";
+            case PerfStage::StateBuild:
+                return "stateBuild";
+            case PerfStage::PendingStepWait:
+                return "pendingStepWait";
+            case PerfStage::GraphInsert:
+                return "graphInsert";
+            case PerfStage::ActionSelection:
+                return "actionSelection";
+            case PerfStage::OperateConversion:
+                return "operateConversion";
+            case PerfStage::StrategyUpdate:
+                return "strategyUpdate";
+            case PerfStage::SpeculativeSelection:
+                return "speculativeSelection";
+            case PerfStage::Total:
+                return "total";
+            default:
+                return "unknown";
+        }
+    }
+
+    std::string PerfStats::toJson() const {
+        nlohmann::json stages = nlohmann::json::object();
+        // Snapshots are large; one reused heap copy instead of one per stage on the stack
+        std::unique_ptr<LatencyHistogram::Snapshot> snapshot(new LatencyHistogram::Snapshot());
+        for (size_t i = 0; i < static_cast<size_t>(PerfStage::Count); i++) {
+            this->_stages[i].snapshot(*snapshot);
+            if (snapshot->count == 0) {
+                continue;
+            }
+            nlohmann::json stage;
+            stage["count"] = snapshot->count;
+            stage["mean"] = snapshot->sumMicros / snapshot->count;
+            stage["p50"] = snapshot->percentile(50);
+            stage["p90"] = snapshot->percentile(90);
+            stage["p99"] = snapshot->percentile(99);
+            stage["p999"] = snapshot->percentile(99.9);
+            stage["max"] = snapshot->maxMicros;
+            stages[stageName(static_cast<PerfStage>(i))] = stage;
+        }
+        nlohmann::json j;
+        j["unit"] = "us";
+        j["stages"] = stages;
+        return j.dump();
+    }
+
+    void PerfStats::reset() {
+        for (auto &stage: this->_stages) {
+            stage.reset();
+        }
+    }
+
+}
+
+#endif //PerfStats_CPP_
@@ -0,0 +1,148 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef PerfStats_H_
+#define PerfStats_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "../Trace.h"
+
+namespace fastbotx {
+
+    /// Stages of a getAction step timed by PerfStats
+    enum class PerfStage : uint8_t {
+        /// GUI tree dump (binary or XML) to Element tree
+        Parse = 0,
+        /// Preference::resolvePage and the user specified action lookup
+        PreferenceResolve,
+        /// State and widgets built from the Element tree
+        StateBuild,
+        /// Waiting for the device's previous step to finish (pipelined steps)
+        PendingStepWait,
+        /// State added to the graph and handed to the agent
+        GraphInsert,
+        /// Agent choosing the action
+        ActionSelection,
+        /// Action to DeviceOperateWrapper, preference patches included
+        OperateConversion,
+        /// Agent learning from the step (updateStrategy), off the critical path when pipelined
+        StrategyUpdate,
+        /// Agent choosing the action of the predicted next state ahead (FASTBOT_SPECULATIVE_STEPS)
+        SpeculativeSelection,
+        /// getOperateOpt from start to the returned operation
+        Total,
+        Count
+    };
+
+    /**
+     * @brief Latency histogram with log-linear buckets, recorded without locks
+     *
+     * HDR-style: values below 2^SubBucketBits microseconds get a bucket each; above,
+     * every power of two is split into 2^SubBucketBits buckets, so a reported
+     * percentile is within about 3% of the recorded value. Recording is a relaxed
+     * atomic increment of the bucket (plus the sum and a max update), so devices
+     * stepping concurrently record into the same histogram.
+     */
+    class LatencyHistogram {
+    public:
+        static constexpr unsigned SubBucketBits = 5;
+        static constexpr uint64_t SubBucketCount = 1ULL << SubBucketBits;
+        /// Larger values (about 19 hours) are counted as this one
+        static constexpr uint64_t MaxTrackableMicros = (1ULL << 36) - 1;
+        static constexpr size_t BucketCount = (36 - SubBucketBits + 1) * SubBucketCount;
+
+        void record(uint64_t micros);
+
+        /// Point-in-time copy; recording goes on meanwhile, so counts may lag by a few values
+        struct Snapshot {
+            uint64_t count{0};
+            uint64_t sumMicros{0};
+            uint64_t maxMicros{0};
+            uint64_t buckets[BucketCount]{};
+
+            /// Value at percentile (0-100], 0 when empty
+            uint64_t percentile(double percent) const;
+        };
+
+        void snapshot(Snapshot &out) const;
+
+        void reset();
+
+        static size_t bucketOf(uint64_t micros);
+
+        /// Middle of the values counted in bucket
+        static uint64_t valueOf(size_t bucket);
+
+    private:
+        std::atomic<uint64_t> _buckets[BucketCount]{};
+        std::atomic<uint64_t> _sumMicros{0};
+        std::atomic<uint64_t> _maxMicros{0};
+    };
+
+    /**
+     * @brief Latency histograms of the getAction stages, one per PerfStage
+     *
+     * Replaces scraping the per-step "build state cost" log lines for P50/P99: the
+     * histograms are always recorded and read through getPerfStatsNative.
+     */
+    class PerfStats {
+    public:
+        void record(PerfStage stage, std::chrono::steady_clock::duration elapsed);
+
+        /// Record a duration measured with currentStamp() (milliseconds)
+        void recordMillis(PerfStage stage, double millis);
+
+        /**
+         * @brief Compact JSON snapshot, microseconds:
+         * {"unit":"us","stages":{"parse":{"count":N,"mean":..,"p50":..,"p90":..,"p99":..,"p999":..,"max":..},..}}
+         *
+         * Stages not recorded yet are left out.
+         */
+        std::string toJson() const;
+
+        void reset();
+
+        static const char *stageName(PerfStage stage);
+
+    private:
+        LatencyHistogram _stages[static_cast<size_t>(PerfStage::Count)];
+    };
+
+    /// Records the time from its construction to its destruction under stage, and traces it as a span
+    class StageTimer {
+    public:
+        StageTimer(PerfStats &stats, PerfStage stage)
+                : _stats(stats), _stage(stage), _start(std::chrono::steady_clock::now())
+#if FASTBOT_TRACE_LEVEL >= FASTBOT_TRACE_STAGES
+                , _span(PerfStats::stageName(stage))
+#endif
+        {
+        }
+
+        ~StageTimer() {
+            this->_stats.record(this->_stage, std::chrono::steady_clock::now() - this->_start);
+        }
+
+        StageTimer(const StageTimer &) = delete;
+
+        StageTimer &operator=(const StageTimer &) = delete;
+
+    private:
+        PerfStats &_stats;
+        PerfStage _stage;
+        std::chrono::steady_clock::time_point _start;
+#if FASTBOT_TRACE_LEVEL >= FASTBOT_TRACE_STAGES
+        trace::Span _span;
+#endif
+    };
+
+}
+
+#endif //PerfStats_H_
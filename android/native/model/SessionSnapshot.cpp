@@ -0,0 +1,523 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef SessionSnapshot_CPP_
+#define SessionSnapshot_CPP_
+
+#include "SessionSnapshot.h"
+#include "../Base.h"
+#include "../utils.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fastbotx {
+
+    namespace {
+#ifdef __ANDROID__
+        constexpr const char *SessionStoragePrefix = "/sdcard/fastbot_";
+#else
+        constexpr const char *SessionStoragePrefix = "";
+#endif
+        constexpr const char *SessionFileExtension = ".session";
+
+        constexpr char SessionMagic[4] = {'F', 'B', 'S', 'S'};
+        constexpr uint32_t SessionFormatVersion = 1;
+        constexpr size_t SessionHeaderBytes = sizeof(SessionMagic) + sizeof(uint32_t);
+        /// Payload size and checksum before every record
+        constexpr size_t RecordHeaderBytes = sizeof(uint32_t) + sizeof(uint64_t);
+        /// File size below which write() never rewrites the file
+        constexpr size_t CompactionMinBytes = 256 * 1024;
+        /// Bytes of one transition ring entry
+        constexpr size_t TransitionBytes = 3 * sizeof(uint64_t) + sizeof(uint32_t);
+
+        /// First payload byte of a record
+        enum RecordType : uint8_t {
+            ActivityRecord = 1,
+            StateRecord = 2,
+            KeyMaskTable = 3,
+            BlacklistTable = 4,
+            ActivityVisitTable = 5,
+            TransitionRecords = 6
+        };
+
+        template<typename T>
+        void put(std::string &out, T value) {
+            out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+        }
+
+        void putRecord(std::string &out, const std::string &payload) {
+            put<uint32_t>(out, static_cast<uint32_t>(payload.size()));
+            put<uint64_t>(out, XXH3_64bits(payload.data(), payload.size()));
+            out += payload;
+        }
+
+        /// Bounds-checked reads from a record payload
+        struct PayloadReader {
+            const char *in;
+            const char *end;
+
+            template<typename T>
+            bool get(T &value) {
+                if (static_cast<size_t>(this->end - this->in) < sizeof(T)) {
+                    return false;
+                }
+                std::memcpy(&value, this->in, sizeof(T));
+                this->in += sizeof(T);
+                return true;
+            }
+
+            bool getBytes(std::string &value) {
+                uint32_t length = 0;
+                if (!get(length) || static_cast<size_t>(this->end - this->in) < length) {
+                    return false;
+                }
+                value.assign(this->in, length);
+                this->in += length;
+                return true;
+            }
+        };
+
+        void putKeyHashes(std::string &out, const WidgetKeyHashAggregate &hashes) {
+            put<uint64_t>(out, hashes.clazz);
+            put<uint64_t>(out, hashes.resourceID);
+            put<uint64_t>(out, hashes.operateMask);
+            put<uint64_t>(out, hashes.scrollType);
+            put<uint64_t>(out, hashes.text);
+            put<uint64_t>(out, hashes.contentDesc);
+            put<uint64_t>(out, hashes.index);
+            put<uint64_t>(out, hashes.defaultBase);
+            put<uint8_t>(out, hashes.odd ? 1 : 0);
+        }
+
+        bool getKeyHashes(PayloadReader &reader, WidgetKeyHashAggregate &hashes) {
+            uint64_t terms[8];
+            uint8_t odd = 0;
+            for (uint64_t &term: terms) {
+                if (!reader.get(term)) {
+                    return false;
+                }
+            }
+            if (!reader.get(odd)) {
+                return false;
+            }
+            hashes.clazz = static_cast<uintptr_t>(terms[0]);
+            hashes.resourceID = static_cast<uintptr_t>(terms[1]);
+            hashes.operateMask = static_cast<uintptr_t>(terms[2]);
+            hashes.scrollType = static_cast<uintptr_t>(terms[3]);
+            hashes.text = static_cast<uintptr_t>(terms[4]);
+            hashes.contentDesc = static_cast<uintptr_t>(terms[5]);
+            hashes.index = static_cast<uintptr_t>(terms[6]);
+            hashes.defaultBase = static_cast<uintptr_t>(terms[7]);
+            hashes.odd = odd != 0;
+            return true;
+        }
+
+        /// Read one record's payload into data; false if it does not parse
+        bool readRecord(PayloadReader reader, std::unordered_map<uint32_t, InternedString> &activities,
+                        std::unordered_map<uint64_t, size_t> &stateIndex, SessionData &data) {
+            uint8_t type = 0;
+            if (!reader.get(type)) {
+                return false;
+            }
+            auto activityOf = [&activities](uint32_t id, InternedString &activity) {
+                auto found = activities.find(id);
+                if (found == activities.end()) {
+                    return false;
+                }
+                activity = found->second;
+                return true;
+            };
+            switch (type) {
+                case ActivityRecord: {
+                    uint32_t id = 0;
+                    std::string name;
+                    if (!reader.get(id) || !reader.getBytes(name)) {
+                        return false;
+                    }
+                    activities[id] = InternedString::intern(name);
+                    return true;
+                }
+                case StateRecord: {
+                    uint32_t activityId = 0;
+                    uint64_t hash = 0;
+                    int32_t visitedCount = 0;
+                    uint32_t mask = 0;
+                    uint64_t activityKeyHash = 0;
+                    InternedString activity;
+                    ColdStateRecord state;
+                    if (!reader.get(activityId) || !reader.get(hash) || !reader.get(visitedCount) ||
+                        !reader.get(mask) || !reader.get(activityKeyHash) ||
+                        !getKeyHashes(reader, state.widgetKeyHashes) || !reader.getBytes(state.actions) ||
+                        !activityOf(activityId, activity)) {
+                        return false;
+                    }
+                    state.hash = static_cast<uintptr_t>(hash);
+                    state.visitedCount = visitedCount;
+                    state.mask = static_cast<WidgetKeyMask>(mask);
+                    state.activityKeyHash = static_cast<uintptr_t>(activityKeyHash);
+                    auto known = stateIndex.find(hash);
+                    if (known != stateIndex.end()) {
+                        data.states[known->second] = std::make_pair(activity, std::move(state));
+                    } else {
+                        stateIndex.emplace(hash, data.states.size());
+                        data.states.emplace_back(activity, std::move(state));
+                    }
+                    return true;
+                }
+                case KeyMaskTable:
+                case BlacklistTable: {
+                    uint32_t count = 0;
+                    if (!reader.get(count)) {
+                        return false;
+                    }
+                    std::vector<std::pair<InternedString, WidgetKeyMask>> table;
+                    for (uint32_t i = 0; i < count; i++) {
+                        uint32_t activityId = 0;
+                        uint32_t mask = 0;
+                        InternedString activity;
+                        if (!reader.get(activityId) || !reader.get(mask) || !activityOf(activityId, activity)) {
+                            return false;
+                        }
+                        table.emplace_back(activity, static_cast<WidgetKeyMask>(mask));
+                    }
+                    (type == KeyMaskTable ? data.activityKeyMasks : data.coarseningBlacklist).swap(table);
+                    return true;
+                }
+                case ActivityVisitTable: {
+                    uint32_t count = 0;
+                    if (!reader.get(count)) {
+                        return false;
+                    }
+                    std::vector<std::pair<InternedString, long>> table;
+                    for (uint32_t i = 0; i < count; i++) {
+                        uint32_t activityId = 0;
+                        int64_t visits = 0;
+                        InternedString activity;
+                        if (!reader.get(activityId) || !reader.get(visits) || !activityOf(activityId, activity)) {
+                            return false;
+                        }
+                        table.emplace_back(activity, static_cast<long>(visits));
+                    }
+                    data.activityVisits.swap(table);
+                    return true;
+                }
+                case TransitionRecords: {
+                    uint32_t count = 0;
+                    if (!reader.get(count)) {
+                        return false;
+                    }
+                    for (uint32_t i = 0; i < count; i++) {
+                        SessionData::Transition transition{};
+                        uint32_t activityId = 0;
+                        if (!reader.get(transition.source) || !reader.get(transition.action) ||
+                            !reader.get(transition.target) || !reader.get(activityId) ||
+                            !activityOf(activityId, transition.activity)) {
+                            return false;
+                        }
+                        data.transitions.push_back(transition);
+                    }
+                    return true;
+                }
+                default:
+                    return false;
+            }
+        }
+    }
+
+    SessionSnapshot::SessionSnapshot(std::string path)
+            : _path(std::move(path)) {
+    }
+
+    std::string SessionSnapshot::pathOf(const std::string &packageName) {
+        return std::string(SessionStoragePrefix) + packageName + SessionFileExtension;
+    }
+
+    bool SessionSnapshot::load(const std::string &path, SessionData &data) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat fileStat{};
+        if (fstat(fd, &fileStat) != 0 || static_cast<size_t>(fileStat.st_size) <= SessionHeaderBytes) {
+            close(fd);
+            return false;
+        }
+        auto size = static_cast<size_t>(fileStat.st_size);
+        void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapped == MAP_FAILED) {
+            BLOGE("session: mmap failed for %s", path.c_str());
+            return false;
+        }
+        const char *begin = static_cast<const char *>(mapped);
+        const char *end = begin + size;
+        uint32_t version = 0;
+        std::memcpy(&version, begin + sizeof(SessionMagic), sizeof(version));
+        if (std::memcmp(begin, SessionMagic, sizeof(SessionMagic)) != 0 || version != SessionFormatVersion) {
+            BLOGE("session: %s is not a session snapshot of this version", path.c_str());
+            munmap(mapped, size);
+            return false;
+        }
+
+        std::unordered_map<uint32_t, InternedString> activities;
+        std::unordered_map<uint64_t, size_t> stateIndex;
+        size_t records = 0;
+        const char *in = begin + SessionHeaderBytes;
+        while (static_cast<size_t>(end - in) >= RecordHeaderBytes) {
+            uint32_t payloadSize = 0;
+            uint64_t checksum = 0;
+            std::memcpy(&payloadSize, in, sizeof(payloadSize));
+            std::memcpy(&checksum, in + sizeof(payloadSize), sizeof(checksum));
+            const char *payload = in + RecordHeaderBytes;
+            if (payloadSize > static_cast<size_t>(end - payload) ||
+                XXH3_64bits(payload, payloadSize) != checksum ||
+                !readRecord(PayloadReader{payload, payload + payloadSize}, activities, stateIndex, data)) {
+                break;
+            }
+            in = payload + payloadSize;
+            records++;
+        }
+        if (in != end) {
+            BLOGE("session: %s has a torn tail at %zu of %zu bytes", path.c_str(),
+                  static_cast<size_t>(in - begin), size);
+        }
+        munmap(mapped, size);
+        return records > 0;
+    }
+
+    uint32_t SessionSnapshot::activityId(InternedString activity, std::string &out) {
+        auto known = this->_activityIds.find(activity);
+        if (known != this->_activityIds.end()) {
+            return known->second;
+        }
+        auto id = static_cast<uint32_t>(this->_activityIds.size());
+        this->_activityIds.emplace(activity, id);
+        std::string payload;
+        put<uint8_t>(payload, ActivityRecord);
+        put<uint32_t>(payload, id);
+        const std::string &name = activity.str();
+        put<uint32_t>(payload, static_cast<uint32_t>(name.size()));
+        payload += name;
+        putRecord(out, payload);
+        this->_activityBytes += RecordHeaderBytes + payload.size();
+        return id;
+    }
+
+    size_t SessionSnapshot::encode(const SessionData &capture, std::string &out) {
+        size_t liveBytes = 0;
+        std::string payload;
+        // A record is kept when it differs from the last one written for the same state or table
+        auto putIfChanged = [&out, &payload, &liveBytes](WrittenRecord &written) {
+            uint64_t digest = XXH3_64bits(payload.data(), payload.size());
+            if (written.bytes == 0 || written.digest != digest) {
+                written.digest = digest;
+                written.bytes = RecordHeaderBytes + payload.size();
+                putRecord(out, payload);
+            }
+            liveBytes += written.bytes;
+        };
+
+        // A complete capture drops the states the graph no longer has
+        std::unordered_map<uint64_t, WrittenRecord> previousStates;
+        if (capture.complete) {
+            previousStates.swap(this->_states);
+            this->_stateBytes = 0;
+        }
+        for (const auto &entry: capture.states) {
+            const ColdStateRecord &state = entry.second;
+            uint32_t activity = activityId(entry.first, out);
+            payload.clear();
+            put<uint8_t>(payload, StateRecord);
+            put<uint32_t>(payload, activity);
+            put<uint64_t>(payload, state.hash);
+            put<int32_t>(payload, state.visitedCount);
+            put<uint32_t>(payload, state.mask);
+            put<uint64_t>(payload, state.activityKeyHash);
+            putKeyHashes(payload, state.widgetKeyHashes);
+            put<uint32_t>(payload, static_cast<uint32_t>(state.actions.size()));
+            payload += state.actions;
+            WrittenRecord &written = this->_states[state.hash];
+            if (capture.complete) {
+                auto previous = previousStates.find(state.hash);
+                if (previous != previousStates.end()) {
+                    written = previous->second;
+                }
+            } else {
+                this->_stateBytes -= written.bytes;
+            }
+            size_t bytesBefore = liveBytes;
+            putIfChanged(written);
+            this->_stateBytes += liveBytes - bytesBefore;
+        }
+        liveBytes = this->_stateBytes;
+
+        const std::vector<std::pair<InternedString, WidgetKeyMask>> *maskTables[2] = {
+                &capture.activityKeyMasks, &capture.coarseningBlacklist};
+        for (int table = 0; table < 2; table++) {
+            std::vector<uint32_t> ids;
+            for (const auto &mask: *maskTables[table]) {
+                ids.push_back(activityId(mask.first, out));
+            }
+            payload.clear();
+            put<uint8_t>(payload, table == 0 ? KeyMaskTable : BlacklistTable);
+            put<uint32_t>(payload, static_cast<uint32_t>(ids.size()));
+            for (size_t i = 0; i < ids.size(); i++) {
+                put<uint32_t>(payload, ids[i]);
+                put<uint32_t>(payload, (*maskTables[table])[i].second);
+            }
+            putIfChanged(this->_tables[table]);
+        }
+        {
+            std::vector<uint32_t> ids;
+            for (const auto &visits: capture.activityVisits) {
+                ids.push_back(activityId(visits.first, out));
+            }
+            payload.clear();
+            put<uint8_t>(payload, ActivityVisitTable);
+            put<uint32_t>(payload, static_cast<uint32_t>(ids.size()));
+            for (size_t i = 0; i < ids.size(); i++) {
+                put<uint32_t>(payload, ids[i]);
+                put<int64_t>(payload, capture.activityVisits[i].second);
+            }
+            putIfChanged(this->_tables[2]);
+        }
+
+        // Ring entries recorded since the last write; older ones are in the file already
+        uint64_t firstRecorded = capture.transitionsRecorded - capture.transitions.size();
+        size_t skip = this->_transitionsWritten > firstRecorded
+                      ? static_cast<size_t>(std::min<uint64_t>(this->_transitionsWritten - firstRecorded,
+                                                               capture.transitions.size()))
+                      : 0;
+        if (skip < capture.transitions.size()) {
+            std::vector<uint32_t> ids;
+            for (size_t i = skip; i < capture.transitions.size(); i++) {
+                ids.push_back(activityId(capture.transitions[i].activity, out));
+            }
+            payload.clear();
+            put<uint8_t>(payload, TransitionRecords);
+            put<uint32_t>(payload, static_cast<uint32_t>(ids.size()));
+            for (size_t i = skip; i < capture.transitions.size(); i++) {
+                const SessionData::Transition &transition = capture.transitions[i];
+                put<uint64_t>(payload, transition.source);
+                put<uint64_t>(payload, transition.action);
+                put<uint64_t>(payload, transition.target);
+                put<uint32_t>(payload, ids[i - skip]);
+            }
+            putRecord(out, payload);
+            this->_transitionBytes += RecordHeaderBytes + payload.size();
+        }
+        this->_transitionsWritten = capture.transitionsRecorded;
+        // Entries pushed out of the ring are stale
+        liveBytes += std::min(this->_transitionBytes, RecordHeaderBytes + 5 + capture.transitions.size() * TransitionBytes);
+        return liveBytes + this->_activityBytes;
+    }
+
+    bool SessionSnapshot::write(const SessionData &capture) {
+        std::string records;
+        bool written;
+        if (!capture.complete && needsCompleteCapture()) {
+            BLOGE("session: %s needs a complete capture", this->_path.c_str());
+            return false;
+        }
+        if (!this->_inSync) {
+            reset();
+            encode(capture, records);
+            written = rewrite(records);
+        } else {
+            size_t liveBytes = encode(capture, records);
+            size_t fileBytes = this->_fileBytes + records.size();
+            bool compact = this->_compactionDue || (fileBytes > CompactionMinBytes && fileBytes > 2 * liveBytes);
+            if (records.empty() && !compact) {
+                return true;
+            }
+            if (compact && !capture.complete) {
+                // Only the changed states are at hand: append, and rewrite from the next capture
+                this->_compactionDue = true;
+                written = append(records);
+            } else if (compact) {
+                reset();
+                records.clear();
+                encode(capture, records);
+                written = rewrite(records);
+            } else {
+                written = append(records);
+            }
+        }
+        if (!written) {
+            BLOGE("session: cannot write %s", this->_path.c_str());
+            reset();
+        }
+        return written;
+    }
+
+    bool SessionSnapshot::rewrite(const std::string &records) {
+        std::string tempPath = this->_path + ".tmp";
+        int fd = ::open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            return false;
+        }
+        std::string header(SessionMagic, sizeof(SessionMagic));
+        put<uint32_t>(header, SessionFormatVersion);
+        bool written = ::write(fd, header.data(), header.size()) == static_cast<ssize_t>(header.size()) &&
+                       ::write(fd, records.data(), records.size()) == static_cast<ssize_t>(records.size()) &&
+                       0 == fsync(fd);
+        close(fd);
+        if (!written || std::rename(tempPath.c_str(), this->_path.c_str()) != 0) {
+            std::remove(tempPath.c_str());
+            return false;
+        }
+        this->_fileBytes = header.size() + records.size();
+        this->_inSync = true;
+        BLOG("session: wrote %s (%zu bytes)", this->_path.c_str(), this->_fileBytes);
+        return true;
+    }
+
+    bool SessionSnapshot::append(const std::string &records) {
+        int fd = ::open(this->_path.c_str(), O_WRONLY | O_APPEND);
+        if (fd < 0) {
+            return false;
+        }
+        // One write; a crash mid-write leaves a tail that load() stops at
+        bool written = ::write(fd, records.data(), records.size()) == static_cast<ssize_t>(records.size()) &&
+                       0 == fsync(fd);
+        close(fd);
+        if (!written) {
+            return false;
+        }
+        this->_fileBytes += records.size();
+        BDLOG("session: appended %zu bytes to %s (%zu bytes)", records.size(), this->_path.c_str(),
+              this->_fileBytes);
+        return true;
+    }
+
+    void SessionSnapshot::reset() {
+        this->_inSync = false;
+        this->_fileBytes = 0;
+        this->_activityIds.clear();
+        this->_activityBytes = 0;
+        this->_states.clear();
+        this->_stateBytes = 0;
+        this->_compactionDue = false;
+        for (WrittenRecord &table: this->_tables) {
+            table = WrittenRecord{};
+        }
+        this->_transitionsWritten = 0;
+        this->_transitionBytes = 0;
+    }
+
+    void SessionSnapshot::remove() {
+        reset();
+        std::remove(this->_path.c_str());
+    }
+
+}
+
+#endif //SessionSnapshot_CPP_
@@ -0,0 +1,143 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef SessionSnapshot_H_
+#define SessionSnapshot_H_
+
+#include "State.h"
+#include "../StringInterner.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace fastbotx {
+
+    /// What a session snapshot holds: Model captures one per write and gets one back on resume
+    struct SessionData {
+        struct Transition {
+            uint64_t source;
+            uint64_t action;
+            uint64_t target;
+            InternedString activity;
+        };
+
+        /// Graph states as cold storage keeps them, with their activity
+        std::vector<std::pair<InternedString, ColdStateRecord>> states;
+        /// states holds every graph state; otherwise only those changed since the previous capture
+        bool complete{true};
+        /// Widget key mask of each activity whose mask was changed
+        std::vector<std::pair<InternedString, WidgetKeyMask>> activityKeyMasks;
+        /// (activity, mask) refinements that coarsening rolled back
+        std::vector<std::pair<InternedString, WidgetKeyMask>> coarseningBlacklist;
+        /// Graph::addState calls per activity
+        std::vector<std::pair<InternedString, long>> activityVisits;
+        /// Transition ring, oldest first
+        std::vector<Transition> transitions;
+        /// TransitionLog::recorded() after the last entry of transitions (captures only)
+        uint64_t transitionsRecorded{0};
+    };
+
+    /**
+     * @brief Crash-safe file of a session's graph, abstraction masks and transition ring
+     *
+     * The file is a header and checksummed records; a later record of a state or table
+     * supersedes the earlier ones. write() appends only the states and tables that changed
+     * since the last write, and the ring entries recorded since, then rewrites the whole
+     * file (temp file and rename) once stale records outweigh the live ones. Rewriting takes
+     * a complete capture: until the first write, or once a write found the file due for
+     * compaction, needsCompleteCapture() asks for one; other captures may hold just the
+     * changed states. States gone from the graph leave the file at a rewrite. A crash thus
+     * leaves at most a torn last record, where load() stops. load() maps the file and reads
+     * it in one pass.
+     *
+     * Q-values are not in it: the reuse model and its journal keep them. Records are in
+     * native byte order, as the file is only read on the device that wrote it.
+     * Not thread-safe: Model writes it from its session thread under its session mutex.
+     */
+    class SessionSnapshot {
+    public:
+        explicit SessionSnapshot(std::string path);
+
+        /// Snapshot file of a package's session
+        static std::string pathOf(const std::string &packageName);
+
+        /**
+         * @brief Read a snapshot
+         * @return false if the file is missing or holds no valid record
+         */
+        static bool load(const std::string &path, SessionData &data);
+
+        /**
+         * @brief Save what changed in capture since the last write
+         *
+         * The first write of a SessionSnapshot rewrites the file.
+         * @return false if the file could not be written (the next write rewrites it)
+         */
+        bool write(const SessionData &capture);
+
+        /// Whether the next capture must hold every state (see the class comment)
+        bool needsCompleteCapture() const { return !this->_inSync || this->_compactionDue; }
+
+        /// Delete the file: the session ended cleanly and is not to be resumed
+        void remove();
+
+        const std::string &path() const { return this->_path; }
+
+        size_t fileBytes() const { return this->_fileBytes; }
+
+    private:
+        /**
+         * @brief Append the records of capture that differ from the file to out
+         * @return Bytes of the file's records still current once out is written
+         */
+        size_t encode(const SessionData &capture, std::string &out);
+
+        /// Id of activity in the file, appending its record to out if it has none yet
+        uint32_t activityId(InternedString activity, std::string &out);
+
+        /// Write header and records to a temp file renamed over the file
+        bool rewrite(const std::string &records);
+
+        bool append(const std::string &records);
+
+        /// Forget what the file holds, so the next encode is full
+        void reset();
+
+        std::string _path;
+        /// The file holds what the members below describe
+        bool _inSync{false};
+        size_t _fileBytes{0};
+
+        /// Activities with a record in the file
+        std::unordered_map<InternedString, uint32_t> _activityIds;
+        size_t _activityBytes{0};
+
+        struct WrittenRecord {
+            uint64_t digest;
+            size_t bytes;
+        };
+        /// Last record of each state in the file, by state hash, and their bytes
+        std::unordered_map<uint64_t, WrittenRecord> _states;
+        size_t _stateBytes{0};
+        /// Stale records outweigh the live ones: rewrite at the next complete capture
+        bool _compactionDue{false};
+        /// Last record of each table (key masks, blacklist, activity visits)
+        WrittenRecord _tables[3]{};
+
+        /// TransitionLog::recorded() covered by the file, and ring entries in it
+        uint64_t _transitionsWritten{0};
+        size_t _transitionBytes{0};
+    };
+
+    typedef std::shared_ptr<SessionSnapshot> SessionSnapshotPtr;
+
+}
+
+#endif //SessionSnapshot_H_
@@ -0,0 +1,98 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef StepExecutor_CPP_
+#define StepExecutor_CPP_
+
+#include "StepExecutor.h"
+#include "../utils.hpp"
+
+namespace fastbotx {
+
+    bool StepTask::tryRun() {
+        if (this->_claimed.exchange(true, std::memory_order_acq_rel)) {
+            return false;
+        }
+        this->_work();
+        this->_work = nullptr;  // Release what the work captured as soon as it ran
+        std::lock_guard<std::mutex> guard(this->_mutex);
+        this->_done = true;
+        this->_finished.notify_all();
+        return true;
+    }
+
+    void StepTask::wait() {
+        if (this->tryRun()) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(this->_mutex);
+        this->_finished.wait(lock, [this] { return this->_done; });
+    }
+
+    bool StepTask::waitFor(std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock(this->_mutex);
+        return this->_finished.wait_for(lock, timeout, [this] { return this->_done; });
+    }
+
+    bool StepTask::done() const {
+        std::lock_guard<std::mutex> guard(this->_mutex);
+        return this->_done;
+    }
+
+    StepExecutor::StepExecutor(size_t threadCount) {
+        if (threadCount == 0) {
+            threadCount = 1;
+        }
+        this->_workers.reserve(threadCount);
+        for (size_t i = 0; i < threadCount; i++) {
+            this->_workers.emplace_back(&StepExecutor::workerLoop, this);
+        }
+        BLOG("step executor: started %zu worker threads", threadCount);
+    }
+
+    StepExecutor::~StepExecutor() {
+        {
+            std::lock_guard<std::mutex> guard(this->_mutex);
+            this->_stopping = true;
+        }
+        this->_wakeup.notify_all();
+        for (std::thread &worker: this->_workers) {
+            if (worker.joinable()) {
+                worker.join();
+            }
+        }
+    }
+
+    StepTaskPtr StepExecutor::submit(std::function<void()> work) {
+        StepTaskPtr task = std::make_shared<StepTask>(std::move(work));
+        {
+            std::lock_guard<std::mutex> guard(this->_mutex);
+            this->_queue.push_back(task);
+        }
+        this->_wakeup.notify_one();
+        return task;
+    }
+
+    void StepExecutor::workerLoop() {
+        while (true) {
+            StepTaskPtr task;
+            {
+                std::unique_lock<std::mutex> lock(this->_mutex);
+                this->_wakeup.wait(lock, [this] { return this->_stopping || !this->_queue.empty(); });
+                if (this->_queue.empty()) {
+                    return;  // Stopping and drained
+                }
+                task = std::move(this->_queue.front());
+                this->_queue.pop_front();
+            }
+            // A task already run by a thread waiting on it is skipped here
+            task->tryRun();
+        }
+    }
+
+}
+
+#endif //StepExecutor_CPP_
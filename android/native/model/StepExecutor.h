@@ -0,0 +1,94 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef StepExecutor_H_
+#define StepExecutor_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fastbotx {
+
+    /**
+     * @brief Work queued on a StepExecutor, run exactly once
+     *
+     * Whoever needs the result first runs it: a worker picking it up, or a thread
+     * calling wait() before any worker did. So waiting on a task never depends on a
+     * free worker, and a task may wait on another from inside a worker.
+     */
+    class StepTask {
+    public:
+        explicit StepTask(std::function<void()> work) : _work(std::move(work)) {
+        }
+
+        /// Run the work unless another thread already claimed it; true if this call ran it
+        bool tryRun();
+
+        /// Return once the work is done, running it here if nobody started it yet
+        void wait();
+
+        /// Wait up to timeout for a worker to finish the work (never runs it here); true if done
+        bool waitFor(std::chrono::milliseconds timeout);
+
+        bool done() const;
+
+    private:
+        std::function<void()> _work;
+        std::atomic<bool> _claimed{false};
+        mutable std::mutex _mutex;
+        std::condition_variable _finished;
+        bool _done{false};
+    };
+
+    typedef std::shared_ptr<StepTask> StepTaskPtr;
+
+    /**
+     * @brief Small pool of worker threads running the work of steps off the caller's thread
+     *
+     * Used for what a step leaves after its operation is known (the agent's strategy
+     * update, visit counts, state abstraction checks) and for steps submitted
+     * asynchronously through JNI. Tasks run in submission order as workers free up;
+     * ordering between tasks is up to their owners (see StepTask::wait).
+     */
+    class StepExecutor {
+    public:
+        explicit StepExecutor(size_t threadCount);
+
+        /// Runs the tasks still queued, then joins the workers (so never from one of its tasks)
+        ~StepExecutor();
+
+        StepExecutor(const StepExecutor &) = delete;
+
+        StepExecutor &operator=(const StepExecutor &) = delete;
+
+        /// Queue work for a worker; the returned task can be waited on
+        StepTaskPtr submit(std::function<void()> work);
+
+        size_t threadCount() const { return this->_workers.size(); }
+
+    private:
+        void workerLoop();
+
+        std::vector<std::thread> _workers;
+        std::deque<StepTaskPtr> _queue;
+        std::mutex _mutex;
+        std::condition_variable _wakeup;
+        bool _stopping{false};
+    };
+
+    typedef std::shared_ptr<StepExecutor> StepExecutorPtr;
+
+}
+
+#endif //StepExecutor_H_
@@ -0,0 +1,77 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef SuccessorPredictor_CPP_
+#define SuccessorPredictor_CPP_
+
+#include "SuccessorPredictor.h"
+#include "MemoryFootprint.h"
+
+namespace fastbotx {
+
+    SuccessorPredictor::SuccessorPredictor(size_t maxPairs)
+            : _maxPairs(maxPairs) {
+    }
+
+    void SuccessorPredictor::record(uintptr_t sourceStateHash, uintptr_t actionHash, uintptr_t targetStateHash,
+                                    InternedString targetActivity) {
+        PairKey key{sourceStateHash, actionHash};
+        if (this->_pairs.size() >= this->_maxPairs && this->_pairs.find(key) == this->_pairs.end()) {
+            this->_pairs.clear();
+        }
+        PairTargets &pair = this->_pairs[key];
+        this->_records++;
+        Target *slot = nullptr;
+        for (Target &target: pair.targets) {
+            if (target.count > 0 && target.state == targetStateHash) {
+                slot = &target;
+                break;
+            }
+        }
+        if (nullptr == slot) {
+            // A new target replaces the least frequent one (the oldest on a tie)
+            slot = &pair.targets[0];
+            for (Target &target: pair.targets) {
+                if (target.count < slot->count || (target.count == slot->count && target.lastSeen < slot->lastSeen)) {
+                    slot = &target;
+                }
+            }
+            *slot = Target();
+            slot->state = targetStateHash;
+            slot->activity = targetActivity;
+        }
+        slot->count++;
+        slot->lastSeen = this->_records;
+    }
+
+    bool SuccessorPredictor::predict(uintptr_t sourceStateHash, uintptr_t actionHash, uintptr_t &targetStateHash,
+                                     InternedString &targetActivity) const {
+        auto pairIt = this->_pairs.find(PairKey{sourceStateHash, actionHash});
+        if (pairIt == this->_pairs.end()) {
+            return false;
+        }
+        const Target *best = nullptr;
+        for (const Target &target: pairIt->second.targets) {
+            if (target.count > 0 && (nullptr == best || target.count > best->count ||
+                                     (target.count == best->count && target.lastSeen > best->lastSeen))) {
+                best = &target;
+            }
+        }
+        if (nullptr == best) {
+            return false;
+        }
+        targetStateHash = best->state;
+        targetActivity = best->activity;
+        return true;
+    }
+
+    size_t SuccessorPredictor::heapBytes() const {
+        return MemoryFootprint::bytesOf(this->_pairs);
+    }
+
+}
+
+#endif //SuccessorPredictor_CPP_
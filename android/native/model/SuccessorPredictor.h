@@ -0,0 +1,84 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef SuccessorPredictor_H_
+#define SuccessorPredictor_H_
+
+#include "../StringInterner.h"
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+namespace fastbotx {
+
+    /**
+     * @brief Successor states seen after each (state, action), to predict the next page
+     *
+     * Keeps the few most frequent target states of every pair with how often each was
+     * reached; predict() answers the most frequent one, the latest on a tie. Used by
+     * speculative steps (FASTBOT_SPECULATIVE_STEPS) to select the next action ahead.
+     *
+     * Bounded: once maxPairs pairs are known, the counts start over.
+     * Not thread-safe: each device shard owns one and uses it from its own steps.
+     */
+    class SuccessorPredictor {
+    public:
+        /// Target states kept per pair
+        static constexpr size_t TargetsPerPair = 4;
+
+        explicit SuccessorPredictor(size_t maxPairs = 1 << 16);
+
+        void record(uintptr_t sourceStateHash, uintptr_t actionHash, uintptr_t targetStateHash,
+                    InternedString targetActivity);
+
+        /**
+         * @brief Most likely target of (source, action)
+         * @return false if the pair was never seen
+         */
+        bool predict(uintptr_t sourceStateHash, uintptr_t actionHash, uintptr_t &targetStateHash,
+                     InternedString &targetActivity) const;
+
+        size_t size() const { return this->_pairs.size(); }
+
+        /// Heap bytes of the pair table
+        size_t heapBytes() const;
+
+    private:
+        struct PairKey {
+            uintptr_t source;
+            uintptr_t action;
+
+            bool operator==(const PairKey &other) const {
+                return this->source == other.source && this->action == other.action;
+            }
+        };
+
+        struct PairKeyHash {
+            size_t operator()(const PairKey &key) const {
+                return static_cast<size_t>(key.source ^ (key.action * 0x9e3779b97f4a7c15ULL));
+            }
+        };
+
+        struct Target {
+            uintptr_t state{0};
+            InternedString activity;
+            uint32_t count{0};
+            /// record() call that last reached it, breaks ties
+            uint64_t lastSeen{0};
+        };
+
+        struct PairTargets {
+            Target targets[TargetsPerPair];
+        };
+
+        size_t _maxPairs;
+        uint64_t _records{0};
+        std::unordered_map<PairKey, PairTargets, PairKeyHash> _pairs;
+    };
+
+}
+
+#endif //SuccessorPredictor_H_
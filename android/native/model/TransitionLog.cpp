@@ -0,0 +1,101 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef TransitionLog_CPP_
+#define TransitionLog_CPP_
+
+#include "TransitionLog.h"
+#include "MemoryFootprint.h"
+#include <set>
+
+namespace fastbotx {
+
+    TransitionLog::TransitionLog(size_t capacity, size_t minTargets)
+            : _sources(capacity, 0), _actions(capacity, 0), _targets(capacity, 0),
+              _activities(capacity), _minTargets(minTargets) {
+    }
+
+    void TransitionLog::record(uintptr_t sourceStateHash, uintptr_t actionHash, uintptr_t targetStateHash,
+                               InternedString sourceActivity) {
+        if (this->_sources.empty()) {
+            return;
+        }
+        size_t slot = this->_next;
+        if (this->_count == this->_sources.size()) {
+            remove(slot);
+        } else {
+            this->_count++;
+        }
+        this->_sources[slot] = sourceStateHash;
+        this->_actions[slot] = actionHash;
+        this->_targets[slot] = targetStateHash;
+        this->_activities[slot] = sourceActivity;
+        add(slot);
+        this->_next = (slot + 1) % this->_sources.size();
+        this->_recorded++;
+    }
+
+    void TransitionLog::add(size_t slot) {
+        if (this->_sources[slot] == this->_targets[slot]) {
+            return;
+        }
+        auto inserted = this->_pairs.emplace(PairKey{this->_sources[slot], this->_actions[slot]}, PairTargets());
+        PairTargets &pair = inserted.first->second;
+        if (inserted.second) {
+            // The source state's hash includes its activity, so every entry of a pair agrees
+            pair.activity = this->_activities[slot];
+        }
+        if (1 == ++pair.targets[this->_targets[slot]] && pair.targets.size() == this->_minTargets) {
+            this->_nonDeterministicPairs[pair.activity]++;
+        }
+    }
+
+    void TransitionLog::remove(size_t slot) {
+        if (this->_sources[slot] == this->_targets[slot]) {
+            return;
+        }
+        auto pairIt = this->_pairs.find(PairKey{this->_sources[slot], this->_actions[slot]});
+        if (pairIt == this->_pairs.end()) {
+            return;
+        }
+        PairTargets &pair = pairIt->second;
+        auto target = pair.targets.find(this->_targets[slot]);
+        if (target == pair.targets.end() || --target->second > 0) {
+            return;
+        }
+        if (pair.targets.size() == this->_minTargets) {
+            auto flagged = this->_nonDeterministicPairs.find(pair.activity);
+            if (flagged != this->_nonDeterministicPairs.end() && 0 == --flagged->second) {
+                this->_nonDeterministicPairs.erase(flagged);
+            }
+        }
+        pair.targets.erase(target);
+        if (pair.targets.empty()) {
+            this->_pairs.erase(pairIt);
+        }
+    }
+
+    std::vector<InternedString> TransitionLog::nonDeterministicActivities() const {
+        std::set<InternedString, InternedStringNameLess> activities;
+        for (const auto &flagged: this->_nonDeterministicPairs) {
+            activities.insert(flagged.first);
+        }
+        return std::vector<InternedString>(activities.begin(), activities.end());
+    }
+
+    size_t TransitionLog::heapBytes() const {
+        size_t bytes = MemoryFootprint::bytesOf(this->_sources) + MemoryFootprint::bytesOf(this->_actions) +
+                       MemoryFootprint::bytesOf(this->_targets) + MemoryFootprint::bytesOf(this->_activities) +
+                       MemoryFootprint::bytesOf(this->_pairs) + MemoryFootprint::bytesOf(this->_nonDeterministicPairs);
+        for (const auto &pair: this->_pairs) {
+            bytes += MemoryFootprint::bytesOf(pair.second.targets);
+        }
+        return bytes;
+    }
+
+}
+
+#endif //TransitionLog_CPP_
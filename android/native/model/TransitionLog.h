@@ -0,0 +1,119 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+#ifndef TransitionLog_H_
+#define TransitionLog_H_
+
+#include "../StringInterner.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace fastbotx {
+
+    /**
+     * @brief Ring of the latest (source state, action, target state) transitions
+     *
+     * Feeds non-determinism detection for dynamic state abstraction: a (source, action)
+     * pair that led to minTargets or more distinct targets within the ring marks its
+     * source activity for refinement. Entries are stored as parallel columns with the
+     * activity interned, and the distinct targets of every pair are counted as entries
+     * enter and leave the ring, so recording is O(1) and a check is O(flagged activities)
+     * instead of a rebuild over the whole ring.
+     *
+     * Self-loops (source == target) take a slot but never count as a target.
+     * Not thread-safe: Model guards it with its abstraction mutex.
+     */
+    class TransitionLog {
+    public:
+        /**
+         * @param capacity Entries kept; the oldest is dropped when full (0 records nothing)
+         * @param minTargets Distinct targets that make a (source, action) pair non-deterministic
+         */
+        TransitionLog(size_t capacity, size_t minTargets);
+
+        void record(uintptr_t sourceStateHash, uintptr_t actionHash, uintptr_t targetStateHash,
+                    InternedString sourceActivity);
+
+        /// Source activities of the non-deterministic pairs, sorted by name
+        std::vector<InternedString> nonDeterministicActivities() const;
+
+        /// Entries currently in the ring
+        size_t size() const { return this->_count; }
+
+        size_t capacity() const { return this->_sources.size(); }
+
+        /// record() calls so far; entry i of all recorded has sequence number i
+        uint64_t recorded() const { return this->_recorded; }
+
+        /**
+         * @brief Visit the entries still in the ring with a sequence number of at least from, oldest first
+         *
+         * func(source, action, target, activity); used to save the ring with a session snapshot.
+         */
+        template<typename Func>
+        void forEachSince(uint64_t from, Func func) const {
+            uint64_t oldest = this->_recorded - this->_count;
+            size_t skip = from > oldest ? static_cast<size_t>(std::min<uint64_t>(from - oldest, this->_count)) : 0;
+            size_t first = (this->_next + this->_sources.size() - this->_count) % std::max<size_t>(this->_sources.size(), 1);
+            for (size_t i = skip; i < this->_count; i++) {
+                size_t slot = (first + i) % this->_sources.size();
+                func(this->_sources[slot], this->_actions[slot], this->_targets[slot], this->_activities[slot]);
+            }
+        }
+
+        /// Heap bytes of the columns and the pair counts
+        size_t heapBytes() const;
+
+    private:
+        struct PairKey {
+            uintptr_t source;
+            uintptr_t action;
+
+            bool operator==(const PairKey &other) const {
+                return this->source == other.source && this->action == other.action;
+            }
+        };
+
+        struct PairKeyHash {
+            size_t operator()(const PairKey &key) const {
+                return static_cast<size_t>(key.source ^ (key.action * 0x9e3779b97f4a7c15ULL));
+            }
+        };
+
+        /// Distinct targets of one (source, action) pair in the ring
+        struct PairTargets {
+            /// Target state hash -> entries with that target
+            std::unordered_map<uintptr_t, uint32_t> targets;
+            InternedString activity;
+        };
+
+        void add(size_t slot);
+
+        void remove(size_t slot);
+
+        // One column per field, indexed by ring slot
+        std::vector<uintptr_t> _sources;
+        std::vector<uintptr_t> _actions;
+        std::vector<uintptr_t> _targets;
+        std::vector<InternedString> _activities;
+        size_t _next{0};
+        size_t _count{0};
+        uint64_t _recorded{0};
+
+        size_t _minTargets;
+        std::unordered_map<PairKey, PairTargets, PairKeyHash> _pairs;
+        /// Activity -> its pairs with at least _minTargets distinct targets (only non-zero counts)
+        std::map<InternedString, uint32_t> _nonDeterministicPairs;
+    };
+
+}
+
+#endif //TransitionLog_H_
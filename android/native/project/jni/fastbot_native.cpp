@@ -7,14 +7,21 @@
 #include "fastbot_native.h"
 #include "Model.h"
 #include "Element.h"
+#include "DeltaDumpDecoder.h"
 #include "DeviceOperateWrapper.h"
 // #include "ModelReusableAgent.h"  // Temporarily disabled for DoubleSarsa testing
 #include "DoubleSarsaAgent.h"
+#include "GuiTraceRecorder.h"
 #include "utils.hpp"
 #include "../thirdpart/json/json.hpp"
 #include <random>
 #include <chrono>
+#include <climits>
+#include <memory>
+#include <algorithm>
 #include <cstring>
+#include <future>
+#include <mutex>
 
 #ifdef __cplusplus
 extern "C" {
@@ -22,95 +29,230 @@ extern "C" {
 
 static fastbotx::ModelPtr _fastbot_model = nullptr;
 
+// Set by initAgentAsyncNative, invalid (nothing to wait for) otherwise. _model_ready: _fastbot_model
+// exists with its configs loaded; _agent_ready: the agent, its reuse model and the resource mapping
+// are loaded too. Read and written under _init_mutex
+static std::mutex _init_mutex;
+static std::shared_future<void> _model_ready;
+static std::shared_future<void> _agent_ready;
+
+static void awaitInit(const std::shared_future<void> &stage) {
+    std::shared_future<void> ready;
+    {
+        std::lock_guard<std::mutex> guard(_init_mutex);
+        ready = stage;
+    }
+    if (ready.valid()) {
+        ready.wait();
+    }
+}
+
+// Entry points using _fastbot_model wait for this first; steps also wait for awaitAgentInit, after
+// parsing the dump, so the first page is parsed while the reuse model still loads
+static void awaitModelInit() {
+    awaitInit(_model_ready);
+}
+
+static void awaitAgentInit() {
+    awaitInit(_agent_ready);
+}
+
+// Tree of the last delta dump ("FB\0\3"), which the next one is applied to
+static fastbotx::DeltaDumpDecoder _delta_decoder;
+
+// GUI trace being recorded (startGuiTraceRecordingNative), or null; atomic_load / atomic_store only
+static fastbotx::GuiTraceRecorderPtr _gui_trace_recorder;
+
+// Append one getAction call to the GUI trace if recording; the dump must still be valid
+static void recordGuiTrace(const std::string &activity, const char *dump, size_t dumpLength,
+                           const std::string &operation, std::chrono::steady_clock::time_point callStart) {
+    fastbotx::GuiTraceRecorderPtr recorder = std::atomic_load(&_gui_trace_recorder);
+    if (!recorder) {
+        return;
+    }
+    auto stepCost = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - callStart).count();
+    recorder->record(activity.data(), activity.size(), dump, dumpLength, operation,
+                     static_cast<uint32_t>(stepCost));
+}
+
 // Fuzzer: RNG and one fuzz action JSON (performance §3.3)
-static std::mt19937 &fuzzRng() {
-    static std::mt19937 rng(static_cast<unsigned>(std::chrono::steady_clock::now().time_since_epoch().count()));
+// Stream "fuzz" of fastbotx::RandomStreams, reseeded after setRandomSeedNative
+static fastbotx::Rng &fuzzRng() {
+    static fastbotx::Rng rng;
+    static uint32_t seededGeneration = 0;
+    uint32_t generation = fastbotx::RandomStreams::generation();
+    if (seededGeneration != generation) {
+        rng = fastbotx::RandomStreams::stream("fuzz");
+        seededGeneration = generation;
+    }
     return rng;
 }
 
-static std::string getNextFuzzActionJson(int displayWidth, int displayHeight, bool simplify) {
+// Kinds of fuzz action, the type byte of getFuzzActionsIntoBufferNative
+enum FuzzActionType : uint8_t {
+    FuzzRotation = 0, FuzzAppSwitch = 1, FuzzDrag = 2, FuzzPinch = 3, FuzzClick = 4
+};
+
+// One fuzz action; points is flat [x1,y1,x2,y2,...] and keeps its capacity across draws
+struct FuzzAction {
+    FuzzActionType type{FuzzClick};
+    bool flag{false};   // rotation: persist, app_switch: home
+    int32_t value{0};   // rotation: degree, click: waitTime
+    std::vector<float> points;
+};
+
+static void nextFuzzAction(int displayWidth, int displayHeight, FuzzAction &action) {
     auto &rng = fuzzRng();
-    std::uniform_real_distribution<float> distW(0.f, static_cast<float>(displayWidth > 0 ? displayWidth : 1080));
-    std::uniform_real_distribution<float> distH(0.f, static_cast<float>(displayHeight > 0 ? displayHeight : 1920));
-    std::uniform_int_distribution<int> distRot(0, 3);
+    const float width = static_cast<float>(displayWidth > 0 ? displayWidth : 1080);
+    const float height = static_cast<float>(displayHeight > 0 ? displayHeight : 1920);
     const int rotations[] = {0, 90, 180, 270};
-    nlohmann::json j;
-    int typeChoice;
-    if (simplify) {
-        typeChoice = std::uniform_int_distribution<int>(0, 4)(rng);  // rotation, app_switch, drag, pinch, click
-    } else {
-        typeChoice = std::uniform_int_distribution<int>(0, 4)(rng);
+    action.flag = false;
+    action.value = 0;
+    action.points.clear();
+    auto addPoints = [&](int n) {
+        for (int i = 0; i < n; i++) {
+            action.points.push_back(rng.nextFloat() * width);
+            action.points.push_back(rng.nextFloat() * height);
+        }
+    };
+    switch (rng.nextInt(0, 5)) {  // rotation, app_switch, drag, pinch, click
+        case 0:
+            action.type = FuzzRotation;
+            action.value = rotations[rng.nextInt(0, 4)];
+            break;
+        case 1:
+            action.type = FuzzAppSwitch;
+            action.flag = (rng.nextBelow(2) != 0);
+            break;
+        case 2:  // 2-10 points
+            action.type = FuzzDrag;
+            addPoints(2 + rng.nextInt(0, 9));
+            break;
+        case 3:  // 4+ points, in pairs
+            action.type = FuzzPinch;
+            addPoints(4 + rng.nextInt(0, 7) * 2);
+            break;
+        default:
+            action.type = FuzzClick;
+            addPoints(1);
+            action.value = rng.nextInt(0, 1001);
+            break;
     }
-    switch (typeChoice) {
-        case 0:  // rotation
+}
+
+static std::string getNextFuzzActionJson(int displayWidth, int displayHeight, bool simplify) {
+    // simplify and full fuzzing draw from the same five kinds
+    (void) simplify;
+    FuzzAction action;
+    nextFuzzAction(displayWidth, displayHeight, action);
+    nlohmann::json j;
+    switch (action.type) {
+        case FuzzRotation:
             j["type"] = "rotation";
-            j["degree"] = rotations[distRot(rng)];
-            j["persist"] = false;
+            j["degree"] = action.value;
+            j["persist"] = action.flag;
             break;
-        case 1:  // app_switch
+        case FuzzAppSwitch:
             j["type"] = "app_switch";
-            j["home"] = (std::uniform_int_distribution<int>(0, 1)(rng) != 0);
+            j["home"] = action.flag;
             break;
-        case 2:  // drag: 2-10 points, flat values [x1,y1,x2,y2,...]
-            j["type"] = "drag";
-            {
-                int n = 2 + std::uniform_int_distribution<int>(0, 8)(rng);
-                nlohmann::json arr = nlohmann::json::array();
-                for (int i = 0; i < n; i++) {
-                    arr.push_back(distW(rng));
-                    arr.push_back(distH(rng));
-                }
-                j["values"] = arr;
-            }
+        case FuzzDrag:
+        case FuzzPinch:
+            j["type"] = action.type == FuzzDrag ? "drag" : "pinch";
+            j["values"] = action.points;
             break;
-        case 3:  // pinch: 4+ points (pairs), flat values
-            j["type"] = "pinch";
-            {
-                int n = 4 + std::uniform_int_distribution<int>(0, 6)(rng) * 2;
-                nlohmann::json arr = nlohmann::json::array();
-                for (int i = 0; i < n; i++) {
-                    arr.push_back(distW(rng));
-                    arr.push_back(distH(rng));
-                }
-                j["values"] = arr;
-            }
-            break;
-        default:  // click
+        default:
             j["type"] = "click";
-            j["x"] = distW(rng);
-            j["y"] = distH(rng);
-            j["waitTime"] = static_cast<long>(std::uniform_int_distribution<int>(0, 1000)(rng));
+            j["x"] = action.points[0];
+            j["y"] = action.points[1];
+            j["waitTime"] = static_cast<long>(action.value);
             break;
     }
     return j.dump();
 }
 
+// AlgorithmType::Server: the operate of the decision server for the raw dump, so the device neither
+// parses it nor runs the model; null to decide locally (no server, a delta dump, which needs the
+// local tree of the previous step, or no answer in time)
+static fastbotx::OperatePtr getRemoteOperate(fastbotx::Model &model, const char *dump, size_t byteLength,
+                                             const std::string &activity) {
+    if (!model.hasDecisionServer() || fastbotx::Element::isBinaryDelta(dump, byteLength)) {
+        return nullptr;
+    }
+    return model.getRemoteOperate(dump, byteLength, activity);
+}
+
+// Activity name of a Java string, interned; its id is the handle registerActivityNative returns
+static fastbotx::InternedString internActivity(JNIEnv *env, jstring activity) {
+    if (activity == nullptr) return fastbotx::InternedString();
+    const char *activityCString = env->GetStringUTFChars(activity, nullptr);
+    if (activityCString == nullptr) return fastbotx::InternedString();
+    fastbotx::InternedString interned = fastbotx::InternedString::intern(activityCString,
+                                                                         std::strlen(activityCString));
+    env->ReleaseStringUTFChars(activity, activityCString);
+    return interned;
+}
+
+// Activity of a handle from registerActivityNative; false (logged) for an id never handed out
+static bool activityOfHandle(jint handle, fastbotx::InternedString &activity) {
+    if (handle < 0 || !fastbotx::InternedString::fromId(static_cast<uint32_t>(handle), activity)) {
+        BLOGE("unknown activity handle %d", static_cast<int>(handle));
+        return false;
+    }
+    return true;
+}
+
 //getAction (XML string from Java - involves GetStringUTFChars copy)
 jstring JNICALL Java_com_bytedance_fastbot_AiClient_b0bhkadf(JNIEnv *env, jobject, jstring activity,
                                                              jstring xmlDescOfGuiTree) {
+    auto callStart = std::chrono::steady_clock::now();
+    awaitModelInit();
     if (nullptr == _fastbot_model) {
         _fastbot_model = fastbotx::Model::create();
     }
     const char *xmlDescriptionCString = env->GetStringUTFChars(xmlDescOfGuiTree, nullptr);
     const char *activityCString = env->GetStringUTFChars(activity, nullptr);
-    std::string xmlString = std::string(xmlDescriptionCString);
     std::string activityString = std::string(activityCString);
-    std::string operationString = _fastbot_model->getOperate(xmlString, activityString);
+    fastbotx::OperatePtr remote = getRemoteOperate(*_fastbot_model, xmlDescriptionCString,
+                                                   std::strlen(xmlDescriptionCString), activityString);
+    // Parsed in place: the UTF chars stay valid until released, after the tree is dropped
+    fastbotx::ElementPtr elem;
+    if (!remote) {
+        {
+            fastbotx::StageTimer parseTimer(_fastbot_model->getPerfStats(), fastbotx::PerfStage::Parse);
+            elem = fastbotx::Element::createFromXml(xmlDescriptionCString, std::strlen(xmlDescriptionCString), true);
+        }
+        awaitAgentInit();
+    }
+    std::string operationString = remote ? remote->toString()
+                                         : elem ? _fastbot_model->getOperate(elem, activityString) : "";
+    elem.reset();
     LOGD("do action opt is : %s", operationString.c_str());
+    recordGuiTrace(activityString, xmlDescriptionCString, std::strlen(xmlDescriptionCString), operationString,
+                   callStart);
     env->ReleaseStringUTFChars(xmlDescOfGuiTree, xmlDescriptionCString);
     env->ReleaseStringUTFChars(activity, activityCString);
     return env->NewStringUTF(operationString.c_str());
 }
 
-// Helper: parse tree from buffer (binary "FB\0\1" or XML), return ElementPtr (opt1).
+// Helper: parse tree from buffer (binary "FB\0\1" / "FB\0\2", a delta "FB\0\3" applied to the previous
+// one, or XML, parsed in place), return ElementPtr (opt1).
 // byteLength must be the actual number of bytes written (Java buffer limit), not capacity,
 // to avoid incomplete UTF-8 when building std::string (fixes type_error.316).
-static fastbotx::ElementPtr parseTreeFromBuffer(const char *addr, size_t byteLength) {
-    if (byteLength >= 4 && addr[0] == 'F' && addr[1] == 'B' && addr[2] == 0 && addr[3] == 1) {
-        return fastbotx::Element::createFromBinary(addr, byteLength);
+// The Direct ByteBuffer stays pinned for the whole JNI call and the tree is dropped before
+// returning, so binary string fields are borrowed from the buffer instead of copied.
+// Timed under PerfStage::Parse of model.
+static fastbotx::ElementPtr parseTreeFromBuffer(fastbotx::Model &model, const char *addr, size_t byteLength) {
+    fastbotx::StageTimer parseTimer(model.getPerfStats(), fastbotx::PerfStage::Parse);
+    if (fastbotx::Element::isBinaryDelta(addr, byteLength)) {
+        return _delta_decoder.decode(addr, byteLength, true);
+    }
+    if (byteLength >= 4 && addr[0] == 'F' && addr[1] == 'B' && addr[2] == 0 &&
+        (addr[3] == 1 || addr[3] == 2)) {
+        return fastbotx::Element::createFromBinary(addr, byteLength, true);
     }
-    std::string xmlString(addr, byteLength);
-    return fastbotx::Element::createFromXml(xmlString);
+    return fastbotx::Element::createFromXml(addr, byteLength, true);
 }
 
 // getAction from Direct ByteBuffer (performance: avoid GetStringUTFChars copy, PERF §3.1; opt1 binary path).
@@ -119,6 +261,8 @@ jstring JNICALL Java_com_bytedance_fastbot_AiClient_getActionFromBufferNative(JN
                                                                               jstring activity,
                                                                               jobject xmlBuffer,
                                                                               jint byteLength) {
+    auto callStart = std::chrono::steady_clock::now();
+    awaitModelInit();
     if (nullptr == _fastbot_model || xmlBuffer == nullptr) {
         return env->NewStringUTF("");
     }
@@ -136,22 +280,134 @@ jstring JNICALL Java_com_bytedance_fastbot_AiClient_getActionFromBufferNative(JN
     }
     const char *activityCString = env->GetStringUTFChars(activity, nullptr);
     std::string activityString = std::string(activityCString);
-    fastbotx::ElementPtr elem = parseTreeFromBuffer(static_cast<const char *>(addr), len);
     std::string operationString;
-    if (elem) {
+    fastbotx::OperatePtr remote = getRemoteOperate(*_fastbot_model, static_cast<const char *>(addr), len,
+                                                   activityString);
+    fastbotx::ElementPtr elem = remote ? nullptr : parseTreeFromBuffer(*_fastbot_model,
+                                                                       static_cast<const char *>(addr), len);
+    if (remote) {
+        operationString = remote->toString();
+    } else if (elem) {
+        awaitAgentInit();
         fastbotx::OperatePtr opt = _fastbot_model->getOperateOpt(elem, activityString, "");
         operationString = opt ? opt->toString() : "";
     }
+    recordGuiTrace(activityString, static_cast<const char *>(addr), len, operationString, callStart);
     env->ReleaseStringUTFChars(activity, activityCString);
     return env->NewStringUTF(operationString.c_str());
 }
 
-// getAction structured: return OperateResult to avoid JSON parse (SECURITY_AND_OPTIMIZATION §7 opt4).
-// byteLength must be the actual bytes in the buffer (Java limit/remaining), not capacity.
-jobject JNICALL Java_com_bytedance_fastbot_AiClient_getActionFromBufferNativeStructured(JNIEnv *env, jobject,
-                                                                                        jstring activity,
-                                                                                        jobject xmlBuffer,
-                                                                                        jint byteLength) {
+// Action plan from Direct ByteBuffer: getActionFromBufferNative followed by the queued custom actions
+// resolved on the same page, as PlannedOperate::planToString JSON ("" on failure). unexecutedSteps
+// trailing steps of the previous plan did not run and are queued again first.
+jstring JNICALL Java_com_bytedance_fastbot_AiClient_getActionPlanFromBufferNative(JNIEnv *env, jobject,
+                                                                                  jstring activity,
+                                                                                  jobject xmlBuffer,
+                                                                                  jint byteLength,
+                                                                                  jint maxSteps,
+                                                                                  jint unexecutedSteps) {
+    auto callStart = std::chrono::steady_clock::now();
+    awaitModelInit();
+    if (nullptr == _fastbot_model || xmlBuffer == nullptr) {
+        return env->NewStringUTF("");
+    }
+    void *addr = env->GetDirectBufferAddress(xmlBuffer);
+    jlong capacity = env->GetDirectBufferCapacity(xmlBuffer);
+    if (addr == nullptr || capacity <= 0) {
+        return env->NewStringUTF("");
+    }
+    size_t len = std::min(static_cast<size_t>(byteLength > 0 ? byteLength : 0), static_cast<size_t>(capacity));
+    if (len == 0) {
+        return env->NewStringUTF("");
+    }
+    const char *activityCString = env->GetStringUTFChars(activity, nullptr);
+    std::string activityString = std::string(activityCString);
+    fastbotx::ElementPtr elem = parseTreeFromBuffer(*_fastbot_model, static_cast<const char *>(addr), len);
+    std::string planString;
+    if (elem) {
+        awaitAgentInit();
+        std::vector<fastbotx::PlannedOperate> plan = _fastbot_model->getOperatePlan(
+                elem, activityString, "", static_cast<size_t>(std::max(maxSteps, 1)),
+                static_cast<size_t>(std::max(unexecutedSteps, 0)));
+        planString = fastbotx::PlannedOperate::planToString(plan);
+        recordGuiTrace(activityString, static_cast<const char *>(addr), len,
+                       plan.front().operate ? plan.front().operate->toString() : "", callStart);
+    }
+    env->ReleaseStringUTFChars(activity, activityCString);
+    return env->NewStringUTF(planString.c_str());
+}
+
+// OperateResult class and field IDs, looked up once (JNI_OnLoad, or the first structured call)
+struct OperateResultFields {
+    jclass cls{nullptr};
+    jfieldID actOrdinal{nullptr};
+    jfieldID pos{nullptr};
+    jfieldID throttle{nullptr};
+    jfieldID waitTime{nullptr};
+    jfieldID text{nullptr};
+    jfieldID clear{nullptr};
+    jfieldID adbInput{nullptr};
+    jfieldID rawInput{nullptr};
+    jfieldID allowFuzzing{nullptr};
+    jfieldID editable{nullptr};
+    jfieldID sid{nullptr};
+    jfieldID aid{nullptr};
+    jfieldID jAction{nullptr};
+    jfieldID widget{nullptr};
+};
+
+static OperateResultFields _operate_result_fields;
+
+static bool cacheOperateResultFields(JNIEnv *env) {
+    if (_operate_result_fields.cls != nullptr) return true;
+    jclass localClass = env->FindClass("com/android/commands/monkey/fastbot/client/OperateResult");
+    if (!localClass) {
+        env->ExceptionClear();
+        BLOGE("%s", "OperateResult class not found, structured result disabled");
+        return false;
+    }
+    OperateResultFields fields;
+    fields.actOrdinal = env->GetFieldID(localClass, "actOrdinal", "I");
+    fields.pos = env->GetFieldID(localClass, "pos", "[S");
+    fields.throttle = env->GetFieldID(localClass, "throttle", "I");
+    fields.waitTime = env->GetFieldID(localClass, "waitTime", "J");
+    fields.text = env->GetFieldID(localClass, "text", "Ljava/lang/String;");
+    fields.clear = env->GetFieldID(localClass, "clear", "Z");
+    fields.adbInput = env->GetFieldID(localClass, "adbInput", "Z");
+    fields.rawInput = env->GetFieldID(localClass, "rawInput", "Z");
+    fields.allowFuzzing = env->GetFieldID(localClass, "allowFuzzing", "Z");
+    fields.editable = env->GetFieldID(localClass, "editable", "Z");
+    fields.sid = env->GetFieldID(localClass, "sid", "Ljava/lang/String;");
+    fields.aid = env->GetFieldID(localClass, "aid", "Ljava/lang/String;");
+    fields.jAction = env->GetFieldID(localClass, "jAction", "Ljava/lang/String;");
+    fields.widget = env->GetFieldID(localClass, "widget", "Ljava/lang/String;");
+    if (env->ExceptionCheck()) {
+        env->ExceptionClear();
+        env->DeleteLocalRef(localClass);
+        BLOGE("%s", "OperateResult field missing, structured result disabled");
+        return false;
+    }
+    fields.cls = static_cast<jclass>(env->NewGlobalRef(localClass));
+    env->DeleteLocalRef(localClass);
+    _operate_result_fields = fields;
+    return fields.cls != nullptr;
+}
+
+// The library is loaded from AiClient, so FindClass here resolves through the app's class loader
+JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *vm, void *) {
+    JNIEnv *env = nullptr;
+    if (vm->GetEnv(reinterpret_cast<void **>(&env), JNI_VERSION_1_6) != JNI_OK || !env) {
+        return JNI_ERR;
+    }
+    cacheOperateResultFields(env);
+    return JNI_VERSION_1_6;
+}
+
+// Parse the tree in a Direct ByteBuffer and run one step; nullptr when the structured paths
+// return no result (the caller falls back to the JSON path)
+static fastbotx::OperatePtr getOperateFromBuffer(JNIEnv *env, fastbotx::InternedString activity,
+                                                 jobject xmlBuffer, jint byteLength) {
+    awaitModelInit();
     if (nullptr == _fastbot_model || xmlBuffer == nullptr) return nullptr;
     void *addr = env->GetDirectBufferAddress(xmlBuffer);
     jlong capacity = env->GetDirectBufferCapacity(xmlBuffer);
@@ -161,54 +417,258 @@ jobject JNICALL Java_com_bytedance_fastbot_AiClient_getActionFromBufferNativeStr
         len = static_cast<size_t>(capacity);
     }
     if (len == 0) return nullptr;
-    const char *activityCString = env->GetStringUTFChars(activity, nullptr);
-    std::string activityString = std::string(activityCString);
-    env->ReleaseStringUTFChars(activity, activityCString);
 
-    fastbotx::ElementPtr elem = parseTreeFromBuffer(static_cast<const char *>(addr), len);
+    fastbotx::OperatePtr opt = getRemoteOperate(*_fastbot_model, static_cast<const char *>(addr), len,
+                                                activity.str());
+    if (opt) return opt;
+    fastbotx::ElementPtr elem = parseTreeFromBuffer(*_fastbot_model, static_cast<const char *>(addr), len);
     if (!elem) return nullptr;
-    fastbotx::OperatePtr opt = _fastbot_model->getOperateOpt(elem, activityString, "");
+    awaitAgentInit();
+    opt = _fastbot_model->getOperateOpt(elem, activity, "");
     if (!opt || opt == fastbotx::DeviceOperateWrapper::OperateNop) return nullptr;
+    return opt;
+}
 
-    jclass cls = env->FindClass("com/android/commands/monkey/fastbot/client/OperateResult");
-    if (!cls) return nullptr;
-    jobject result = env->AllocObject(cls);
+// getAction structured: return OperateResult to avoid JSON parse (SECURITY_AND_OPTIMIZATION §7 opt4).
+// byteLength must be the actual bytes in the buffer (Java limit/remaining), not capacity.
+jobject JNICALL Java_com_bytedance_fastbot_AiClient_getActionFromBufferNativeStructured(JNIEnv *env, jobject,
+                                                                                        jstring activity,
+                                                                                        jobject xmlBuffer,
+                                                                                        jint byteLength) {
+    if (!cacheOperateResultFields(env)) return nullptr;
+    fastbotx::OperatePtr opt = getOperateFromBuffer(env, internActivity(env, activity), xmlBuffer, byteLength);
+    if (!opt) return nullptr;
+
+    const OperateResultFields &fields = _operate_result_fields;
+    jobject result = env->AllocObject(fields.cls);
     if (!result) return nullptr;
 
-    env->SetIntField(result, env->GetFieldID(cls, "actOrdinal", "I"), static_cast<jint>(opt->act));
+    env->SetIntField(result, fields.actOrdinal, static_cast<jint>(opt->act));
     jshortArray posArr = env->NewShortArray(4);
     if (posArr && opt->pos.left >= -32768 && opt->pos.left <= 32767) {
         jshort posData[4] = { static_cast<jshort>(opt->pos.left), static_cast<jshort>(opt->pos.top),
                              static_cast<jshort>(opt->pos.right), static_cast<jshort>(opt->pos.bottom) };
         env->SetShortArrayRegion(posArr, 0, 4, posData);
     }
-    env->SetObjectField(result, env->GetFieldID(cls, "pos", "[S"), posArr);
-    env->SetIntField(result, env->GetFieldID(cls, "throttle", "I"), static_cast<jint>(opt->throttle));
-    env->SetLongField(result, env->GetFieldID(cls, "waitTime", "J"), static_cast<jlong>(opt->waitTime));
-    env->SetObjectField(result, env->GetFieldID(cls, "text", "Ljava/lang/String;"),
+    env->SetObjectField(result, fields.pos, posArr);
+    env->SetIntField(result, fields.throttle, static_cast<jint>(opt->throttle));
+    env->SetLongField(result, fields.waitTime, static_cast<jlong>(opt->waitTime));
+    env->SetObjectField(result, fields.text,
                         opt->getText().empty() ? nullptr : env->NewStringUTF(opt->getText().c_str()));
-    env->SetBooleanField(result, env->GetFieldID(cls, "clear", "Z"), opt->clear ? JNI_TRUE : JNI_FALSE);
-    env->SetBooleanField(result, env->GetFieldID(cls, "adbInput", "Z"), opt->adbInput ? JNI_TRUE : JNI_FALSE);
-    env->SetBooleanField(result, env->GetFieldID(cls, "rawInput", "Z"), opt->getRawInput() ? JNI_TRUE : JNI_FALSE);
-    env->SetBooleanField(result, env->GetFieldID(cls, "allowFuzzing", "Z"), opt->allowFuzzing ? JNI_TRUE : JNI_FALSE);
-    env->SetBooleanField(result, env->GetFieldID(cls, "editable", "Z"), opt->editable ? JNI_TRUE : JNI_FALSE);
-    env->SetObjectField(result, env->GetFieldID(cls, "sid", "Ljava/lang/String;"),
+    env->SetBooleanField(result, fields.clear, opt->clear ? JNI_TRUE : JNI_FALSE);
+    env->SetBooleanField(result, fields.adbInput, opt->adbInput ? JNI_TRUE : JNI_FALSE);
+    env->SetBooleanField(result, fields.rawInput, opt->getRawInput() ? JNI_TRUE : JNI_FALSE);
+    env->SetBooleanField(result, fields.allowFuzzing, opt->allowFuzzing ? JNI_TRUE : JNI_FALSE);
+    env->SetBooleanField(result, fields.editable, opt->editable ? JNI_TRUE : JNI_FALSE);
+    env->SetObjectField(result, fields.sid,
                         opt->sid.empty() ? nullptr : env->NewStringUTF(opt->sid.c_str()));
-    env->SetObjectField(result, env->GetFieldID(cls, "aid", "Ljava/lang/String;"),
+    env->SetObjectField(result, fields.aid,
                         opt->aid.empty() ? nullptr : env->NewStringUTF(opt->aid.c_str()));
-    env->SetObjectField(result, env->GetFieldID(cls, "jAction", "Ljava/lang/String;"),
+    env->SetObjectField(result, fields.jAction,
                         opt->getJAction().empty() ? nullptr : env->NewStringUTF(opt->getJAction().c_str()));
-    env->SetObjectField(result, env->GetFieldID(cls, "widget", "Ljava/lang/String;"),
+    env->SetObjectField(result, fields.widget,
                         opt->widget.empty() ? nullptr : env->NewStringUTF(opt->widget.c_str()));
 
-    env->DeleteLocalRef(cls);
     if (posArr) env->DeleteLocalRef(posArr);
     return result;
 }
 
+// Last encoded result, which takePendingResultNative copies when it did not fit the caller's
+// buffer; its capacity is reused, so encoding does not allocate once warmed up. Kept per
+// thread, since each device steps the shared model from its own thread
+static thread_local std::string _pending_operate_result;
+
+// Copy the pending result into a Direct ByteBuffer: its size, or -size if the buffer is too small
+static jint copyPendingResult(JNIEnv *env, jobject resultBuffer) {
+    auto size = static_cast<jint>(_pending_operate_result.size());
+    void *addr = resultBuffer ? env->GetDirectBufferAddress(resultBuffer) : nullptr;
+    jlong capacity = resultBuffer ? env->GetDirectBufferCapacity(resultBuffer) : 0;
+    if (addr == nullptr || capacity < size) {
+        return -size;
+    }
+    std::memcpy(addr, _pending_operate_result.data(), _pending_operate_result.size());
+    return size;
+}
+
+// getAction into a caller-owned Direct ByteBuffer (DeviceOperateWrapper::writeBinary): no JNI lookups
+// and no Java objects created. Returns the bytes written, 0 when there is no structured result
+// (fall back to the JSON path), or -size if resultBuffer is too small: the result is kept and
+// takePendingResultNative copies it into a larger buffer without running another step.
+jint JNICALL Java_com_bytedance_fastbot_AiClient_getActionFromBufferNativeInto(JNIEnv *env, jobject,
+                                                                               jstring activity,
+                                                                               jobject xmlBuffer,
+                                                                               jint byteLength,
+                                                                               jobject resultBuffer) {
+    fastbotx::OperatePtr opt = getOperateFromBuffer(env, internActivity(env, activity), xmlBuffer, byteLength);
+    if (!opt) return 0;
+    opt->writeBinary(_pending_operate_result);
+    return copyPendingResult(env, resultBuffer);
+}
+
+// Intern an activity name once; the handle stands for it in the ...ByHandle calls, so the
+// per-step calls copy no activity string across JNI. Stable for the life of the process.
+jint JNICALL Java_com_bytedance_fastbot_AiClient_registerActivityNative(JNIEnv *env, jobject, jstring activity) {
+    return static_cast<jint>(internActivity(env, activity).id());
+}
+
+// getActionFromBufferNativeInto with an activity handle of registerActivityNative; 0 for an unknown handle
+jint JNICALL Java_com_bytedance_fastbot_AiClient_getActionFromBufferNativeIntoByHandle(JNIEnv *env, jobject,
+                                                                                       jint activityHandle,
+                                                                                       jobject xmlBuffer,
+                                                                                       jint byteLength,
+                                                                                       jobject resultBuffer) {
+    fastbotx::InternedString activity;
+    if (!activityOfHandle(activityHandle, activity)) return 0;
+    fastbotx::OperatePtr opt = getOperateFromBuffer(env, activity, xmlBuffer, byteLength);
+    if (!opt) return 0;
+    opt->writeBinary(_pending_operate_result);
+    return copyPendingResult(env, resultBuffer);
+}
+
+// getAction (XML string) answered in binary like getActionFromBufferNativeInto, so Java parses no
+// JSON; every operation is encoded, NOP included, as b0bhkadf returns it. 0 if the XML does not parse.
+jint JNICALL Java_com_bytedance_fastbot_AiClient_getActionNativeInto(JNIEnv *env, jobject, jstring activity,
+                                                                     jstring xmlDescOfGuiTree,
+                                                                     jobject resultBuffer) {
+    awaitModelInit();
+    if (nullptr == _fastbot_model) {
+        _fastbot_model = fastbotx::Model::create();
+    }
+    const char *xmlDescriptionCString = env->GetStringUTFChars(xmlDescOfGuiTree, nullptr);
+    const char *activityCString = env->GetStringUTFChars(activity, nullptr);
+    std::string activityString = std::string(activityCString);
+    env->ReleaseStringUTFChars(activity, activityCString);
+    fastbotx::OperatePtr opt = getRemoteOperate(*_fastbot_model, xmlDescriptionCString,
+                                                std::strlen(xmlDescriptionCString), activityString);
+    // Parsed in place, as in b0bhkadf
+    fastbotx::ElementPtr elem;
+    if (!opt) {
+        {
+            fastbotx::StageTimer parseTimer(_fastbot_model->getPerfStats(), fastbotx::PerfStage::Parse);
+            elem = fastbotx::Element::createFromXml(xmlDescriptionCString, std::strlen(xmlDescriptionCString), true);
+        }
+        awaitAgentInit();
+        opt = elem ? _fastbot_model->getOperateOpt(elem, activityString, "") : nullptr;
+    }
+    elem.reset();
+    env->ReleaseStringUTFChars(xmlDescOfGuiTree, xmlDescriptionCString);
+    if (!opt) return 0;
+    opt->writeBinary(_pending_operate_result);
+    return copyPendingResult(env, resultBuffer);
+}
+
+jint JNICALL Java_com_bytedance_fastbot_AiClient_takePendingResultNative(JNIEnv *env, jobject,
+                                                                         jobject resultBuffer) {
+    if (_pending_operate_result.empty()) return 0;
+    return copyPendingResult(env, resultBuffer);
+}
+
+// A step submitted by submitActionFromBufferNative, until pollActionResultNative hands its result
+// over. Kept per thread like _pending_operate_result
+struct SubmittedStep {
+    fastbotx::StepTaskPtr task;
+    // Written by the task, read once it is done
+    fastbotx::OperatePtr operate;
+    // Global reference to the dump, which the task parses in place
+    jobject xmlBuffer{nullptr};
+};
+
+static thread_local std::shared_ptr<SubmittedStep> _submitted_step;
+
+// pollActionResultNative: the submitted step is still running
+static const jint SubmittedStepPending = INT32_MIN;
+
+// Start getActionFromBufferNativeInto on the model's StepExecutor and return at once, so the caller
+// can go on (e.g. wait for the device) while the dump is parsed and the action selected. xmlBuffer
+// must not change until pollActionResultNative returned the result. False if nothing was submitted:
+// no model, an empty buffer, or a step of this thread not polled yet.
+static jboolean submitActionFromBuffer(JNIEnv *env, fastbotx::InternedString activity, jobject xmlBuffer,
+                                       jint byteLength) {
+    awaitModelInit();
+    if (nullptr == _fastbot_model || xmlBuffer == nullptr || _submitted_step) return JNI_FALSE;
+    void *addr = env->GetDirectBufferAddress(xmlBuffer);
+    jlong capacity = env->GetDirectBufferCapacity(xmlBuffer);
+    if (addr == nullptr || capacity <= 0) return JNI_FALSE;
+    size_t len = static_cast<size_t>(byteLength > 0 ? byteLength : 0);
+    if (len > static_cast<size_t>(capacity)) {
+        len = static_cast<size_t>(capacity);
+    }
+    if (len == 0) return JNI_FALSE;
+
+    auto step = std::make_shared<SubmittedStep>();
+    step->xmlBuffer = env->NewGlobalRef(xmlBuffer);
+    fastbotx::ModelPtr model = _fastbot_model;
+    const char *xml = static_cast<const char *>(addr);
+    // The task holds its SubmittedStep only weakly: the caller's thread owns it
+    std::weak_ptr<SubmittedStep> weakStep = step;
+    step->task = model->getStepExecutor()->submit([model, xml, len, activity, weakStep]() {
+        fastbotx::OperatePtr remote = getRemoteOperate(*model, xml, len, activity.str());
+        if (remote) {
+            if (auto submitted = weakStep.lock()) {
+                submitted->operate = remote;
+            }
+            return;
+        }
+        // Parsed on the worker: the tree is dropped before the task ends, as in the other paths
+        fastbotx::ElementPtr elem = parseTreeFromBuffer(*model, xml, len);
+        awaitAgentInit();
+        fastbotx::OperatePtr opt = elem ? model->getOperateOpt(elem, activity, "") : nullptr;
+        elem.reset();
+        if (auto submitted = weakStep.lock()) {
+            submitted->operate = opt;
+        }
+    });
+    _submitted_step = step;
+    return JNI_TRUE;
+}
+
+jboolean JNICALL Java_com_bytedance_fastbot_AiClient_submitActionFromBufferNative(JNIEnv *env, jobject,
+                                                                                 jstring activity,
+                                                                                 jobject xmlBuffer,
+                                                                                 jint byteLength) {
+    return submitActionFromBuffer(env, internActivity(env, activity), xmlBuffer, byteLength);
+}
+
+// submitActionFromBufferNative with an activity handle of registerActivityNative
+jboolean JNICALL Java_com_bytedance_fastbot_AiClient_submitActionFromBufferNativeByHandle(JNIEnv *env, jobject,
+                                                                                         jint activityHandle,
+                                                                                         jobject xmlBuffer,
+                                                                                         jint byteLength) {
+    fastbotx::InternedString activity;
+    if (!activityOfHandle(activityHandle, activity)) return JNI_FALSE;
+    return submitActionFromBuffer(env, activity, xmlBuffer, byteLength);
+}
+
+// Result of the step submitted on this thread, as getActionNativeInto returns it (NOP included).
+// Waits up to timeoutMs for it, SubmittedStepPending if it is still running then; a negative
+// timeout waits until it is done, running it here if no worker started it yet. 0 if no step was
+// submitted or the dump did not parse.
+jint JNICALL Java_com_bytedance_fastbot_AiClient_pollActionResultNative(JNIEnv *env, jobject,
+                                                                        jobject resultBuffer,
+                                                                        jlong timeoutMs) {
+    if (!_submitted_step) return 0;
+    std::shared_ptr<SubmittedStep> step = _submitted_step;
+    if (timeoutMs < 0) {
+        step->task->wait();
+    } else if (!step->task->waitFor(std::chrono::milliseconds(timeoutMs))) {
+        return SubmittedStepPending;
+    }
+    _submitted_step.reset();
+    env->DeleteGlobalRef(step->xmlBuffer);
+    if (!step->operate) return 0;
+    step->operate->writeBinary(_pending_operate_result);
+    return copyPendingResult(env, resultBuffer);
+}
+
+// ID of the delta dump the next one may be based on, 0 if the dumper must send one without references
+jlong JNICALL Java_com_bytedance_fastbot_AiClient_getDeltaBaseDumpIdNative(JNIEnv *, jobject) {
+    return static_cast<jlong>(_delta_decoder.baseDumpId());
+}
+
 // for single device, just addAgent as empty device //InitAgent
 void JNICALL Java_com_bytedance_fastbot_AiClient_fgdsaf5d(JNIEnv *env, jobject, jint agentType,
                                                           jstring packageName, jint deviceType) {
+    awaitAgentInit();
     if (nullptr == _fastbot_model) {
         _fastbot_model = fastbotx::Model::create();
     }
@@ -219,6 +679,7 @@ void JNICALL Java_com_bytedance_fastbot_AiClient_fgdsaf5d(JNIEnv *env, jobject,
     if (env)
         packageNameCString = env->GetStringUTFChars(packageName, nullptr);
     _fastbot_model->setPackageName(std::string(packageNameCString));
+    _fastbot_model->startSession();
 
     BLOG("init agent with type %d, %s,  %d", agentType, packageNameCString, deviceType);
     // Temporarily: Always use DoubleSarsaAgent for testing
@@ -236,6 +697,7 @@ void JNICALL Java_com_bytedance_fastbot_AiClient_fgdsaf5d(JNIEnv *env, jobject,
 // load ResMapping
 void JNICALL
 Java_com_bytedance_fastbot_AiClient_jdasdbil(JNIEnv *env, jobject, jstring resMappingFilepath) {
+    awaitAgentInit();
     if (nullptr == _fastbot_model) {
         _fastbot_model = fastbotx::Model::create();
     }
@@ -247,31 +709,87 @@ Java_com_bytedance_fastbot_AiClient_jdasdbil(JNIEnv *env, jobject, jstring resMa
     env->ReleaseStringUTFChars(resMappingFilepath, resourceMappingPath);
 }
 
+// fgdsaf5d and jdasdbil in the background, returning at once: the reuse model file is mapped and
+// verified, and the resource mapping parsed, while the configs load (Model::create); the agent is
+// added once the model exists. Later calls wait for the stage they need (awaitModelInit,
+// awaitAgentInit). resMappingPath "" loads no mapping besides max.mapping.
+void JNICALL
+Java_com_bytedance_fastbot_AiClient_initAgentAsyncNative(JNIEnv *env, jobject, jint agentType,
+                                                         jstring packageName, jint deviceType,
+                                                         jstring resMappingPath) {
+    std::string packageNameString;
+    std::string mappingPathString;
+    if (packageName != nullptr) {
+        const char *packageNameCString = env->GetStringUTFChars(packageName, nullptr);
+        packageNameString = packageNameCString;
+        env->ReleaseStringUTFChars(packageName, packageNameCString);
+    }
+    if (resMappingPath != nullptr) {
+        const char *mappingPathCString = env->GetStringUTFChars(resMappingPath, nullptr);
+        mappingPathString = mappingPathCString;
+        env->ReleaseStringUTFChars(resMappingPath, mappingPathCString);
+    }
+    BLOG("init agent async with type %d, %s,  %d", agentType, packageNameString.c_str(), deviceType);
+
+    std::lock_guard<std::mutex> guard(_init_mutex);
+    if (_agent_ready.valid()) {
+        BLOGE("%s", "agent init already started");
+        return;
+    }
+    fastbotx::DoubleSarsaAgent::prefetchReuseModel(packageNameString);
+    std::shared_future<fastbotx::Preference::ResMappingPairs> mapping;
+    if (!mappingPathString.empty()) {
+        mapping = std::async(std::launch::async, &fastbotx::Preference::readMixResMapping, mappingPathString).share();
+    }
+    _model_ready = std::async(std::launch::async, []() {
+        if (nullptr == _fastbot_model) {
+            _fastbot_model = fastbotx::Model::create();
+        }
+    }).share();
+    std::shared_future<void> modelReady = _model_ready;
+    _agent_ready = std::async(std::launch::async, [modelReady, mapping, agentType, deviceType, packageNameString]() {
+        modelReady.wait();
+        auto agentPointer = _fastbot_model->addAgent("", (fastbotx::AlgorithmType) agentType,
+                                                     (fastbotx::DeviceType) deviceType);
+        _fastbot_model->setPackageName(packageNameString);
+        _fastbot_model->startSession();
+        auto doubleSarsaAgentPtr = std::dynamic_pointer_cast<fastbotx::DoubleSarsaAgent>(agentPointer);
+        if (doubleSarsaAgentPtr) {
+            doubleSarsaAgentPtr->loadReuseModel(packageNameString);
+        } else {
+            BLOGE("Double SARSA: Failed to cast agent to DoubleSarsaAgent");
+        }
+        auto preference = _fastbot_model->getPreference();
+        if (preference && mapping.valid()) {
+            preference->applyMixResMapping(mapping.get());
+        }
+    }).share();
+}
+
 // to check if a point is in black widget area (single point)
 jboolean JNICALL
 Java_com_bytedance_fastbot_AiClient_nkksdhdk(JNIEnv *env, jobject, jstring activity, jfloat pointX,
                                              jfloat pointY) {
     bool isShield = false;
+    awaitModelInit();
     if (nullptr == _fastbot_model) {
         BLOGE("%s", "model null, check point failed!");
         return isShield;
     }
-    const char *activityStr = env->GetStringUTFChars(activity, nullptr);
     auto preference = _fastbot_model->getPreference();
     if (preference) {
-        isShield = preference->checkPointIsInBlackRects(std::string(activityStr),
+        isShield = preference->checkPointIsInBlackRects(internActivity(env, activity),
                                                         static_cast<int>(pointX),
                                                         static_cast<int>(pointY));
     }
-    env->ReleaseStringUTFChars(activity, activityStr);
     return isShield;
 }
 
 // batch check: multiple points in one JNI call to reduce round-trips (performance optimization)
-jbooleanArray JNICALL
-Java_com_bytedance_fastbot_AiClient_checkPointsInShieldNative(JNIEnv *env, jobject, jstring activity,
-                                                              jfloatArray xCoords, jfloatArray yCoords) {
+static jbooleanArray checkPointsInShield(JNIEnv *env, fastbotx::InternedString activity,
+                                         jfloatArray xCoords, jfloatArray yCoords) {
     jbooleanArray result = nullptr;
+    awaitModelInit();
     if (nullptr == _fastbot_model || xCoords == nullptr || yCoords == nullptr) {
         return result;
     }
@@ -283,28 +801,22 @@ Java_com_bytedance_fastbot_AiClient_checkPointsInShieldNative(JNIEnv *env, jobje
     if (result == nullptr) {
         return nullptr;
     }
-    const char *activityStr = env->GetStringUTFChars(activity, nullptr);
     jfloat *xElems = env->GetFloatArrayElements(xCoords, nullptr);
     jfloat *yElems = env->GetFloatArrayElements(yCoords, nullptr);
-    if (activityStr == nullptr || xElems == nullptr || yElems == nullptr) {
-        if (activityStr) env->ReleaseStringUTFChars(activity, activityStr);
+    if (xElems == nullptr || yElems == nullptr) {
         if (xElems) env->ReleaseFloatArrayElements(xCoords, xElems, JNI_ABORT);
         if (yElems) env->ReleaseFloatArrayElements(yCoords, yElems, JNI_ABORT);
         return result;
     }
     auto preference = _fastbot_model->getPreference();
-    std::string activityCpp(activityStr);
     jboolean *out = new jboolean[len];
-    for (jsize i = 0; i < len; i++) {
-        bool isShield = false;
-        if (preference) {
-            isShield = preference->checkPointIsInBlackRects(activityCpp,
-                                                            static_cast<int>(xElems[i]),
-                                                            static_cast<int>(yElems[i]));
-        }
-        out[i] = isShield ? JNI_TRUE : JNI_FALSE;
+    if (preference) {
+        static_assert(sizeof(jboolean) == sizeof(uint8_t), "jboolean is expected to be uint8_t");
+        preference->checkPointsInBlackRects(activity, xElems, yElems,
+                                            static_cast<size_t>(len), reinterpret_cast<uint8_t *>(out));
+    } else {
+        std::fill(out, out + len, static_cast<jboolean>(JNI_FALSE));
     }
-    env->ReleaseStringUTFChars(activity, activityStr);
     env->ReleaseFloatArrayElements(xCoords, xElems, JNI_ABORT);
     env->ReleaseFloatArrayElements(yCoords, yElems, JNI_ABORT);
     env->SetBooleanArrayRegion(result, 0, len, out);
@@ -312,12 +824,28 @@ Java_com_bytedance_fastbot_AiClient_checkPointsInShieldNative(JNIEnv *env, jobje
     return result;
 }
 
+jbooleanArray JNICALL
+Java_com_bytedance_fastbot_AiClient_checkPointsInShieldNative(JNIEnv *env, jobject, jstring activity,
+                                                              jfloatArray xCoords, jfloatArray yCoords) {
+    return checkPointsInShield(env, internActivity(env, activity), xCoords, yCoords);
+}
+
+// checkPointsInShieldNative with an activity handle of registerActivityNative; null for an unknown handle
+jbooleanArray JNICALL
+Java_com_bytedance_fastbot_AiClient_checkPointsInShieldNativeByHandle(JNIEnv *env, jobject, jint activityHandle,
+                                                                      jfloatArray xCoords, jfloatArray yCoords) {
+    fastbotx::InternedString activity;
+    if (!activityOfHandle(activityHandle, activity)) return nullptr;
+    return checkPointsInShield(env, activity, xCoords, yCoords);
+}
+
 jstring JNICALL Java_com_bytedance_fastbot_AiClient_getNativeVersion(JNIEnv *env, jclass clazz) {
     return env->NewStringUTF(FASTBOT_VERSION);
 }
 
 // Coverage tracking: report activity (performance optimization §3.4)
 void JNICALL Java_com_bytedance_fastbot_AiClient_reportActivityNative(JNIEnv *env, jobject, jstring activity) {
+    awaitModelInit();
     if (nullptr == _fastbot_model || activity == nullptr) return;
     const char *activityStr = env->GetStringUTFChars(activity, nullptr);
     if (activityStr) {
@@ -328,11 +856,63 @@ void JNICALL Java_com_bytedance_fastbot_AiClient_reportActivityNative(JNIEnv *en
 
 // Coverage tracking: get coverage JSON (performance optimization §3.4)
 jstring JNICALL Java_com_bytedance_fastbot_AiClient_getCoverageJsonNative(JNIEnv *env, jobject) {
+    awaitModelInit();
     if (nullptr == _fastbot_model) return env->NewStringUTF("{}");
     std::string json = _fastbot_model->getCoverageJson();
     return env->NewStringUTF(json.c_str());
 }
 
+// Coverage tracking: activity switches batched by Java, as (length u16, UTF-8 bytes) records in a
+// Direct ByteBuffer, reported under one lock. Returns the activities reported
+jint JNICALL Java_com_bytedance_fastbot_AiClient_reportActivitiesNative(JNIEnv *env, jobject, jobject buffer,
+                                                                        jint byteLength) {
+    awaitModelInit();
+    auto *data = buffer ? static_cast<const uint8_t *>(env->GetDirectBufferAddress(buffer)) : nullptr;
+    jlong capacity = buffer ? env->GetDirectBufferCapacity(buffer) : 0;
+    if (nullptr == _fastbot_model || data == nullptr || byteLength <= 0 || byteLength > capacity) {
+        return 0;
+    }
+    static thread_local std::vector<std::string> activities;
+    size_t count = 0;
+    size_t offset = 0;
+    auto size = static_cast<size_t>(byteLength);
+    while (offset + 2 <= size) {
+        uint16_t length;
+        std::memcpy(&length, data + offset, sizeof(length));
+        offset += 2;
+        if (length > size - offset) {
+            BLOGE("activity report truncated at byte %zu", offset);
+            break;
+        }
+        if (activities.size() <= count) {
+            activities.emplace_back();
+        }
+        activities[count++].assign(reinterpret_cast<const char *>(data + offset), length);
+        offset += length;
+    }
+    activities.resize(count);
+    _fastbot_model->reportActivities(activities);
+    return static_cast<jint>(count);
+}
+
+// Coverage tracking: activities first seen since sinceVersion, and the counters, in binary
+// (Model::writeCoverageDelta). Returns the bytes written, or -size if resultBuffer is too small
+jint JNICALL Java_com_bytedance_fastbot_AiClient_getCoverageDeltaNative(JNIEnv *env, jobject, jint sinceVersion,
+                                                                        jobject resultBuffer) {
+    awaitModelInit();
+    if (nullptr == _fastbot_model) return 0;
+    static thread_local std::string delta;
+    _fastbot_model->writeCoverageDelta(static_cast<uint32_t>(sinceVersion), delta);
+    auto size = static_cast<jint>(delta.size());
+    void *addr = resultBuffer ? env->GetDirectBufferAddress(resultBuffer) : nullptr;
+    jlong capacity = resultBuffer ? env->GetDirectBufferCapacity(resultBuffer) : 0;
+    if (addr == nullptr || capacity < size) {
+        return -size;
+    }
+    std::memcpy(addr, delta.data(), delta.size());
+    return size;
+}
+
 // Fuzzing: get next fuzz action JSON from C++ (performance §3.3)
 jstring JNICALL Java_com_bytedance_fastbot_AiClient_getNextFuzzActionNative(JNIEnv *env, jobject,
                                                                             jint displayWidth,
@@ -342,6 +922,146 @@ jstring JNICALL Java_com_bytedance_fastbot_AiClient_getNextFuzzActionNative(JNIE
     return env->NewStringUTF(json.c_str());
 }
 
+// Fuzzing: count fuzz actions written into a Direct ByteBuffer in one call, without JSON or Java strings.
+// Little-endian, one record per action: type u8 (FuzzActionType) | flag u8 | point count u16 |
+// value i32 | (x f32, y f32) x point count. With an activity, actions touching one of its black rects
+// (checkPointsInBlackRects) are drawn again, up to 4 * count draws in all. Returns the actions written:
+// fewer than count when the buffer is full or the draws ran out.
+jint JNICALL Java_com_bytedance_fastbot_AiClient_getFuzzActionsIntoBufferNative(JNIEnv *env, jobject,
+                                                                                jobject resultBuffer,
+                                                                                jint count,
+                                                                                jint displayWidth,
+                                                                                jint displayHeight,
+                                                                                jstring activity) {
+    auto *out = resultBuffer ? static_cast<uint8_t *>(env->GetDirectBufferAddress(resultBuffer)) : nullptr;
+    jlong capacity = resultBuffer ? env->GetDirectBufferCapacity(resultBuffer) : 0;
+    if (out == nullptr || capacity <= 0 || count <= 0) {
+        return 0;
+    }
+    fastbotx::PreferencePtr preference;
+    std::string activityString;
+    if (activity != nullptr) {
+        awaitModelInit();
+        preference = _fastbot_model ? _fastbot_model->getPreference() : nullptr;
+        const char *activityCString = env->GetStringUTFChars(activity, nullptr);
+        if (activityCString) {
+            activityString = activityCString;
+            env->ReleaseStringUTFChars(activity, activityCString);
+        }
+    }
+    static thread_local FuzzAction action;
+    static thread_local std::vector<float> xs, ys;
+    static thread_local std::vector<uint8_t> inBlack;
+    const size_t headerSize = 8;
+    size_t offset = 0;
+    jint written = 0;
+    for (jint draws = 0; written < count && draws < count * 4; draws++) {
+        nextFuzzAction(displayWidth, displayHeight, action);
+        size_t pointCount = action.points.size() / 2;
+        if (preference && pointCount > 0) {
+            xs.resize(pointCount);
+            ys.resize(pointCount);
+            inBlack.resize(pointCount);
+            for (size_t i = 0; i < pointCount; i++) {
+                xs[i] = action.points[2 * i];
+                ys[i] = action.points[2 * i + 1];
+            }
+            preference->checkPointsInBlackRects(activityString, xs.data(), ys.data(), pointCount, inBlack.data());
+            if (std::find(inBlack.begin(), inBlack.end(), 1) != inBlack.end()) {
+                continue;
+            }
+        }
+        size_t recordSize = headerSize + action.points.size() * sizeof(float);
+        if (offset + recordSize > static_cast<size_t>(capacity)) {
+            break;
+        }
+        auto points = static_cast<uint16_t>(pointCount);
+        out[offset] = static_cast<uint8_t>(action.type);
+        out[offset + 1] = action.flag ? 1 : 0;
+        std::memcpy(out + offset + 2, &points, sizeof(points));
+        std::memcpy(out + offset + 4, &action.value, sizeof(action.value));
+        std::memcpy(out + offset + headerSize, action.points.data(), action.points.size() * sizeof(float));
+        offset += recordSize;
+        written++;
+    }
+    return written;
+}
+
+// Seed of every native generator (fastbotx::RandomStreams), e.g. the monkey seed, so a run can be
+// replayed; call before initAgent, as agents take their stream when created
+void JNICALL Java_com_bytedance_fastbot_AiClient_setRandomSeedNative(JNIEnv *, jobject, jlong seed) {
+    fastbotx::RandomStreams::setGlobalSeed(static_cast<uint64_t>(seed));
+    BLOG("random seed set to %lld", static_cast<long long>(seed));
+}
+
+// Persist the reuse model now instead of at the next scheduled save (e.g. before the test stops)
+jboolean JNICALL Java_com_bytedance_fastbot_AiClient_flushModelNative(JNIEnv *env, jobject) {
+    awaitAgentInit();
+    if (nullptr == _fastbot_model) return JNI_FALSE;
+    // Includes the step the device is executing; no step runs while the Q-table is copied
+    bool flushed = _fastbot_model->withIdleAgent("", [](const fastbotx::AbstractAgentPtr &agent) {
+        auto doubleSarsaAgentPtr = std::dynamic_pointer_cast<fastbotx::DoubleSarsaAgent>(agent);
+        return doubleSarsaAgentPtr && doubleSarsaAgentPtr->flushReuseModel();
+    });
+    return flushed ? JNI_TRUE : JNI_FALSE;
+}
+
+// The test stopped cleanly: stop the session snapshots and delete the file, so the next run starts afresh
+void JNICALL Java_com_bytedance_fastbot_AiClient_endSessionNative(JNIEnv *, jobject) {
+    awaitAgentInit();
+    if (nullptr == _fastbot_model) return;
+    _fastbot_model->endSession();
+}
+
+// Latency histograms of the getAction stages as compact JSON (PerfStats::toJson, microseconds),
+// cleared afterwards if reset; "" before the model exists
+jstring JNICALL Java_com_bytedance_fastbot_AiClient_getPerfStatsNative(JNIEnv *env, jobject, jboolean reset) {
+    awaitModelInit();
+    if (nullptr == _fastbot_model) return env->NewStringUTF("");
+    fastbotx::PerfStats &stats = _fastbot_model->getPerfStats();
+    std::string json = stats.toJson();
+    if (reset == JNI_TRUE) {
+        stats.reset();
+    }
+    return env->NewStringUTF(json.c_str());
+}
+
+// Estimated heap bytes per subsystem as JSON (Model::getMemoryFootprintJson); "" before the model exists
+jstring JNICALL Java_com_bytedance_fastbot_AiClient_getMemoryFootprintNative(JNIEnv *env, jobject) {
+    awaitModelInit();
+    if (nullptr == _fastbot_model) return env->NewStringUTF("");
+    std::string json = _fastbot_model->getMemoryFootprintJson();
+    return env->NewStringUTF(json.c_str());
+}
+
+// Record every getActionFromBufferNative / b0bhkadf call (page, activity, operation, cost) to a
+// GUI trace file at path, replacing the trace being recorded; false if the file cannot be created
+jboolean JNICALL
+Java_com_bytedance_fastbot_AiClient_startGuiTraceRecordingNative(JNIEnv *env, jobject, jstring path) {
+    if (path == nullptr) return JNI_FALSE;
+    const char *pathCString = env->GetStringUTFChars(path, nullptr);
+    auto recorder = std::make_shared<fastbotx::GuiTraceRecorder>(std::string(pathCString));
+    env->ReleaseStringUTFChars(path, pathCString);
+    if (!recorder->isOpen()) return JNI_FALSE;
+    std::atomic_store(&_gui_trace_recorder, recorder);
+    return JNI_TRUE;
+}
+
+// Stop recording; the trace is complete once the calls still holding the recorder return
+void JNICALL Java_com_bytedance_fastbot_AiClient_stopGuiTraceRecordingNative(JNIEnv *, jobject) {
+    std::atomic_store(&_gui_trace_recorder, fastbotx::GuiTraceRecorderPtr());
+}
+
+// Reload max.widget.black and max.tree.pruning mid-run; parsing happens on the calling thread
+jboolean JNICALL
+Java_com_bytedance_fastbot_AiClient_reloadPreferencesNative(JNIEnv *env, jobject, jboolean onlyIfChanged) {
+    awaitModelInit();
+    if (nullptr == _fastbot_model) return JNI_FALSE;
+    auto preference = _fastbot_model->getPreference();
+    if (!preference) return JNI_FALSE;
+    return preference->reloadRules(onlyIfChanged == JNI_TRUE) ? JNI_TRUE : JNI_FALSE;
+}
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
@@ -23,27 +23,90 @@ Java_com_bytedance_fastbot_AiClient_fgdsaf5d(JNIEnv *env, jobject, jint, jstring
 //loadResMapping
 JNIEXPORT void JNICALL Java_com_bytedance_fastbot_AiClient_jdasdbil(JNIEnv *env, jobject, jstring);
 
+//InitAgent in the background, with the resource mapping of resMappingPath ("" for none)
+JNIEXPORT void JNICALL
+Java_com_bytedance_fastbot_AiClient_initAgentAsyncNative(JNIEnv *env, jobject, jint, jstring, jint, jstring);
+
 JNIEXPORT jboolean JNICALL
 Java_com_bytedance_fastbot_AiClient_nkksdhdk(JNIEnv *env, jobject, jstring activity, jfloat pointX,
                                              jfloat pointY);
 JNIEXPORT jbooleanArray JNICALL
 Java_com_bytedance_fastbot_AiClient_checkPointsInShieldNative(JNIEnv *env, jobject, jstring activity,
                                                               jfloatArray xCoords, jfloatArray yCoords);
+JNIEXPORT jbooleanArray JNICALL
+Java_com_bytedance_fastbot_AiClient_checkPointsInShieldNativeByHandle(JNIEnv *env, jobject, jint activityHandle,
+                                                                      jfloatArray xCoords, jfloatArray yCoords);
 JNIEXPORT jstring JNICALL
 Java_com_bytedance_fastbot_AiClient_getActionFromBufferNative(JNIEnv *env, jobject, jstring activity,
                                                               jobject xmlBuffer, jint byteLength);
+JNIEXPORT jstring JNICALL
+Java_com_bytedance_fastbot_AiClient_getActionPlanFromBufferNative(JNIEnv *env, jobject, jstring activity,
+                                                                  jobject xmlBuffer, jint byteLength,
+                                                                  jint maxSteps, jint unexecutedSteps);
 JNIEXPORT jobject JNICALL
 Java_com_bytedance_fastbot_AiClient_getActionFromBufferNativeStructured(JNIEnv *env, jobject, jstring activity,
                                                                          jobject xmlBuffer, jint byteLength);
+JNIEXPORT jint JNICALL
+Java_com_bytedance_fastbot_AiClient_getActionFromBufferNativeInto(JNIEnv *env, jobject, jstring activity,
+                                                                   jobject xmlBuffer, jint byteLength,
+                                                                   jobject resultBuffer);
+// Activity handles: intern a name once, then pass its id instead of the string
+JNIEXPORT jint JNICALL
+Java_com_bytedance_fastbot_AiClient_registerActivityNative(JNIEnv *env, jobject, jstring activity);
+JNIEXPORT jint JNICALL
+Java_com_bytedance_fastbot_AiClient_getActionFromBufferNativeIntoByHandle(JNIEnv *env, jobject, jint activityHandle,
+                                                                           jobject xmlBuffer, jint byteLength,
+                                                                           jobject resultBuffer);
+JNIEXPORT jint JNICALL
+Java_com_bytedance_fastbot_AiClient_getActionNativeInto(JNIEnv *env, jobject, jstring activity,
+                                                        jstring xmlDescOfGuiTree, jobject resultBuffer);
+JNIEXPORT jint JNICALL
+Java_com_bytedance_fastbot_AiClient_takePendingResultNative(JNIEnv *env, jobject, jobject resultBuffer);
+JNIEXPORT jboolean JNICALL
+Java_com_bytedance_fastbot_AiClient_submitActionFromBufferNative(JNIEnv *env, jobject, jstring activity,
+                                                                 jobject xmlBuffer, jint byteLength);
+JNIEXPORT jboolean JNICALL
+Java_com_bytedance_fastbot_AiClient_submitActionFromBufferNativeByHandle(JNIEnv *env, jobject, jint activityHandle,
+                                                                         jobject xmlBuffer, jint byteLength);
+JNIEXPORT jint JNICALL
+Java_com_bytedance_fastbot_AiClient_pollActionResultNative(JNIEnv *env, jobject, jobject resultBuffer,
+                                                           jlong timeoutMs);
+JNIEXPORT jlong JNICALL
+Java_com_bytedance_fastbot_AiClient_getDeltaBaseDumpIdNative(JNIEnv *env, jobject);
 JNIEXPORT jstring JNICALL
 Java_com_bytedance_fastbot_AiClient_getNativeVersion(JNIEnv *env, jclass clazz);
 JNIEXPORT void JNICALL
 Java_com_bytedance_fastbot_AiClient_reportActivityNative(JNIEnv *env, jobject, jstring activity);
 JNIEXPORT jstring JNICALL
 Java_com_bytedance_fastbot_AiClient_getCoverageJsonNative(JNIEnv *env, jobject);
+JNIEXPORT jint JNICALL
+Java_com_bytedance_fastbot_AiClient_reportActivitiesNative(JNIEnv *env, jobject, jobject buffer, jint byteLength);
+JNIEXPORT jint JNICALL
+Java_com_bytedance_fastbot_AiClient_getCoverageDeltaNative(JNIEnv *env, jobject, jint sinceVersion,
+                                                           jobject resultBuffer);
 JNIEXPORT jstring JNICALL
 Java_com_bytedance_fastbot_AiClient_getNextFuzzActionNative(JNIEnv *env, jobject, jint displayWidth,
                                                             jint displayHeight, jboolean simplify);
+JNIEXPORT jint JNICALL
+Java_com_bytedance_fastbot_AiClient_getFuzzActionsIntoBufferNative(JNIEnv *env, jobject, jobject resultBuffer,
+                                                                   jint count, jint displayWidth,
+                                                                   jint displayHeight, jstring activity);
+JNIEXPORT void JNICALL
+Java_com_bytedance_fastbot_AiClient_setRandomSeedNative(JNIEnv *env, jobject, jlong seed);
+JNIEXPORT jboolean JNICALL
+Java_com_bytedance_fastbot_AiClient_flushModelNative(JNIEnv *env, jobject);
+JNIEXPORT void JNICALL
+Java_com_bytedance_fastbot_AiClient_endSessionNative(JNIEnv *env, jobject);
+JNIEXPORT jstring JNICALL
+Java_com_bytedance_fastbot_AiClient_getPerfStatsNative(JNIEnv *env, jobject, jboolean reset);
+JNIEXPORT jstring JNICALL
+Java_com_bytedance_fastbot_AiClient_getMemoryFootprintNative(JNIEnv *env, jobject);
+JNIEXPORT jboolean JNICALL
+Java_com_bytedance_fastbot_AiClient_startGuiTraceRecordingNative(JNIEnv *env, jobject, jstring path);
+JNIEXPORT void JNICALL
+Java_com_bytedance_fastbot_AiClient_stopGuiTraceRecordingNative(JNIEnv *env, jobject);
+JNIEXPORT jboolean JNICALL
+Java_com_bytedance_fastbot_AiClient_reloadPreferencesNative(JNIEnv *env, jobject, jboolean onlyIfChanged);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,82 @@
+/*
+ * This code is licensed under the Fastbot license. You may obtain a copy of this license in the LICENSE.txt file in the root directory of this source tree.
+ */
+/**
+ * @authors Jianqiang Guo, Yuhui Su, Zhao Zhang
+ */
+/**
+ * Host decision server for AlgorithmType::Server (Linux / macOS).
+ *
+ * Devices started with the Server algorithm and max.decisionServer=<host>:<port> in max.config
+ * send every GUI dump here; the server parses it, runs the Model and answers with the
+ * operate. A device decides locally (its own Double SARSA agent) while the server is slow
+ * or unreachable. See fastbotx::DecisionServer.
+ *
+ * Usage: fastbot_decision_server [--bind A] [--port P] [--threads N] [--max-devices D] [--shared] [--seed S]
+ *   --bind         Numeric address to listen on (default 127.0.0.1: reach it with adb reverse;
+ *                  the protocol is unauthenticated, so bind 0.0.0.0 or :: on trusted networks only)
+ *   --port         TCP port (default 7330)
+ *   --threads      Worker threads running steps (default: hardware threads)
+ *   --max-devices  Distinct devices served (default 64); further devices decide locally
+ *   --shared       One Model for all devices, an agent per device, instead of a Model per device
+ *   --seed         Exported as FASTBOT_RANDOM_SEED before any model exists (default: random)
+ */
+
+#include "../utils.hpp"
+#include "../model/DecisionServer.h"
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+static fastbotx::DecisionServer *_server = nullptr;
+
+static void onSignal(int) {
+    if (_server) {
+        _server->stop();
+    }
+}
+
+static void printUsage(const char *program) {
+    fprintf(stderr, "usage: %s [--bind A] [--port P] [--threads N] [--max-devices D] [--shared] [--seed S]\n",
+            program);
+}
+
+int main(int argc, char **argv) {
+    std::string address = "127.0.0.1";
+    int port = 7330;
+    size_t threads = std::max(1U, std::thread::hardware_concurrency());
+    size_t maxDevices = fastbotx::DecisionServer::DefaultMaxDevices;
+    bool shared = false;
+    for (int i = 1; i < argc; i++) {
+        if (0 == strcmp(argv[i], "--bind") && i + 1 < argc) {
+            address = argv[++i];
+        } else if (0 == strcmp(argv[i], "--port") && i + 1 < argc) {
+            port = atoi(argv[++i]);
+        } else if (0 == strcmp(argv[i], "--threads") && i + 1 < argc) {
+            threads = static_cast<size_t>(std::max(1, atoi(argv[++i])));
+        } else if (0 == strcmp(argv[i], "--max-devices") && i + 1 < argc) {
+            maxDevices = static_cast<size_t>(std::max(1, atoi(argv[++i])));
+        } else if (0 == strcmp(argv[i], "--shared")) {
+            shared = true;
+        } else if (0 == strcmp(argv[i], "--seed") && i + 1 < argc) {
+            setenv("FASTBOT_RANDOM_SEED", argv[++i], 1);
+        } else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+    signal(SIGPIPE, SIG_IGN);
+    fastbotx::DecisionServer server(shared, threads, maxDevices);
+    if (!server.listen(address, port)) {
+        return 1;
+    }
+    _server = &server;
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    server.run();
+    _server = nullptr;
+    printf("decision server stopped, served %zu devices\n", server.deviceCount());
+    return 0;
+}
@@ -89,7 +89,10 @@ namespace fastbotx {
         typedef ReuseEntryBuilder Builder;
         enum FlatBuffersVTableOffset FLATBUFFERS_VTABLE_UNDERLYING_TYPE {
             VT_ACTION = 4,
-            VT_TARGETS = 6
+            VT_TARGETS = 6,
+            VT_Q1 = 8,
+            VT_Q2 = 10,
+            VT_VISITS = 12
         };
 
         uint64_t action() const {
@@ -109,12 +112,27 @@ namespace fastbotx {
                     VT_TARGETS);
         }
 
+        double q1() const {
+            return GetField<double>(VT_Q1, 0.0);
+        }
+
+        double q2() const {
+            return GetField<double>(VT_Q2, 0.0);
+        }
+
+        uint32_t visits() const {
+            return GetField<uint32_t>(VT_VISITS, 0);
+        }
+
         bool Verify(flatbuffers::Verifier &verifier) const {
             return VerifyTableStart(verifier) &&
                    VerifyField<uint64_t>(verifier, VT_ACTION) &&
                    VerifyOffset(verifier, VT_TARGETS) &&
                    verifier.VerifyVector(targets()) &&
                    verifier.VerifyVectorOfTables(targets()) &&
+                   VerifyField<double>(verifier, VT_Q1) &&
+                   VerifyField<double>(verifier, VT_Q2) &&
+                   VerifyField<uint32_t>(verifier, VT_VISITS) &&
                    verifier.EndTable();
         }
     };
@@ -135,6 +153,18 @@ namespace fastbotx {
             fbb_.AddOffset(ReuseEntry::VT_TARGETS, targets);
         }
 
+        void add_q1(double q1) {
+            fbb_.AddElement<double>(ReuseEntry::VT_Q1, q1, 0.0);
+        }
+
+        void add_q2(double q2) {
+            fbb_.AddElement<double>(ReuseEntry::VT_Q2, q2, 0.0);
+        }
+
+        void add_visits(uint32_t visits) {
+            fbb_.AddElement<uint32_t>(ReuseEntry::VT_VISITS, visits, 0);
+        }
+
         explicit ReuseEntryBuilder(flatbuffers::FlatBufferBuilder &_fbb)
                 : fbb_(_fbb) {
             start_ = fbb_.StartTable();
@@ -150,9 +180,15 @@ namespace fastbotx {
     inline flatbuffers::Offset<ReuseEntry> CreateReuseEntry(
             flatbuffers::FlatBufferBuilder &_fbb,
             uint64_t action = 0,
-            flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<fastbotx::ActivityTimes>>> targets = 0) {
+            flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<fastbotx::ActivityTimes>>> targets = 0,
+            double q1 = 0.0,
+            double q2 = 0.0,
+            uint32_t visits = 0) {
         ReuseEntryBuilder builder_(_fbb);
+        builder_.add_q2(q2);
+        builder_.add_q1(q1);
         builder_.add_action(action);
+        builder_.add_visits(visits);
         builder_.add_targets(targets);
         return builder_.Finish();
     }
@@ -160,19 +196,27 @@ namespace fastbotx {
 inline flatbuffers::Offset<ReuseEntry> CreateReuseEntryDirect(
         flatbuffers::FlatBufferBuilder &_fbb,
         uint64_t action = 0,
-        const std::vector<flatbuffers::Offset<fastbotx::ActivityTimes>> *targets = nullptr) {
+        const std::vector<flatbuffers::Offset<fastbotx::ActivityTimes>> *targets = nullptr,
+        double q1 = 0.0,
+        double q2 = 0.0,
+        uint32_t visits = 0) {
     auto targets__ = targets ? _fbb.CreateVector<flatbuffers::Offset<fastbotx::ActivityTimes>>(
             *targets) : 0;
     return fastbotx::CreateReuseEntry(
             _fbb,
             action,
-            targets__);
+            targets__,
+            q1,
+            q2,
+            visits);
 }
 
 struct ReuseModel FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
     typedef ReuseModelBuilder Builder;
     enum FlatBuffersVTableOffset FLATBUFFERS_VTABLE_UNDERLYING_TYPE {
-        VT_MODEL = 4
+        VT_MODEL = 4,
+        VT_VERSION = 6,
+        VT_CHECKPOINT = 8
     };
 
     const flatbuffers::Vector<flatbuffers::Offset<fastbotx::ReuseEntry>> *model() const {
@@ -180,11 +224,21 @@ struct ReuseModel FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
                 VT_MODEL);
     }
 
+    uint32_t version() const {
+        return GetField<uint32_t>(VT_VERSION, 0);
+    }
+
+    uint64_t checkpoint() const {
+        return GetField<uint64_t>(VT_CHECKPOINT, 0);
+    }
+
     bool Verify(flatbuffers::Verifier &verifier) const {
         return VerifyTableStart(verifier) &&
                VerifyOffset(verifier, VT_MODEL) &&
                verifier.VerifyVector(model()) &&
                verifier.VerifyVectorOfTables(model()) &&
+               VerifyField<uint32_t>(verifier, VT_VERSION) &&
+               VerifyField<uint64_t>(verifier, VT_CHECKPOINT) &&
                verifier.EndTable();
     }
 };
@@ -199,6 +253,14 @@ struct ReuseModelBuilder {
         fbb_.AddOffset(ReuseModel::VT_MODEL, model);
     }
 
+    void add_version(uint32_t version) {
+        fbb_.AddElement<uint32_t>(ReuseModel::VT_VERSION, version, 0);
+    }
+
+    void add_checkpoint(uint64_t checkpoint) {
+        fbb_.AddElement<uint64_t>(ReuseModel::VT_CHECKPOINT, checkpoint, 0);
+    }
+
     explicit ReuseModelBuilder(flatbuffers::FlatBufferBuilder &_fbb)
             : fbb_(_fbb) {
         start_ = fbb_.StartTable();
@@ -213,19 +275,27 @@ struct ReuseModelBuilder {
 
 inline flatbuffers::Offset<ReuseModel> CreateReuseModel(
         flatbuffers::FlatBufferBuilder &_fbb,
-        flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<fastbotx::ReuseEntry>>> model = 0) {
+        flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<fastbotx::ReuseEntry>>> model = 0,
+        uint32_t version = 0,
+        uint64_t checkpoint = 0) {
     ReuseModelBuilder builder_(_fbb);
+    builder_.add_checkpoint(checkpoint);
+    builder_.add_version(version);
     builder_.add_model(model);
     return builder_.Finish();
 }
 
 inline flatbuffers::Offset<ReuseModel> CreateReuseModelDirect(
         flatbuffers::FlatBufferBuilder &_fbb,
-        std::vector<flatbuffers::Offset<fastbotx::ReuseEntry>> *model = nullptr) {
+        std::vector<flatbuffers::Offset<fastbotx::ReuseEntry>> *model = nullptr,
+        uint32_t version = 0,
+        uint64_t checkpoint = 0) {
     auto model__ = model ? _fbb.CreateVectorOfSortedTables<fastbotx::ReuseEntry>(model) : 0;
     return fastbotx::CreateReuseModel(
             _fbb,
-            model__);
+            model__,
+            version,
+            checkpoint);
 }
 
 inline const fastbotx::ReuseModel *GetReuseModel(const void *buf) {
@@ -7951,7 +7951,7 @@ class lexer
     JSON_HEDLEY_NON_NULL(2)
     static void strtof(float& f, const char* str, char** endptr) noexcept
     {
-        f = strtof(str, endptr);
+        f = std::strtof(str, endptr);
     }
 
     JSON_HEDLEY_NON_NULL(2)
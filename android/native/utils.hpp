@@ -7,11 +7,11 @@
 #ifndef UTILS_HPP_
 #define UTILS_HPP_
 
-#define _DEBUG_ 1
 #define TAG "[FastbotNative]"
 
 #include <string>
 #include <algorithm>
+#include <atomic>
 
 #ifdef __ANDROID__
 
@@ -23,7 +23,21 @@
 #define LOGE(fmt, ...) __android_log_print(ANDROID_LOG_ERROR,TAG ,fmt, ##__VA_ARGS__)
 #define LOGF(fmt, ...) __android_log_print(ANDROID_LOG_FATAL,TAG ,fmt, ##__VA_ARGS__)
 #else
-#define Time_Format_Now (getTimeFormatStr().c_str())
+
+#include <cstdio>
+#include <ctime>
+
+// Timestamp of host log lines; self-contained so the macros also work outside namespace fastbotx
+inline std::string logTimeFormatStr() {
+    time_t now = time(nullptr);
+    struct tm timeStruct{};
+    localtime_r(&now, &timeStruct);
+    char buf[32];
+    strftime(buf, sizeof(buf), "%Y-%m-%d %T", &timeStruct);
+    return {buf};
+}
+
+#define Time_Format_Now (logTimeFormatStr().c_str())
 #define LOGD(fmt, ...) printf(TAG "[%s] DEBUG[%s][%s][%d]:" fmt "\n", Time_Format_Now, __FILE__, __FUNCTION__, __LINE__, ##__VA_ARGS__)
 #define LOGI(fmt, ...) printf(TAG "[%s] :" fmt "\n", Time_Format_Now ,##__VA_ARGS__)
 #define LOGW(fmt, ...) printf(TAG "[%s] WARNING:" fmt "\n", Time_Format_Now, ##__VA_ARGS__)
@@ -37,15 +51,64 @@
 #define ACTIVITY_VC_STR "ViewController"
 #endif
 
-//#if _DEBUG_
-#define BDLOG(fmt, ...)   LOGD(fmt,##__VA_ARGS__)
+// Compile-time log level. _DEBUG_ is defined by CMake for non-Release builds; Release
+// builds drop BDLOG entirely, so its arguments (toString() calls, loops building a
+// message) are never evaluated on the hot path. Override with -DFASTBOT_LOG_LEVEL=n.
+#define FASTBOT_LOG_LEVEL_ERROR 0
+#define FASTBOT_LOG_LEVEL_INFO  1
+#define FASTBOT_LOG_LEVEL_DEBUG 2
+
+#ifndef FASTBOT_LOG_LEVEL
+#ifdef _DEBUG_
+#define FASTBOT_LOG_LEVEL FASTBOT_LOG_LEVEL_DEBUG
+#else
+#define FASTBOT_LOG_LEVEL FASTBOT_LOG_LEVEL_INFO
+#endif
+#endif
+
+/// Whether BDLOG is compiled in; guard debug-only work that builds a log message with it
+#define FASTBOT_DEBUG_LOG (FASTBOT_LOG_LEVEL >= FASTBOT_LOG_LEVEL_DEBUG)
+
+// A disabled log still type-checks its format and arguments but never evaluates them
+#define FASTBOT_LOG_DISABLED_(LOG, fmt, ...) do { if (false) { LOG(fmt,##__VA_ARGS__); } } while (0)
+
+namespace fastbotx {
+
+    /**
+     * @brief Runtime log level, lowered from FASTBOT_LOG_LEVEL by max.nativeLogLevel
+     *
+     * Logs compiled in above it skip formatting and their arguments, so a quiet run does
+     * not build the per-step state and action dumps. Raising it past FASTBOT_LOG_LEVEL has
+     * no effect: those logs are not compiled in.
+     */
+    inline std::atomic<int> &runtimeLogLevel() {
+        static std::atomic<int> level{FASTBOT_LOG_LEVEL};
+        return level;
+    }
+
+    inline void setRuntimeLogLevel(int level) {
+        runtimeLogLevel().store(level, std::memory_order_relaxed);
+    }
+}
+
+/// Whether logs of this level are compiled in and enabled at runtime
+#define FASTBOT_LOG_ON(level) \
+    (FASTBOT_LOG_LEVEL >= (level) && fastbotx::runtimeLogLevel().load(std::memory_order_relaxed) >= (level))
+
+#define FASTBOT_LOG_AT_(level, LOG, fmt, ...) do { if (FASTBOT_LOG_ON(level)) { LOG(fmt,##__VA_ARGS__); } } while (0)
+
+#if FASTBOT_DEBUG_LOG
+#define BDLOG(fmt, ...)   FASTBOT_LOG_AT_(FASTBOT_LOG_LEVEL_DEBUG, LOGD, fmt,##__VA_ARGS__)
+#else
+#define BDLOG(fmt, ...)   FASTBOT_LOG_DISABLED_(LOGD, fmt,##__VA_ARGS__)
+#endif
 #define BDLOGE(fmt, ...)  LOGE(fmt,##__VA_ARGS__)
-//#else
-//#define BDLOGE(...)
-//#define BDLOG(...)
-//#endif
 
-#define BLOG(fmt, ...)    LOGI(fmt,##__VA_ARGS__)
+#if FASTBOT_LOG_LEVEL >= FASTBOT_LOG_LEVEL_INFO
+#define BLOG(fmt, ...)    FASTBOT_LOG_AT_(FASTBOT_LOG_LEVEL_INFO, LOGI, fmt,##__VA_ARGS__)
+#else
+#define BLOG(fmt, ...)    FASTBOT_LOG_DISABLED_(LOGI, fmt,##__VA_ARGS__)
+#endif
 #define BLOGE(fmt, ...)   LOGE(fmt,##__VA_ARGS__)
 
 // Android logcat has a limit of ~4KB per log line
@@ -102,7 +165,7 @@ inline void logLongStringInfo(const std::string& longStr) {
 // If should drop detail after hashing
 #define DROP_DETAIL_AFTER_SATE 1
 
-// If should generate hash based on text
+// If should generate hash based on text (also max.stateWithText at runtime)
 #define STATE_WITH_TEXT        0
 
 // Whether the text attribute participates in the hash generation,
@@ -111,10 +174,10 @@ inline void logLongStringInfo(const std::string& longStr) {
 // not participate in the abstraction, the length of the character will be truncated,
 #define STATE_TEXT_MAX_LEN     (2*3)
 
-// If should generate hash based on index
+// If should generate hash based on index (also max.stateWithIndex at runtime)
 #define STATE_WITH_INDEX       0
 
-// If should order widgets before generating hash
+// If should order widgets before generating hash (also max.stateWithWidgetOrder at runtime)
 #define STATE_WITH_WIDGET_ORDER 0
 
 #define STATE_MERGE_DETAIL_TEXT 1
@@ -139,6 +202,8 @@ inline void logLongStringInfo(const std::string& longStr) {
 #define AlphaMaxGuiActionsPerModelAction  3
 /// When true: per-round paper order — ActionRefinement(α) then StateCoarsening(β) then StateRefinement; when false: per-K-step batch (merge α + non-determinism)
 #define UsePaperRefinementOrder           0
+/// Refinement/coarsening tasks (about one activity each) run per step: a batch is spread over the steps after it
+#define AbstractionTasksPerStep           2
 /// Skip adding Text when widgets with non-empty text > this count (avoid list/article screens exploding)
 #define MaxTextWidgetCount                20
 /// Skip adding Text when (widgets with non-empty text) / total widgets > this ratio (0–100, e.g. 50 = 50%)
@@ -170,5 +235,90 @@ inline void logLongStringInfo(const std::string& longStr) {
 #define FASTBOT_LOG_BLACK_RECT_CHECK 0
 #endif
 
+// Performance optimization: Incremental state building
+// Set to 1 to reuse Widgets built on the previous step for GUI subtrees whose
+// Element::subtreeSignature() did not change (default)
+// Set to 0 to rebuild every Widget from scratch on each step
+#ifndef FASTBOT_INCREMENTAL_STATE_BUILD
+#define FASTBOT_INCREMENTAL_STATE_BUILD 1
+#endif
+
+// Performance optimization: Parallel state building
+// Set to N > 0 to build the Widgets of GUI trees of at least N nodes on the Model's
+// StepExecutor workers and the calling thread together, chunk of subtrees by chunk; they
+// are joined in the serial order, so states and their hashes do not change. Single-core
+// hosts still build on the calling thread. Opt in after measuring createReuseStateParallel
+// against createReuseStateChanged on the target devices; 2000 is a reasonable start
+// Set to 0 to build every tree on the calling thread (default)
+#ifndef FASTBOT_PARALLEL_STATE_BUILD
+#define FASTBOT_PARALLEL_STATE_BUILD 0
+#endif
+
+// Performance optimization: Fused attribute hashing in the binary parser
+// Set to 1 to hash text and content-desc payloads in Element::createFromBinary while
+// they are read, so Widget construction and state hashing do not hash them again (default)
+// Set to 0 to hash the strings when Widgets are built
+#ifndef FASTBOT_FUSED_PARSE_HASH
+#define FASTBOT_FUSED_PARSE_HASH 1
+#endif
+
+// Performance optimization: Compiled preference cache
+// Set to 1 to restore the parsed preference files from Preference::PreferenceCacheFilePath
+// when their size and mtime did not change since it was written (default)
+// Set to 0 to parse every preference file at startup
+#ifndef FASTBOT_PREFERENCE_CACHE
+#define FASTBOT_PREFERENCE_CACHE 1
+#endif
+
+// Performance optimization: Streaming XML parser
+// Set to 1 to build Elements from XML dumps directly with XmlStreamReader, falling back
+// to the tinyxml2 DOM only if the dump does not parse (default)
+// Set to 0 to always parse XML into a tinyxml2 DOM first
+#ifndef FASTBOT_STREAMING_XML
+#define FASTBOT_STREAMING_XML 1
+#endif
+
+// Performance optimization: Pipelined steps
+// Set to 1 to return a step's operation as soon as it is selected and finish the step
+// (strategy update, visit counts, state abstraction checks) on a StepExecutor worker
+// while the device executes it; the device's next step waits for it (default)
+// Set to 0 to finish every step before its operation is returned
+#ifndef FASTBOT_PIPELINED_STEPS
+#define FASTBOT_PIPELINED_STEPS 1
+#endif
+
+// Performance optimization: Speculative steps
+// Set to 1 to predict, while the device executes a step, the state it leads to (the one most
+// often reached after the same state and action) and let the agent select that state's action
+// ahead; the next step takes it when its page arrives as that state and asks the agent otherwise.
+// Only states that still have their details are predicted: with DROP_DETAIL_AFTER_SATE, the
+// state just left, i.e. actions that leave the page as it was
+// Set to 0 to select every action once its page arrived (default)
+#ifndef FASTBOT_SPECULATIVE_STEPS
+#define FASTBOT_SPECULATIVE_STEPS 0
+#endif
+
+// Memory optimization: Cold state storage
+// Set to N > 0 to pack the widgets and actions of detail-dropped states not seen in the
+// last N graph steps into a few bytes per action, rebuilt when the state is seen again
+// (default; needs DROP_DETAIL_AFTER_SATE)
+// Set to 0 to keep every state's widgets and actions for the whole run
+#ifndef FASTBOT_COLD_STATE_STEPS
+#define FASTBOT_COLD_STATE_STEPS 256
+#endif
+
+// Storage optimization: Compact reuse model files
+// Set to 1 to save reuse models (.fbm) in the CompactReuseModel encoding: an activity name
+// dictionary and delta-encoded, sorted action hashes with packed (activity id, times) pairs (default)
+// Set to 0 to save them as FlatBuffers ReuseModel; loading reads either encoding
+#ifndef FASTBOT_COMPACT_REUSE_MODEL
+#define FASTBOT_COMPACT_REUSE_MODEL 1
+#endif
+
+/// Worker threads of the Model's StepExecutor
+#ifndef StepExecutorThreads
+#define StepExecutorThreads 2
+#endif
+
 #endif // UTILS_HPP_
 